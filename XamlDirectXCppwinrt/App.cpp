@@ -7,6 +7,7 @@ using namespace winrt;
 using namespace winrt::Windows::ApplicationModel;
 using namespace winrt::Windows::ApplicationModel::Activation;
 using namespace winrt::Windows::Foundation;
+using namespace winrt::Windows::Storage;
 using namespace winrt::Windows::UI::Xaml;
 using namespace winrt::Windows::UI::Xaml::Controls;
 using namespace winrt::Windows::UI::Xaml::Navigation;
@@ -21,6 +22,7 @@ App::App()
 {
     InitializeComponent();
     Suspending({ this, &App::OnSuspending });
+    Resuming({ this, &App::OnResuming });
 
 #if defined _DEBUG && !defined DISABLE_XAML_GENERATED_BREAK_ON_UNHANDLED_EXCEPTION
     UnhandledException([this](IInspectable const&, UnhandledExceptionEventArgs const& e)
@@ -58,12 +60,6 @@ void App::OnLaunched(LaunchActivatedEventArgs const& e)
 
         rootFrame.NavigationFailed({ this, &App::OnNavigationFailed });
 
-        if (e.PreviousExecutionState() == ApplicationExecutionState::Terminated)
-        {
-            // Restore the saved session state only when appropriate, scheduling the
-            // final launch steps after the restore is complete
-        }
-
         if (e.PrelaunchActivated() == false)
         {
             if (rootFrame.Content() == nullptr)
@@ -73,6 +69,14 @@ void App::OnLaunched(LaunchActivatedEventArgs const& e)
                 // parameter
                 rootFrame.Navigate(xaml_typename<$projectname$::MainPage>(), box_value(e.Arguments()));
             }
+
+            // Pick the simulation up where it was when the app was terminated.
+            auto page = rootFrame.Content().try_as<$projectname$::MainPage>();
+            if (page != nullptr && e.PreviousExecutionState() == ApplicationExecutionState::Terminated)
+            {
+                get_self<implementation::MainPage>(page)->LoadInternalState(ApplicationData::Current().LocalSettings().Values());
+            }
+
             // Place the frame in the current Window
             Window::Current().Content(rootFrame);
             // Ensure the current window is active
@@ -103,9 +107,60 @@ void App::OnLaunched(LaunchActivatedEventArgs const& e)
 /// </summary>
 /// <param name="sender">The source of the suspend request.</param>
 /// <param name="e">Details about the suspend request.</param>
-void App::OnSuspending([[maybe_unused]] IInspectable const& sender, [[maybe_unused]] SuspendingEventArgs const& e)
+fire_and_forget App::OnSuspending([[maybe_unused]] IInspectable sender, SuspendingEventArgs e)
 {
-    // Save application state and stop any background activity
+    // Save application state and stop any background activity. The deferral keeps the app
+    // running until the frame in progress has finished and the snapshot has been saved.
+    auto page = GetMainPage();
+    if (page == nullptr)
+    {
+        co_return;
+    }
+
+    auto deferral = e.SuspendingOperation().GetDeferral();
+    try
+    {
+        co_await page->SuspendAsync(ApplicationData::Current().LocalSettings().Values());
+    }
+    catch (hresult_error const&)
+    {
+        // E.g. a cache file that couldn't be written. Whatever wasn't saved is rebuilt on the
+        // next launch, but a deferral that is never completed gets the app terminated.
+    }
+    deferral.Complete();
+}
+
+/// <summary>
+/// Invoked when the application is resumed from suspension with the contents of memory intact.
+/// </summary>
+void App::OnResuming(IInspectable const&, IInspectable const&)
+{
+    auto page = GetMainPage();
+    if (page != nullptr)
+    {
+        page->Resume();
+    }
+}
+
+/// <summary>
+/// The page showing the DirectX content, or nullptr if there isn't one, e.g. after a prelaunch.
+/// </summary>
+com_ptr<implementation::MainPage> App::GetMainPage()
+{
+    auto frame = Window::Current().Content().try_as<Frame>();
+    if (frame == nullptr)
+    {
+        return nullptr;
+    }
+
+    auto page = frame.Content().try_as<$projectname$::MainPage>();
+    if (page == nullptr)
+    {
+        return nullptr;
+    }
+    com_ptr<implementation::MainPage> result;
+    result.copy_from(get_self<implementation::MainPage>(page));
+    return result;
 }
 
 /// <summary>
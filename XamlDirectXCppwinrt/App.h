@@ -3,12 +3,18 @@
 
 namespace winrt::$projectname$::implementation
 {
+    struct MainPage;
+
     struct App : AppT<App>
     {
         App();
 
         void OnLaunched(Windows::ApplicationModel::Activation::LaunchActivatedEventArgs const&);
-        void OnSuspending(IInspectable const&, Windows::ApplicationModel::SuspendingEventArgs const&);
+        fire_and_forget OnSuspending(IInspectable, Windows::ApplicationModel::SuspendingEventArgs);
+        void OnResuming(IInspectable const&, IInspectable const&);
         void OnNavigationFailed(IInspectable const&, Windows::UI::Xaml::Navigation::NavigationFailedEventArgs const&);
+
+    private:
+        com_ptr<MainPage> GetMainPage();
     };
 }
@@ -0,0 +1,452 @@
+﻿#include "pch.h"
+#include "AntiAliasing.h"
+#include "Profiler.h"
+
+using namespace DirectX;
+
+DX::AntiAliasing::AntiAliasing(const std::shared_ptr<DeviceResources>& deviceResources, const std::shared_ptr<ShaderLibrary>& shaderLibrary) :
+	m_deviceResources(deviceResources),
+	m_shaderLibrary(shaderLibrary),
+	m_requestedMode(static_cast<uint32_t>(AntiAliasingMode::None)),
+	m_appliedRequest(UINT32_MAX),
+	m_mode(AntiAliasingMode::None),
+	m_sampleCount(1),
+	m_targetsDirty(true),
+	m_width(0),
+	m_height(0),
+	m_accumulationFrames(0),
+	m_frameIndex(0),
+	m_costs(),
+	m_frames(),
+	m_nextFrame(0),
+	m_pendingCount(0),
+	m_inFrame(false),
+	m_historyIndex(0),
+	m_historyValid(false),
+	m_historyViewport(),
+	m_previousViewProjection(),
+	m_temporalLoadingComplete(false)
+{
+}
+
+winrt::fire_and_forget DX::AntiAliasing::CreateDeviceDependentResourcesAsync()
+{
+	DX_PROFILE_SCOPE("AntiAliasing::CreateDeviceDependentResourcesAsync");
+
+	auto device = m_deviceResources->GetD3DDevice();
+
+	// Without timestamp queries the modes still work; their costs just aren't measured.
+	CD3D11_QUERY_DESC disjointDesc(D3D11_QUERY_TIMESTAMP_DISJOINT);
+	CD3D11_QUERY_DESC timestampDesc(D3D11_QUERY_TIMESTAMP);
+	for (auto& frame : m_frames)
+	{
+		if (FAILED(device->CreateQuery(&disjointDesc, frame.disjoint.put())) ||
+			FAILED(device->CreateQuery(&timestampDesc, frame.begin.put())) ||
+			FAILED(device->CreateQuery(&timestampDesc, frame.resolve.put())) ||
+			FAILED(device->CreateQuery(&timestampDesc, frame.end.put())))
+		{
+			for (auto& created : m_frames)
+			{
+				created = Frame();
+			}
+			break;
+		}
+	}
+
+	m_nextFrame = 0;
+	m_pendingCount = 0;
+	m_inFrame = false;
+
+	// Apply the requested mode again on the new device.
+	m_appliedRequest = UINT32_MAX;
+	m_targetsDirty = true;
+
+	if (m_deviceResources->GetDeviceFeatureLevel() >= D3D_FEATURE_LEVEL_10_0)
+	{
+		ShaderVariant vertexShader;
+		co_await m_shaderLibrary->LoadAsync("FullscreenVertexShader", 0, &vertexShader);
+		winrt::check_hresult(
+			device->CreateVertexShader(
+				vertexShader.bytecode.data,
+				vertexShader.bytecode.size,
+				nullptr,
+				m_fullscreenVertexShader.put()));
+
+		ShaderVariant pixelShader;
+		co_await m_shaderLibrary->LoadAsync("TemporalResolvePixelShader", 0, &pixelShader);
+		winrt::check_hresult(
+			device->CreatePixelShader(
+				pixelShader.bytecode.data,
+				pixelShader.bytecode.size,
+				nullptr,
+				m_temporalResolveShader.put()));
+
+		CD3D11_BUFFER_DESC constantBufferDesc(sizeof(TemporalResolveConstantBuffer), D3D11_BIND_CONSTANT_BUFFER);
+		winrt::check_hresult(device->CreateBuffer(&constantBufferDesc, nullptr, m_constantBuffer.put()));
+
+		CD3D11_SAMPLER_DESC samplerDesc(D3D11_DEFAULT);
+		winrt::check_hresult(device->CreateSamplerState(&samplerDesc, m_sampler.put()));
+
+		m_temporalLoadingComplete = true;
+	}
+}
+
+// The targets follow the back buffer's size; they are created again by the next Update.
+void DX::AntiAliasing::CreateWindowSizeDependentResources()
+{
+	const DisplayMetrics& metrics = m_deviceResources->GetDisplayMetrics();
+	m_width = static_cast<uint32_t>(metrics.renderTargetWidth);
+	m_height = static_cast<uint32_t>(metrics.renderTargetHeight);
+	m_targetsDirty = true;
+}
+
+void DX::AntiAliasing::ReleaseDeviceDependentResources()
+{
+	m_temporalLoadingComplete = false;
+	for (auto& frame : m_frames)
+	{
+		frame = Frame();
+	}
+
+	ReleaseTargets();
+	m_fullscreenVertexShader = nullptr;
+	m_temporalResolveShader = nullptr;
+	m_constantBuffer = nullptr;
+	m_sampler = nullptr;
+	m_pendingCount = 0;
+	m_inFrame = false;
+}
+
+void DX::AntiAliasing::SetMode(AntiAliasingMode mode, uint32_t sampleCount)
+{
+	m_requestedMode.store(static_cast<uint32_t>(mode) | ((std::min)(sampleCount, 255u) << 8), std::memory_order_relaxed);
+}
+
+void DX::AntiAliasing::Trim()
+{
+	ReleaseTargets();
+	m_targetsDirty = true;
+}
+
+bool DX::AntiAliasing::Update()
+{
+	ReadBackFrames(m_deviceResources->GetD3DDeviceContext());
+
+	uint32_t request = m_requestedMode.load(std::memory_order_relaxed);
+	if (request != m_appliedRequest)
+	{
+		// Temporal waits for its shaders, if the device can run them at all.
+		AntiAliasingMode mode = static_cast<AntiAliasingMode>(request & 0xFF);
+		bool waiting =
+			mode == AntiAliasingMode::Temporal &&
+			!m_temporalLoadingComplete &&
+			m_deviceResources->GetDeviceFeatureLevel() >= D3D_FEATURE_LEVEL_10_0;
+
+		if (!waiting)
+		{
+			m_appliedRequest = request;
+			m_mode = mode;
+			m_sampleCount = request >> 8;
+			m_targetsDirty = true;
+		}
+	}
+
+	if (!m_targetsDirty)
+	{
+		return false;
+	}
+
+	CreateTargets();
+	m_targetsDirty = false;
+	return true;
+}
+
+// Antialiased content is resolved over the whole target, so what is outside the damage
+// would be replaced too; repaint all of it instead.
+void DX::AntiAliasing::CollectDamage(DirtyRect const& bounds, DirtyRegion& damage)
+{
+	if (!IsActive())
+	{
+		m_accumulationFrames = 0;
+		return;
+	}
+
+	if (!damage.IsEmpty())
+	{
+		// Two jitter cycles bring the history within a fifth of the settled image.
+		m_accumulationFrames = m_mode == AntiAliasingMode::Temporal ? JitterLength * 2 : 0;
+	}
+	else if (m_accumulationFrames > 0)
+	{
+		m_accumulationFrames--;
+	}
+	else
+	{
+		return;
+	}
+
+	damage.Add(bounds);
+}
+
+DX::JitterOffset DX::AntiAliasing::GetProjectionJitter(D3D11_VIEWPORT const& viewport) const
+{
+	if (m_mode != AntiAliasingMode::Temporal || !IsActive())
+	{
+		return { 0.0f, 0.0f };
+	}
+
+	return JitterToClip(ComputeJitter(m_frameIndex, JitterLength), viewport.Width, viewport.Height);
+}
+
+void DX::AntiAliasing::BeginScene(ID3D11DeviceContext3* context)
+{
+	m_costs[static_cast<uint32_t>(m_mode)].frames++;
+
+	// Every query is still in flight. Skip measuring this frame rather than wait.
+	if (m_frames[0].disjoint == nullptr || m_pendingCount == FrameLatency)
+	{
+		return;
+	}
+
+	Frame& frame = m_frames[m_nextFrame];
+	frame.mode = m_mode;
+	context->Begin(frame.disjoint.get());
+	context->End(frame.begin.get());
+	m_inFrame = true;
+}
+
+void DX::AntiAliasing::Resolve(ID3D11DeviceContext3* context, ID3D11RenderTargetView* destination, D3D11_VIEWPORT const& viewport, XMFLOAT4X4 const& viewProjection)
+{
+	Frame& frame = m_frames[m_nextFrame];
+	if (m_inFrame)
+	{
+		context->End(frame.resolve.get());
+	}
+
+	if (IsActive())
+	{
+		if (m_mode == AntiAliasingMode::Multisample)
+		{
+			winrt::com_ptr<ID3D11Resource> destinationResource;
+			destination->GetResource(destinationResource.put());
+			context->ResolveSubresource(destinationResource.get(), 0, m_colorTexture.get(), 0, DXGI_FORMAT_B8G8R8A8_UNORM);
+		}
+		else if (m_mode == AntiAliasingMode::Temporal)
+		{
+			ResolveTemporal(context, destination, viewport, viewProjection);
+		}
+
+		context->OMSetRenderTargets(1, &destination, nullptr);
+	}
+
+	if (m_inFrame)
+	{
+		context->End(frame.end.get());
+		context->End(frame.disjoint.get());
+		m_nextFrame = (m_nextFrame + 1) % FrameLatency;
+		m_pendingCount++;
+		m_inFrame = false;
+	}
+
+	m_frameIndex++;
+}
+
+// Draws one triangle over the viewport, writing the blend to the destination and to the
+// history that the next frame reads.
+void DX::AntiAliasing::ResolveTemporal(ID3D11DeviceContext3* context, ID3D11RenderTargetView* destination, D3D11_VIEWPORT const& viewport, XMFLOAT4X4 const& viewProjection)
+{
+	// History drawn at another resolution doesn't line up with this frame.
+	if (viewport.Width != m_historyViewport.Width || viewport.Height != m_historyViewport.Height)
+	{
+		m_historyValid = false;
+		m_historyViewport = viewport;
+	}
+
+	XMMATRIX current = XMLoadFloat4x4(&viewProjection);
+	XMMATRIX previous = m_historyValid ? XMLoadFloat4x4(&m_previousViewProjection) : current;
+
+	TemporalResolveConstantBuffer constants = {};
+	XMStoreFloat4x4(&constants.reprojection, XMMatrixMultiply(XMMatrixInverse(nullptr, current), previous));
+	constants.viewportSize = XMFLOAT2(viewport.Width, viewport.Height);
+	constants.textureSizeInverse = XMFLOAT2(1.0f / m_width, 1.0f / m_height);
+	constants.currentWeight = m_historyValid ? CurrentWeight : 1.0f;
+	context->UpdateSubresource1(m_constantBuffer.get(), 0, nullptr, &constants, 0, 0, 0);
+
+	uint32_t nextHistory = m_historyIndex ^ 1;
+	ID3D11RenderTargetView* targets[2] = { destination, m_historyTargetViews[nextHistory].get() };
+	context->OMSetRenderTargets(ARRAYSIZE(targets), targets, nullptr);
+
+	ID3D11ShaderResourceView* views[3] = { m_colorView.get(), m_depthView.get(), m_historyViews[m_historyIndex].get() };
+	ID3D11Buffer* constantBuffer = m_constantBuffer.get();
+	ID3D11SamplerState* sampler = m_sampler.get();
+	context->IASetInputLayout(nullptr);
+	context->IASetPrimitiveTopology(D3D11_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
+	context->VSSetShader(m_fullscreenVertexShader.get(), nullptr, 0);
+	context->PSSetShader(m_temporalResolveShader.get(), nullptr, 0);
+	context->PSSetConstantBuffers1(TemporalResolveConstantBufferLayout.registerIndex, 1, &constantBuffer, nullptr, nullptr);
+	context->PSSetShaderResources(0, ARRAYSIZE(views), views);
+	context->PSSetSamplers(0, 1, &sampler);
+	context->Draw(3, 0);
+
+	// The scene's targets are written again next frame.
+	ID3D11ShaderResourceView* nullViews[ARRAYSIZE(views)] = {};
+	context->PSSetShaderResources(0, ARRAYSIZE(nullViews), nullViews);
+
+	m_historyIndex = nextHistory;
+	m_historyValid = true;
+	m_previousViewProjection = viewProjection;
+}
+
+// Reads the timings of finished frames without blocking, and adds them to their modes' costs.
+void DX::AntiAliasing::ReadBackFrames(ID3D11DeviceContext3* context)
+{
+	while (m_pendingCount > 0)
+	{
+		Frame& frame = m_frames[(m_nextFrame + FrameLatency - m_pendingCount) % FrameLatency];
+
+		D3D11_QUERY_DATA_TIMESTAMP_DISJOINT disjointData;
+		uint64_t begin;
+		uint64_t resolve;
+		uint64_t end;
+		if (context->GetData(frame.disjoint.get(), &disjointData, sizeof(disjointData), D3D11_ASYNC_GETDATA_DONOTFLUSH) != S_OK ||
+			context->GetData(frame.begin.get(), &begin, sizeof(begin), D3D11_ASYNC_GETDATA_DONOTFLUSH) != S_OK ||
+			context->GetData(frame.resolve.get(), &resolve, sizeof(resolve), D3D11_ASYNC_GETDATA_DONOTFLUSH) != S_OK ||
+			context->GetData(frame.end.get(), &end, sizeof(end), D3D11_ASYNC_GETDATA_DONOTFLUSH) != S_OK)
+		{
+			break;
+		}
+		m_pendingCount--;
+
+		if (disjointData.Disjoint)
+		{
+			continue;
+		}
+
+		double millisecondsPerTick = 1000.0 / disjointData.Frequency;
+		AntiAliasingCost& cost = m_costs[static_cast<uint32_t>(frame.mode)];
+		cost.measuredFrames++;
+		cost.sceneMilliseconds += (end - begin) * millisecondsPerTick;
+		cost.resolveMilliseconds += (end - resolve) * millisecondsPerTick;
+	}
+}
+
+// Creates the targets of the applied mode, falling back to what the device supports.
+void DX::AntiAliasing::CreateTargets()
+{
+	ReleaseTargets();
+	m_historyValid = false;
+
+	auto device = m_deviceResources->GetD3DDevice();
+	if (m_mode == AntiAliasingMode::Temporal && !m_temporalLoadingComplete)
+	{
+		m_mode = AntiAliasingMode::None;
+	}
+
+	if (m_mode == AntiAliasingMode::Multisample)
+	{
+		auto supports = [&](uint32_t sampleCount)
+		{
+			UINT colorLevels = 0;
+			UINT depthLevels = 0;
+			return
+				SUCCEEDED(device->CheckMultisampleQualityLevels(DXGI_FORMAT_B8G8R8A8_UNORM, sampleCount, &colorLevels)) && colorLevels > 0 &&
+				SUCCEEDED(device->CheckMultisampleQualityLevels(DXGI_FORMAT_D24_UNORM_S8_UINT, sampleCount, &depthLevels)) && depthLevels > 0;
+		};
+
+		// Try the largest power of two up to the requested count, then halve it.
+		uint32_t sampleCount = 2;
+		while (sampleCount * 2 <= (std::min)(m_sampleCount, static_cast<uint32_t>(D3D11_MAX_MULTISAMPLE_SAMPLE_COUNT)))
+		{
+			sampleCount *= 2;
+		}
+		while (sampleCount >= 2 && !supports(sampleCount))
+		{
+			sampleCount /= 2;
+		}
+
+		m_sampleCount = sampleCount;
+		if (sampleCount < 2)
+		{
+			m_mode = AntiAliasingMode::None;
+		}
+	}
+
+	if (m_mode != AntiAliasingMode::Multisample)
+	{
+		m_sampleCount = 1;
+	}
+
+	if (m_mode == AntiAliasingMode::None || m_width == 0 || m_height == 0)
+	{
+		return;
+	}
+
+	bool temporal = m_mode == AntiAliasingMode::Temporal;
+	uint64_t pixelCount = uint64_t(m_width) * m_height;
+
+	CD3D11_TEXTURE2D_DESC colorDesc(
+		DXGI_FORMAT_B8G8R8A8_UNORM,
+		m_width,
+		m_height,
+		1,
+		1,
+		D3D11_BIND_RENDER_TARGET | (temporal ? D3D11_BIND_SHADER_RESOURCE : 0),
+		D3D11_USAGE_DEFAULT,
+		0,
+		m_sampleCount);
+	winrt::check_hresult(device->CreateTexture2D(&colorDesc, nullptr, m_colorTexture.put()));
+	winrt::check_hresult(device->CreateRenderTargetView(m_colorTexture.get(), nullptr, m_colorTargetView.put()));
+
+	winrt::com_ptr<ID3D11Texture2D> depthStencil;
+	if (temporal)
+	{
+		winrt::check_hresult(device->CreateShaderResourceView(m_colorTexture.get(), nullptr, m_colorView.put()));
+
+		// Typeless, so that the depth can be read as well as tested.
+		CD3D11_TEXTURE2D_DESC depthDesc(DXGI_FORMAT_R24G8_TYPELESS, m_width, m_height, 1, 1, D3D11_BIND_DEPTH_STENCIL | D3D11_BIND_SHADER_RESOURCE);
+		winrt::check_hresult(device->CreateTexture2D(&depthDesc, nullptr, depthStencil.put()));
+
+		CD3D11_DEPTH_STENCIL_VIEW_DESC depthStencilViewDesc(D3D11_DSV_DIMENSION_TEXTURE2D, DXGI_FORMAT_D24_UNORM_S8_UINT);
+		winrt::check_hresult(device->CreateDepthStencilView(depthStencil.get(), &depthStencilViewDesc, m_depthStencilView.put()));
+
+		CD3D11_SHADER_RESOURCE_VIEW_DESC depthViewDesc(D3D11_SRV_DIMENSION_TEXTURE2D, DXGI_FORMAT_R24_UNORM_X8_TYPELESS);
+		winrt::check_hresult(device->CreateShaderResourceView(depthStencil.get(), &depthViewDesc, m_depthView.put()));
+
+		CD3D11_TEXTURE2D_DESC historyDesc(DXGI_FORMAT_B8G8R8A8_UNORM, m_width, m_height, 1, 1, D3D11_BIND_RENDER_TARGET | D3D11_BIND_SHADER_RESOURCE);
+		for (uint32_t i = 0; i < 2; i++)
+		{
+			winrt::com_ptr<ID3D11Texture2D> history;
+			winrt::check_hresult(device->CreateTexture2D(&historyDesc, nullptr, history.put()));
+			winrt::check_hresult(device->CreateRenderTargetView(history.get(), nullptr, m_historyTargetViews[i].put()));
+			winrt::check_hresult(device->CreateShaderResourceView(history.get(), nullptr, m_historyViews[i].put()));
+		}
+
+		// Color, depth and two histories, four bytes a pixel each.
+		m_costs[static_cast<uint32_t>(m_mode)].targetBytes = pixelCount * 16;
+	}
+	else
+	{
+		CD3D11_TEXTURE2D_DESC depthDesc(DXGI_FORMAT_D24_UNORM_S8_UINT, m_width, m_height, 1, 1, D3D11_BIND_DEPTH_STENCIL, D3D11_USAGE_DEFAULT, 0, m_sampleCount);
+		winrt::check_hresult(device->CreateTexture2D(&depthDesc, nullptr, depthStencil.put()));
+
+		CD3D11_DEPTH_STENCIL_VIEW_DESC depthStencilViewDesc(D3D11_DSV_DIMENSION_TEXTURE2DMS);
+		winrt::check_hresult(device->CreateDepthStencilView(depthStencil.get(), &depthStencilViewDesc, m_depthStencilView.put()));
+
+		// Color and depth, four bytes a sample each.
+		m_costs[static_cast<uint32_t>(m_mode)].targetBytes = pixelCount * m_sampleCount * 8;
+	}
+}
+
+void DX::AntiAliasing::ReleaseTargets()
+{
+	m_colorTexture = nullptr;
+	m_colorTargetView = nullptr;
+	m_colorView = nullptr;
+	m_depthStencilView = nullptr;
+	m_depthView = nullptr;
+	for (uint32_t i = 0; i < 2; i++)
+	{
+		m_historyTargetViews[i] = nullptr;
+		m_historyViews[i] = nullptr;
+	}
+}
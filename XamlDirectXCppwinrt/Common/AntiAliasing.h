@@ -0,0 +1,175 @@
+﻿#pragma once
+
+#include "AntiAliasingFilters.h"
+#include "DeviceResources.h"
+#include "DirtyRegion.h"
+#include "ShaderLibrary.h"
+#include "ShaderReflection.h"
+
+#include <atomic>
+
+namespace DX
+{
+	enum class AntiAliasingMode : uint32_t
+	{
+		None,
+		Multisample,
+		Temporal,
+	};
+
+	static const uint32_t AntiAliasingModeCount = 3;
+
+	// What a mode has cost while it was in use. GPU times run from the clear of the 3D content
+	// to the end of its resolve, so they include the content itself, drawn the way the mode
+	// draws it, and are comparable between modes.
+	struct AntiAliasingCost
+	{
+		uint64_t	frames;					// Frames drawn in the mode.
+		uint64_t	measuredFrames;			// Frames whose GPU times were read back.
+		double		sceneMilliseconds;		// Total GPU time of the measured frames' 3D content.
+		double		resolveMilliseconds;	// Total GPU time of their resolves.
+		uint64_t	targetBytes;			// Size of the mode's render targets, as last created.
+	};
+
+	// Blends the current frame into the reprojected history. reprojection takes a point from
+	// the current frame's clip space to the previous frame's.
+	struct TemporalResolveConstantBuffer
+	{
+		DirectX::XMFLOAT4X4	reprojection;
+		DirectX::XMFLOAT2	viewportSize;
+		DirectX::XMFLOAT2	textureSizeInverse;
+		float				currentWeight;
+		float				padding[3];
+	};
+
+	constexpr auto TemporalResolveConstantBufferLayout = DescribeConstantBuffer<TemporalResolveConstantBuffer>(
+		"TemporalResolveConstantBuffer", 0,
+		DX_SHADER_FIELD(TemporalResolveConstantBuffer, reprojection, Float4x4),
+		DX_SHADER_FIELD(TemporalResolveConstantBuffer, viewportSize, Float2),
+		DX_SHADER_FIELD(TemporalResolveConstantBuffer, textureSizeInverse, Float2),
+		DX_SHADER_FIELD(TemporalResolveConstantBuffer, currentWeight, Float),
+		DX_SHADER_FIELD(TemporalResolveConstantBuffer, padding, Float3));
+
+	static_assert(MatchesShaderPacking(TemporalResolveConstantBufferLayout), "TemporalResolveConstantBuffer doesn't match HLSL packing.");
+
+	// Antialiases the 3D content. The content is drawn into the mode's own targets, the size of
+	// the back buffer, and resolved into the target it would otherwise have been drawn to:
+	//
+	// - Multisample draws with several samples per pixel and resolves them with the hardware's
+	//   box filter.
+	// - Temporal moves the projection by a different sub-pixel offset each frame, from a Halton
+	//   sequence, and blends each frame into a history reprojected through the depth buffer. The
+	//   reprojection follows the camera; objects that move on their own rely on the history
+	//   being clamped to the current frame. It needs feature level 10, to read the depth buffer.
+	//
+	// Both resolve the whole target, so while either is active every repaint covers the whole
+	// screen, and temporal keeps repainting for two jitter cycles after the content last changed,
+	// until the history settles. The reference math is in AntiAliasingFilters.h.
+	class AntiAliasing
+	{
+	public:
+		AntiAliasing(const std::shared_ptr<DeviceResources>& deviceResources, const std::shared_ptr<ShaderLibrary>& shaderLibrary);
+		winrt::fire_and_forget CreateDeviceDependentResourcesAsync();
+		void CreateWindowSizeDependentResources();
+		void ReleaseDeviceDependentResources();
+
+		// Releases the mode's targets, e.g. while the app is suspended. The next Update creates
+		// them again. Call it from the render thread, or while the render loop is stopped.
+		void Trim();
+
+		// Takes effect at the next Update, and may be called from any thread. A mode the device
+		// can't do falls back to no antialiasing, and a sample count it can't do to a lower one.
+		void SetMode(AntiAliasingMode mode, uint32_t sampleCount = 4);
+
+		// Reads back the timings of finished frames, applies a new mode and creates its targets.
+		// Returns true if the targets changed, after which everything must be redrawn.
+		bool Update();
+
+		AntiAliasingMode GetMode() const				{ return m_mode; }
+		uint32_t GetSampleCount() const					{ return m_sampleCount; }
+		bool IsActive() const							{ return m_mode != AntiAliasingMode::None && m_colorTargetView != nullptr; }
+		bool IsAccumulating() const						{ return m_accumulationFrames > 0; }
+		const AntiAliasingCost& GetCost(AntiAliasingMode mode) const	{ return m_costs[static_cast<uint32_t>(mode)]; }
+
+		// Grows any damage to the whole screen while a mode is active.
+		void CollectDamage(DirtyRect const& bounds, DirtyRegion& damage);
+
+		// The clip space offset to add to the projection of the 3D content this frame.
+		JitterOffset GetProjectionJitter(D3D11_VIEWPORT const& viewport) const;
+
+		// Where to draw the 3D content while IsActive.
+		ID3D11RenderTargetView* GetRenderTargetView() const	{ return m_colorTargetView.get(); }
+		ID3D11DepthStencilView* GetDepthStencilView() const	{ return m_depthStencilView.get(); }
+
+		// Bracket the 3D content: BeginScene before its clear, Resolve after it. viewport is the
+		// one the content was drawn with, and viewProjection its projection without the jitter.
+		// Resolve leaves the destination bound as the only render target.
+		void BeginScene(ID3D11DeviceContext3* context);
+		void Resolve(ID3D11DeviceContext3* context, ID3D11RenderTargetView* destination, D3D11_VIEWPORT const& viewport, DirectX::XMFLOAT4X4 const& viewProjection);
+
+	private:
+		// Number of frames in flight before their queries are read back.
+		static const uint32_t FrameLatency = 4;
+
+		// Frames in a cycle of the temporal jitter.
+		static const uint32_t JitterLength = 8;
+
+		// Share of the current frame in each temporal resolve, once there is a history.
+		static constexpr float CurrentWeight = 0.1f;
+
+		struct Frame
+		{
+			winrt::com_ptr<ID3D11Query>		disjoint;
+			winrt::com_ptr<ID3D11Query>		begin;
+			winrt::com_ptr<ID3D11Query>		resolve;
+			winrt::com_ptr<ID3D11Query>		end;
+			AntiAliasingMode				mode;
+		};
+
+		void ReadBackFrames(ID3D11DeviceContext3* context);
+		void CreateTargets();
+		void ReleaseTargets();
+		void ResolveTemporal(ID3D11DeviceContext3* context, ID3D11RenderTargetView* destination, D3D11_VIEWPORT const& viewport, DirectX::XMFLOAT4X4 const& viewProjection);
+
+		std::shared_ptr<DeviceResources>			m_deviceResources;
+		std::shared_ptr<ShaderLibrary>				m_shaderLibrary;
+
+		// The requested mode in the low byte and sample count above it.
+		std::atomic<uint32_t>						m_requestedMode;
+		uint32_t									m_appliedRequest;
+		AntiAliasingMode							m_mode;
+		uint32_t									m_sampleCount;
+		bool										m_targetsDirty;
+		uint32_t									m_width;
+		uint32_t									m_height;
+		uint32_t									m_accumulationFrames;
+		uint64_t									m_frameIndex;
+		AntiAliasingCost							m_costs[AntiAliasingModeCount];
+
+		Frame										m_frames[FrameLatency];
+		uint32_t									m_nextFrame;
+		uint32_t									m_pendingCount;
+		bool										m_inFrame;
+
+		// Targets of the active mode. Temporal's depth buffer can also be read.
+		winrt::com_ptr<ID3D11Texture2D>				m_colorTexture;
+		winrt::com_ptr<ID3D11RenderTargetView>		m_colorTargetView;
+		winrt::com_ptr<ID3D11ShaderResourceView>	m_colorView;
+		winrt::com_ptr<ID3D11DepthStencilView>		m_depthStencilView;
+		winrt::com_ptr<ID3D11ShaderResourceView>	m_depthView;
+
+		// Temporal history, read from one and written to the other in turn.
+		winrt::com_ptr<ID3D11RenderTargetView>		m_historyTargetViews[2];
+		winrt::com_ptr<ID3D11ShaderResourceView>	m_historyViews[2];
+		uint32_t									m_historyIndex;
+		bool										m_historyValid;
+		D3D11_VIEWPORT								m_historyViewport;
+		DirectX::XMFLOAT4X4							m_previousViewProjection;
+
+		winrt::com_ptr<ID3D11VertexShader>			m_fullscreenVertexShader;
+		winrt::com_ptr<ID3D11PixelShader>			m_temporalResolveShader;
+		winrt::com_ptr<ID3D11Buffer>				m_constantBuffer;
+		winrt::com_ptr<ID3D11SamplerState>			m_sampler;
+		bool										m_temporalLoadingComplete;
+	};
+}
@@ -0,0 +1,136 @@
+﻿#pragma once
+
+#include <algorithm>
+#include <cstdint>
+
+namespace DX
+{
+	// The math of the antialiasing modes, with no knowledge of the graphics API. AntiAliasing
+	// and TemporalResolvePixelShader.hlsl do the same on the GPU; these are the reference.
+	// Matrices are row-major and multiply row vectors, as DirectXMath lays them out.
+
+	struct FilterColor
+	{
+		float	r;
+		float	g;
+		float	b;
+		float	a;
+	};
+
+	struct JitterOffset
+	{
+		float	x;
+		float	y;
+	};
+
+	// Element index of the Halton sequence in a base: index's digits in that base, mirrored
+	// around the radix point. Successive elements fill [0, 1) evenly.
+	inline float Halton(uint32_t index, uint32_t base)
+	{
+		float result = 0.0f;
+		float fraction = 1.0f;
+		while (index > 0)
+		{
+			fraction /= base;
+			result += fraction * (index % base);
+			index /= base;
+		}
+		return result;
+	}
+
+	// The sub-pixel offset of a frame, in pixels within [-0.5, 0.5), from the Halton (2, 3)
+	// sequence repeating every length frames. Element 0, the pixel corner, is skipped.
+	inline JitterOffset ComputeJitter(uint64_t frameIndex, uint32_t length)
+	{
+		uint32_t index = static_cast<uint32_t>(frameIndex % length) + 1;
+		return { Halton(index, 2) - 0.5f, Halton(index, 3) - 0.5f };
+	}
+
+	// A pixel offset in a viewport as a clip space offset. Clip space y points up.
+	inline JitterOffset JitterToClip(JitterOffset pixels, float width, float height)
+	{
+		return { pixels.x * 2.0f / width, -pixels.y * 2.0f / height };
+	}
+
+	// Shifts everything a projection matrix draws by a clip space offset. The offset is scaled
+	// by w, so that it is the same after the perspective divide. Apply it to the projection
+	// after any orientation transform, so that it moves the image across the screen.
+	inline void ApplyProjectionJitter(float matrix[16], JitterOffset clip)
+	{
+		for (int row = 0; row < 4; row++)
+		{
+			matrix[row * 4 + 0] += clip.x * matrix[row * 4 + 3];
+			matrix[row * 4 + 1] += clip.y * matrix[row * 4 + 3];
+		}
+	}
+
+	// Finds where a point of the current frame was in the previous frame, in texture
+	// coordinates. reprojection is the inverse of the current view projection times the
+	// previous view projection; depth is the value in the depth buffer. Returns false if the
+	// point was behind the previous camera.
+	inline bool Reproject(const float reprojection[16], float u, float v, float depth, float* previousU, float* previousV)
+	{
+		const float point[4] = { u * 2.0f - 1.0f, 1.0f - v * 2.0f, depth, 1.0f };
+		float clip[4];
+		for (int column = 0; column < 4; column++)
+		{
+			clip[column] = 0.0f;
+			for (int row = 0; row < 4; row++)
+			{
+				clip[column] += point[row] * reprojection[row * 4 + column];
+			}
+		}
+
+		if (clip[3] <= 0.0f)
+		{
+			return false;
+		}
+
+		*previousU = (clip[0] / clip[3] + 1.0f) * 0.5f;
+		*previousV = (1.0f - clip[1] / clip[3]) * 0.5f;
+		return true;
+	}
+
+	// The box filter a multisample resolve applies: the average of a pixel's samples.
+	inline FilterColor ResolveSamples(const FilterColor* samples, uint32_t count)
+	{
+		FilterColor sum = {};
+		for (uint32_t i = 0; i < count; i++)
+		{
+			sum.r += samples[i].r;
+			sum.g += samples[i].g;
+			sum.b += samples[i].b;
+			sum.a += samples[i].a;
+		}
+
+		float scale = 1.0f / count;
+		return { sum.r * scale, sum.g * scale, sum.b * scale, sum.a * scale };
+	}
+
+	// Blends a pixel of the current frame into its reprojected history. The history is first
+	// clamped to the range of the current pixel's 3x3 neighbourhood, which removes most of the
+	// ghosting left where the history shows something that has since moved. neighbourhood[4] is
+	// the pixel itself; currentWeight is 1 where there is no usable history.
+	inline FilterColor TemporalResolve(const FilterColor neighbourhood[9], FilterColor history, float currentWeight)
+	{
+		FilterColor low = neighbourhood[0];
+		FilterColor high = neighbourhood[0];
+		for (int i = 1; i < 9; i++)
+		{
+			low = { (std::min)(low.r, neighbourhood[i].r), (std::min)(low.g, neighbourhood[i].g), (std::min)(low.b, neighbourhood[i].b), (std::min)(low.a, neighbourhood[i].a) };
+			high = { (std::max)(high.r, neighbourhood[i].r), (std::max)(high.g, neighbourhood[i].g), (std::max)(high.b, neighbourhood[i].b), (std::max)(high.a, neighbourhood[i].a) };
+		}
+
+		history.r = (std::min)((std::max)(history.r, low.r), high.r);
+		history.g = (std::min)((std::max)(history.g, low.g), high.g);
+		history.b = (std::min)((std::max)(history.b, low.b), high.b);
+		history.a = (std::min)((std::max)(history.a, low.a), high.a);
+
+		const FilterColor& current = neighbourhood[4];
+		return {
+			history.r + (current.r - history.r) * currentWeight,
+			history.g + (current.g - history.g) * currentWeight,
+			history.b + (current.b - history.b) * currentWeight,
+			history.a + (current.a - history.a) * currentWeight };
+	}
+}
@@ -0,0 +1,619 @@
+﻿#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include "TextureContainer.h"
+
+namespace DX
+{
+	// Encoders for the block-compressed formats, used by the texture importer. Each encodes one
+	// 4x4 block from 16 RGBA8 texels, row by row. They aim for good quality at a speed that suits
+	// an import step rather than an exhaustive search: endpoints lie along the principal axis of
+	// the block's colors and are refined once by least squares.
+	//
+	// BC6H holds HDR data, which the 8-bit inputs the importer reads can't provide, so it has no
+	// encoder.
+	namespace BlockCompression
+	{
+		// Principal axis of count points of dimension TDimension, by power iteration on their
+		// covariance. Writes the mean and a unit axis; a block of one color gets a zero axis.
+		template<int TDimension>
+		void FindPrincipalAxis(const float (*points)[TDimension], int count, float* mean, float* axis)
+		{
+			for (int d = 0; d < TDimension; d++)
+			{
+				mean[d] = 0.0f;
+				for (int i = 0; i < count; i++)
+				{
+					mean[d] += points[i][d];
+				}
+				mean[d] /= count;
+			}
+
+			float covariance[TDimension][TDimension] = {};
+			for (int i = 0; i < count; i++)
+			{
+				for (int a = 0; a < TDimension; a++)
+				{
+					for (int b = 0; b < TDimension; b++)
+					{
+						covariance[a][b] += (points[i][a] - mean[a]) * (points[i][b] - mean[b]);
+					}
+				}
+			}
+
+			// Start from the diagonal of the bounding box, which is usually close already.
+			float minimum[TDimension];
+			float maximum[TDimension];
+			for (int d = 0; d < TDimension; d++)
+			{
+				minimum[d] = maximum[d] = points[0][d];
+				for (int i = 1; i < count; i++)
+				{
+					minimum[d] = (std::min)(minimum[d], points[i][d]);
+					maximum[d] = (std::max)(maximum[d], points[i][d]);
+				}
+				axis[d] = maximum[d] - minimum[d];
+			}
+
+			for (int iteration = 0; iteration < 8; iteration++)
+			{
+				float next[TDimension] = {};
+				for (int a = 0; a < TDimension; a++)
+				{
+					for (int b = 0; b < TDimension; b++)
+					{
+						next[a] += covariance[a][b] * axis[b];
+					}
+				}
+
+				float length = 0.0f;
+				for (int d = 0; d < TDimension; d++)
+				{
+					length += next[d] * next[d];
+				}
+
+				if (length < 1.0e-12f)
+				{
+					break;
+				}
+
+				length = 1.0f / std::sqrt(length);
+				for (int d = 0; d < TDimension; d++)
+				{
+					axis[d] = next[d] * length;
+				}
+			}
+
+			float length = 0.0f;
+			for (int d = 0; d < TDimension; d++)
+			{
+				length += axis[d] * axis[d];
+			}
+			length = (length > 1.0e-12f) ? 1.0f / std::sqrt(length) : 0.0f;
+			for (int d = 0; d < TDimension; d++)
+			{
+				axis[d] *= length;
+			}
+		}
+
+		// Endpoints at the extremes of the points projected on the axis.
+		template<int TDimension>
+		void FindEndpoints(const float (*points)[TDimension], int count, const float* mean, const float* axis, float* low, float* high)
+		{
+			float minimum = 0.0f;
+			float maximum = 0.0f;
+			for (int i = 0; i < count; i++)
+			{
+				float t = 0.0f;
+				for (int d = 0; d < TDimension; d++)
+				{
+					t += (points[i][d] - mean[d]) * axis[d];
+				}
+				minimum = (std::min)(minimum, t);
+				maximum = (std::max)(maximum, t);
+			}
+
+			for (int d = 0; d < TDimension; d++)
+			{
+				low[d] = mean[d] + axis[d] * minimum;
+				high[d] = mean[d] + axis[d] * maximum;
+			}
+		}
+
+		// Least squares endpoints for points already assigned to palette entries, where entry i
+		// is low * (1 - weights[i]) + high * weights[i]. Returns false if the assignment doesn't
+		// determine them, for example when every point uses the same entry.
+		template<int TDimension>
+		bool RefineEndpoints(const float (*points)[TDimension], int count, const uint8_t* indices, const float* weights, float* low, float* high)
+		{
+			float aa = 0.0f;
+			float ab = 0.0f;
+			float bb = 0.0f;
+			float ax[TDimension] = {};
+			float bx[TDimension] = {};
+			for (int i = 0; i < count; i++)
+			{
+				float b = weights[indices[i]];
+				float a = 1.0f - b;
+				aa += a * a;
+				ab += a * b;
+				bb += b * b;
+				for (int d = 0; d < TDimension; d++)
+				{
+					ax[d] += a * points[i][d];
+					bx[d] += b * points[i][d];
+				}
+			}
+
+			float determinant = aa * bb - ab * ab;
+			if (std::fabs(determinant) < 1.0e-6f)
+			{
+				return false;
+			}
+
+			float inverse = 1.0f / determinant;
+			for (int d = 0; d < TDimension; d++)
+			{
+				low[d] = (ax[d] * bb - bx[d] * ab) * inverse;
+				high[d] = (bx[d] * aa - ax[d] * ab) * inverse;
+			}
+			return true;
+		}
+
+		inline int ClampToInt(float value, int minimum, int maximum)
+		{
+			int result = static_cast<int>(value + 0.5f);
+			return result < minimum ? minimum : (result > maximum ? maximum : result);
+		}
+
+		inline uint16_t QuantizeRgb565(const float* color)
+		{
+			int r = ClampToInt(color[0] * (31.0f / 255.0f), 0, 31);
+			int g = ClampToInt(color[1] * (63.0f / 255.0f), 0, 63);
+			int b = ClampToInt(color[2] * (31.0f / 255.0f), 0, 31);
+			return static_cast<uint16_t>((r << 11) | (g << 5) | b);
+		}
+
+		inline void ExpandRgb565(uint16_t packed, float* color)
+		{
+			int r = (packed >> 11) & 31;
+			int g = (packed >> 5) & 63;
+			int b = packed & 31;
+			color[0] = static_cast<float>((r << 3) | (r >> 2));
+			color[1] = static_cast<float>((g << 2) | (g >> 4));
+			color[2] = static_cast<float>((b << 3) | (b >> 2));
+		}
+
+		// Picks the nearest palette entry for each point. Returns the total squared error.
+		template<int TDimension>
+		float AssignIndices(const float (*points)[TDimension], int count, const float (*palette)[TDimension], int paletteSize, uint8_t* indices)
+		{
+			float total = 0.0f;
+			for (int i = 0; i < count; i++)
+			{
+				float best = 1.0e30f;
+				for (int p = 0; p < paletteSize; p++)
+				{
+					float error = 0.0f;
+					for (int d = 0; d < TDimension; d++)
+					{
+						float difference = points[i][d] - palette[p][d];
+						error += difference * difference;
+					}
+
+					if (error < best)
+					{
+						best = error;
+						indices[i] = static_cast<uint8_t>(p);
+					}
+				}
+				total += best;
+			}
+			return total;
+		}
+
+		// The 4-color BC1 palette: the endpoints, then the colors a third and two thirds of the
+		// way between them.
+		inline float EvaluateBC1(const float (*points)[3], uint16_t color0, uint16_t color1, uint8_t* indices)
+		{
+			float palette[4][3];
+			ExpandRgb565(color0, palette[0]);
+			ExpandRgb565(color1, palette[1]);
+			for (int d = 0; d < 3; d++)
+			{
+				palette[2][d] = (2.0f * palette[0][d] + palette[1][d]) / 3.0f;
+				palette[3][d] = (palette[0][d] + 2.0f * palette[1][d]) / 3.0f;
+			}
+			return AssignIndices<3>(points, 16, palette, 4, indices);
+		}
+
+		// Always uses the 4-color mode, so the result is also valid as the color half of BC2 and
+		// BC3, which don't have the 3-color mode. Alpha is ignored.
+		inline void EncodeBC1(const uint8_t* texels, uint8_t* block)
+		{
+			float points[16][3];
+			for (int i = 0; i < 16; i++)
+			{
+				for (int d = 0; d < 3; d++)
+				{
+					points[i][d] = texels[i * 4 + d];
+				}
+			}
+
+			float mean[3];
+			float axis[3];
+			float low[3];
+			float high[3];
+			FindPrincipalAxis<3>(points, 16, mean, axis);
+			FindEndpoints<3>(points, 16, mean, axis, low, high);
+
+			uint16_t color0 = QuantizeRgb565(high);
+			uint16_t color1 = QuantizeRgb565(low);
+			uint8_t indices[16];
+			float error = EvaluateBC1(points, color0, color1, indices);
+
+			static const float weights[4] = { 0.0f, 1.0f, 1.0f / 3.0f, 2.0f / 3.0f };
+			if (error > 0.0f && RefineEndpoints<3>(points, 16, indices, weights, high, low))
+			{
+				uint16_t refined0 = QuantizeRgb565(high);
+				uint16_t refined1 = QuantizeRgb565(low);
+				uint8_t refinedIndices[16];
+				float refinedError = EvaluateBC1(points, refined0, refined1, refinedIndices);
+				if (refinedError < error)
+				{
+					color0 = refined0;
+					color1 = refined1;
+					memcpy(indices, refinedIndices, sizeof(indices));
+				}
+			}
+
+			// The first color must be the larger for the 4-color mode. Swapping the endpoints
+			// swaps entries 0 and 1, and 2 and 3. Equal endpoints select the 3-color mode, where
+			// every texel uses entry 0 anyway.
+			if (color0 < color1)
+			{
+				uint16_t swap = color0;
+				color0 = color1;
+				color1 = swap;
+				for (uint8_t& index : indices)
+				{
+					index ^= 1;
+				}
+			}
+			else if (color0 == color1)
+			{
+				memset(indices, 0, sizeof(indices));
+			}
+
+			uint32_t bits = 0;
+			for (int i = 0; i < 16; i++)
+			{
+				bits |= static_cast<uint32_t>(indices[i]) << (i * 2);
+			}
+
+			block[0] = static_cast<uint8_t>(color0);
+			block[1] = static_cast<uint8_t>(color0 >> 8);
+			block[2] = static_cast<uint8_t>(color1);
+			block[3] = static_cast<uint8_t>(color1 >> 8);
+			for (int i = 0; i < 4; i++)
+			{
+				block[4 + i] = static_cast<uint8_t>(bits >> (i * 8));
+			}
+		}
+
+		// One channel with 8-bit endpoints and eight levels between them.
+		inline void EncodeBC4(const uint8_t* texels, int channel, uint8_t* block)
+		{
+			int minimum = 255;
+			int maximum = 0;
+			for (int i = 0; i < 16; i++)
+			{
+				minimum = (std::min)(minimum, static_cast<int>(texels[i * 4 + channel]));
+				maximum = (std::max)(maximum, static_cast<int>(texels[i * 4 + channel]));
+			}
+
+			// With the first endpoint the larger, entries 2 to 7 step evenly from it to the second.
+			float palette[8];
+			palette[0] = static_cast<float>(maximum);
+			palette[1] = static_cast<float>(minimum);
+			for (int i = 2; i < 8; i++)
+			{
+				palette[i] = ((8 - i) * palette[0] + (i - 1) * palette[1]) / 7.0f;
+			}
+
+			uint64_t bits = 0;
+			for (int i = 0; i < 16; i++)
+			{
+				float value = texels[i * 4 + channel];
+				uint64_t index = 0;
+				float best = 1.0e30f;
+				for (int p = 0; p < 8 && maximum != minimum; p++)
+				{
+					float error = std::fabs(value - palette[p]);
+					if (error < best)
+					{
+						best = error;
+						index = static_cast<uint64_t>(p);
+					}
+				}
+				bits |= index << (i * 3);
+			}
+
+			block[0] = static_cast<uint8_t>(maximum);
+			block[1] = static_cast<uint8_t>(minimum);
+			for (int i = 0; i < 6; i++)
+			{
+				block[2 + i] = static_cast<uint8_t>(bits >> (i * 8));
+			}
+		}
+
+		// Explicit 4-bit alpha, then a BC1 color block.
+		inline void EncodeBC2(const uint8_t* texels, uint8_t* block)
+		{
+			uint64_t bits = 0;
+			for (int i = 0; i < 16; i++)
+			{
+				uint64_t alpha = (texels[i * 4 + 3] * 15u + 127u) / 255u;
+				bits |= alpha << (i * 4);
+			}
+
+			for (int i = 0; i < 8; i++)
+			{
+				block[i] = static_cast<uint8_t>(bits >> (i * 8));
+			}
+			EncodeBC1(texels, block + 8);
+		}
+
+		// BC4 alpha, then a BC1 color block.
+		inline void EncodeBC3(const uint8_t* texels, uint8_t* block)
+		{
+			EncodeBC4(texels, 3, block);
+			EncodeBC1(texels, block + 8);
+		}
+
+		// Red and green as two BC4 blocks, for normal maps and other two-channel data.
+		inline void EncodeBC5(const uint8_t* texels, uint8_t* block)
+		{
+			EncodeBC4(texels, 0, block);
+			EncodeBC4(texels, 1, block + 8);
+		}
+
+		// Writes values into a 128-bit block, least significant bit first.
+		class BlockWriter
+		{
+		public:
+			explicit BlockWriter(uint8_t* block) :
+				m_block(block),
+				m_position(0)
+			{
+				memset(block, 0, 16);
+			}
+
+			void Write(uint32_t value, int bitCount)
+			{
+				for (int i = 0; i < bitCount; i++, m_position++)
+				{
+					m_block[m_position / 8] |= static_cast<uint8_t>(((value >> i) & 1) << (m_position % 8));
+				}
+			}
+
+		private:
+			uint8_t*	m_block;
+			int			m_position;
+		};
+
+		const int BC7Mode6Weights[16] = { 0, 4, 9, 13, 17, 21, 26, 30, 34, 38, 43, 47, 51, 55, 60, 64 };
+
+		// The mode 6 palette for 8-bit endpoints, exactly as the hardware interpolates it. The
+		// palette lies on a line, so each point only needs comparing with the entries either side
+		// of its projection onto that line rather than with all sixteen.
+		inline float EvaluateBC7Mode6(const float (*points)[4], const int* endpoint0, const int* endpoint1, uint8_t* indices)
+		{
+			float palette[16][4];
+			for (int i = 0; i < 16; i++)
+			{
+				for (int d = 0; d < 4; d++)
+				{
+					palette[i][d] = static_cast<float>(((64 - BC7Mode6Weights[i]) * endpoint0[d] + BC7Mode6Weights[i] * endpoint1[d] + 32) >> 6);
+				}
+			}
+
+			float direction[4];
+			float lengthSquared = 0.0f;
+			for (int d = 0; d < 4; d++)
+			{
+				direction[d] = static_cast<float>(endpoint1[d] - endpoint0[d]);
+				lengthSquared += direction[d] * direction[d];
+			}
+			float scale = lengthSquared > 0.0f ? 15.0f / lengthSquared : 0.0f;
+
+			float total = 0.0f;
+			for (int i = 0; i < 16; i++)
+			{
+				float t = 0.0f;
+				for (int d = 0; d < 4; d++)
+				{
+					t += (points[i][d] - endpoint0[d]) * direction[d];
+				}
+				int nearest = ClampToInt(t * scale, 0, 15);
+
+				float best = 1.0e30f;
+				for (int p = (std::max)(nearest - 1, 0); p <= (std::min)(nearest + 1, 15); p++)
+				{
+					float error = 0.0f;
+					for (int d = 0; d < 4; d++)
+					{
+						float difference = points[i][d] - palette[p][d];
+						error += difference * difference;
+					}
+
+					if (error < best)
+					{
+						best = error;
+						indices[i] = static_cast<uint8_t>(p);
+					}
+				}
+				total += best;
+			}
+			return total;
+		}
+
+		// Quantizes endpoints to 7 bits per channel plus a shared low bit, trying both values of
+		// the low bit for each endpoint.
+		inline float QuantizeBC7Mode6(const float (*points)[4], const float* low, const float* high, int* endpoint0, int* endpoint1, uint8_t* indices)
+		{
+			float best = 1.0e30f;
+			for (int bits = 0; bits < 4; bits++)
+			{
+				int pbit0 = bits & 1;
+				int pbit1 = bits >> 1;
+				int candidate0[4];
+				int candidate1[4];
+				for (int d = 0; d < 4; d++)
+				{
+					candidate0[d] = (ClampToInt((low[d] - pbit0) * 0.5f, 0, 127) << 1) | pbit0;
+					candidate1[d] = (ClampToInt((high[d] - pbit1) * 0.5f, 0, 127) << 1) | pbit1;
+				}
+
+				uint8_t candidateIndices[16];
+				float error = EvaluateBC7Mode6(points, candidate0, candidate1, candidateIndices);
+				if (bits == 0 || error < best)
+				{
+					best = error;
+					memcpy(endpoint0, candidate0, sizeof(candidate0));
+					memcpy(endpoint1, candidate1, sizeof(candidate1));
+					memcpy(indices, candidateIndices, sizeof(candidateIndices));
+				}
+			}
+			return best;
+		}
+
+		// Mode 6 only: one subset, RGBA endpoints and 4-bit indices. It handles color and alpha
+		// together well and is the mode most blocks of typical content would pick anyway.
+		inline void EncodeBC7(const uint8_t* texels, uint8_t* block)
+		{
+			float points[16][4];
+			for (int i = 0; i < 16; i++)
+			{
+				for (int d = 0; d < 4; d++)
+				{
+					points[i][d] = texels[i * 4 + d];
+				}
+			}
+
+			float mean[4];
+			float axis[4];
+			float low[4];
+			float high[4];
+			FindPrincipalAxis<4>(points, 16, mean, axis);
+			FindEndpoints<4>(points, 16, mean, axis, low, high);
+
+			int endpoint0[4];
+			int endpoint1[4];
+			uint8_t indices[16];
+			float error = QuantizeBC7Mode6(points, low, high, endpoint0, endpoint1, indices);
+
+			float weights[16];
+			for (int i = 0; i < 16; i++)
+			{
+				weights[i] = BC7Mode6Weights[i] / 64.0f;
+			}
+
+			if (error > 0.0f && RefineEndpoints<4>(points, 16, indices, weights, low, high))
+			{
+				int refined0[4];
+				int refined1[4];
+				uint8_t refinedIndices[16];
+				if (QuantizeBC7Mode6(points, low, high, refined0, refined1, refinedIndices) < error)
+				{
+					memcpy(endpoint0, refined0, sizeof(refined0));
+					memcpy(endpoint1, refined1, sizeof(refined1));
+					memcpy(indices, refinedIndices, sizeof(refinedIndices));
+				}
+			}
+
+			// The first index is stored without its top bit, which must therefore be zero.
+			// Swapping the endpoints reverses the palette.
+			if (indices[0] >= 8)
+			{
+				for (int d = 0; d < 4; d++)
+				{
+					int swap = endpoint0[d];
+					endpoint0[d] = endpoint1[d];
+					endpoint1[d] = swap;
+				}
+				for (uint8_t& index : indices)
+				{
+					index = static_cast<uint8_t>(15 - index);
+				}
+			}
+
+			BlockWriter writer(block);
+			writer.Write(1u << 6, 7);
+			for (int d = 0; d < 4; d++)
+			{
+				writer.Write(static_cast<uint32_t>(endpoint0[d] >> 1), 7);
+				writer.Write(static_cast<uint32_t>(endpoint1[d] >> 1), 7);
+			}
+			writer.Write(static_cast<uint32_t>(endpoint0[0] & 1), 1);
+			writer.Write(static_cast<uint32_t>(endpoint1[0] & 1), 1);
+			writer.Write(indices[0], 3);
+			for (int i = 1; i < 16; i++)
+			{
+				writer.Write(indices[i], 4);
+			}
+		}
+
+		// Encodes one block. Returns false for a format without an encoder.
+		inline bool EncodeBlock(BlockFormat format, const uint8_t* texels, uint8_t* block)
+		{
+			switch (format)
+			{
+			case BlockFormat::BC1:	EncodeBC1(texels, block); return true;
+			case BlockFormat::BC2:	EncodeBC2(texels, block); return true;
+			case BlockFormat::BC3:	EncodeBC3(texels, block); return true;
+			case BlockFormat::BC4:	EncodeBC4(texels, 0, block); return true;
+			case BlockFormat::BC5:	EncodeBC5(texels, block); return true;
+			case BlockFormat::BC7:	EncodeBC7(texels, block); return true;
+			default:				return false;
+			}
+		}
+
+		// Encodes rows of blocks [firstRow, lastRow) of an RGBA8 image into destination, which
+		// holds the whole mip laid out as GetMipLayout describes. Blocks that overhang the edge
+		// of a small mip repeat its last row and column. Rows can be encoded by several threads
+		// at once.
+		inline bool EncodeBlockRows(BlockFormat format, const uint8_t* image, uint32_t width, uint32_t height, uint32_t firstRow, uint32_t lastRow, uint8_t* destination)
+		{
+			uint32_t blockSize = GetBlockSize(format);
+			uint32_t blocksAcross = (width + 3) / 4;
+			uint8_t texels[64];
+
+			for (uint32_t row = firstRow; row < lastRow; row++)
+			{
+				for (uint32_t column = 0; column < blocksAcross; column++)
+				{
+					for (uint32_t y = 0; y < 4; y++)
+					{
+						uint32_t sourceY = (std::min)(row * 4 + y, height - 1);
+						for (uint32_t x = 0; x < 4; x++)
+						{
+							uint32_t sourceX = (std::min)(column * 4 + x, width - 1);
+							memcpy(texels + (y * 4 + x) * 4, image + (size_t(sourceY) * width + sourceX) * 4, 4);
+						}
+					}
+
+					if (!EncodeBlock(format, texels, destination + (size_t(row) * blocksAcross + column) * blockSize))
+					{
+						return false;
+					}
+				}
+			}
+			return true;
+		}
+	}
+}
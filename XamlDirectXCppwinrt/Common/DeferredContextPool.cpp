@@ -0,0 +1,91 @@
+﻿#include "pch.h"
+#include "DeferredContextPool.h"
+#include "Profiler.h"
+
+#include <thread>
+
+DX::DeferredContextPool::DeferredContextPool() :
+	m_outputState()
+{
+}
+
+// Creates one deferred context per hardware thread, up to the recorder's limit.
+void DX::DeferredContextPool::CreateDeviceDependentResources(ID3D11Device3* device, ID3D11DeviceContext3* immediateContext)
+{
+	m_immediateContext.copy_from(immediateContext);
+
+	size_t workerCount = (std::min)(
+		static_cast<size_t>((std::max)(std::thread::hardware_concurrency(), 1u)),
+		ParallelCommandRecorder<DeferredContextPool>::MaxWorkers);
+
+	m_workerContexts.resize(workerCount);
+	for (auto& workerContext : m_workerContexts)
+	{
+		winrt::check_hresult(device->CreateDeferredContext3(0, workerContext.put()));
+	}
+}
+
+void DX::DeferredContextPool::ReleaseDeviceDependentResources()
+{
+	m_outputState = OutputState();
+	m_workerContexts.clear();
+	m_immediateContext = nullptr;
+}
+
+// Captures the immediate context's output state. Contexts aren't thread safe, so this has to
+// happen on the submitting thread before any worker starts.
+void DX::DeferredContextPool::BeginParallelRecording()
+{
+	ID3D11RenderTargetView* renderTargetViews[D3D11_SIMULTANEOUS_RENDER_TARGET_COUNT] = {};
+	ID3D11DepthStencilView* depthStencilView = nullptr;
+	m_immediateContext->OMGetRenderTargets(D3D11_SIMULTANEOUS_RENDER_TARGET_COUNT, renderTargetViews, &depthStencilView);
+	for (UINT i = 0; i < D3D11_SIMULTANEOUS_RENDER_TARGET_COUNT; i++)
+	{
+		m_outputState.renderTargetViews[i].attach(renderTargetViews[i]);
+	}
+	m_outputState.depthStencilView.attach(depthStencilView);
+
+	m_immediateContext->RSGetState(m_outputState.rasterizerState.put());
+
+	m_outputState.viewportCount = D3D11_VIEWPORT_AND_SCISSORRECT_OBJECT_COUNT_PER_PIPELINE;
+	m_immediateContext->RSGetViewports(&m_outputState.viewportCount, m_outputState.viewports);
+
+	m_outputState.scissorRectCount = D3D11_VIEWPORT_AND_SCISSORRECT_OBJECT_COUNT_PER_PIPELINE;
+	m_immediateContext->RSGetScissorRects(&m_outputState.scissorRectCount, m_outputState.scissorRects);
+}
+
+// Drops the captured references, so that the swap chain can be resized.
+void DX::DeferredContextPool::EndParallelRecording()
+{
+	m_outputState = OutputState();
+}
+
+void DX::DeferredContextPool::BeginRecording(ID3D11DeviceContext3& context)
+{
+	ID3D11RenderTargetView* renderTargetViews[D3D11_SIMULTANEOUS_RENDER_TARGET_COUNT];
+	for (UINT i = 0; i < D3D11_SIMULTANEOUS_RENDER_TARGET_COUNT; i++)
+	{
+		renderTargetViews[i] = m_outputState.renderTargetViews[i].get();
+	}
+
+	context.OMSetRenderTargets(D3D11_SIMULTANEOUS_RENDER_TARGET_COUNT, renderTargetViews, m_outputState.depthStencilView.get());
+	context.RSSetState(m_outputState.rasterizerState.get());
+	context.RSSetViewports(m_outputState.viewportCount, m_outputState.viewports);
+	context.RSSetScissorRects(m_outputState.scissorRectCount, m_outputState.scissorRects);
+}
+
+DX::DeferredContextPool::CommandList DX::DeferredContextPool::FinishRecording(ID3D11DeviceContext3& context)
+{
+	DX_PROFILE_SCOPE("DeferredContextPool::FinishRecording");
+
+	// Clearing the state leaves the context ready for the next frame.
+	CommandList commandList;
+	winrt::check_hresult(context.FinishCommandList(FALSE, commandList.put()));
+	return commandList;
+}
+
+void DX::DeferredContextPool::Execute(CommandList& commandList)
+{
+	// Restore the immediate context's state afterwards, so callers can keep using it as before.
+	m_immediateContext->ExecuteCommandList(commandList.get(), TRUE);
+}
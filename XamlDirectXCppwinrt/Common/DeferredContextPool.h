@@ -0,0 +1,54 @@
+﻿#pragma once
+
+#include <ppl.h>
+#include "ParallelCommandRecorder.h"
+
+namespace DX
+{
+	// Direct3D 11 backend for ParallelCommandRecorder. Owns one deferred context per worker and
+	// replays the resulting command lists on the immediate context.
+	class DeferredContextPool
+	{
+	public:
+		using Context = ID3D11DeviceContext3;
+		using CommandList = winrt::com_ptr<ID3D11CommandList>;
+
+		DeferredContextPool();
+		void CreateDeviceDependentResources(ID3D11Device3* device, ID3D11DeviceContext3* immediateContext);
+		void ReleaseDeviceDependentResources();
+
+		size_t GetWorkerCount() const							{ return m_workerContexts.size(); }
+		ID3D11DeviceContext3& GetImmediateContext()				{ return *m_immediateContext.get(); }
+		ID3D11DeviceContext3& GetWorkerContext(size_t worker)	{ return *m_workerContexts[worker].get(); }
+
+		void BeginParallelRecording();
+		void EndParallelRecording();
+		void BeginRecording(ID3D11DeviceContext3& context);
+		CommandList FinishRecording(ID3D11DeviceContext3& context);
+		void Execute(CommandList& commandList);
+
+		template<typename TFunc>
+		void ParallelFor(size_t count, const TFunc& func)
+		{
+			concurrency::parallel_for(size_t(0), count, [&](size_t worker) { func(worker); });
+		}
+
+	private:
+		// Output state of the immediate context, copied to each worker context so that workers
+		// draw into the same targets with the same viewport and scissor as the calling renderer.
+		struct OutputState
+		{
+			winrt::com_ptr<ID3D11RenderTargetView>	renderTargetViews[D3D11_SIMULTANEOUS_RENDER_TARGET_COUNT];
+			winrt::com_ptr<ID3D11DepthStencilView>	depthStencilView;
+			winrt::com_ptr<ID3D11RasterizerState>	rasterizerState;
+			D3D11_VIEWPORT							viewports[D3D11_VIEWPORT_AND_SCISSORRECT_OBJECT_COUNT_PER_PIPELINE];
+			UINT									viewportCount;
+			D3D11_RECT								scissorRects[D3D11_VIEWPORT_AND_SCISSORRECT_OBJECT_COUNT_PER_PIPELINE];
+			UINT									scissorRectCount;
+		};
+
+		winrt::com_ptr<ID3D11DeviceContext3>				m_immediateContext;
+		std::vector<winrt::com_ptr<ID3D11DeviceContext3>>	m_workerContexts;
+		OutputState											m_outputState;
+	};
+}
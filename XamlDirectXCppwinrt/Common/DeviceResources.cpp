@@ -1,6 +1,7 @@
 ﻿#include "pch.h"
 #include "DeviceResources.h"
 #include "DirectXHelper.h"
+#include "Profiler.h"
 #include <windows.ui.xaml.media.dxinterop.h>
 
 using namespace winrt;
@@ -11,81 +12,40 @@ using namespace winrt::Windows::Graphics::Display;
 using namespace winrt::Windows::UI::Core;
 using namespace winrt::Windows::UI::Xaml::Controls;
 
-namespace DisplayMetrics
-{
-	// High resolution displays can require a lot of GPU and battery power to render.
-	// High resolution phones, for example, may suffer from poor battery life if
-	// games attempt to render at 60 frames per second at full fidelity.
-	// The decision to render at full fidelity across all platforms and form factors
-	// should be deliberate.
-	static const bool SupportHighResolutions = false;
-
-	// The default thresholds that define a "high resolution" display. If the thresholds
-	// are exceeded and SupportHighResolutions is false, the dimensions will be scaled
-	// by 50%.
-	static const float DpiThreshold = 192.0f;		// 200% of standard desktop display.
-	static const float WidthThreshold = 1920.0f;	// 1080p width.
-	static const float HeightThreshold = 1080.0f;	// 1080p height.
-};
-
-// Constants used to calculate screen rotations.
-namespace ScreenRotation
-{
-	// 0-degree Z-rotation
-	static const XMFLOAT4X4 Rotation0( 
-		1.0f, 0.0f, 0.0f, 0.0f,
-		0.0f, 1.0f, 0.0f, 0.0f,
-		0.0f, 0.0f, 1.0f, 0.0f,
-		0.0f, 0.0f, 0.0f, 1.0f
-		);
-
-	// 90-degree Z-rotation
-	static const XMFLOAT4X4 Rotation90(
-		0.0f, 1.0f, 0.0f, 0.0f,
-		-1.0f, 0.0f, 0.0f, 0.0f,
-		0.0f, 0.0f, 1.0f, 0.0f,
-		0.0f, 0.0f, 0.0f, 1.0f
-		);
-
-	// 180-degree Z-rotation
-	static const XMFLOAT4X4 Rotation180(
-		-1.0f, 0.0f, 0.0f, 0.0f,
-		0.0f, -1.0f, 0.0f, 0.0f,
-		0.0f, 0.0f, 1.0f, 0.0f,
-		0.0f, 0.0f, 0.0f, 1.0f
-		);
-
-	// 270-degree Z-rotation
-	static const XMFLOAT4X4 Rotation270( 
-		0.0f, -1.0f, 0.0f, 0.0f,
-		1.0f, 0.0f, 0.0f, 0.0f,
-		0.0f, 0.0f, 1.0f, 0.0f,
-		0.0f, 0.0f, 0.0f, 1.0f
-		);
-};
-
 // Constructor for DeviceResources.
 DX::DeviceResources::DeviceResources() : 
 	m_screenViewport(),
 	m_d3dFeatureLevel(D3D_FEATURE_LEVEL_9_1),
-	m_d3dRenderTargetSize(),
-	m_outputSize(),
-	m_logicalSize(),
-	m_nativeOrientation(DisplayOrientations::None),
-	m_currentOrientation(DisplayOrientations::None),
-	m_dpi(-1.0f),
-	m_effectiveDpi(-1.0f),
-	m_compositionScaleX(1.0f),
-	m_compositionScaleY(1.0f),
-	m_deviceNotify(nullptr)
+	m_occluded(false),
+	m_displayState{ 0.0f, 0.0f, -1.0f, 1.0f, 1.0f, DX::DisplayOrientation::None, DX::DisplayOrientation::None },
+	m_displayMetrics(DX::ComputeDisplayMetrics(m_displayState)),
+	m_deviceNotify(nullptr),
+	m_creationStage(0)
 {
 	CreateDeviceIndependentResources();
 	CreateDeviceResources();
 }
 
+// Creating the Direct3D device mostly waits for the driver, so the Direct2D factory is created
+// meanwhile on another thread.
+DX::DeviceResources::DeviceResources(StartupGraph& startup) :
+	m_screenViewport(),
+	m_d3dFeatureLevel(D3D_FEATURE_LEVEL_9_1),
+	m_occluded(false),
+	m_displayState{ 0.0f, 0.0f, -1.0f, 1.0f, 1.0f, DX::DisplayOrientation::None, DX::DisplayOrientation::None },
+	m_displayMetrics(DX::ComputeDisplayMetrics(m_displayState)),
+	m_deviceNotify(nullptr)
+{
+	auto factory = startup.AddStage("Direct2D factory", {}, StartupThread::Any, [this] { CreateDeviceIndependentResources(); });
+	auto device = startup.AddStage("Direct3D device", {}, StartupThread::Any, [this] { CreateDirect3DDevice(); });
+	m_creationStage = startup.AddStage("Direct2D device", { factory, device }, StartupThread::Any, [this] { CreateDirect2DDevice(); });
+}
+
 // Configures resources that don't depend on the Direct3D device.
 void DX::DeviceResources::CreateDeviceIndependentResources()
 {
+	DX_PROFILE_SCOPE("DeviceResources::CreateDeviceIndependentResources");
+
 	// Initialize Direct2D resources.
 	D2D1_FACTORY_OPTIONS options;
 	ZeroMemory(&options, sizeof(D2D1_FACTORY_OPTIONS));
@@ -105,28 +65,57 @@ void DX::DeviceResources::CreateDeviceIndependentResources()
 			)
 		);
 
-	// Initialize the DirectWrite Factory.
-	winrt::check_hresult(
-		DWriteCreateFactory(
-			DWRITE_FACTORY_TYPE_SHARED,
-			__uuidof(IDWriteFactory3),
-			(::IUnknown**)m_dwriteFactory.put_void()
-			)
-		);
+}
 
-	// Initialize the Windows Imaging Component (WIC) Factory.
-	winrt::check_hresult(
-		CoCreateInstance(
-			CLSID_WICImagingFactory2,
-			nullptr,
-			CLSCTX_INPROC_SERVER,
-			__uuidof(IWICImagingFactory),
-			m_wicFactory.put_void()));
+IDWriteFactory3* DX::DeviceResources::GetDWriteFactory() const
+{
+	std::call_once(m_dwriteFactoryCreated, [this]
+	{
+		DX_PROFILE_SCOPE("DeviceResources::CreateDWriteFactory");
+
+		// Initialize the DirectWrite Factory.
+		winrt::check_hresult(
+			DWriteCreateFactory(
+				DWRITE_FACTORY_TYPE_SHARED,
+				__uuidof(IDWriteFactory3),
+				(::IUnknown**)m_dwriteFactory.put_void()
+				)
+			);
+	});
+	return m_dwriteFactory.get();
+}
+
+IWICImagingFactory2* DX::DeviceResources::GetWicImagingFactory() const
+{
+	std::call_once(m_wicFactoryCreated, [this]
+	{
+		DX_PROFILE_SCOPE("DeviceResources::CreateWicImagingFactory");
+
+		// Initialize the Windows Imaging Component (WIC) Factory.
+		winrt::check_hresult(
+			CoCreateInstance(
+				CLSID_WICImagingFactory2,
+				nullptr,
+				CLSCTX_INPROC_SERVER,
+				__uuidof(IWICImagingFactory),
+				m_wicFactory.put_void()));
+	});
+	return m_wicFactory.get();
 }
 
 // Configures the Direct3D device, and stores handles to it and the device context.
 void DX::DeviceResources::CreateDeviceResources() 
 {
+	DX_PROFILE_SCOPE("DeviceResources::CreateDeviceResources");
+
+	CreateDirect3DDevice();
+	CreateDirect2DDevice();
+}
+
+void DX::DeviceResources::CreateDirect3DDevice()
+{
+	DX_PROFILE_SCOPE("DeviceResources::CreateDirect3DDevice");
+
 	// This flag adds support for surfaces with a different color channel ordering
 	// than the API default. It is required for compatibility with Direct2D.
 	UINT creationFlags = D3D11_CREATE_DEVICE_BGRA_SUPPORT;
@@ -197,6 +186,12 @@ void DX::DeviceResources::CreateDeviceResources()
 	// Store pointers to the Direct3D 11.3 API device and immediate context.
 	m_d3dDevice = device.as<ID3D11Device3>();
 	m_d3dContext = context.as<ID3D11DeviceContext3>();
+}
+
+// Needs the Direct2D factory and the Direct3D device.
+void DX::DeviceResources::CreateDirect2DDevice()
+{
+	DX_PROFILE_SCOPE("DeviceResources::CreateDirect2DDevice");
 
 	// Create the Direct2D device object and a corresponding context.
 	auto dxgiDevice = m_d3dDevice.as<IDXGIDevice3>();
@@ -216,6 +211,8 @@ void DX::DeviceResources::CreateDeviceResources()
 // These resources need to be recreated every time the window size is changed.
 void DX::DeviceResources::CreateWindowSizeDependentResources() 
 {
+	DX_PROFILE_SCOPE("DeviceResources::CreateWindowSizeDependentResources");
+
 	// Clear the previous window size specific context.
 	ID3D11RenderTargetView* nullViews[] = {nullptr};
 	m_d3dContext->OMSetRenderTargets(ARRAYSIZE(nullViews), nullViews, nullptr);
@@ -225,24 +222,18 @@ void DX::DeviceResources::CreateWindowSizeDependentResources()
 	m_d3dDepthStencilView = nullptr;
 	m_d3dContext->Flush1(D3D11_CONTEXT_TYPE_ALL, nullptr);
 
-	UpdateRenderTargetSize();
-
-	// The width and height of the swap chain must be based on the window's
-	// natively-oriented width and height. If the window is not in the native
-	// orientation, the dimensions must be reversed.
-	DXGI_MODE_ROTATION displayRotation = ComputeDisplayRotation();
-
-	bool swapDimensions = displayRotation == DXGI_MODE_ROTATION_ROTATE90 || displayRotation == DXGI_MODE_ROTATION_ROTATE270;
-	m_d3dRenderTargetSize.Width = swapDimensions ? m_outputSize.Height : m_outputSize.Width;
-	m_d3dRenderTargetSize.Height = swapDimensions ? m_outputSize.Width : m_outputSize.Height;
+	// The swap chain's buffers are laid out in the display's native orientation, so the
+	// dimensions are reversed when the window isn't in it.
+	UINT renderTargetWidth = static_cast<UINT>(m_displayMetrics.renderTargetWidth);
+	UINT renderTargetHeight = static_cast<UINT>(m_displayMetrics.renderTargetHeight);
 
 	if (m_swapChain != nullptr)
 	{
 		// If the swap chain already exists, resize it.
 		HRESULT hr = m_swapChain->ResizeBuffers(
 			2, // Double-buffered swap chain.
-			lround(m_d3dRenderTargetSize.Width),
-			lround(m_d3dRenderTargetSize.Height),
+			renderTargetWidth,
+			renderTargetHeight,
 			DXGI_FORMAT_B8G8R8A8_UNORM,
 			0
 			);
@@ -264,11 +255,11 @@ void DX::DeviceResources::CreateWindowSizeDependentResources()
 	else
 	{
 		// Otherwise, create a new one using the same adapter as the existing Direct3D device.
-		DXGI_SCALING scaling = DisplayMetrics::SupportHighResolutions ? DXGI_SCALING_NONE : DXGI_SCALING_STRETCH;
+		DXGI_SCALING scaling = DisplayScaling::SupportHighResolutions ? DXGI_SCALING_NONE : DXGI_SCALING_STRETCH;
 		DXGI_SWAP_CHAIN_DESC1 swapChainDesc = {0};
 
-		swapChainDesc.Width = lround(m_d3dRenderTargetSize.Width);		// Match the size of the window.
-		swapChainDesc.Height = lround(m_d3dRenderTargetSize.Height);
+		swapChainDesc.Width = renderTargetWidth;						// Match the size of the window.
+		swapChainDesc.Height = renderTargetHeight;
 		swapChainDesc.Format = DXGI_FORMAT_B8G8R8A8_UNORM;				// This is the most common swap chain format.
 		swapChainDesc.Stereo = false;
 		swapChainDesc.SampleDesc.Count = 1;								// Don't use multi-sampling.
@@ -324,57 +315,9 @@ void DX::DeviceResources::CreateWindowSizeDependentResources()
 			);
 	}
 
-	// Set the proper orientation for the swap chain, and generate 2D and
-	// 3D matrix transformations for rendering to the rotated swap chain.
-	// Note the rotation angle for the 2D and 3D transforms are different.
-	// This is due to the difference in coordinate spaces.  Additionally,
-	// the 3D matrix is specified explicitly to avoid rounding errors.
-
-	switch (displayRotation)
-	{
-	case DXGI_MODE_ROTATION_IDENTITY:
-		m_orientationTransform2D = Matrix3x2F::Identity();
-		m_orientationTransform3D = ScreenRotation::Rotation0;
-		break;
-
-	case DXGI_MODE_ROTATION_ROTATE90:
-		m_orientationTransform2D = 
-			Matrix3x2F::Rotation(90.0f) *
-			Matrix3x2F::Translation(m_logicalSize.Height, 0.0f);
-		m_orientationTransform3D = ScreenRotation::Rotation270;
-		break;
-
-	case DXGI_MODE_ROTATION_ROTATE180:
-		m_orientationTransform2D = 
-			Matrix3x2F::Rotation(180.0f) *
-			Matrix3x2F::Translation(m_logicalSize.Width, m_logicalSize.Height);
-		m_orientationTransform3D = ScreenRotation::Rotation180;
-		break;
-
-	case DXGI_MODE_ROTATION_ROTATE270:
-		m_orientationTransform2D = 
-			Matrix3x2F::Rotation(270.0f) *
-			Matrix3x2F::Translation(0.0f, m_logicalSize.Width);
-		m_orientationTransform3D = ScreenRotation::Rotation90;
-		break;
-
-	default:
-		throw winrt::hresult_not_implemented();
-	}
-
-	winrt::check_hresult(
-		m_swapChain->SetRotation(displayRotation)
-		);
-
-	// Setup inverse scale on the swap chain
-	DXGI_MATRIX_3X2_F inverseScale = { 0 };
-	inverseScale._11 = 1.0f / m_effectiveCompositionScaleX;
-	inverseScale._22 = 1.0f / m_effectiveCompositionScaleY;
-	auto spSwapChain2 = m_swapChain.as<IDXGISwapChain2>();
-
-	winrt::check_hresult(
-		spSwapChain2->SetMatrixTransform(&inverseScale)
-		);
+	// Set the proper orientation and scale for the swap chain. The 2D and 3D transforms for
+	// rendering to the rotated swap chain are part of the display metrics.
+	UpdateSwapChainTransform();
 
 	// Create a render target view of the swap chain back buffer.
 	com_ptr<ID3D11Texture2D1> backBuffer;
@@ -393,8 +336,8 @@ void DX::DeviceResources::CreateWindowSizeDependentResources()
 	// Create a depth stencil view for use with 3D rendering if needed.
 	CD3D11_TEXTURE2D_DESC1 depthStencilDesc(
 		DXGI_FORMAT_D24_UNORM_S8_UINT, 
-		lround(m_d3dRenderTargetSize.Width),
-		lround(m_d3dRenderTargetSize.Height),
+		renderTargetWidth,
+		renderTargetHeight,
 		1, // This depth stencil view has only one texture.
 		1, // Use a single mipmap level.
 		D3D11_BIND_DEPTH_STENCIL
@@ -422,8 +365,8 @@ void DX::DeviceResources::CreateWindowSizeDependentResources()
 	m_screenViewport = CD3D11_VIEWPORT(
 		0.0f,
 		0.0f,
-		m_d3dRenderTargetSize.Width,
-		m_d3dRenderTargetSize.Height
+		m_displayMetrics.renderTargetWidth,
+		m_displayMetrics.renderTargetHeight
 		);
 
 	m_d3dContext->RSSetViewports(1, &m_screenViewport);
@@ -434,8 +377,8 @@ void DX::DeviceResources::CreateWindowSizeDependentResources()
 		D2D1::BitmapProperties1(
 			D2D1_BITMAP_OPTIONS_TARGET | D2D1_BITMAP_OPTIONS_CANNOT_DRAW,
 			D2D1::PixelFormat(DXGI_FORMAT_B8G8R8A8_UNORM, D2D1_ALPHA_MODE_PREMULTIPLIED),
-			m_dpi,
-			m_dpi
+			m_displayState.dpi,
+			m_displayState.dpi
 			);
 
 	com_ptr<IDXGISurface2> dxgiBackBuffer;
@@ -452,45 +395,63 @@ void DX::DeviceResources::CreateWindowSizeDependentResources()
 		);
 
 	m_d2dContext->SetTarget(m_d2dTargetBitmap.get());
-	m_d2dContext->SetDpi(m_effectiveDpi, m_effectiveDpi);
+	m_d2dContext->SetDpi(m_displayMetrics.effectiveDpi, m_displayMetrics.effectiveDpi);
 
 	// Grayscale text anti-aliasing is recommended for all Microsoft Store apps.
 	m_d2dContext->SetTextAntialiasMode(D2D1_TEXT_ANTIALIAS_MODE_GRAYSCALE);
 }
 
-// Determine the dimensions of the render target and whether it will be scaled down.
-void DX::DeviceResources::UpdateRenderTargetSize()
+// Rotates the swap chain from the display's native orientation to its current one, and undoes
+// the composition scale, which the render target already includes.
+void DX::DeviceResources::UpdateSwapChainTransform()
 {
-	m_effectiveDpi = m_dpi;
-	m_effectiveCompositionScaleX = m_compositionScaleX;
-	m_effectiveCompositionScaleY = m_compositionScaleY;
-
-	// To improve battery life on high resolution devices, render to a smaller render target
-	// and allow the GPU to scale the output when it is presented.
-	if (!DisplayMetrics::SupportHighResolutions && m_dpi > DisplayMetrics::DpiThreshold)
+	DXGI_MODE_ROTATION displayRotation = static_cast<DXGI_MODE_ROTATION>(m_displayMetrics.rotation);
+	if (displayRotation == DXGI_MODE_ROTATION_UNSPECIFIED)
 	{
-		float width = DX::ConvertDipsToPixels(m_logicalSize.Width, m_dpi);
-		float height = DX::ConvertDipsToPixels(m_logicalSize.Height, m_dpi);
+		throw winrt::hresult_not_implemented();
+	}
 
-		// When the device is in portrait orientation, height > width. Compare the
-		// larger dimension against the width threshold and the smaller dimension
-		// against the height threshold.
-		if (max(width, height) > DisplayMetrics::WidthThreshold && min(width, height) > DisplayMetrics::HeightThreshold)
-		{
-			// To scale the app we change the effective DPI. Logical size does not change.
-			m_effectiveDpi /= 2.0f;
-			m_effectiveCompositionScaleX /= 2.0f;
-			m_effectiveCompositionScaleY /= 2.0f;
-		}
+	winrt::check_hresult(
+		m_swapChain->SetRotation(displayRotation)
+		);
+
+	// Setup inverse scale on the swap chain
+	DXGI_MATRIX_3X2_F inverseScale = { 0 };
+	inverseScale._11 = 1.0f / m_displayMetrics.effectiveCompositionScaleX;
+	inverseScale._22 = 1.0f / m_displayMetrics.effectiveCompositionScaleY;
+	auto spSwapChain2 = m_swapChain.as<IDXGISwapChain2>();
+
+	winrt::check_hresult(
+		spSwapChain2->SetMatrixTransform(&inverseScale)
+		);
+}
+
+// Moves to a new display state. Everything that depends on the size of the swap chain is
+// created again only when the size changes; a new rotation or scale only updates the swap
+// chain's transform and the Direct2D DPI.
+DX::DisplayChange DX::DeviceResources::SetDisplayState(const DisplayState& state)
+{
+	if (state == m_displayState)
+	{
+		return DisplayChange::None;
 	}
 
-	// Calculate the necessary render target size in pixels.
-	m_outputSize.Width = DX::ConvertDipsToPixels(m_logicalSize.Width, m_effectiveDpi);
-	m_outputSize.Height = DX::ConvertDipsToPixels(m_logicalSize.Height, m_effectiveDpi);
+	DisplayMetrics metrics = m_displayMetricsCache.Get(state);
+	DisplayChange change = CompareDisplayMetrics(m_displayMetrics, metrics);
+	m_displayState = state;
+	m_displayMetrics = metrics;
 
-	// Prevent zero size DirectX content from being created.
-	m_outputSize.Width = max(m_outputSize.Width, 1);
-	m_outputSize.Height = max(m_outputSize.Height, 1);
+	if (change == DisplayChange::Resize || m_swapChain == nullptr)
+	{
+		CreateWindowSizeDependentResources();
+	}
+	else if (change == DisplayChange::Transform)
+	{
+		UpdateSwapChainTransform();
+		m_d2dContext->SetDpi(m_displayMetrics.effectiveDpi, m_displayMetrics.effectiveDpi);
+	}
+
+	return change;
 }
 
 // This method is called when the XAML control is created (or re-created).
@@ -499,13 +460,15 @@ void DX::DeviceResources::SetSwapChainPanel(SwapChainPanel const& panel)
 	auto currentDisplayInformation = DisplayInformation::GetForCurrentView();
 
 	m_swapChainPanel = panel;
-	m_logicalSize = winrt::Windows::Foundation::Size(static_cast<float>(panel.ActualWidth()), static_cast<float>(panel.ActualHeight()));
-	m_nativeOrientation = currentDisplayInformation.NativeOrientation();
-	m_currentOrientation = currentDisplayInformation.CurrentOrientation();
-	m_compositionScaleX = panel.CompositionScaleX();
-	m_compositionScaleY = panel.CompositionScaleY();
-	m_dpi = currentDisplayInformation.LogicalDpi();
-	m_d2dContext->SetDpi(m_dpi, m_dpi);
+	m_displayState.logicalWidth = static_cast<float>(panel.ActualWidth());
+	m_displayState.logicalHeight = static_cast<float>(panel.ActualHeight());
+	m_displayState.nativeOrientation = static_cast<DX::DisplayOrientation>(currentDisplayInformation.NativeOrientation());
+	m_displayState.currentOrientation = static_cast<DX::DisplayOrientation>(currentDisplayInformation.CurrentOrientation());
+	m_displayState.compositionScaleX = panel.CompositionScaleX();
+	m_displayState.compositionScaleY = panel.CompositionScaleY();
+	m_displayState.dpi = currentDisplayInformation.LogicalDpi();
+	m_displayMetrics = m_displayMetricsCache.Get(m_displayState);
+	m_d2dContext->SetDpi(m_displayState.dpi, m_displayState.dpi);
 
 	CreateWindowSizeDependentResources();
 }
@@ -513,44 +476,35 @@ void DX::DeviceResources::SetSwapChainPanel(SwapChainPanel const& panel)
 // This method is called in the event handler for the SizeChanged event.
 void DX::DeviceResources::SetLogicalSize(winrt::Windows::Foundation::Size logicalSize)
 {
-	if (m_logicalSize != logicalSize)
-	{
-		m_logicalSize = logicalSize;
-		CreateWindowSizeDependentResources();
-	}
+	DisplayState state = m_displayState;
+	state.logicalWidth = logicalSize.Width;
+	state.logicalHeight = logicalSize.Height;
+	SetDisplayState(state);
 }
 
 // This method is called in the event handler for the DpiChanged event.
 void DX::DeviceResources::SetDpi(float dpi)
 {
-	if (dpi != m_dpi)
-	{
-		m_dpi = dpi;
-		m_d2dContext->SetDpi(m_dpi, m_dpi);
-		CreateWindowSizeDependentResources();
-	}
+	DisplayState state = m_displayState;
+	state.dpi = dpi;
+	SetDisplayState(state);
 }
 
 // This method is called in the event handler for the OrientationChanged event.
 void DX::DeviceResources::SetCurrentOrientation(DisplayOrientations currentOrientation)
 {
-	if (m_currentOrientation != currentOrientation)
-	{
-		m_currentOrientation = currentOrientation;
-		CreateWindowSizeDependentResources();
-	}
+	DisplayState state = m_displayState;
+	state.currentOrientation = static_cast<DX::DisplayOrientation>(currentOrientation);
+	SetDisplayState(state);
 }
 
 // This method is called in the event handler for the CompositionScaleChanged event.
 void DX::DeviceResources::SetCompositionScale(float compositionScaleX, float compositionScaleY)
 {
-	if (m_compositionScaleX != compositionScaleX ||
-		m_compositionScaleY != compositionScaleY)
-	{
-		m_compositionScaleX = compositionScaleX;
-		m_compositionScaleY = compositionScaleY;
-		CreateWindowSizeDependentResources();
-	}
+	DisplayState state = m_displayState;
+	state.compositionScaleX = compositionScaleX;
+	state.compositionScaleY = compositionScaleY;
+	SetDisplayState(state);
 }
 
 // This method is called in the event handler for the DisplayContentsInvalidated event.
@@ -615,7 +569,7 @@ void DX::DeviceResources::HandleDeviceLost()
 	}
 
 	CreateDeviceResources();
-	m_d2dContext->SetDpi(m_dpi, m_dpi);
+	m_d2dContext->SetDpi(m_displayState.dpi, m_displayState.dpi);
 	CreateWindowSizeDependentResources();
 
 	if (m_deviceNotify != nullptr)
@@ -665,62 +619,62 @@ void DX::DeviceResources::Present()
 	else
 	{
 		winrt::check_hresult(hr);
+		m_occluded = (hr == DXGI_STATUS_OCCLUDED);
 	}
 }
 
-// This method determines the rotation between the display device's native orientation and the
-// current display orientation.
-DXGI_MODE_ROTATION DX::DeviceResources::ComputeDisplayRotation()
+// Present only the parts of the swap chain that changed since the previous Present. The caller
+// is responsible for keeping the rest of each back buffer up to date, so unlike Present() the
+// render target is not discarded afterwards.
+void DX::DeviceResources::Present(const DirtyRegion& dirtyRegion)
 {
-	DXGI_MODE_ROTATION rotation = DXGI_MODE_ROTATION_UNSPECIFIED;
+	DirtyRect bounds = { 0, 0, lround(m_displayMetrics.renderTargetWidth), lround(m_displayMetrics.renderTargetHeight) };
 
-	// Note: NativeOrientation can only be Landscape or Portrait even though
-	// the DisplayOrientations enum has other values.
-	switch (m_nativeOrientation)
+	// An empty list tells DXGI the whole buffer changed. That is also what we want when
+	// nothing changed at all, since the buffer then holds exactly the previous frame.
+	RECT dirtyRects[DirtyRegion::MaxRects];
+	DXGI_PRESENT_PARAMETERS parameters = { 0 };
+
+	if (!dirtyRegion.IsEmpty() && !dirtyRegion.Covers(bounds))
 	{
-	case DisplayOrientations::Landscape:
-		switch (m_currentOrientation)
+		for (size_t i = 0; i < dirtyRegion.GetCount(); i++)
 		{
-		case DisplayOrientations::Landscape:
-			rotation = DXGI_MODE_ROTATION_IDENTITY;
-			break;
-
-		case DisplayOrientations::Portrait:
-			rotation = DXGI_MODE_ROTATION_ROTATE270;
-			break;
-
-		case DisplayOrientations::LandscapeFlipped:
-			rotation = DXGI_MODE_ROTATION_ROTATE180;
-			break;
-
-		case DisplayOrientations::PortraitFlipped:
-			rotation = DXGI_MODE_ROTATION_ROTATE90;
-			break;
+			const DirtyRect& rect = dirtyRegion.GetRects()[i];
+			dirtyRects[i] = { rect.left, rect.top, rect.right, rect.bottom };
 		}
-		break;
 
-	case DisplayOrientations::Portrait:
-		switch (m_currentOrientation)
-		{
-		case DisplayOrientations::Landscape:
-			rotation = DXGI_MODE_ROTATION_ROTATE90;
-			break;
+		parameters.DirtyRectsCount = static_cast<UINT>(dirtyRegion.GetCount());
+		parameters.pDirtyRects = dirtyRects;
+	}
 
-		case DisplayOrientations::Portrait:
-			rotation = DXGI_MODE_ROTATION_IDENTITY;
-			break;
+	HRESULT hr = m_swapChain->Present1(1, 0, &parameters);
 
-		case DisplayOrientations::LandscapeFlipped:
-			rotation = DXGI_MODE_ROTATION_ROTATE270;
-			break;
+	// The depth stencil is cleared every frame, so it can still be discarded.
+	m_d3dContext->DiscardView1(m_d3dDepthStencilView.get(), nullptr, 0);
 
-		case DisplayOrientations::PortraitFlipped:
-			rotation = DXGI_MODE_ROTATION_ROTATE180;
-			break;
-		}
-		break;
+	if (hr == DXGI_ERROR_DEVICE_REMOVED || hr == DXGI_ERROR_DEVICE_RESET)
+	{
+		HandleDeviceLost();
+	}
+	else
+	{
+		winrt::check_hresult(hr);
+		m_occluded = (hr == DXGI_STATUS_OCCLUDED);
 	}
-	return rotation;
 }
 
+// Checks whether a present would be shown, without presenting or waiting for vsync. Returns true
+// while the swap chain is still occluded.
+bool DX::DeviceResources::TestPresent()
+{
+	HRESULT hr = m_swapChain->Present(0, DXGI_PRESENT_TEST);
+	if (hr == DXGI_ERROR_DEVICE_REMOVED || hr == DXGI_ERROR_DEVICE_RESET)
+	{
+		HandleDeviceLost();
+		return false;
+	}
 
+	winrt::check_hresult(hr);
+	m_occluded = (hr == DXGI_STATUS_OCCLUDED);
+	return m_occluded;
+}
@@ -1,5 +1,9 @@
 ﻿#pragma once
 
+#include "DirtyRegion.h"
+#include "DisplayMetrics.h"
+#include "StartupGraph.h"
+
 namespace DX
 {
 	// Provides an interface for an application that owns DeviceResources to be notified of the device being lost or created.
@@ -13,24 +17,45 @@ namespace DX
 	class DeviceResources
 	{
 	public:
+		// Creates the factories and the device now.
 		DeviceResources();
+
+		// Adds stages that create them to a startup graph instead, overlapping the Direct2D
+		// factory with the Direct3D device. Nothing else may be called before the stage
+		// GetCreationStage returns has run.
+		explicit DeviceResources(StartupGraph& startup);
+		StartupGraph::StageId GetCreationStage() const { return m_creationStage; }
+
 		void SetSwapChainPanel(winrt::Windows::UI::Xaml::Controls::SwapChainPanel const& panel);
 		void SetLogicalSize(winrt::Windows::Foundation::Size logicalSize);
 		void SetCurrentOrientation(winrt::Windows::Graphics::Display::DisplayOrientations currentOrientation);
 		void SetDpi(float dpi);
 		void SetCompositionScale(float compositionScaleX, float compositionScaleY);
+
+		// Applies several display changes at once. Resizes the swap chain only if the size of
+		// its buffers changes, and returns what the change means for content.
+		DisplayChange SetDisplayState(const DisplayState& state);
 		void ValidateDevice();
 		void HandleDeviceLost();
 		void RegisterDeviceNotify(IDeviceNotify* deviceNotify);
 		void Trim();
 		void Present();
+		void Present(const DirtyRegion& dirtyRegion);
+
+		// Whether the last present found the swap chain's content hidden, e.g. behind another
+		// window. TestPresent asks again without presenting, for a loop that stopped drawing.
+		bool IsOccluded() const { return m_occluded; }
+		bool TestPresent();
 
 		// The size of the render target, in pixels.
-		winrt::Windows::Foundation::Size	GetOutputSize() const					{ return m_outputSize; }
+		winrt::Windows::Foundation::Size	GetOutputSize() const					{ return { m_displayMetrics.outputWidth, m_displayMetrics.outputHeight }; }
 
 		// The size of the render target, in dips.
-		winrt::Windows::Foundation::Size	GetLogicalSize() const					{ return m_logicalSize; }
-		float						GetDpi() const							{ return m_effectiveDpi; }
+		winrt::Windows::Foundation::Size	GetLogicalSize() const					{ return { m_displayState.logicalWidth, m_displayState.logicalHeight }; }
+		float						GetDpi() const							{ return m_displayMetrics.effectiveDpi; }
+
+		const DisplayState&			GetDisplayState() const					{ return m_displayState; }
+		const DisplayMetrics&		GetDisplayMetrics() const				{ return m_displayMetrics; }
 
 		// D3D Accessors.
 		ID3D11Device3*				GetD3DDevice() const					{ return m_d3dDevice.get(); }
@@ -40,23 +65,31 @@ namespace DX
 		ID3D11RenderTargetView1*	GetBackBufferRenderTargetView() const	{ return m_d3dRenderTargetView.get(); }
 		ID3D11DepthStencilView*		GetDepthStencilView() const				{ return m_d3dDepthStencilView.get(); }
 		D3D11_VIEWPORT				GetScreenViewport() const				{ return m_screenViewport; }
-		DirectX::XMFLOAT4X4			GetOrientationTransform3D() const		{ return m_orientationTransform3D; }
+		DirectX::XMFLOAT4X4			GetOrientationTransform3D() const		{ return DirectX::XMFLOAT4X4(m_displayMetrics.orientationTransform3D); }
 
 		// D2D Accessors.
 		ID2D1Factory3*				GetD2DFactory() const					{ return m_d2dFactory.get(); }
 		ID2D1Device2*				GetD2DDevice() const					{ return m_d2dDevice.get(); }
 		ID2D1DeviceContext2*		GetD2DDeviceContext() const				{ return m_d2dContext.get(); }
 		ID2D1Bitmap1*				GetD2DTargetBitmap() const				{ return m_d2dTargetBitmap.get(); }
-		IDWriteFactory3*			GetDWriteFactory() const				{ return m_dwriteFactory.get(); }
-		IWICImagingFactory2*		GetWicImagingFactory() const			{ return m_wicFactory.get(); }
-		D2D1::Matrix3x2F			GetOrientationTransform2D() const		{ return m_orientationTransform2D; }
+
+		// Created on first use, from any thread, since few apps need them before their first frame.
+		IDWriteFactory3*			GetDWriteFactory() const;
+		IWICImagingFactory2*		GetWicImagingFactory() const;
+
+		D2D1::Matrix3x2F			GetOrientationTransform2D() const
+		{
+			const float* transform = m_displayMetrics.orientationTransform2D;
+			return D2D1::Matrix3x2F(transform[0], transform[1], transform[2], transform[3], transform[4], transform[5]);
+		}
 
 	private:
 		void CreateDeviceIndependentResources();
 		void CreateDeviceResources();
+		void CreateDirect3DDevice();
+		void CreateDirect2DDevice();
 		void CreateWindowSizeDependentResources();
-		void UpdateRenderTargetSize();
-		DXGI_MODE_ROTATION ComputeDisplayRotation();
+		void UpdateSwapChainTransform();
 
 		// Direct3D objects.
 		winrt::com_ptr<ID3D11Device3>			m_d3dDevice;
@@ -75,34 +108,29 @@ namespace DX
 		winrt::com_ptr<ID2D1Bitmap1>		m_d2dTargetBitmap;
 
 		// DirectWrite drawing components.
-		winrt::com_ptr<IDWriteFactory3>		m_dwriteFactory;
-		winrt::com_ptr<IWICImagingFactory2>	m_wicFactory;
+		mutable std::once_flag						m_dwriteFactoryCreated;
+		mutable winrt::com_ptr<IDWriteFactory3>		m_dwriteFactory;
+		mutable std::once_flag						m_wicFactoryCreated;
+		mutable winrt::com_ptr<IWICImagingFactory2>	m_wicFactory;
 
 		// Cached reference to the XAML panel.
 		winrt::Windows::UI::Xaml::Controls::SwapChainPanel	m_swapChainPanel;
 
 		// Cached device properties.
 		D3D_FEATURE_LEVEL								m_d3dFeatureLevel;
-		winrt::Windows::Foundation::Size						m_d3dRenderTargetSize;
-		winrt::Windows::Foundation::Size						m_outputSize;
-		winrt::Windows::Foundation::Size						m_logicalSize;
-		winrt::Windows::Graphics::Display::DisplayOrientations	m_nativeOrientation;
-		winrt::Windows::Graphics::Display::DisplayOrientations	m_currentOrientation;
-		float											m_dpi;
-		float											m_compositionScaleX;
-		float											m_compositionScaleY;
-
-		// Variables that take into account whether the app supports high resolution screens or not.
-		float											m_effectiveDpi;
-		float											m_effectiveCompositionScaleX;
-		float											m_effectiveCompositionScaleY;
-
-		// Transforms used for display orientation.
-		D2D1::Matrix3x2F	m_orientationTransform2D;
-		DirectX::XMFLOAT4X4	m_orientationTransform3D;
+		bool											m_occluded;
+
+		// The window's display state, and the sizes and transforms that follow from it, taking
+		// into account whether the app supports high resolution screens or not.
+		DisplayState									m_displayState;
+		DisplayMetrics									m_displayMetrics;
+		DisplayMetricsCache								m_displayMetricsCache;
 
 		// The IDeviceNotify can be held directly as it owns the DeviceResources.
 		IDeviceNotify* m_deviceNotify;
+
+		// The startup stage after which the device exists, when a startup graph creates it.
+		StartupGraph::StageId							m_creationStage;
 	};
 
 
@@ -0,0 +1,221 @@
+﻿#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <cstdint>
+
+namespace DX
+{
+	// Axis-aligned rectangle in render target pixels. Right and bottom are exclusive, matching
+	// the RECT convention used by DXGI and Direct3D.
+	struct DirtyRect
+	{
+		int32_t left;
+		int32_t top;
+		int32_t right;
+		int32_t bottom;
+
+		bool IsEmpty() const		{ return right <= left || bottom <= top; }
+		int64_t Area() const		{ return IsEmpty() ? 0 : static_cast<int64_t>(right - left) * (bottom - top); }
+
+		bool Contains(const DirtyRect& other) const
+		{
+			return left <= other.left && top <= other.top && right >= other.right && bottom >= other.bottom;
+		}
+
+		// True if the rectangles overlap or share an edge.
+		bool Touches(const DirtyRect& other) const
+		{
+			return left <= other.right && other.left <= right && top <= other.bottom && other.top <= bottom;
+		}
+
+		static DirtyRect Union(const DirtyRect& a, const DirtyRect& b)
+		{
+			return { (std::min)(a.left, b.left), (std::min)(a.top, b.top), (std::max)(a.right, b.right), (std::max)(a.bottom, b.bottom) };
+		}
+
+		static DirtyRect Intersect(const DirtyRect& a, const DirtyRect& b)
+		{
+			return { (std::max)(a.left, b.left), (std::max)(a.top, b.top), (std::min)(a.right, b.right), (std::min)(a.bottom, b.bottom) };
+		}
+	};
+
+	// Accumulates the parts of a frame that changed, as a small set of rectangles. Rectangles
+	// are merged whenever doing so doesn't cost more area than keeping them apart, and the set
+	// is capped so that the list handed to Present stays short. Never allocates.
+	class DirtyRegion
+	{
+	public:
+		static const size_t MaxRects = 8;
+
+		DirtyRegion() : m_count(0) {}
+
+		void Clear()						{ m_count = 0; }
+		bool IsEmpty() const				{ return m_count == 0; }
+		size_t GetCount() const				{ return m_count; }
+		const DirtyRect* GetRects() const	{ return m_rects.data(); }
+
+		void Add(DirtyRect rect)
+		{
+			if (rect.IsEmpty())
+			{
+				return;
+			}
+
+			// Fold the new rectangle into any existing one it overlaps, as long as the merged
+			// rectangle is no bigger than the two separately. Merging can make the result touch
+			// rectangles that were already checked, so restart after every merge.
+			bool merged = true;
+			while (merged)
+			{
+				merged = false;
+				for (size_t i = 0; i < m_count; i++)
+				{
+					const DirtyRect& existing = m_rects[i];
+					if (existing.Contains(rect))
+					{
+						return;
+					}
+
+					if (rect.Contains(existing) ||
+						(rect.Touches(existing) && DirtyRect::Union(rect, existing).Area() <= rect.Area() + existing.Area()))
+					{
+						rect = DirtyRect::Union(rect, existing);
+						RemoveAt(i);
+						merged = true;
+						break;
+					}
+				}
+			}
+
+			m_rects[m_count++] = rect;
+
+			if (m_count > MaxRects)
+			{
+				MergeCheapestPair();
+			}
+		}
+
+		void Add(const DirtyRegion& region)
+		{
+			for (size_t i = 0; i < region.m_count; i++)
+			{
+				Add(region.m_rects[i]);
+			}
+		}
+
+		// Restricts the region to the specified bounds, typically the render target.
+		void Clip(const DirtyRect& bounds)
+		{
+			size_t count = 0;
+			for (size_t i = 0; i < m_count; i++)
+			{
+				DirtyRect clipped = DirtyRect::Intersect(m_rects[i], bounds);
+				if (!clipped.IsEmpty())
+				{
+					m_rects[count++] = clipped;
+				}
+			}
+			m_count = count;
+		}
+
+		// Smallest rectangle enclosing the whole region.
+		DirtyRect GetBounds() const
+		{
+			if (m_count == 0)
+			{
+				return { 0, 0, 0, 0 };
+			}
+
+			DirtyRect bounds = m_rects[0];
+			for (size_t i = 1; i < m_count; i++)
+			{
+				bounds = DirtyRect::Union(bounds, m_rects[i]);
+			}
+			return bounds;
+		}
+
+		// Total area of the region, counting pixels covered by more than one rectangle once.
+		// Rectangles that overlap but would waste area if merged are kept apart, so the areas
+		// can't simply be summed. Instead the region is cut into cells along every rectangle
+		// edge, and the cells inside any rectangle are counted.
+		int64_t GetArea() const
+		{
+			std::array<int32_t, MaxRects * 2> xs;
+			std::array<int32_t, MaxRects * 2> ys;
+			for (size_t i = 0; i < m_count; i++)
+			{
+				xs[i * 2] = m_rects[i].left;
+				xs[i * 2 + 1] = m_rects[i].right;
+				ys[i * 2] = m_rects[i].top;
+				ys[i * 2 + 1] = m_rects[i].bottom;
+			}
+			std::sort(xs.begin(), xs.begin() + m_count * 2);
+			std::sort(ys.begin(), ys.begin() + m_count * 2);
+
+			int64_t area = 0;
+			for (size_t x = 0; x + 1 < m_count * 2; x++)
+			{
+				for (size_t y = 0; y + 1 < m_count * 2; y++)
+				{
+					DirtyRect cell = { xs[x], ys[y], xs[x + 1], ys[y + 1] };
+					if (!cell.IsEmpty() && Covers(cell))
+					{
+						area += cell.Area();
+					}
+				}
+			}
+			return area;
+		}
+
+		bool Covers(const DirtyRect& bounds) const
+		{
+			for (size_t i = 0; i < m_count; i++)
+			{
+				if (m_rects[i].Contains(bounds))
+				{
+					return true;
+				}
+			}
+			return false;
+		}
+
+	private:
+		void RemoveAt(size_t index)
+		{
+			m_rects[index] = m_rects[m_count - 1];
+			m_count--;
+		}
+
+		// Merges the two rectangles whose union wastes the least area.
+		void MergeCheapestPair()
+		{
+			size_t bestA = 0;
+			size_t bestB = 1;
+			int64_t bestWaste = INT64_MAX;
+
+			for (size_t a = 0; a < m_count; a++)
+			{
+				for (size_t b = a + 1; b < m_count; b++)
+				{
+					int64_t waste = DirtyRect::Union(m_rects[a], m_rects[b]).Area() - m_rects[a].Area() - m_rects[b].Area();
+					if (waste < bestWaste)
+					{
+						bestWaste = waste;
+						bestA = a;
+						bestB = b;
+					}
+				}
+			}
+
+			DirtyRect merged = DirtyRect::Union(m_rects[bestA], m_rects[bestB]);
+			RemoveAt(bestB);
+			RemoveAt(bestA);
+			Add(merged);
+		}
+
+		std::array<DirtyRect, MaxRects + 1>	m_rects;
+		size_t								m_count;
+	};
+}
@@ -0,0 +1,324 @@
+﻿#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+
+namespace DX
+{
+	namespace DisplayScaling
+	{
+		// High resolution displays can require a lot of GPU and battery power to render.
+		// High resolution phones, for example, may suffer from poor battery life if
+		// games attempt to render at 60 frames per second at full fidelity.
+		// The decision to render at full fidelity across all platforms and form factors
+		// should be deliberate.
+		const bool SupportHighResolutions = false;
+
+		// The default thresholds that define a "high resolution" display. If the thresholds
+		// are exceeded and SupportHighResolutions is false, the dimensions will be scaled
+		// by 50%.
+		const float DpiThreshold = 192.0f;		// 200% of standard desktop display.
+		const float WidthThreshold = 1920.0f;	// 1080p width.
+		const float HeightThreshold = 1080.0f;	// 1080p height.
+	}
+
+	// The values of Windows::Graphics::Display::DisplayOrientations.
+	enum class DisplayOrientation : uint32_t
+	{
+		None = 0,
+		Landscape = 1,
+		Portrait = 2,
+		LandscapeFlipped = 4,
+		PortraitFlipped = 8,
+	};
+
+	// The values of DXGI_MODE_ROTATION: how the swap chain is rotated relative to the display's
+	// native orientation.
+	enum class DisplayRotation : uint32_t
+	{
+		Unspecified = 0,
+		Identity = 1,
+		Rotate90 = 2,
+		Rotate180 = 3,
+		Rotate270 = 4,
+	};
+
+	// Everything the window reports about how it is displayed.
+	struct DisplayState
+	{
+		float				logicalWidth;		// DIPs.
+		float				logicalHeight;
+		float				dpi;
+		float				compositionScaleX;
+		float				compositionScaleY;
+		DisplayOrientation	nativeOrientation;
+		DisplayOrientation	currentOrientation;
+
+		bool operator==(const DisplayState& other) const
+		{
+			return logicalWidth == other.logicalWidth && logicalHeight == other.logicalHeight && dpi == other.dpi &&
+				compositionScaleX == other.compositionScaleX && compositionScaleY == other.compositionScaleY &&
+				nativeOrientation == other.nativeOrientation && currentOrientation == other.currentOrientation;
+		}
+
+		bool operator!=(const DisplayState& other) const { return !(*this == other); }
+	};
+
+	// What the swap chain and the renderers need to know about a DisplayState.
+	struct DisplayMetrics
+	{
+		// The DPI and composition scale to render at, which are halved on high resolution
+		// displays unless SupportHighResolutions is set.
+		float				effectiveDpi;
+		float				effectiveCompositionScaleX;
+		float				effectiveCompositionScaleY;
+
+		// The render target in pixels, as the app sees it, and as the swap chain's buffers are
+		// laid out in the display's native orientation.
+		float				outputWidth;
+		float				outputHeight;
+		float				renderTargetWidth;
+		float				renderTargetHeight;
+
+		DisplayRotation		rotation;
+
+		// The rotation as a D2D1_MATRIX_3X2_F in DIPs, and as a row-major 4x4 matrix for 3D
+		// content. The 2D and 3D rotations differ because the coordinate spaces do.
+		float				orientationTransform2D[6];
+		float				orientationTransform3D[16];
+	};
+
+	// How much of the swap chain a change from one DisplayMetrics to another affects.
+	enum class DisplayChange : uint32_t
+	{
+		None,			// Nothing a renderer can see.
+		Transform,		// The rotation, the scale or the DPI; the buffers keep their size.
+		Resize,			// The buffers must be resized, and their views created again.
+	};
+
+	namespace DisplayMetricsDetail
+	{
+		inline float ConvertDipsToPixels(float dips, float dpi)
+		{
+			constexpr float dipsPerInch = 96.0f;
+			return std::floor(dips * dpi / dipsPerInch + 0.5f); // Round to nearest integer.
+		}
+
+		// Rotations indexed by native orientation (landscape, portrait) and current orientation
+		// (landscape, portrait, landscape flipped, portrait flipped).
+		const DisplayRotation Rotations[2][4] =
+		{
+			{ DisplayRotation::Identity, DisplayRotation::Rotate270, DisplayRotation::Rotate180, DisplayRotation::Rotate90 },
+			{ DisplayRotation::Rotate90, DisplayRotation::Identity, DisplayRotation::Rotate270, DisplayRotation::Rotate180 },
+		};
+
+		// 0, 270, 180 and 90 degree Z-rotations, indexed by DisplayRotation. The 3D matrices
+		// are spelled out to avoid rounding errors.
+		const float Transforms3D[5][16] =
+		{
+			{ 1.0f, 0.0f, 0.0f, 0.0f,  0.0f, 1.0f, 0.0f, 0.0f,  0.0f, 0.0f, 1.0f, 0.0f,  0.0f, 0.0f, 0.0f, 1.0f },
+			{ 1.0f, 0.0f, 0.0f, 0.0f,  0.0f, 1.0f, 0.0f, 0.0f,  0.0f, 0.0f, 1.0f, 0.0f,  0.0f, 0.0f, 0.0f, 1.0f },
+			{ 0.0f, -1.0f, 0.0f, 0.0f,  1.0f, 0.0f, 0.0f, 0.0f,  0.0f, 0.0f, 1.0f, 0.0f,  0.0f, 0.0f, 0.0f, 1.0f },
+			{ -1.0f, 0.0f, 0.0f, 0.0f,  0.0f, -1.0f, 0.0f, 0.0f,  0.0f, 0.0f, 1.0f, 0.0f,  0.0f, 0.0f, 0.0f, 1.0f },
+			{ 0.0f, 1.0f, 0.0f, 0.0f,  -1.0f, 0.0f, 0.0f, 0.0f,  0.0f, 0.0f, 1.0f, 0.0f,  0.0f, 0.0f, 0.0f, 1.0f },
+		};
+
+		inline int GetOrientationIndex(DisplayOrientation orientation)
+		{
+			switch (orientation)
+			{
+			case DisplayOrientation::Landscape:			return 0;
+			case DisplayOrientation::Portrait:			return 1;
+			case DisplayOrientation::LandscapeFlipped:	return 2;
+			case DisplayOrientation::PortraitFlipped:	return 3;
+			default:									return -1;
+			}
+		}
+	}
+
+	// The rotation between the display's native orientation and its current one. Native
+	// orientations can only be landscape or portrait; anything else is unspecified.
+	inline DisplayRotation ComputeDisplayRotation(DisplayOrientation nativeOrientation, DisplayOrientation currentOrientation)
+	{
+		int native = DisplayMetricsDetail::GetOrientationIndex(nativeOrientation);
+		int current = DisplayMetricsDetail::GetOrientationIndex(currentOrientation);
+		if (native < 0 || native > 1 || current < 0)
+		{
+			return DisplayRotation::Unspecified;
+		}
+		return DisplayMetricsDetail::Rotations[native][current];
+	}
+
+	// Works out the render target size and the orientation transforms for a state. Pure, so the
+	// results can be cached and compared; see DisplayMetricsCache.
+	inline DisplayMetrics ComputeDisplayMetrics(const DisplayState& state)
+	{
+		using DisplayMetricsDetail::ConvertDipsToPixels;
+
+		DisplayMetrics metrics = {};
+		metrics.effectiveDpi = state.dpi;
+		metrics.effectiveCompositionScaleX = state.compositionScaleX;
+		metrics.effectiveCompositionScaleY = state.compositionScaleY;
+
+		// To improve battery life on high resolution devices, render to a smaller render target
+		// and allow the GPU to scale the output when it is presented.
+		if (!DisplayScaling::SupportHighResolutions && state.dpi > DisplayScaling::DpiThreshold)
+		{
+			float width = ConvertDipsToPixels(state.logicalWidth, state.dpi);
+			float height = ConvertDipsToPixels(state.logicalHeight, state.dpi);
+
+			// When the device is in portrait orientation, height > width. Compare the
+			// larger dimension against the width threshold and the smaller dimension
+			// against the height threshold.
+			if ((std::max)(width, height) > DisplayScaling::WidthThreshold && (std::min)(width, height) > DisplayScaling::HeightThreshold)
+			{
+				// To scale the app we change the effective DPI. Logical size does not change.
+				metrics.effectiveDpi /= 2.0f;
+				metrics.effectiveCompositionScaleX /= 2.0f;
+				metrics.effectiveCompositionScaleY /= 2.0f;
+			}
+		}
+
+		// Calculate the necessary render target size in pixels, and prevent zero size DirectX
+		// content from being created.
+		metrics.outputWidth = ConvertDipsToPixels(state.logicalWidth, metrics.effectiveDpi);
+		metrics.outputHeight = ConvertDipsToPixels(state.logicalHeight, metrics.effectiveDpi);
+		metrics.outputWidth = (std::max)(metrics.outputWidth, 1.0f);
+		metrics.outputHeight = (std::max)(metrics.outputHeight, 1.0f);
+
+		// The width and height of the swap chain must be based on the window's
+		// natively-oriented width and height. If the window is not in the native
+		// orientation, the dimensions must be reversed.
+		metrics.rotation = ComputeDisplayRotation(state.nativeOrientation, state.currentOrientation);
+		bool swapDimensions = metrics.rotation == DisplayRotation::Rotate90 || metrics.rotation == DisplayRotation::Rotate270;
+		metrics.renderTargetWidth = swapDimensions ? metrics.outputHeight : metrics.outputWidth;
+		metrics.renderTargetHeight = swapDimensions ? metrics.outputWidth : metrics.outputHeight;
+
+		// The 2D transforms rotate clockwise by the rotation and translate the result back onto
+		// the logical screen. They are spelled out, like the 3D ones, to avoid rounding errors.
+		float* transform = metrics.orientationTransform2D;
+		switch (metrics.rotation)
+		{
+		case DisplayRotation::Rotate90:
+			transform[0] = 0.0f;	transform[1] = 1.0f;
+			transform[2] = -1.0f;	transform[3] = 0.0f;
+			transform[4] = state.logicalHeight;	transform[5] = 0.0f;
+			break;
+
+		case DisplayRotation::Rotate180:
+			transform[0] = -1.0f;	transform[1] = 0.0f;
+			transform[2] = 0.0f;	transform[3] = -1.0f;
+			transform[4] = state.logicalWidth;	transform[5] = state.logicalHeight;
+			break;
+
+		case DisplayRotation::Rotate270:
+			transform[0] = 0.0f;	transform[1] = -1.0f;
+			transform[2] = 1.0f;	transform[3] = 0.0f;
+			transform[4] = 0.0f;	transform[5] = state.logicalWidth;
+			break;
+
+		default:
+			transform[0] = 1.0f;	transform[1] = 0.0f;
+			transform[2] = 0.0f;	transform[3] = 1.0f;
+			transform[4] = 0.0f;	transform[5] = 0.0f;
+			break;
+		}
+
+		const float* transform3D = DisplayMetricsDetail::Transforms3D[static_cast<uint32_t>(metrics.rotation)];
+		for (int i = 0; i < 16; i++)
+		{
+			metrics.orientationTransform3D[i] = transform3D[i];
+		}
+
+		return metrics;
+	}
+
+	// What moving from one set of metrics to another requires of the swap chain. Buffers only
+	// need resizing when their size in the native orientation changes; a rotation by 180
+	// degrees, a new composition scale, or a new size that rounds to the same pixels only
+	// changes how the buffers are presented and how content is transformed into them.
+	inline DisplayChange CompareDisplayMetrics(const DisplayMetrics& previous, const DisplayMetrics& next)
+	{
+		if (previous.renderTargetWidth != next.renderTargetWidth || previous.renderTargetHeight != next.renderTargetHeight)
+		{
+			return DisplayChange::Resize;
+		}
+
+		if (previous.effectiveDpi != next.effectiveDpi ||
+			previous.effectiveCompositionScaleX != next.effectiveCompositionScaleX ||
+			previous.effectiveCompositionScaleY != next.effectiveCompositionScaleY ||
+			previous.outputWidth != next.outputWidth || previous.outputHeight != next.outputHeight ||
+			previous.rotation != next.rotation)
+		{
+			return DisplayChange::Transform;
+		}
+
+		for (int i = 0; i < 6; i++)
+		{
+			if (previous.orientationTransform2D[i] != next.orientationTransform2D[i])
+			{
+				return DisplayChange::Transform;
+			}
+		}
+
+		return DisplayChange::None;
+	}
+
+	// Remembers the metrics of the last few states. Windows tend to move between a handful of
+	// states, such as two orientations or the DPIs of two monitors, and a change is often
+	// reported by several events in turn, each of which would otherwise compute everything again.
+	class DisplayMetricsCache
+	{
+	public:
+		static const size_t Capacity = 8;
+
+		DisplayMetricsCache() :
+			m_count(0),
+			m_next(0),
+			m_hits(0),
+			m_misses(0)
+		{
+		}
+
+		// The reference is valid until the next call.
+		const DisplayMetrics& Get(const DisplayState& state)
+		{
+			for (size_t i = 0; i < m_count; i++)
+			{
+				if (m_entries[i].state == state)
+				{
+					m_hits++;
+					return m_entries[i].metrics;
+				}
+			}
+
+			// Replace the oldest entry.
+			m_misses++;
+			Entry& entry = m_entries[m_next];
+			entry.state = state;
+			entry.metrics = ComputeDisplayMetrics(state);
+			m_next = (m_next + 1) % Capacity;
+			m_count = (m_count < Capacity) ? m_count + 1 : Capacity;
+			return entry.metrics;
+		}
+
+		void Clear()				{ m_count = 0; m_next = 0; }
+		uint64_t GetHits() const	{ return m_hits; }
+		uint64_t GetMisses() const	{ return m_misses; }
+
+	private:
+		struct Entry
+		{
+			DisplayState	state;
+			DisplayMetrics	metrics;
+		};
+
+		Entry		m_entries[Capacity];
+		size_t		m_count;
+		size_t		m_next;
+		uint64_t	m_hits;
+		uint64_t	m_misses;
+	};
+}
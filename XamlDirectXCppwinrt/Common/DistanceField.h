@@ -0,0 +1,134 @@
+﻿#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace DX
+{
+	// Signed distance fields, which store for each texel how far it is from the nearest edge of a
+	// shape instead of whether it is covered. Sampled with bilinear filtering and thresholded in
+	// a shader, a distance field gives sharp edges at any scale, so one small rasterization of a
+	// glyph serves every size and DPI it is drawn at.
+	namespace DistanceField
+	{
+		const float Infinity = 1.0e20f;
+
+		// One dimension of the exact squared Euclidean distance transform of Felzenszwalb and
+		// Huttenlocher: the lower envelope of the parabolas rooted at each sample. scratch must
+		// hold 2 * count + 1 values, and positions count values.
+		inline void Transform1D(float* values, size_t stride, int count, float* scratch, int* positions)
+		{
+			float* boundaries = scratch;
+			float* source = scratch + count + 1;
+			for (int i = 0; i < count; i++)
+			{
+				source[i] = values[i * stride];
+			}
+
+			int hull = 0;
+			positions[0] = 0;
+			boundaries[0] = -Infinity;
+			boundaries[1] = Infinity;
+
+			for (int q = 1; q < count; q++)
+			{
+				// Drop the parabolas that the new one hides.
+				float s;
+				for (;;)
+				{
+					int p = positions[hull];
+					s = ((source[q] + float(q) * q) - (source[p] + float(p) * p)) / (2.0f * (q - p));
+					if (s > boundaries[hull] || hull == 0)
+					{
+						break;
+					}
+					hull--;
+				}
+
+				hull++;
+				positions[hull] = q;
+				boundaries[hull] = s;
+				boundaries[hull + 1] = Infinity;
+			}
+
+			hull = 0;
+			for (int q = 0; q < count; q++)
+			{
+				while (boundaries[hull + 1] < q)
+				{
+					hull++;
+				}
+				int p = positions[hull];
+				values[q * stride] = float(q - p) * (q - p) + source[p];
+			}
+		}
+
+		// Replaces each value, 0 at feature texels and Infinity elsewhere, with the squared
+		// distance to the nearest feature texel.
+		inline void Transform2D(float* values, int width, int height)
+		{
+			int longest = (std::max)(width, height);
+			std::vector<float> scratch(size_t(longest) * 2 + 1);
+			std::vector<int> positions(longest);
+
+			for (int x = 0; x < width; x++)
+			{
+				Transform1D(values + x, size_t(width), height, scratch.data(), positions.data());
+			}
+			for (int y = 0; y < height; y++)
+			{
+				Transform1D(values + size_t(y) * width, 1, width, scratch.data(), positions.data());
+			}
+		}
+
+		// Builds the distance field of an 8-bit coverage bitmap, where texels of at least 128
+		// are inside. The field is spread texels larger than the bitmap on every side, so that
+		// edges near the bitmap's border still fade out. Distances are encoded as 128 at the edge,
+		// rising inside and falling outside by 127 / spread per texel, and saturate at spread
+		// texels. destination has rows of destinationPitch bytes.
+		inline void Generate(const uint8_t* coverage, uint32_t width, uint32_t height, uint32_t pitch, uint32_t spread, uint8_t* destination, uint32_t destinationPitch)
+		{
+			int fieldWidth = static_cast<int>(width + spread * 2);
+			int fieldHeight = static_cast<int>(height + spread * 2);
+			size_t size = size_t(fieldWidth) * fieldHeight;
+
+			// Squared distances from each texel to the nearest inside texel, and to the nearest
+			// outside one.
+			std::vector<float> toInside(size, Infinity);
+			std::vector<float> toOutside(size, 0.0f);
+			for (uint32_t y = 0; y < height; y++)
+			{
+				for (uint32_t x = 0; x < width; x++)
+				{
+					if (coverage[size_t(y) * pitch + x] >= 128)
+					{
+						size_t texel = size_t(y + spread) * fieldWidth + x + spread;
+						toInside[texel] = 0.0f;
+						toOutside[texel] = Infinity;
+					}
+				}
+			}
+
+			Transform2D(toInside.data(), fieldWidth, fieldHeight);
+			Transform2D(toOutside.data(), fieldWidth, fieldHeight);
+
+			// The transforms measure between texel centers, and the edge lies halfway between an
+			// inside and an outside texel.
+			float scale = 127.0f / spread;
+			for (int y = 0; y < fieldHeight; y++)
+			{
+				uint8_t* row = destination + size_t(y) * destinationPitch;
+				for (int x = 0; x < fieldWidth; x++)
+				{
+					size_t texel = size_t(y) * fieldWidth + x;
+					float distance = (toOutside[texel] > 0.0f) ? std::sqrt(toOutside[texel]) - 0.5f : 0.5f - std::sqrt(toInside[texel]);
+					float encoded = 128.0f + distance * scale;
+					row[x] = static_cast<uint8_t>((std::min)((std::max)(encoded, 0.0f), 255.0f) + 0.5f);
+				}
+			}
+		}
+	}
+}
@@ -0,0 +1,141 @@
+﻿#include "pch.h"
+#include "DistanceFieldFont.h"
+#include "Profiler.h"
+
+namespace
+{
+	// Glyphs are rasterized at this many pixels to the em. Larger sizes keep sharper corners,
+	// at the cost of atlas space.
+	const float RasterEmSize = 48.0f;
+	const uint32_t Spread = 6;
+	const uint32_t AtlasSize = 512;
+
+	const uint32_t FirstCharacter = 0x20;
+	const uint32_t LastCharacter = 0x7E;
+}
+
+DX::DistanceFieldFont::DistanceFieldFont(IDWriteFactory3* factory, const wchar_t* familyName, DWRITE_FONT_WEIGHT weight) :
+	m_atlas(AtlasSize, AtlasSize, RasterEmSize, Spread),
+	m_texture(SpriteBatch::NoTexture)
+{
+	DX_PROFILE_SCOPE("DistanceFieldFont::DistanceFieldFont");
+
+	winrt::com_ptr<IDWriteFontCollection> fontCollection;
+	winrt::check_hresult(factory->GetSystemFontCollection(fontCollection.put()));
+
+	// Fall back to the first family if the requested one isn't installed.
+	UINT32 familyIndex = 0;
+	BOOL exists = FALSE;
+	winrt::check_hresult(fontCollection->FindFamilyName(familyName, &familyIndex, &exists));
+	if (!exists)
+	{
+		familyIndex = 0;
+	}
+
+	winrt::com_ptr<IDWriteFontFamily> fontFamily;
+	winrt::check_hresult(fontCollection->GetFontFamily(familyIndex, fontFamily.put()));
+
+	winrt::com_ptr<IDWriteFont> font;
+	winrt::check_hresult(fontFamily->GetFirstMatchingFont(weight, DWRITE_FONT_STRETCH_NORMAL, DWRITE_FONT_STYLE_NORMAL, font.put()));
+
+	winrt::com_ptr<IDWriteFontFace> fontFace;
+	winrt::check_hresult(font->CreateFontFace(fontFace.put()));
+
+	DWRITE_FONT_METRICS fontMetrics;
+	fontFace->GetMetrics(&fontMetrics);
+	float designUnitsPerEm = static_cast<float>(fontMetrics.designUnitsPerEm);
+	m_atlas.SetLineMetrics(fontMetrics.ascent / designUnitsPerEm, (fontMetrics.descent + fontMetrics.lineGap) / designUnitsPerEm);
+
+	const uint32_t characterCount = LastCharacter - FirstCharacter + 1;
+	UINT32 codepoints[characterCount];
+	UINT16 glyphIndices[characterCount];
+	DWRITE_GLYPH_METRICS glyphMetrics[characterCount];
+	for (uint32_t i = 0; i < characterCount; i++)
+	{
+		codepoints[i] = FirstCharacter + i;
+	}
+	winrt::check_hresult(fontFace->GetGlyphIndices(codepoints, characterCount, glyphIndices));
+	winrt::check_hresult(fontFace->GetDesignGlyphMetrics(glyphIndices, characterCount, glyphMetrics, FALSE));
+
+	// Aliased coverage is all the distance transform uses, since it only asks whether a texel
+	// is inside the glyph.
+	IDWriteFactory* baseFactory = factory;
+	std::vector<uint8_t> coverage;
+	for (uint32_t i = 0; i < characterCount; i++)
+	{
+		float advance = glyphMetrics[i].advanceWidth * RasterEmSize / designUnitsPerEm;
+
+		FLOAT glyphAdvance = 0.0f;
+		DWRITE_GLYPH_OFFSET glyphOffset = {};
+		DWRITE_GLYPH_RUN glyphRun = {};
+		glyphRun.fontFace = fontFace.get();
+		glyphRun.fontEmSize = RasterEmSize;
+		glyphRun.glyphCount = 1;
+		glyphRun.glyphIndices = &glyphIndices[i];
+		glyphRun.glyphAdvances = &glyphAdvance;
+		glyphRun.glyphOffsets = &glyphOffset;
+
+		winrt::com_ptr<IDWriteGlyphRunAnalysis> analysis;
+		winrt::check_hresult(
+			baseFactory->CreateGlyphRunAnalysis(
+				&glyphRun,
+				1.0f,
+				nullptr,
+				DWRITE_RENDERING_MODE_ALIASED,
+				DWRITE_MEASURING_MODE_NATURAL,
+				0.0f,
+				0.0f,
+				analysis.put()));
+
+		RECT bounds;
+		winrt::check_hresult(analysis->GetAlphaTextureBounds(DWRITE_TEXTURE_ALIASED_1x1, &bounds));
+
+		DX::GlyphBitmap bitmap = {};
+		if (bounds.right > bounds.left && bounds.bottom > bounds.top)
+		{
+			bitmap.width = static_cast<uint32_t>(bounds.right - bounds.left);
+			bitmap.height = static_cast<uint32_t>(bounds.bottom - bounds.top);
+			bitmap.pitch = bitmap.width;
+			bitmap.left = bounds.left;
+			bitmap.top = bounds.top;
+
+			coverage.resize(size_t(bitmap.width) * bitmap.height);
+			winrt::check_hresult(analysis->CreateAlphaTexture(DWRITE_TEXTURE_ALIASED_1x1, &bounds, coverage.data(), static_cast<UINT32>(coverage.size())));
+			bitmap.coverage = coverage.data();
+		}
+
+		if (!m_atlas.AddGlyph(codepoints[i], advance, bitmap.coverage != nullptr ? &bitmap : nullptr))
+		{
+			// The atlas is too small for the font at RasterEmSize.
+			winrt::throw_hresult(E_NOT_SUFFICIENT_BUFFER);
+		}
+	}
+}
+
+void DX::DistanceFieldFont::CreateDeviceDependentResources(ID3D11Device3* device, SpriteRenderer& spriteRenderer)
+{
+	if (device->GetFeatureLevel() >= D3D_FEATURE_LEVEL_9_3)
+	{
+		const auto& pixels = m_atlas.GetPixels();
+		D3D11_SUBRESOURCE_DATA textureData = { pixels.data(), m_atlas.GetWidth(), 0 };
+		CD3D11_TEXTURE2D_DESC textureDesc(DXGI_FORMAT_R8_UNORM, m_atlas.GetWidth(), m_atlas.GetHeight(), 1, 1, D3D11_BIND_SHADER_RESOURCE, D3D11_USAGE_IMMUTABLE);
+
+		winrt::com_ptr<ID3D11Texture2D> texture;
+		winrt::check_hresult(device->CreateTexture2D(&textureDesc, &textureData, texture.put()));
+		winrt::check_hresult(device->CreateShaderResourceView(texture.get(), nullptr, m_view.put()));
+	}
+
+	if (m_texture == SpriteBatch::NoTexture)
+	{
+		m_texture = spriteRenderer.AddTexture(m_view.get(), SpriteTextureType::DistanceField);
+	}
+	else
+	{
+		spriteRenderer.SetTexture(m_texture, m_view.get());
+	}
+}
+
+void DX::DistanceFieldFont::ReleaseDeviceDependentResources()
+{
+	m_view = nullptr;
+}
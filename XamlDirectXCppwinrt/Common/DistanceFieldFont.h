@@ -0,0 +1,30 @@
+﻿#pragma once
+
+#include "GlyphAtlas.h"
+#include "SpriteRenderer.h"
+
+namespace DX
+{
+	// A system font's printable ASCII characters as a distance field glyph atlas, for overlay
+	// text drawn through the SpriteRenderer. The glyphs are rasterized once with DirectWrite, when
+	// the font is created; text in this font is then drawn at any size and DPI, and survives
+	// device loss, without rasterizing or laying out again.
+	class DistanceFieldFont
+	{
+	public:
+		DistanceFieldFont(IDWriteFactory3* factory, const wchar_t* familyName, DWRITE_FONT_WEIGHT weight);
+
+		// Uploads the atlas and registers it with the sprite renderer, as a distance field
+		// texture. On feature levels without the distance field shader there is nothing to upload.
+		void CreateDeviceDependentResources(ID3D11Device3* device, SpriteRenderer& spriteRenderer);
+		void ReleaseDeviceDependentResources();
+
+		const GlyphAtlas& GetAtlas() const				{ return m_atlas; }
+		SpriteBatch::TextureId GetTexture() const		{ return m_texture; }
+
+	private:
+		GlyphAtlas									m_atlas;
+		SpriteBatch::TextureId						m_texture;
+		winrt::com_ptr<ID3D11ShaderResourceView>	m_view;
+	};
+}
@@ -0,0 +1,212 @@
+﻿#include "pch.h"
+#include "DynamicResolution.h"
+
+DX::DynamicResolution::DynamicResolution(const std::shared_ptr<DeviceResources>& deviceResources, const ResolutionController::Settings& settings) :
+	m_deviceResources(deviceResources),
+	m_controller(settings),
+	m_scale(settings.maxScale),
+	m_frames(),
+	m_nextFrame(0),
+	m_pendingCount(0),
+	m_settlingFrames(0),
+	m_inFrame(false),
+	m_texture(SpriteBatch::NoTexture),
+	m_width(0),
+	m_height(0)
+{
+}
+
+// Creates the queries. A device that can't create them renders at full scale.
+void DX::DynamicResolution::CreateDeviceDependentResources()
+{
+	auto device = m_deviceResources->GetD3DDevice();
+	CD3D11_QUERY_DESC disjointDesc(D3D11_QUERY_TIMESTAMP_DISJOINT);
+	CD3D11_QUERY_DESC timestampDesc(D3D11_QUERY_TIMESTAMP);
+
+	for (auto& frame : m_frames)
+	{
+		if (FAILED(device->CreateQuery(&disjointDesc, frame.disjoint.put())) ||
+			FAILED(device->CreateQuery(&timestampDesc, frame.begin.put())) ||
+			FAILED(device->CreateQuery(&timestampDesc, frame.end.put())))
+		{
+			ReleaseDeviceDependentResources();
+			break;
+		}
+	}
+
+	// A new device may be a different GPU; start again from full scale.
+	m_controller.Reset();
+	m_scale = m_controller.GetScale();
+	m_nextFrame = 0;
+	m_pendingCount = 0;
+	m_settlingFrames = 0;
+	m_inFrame = false;
+}
+
+// The offscreen target is as large as the back buffer, so the scale can change from frame to
+// frame without creating it again.
+void DX::DynamicResolution::CreateWindowSizeDependentResources(SpriteRenderer& spriteRenderer)
+{
+	m_renderTargetView = nullptr;
+	m_view = nullptr;
+
+	const DisplayMetrics& metrics = m_deviceResources->GetDisplayMetrics();
+	m_width = static_cast<uint32_t>(metrics.renderTargetWidth);
+	m_height = static_cast<uint32_t>(metrics.renderTargetHeight);
+
+	if (m_frames[0].disjoint != nullptr && m_width > 0 && m_height > 0)
+	{
+		auto device = m_deviceResources->GetD3DDevice();
+		CD3D11_TEXTURE2D_DESC textureDesc(
+			DXGI_FORMAT_B8G8R8A8_UNORM,
+			m_width,
+			m_height,
+			1,
+			1,
+			D3D11_BIND_RENDER_TARGET | D3D11_BIND_SHADER_RESOURCE);
+
+		winrt::com_ptr<ID3D11Texture2D> texture;
+		winrt::check_hresult(device->CreateTexture2D(&textureDesc, nullptr, texture.put()));
+		winrt::check_hresult(device->CreateRenderTargetView(texture.get(), nullptr, m_renderTargetView.put()));
+		winrt::check_hresult(device->CreateShaderResourceView(texture.get(), nullptr, m_view.put()));
+	}
+
+	if (m_texture == SpriteBatch::NoTexture)
+	{
+		m_texture = spriteRenderer.AddTexture(m_view.get());
+	}
+	else
+	{
+		spriteRenderer.SetTexture(m_texture, m_view.get());
+	}
+}
+
+void DX::DynamicResolution::ReleaseDeviceDependentResources()
+{
+	for (auto& frame : m_frames)
+	{
+		frame.disjoint = nullptr;
+		frame.begin = nullptr;
+		frame.end = nullptr;
+	}
+
+	m_renderTargetView = nullptr;
+	m_view = nullptr;
+	m_pendingCount = 0;
+	m_inFrame = false;
+}
+
+bool DX::DynamicResolution::Update(ID3D11DeviceContext* context)
+{
+	// Frames finish in order, so stop at the first one that hasn't.
+	while (m_pendingCount > 0)
+	{
+		Frame& frame = m_frames[(m_nextFrame + FrameLatency - m_pendingCount) % FrameLatency];
+
+		D3D11_QUERY_DATA_TIMESTAMP_DISJOINT disjointData;
+		uint64_t frameBegin;
+		uint64_t frameEnd;
+		if (context->GetData(frame.disjoint.get(), &disjointData, sizeof(disjointData), D3D11_ASYNC_GETDATA_DONOTFLUSH) != S_OK ||
+			context->GetData(frame.begin.get(), &frameBegin, sizeof(frameBegin), D3D11_ASYNC_GETDATA_DONOTFLUSH) != S_OK ||
+			context->GetData(frame.end.get(), &frameEnd, sizeof(frameEnd), D3D11_ASYNC_GETDATA_DONOTFLUSH) != S_OK)
+		{
+			break;
+		}
+		m_pendingCount--;
+
+		// The GPU clock was unreliable while the frame ran, e.g. because its frequency changed.
+		if (disjointData.Disjoint)
+		{
+			continue;
+		}
+
+		float milliseconds = static_cast<float>(static_cast<double>(frameEnd - frameBegin) * 1000.0 / disjointData.Frequency);
+		m_controller.AddSample(milliseconds, frame.scale);
+	}
+
+	if (m_controller.GetScale() == m_scale)
+	{
+		return false;
+	}
+
+	m_scale = m_controller.GetScale();
+	m_settlingFrames = SettlingFrames;
+	return true;
+}
+
+void DX::DynamicResolution::BeginFrame(ID3D11DeviceContext* context)
+{
+	if (m_frames[0].disjoint == nullptr)
+	{
+		return;
+	}
+
+	if (m_settlingFrames > 0)
+	{
+		m_settlingFrames--;
+		return;
+	}
+
+	// Every query is still in flight. Skip this frame rather than wait.
+	if (m_pendingCount == FrameLatency)
+	{
+		return;
+	}
+
+	Frame& frame = m_frames[m_nextFrame];
+	frame.scale = m_scale;
+	context->Begin(frame.disjoint.get());
+	context->End(frame.begin.get());
+	m_inFrame = true;
+}
+
+void DX::DynamicResolution::EndFrame(ID3D11DeviceContext* context)
+{
+	if (!m_inFrame)
+	{
+		return;
+	}
+
+	Frame& frame = m_frames[m_nextFrame];
+	context->End(frame.end.get());
+	context->End(frame.disjoint.get());
+	m_nextFrame = (m_nextFrame + 1) % FrameLatency;
+	m_pendingCount++;
+	m_inFrame = false;
+}
+
+D3D11_VIEWPORT DX::DynamicResolution::GetViewport() const
+{
+	return CD3D11_VIEWPORT(
+		0.0f,
+		0.0f,
+		static_cast<float>(ResolutionController::ScaleSize(m_width, m_scale)),
+		static_cast<float>(ResolutionController::ScaleSize(m_height, m_scale)));
+}
+
+D3D11_RECT DX::DynamicResolution::ScaleRect(const D3D11_RECT& rect) const
+{
+	LONG width = static_cast<LONG>(ResolutionController::ScaleSize(m_width, m_scale));
+	LONG height = static_cast<LONG>(ResolutionController::ScaleSize(m_height, m_scale));
+
+	D3D11_RECT scaled;
+	scaled.left = (std::max)(static_cast<LONG>(std::floor(rect.left * m_scale)) - 1, 0L);
+	scaled.top = (std::max)(static_cast<LONG>(std::floor(rect.top * m_scale)) - 1, 0L);
+	scaled.right = (std::min)(static_cast<LONG>(std::ceil(rect.right * m_scale)) + 1, width);
+	scaled.bottom = (std::min)(static_cast<LONG>(std::ceil(rect.bottom * m_scale)) + 1, height);
+	return scaled;
+}
+
+// The source rectangle runs between the centers of the corner texels, so that filtering never
+// reads the texels just outside the scaled viewport, which hold nothing of this frame.
+void DX::DynamicResolution::DrawUpscale(SpriteBatch& batch) const
+{
+	float width = static_cast<float>(m_width);
+	float height = static_cast<float>(m_height);
+	float scaledWidth = static_cast<float>(ResolutionController::ScaleSize(m_width, m_scale));
+	float scaledHeight = static_cast<float>(ResolutionController::ScaleSize(m_height, m_scale));
+
+	SpriteRect destination = { 0.0f, 0.0f, width, height };
+	SpriteRect source = { 0.5f / width, 0.5f / height, (scaledWidth - 0.5f) / width, (scaledHeight - 0.5f) / height };
+	batch.DrawQuad(m_texture, destination, source, 0xFFFFFFFF);
+}
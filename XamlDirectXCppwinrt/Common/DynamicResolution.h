@@ -0,0 +1,86 @@
+﻿#pragma once
+
+#include "DeviceResources.h"
+#include "ResolutionController.h"
+#include "SpriteRenderer.h"
+
+namespace DX
+{
+	// Renders 3D content at a lower resolution when the GPU can't finish frames within a budget.
+	// The GPU time of each frame is measured with timestamp queries and read back frames later,
+	// without waiting; a ResolutionController turns the times into a scale for the next frames.
+	//
+	// While the scale is below one, the 3D content is drawn into the top left corner of an
+	// offscreen target the size of the back buffer, through a viewport and scissor rectangle
+	// scaled to match, and then drawn on the back buffer as a sprite, filtered bilinearly, under
+	// the overlays, which stay at full resolution. At full scale the content is drawn straight
+	// to the back buffer as before. The offscreen target shares the back buffer's depth buffer.
+	//
+	// Devices that can't measure GPU time, as some feature level 9_x devices can't, always
+	// render at full scale.
+	class DynamicResolution
+	{
+	public:
+		DynamicResolution(const std::shared_ptr<DeviceResources>& deviceResources, const ResolutionController::Settings& settings);
+		void CreateDeviceDependentResources();
+		void CreateWindowSizeDependentResources(SpriteRenderer& spriteRenderer);
+		void ReleaseDeviceDependentResources();
+
+		// Reads back the timings of finished frames and picks the scale of the next. Returns
+		// true if the scale changed, after which the offscreen target must be redrawn in full.
+		bool Update(ID3D11DeviceContext* context);
+
+		// Measure the GPU work issued between them. Frames redrawn in full because the scale
+		// just changed aren't typical of the content, and aren't measured.
+		void BeginFrame(ID3D11DeviceContext* context);
+		void EndFrame(ID3D11DeviceContext* context);
+
+		bool IsScaled() const							{ return m_scale < 1.0f && m_renderTargetView != nullptr; }
+		float GetScale() const							{ return m_scale; }
+		const ResolutionController& GetController() const	{ return m_controller; }
+		void SetTargetMilliseconds(float milliseconds)	{ m_controller.SetTargetMilliseconds(milliseconds); }
+
+		// Where to draw the 3D content while IsScaled.
+		ID3D11RenderTargetView* GetRenderTargetView() const	{ return m_renderTargetView.get(); }
+		D3D11_VIEWPORT GetViewport() const;
+
+		// A back buffer rectangle in the offscreen target, grown by a texel on every side so that
+		// it covers each texel that bilinear filtering reads for the pixels in the rectangle.
+		D3D11_RECT ScaleRect(const D3D11_RECT& rect) const;
+
+		// Adds the quad that draws the offscreen target on the whole back buffer.
+		void DrawUpscale(SpriteBatch& batch) const;
+
+	private:
+		// Number of frames in flight before their queries are read back.
+		static const uint32_t FrameLatency = 4;
+
+		// Frames redrawn in full after a change of scale, one for each swap chain buffer.
+		static const uint32_t SettlingFrames = 2;
+
+		struct Frame
+		{
+			winrt::com_ptr<ID3D11Query>		disjoint;
+			winrt::com_ptr<ID3D11Query>		begin;
+			winrt::com_ptr<ID3D11Query>		end;
+			float							scale;
+		};
+
+		std::shared_ptr<DeviceResources>			m_deviceResources;
+		ResolutionController						m_controller;
+		float										m_scale;
+
+		// A ring of frames: m_pendingCount frames ending just before m_nextFrame await readback.
+		Frame										m_frames[FrameLatency];
+		uint32_t									m_nextFrame;
+		uint32_t									m_pendingCount;
+		uint32_t									m_settlingFrames;
+		bool										m_inFrame;
+
+		winrt::com_ptr<ID3D11RenderTargetView>		m_renderTargetView;
+		winrt::com_ptr<ID3D11ShaderResourceView>	m_view;
+		SpriteBatch::TextureId						m_texture;
+		uint32_t									m_width;
+		uint32_t									m_height;
+	};
+}
@@ -0,0 +1,134 @@
+﻿#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+
+namespace DX
+{
+	// Decides when the render loop needs to produce a frame. In continuous mode every iteration
+	// of the loop renders, paced by vsync. In on-demand mode the loop sleeps until something
+	// invalidates the frame or a scheduled redraw deadline arrives.
+	class FrameScheduler
+	{
+	public:
+		using Clock = std::chrono::steady_clock;
+
+		FrameScheduler() :
+			m_continuous(true),
+			m_dirty(true),
+			m_wakeRequested(false),
+			m_hasDeadline(false),
+			m_wakeupCount(0),
+			m_frameCount(0)
+		{
+		}
+
+		FrameScheduler(const FrameScheduler&) = delete;
+		FrameScheduler& operator=(const FrameScheduler&) = delete;
+
+		// Set whether to render every iteration or only when invalidated.
+		void SetContinuous(bool continuous)
+		{
+			m_continuous.store(continuous, std::memory_order_relaxed);
+			Invalidate();
+		}
+
+		bool IsContinuous() const { return m_continuous.load(std::memory_order_relaxed); }
+
+		// Marks the next frame as needing to be drawn. May be called from any thread.
+		void Invalidate()
+		{
+			// Only the first invalidation since the last frame needs to signal the loop.
+			if (!m_dirty.exchange(true, std::memory_order_acq_rel))
+			{
+				std::lock_guard<std::mutex> lock(m_mutex);
+				m_condition.notify_one();
+			}
+		}
+
+		// Requests a redraw no later than the specified time. Animations that only need to change
+		// at known times use this instead of invalidating every frame. The earliest deadline wins.
+		void ScheduleRedraw(Clock::time_point deadline)
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+			if (!m_hasDeadline || deadline < m_deadline)
+			{
+				m_deadline = deadline;
+				m_hasDeadline = true;
+				m_condition.notify_one();
+			}
+		}
+
+		// Wakes a waiting render loop without requesting a frame, e.g. so it can observe a stop request.
+		void Wake()
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+			m_wakeRequested = true;
+			m_condition.notify_one();
+		}
+
+		// Called by the render loop before each frame. Blocks while there is nothing to draw and
+		// returns true if a frame should be rendered, or false if the loop was only woken up.
+		bool WaitForFrame()
+		{
+			if (m_continuous.load(std::memory_order_relaxed))
+			{
+				m_dirty.store(false, std::memory_order_relaxed);
+				m_frameCount++;
+				return true;
+			}
+
+			std::unique_lock<std::mutex> lock(m_mutex);
+
+			while (!m_dirty.load(std::memory_order_acquire) && !m_wakeRequested)
+			{
+				if (m_hasDeadline)
+				{
+					if (Clock::now() >= m_deadline)
+					{
+						m_hasDeadline = false;
+						m_dirty.store(true, std::memory_order_relaxed);
+						break;
+					}
+					m_condition.wait_until(lock, m_deadline);
+				}
+				else
+				{
+					m_condition.wait(lock);
+				}
+				m_wakeupCount++;
+			}
+
+			m_wakeRequested = false;
+			if (!m_dirty.exchange(false, std::memory_order_acq_rel))
+			{
+				return false;
+			}
+
+			m_frameCount++;
+			return true;
+		}
+
+		// Number of times the loop woke from a wait, including spurious and deadline wakeups.
+		uint64_t GetWakeupCount() const { return m_wakeupCount; }
+
+		// Number of frames the scheduler has allowed the loop to render.
+		uint64_t GetFrameCount() const { return m_frameCount; }
+
+	private:
+		std::mutex				m_mutex;
+		std::condition_variable	m_condition;
+		std::atomic<bool>		m_continuous;
+		std::atomic<bool>		m_dirty;
+		bool					m_wakeRequested;
+		bool					m_hasDeadline;
+		Clock::time_point		m_deadline;
+
+		// Statistics, only touched by the render loop.
+		uint64_t				m_wakeupCount;
+		uint64_t				m_frameCount;
+	};
+}
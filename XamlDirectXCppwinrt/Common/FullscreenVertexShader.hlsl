@@ -0,0 +1,14 @@
+struct PixelShaderInput
+{
+	float4 pos : SV_POSITION;
+};
+
+// Draws one triangle that covers the viewport, from three vertices with no vertex buffer.
+PixelShaderInput main(uint id : SV_VertexID)
+{
+	float2 uv = float2((id << 1) & 2, id & 2);
+
+	PixelShaderInput output;
+	output.pos = float4(uv * float2(2.0f, -2.0f) + float2(-1.0f, 1.0f), 0.0f, 1.0f);
+	return output;
+}
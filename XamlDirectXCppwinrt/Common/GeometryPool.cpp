@@ -0,0 +1,227 @@
+﻿#include "pch.h"
+#include "GeometryPool.h"
+#include "Profiler.h"
+
+#include <unordered_map>
+
+DX::GeometryPool::GeometryPool(uint32_t vertexStride, uint32_t vertexCapacity, uint32_t indexCapacity) :
+	m_vertexStride(vertexStride),
+	m_vertexCapacity(vertexCapacity),
+	m_indexCapacity(indexCapacity),
+	m_vertexAllocator(vertexCapacity),
+	m_indexAllocator(indexCapacity)
+{
+}
+
+void DX::GeometryPool::CreateDeviceDependentResources(ID3D11Device3* device)
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	m_device.copy_from(device);
+	CreateBuffers(device, m_vertexBuffer, m_indexBuffer);
+}
+
+// Every mesh is lost along with the device. Renderers add theirs again when they recreate
+// their device dependent resources.
+void DX::GeometryPool::ReleaseDeviceDependentResources()
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	m_device = nullptr;
+	m_vertexBuffer = nullptr;
+	m_indexBuffer = nullptr;
+	m_vertexAllocator.Reset(m_vertexCapacity);
+	m_indexAllocator.Reset(m_indexCapacity);
+	m_meshes.clear();
+	m_freeMeshes.clear();
+	m_pendingUploads.clear();
+}
+
+void DX::GeometryPool::CreateBuffers(ID3D11Device3* device, winrt::com_ptr<ID3D11Buffer>& vertexBuffer, winrt::com_ptr<ID3D11Buffer>& indexBuffer) const
+{
+	CD3D11_BUFFER_DESC vertexBufferDesc(m_vertexCapacity * m_vertexStride, D3D11_BIND_VERTEX_BUFFER);
+	winrt::check_hresult(
+		device->CreateBuffer(
+			&vertexBufferDesc,
+			nullptr,
+			vertexBuffer.put()));
+
+	CD3D11_BUFFER_DESC indexBufferDesc(m_indexCapacity * sizeof(uint16_t), D3D11_BIND_INDEX_BUFFER);
+	winrt::check_hresult(
+		device->CreateBuffer(
+			&indexBufferDesc,
+			nullptr,
+			indexBuffer.put()));
+}
+
+// Reserves space for a mesh and queues its data for upload. Throws if the pool is full.
+DX::GeometryPool::MeshHandle DX::GeometryPool::AddMesh(const void* vertices, uint32_t vertexCount, const uint16_t* indices, uint32_t indexCount)
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+
+	uint32_t vertexOffset = m_vertexAllocator.Allocate(vertexCount);
+	if (vertexOffset == RangeAllocator::InvalidOffset)
+	{
+		winrt::throw_hresult(E_OUTOFMEMORY);
+	}
+
+	uint32_t indexOffset = m_indexAllocator.Allocate(indexCount);
+	if (indexOffset == RangeAllocator::InvalidOffset)
+	{
+		m_vertexAllocator.Free(vertexOffset);
+		winrt::throw_hresult(E_OUTOFMEMORY);
+	}
+
+	MeshHandle mesh;
+	if (!m_freeMeshes.empty())
+	{
+		mesh = m_freeMeshes.back();
+		m_freeMeshes.pop_back();
+	}
+	else
+	{
+		mesh = static_cast<MeshHandle>(m_meshes.size());
+		m_meshes.emplace_back();
+	}
+
+	m_meshes[mesh] = { vertexOffset, vertexCount, indexOffset, indexCount, true };
+
+	PendingUpload upload;
+	upload.mesh = mesh;
+	upload.vertices.assign(
+		static_cast<const uint8_t*>(vertices),
+		static_cast<const uint8_t*>(vertices) + static_cast<size_t>(vertexCount) * m_vertexStride);
+	upload.indices.assign(indices, indices + indexCount);
+	m_pendingUploads.push_back(std::move(upload));
+
+	return mesh;
+}
+
+void DX::GeometryPool::RemoveMesh(MeshHandle mesh)
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	if (mesh >= m_meshes.size() || !m_meshes[mesh].inUse)
+	{
+		return;
+	}
+
+	m_vertexAllocator.Free(m_meshes[mesh].vertexOffset);
+	m_indexAllocator.Free(m_meshes[mesh].indexOffset);
+	m_meshes[mesh].inUse = false;
+	m_freeMeshes.push_back(mesh);
+
+	std::erase_if(m_pendingUploads, [mesh](const PendingUpload& upload) { return upload.mesh == mesh; });
+}
+
+// The range changes when the pool is compacted, so look it up again each frame.
+DX::MeshRange DX::GeometryPool::GetMeshRange(MeshHandle mesh)
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	const Mesh& entry = m_meshes[mesh];
+	return { entry.indexCount, entry.indexOffset, static_cast<int32_t>(entry.vertexOffset) };
+}
+
+void DX::GeometryPool::Flush(ID3D11DeviceContext3* context)
+{
+	DX_PROFILE_SCOPE("GeometryPool::Flush");
+	std::lock_guard<std::mutex> lock(m_mutex);
+
+	if (m_vertexBuffer == nullptr)
+	{
+		return;
+	}
+
+	for (const auto& upload : m_pendingUploads)
+	{
+		const Mesh& mesh = m_meshes[upload.mesh];
+
+		D3D11_BOX vertexBox = CD3D11_BOX(mesh.vertexOffset * m_vertexStride, 0, 0, (mesh.vertexOffset + mesh.vertexCount) * m_vertexStride, 1, 1);
+		context->UpdateSubresource(m_vertexBuffer.get(), 0, &vertexBox, upload.vertices.data(), 0, 0);
+
+		D3D11_BOX indexBox = CD3D11_BOX(mesh.indexOffset * sizeof(uint16_t), 0, 0, (mesh.indexOffset + mesh.indexCount) * sizeof(uint16_t), 1, 1);
+		context->UpdateSubresource(m_indexBuffer.get(), 0, &indexBox, upload.indices.data(), 0, 0);
+	}
+	m_pendingUploads.clear();
+
+	if (m_vertexAllocator.GetStats().fragmentation > MaxFragmentation ||
+		m_indexAllocator.GetStats().fragmentation > MaxFragmentation)
+	{
+		Compact(context);
+	}
+}
+
+void DX::GeometryPool::Defragment(ID3D11DeviceContext3* context)
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	if (m_vertexBuffer != nullptr)
+	{
+		Compact(context);
+	}
+}
+
+// Packs every mesh to the start of a new pair of buffers, leaving all free space in one range.
+// The GPU copies the data, so nothing is read back. Must be called with m_mutex held.
+void DX::GeometryPool::Compact(ID3D11DeviceContext3* context)
+{
+	DX_PROFILE_SCOPE("GeometryPool::Compact");
+
+	std::unordered_map<uint32_t, uint32_t> vertexMoves;
+	for (const auto& move : m_vertexAllocator.Defragment())
+	{
+		vertexMoves.emplace(move.oldOffset, move.newOffset);
+	}
+
+	std::unordered_map<uint32_t, uint32_t> indexMoves;
+	for (const auto& move : m_indexAllocator.Defragment())
+	{
+		indexMoves.emplace(move.oldOffset, move.newOffset);
+	}
+
+	// Source and destination regions of a copy may not overlap within one buffer, so copy into
+	// new buffers rather than moving the data in place.
+	winrt::com_ptr<ID3D11Buffer> vertexBuffer;
+	winrt::com_ptr<ID3D11Buffer> indexBuffer;
+	CreateBuffers(m_device.get(), vertexBuffer, indexBuffer);
+
+	for (auto& mesh : m_meshes)
+	{
+		if (!mesh.inUse)
+		{
+			continue;
+		}
+
+		auto vertexMove = vertexMoves.find(mesh.vertexOffset);
+		uint32_t vertexOffset = (vertexMove != vertexMoves.end()) ? vertexMove->second : mesh.vertexOffset;
+		D3D11_BOX vertexBox = CD3D11_BOX(mesh.vertexOffset * m_vertexStride, 0, 0, (mesh.vertexOffset + mesh.vertexCount) * m_vertexStride, 1, 1);
+		context->CopySubresourceRegion(vertexBuffer.get(), 0, vertexOffset * m_vertexStride, 0, 0, m_vertexBuffer.get(), 0, &vertexBox);
+		mesh.vertexOffset = vertexOffset;
+
+		auto indexMove = indexMoves.find(mesh.indexOffset);
+		uint32_t indexOffset = (indexMove != indexMoves.end()) ? indexMove->second : mesh.indexOffset;
+		D3D11_BOX indexBox = CD3D11_BOX(mesh.indexOffset * sizeof(uint16_t), 0, 0, (mesh.indexOffset + mesh.indexCount) * sizeof(uint16_t), 1, 1);
+		context->CopySubresourceRegion(indexBuffer.get(), 0, indexOffset * sizeof(uint16_t), 0, 0, m_indexBuffer.get(), 0, &indexBox);
+		mesh.indexOffset = indexOffset;
+	}
+
+	m_vertexBuffer = vertexBuffer;
+	m_indexBuffer = indexBuffer;
+}
+
+void DX::GeometryPool::Bind(ID3D11DeviceContext3& context) const
+{
+	UINT stride = m_vertexStride;
+	UINT offset = 0;
+	ID3D11Buffer* vertexBufferNoRef = m_vertexBuffer.get();
+	context.IASetVertexBuffers(0, 1, &vertexBufferNoRef, &stride, &offset);
+	context.IASetIndexBuffer(m_indexBuffer.get(), DXGI_FORMAT_R16_UINT, 0);
+}
+
+DX::RangeAllocator::Stats DX::GeometryPool::GetVertexStats()
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	return m_vertexAllocator.GetStats();
+}
+
+DX::RangeAllocator::Stats DX::GeometryPool::GetIndexStats()
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	return m_indexAllocator.GetStats();
+}
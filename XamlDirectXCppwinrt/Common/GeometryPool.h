@@ -0,0 +1,85 @@
+﻿#pragma once
+
+#include <mutex>
+#include "RangeAllocator.h"
+
+namespace DX
+{
+	// Where a mesh lives in the pool's shared buffers. Pass these to DrawIndexed.
+	struct MeshRange
+	{
+		uint32_t	indexCount;
+		uint32_t	startIndex;
+		int32_t		baseVertex;
+	};
+
+	// Holds static meshes in one large vertex buffer and one large index buffer, so that every
+	// mesh drawn from the pool shares the same input assembler bindings and draws differ only by
+	// their start index and base vertex. Indices are 16-bit and relative to each mesh's first
+	// vertex. Meshes may be added from any thread; their data reaches the GPU the next time the
+	// render thread calls Flush.
+	class GeometryPool
+	{
+	public:
+		using MeshHandle = uint32_t;
+		static const MeshHandle InvalidMesh = UINT32_MAX;
+
+		GeometryPool(uint32_t vertexStride, uint32_t vertexCapacity, uint32_t indexCapacity);
+		void CreateDeviceDependentResources(ID3D11Device3* device);
+		void ReleaseDeviceDependentResources();
+
+		MeshHandle AddMesh(const void* vertices, uint32_t vertexCount, const uint16_t* indices, uint32_t indexCount);
+		void RemoveMesh(MeshHandle mesh);
+		MeshRange GetMeshRange(MeshHandle mesh);
+
+		// Called by the render thread before drawing. Uploads newly added meshes, and compacts
+		// the buffers once free space has become too fragmented.
+		void Flush(ID3D11DeviceContext3* context);
+		void Defragment(ID3D11DeviceContext3* context);
+
+		// Binds the shared buffers. Safe to call from worker threads while recording.
+		void Bind(ID3D11DeviceContext3& context) const;
+
+		RangeAllocator::Stats GetVertexStats();
+		RangeAllocator::Stats GetIndexStats();
+
+		// Free space fragmentation at which Flush compacts the buffers.
+		static constexpr float MaxFragmentation = 0.5f;
+
+	private:
+		struct Mesh
+		{
+			uint32_t	vertexOffset;
+			uint32_t	vertexCount;
+			uint32_t	indexOffset;
+			uint32_t	indexCount;
+			bool		inUse;
+		};
+
+		struct PendingUpload
+		{
+			MeshHandle				mesh;
+			std::vector<uint8_t>	vertices;
+			std::vector<uint16_t>	indices;
+		};
+
+		void CreateBuffers(ID3D11Device3* device, winrt::com_ptr<ID3D11Buffer>& vertexBuffer, winrt::com_ptr<ID3D11Buffer>& indexBuffer) const;
+		void Compact(ID3D11DeviceContext3* context);
+
+		uint32_t								m_vertexStride;
+		uint32_t								m_vertexCapacity;
+		uint32_t								m_indexCapacity;
+
+		winrt::com_ptr<ID3D11Device3>			m_device;
+		winrt::com_ptr<ID3D11Buffer>			m_vertexBuffer;
+		winrt::com_ptr<ID3D11Buffer>			m_indexBuffer;
+
+		// Guards everything below, which is shared with threads that add or remove meshes.
+		std::mutex								m_mutex;
+		RangeAllocator							m_vertexAllocator;
+		RangeAllocator							m_indexAllocator;
+		std::vector<Mesh>						m_meshes;
+		std::vector<MeshHandle>					m_freeMeshes;
+		std::vector<PendingUpload>				m_pendingUploads;
+	};
+}
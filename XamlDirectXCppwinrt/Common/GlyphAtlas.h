@@ -0,0 +1,201 @@
+﻿#pragma once
+
+#include "DistanceField.h"
+#include "SkylinePacker.h"
+#include "SpriteBatch.h"
+
+#include <cstdint>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+namespace DX
+{
+	// A glyph rasterized at the atlas's em size, as 8-bit coverage. left and top place the
+	// bitmap's top left corner relative to the pen position on the baseline, y down.
+	struct GlyphBitmap
+	{
+		const uint8_t*	coverage;
+		uint32_t		width;
+		uint32_t		height;
+		uint32_t		pitch;
+		int32_t			left;
+		int32_t			top;
+	};
+
+	// Where a glyph is in the atlas, in texture coordinates, and where to draw it relative to the
+	// pen position on the baseline, in ems. Blank glyphs such as spaces only have an advance.
+	struct Glyph
+	{
+		SpriteRect	texture;
+		SpriteRect	bounds;
+		float		advance;
+		bool		blank;
+	};
+
+	// A line of text laid out in ems, independent of the size it is drawn at.
+	struct TextLayout
+	{
+		struct Item
+		{
+			const Glyph*	glyph;
+			float			x;		// Pen position from the start of the line.
+		};
+
+		std::vector<Item>	glyphs;
+		float				width = 0.0f;
+	};
+
+	// Distance fields of a font's glyphs, packed into one single-channel texture. Glyphs are
+	// rasterized once at a fixed em size and drawn at any size from the distance field, so text
+	// needs neither new rasterization nor new layout when the DPI or the zoom changes: a layout
+	// made once is drawn at a different size. The atlas has no knowledge of the graphics API or
+	// of the rasterizer; see DistanceFieldFont for both.
+	class GlyphAtlas
+	{
+	public:
+		// spread is how far, in texels at emSize, distances are measured outside and inside each
+		// glyph. It bounds how much the glyphs can be scaled down before their edges blur into
+		// each other, and how wide effects such as outlines can be.
+		GlyphAtlas(uint32_t width, uint32_t height, float emSize, uint32_t spread) :
+			m_width(width),
+			m_height(height),
+			m_emSize(emSize),
+			m_spread(spread),
+			m_ascent(0.8f),
+			m_descent(0.2f),
+			m_packer(width, height),
+			m_pixels(size_t(width) * height, 0)
+		{
+		}
+
+		// Line metrics in ems, from the top of the line box to the baseline and from the baseline
+		// to its bottom.
+		void SetLineMetrics(float ascent, float descent)
+		{
+			m_ascent = ascent;
+			m_descent = descent;
+		}
+
+		// Adds a glyph, with its advance in pixels at the em size. A null bitmap, or one with no
+		// texels, adds a blank glyph. Returns false if the atlas is full.
+		bool AddGlyph(uint32_t codepoint, float advance, const GlyphBitmap* bitmap)
+		{
+			Glyph glyph = {};
+			glyph.advance = advance / m_emSize;
+			glyph.blank = true;
+
+			if (bitmap != nullptr && bitmap->width > 0 && bitmap->height > 0)
+			{
+				// A texel of padding keeps bilinear filtering from reaching into the neighbours.
+				uint32_t fieldWidth = bitmap->width + m_spread * 2;
+				uint32_t fieldHeight = bitmap->height + m_spread * 2;
+				uint32_t x, y;
+				if (!m_packer.Pack(fieldWidth + 1, fieldHeight + 1, &x, &y))
+				{
+					return false;
+				}
+
+				DistanceField::Generate(bitmap->coverage, bitmap->width, bitmap->height, bitmap->pitch, m_spread, m_pixels.data() + size_t(y) * m_width + x, m_width);
+
+				glyph.texture.left = float(x) / m_width;
+				glyph.texture.top = float(y) / m_height;
+				glyph.texture.right = float(x + fieldWidth) / m_width;
+				glyph.texture.bottom = float(y + fieldHeight) / m_height;
+				glyph.bounds.left = (bitmap->left - float(m_spread)) / m_emSize;
+				glyph.bounds.top = (bitmap->top - float(m_spread)) / m_emSize;
+				glyph.bounds.right = glyph.bounds.left + fieldWidth / m_emSize;
+				glyph.bounds.bottom = glyph.bounds.top + fieldHeight / m_emSize;
+				glyph.blank = false;
+			}
+
+			if (codepoint < AsciiCount)
+			{
+				m_ascii[codepoint] = glyph;
+				m_hasAscii[codepoint] = true;
+			}
+			else
+			{
+				m_glyphs[codepoint] = glyph;
+			}
+			return true;
+		}
+
+		const Glyph* FindGlyph(uint32_t codepoint) const
+		{
+			if (codepoint < AsciiCount)
+			{
+				return m_hasAscii[codepoint] ? &m_ascii[codepoint] : nullptr;
+			}
+
+			auto glyph = m_glyphs.find(codepoint);
+			return glyph != m_glyphs.end() ? &glyph->second : nullptr;
+		}
+
+		// Lays out one line of text. Characters the atlas doesn't have are drawn as '?', if it
+		// has that. Each UTF-16 unit is treated as one character, so text must be in the Basic
+		// Multilingual Plane.
+		void LayoutText(std::wstring_view text, TextLayout* layout) const
+		{
+			layout->glyphs.clear();
+			const Glyph* fallback = FindGlyph(L'?');
+
+			float x = 0.0f;
+			for (wchar_t character : text)
+			{
+				const Glyph* glyph = FindGlyph(static_cast<uint32_t>(character));
+				if (glyph == nullptr && (glyph = fallback) == nullptr)
+				{
+					continue;
+				}
+
+				if (!glyph->blank)
+				{
+					layout->glyphs.push_back({ glyph, x });
+				}
+				x += glyph->advance;
+			}
+			layout->width = x;
+		}
+
+		// Draws a layout with its line box's top left corner at (x, y), size units to the em.
+		// texture is the number the atlas's texture was given in the sprite renderer.
+		void DrawLayout(SpriteBatch& batch, SpriteBatch::TextureId texture, const TextLayout& layout, float x, float y, float size, uint32_t color, uint16_t layer = 0) const
+		{
+			float baseline = y + m_ascent * size;
+			for (const TextLayout::Item& item : layout.glyphs)
+			{
+				const SpriteRect& bounds = item.glyph->bounds;
+				float penX = x + item.x * size;
+				SpriteRect destination = { penX + bounds.left * size, baseline + bounds.top * size, penX + bounds.right * size, baseline + bounds.bottom * size };
+				batch.DrawQuad(texture, destination, item.glyph->texture, color, layer);
+			}
+		}
+
+		uint32_t GetWidth() const						{ return m_width; }
+		uint32_t GetHeight() const						{ return m_height; }
+		float GetEmSize() const							{ return m_emSize; }
+		float GetAscent() const							{ return m_ascent; }
+		float GetDescent() const						{ return m_descent; }
+		float GetLineHeight() const						{ return m_ascent + m_descent; }
+		float GetOccupancy() const						{ return m_packer.GetOccupancy(); }
+
+		// The distance field texels, one byte each, in rows of GetWidth() bytes.
+		const std::vector<uint8_t>& GetPixels() const	{ return m_pixels; }
+
+	private:
+		static const uint32_t AsciiCount = 128;
+
+		uint32_t						m_width;
+		uint32_t						m_height;
+		float							m_emSize;
+		uint32_t						m_spread;
+		float							m_ascent;
+		float							m_descent;
+		SkylinePacker					m_packer;
+		std::vector<uint8_t>			m_pixels;
+		Glyph							m_ascii[AsciiCount] = {};
+		bool							m_hasAscii[AsciiCount] = {};
+		std::unordered_map<uint32_t, Glyph>	m_glyphs;
+	};
+}
@@ -0,0 +1,170 @@
+﻿#include "pch.h"
+#include "GpuProfiler.h"
+
+DX::GpuProfiler::GpuProfiler() :
+	m_frames(),
+	m_currentFrame(0),
+	m_inFrame(false),
+	m_lastFrameMilliseconds(0.0)
+{
+}
+
+// Creates every query up front so that profiling doesn't allocate while rendering.
+void DX::GpuProfiler::CreateDeviceDependentResources(ID3D11Device* device)
+{
+	CD3D11_QUERY_DESC disjointDesc(D3D11_QUERY_TIMESTAMP_DISJOINT);
+	CD3D11_QUERY_DESC timestampDesc(D3D11_QUERY_TIMESTAMP);
+
+	for (auto& frame : m_frames)
+	{
+		winrt::check_hresult(device->CreateQuery(&disjointDesc, frame.disjoint.put()));
+		winrt::check_hresult(device->CreateQuery(&timestampDesc, frame.begin.put()));
+		winrt::check_hresult(device->CreateQuery(&timestampDesc, frame.end.put()));
+
+		for (auto& zone : frame.zones)
+		{
+			winrt::check_hresult(device->CreateQuery(&timestampDesc, zone.begin.put()));
+			winrt::check_hresult(device->CreateQuery(&timestampDesc, zone.end.put()));
+		}
+
+		frame.zoneCount = 0;
+		frame.pending = false;
+	}
+
+	m_currentFrame = 0;
+	m_inFrame = false;
+}
+
+void DX::GpuProfiler::ReleaseDeviceDependentResources()
+{
+	for (auto& frame : m_frames)
+	{
+		frame.disjoint = nullptr;
+		frame.begin = nullptr;
+		frame.end = nullptr;
+
+		for (auto& zone : frame.zones)
+		{
+			zone.begin = nullptr;
+			zone.end = nullptr;
+		}
+
+		frame.pending = false;
+	}
+
+	m_inFrame = false;
+}
+
+void DX::GpuProfiler::BeginFrame(ID3D11DeviceContext* context)
+{
+	Frame& frame = m_frames[m_currentFrame];
+	if (frame.disjoint == nullptr)
+	{
+		return;
+	}
+
+	// The queries in this slot were issued FrameLatency frames ago. If the GPU still hasn't
+	// finished with them, drop their results rather than wait.
+	if (frame.pending)
+	{
+		ReadBackFrame(context, frame);
+		frame.pending = false;
+	}
+
+	frame.zoneCount = 0;
+	frame.cpuStartNanoseconds = Profiler::Get().Now();
+
+	context->Begin(frame.disjoint.get());
+	context->End(frame.begin.get());
+	m_inFrame = true;
+}
+
+void DX::GpuProfiler::EndFrame(ID3D11DeviceContext* context)
+{
+	if (!m_inFrame)
+	{
+		return;
+	}
+
+	Frame& frame = m_frames[m_currentFrame];
+	context->End(frame.end.get());
+	context->End(frame.disjoint.get());
+	frame.pending = true;
+	m_inFrame = false;
+
+	m_currentFrame = (m_currentFrame + 1) % FrameLatency;
+}
+
+uint32_t DX::GpuProfiler::BeginZone(ID3D11DeviceContext* context, const char* name)
+{
+	Frame& frame = m_frames[m_currentFrame];
+	if (!m_inFrame || frame.zoneCount == MaxZonesPerFrame)
+	{
+		return InvalidZone;
+	}
+
+	uint32_t index = frame.zoneCount++;
+	frame.zones[index].name = name;
+	context->End(frame.zones[index].begin.get());
+	return index;
+}
+
+void DX::GpuProfiler::EndZone(ID3D11DeviceContext* context, uint32_t zone)
+{
+	if (!m_inFrame || zone == InvalidZone)
+	{
+		return;
+	}
+
+	context->End(m_frames[m_currentFrame].zones[zone].end.get());
+}
+
+// Reads the results of a finished frame without blocking. Returns false if they aren't
+// available yet or the GPU clock was unreliable while the frame ran.
+bool DX::GpuProfiler::ReadBackFrame(ID3D11DeviceContext* context, Frame& frame)
+{
+	D3D11_QUERY_DATA_TIMESTAMP_DISJOINT disjointData;
+	if (context->GetData(frame.disjoint.get(), &disjointData, sizeof(disjointData), D3D11_ASYNC_GETDATA_DONOTFLUSH) != S_OK ||
+		disjointData.Disjoint)
+	{
+		return false;
+	}
+
+	auto getTimestamp = [&](ID3D11Query* query, uint64_t& timestamp)
+	{
+		return context->GetData(query, &timestamp, sizeof(timestamp), D3D11_ASYNC_GETDATA_DONOTFLUSH) == S_OK;
+	};
+
+	uint64_t frameBegin;
+	uint64_t frameEnd;
+	if (!getTimestamp(frame.begin.get(), frameBegin) || !getTimestamp(frame.end.get(), frameEnd))
+	{
+		return false;
+	}
+
+	// GPU timestamps have their own clock. Place them on the CPU timeline by assuming the frame
+	// started on the GPU when its commands were issued; relative timings within it are exact.
+	auto toNanoseconds = [&](uint64_t ticks)
+	{
+		return static_cast<uint64_t>(static_cast<double>(ticks) * 1'000'000'000.0 / disjointData.Frequency);
+	};
+
+	Profiler& profiler = Profiler::Get();
+	profiler.RecordGpu("GPU Frame", frame.cpuStartNanoseconds, toNanoseconds(frameEnd - frameBegin));
+	m_lastFrameMilliseconds = static_cast<double>(frameEnd - frameBegin) * 1000.0 / disjointData.Frequency;
+
+	for (uint32_t i = 0; i < frame.zoneCount; i++)
+	{
+		uint64_t zoneBegin;
+		uint64_t zoneEnd;
+		if (getTimestamp(frame.zones[i].begin.get(), zoneBegin) && getTimestamp(frame.zones[i].end.get(), zoneEnd))
+		{
+			profiler.RecordGpu(
+				frame.zones[i].name,
+				frame.cpuStartNanoseconds + toNanoseconds(zoneBegin - frameBegin),
+				toNanoseconds(zoneEnd - zoneBegin));
+		}
+	}
+
+	return true;
+}
@@ -0,0 +1,114 @@
+﻿#pragma once
+
+#include "Profiler.h"
+
+#if defined(DX_ENABLE_PROFILER)
+#define DX_PROFILE_GPU_FRAME(profiler, context)			DX::GpuProfileFrame DX_PROFILE_CONCAT(gpuProfileFrame, __LINE__)(profiler, context)
+#define DX_PROFILE_GPU_SCOPE(profiler, context, name)	DX::GpuProfileScope DX_PROFILE_CONCAT(gpuProfileScope, __LINE__)(profiler, context, name)
+#else
+#define DX_PROFILE_GPU_FRAME(profiler, context)			((void)0)
+#define DX_PROFILE_GPU_SCOPE(profiler, context, name)	((void)0)
+#endif
+
+namespace DX
+{
+	// Measures the GPU time spent in named zones using Direct3D timestamp queries. Queries are
+	// read back several frames after they were issued so the CPU never waits on the GPU, and
+	// the results are forwarded to the Profiler on its GPU timeline.
+	class GpuProfiler
+	{
+	public:
+		GpuProfiler();
+		void CreateDeviceDependentResources(ID3D11Device* device);
+		void ReleaseDeviceDependentResources();
+
+		void BeginFrame(ID3D11DeviceContext* context);
+		void EndFrame(ID3D11DeviceContext* context);
+		uint32_t BeginZone(ID3D11DeviceContext* context, const char* name);
+		void EndZone(ID3D11DeviceContext* context, uint32_t zone);
+
+		// GPU time of the most recent frame whose results have been read back, in milliseconds.
+		double GetLastFrameMilliseconds() const { return m_lastFrameMilliseconds; }
+
+		static const uint32_t InvalidZone = UINT32_MAX;
+
+	private:
+		// Number of frames in flight before their queries are read back.
+		static const uint32_t FrameLatency = 4;
+		static const uint32_t MaxZonesPerFrame = 32;
+
+		struct Zone
+		{
+			const char*						name;
+			winrt::com_ptr<ID3D11Query>		begin;
+			winrt::com_ptr<ID3D11Query>		end;
+		};
+
+		struct Frame
+		{
+			winrt::com_ptr<ID3D11Query>		disjoint;
+			winrt::com_ptr<ID3D11Query>		begin;
+			winrt::com_ptr<ID3D11Query>		end;
+			Zone							zones[MaxZonesPerFrame];
+			uint32_t						zoneCount;
+			uint64_t						cpuStartNanoseconds;
+			bool							pending;
+		};
+
+		bool ReadBackFrame(ID3D11DeviceContext* context, Frame& frame);
+
+		Frame		m_frames[FrameLatency];
+		uint32_t	m_currentFrame;
+		bool		m_inFrame;
+		double		m_lastFrameMilliseconds;
+	};
+
+	// Issues the frame-level queries for the lifetime of a block. Use through DX_PROFILE_GPU_FRAME.
+	class GpuProfileFrame
+	{
+	public:
+		GpuProfileFrame(GpuProfiler& profiler, ID3D11DeviceContext* context) :
+			m_profiler(profiler),
+			m_context(context)
+		{
+			m_profiler.BeginFrame(m_context);
+		}
+
+		~GpuProfileFrame()
+		{
+			m_profiler.EndFrame(m_context);
+		}
+
+		GpuProfileFrame(const GpuProfileFrame&) = delete;
+		GpuProfileFrame& operator=(const GpuProfileFrame&) = delete;
+
+	private:
+		GpuProfiler&			m_profiler;
+		ID3D11DeviceContext*	m_context;
+	};
+
+	// Measures the GPU work issued during the lifetime of a block. Use through DX_PROFILE_GPU_SCOPE.
+	class GpuProfileScope
+	{
+	public:
+		GpuProfileScope(GpuProfiler& profiler, ID3D11DeviceContext* context, const char* name) :
+			m_profiler(profiler),
+			m_context(context),
+			m_zone(profiler.BeginZone(context, name))
+		{
+		}
+
+		~GpuProfileScope()
+		{
+			m_profiler.EndZone(m_context, m_zone);
+		}
+
+		GpuProfileScope(const GpuProfileScope&) = delete;
+		GpuProfileScope& operator=(const GpuProfileScope&) = delete;
+
+	private:
+		GpuProfiler&			m_profiler;
+		ID3D11DeviceContext*	m_context;
+		uint32_t				m_zone;
+	};
+}
@@ -0,0 +1,60 @@
+﻿#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include "LockFreeQueue.h"
+
+namespace DX
+{
+	// Kinds of pointer input forwarded from the input thread to the render loop.
+	enum class InputEventType : uint8_t
+	{
+		PointerPressed,
+		PointerMoved,
+		PointerReleased,
+	};
+
+	// A single pointer sample, in DIPs relative to the swap chain panel.
+	struct InputEvent
+	{
+		InputEventType	type;
+		uint32_t		pointerId;
+		float			x;
+		float			y;
+
+		// Time the sample was taken by the input stack, in microseconds.
+		uint64_t		timestamp;
+	};
+
+	// Queue used to hand pointer samples from the independent input thread to the render loop.
+	// Sized to hold several frames worth of high-frequency pen or touch input.
+	class InputEventQueue
+	{
+	public:
+		InputEventQueue() : m_droppedEvents(0) {}
+
+		// Called on the input thread. If the render loop has fallen far enough behind that the
+		// queue is full, the sample is dropped and counted.
+		bool Push(const InputEvent& inputEvent)
+		{
+			if (!m_queue.TryPush(inputEvent))
+			{
+				m_droppedEvents.fetch_add(1, std::memory_order_relaxed);
+				return false;
+			}
+			return true;
+		}
+
+		// Called on the render thread once per frame.
+		template<typename TFunc>
+		size_t Drain(const TFunc& func) { return m_queue.Drain(func); }
+
+		uint64_t GetDroppedEventCount() const { return m_droppedEvents.load(std::memory_order_relaxed); }
+
+		static const size_t Capacity = 256;
+
+	private:
+		SpscQueue<InputEvent, Capacity>	m_queue;
+		std::atomic<uint64_t>			m_droppedEvents;
+	};
+}
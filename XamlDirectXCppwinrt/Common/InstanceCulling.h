@@ -0,0 +1,107 @@
+﻿#pragma once
+
+#include <cmath>
+#include <cstdint>
+
+namespace DX
+{
+	// Arguments of DrawIndexedInstancedIndirect, in the order the GPU reads them from the
+	// argument buffer. The culling compute shader writes the same layout.
+	struct DrawIndexedIndirectArgs
+	{
+		uint32_t	indexCountPerInstance;
+		uint32_t	instanceCount;
+		uint32_t	startIndexLocation;
+		int32_t		baseVertexLocation;
+		uint32_t	startInstanceLocation;
+	};
+
+	static_assert(sizeof(DrawIndexedIndirectArgs) == 20, "DrawIndexedIndirectArgs must match the D3D11 argument layout.");
+
+	// Byte offset of instanceCount, which the compute shader increments atomically.
+	static const uint32_t DrawArgsInstanceCountOffset = 4;
+
+	// World space bounding sphere of one instance.
+	struct InstanceBounds
+	{
+		float	centerX;
+		float	centerY;
+		float	centerZ;
+		float	radius;
+	};
+
+	// The six planes of a view frustum as (a, b, c, d), with normals pointing inwards, so that
+	// a point is inside when a*x + b*y + c*z + d >= 0 for every plane.
+	struct FrustumPlanes
+	{
+		float planes[6][4];
+	};
+
+	// Extracts the frustum of a combined view-projection matrix. The matrix is row-major and
+	// transforms row vectors, as DirectXMath does, and clip space depth runs from 0 to w.
+	inline FrustumPlanes ExtractFrustumPlanes(const float (&m)[4][4])
+	{
+		FrustumPlanes frustum;
+		for (int i = 0; i < 4; i++)
+		{
+			frustum.planes[0][i] = m[i][3] + m[i][0];	// Left
+			frustum.planes[1][i] = m[i][3] - m[i][0];	// Right
+			frustum.planes[2][i] = m[i][3] + m[i][1];	// Bottom
+			frustum.planes[3][i] = m[i][3] - m[i][1];	// Top
+			frustum.planes[4][i] = m[i][2];				// Near
+			frustum.planes[5][i] = m[i][3] - m[i][2];	// Far
+		}
+
+		// Normalize, so that plane distances can be compared with sphere radii.
+		for (auto& plane : frustum.planes)
+		{
+			float length = std::sqrt(plane[0] * plane[0] + plane[1] * plane[1] + plane[2] * plane[2]);
+			if (length > 0.0f)
+			{
+				for (float& value : plane)
+				{
+					value /= length;
+				}
+			}
+		}
+
+		return frustum;
+	}
+
+	// True unless the sphere lies entirely outside one of the planes. Like most sphere tests this
+	// is conservative: a sphere near a corner of the frustum may be reported visible.
+	inline bool IsSphereVisible(const FrustumPlanes& frustum, const InstanceBounds& bounds)
+	{
+		for (const auto& plane : frustum.planes)
+		{
+			float distance = plane[0] * bounds.centerX + plane[1] * bounds.centerY + plane[2] * bounds.centerZ + plane[3];
+			if (distance < -bounds.radius)
+			{
+				return false;
+			}
+		}
+		return true;
+	}
+
+	// Reference implementation of the culling compute shader. Writes the indices of the visible
+	// instances to visibleInstances and returns how many there are. The shader appends in
+	// whatever order its threads finish, so only the set of indices is guaranteed to match.
+	inline uint32_t CullInstances(const FrustumPlanes& frustum, const InstanceBounds* instances, uint32_t instanceCount, uint32_t* visibleInstances)
+	{
+		uint32_t visibleCount = 0;
+		for (uint32_t i = 0; i < instanceCount; i++)
+		{
+			if (IsSphereVisible(frustum, instances[i]))
+			{
+				visibleInstances[visibleCount++] = i;
+			}
+		}
+		return visibleCount;
+	}
+
+	// The arguments the compute shader starts from each frame. It only fills in instanceCount.
+	inline DrawIndexedIndirectArgs MakeDrawArgs(uint32_t indexCount, uint32_t startIndex, int32_t baseVertex, uint32_t instanceCount = 0)
+	{
+		return { indexCount, instanceCount, startIndex, baseVertex, 0 };
+	}
+}
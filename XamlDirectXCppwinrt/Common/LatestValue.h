@@ -0,0 +1,62 @@
+﻿#pragma once
+
+#include <atomic>
+#include <mutex>
+
+namespace DX
+{
+	// Hands the latest value of a piece of state from any number of threads to one consumer.
+	// Unlike a queue it never fills up: a value set before the consumer took the previous one
+	// replaces it, which is what state like a window size wants, since only the newest matters.
+	// The lock is held only to copy the value, and the consumer can check for a new one without
+	// taking it.
+	template<typename T>
+	class LatestValue
+	{
+	public:
+		LatestValue() : m_value(), m_pending(false) {}
+
+		LatestValue(const LatestValue&) = delete;
+		LatestValue& operator=(const LatestValue&) = delete;
+
+		// Producer side. Returns true if the value replaced one the consumer hadn't taken yet.
+		bool Set(const T& value)
+		{
+			return Update([&value](T& pending, bool) { pending = value; });
+		}
+
+		// Producer side. Calls update with the stored value and whether it is still pending, so
+		// the new value can carry something over from the one it replaces, then marks it
+		// pending. Returns true if the value was still pending.
+		template<typename TUpdate>
+		bool Update(const TUpdate& update)
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+			bool replaced = m_pending.load(std::memory_order_relaxed);
+			update(m_value, replaced);
+			m_pending.store(true, std::memory_order_release);
+			return replaced;
+		}
+
+		// Consumer side. Returns false if nothing was set since the last call.
+		bool Take(T& value)
+		{
+			if (!m_pending.load(std::memory_order_acquire))
+			{
+				return false;
+			}
+
+			std::lock_guard<std::mutex> lock(m_mutex);
+			value = m_value;
+			m_pending.store(false, std::memory_order_relaxed);
+			return true;
+		}
+
+		bool IsPending() const { return m_pending.load(std::memory_order_acquire); }
+
+	private:
+		std::mutex			m_mutex;
+		T					m_value;
+		std::atomic<bool>	m_pending;
+	};
+}
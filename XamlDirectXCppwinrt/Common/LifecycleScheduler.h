@@ -0,0 +1,268 @@
+﻿#pragma once
+
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+
+namespace DX
+{
+	// What the app's window allows it to do, from most to least.
+	//
+	//   Foreground		Visible and presenting. The render loop runs at the display's rate.
+	//   Occluded		Visible but covered, so presents aren't shown. The render loop only
+	//					updates, at a reduced rate, and tests whether it can present again.
+	//   Hidden			Minimized or in the background. The render loop is stopped, and a low
+	//					priority worker keeps streaming the assets the last frames asked for.
+	//   Suspended		Nothing runs.
+	enum class LifecycleState
+	{
+		Foreground,
+		Occluded,
+		Hidden,
+		Suspended,
+	};
+
+	// The background threads the scheduler runs. The render loop and the streaming worker both
+	// use the immediate context, so no state runs both.
+	enum class LifecycleWorker
+	{
+		Render,
+		Streaming,
+	};
+
+	const uint32_t LifecycleWorkerCount = 2;
+
+	// Derives the lifecycle state from the window's events and paces the workers each state runs.
+	// The inputs may change from any thread. A worker is started by whoever sees BeginWorker
+	// return true, calls WaitForTick before each iteration and EndWorker when it returns false.
+	// WaitForWorkers then joins the workers a change stopped, so a new worker never overlaps the
+	// one it replaces.
+	class LifecycleScheduler
+	{
+	public:
+		using Clock = std::chrono::steady_clock;
+
+		explicit LifecycleScheduler(
+			Clock::duration occludedUpdateInterval = std::chrono::milliseconds(100),
+			Clock::duration hiddenStreamingInterval = std::chrono::milliseconds(250)) :
+			m_occludedUpdateInterval(occludedUpdateInterval),
+			m_hiddenStreamingInterval(hiddenStreamingInterval),
+			m_visible(true),
+			m_occluded(false),
+			m_suspended(false),
+			m_state(LifecycleState::Foreground),
+			m_transitionCount(0),
+			m_running{},
+			m_tickCount{}
+		{
+		}
+
+		LifecycleScheduler(const LifecycleScheduler&) = delete;
+		LifecycleScheduler& operator=(const LifecycleScheduler&) = delete;
+
+		// A window that is shown again is assumed to be uncovered until a present says otherwise.
+		void SetVisible(bool visible)
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+			m_visible = visible;
+			m_occluded = false;
+			UpdateState();
+		}
+
+		// Reported by the render loop from the result of each present.
+		void SetOccluded(bool occluded)
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+			m_occluded = occluded;
+			UpdateState();
+		}
+
+		void Suspend()
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+			m_suspended = true;
+			UpdateState();
+		}
+
+		void Resume()
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+			m_suspended = false;
+			m_occluded = false;
+			UpdateState();
+		}
+
+		LifecycleState GetState()
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+			return m_state;
+		}
+
+		static bool Runs(LifecycleState state, LifecycleWorker worker)
+		{
+			switch (worker)
+			{
+			case LifecycleWorker::Render:		return state == LifecycleState::Foreground || state == LifecycleState::Occluded;
+			case LifecycleWorker::Streaming:	return state == LifecycleState::Hidden;
+			}
+			return false;
+		}
+
+		// The shortest time between iterations of the worker in the state. Zero leaves the pace
+		// to the worker, which in the foreground is the display's.
+		Clock::duration GetTickInterval(LifecycleState state, LifecycleWorker worker) const
+		{
+			if (worker == LifecycleWorker::Render && state == LifecycleState::Occluded)
+			{
+				return m_occludedUpdateInterval;
+			}
+			if (worker == LifecycleWorker::Streaming && state == LifecycleState::Hidden)
+			{
+				return m_hiddenStreamingInterval;
+			}
+			return Clock::duration::zero();
+		}
+
+		// Returns true if the caller should start the worker: the state runs it and it isn't
+		// running already. The worker counts as running from now until it calls EndWorker.
+		bool BeginWorker(LifecycleWorker worker)
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+			uint32_t index = static_cast<uint32_t>(worker);
+			if (m_running[index] || !Runs(m_state, worker))
+			{
+				return false;
+			}
+
+			m_running[index] = true;
+			m_lastTick[index] = Clock::time_point();
+			return true;
+		}
+
+		void EndWorker(LifecycleWorker worker)
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+			m_running[static_cast<uint32_t>(worker)] = false;
+			m_condition.notify_all();
+		}
+
+		// Called by a worker before each iteration. Sleeps until the state's interval since the
+		// last iteration has passed, and returns false as soon as the state stops the worker.
+		bool WaitForTick(LifecycleWorker worker)
+		{
+			std::unique_lock<std::mutex> lock(m_mutex);
+			uint32_t index = static_cast<uint32_t>(worker);
+
+			while (Runs(m_state, worker))
+			{
+				// The interval is looked up again after every wakeup, since the state may have
+				// changed, e.g. from occluded back to the foreground.
+				Clock::time_point now = Clock::now();
+				Clock::time_point next = m_lastTick[index] + GetTickInterval(m_state, worker);
+				if (now >= next)
+				{
+					m_lastTick[index] = now;
+					m_tickCount[index]++;
+					return true;
+				}
+				m_condition.wait_until(lock, next);
+			}
+			return false;
+		}
+
+		// Blocks until every worker the current state stops has called EndWorker. Workers waiting
+		// in WaitForTick return at once; one in the middle of an iteration finishes it first.
+		void WaitForWorkers()
+		{
+			std::unique_lock<std::mutex> lock(m_mutex);
+			m_condition.wait(lock, [this]
+			{
+				for (uint32_t index = 0; index < LifecycleWorkerCount; index++)
+				{
+					if (m_running[index] && !Runs(m_state, static_cast<LifecycleWorker>(index)))
+					{
+						return false;
+					}
+				}
+				return true;
+			});
+		}
+
+		bool IsRunning(LifecycleWorker worker)
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+			return m_running[static_cast<uint32_t>(worker)];
+		}
+
+		// Number of state changes, and of iterations each worker was allowed.
+		uint64_t GetTransitionCount()
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+			return m_transitionCount;
+		}
+
+		uint64_t GetTickCount(LifecycleWorker worker)
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+			return m_tickCount[static_cast<uint32_t>(worker)];
+		}
+
+	private:
+		// Suspension overrides visibility, and visibility overrides occlusion.
+		void UpdateState()
+		{
+			LifecycleState state =
+				m_suspended ? LifecycleState::Suspended :
+				!m_visible ? LifecycleState::Hidden :
+				m_occluded ? LifecycleState::Occluded :
+				LifecycleState::Foreground;
+
+			if (state != m_state)
+			{
+				m_state = state;
+				m_transitionCount++;
+				m_condition.notify_all();
+			}
+		}
+
+		const Clock::duration	m_occludedUpdateInterval;
+		const Clock::duration	m_hiddenStreamingInterval;
+
+		// Guards everything below.
+		std::mutex				m_mutex;
+		std::condition_variable	m_condition;
+		bool					m_visible;
+		bool					m_occluded;
+		bool					m_suspended;
+		LifecycleState			m_state;
+		uint64_t				m_transitionCount;
+		bool					m_running[LifecycleWorkerCount];
+		Clock::time_point		m_lastTick[LifecycleWorkerCount];
+		uint64_t				m_tickCount[LifecycleWorkerCount];
+	};
+
+	// Calls EndWorker when a worker's loop exits, including by an exception, so that
+	// WaitForWorkers can't wait for a worker that is gone.
+	class LifecycleWorkerScope
+	{
+	public:
+		LifecycleWorkerScope(LifecycleScheduler& scheduler, LifecycleWorker worker) :
+			m_scheduler(scheduler),
+			m_worker(worker)
+		{
+		}
+
+		~LifecycleWorkerScope()
+		{
+			m_scheduler.EndWorker(m_worker);
+		}
+
+		LifecycleWorkerScope(const LifecycleWorkerScope&) = delete;
+		LifecycleWorkerScope& operator=(const LifecycleWorkerScope&) = delete;
+
+	private:
+		LifecycleScheduler&	m_scheduler;
+		LifecycleWorker		m_worker;
+	};
+}
@@ -0,0 +1,167 @@
+﻿#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+namespace DX
+{
+	// Bounded single-producer/single-consumer ring buffer. One thread may call TryPush while
+	// another thread calls TryPop; neither side ever blocks or takes a lock.
+	template<typename T, size_t Capacity>
+	class SpscQueue
+	{
+		static_assert(Capacity >= 2 && (Capacity & (Capacity - 1)) == 0, "Capacity must be a power of two.");
+
+	public:
+		SpscQueue() : m_head(0), m_tail(0) {}
+
+		SpscQueue(const SpscQueue&) = delete;
+		SpscQueue& operator=(const SpscQueue&) = delete;
+
+		// Producer side. Returns false if the queue is full and the item was not stored.
+		bool TryPush(const T& item)
+		{
+			const size_t tail = m_tail.load(std::memory_order_relaxed);
+			if (tail - m_head.load(std::memory_order_acquire) == Capacity)
+			{
+				return false;
+			}
+
+			m_items[tail & (Capacity - 1)] = item;
+			m_tail.store(tail + 1, std::memory_order_release);
+			return true;
+		}
+
+		// Consumer side. Returns false if the queue is empty.
+		bool TryPop(T& item)
+		{
+			const size_t head = m_head.load(std::memory_order_relaxed);
+			if (head == m_tail.load(std::memory_order_acquire))
+			{
+				return false;
+			}
+
+			item = m_items[head & (Capacity - 1)];
+			m_head.store(head + 1, std::memory_order_release);
+			return true;
+		}
+
+		// Consumer side. Pops every item currently available, in order, and passes it to the
+		// specified function. Returns the number of items drained.
+		template<typename TFunc>
+		size_t Drain(const TFunc& func)
+		{
+			const size_t head = m_head.load(std::memory_order_relaxed);
+			const size_t tail = m_tail.load(std::memory_order_acquire);
+
+			for (size_t i = head; i != tail; i++)
+			{
+				func(m_items[i & (Capacity - 1)]);
+			}
+
+			m_head.store(tail, std::memory_order_release);
+			return tail - head;
+		}
+
+		// Approximate number of queued items. Exact only when called from the consumer
+		// while the producer is idle.
+		size_t Size() const
+		{
+			return m_tail.load(std::memory_order_acquire) - m_head.load(std::memory_order_acquire);
+		}
+
+		static constexpr size_t GetCapacity() { return Capacity; }
+
+	private:
+		// Head and tail live on separate cache lines so the producer and consumer
+		// don't invalidate each other's line on every operation.
+		alignas(64) std::atomic<size_t>	m_head;
+		alignas(64) std::atomic<size_t>	m_tail;
+		alignas(64) std::array<T, Capacity>	m_items;
+	};
+
+	// Bounded multiple-producer/single-consumer queue. Any number of threads may call TryPush
+	// concurrently while one thread calls TryPop. Each slot carries a sequence number that tells
+	// producers and the consumer whose turn it is, so no locks are taken and nothing allocates.
+	template<typename T, size_t Capacity>
+	class MpscQueue
+	{
+		static_assert(Capacity >= 2 && (Capacity & (Capacity - 1)) == 0, "Capacity must be a power of two.");
+
+	public:
+		MpscQueue() : m_enqueuePosition(0), m_dequeuePosition(0)
+		{
+			for (size_t i = 0; i < Capacity; i++)
+			{
+				m_cells[i].sequence.store(i, std::memory_order_relaxed);
+			}
+		}
+
+		MpscQueue(const MpscQueue&) = delete;
+		MpscQueue& operator=(const MpscQueue&) = delete;
+
+		// Producer side, callable from any thread. Returns false if the queue is full.
+		bool TryPush(const T& item)
+		{
+			size_t position = m_enqueuePosition.load(std::memory_order_relaxed);
+			for (;;)
+			{
+				Cell& cell = m_cells[position & (Capacity - 1)];
+				size_t sequence = cell.sequence.load(std::memory_order_acquire);
+				intptr_t difference = static_cast<intptr_t>(sequence) - static_cast<intptr_t>(position);
+
+				if (difference == 0)
+				{
+					// The slot is free; claim it by advancing the enqueue position.
+					if (m_enqueuePosition.compare_exchange_weak(position, position + 1, std::memory_order_relaxed))
+					{
+						cell.item = item;
+						cell.sequence.store(position + 1, std::memory_order_release);
+						return true;
+					}
+				}
+				else if (difference < 0)
+				{
+					// The consumer hasn't released this slot yet, so the queue is full.
+					return false;
+				}
+				else
+				{
+					// Another producer claimed this slot first.
+					position = m_enqueuePosition.load(std::memory_order_relaxed);
+				}
+			}
+		}
+
+		// Consumer side. Returns false if the queue is empty or the oldest item is still being written.
+		bool TryPop(T& item)
+		{
+			Cell& cell = m_cells[m_dequeuePosition & (Capacity - 1)];
+			size_t sequence = cell.sequence.load(std::memory_order_acquire);
+			if (sequence != m_dequeuePosition + 1)
+			{
+				return false;
+			}
+
+			item = cell.item;
+			cell.sequence.store(m_dequeuePosition + Capacity, std::memory_order_release);
+			m_dequeuePosition++;
+			return true;
+		}
+
+		static constexpr size_t GetCapacity() { return Capacity; }
+
+	private:
+		struct Cell
+		{
+			std::atomic<size_t>	sequence;
+			T					item;
+		};
+
+		alignas(64) std::atomic<size_t>	m_enqueuePosition;
+		alignas(64) size_t				m_dequeuePosition;
+		alignas(64) std::array<Cell, Capacity>	m_cells;
+	};
+}
@@ -0,0 +1,63 @@
+﻿#include "pch.h"
+#include "MappedFile.h"
+
+using namespace winrt::Windows::ApplicationModel;
+
+DX::MappedFile::MappedFile() :
+	m_view(nullptr),
+	m_size(0)
+{
+}
+
+DX::MappedFile::~MappedFile()
+{
+	Close();
+}
+
+bool DX::MappedFile::OpenPackageFile(const std::wstring& fileName)
+{
+	return OpenFile(std::wstring(Package::Current().InstalledLocation().Path()) + L"\\" + fileName);
+}
+
+bool DX::MappedFile::OpenFile(const std::wstring& path)
+{
+	Close();
+
+	winrt::file_handle file(CreateFile2(path.c_str(), GENERIC_READ, FILE_SHARE_READ, OPEN_EXISTING, nullptr));
+	if (!file)
+	{
+		DWORD error = GetLastError();
+		if (error == ERROR_FILE_NOT_FOUND || error == ERROR_PATH_NOT_FOUND)
+		{
+			return false;
+		}
+		winrt::throw_hresult(HRESULT_FROM_WIN32(error));
+	}
+
+	LARGE_INTEGER size;
+	winrt::check_bool(GetFileSizeEx(file.get(), &size));
+	if (size.QuadPart == 0)
+	{
+		// Empty files can't be mapped, and have nothing to read anyway.
+		winrt::throw_hresult(HRESULT_FROM_WIN32(ERROR_FILE_INVALID));
+	}
+
+	winrt::handle mapping(CreateFileMappingFromApp(file.get(), nullptr, PAGE_READONLY, 0, nullptr));
+	winrt::check_bool(static_cast<bool>(mapping));
+
+	// The view keeps the mapping alive after its handle is closed.
+	m_view = MapViewOfFileFromApp(mapping.get(), FILE_MAP_READ, 0, 0);
+	winrt::check_pointer(m_view);
+	m_size = static_cast<size_t>(size.QuadPart);
+	return true;
+}
+
+void DX::MappedFile::Close()
+{
+	if (m_view != nullptr)
+	{
+		UnmapViewOfFile(m_view);
+		m_view = nullptr;
+		m_size = 0;
+	}
+}
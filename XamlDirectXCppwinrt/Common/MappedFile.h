@@ -0,0 +1,34 @@
+﻿#pragma once
+
+namespace DX
+{
+	// A read-only view of a file, such as one in the app package. The view is shared with every
+	// other process that maps the file, and the system reads pages from disk the first time they
+	// are touched, so large files cost nothing until their data is used.
+	class MappedFile
+	{
+	public:
+		MappedFile();
+		~MappedFile();
+
+		MappedFile(const MappedFile&) = delete;
+		MappedFile& operator=(const MappedFile&) = delete;
+
+		// Maps a file relative to the package's install folder. Returns false if the file
+		// doesn't exist; throws on any other failure.
+		bool OpenPackageFile(const std::wstring& fileName);
+
+		// Maps a file by its full path, e.g. in the app's local folder. The same as
+		// OpenPackageFile otherwise.
+		bool OpenFile(const std::wstring& path);
+		void Close();
+
+		bool IsOpen() const			{ return m_view != nullptr; }
+		const void* GetData() const	{ return m_view; }
+		size_t GetSize() const		{ return m_size; }
+
+	private:
+		void*	m_view;
+		size_t	m_size;
+	};
+}
@@ -0,0 +1,118 @@
+﻿#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#if defined(_M_X64) || defined(__SSE2__)
+#include <emmintrin.h>
+#define DX_MIP_GENERATION_SSE2 1
+#endif
+
+namespace DX
+{
+	// An image being reduced to a mip chain: RGBA texels as floats, in linear light with the color
+	// premultiplied by alpha. Filtering in this form keeps sRGB content from darkening and keeps
+	// the color of transparent texels from bleeding into their neighbours.
+	struct MipImage
+	{
+		uint32_t			width = 0;
+		uint32_t			height = 0;
+		std::vector<float>	texels;
+	};
+
+	namespace MipGeneration
+	{
+		inline float SrgbToLinear(float value)
+		{
+			return value <= 0.04045f ? value / 12.92f : std::pow((value + 0.055f) / 1.055f, 2.4f);
+		}
+
+		inline float LinearToSrgb(float value)
+		{
+			return value <= 0.0031308f ? value * 12.92f : 1.055f * std::pow(value, 1.0f / 2.4f) - 0.055f;
+		}
+
+		// Converts RGBA8 texels, either sRGB encoded or linear.
+		inline void Load(const uint8_t* rgba, uint32_t width, uint32_t height, bool srgb, MipImage* image)
+		{
+			float toLinear[256];
+			for (int i = 0; i < 256; i++)
+			{
+				toLinear[i] = srgb ? SrgbToLinear(i / 255.0f) : i / 255.0f;
+			}
+
+			image->width = width;
+			image->height = height;
+			image->texels.resize(size_t(width) * height * 4);
+
+			float* texel = image->texels.data();
+			for (size_t i = 0; i < size_t(width) * height; i++, rgba += 4, texel += 4)
+			{
+				float alpha = rgba[3] / 255.0f;
+				texel[0] = toLinear[rgba[0]] * alpha;
+				texel[1] = toLinear[rgba[1]] * alpha;
+				texel[2] = toLinear[rgba[2]] * alpha;
+				texel[3] = alpha;
+			}
+		}
+
+		// Converts back to RGBA8, undoing the premultiplication.
+		inline void Store(const MipImage& image, bool srgb, std::vector<uint8_t>* rgba)
+		{
+			rgba->resize(image.texels.size());
+
+			const float* texel = image.texels.data();
+			uint8_t* output = rgba->data();
+			for (size_t i = 0; i < size_t(image.width) * image.height; i++, texel += 4, output += 4)
+			{
+				float alpha = texel[3];
+				float scale = alpha > 0.0f ? 1.0f / alpha : 0.0f;
+				for (int c = 0; c < 3; c++)
+				{
+					float value = (std::min)(texel[c] * scale, 1.0f);
+					value = srgb ? LinearToSrgb(value) : value;
+					output[c] = static_cast<uint8_t>(value * 255.0f + 0.5f);
+				}
+				output[3] = static_cast<uint8_t>((std::min)(alpha, 1.0f) * 255.0f + 0.5f);
+			}
+		}
+
+		// Halves the image with a 2x2 box filter. An odd dimension repeats its last row or column,
+		// and a dimension of 1 stays 1.
+		inline void Downsample(const MipImage& source, MipImage* destination)
+		{
+			destination->width = (std::max)(source.width / 2, 1u);
+			destination->height = (std::max)(source.height / 2, 1u);
+			destination->texels.resize(size_t(destination->width) * destination->height * 4);
+
+			const size_t pitch = size_t(source.width) * 4;
+			for (uint32_t y = 0; y < destination->height; y++)
+			{
+				const float* row0 = source.texels.data() + (std::min)(y * 2, source.height - 1) * pitch;
+				const float* row1 = source.texels.data() + (std::min)(y * 2 + 1, source.height - 1) * pitch;
+				float* output = destination->texels.data() + size_t(y) * destination->width * 4;
+
+				for (uint32_t x = 0; x < destination->width; x++, output += 4)
+				{
+					size_t x0 = size_t((std::min)(x * 2, source.width - 1)) * 4;
+					size_t x1 = size_t((std::min)(x * 2 + 1, source.width - 1)) * 4;
+#if defined(DX_MIP_GENERATION_SSE2)
+					// One texel per register.
+					__m128 sum = _mm_add_ps(
+						_mm_add_ps(_mm_loadu_ps(row0 + x0), _mm_loadu_ps(row0 + x1)),
+						_mm_add_ps(_mm_loadu_ps(row1 + x0), _mm_loadu_ps(row1 + x1)));
+					_mm_storeu_ps(output, _mm_mul_ps(sum, _mm_set1_ps(0.25f)));
+#else
+					for (int c = 0; c < 4; c++)
+					{
+						output[c] = (row0[x0 + c] + row0[x1 + c] + row1[x0 + c] + row1[x1 + c]) * 0.25f;
+					}
+#endif
+				}
+			}
+		}
+	}
+}
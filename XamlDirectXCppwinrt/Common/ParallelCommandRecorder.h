@@ -0,0 +1,143 @@
+﻿#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cstddef>
+
+namespace DX
+{
+	// A contiguous run of draw packets, [begin, end).
+	struct PacketRange
+	{
+		size_t begin;
+		size_t end;
+
+		size_t Size() const { return end - begin; }
+	};
+
+	// Splits packetCount packets into at most maxRanges contiguous ranges of nearly equal size.
+	// Each range holds at least minPacketsPerRange packets, so that small scenes aren't spread
+	// across more workers than they can keep busy. Returns the number of ranges written.
+	inline size_t PartitionPackets(size_t packetCount, size_t maxRanges, size_t minPacketsPerRange, PacketRange* ranges)
+	{
+		if (packetCount == 0 || maxRanges == 0)
+		{
+			return 0;
+		}
+
+		size_t rangeCount = (std::min)(maxRanges, (std::max)(size_t(1), packetCount / (std::max)(size_t(1), minPacketsPerRange)));
+		size_t baseSize = packetCount / rangeCount;
+		size_t remainder = packetCount % rangeCount;
+
+		size_t begin = 0;
+		for (size_t i = 0; i < rangeCount; i++)
+		{
+			size_t size = baseSize + (i < remainder ? 1 : 0);
+			ranges[i] = { begin, begin + size };
+			begin += size;
+		}
+
+		return rangeCount;
+	}
+
+	// Records draw packets on several workers at once and submits the results in packet order, so
+	// the output is identical to recording every packet on one thread. The graphics API is hidden
+	// behind TBackend, which must provide:
+	//
+	//   using Context = ...;                          // Something packets are recorded into.
+	//   using CommandList = ...;                      // The result of recording on a worker.
+	//   size_t GetWorkerCount() const;                // At most MaxWorkers.
+	//   Context& GetImmediateContext();               // Used when recording on one thread.
+	//   Context& GetWorkerContext(size_t worker);
+	//   void BeginParallelRecording();                // Called on the submitting thread before
+	//   void EndParallelRecording();                  // and after the workers run.
+	//   void BeginRecording(Context& context);        // Prepares a worker context for recording.
+	//   CommandList FinishRecording(Context& context);
+	//   void Execute(CommandList& commandList);       // Called on the submitting thread, in order.
+	//   template<typename TFunc>
+	//   void ParallelFor(size_t count, const TFunc& func);	// Calls func(i) for every i < count.
+	template<typename TBackend>
+	class ParallelCommandRecorder
+	{
+	public:
+		using Context = typename TBackend::Context;
+		using CommandList = typename TBackend::CommandList;
+
+		static const size_t MaxWorkers = 16;
+
+		// Recording on another context has a fixed cost, so by default a worker only gets packets
+		// when there are enough of them to outweigh it.
+		explicit ParallelCommandRecorder(TBackend& backend, size_t minPacketsPerWorker = 64) :
+			m_backend(backend),
+			m_minPacketsPerWorker(minPacketsPerWorker),
+			m_ranges(),
+			m_commandLists()
+		{
+		}
+
+		ParallelCommandRecorder(const ParallelCommandRecorder&) = delete;
+		ParallelCommandRecorder& operator=(const ParallelCommandRecorder&) = delete;
+
+		void SetMinPacketsPerWorker(size_t minPacketsPerWorker) { m_minPacketsPerWorker = minPacketsPerWorker; }
+
+		// Records every packet by calling bindState(context) once per context and then
+		// recordPacket(context, packet) for each packet. Contexts don't share state, so bindState
+		// must set everything the packets rely on. Returns the number of workers used; zero means
+		// the packets were recorded directly on the immediate context.
+		template<typename TPacket, typename TBindState, typename TRecordPacket>
+		size_t Record(const TPacket* packets, size_t packetCount, const TBindState& bindState, const TRecordPacket& recordPacket)
+		{
+			size_t workerCount = (std::min)(m_backend.GetWorkerCount(), MaxWorkers);
+			size_t rangeCount = PartitionPackets(packetCount, workerCount, m_minPacketsPerWorker, m_ranges.data());
+
+			// A single range gains nothing from a worker context, so skip the extra submission.
+			if (rangeCount <= 1)
+			{
+				if (packetCount > 0)
+				{
+					Context& context = m_backend.GetImmediateContext();
+					bindState(context);
+					for (size_t i = 0; i < packetCount; i++)
+					{
+						recordPacket(context, packets[i]);
+					}
+				}
+				return 0;
+			}
+
+			// Each worker owns one range and one context, so workers never touch the same data.
+			m_backend.BeginParallelRecording();
+			m_backend.ParallelFor(rangeCount, [&](size_t worker)
+			{
+				Context& context = m_backend.GetWorkerContext(worker);
+				m_backend.BeginRecording(context);
+				bindState(context);
+
+				const PacketRange& range = m_ranges[worker];
+				for (size_t i = range.begin; i < range.end; i++)
+				{
+					recordPacket(context, packets[i]);
+				}
+
+				m_commandLists[worker] = m_backend.FinishRecording(context);
+			});
+
+			// The ranges are in packet order, so executing them by worker index preserves it.
+			for (size_t worker = 0; worker < rangeCount; worker++)
+			{
+				m_backend.Execute(m_commandLists[worker]);
+				m_commandLists[worker] = CommandList();
+			}
+
+			m_backend.EndParallelRecording();
+
+			return rangeCount;
+		}
+
+	private:
+		TBackend&								m_backend;
+		size_t									m_minPacketsPerWorker;
+		std::array<PacketRange, MaxWorkers>		m_ranges;
+		std::array<CommandList, MaxWorkers>		m_commandLists;
+	};
+}
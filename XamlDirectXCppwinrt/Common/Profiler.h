@@ -0,0 +1,326 @@
+﻿#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "LockFreeQueue.h"
+
+// Profiling zones are compiled in only when DX_ENABLE_PROFILER is defined. Otherwise the macros
+// expand to nothing and have no runtime cost.
+#define DX_PROFILE_CONCAT_INNER(a, b) a##b
+#define DX_PROFILE_CONCAT(a, b) DX_PROFILE_CONCAT_INNER(a, b)
+
+#if defined(DX_ENABLE_PROFILER)
+#define DX_PROFILE_SCOPE(name)			DX::ProfileScope DX_PROFILE_CONCAT(profileScope, __LINE__)(name)
+#define DX_PROFILE_THREAD_NAME(name)	DX::Profiler::Get().SetThreadName(name)
+#else
+#define DX_PROFILE_SCOPE(name)			((void)0)
+#define DX_PROFILE_THREAD_NAME(name)	((void)0)
+#endif
+
+namespace DX
+{
+	// A completed timing zone. Names must be string literals or otherwise outlive the profiler.
+	struct ProfileEvent
+	{
+		const char*	name;
+		uint64_t	startNanoseconds;
+		uint64_t	durationNanoseconds;
+		uint32_t	threadId;
+	};
+
+	// Collects timing zones from any number of threads and exports them as a timeline. Each
+	// thread writes into its own lock-free buffer, so recording a zone never blocks; the buffers
+	// are drained into a bounded history by Collect, usually once per frame. A buffer takes
+	// ThreadBufferCapacity zones, 512 KB, for as long as its thread lives, and is freed by the
+	// first Collect after the thread exits.
+	class Profiler
+	{
+	public:
+		// Thread id used for the timeline of GPU zones.
+		static const uint32_t GpuThreadId = 0;
+
+		static Profiler& Get()
+		{
+			static Profiler profiler;
+			return profiler;
+		}
+
+		// Nanoseconds since the profiler was created.
+		uint64_t Now() const
+		{
+			return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+				std::chrono::steady_clock::now() - m_epoch).count());
+		}
+
+		// Records a zone on the calling thread. Dropped if the thread's buffer is full.
+		void Record(const char* name, uint64_t startNanoseconds, uint64_t durationNanoseconds)
+		{
+			ThreadBuffer& buffer = GetThreadBuffer();
+			buffer.events.TryPush({ name, startNanoseconds, durationNanoseconds, buffer.threadId });
+		}
+
+		// Records a zone measured on the GPU, already converted to the profiler's clock.
+		void RecordGpu(const char* name, uint64_t startNanoseconds, uint64_t durationNanoseconds)
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+			Append({ name, startNanoseconds, durationNanoseconds, GpuThreadId });
+		}
+
+		void SetThreadName(const char* name)
+		{
+			uint32_t threadId = GetThreadBuffer().threadId;
+			std::lock_guard<std::mutex> lock(m_mutex);
+			m_threadNames[threadId] = name;
+		}
+
+		// Moves recorded zones from the per-thread buffers into the history, and frees the
+		// buffers of threads that have exited.
+		void Collect()
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+			for (auto buffer = m_threadBuffers.begin(); buffer != m_threadBuffers.end();)
+			{
+				// Checked before draining, so that every zone the thread recorded is drained.
+				bool retired = (*buffer)->retired.load(std::memory_order_acquire);
+				(*buffer)->events.Drain([this](const ProfileEvent& profileEvent) { Append(profileEvent); });
+				buffer = retired ? m_threadBuffers.erase(buffer) : buffer + 1;
+			}
+		}
+
+		// Number of per-thread buffers allocated, including those of exited threads not yet collected.
+		size_t GetThreadBufferCount()
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+			return m_threadBuffers.size();
+		}
+
+		// Writes the history in the Chrome trace event format, viewable in chrome://tracing or Perfetto.
+		void WriteChromeTrace(std::ostream& stream)
+		{
+			Collect();
+			std::lock_guard<std::mutex> lock(m_mutex);
+
+			stream << "{\"traceEvents\":[\n";
+			stream << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" << GpuThreadId << ",\"args\":{\"name\":\"GPU\"}}";
+			for (const auto& threadName : m_threadNames)
+			{
+				stream << ",\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" << threadName.first
+					<< ",\"args\":{\"name\":\"" << Escape(threadName.second) << "\"}}";
+			}
+
+			ForEachEvent([&](const ProfileEvent& profileEvent)
+			{
+				// Chrome trace timestamps are in microseconds.
+				stream << ",\n{\"name\":\"" << Escape(profileEvent.name)
+					<< "\",\"cat\":\"" << (profileEvent.threadId == GpuThreadId ? "gpu" : "cpu")
+					<< "\",\"ph\":\"X\",\"pid\":1,\"tid\":" << profileEvent.threadId
+					<< ",\"ts\":" << profileEvent.startNanoseconds / 1000 << '.' << PadThousandths(profileEvent.startNanoseconds % 1000)
+					<< ",\"dur\":" << profileEvent.durationNanoseconds / 1000 << '.' << PadThousandths(profileEvent.durationNanoseconds % 1000)
+					<< '}';
+			});
+
+			stream << "\n]}\n";
+		}
+
+		// Writes the history in a compact binary form: a header, a table of zone names, then one
+		// fixed-size record per zone. All values are little-endian.
+		//   char[4] "DXPF", uint32 version, uint32 nameCount, uint32 eventCount
+		//   nameCount x { uint16 length, char[length] }
+		//   eventCount x { uint32 nameIndex, uint32 threadId, uint64 start, uint64 duration }
+		void WriteBinary(std::ostream& stream)
+		{
+			Collect();
+			std::lock_guard<std::mutex> lock(m_mutex);
+
+			std::unordered_map<const char*, uint32_t> nameIndices;
+			std::vector<const char*> names;
+			ForEachEvent([&](const ProfileEvent& profileEvent)
+			{
+				if (nameIndices.emplace(profileEvent.name, static_cast<uint32_t>(names.size())).second)
+				{
+					names.push_back(profileEvent.name);
+				}
+			});
+
+			stream.write("DXPF", 4);
+			WriteValue<uint32_t>(stream, BinaryFormatVersion);
+			WriteValue<uint32_t>(stream, static_cast<uint32_t>(names.size()));
+			WriteValue<uint32_t>(stream, static_cast<uint32_t>(m_eventCount));
+
+			for (const char* name : names)
+			{
+				std::string value(name);
+				WriteValue<uint16_t>(stream, static_cast<uint16_t>(value.size()));
+				stream.write(value.data(), value.size());
+			}
+
+			ForEachEvent([&](const ProfileEvent& profileEvent)
+			{
+				WriteValue<uint32_t>(stream, nameIndices[profileEvent.name]);
+				WriteValue<uint32_t>(stream, profileEvent.threadId);
+				WriteValue<uint64_t>(stream, profileEvent.startNanoseconds);
+				WriteValue<uint64_t>(stream, profileEvent.durationNanoseconds);
+			});
+		}
+
+		void Clear()
+		{
+			Collect();
+			std::lock_guard<std::mutex> lock(m_mutex);
+			m_history.clear();
+			m_eventCount = 0;
+			m_nextEvent = 0;
+		}
+
+		// Number of zones kept in the history before the oldest are overwritten.
+		static const size_t HistoryCapacity = 1 << 18;
+
+		// Number of zones each thread can record between calls to Collect.
+		static const size_t ThreadBufferCapacity = 1 << 14;
+
+		static const uint32_t BinaryFormatVersion = 1;
+
+	private:
+		struct ThreadBuffer
+		{
+			uint32_t threadId;
+			std::atomic<bool> retired;			// Set when the thread exits.
+			SpscQueue<ProfileEvent, ThreadBufferCapacity> events;
+		};
+
+		// Retires the thread's buffer when the thread exits. The profiler keeps owning it until
+		// Collect has drained it, so zones recorded just before the exit are still exported.
+		struct ThreadBufferOwner
+		{
+			ThreadBuffer* buffer = nullptr;
+
+			~ThreadBufferOwner()
+			{
+				if (buffer != nullptr)
+				{
+					buffer->retired.store(true, std::memory_order_release);
+				}
+			}
+		};
+
+		Profiler() :
+			m_epoch(std::chrono::steady_clock::now()),
+			m_nextThreadId(GpuThreadId + 1),
+			m_nextEvent(0),
+			m_eventCount(0)
+		{
+		}
+
+		ThreadBuffer& GetThreadBuffer()
+		{
+			thread_local ThreadBufferOwner owner;
+			if (owner.buffer == nullptr)
+			{
+				auto buffer = std::make_unique<ThreadBuffer>();
+				buffer->threadId = m_nextThreadId.fetch_add(1);
+				buffer->retired.store(false, std::memory_order_relaxed);
+				owner.buffer = buffer.get();
+
+				std::lock_guard<std::mutex> lock(m_mutex);
+				m_threadBuffers.push_back(std::move(buffer));
+			}
+			return *owner.buffer;
+		}
+
+		// Must be called with m_mutex held.
+		void Append(const ProfileEvent& profileEvent)
+		{
+			if (m_history.size() < HistoryCapacity)
+			{
+				m_history.push_back(profileEvent);
+			}
+			else
+			{
+				m_history[m_nextEvent] = profileEvent;
+			}
+
+			m_nextEvent = (m_nextEvent + 1) % HistoryCapacity;
+			if (m_eventCount < HistoryCapacity)
+			{
+				m_eventCount++;
+			}
+		}
+
+		// Visits the history from oldest to newest. Must be called with m_mutex held.
+		template<typename TFunc>
+		void ForEachEvent(const TFunc& func) const
+		{
+			size_t first = (m_eventCount < HistoryCapacity) ? 0 : m_nextEvent;
+			for (size_t i = 0; i < m_eventCount; i++)
+			{
+				func(m_history[(first + i) % HistoryCapacity]);
+			}
+		}
+
+		static std::string Escape(const char* text)
+		{
+			std::string escaped;
+			for (; *text != '\0'; text++)
+			{
+				if (*text == '"' || *text == '\\')
+				{
+					escaped += '\\';
+				}
+				escaped += *text;
+			}
+			return escaped;
+		}
+
+		static std::string PadThousandths(uint64_t value)
+		{
+			std::string digits = std::to_string(value);
+			return std::string(3 - digits.size(), '0') + digits;
+		}
+
+		template<typename T>
+		static void WriteValue(std::ostream& stream, T value)
+		{
+			stream.write(reinterpret_cast<const char*>(&value), sizeof(T));
+		}
+
+		std::chrono::steady_clock::time_point				m_epoch;
+		std::atomic<uint32_t>								m_nextThreadId;
+		std::mutex											m_mutex;
+		std::vector<std::unique_ptr<ThreadBuffer>>			m_threadBuffers;
+		std::unordered_map<uint32_t, const char*>			m_threadNames;
+		std::vector<ProfileEvent>							m_history;
+		size_t												m_nextEvent;
+		size_t												m_eventCount;
+	};
+
+	// Records the lifetime of a block as a timing zone. Use through DX_PROFILE_SCOPE.
+	class ProfileScope
+	{
+	public:
+		explicit ProfileScope(const char* name) :
+			m_name(name),
+			m_start(Profiler::Get().Now())
+		{
+		}
+
+		~ProfileScope()
+		{
+			Profiler& profiler = Profiler::Get();
+			profiler.Record(m_name, m_start, profiler.Now() - m_start);
+		}
+
+		ProfileScope(const ProfileScope&) = delete;
+		ProfileScope& operator=(const ProfileScope&) = delete;
+
+	private:
+		const char*	m_name;
+		uint64_t	m_start;
+	};
+}
@@ -0,0 +1,205 @@
+﻿#pragma once
+
+#include <cstdint>
+#include <iterator>
+#include <map>
+#include <vector>
+
+namespace DX
+{
+	// Sub-allocates ranges out of a fixed-size linear space, such as the elements of a buffer.
+	// Free ranges are kept sorted by offset and merged with their neighbours when released, and
+	// allocations use the smallest free range that fits to keep large ranges available.
+	class RangeAllocator
+	{
+	public:
+		static const uint32_t InvalidOffset = UINT32_MAX;
+
+		struct Stats
+		{
+			uint32_t	capacity;
+			uint32_t	usedSize;
+			uint32_t	freeSize;
+			uint32_t	largestFreeRange;
+			uint32_t	freeRangeCount;
+			uint32_t	allocationCount;
+
+			// Share of the free space outside the largest free range, from 0 when all free
+			// space is contiguous to nearly 1 when it is scattered in small pieces.
+			float		fragmentation;
+		};
+
+		// An allocation that Defragment moved. The contents must be copied from oldOffset to
+		// newOffset before the old location is reused.
+		struct Move
+		{
+			uint32_t	oldOffset;
+			uint32_t	newOffset;
+			uint32_t	size;
+		};
+
+		explicit RangeAllocator(uint32_t capacity = 0)
+		{
+			Reset(capacity);
+		}
+
+		// Frees every allocation and sets a new capacity.
+		void Reset(uint32_t capacity)
+		{
+			m_capacity = capacity;
+			m_usedSize = 0;
+			m_freeRanges.clear();
+			m_allocations.clear();
+			if (capacity > 0)
+			{
+				m_freeRanges.emplace(0, capacity);
+			}
+		}
+
+		// Returns the offset of a range of the specified size, or InvalidOffset if no free range
+		// is large enough.
+		uint32_t Allocate(uint32_t size)
+		{
+			if (size == 0)
+			{
+				return InvalidOffset;
+			}
+
+			auto best = m_freeRanges.end();
+			for (auto range = m_freeRanges.begin(); range != m_freeRanges.end(); ++range)
+			{
+				if (range->second >= size && (best == m_freeRanges.end() || range->second < best->second))
+				{
+					best = range;
+					if (best->second == size)
+					{
+						break;
+					}
+				}
+			}
+
+			if (best == m_freeRanges.end())
+			{
+				return InvalidOffset;
+			}
+
+			uint32_t offset = best->first;
+			uint32_t remaining = best->second - size;
+			m_freeRanges.erase(best);
+			if (remaining > 0)
+			{
+				m_freeRanges.emplace(offset + size, remaining);
+			}
+
+			m_allocations.emplace(offset, size);
+			m_usedSize += size;
+			return offset;
+		}
+
+		// Releases an allocation made by Allocate. Returns false if offset isn't an allocation.
+		bool Free(uint32_t offset)
+		{
+			auto allocation = m_allocations.find(offset);
+			if (allocation == m_allocations.end())
+			{
+				return false;
+			}
+
+			uint32_t size = allocation->second;
+			m_allocations.erase(allocation);
+			m_usedSize -= size;
+
+			// Merge with the free range that follows, then with the one that precedes.
+			auto next = m_freeRanges.lower_bound(offset);
+			if (next != m_freeRanges.end() && offset + size == next->first)
+			{
+				size += next->second;
+				next = m_freeRanges.erase(next);
+			}
+
+			if (next != m_freeRanges.begin())
+			{
+				auto previous = std::prev(next);
+				if (previous->first + previous->second == offset)
+				{
+					previous->second += size;
+					return true;
+				}
+			}
+
+			m_freeRanges.emplace_hint(next, offset, size);
+			return true;
+		}
+
+		// Size of an allocation, or 0 if offset isn't an allocation.
+		uint32_t GetSize(uint32_t offset) const
+		{
+			auto allocation = m_allocations.find(offset);
+			return allocation == m_allocations.end() ? 0 : allocation->second;
+		}
+
+		// Packs every allocation towards offset 0 so that all free space forms one range. Returns
+		// the allocations that moved, in ascending order of offset.
+		std::vector<Move> Defragment()
+		{
+			std::vector<Move> moves;
+			std::map<uint32_t, uint32_t> allocations;
+
+			uint32_t nextOffset = 0;
+			for (const auto& allocation : m_allocations)
+			{
+				if (allocation.first != nextOffset)
+				{
+					moves.push_back({ allocation.first, nextOffset, allocation.second });
+				}
+				allocations.emplace_hint(allocations.end(), nextOffset, allocation.second);
+				nextOffset += allocation.second;
+			}
+
+			m_allocations.swap(allocations);
+			m_freeRanges.clear();
+			if (nextOffset < m_capacity)
+			{
+				m_freeRanges.emplace(nextOffset, m_capacity - nextOffset);
+			}
+
+			return moves;
+		}
+
+		Stats GetStats() const
+		{
+			Stats stats = {};
+			stats.capacity = m_capacity;
+			stats.usedSize = m_usedSize;
+			stats.freeSize = m_capacity - m_usedSize;
+			stats.freeRangeCount = static_cast<uint32_t>(m_freeRanges.size());
+			stats.allocationCount = static_cast<uint32_t>(m_allocations.size());
+
+			for (const auto& range : m_freeRanges)
+			{
+				if (range.second > stats.largestFreeRange)
+				{
+					stats.largestFreeRange = range.second;
+				}
+			}
+
+			if (stats.freeSize > 0)
+			{
+				stats.fragmentation = 1.0f - static_cast<float>(stats.largestFreeRange) / stats.freeSize;
+			}
+
+			return stats;
+		}
+
+		uint32_t GetCapacity() const	{ return m_capacity; }
+		uint32_t GetUsedSize() const	{ return m_usedSize; }
+
+	private:
+		uint32_t						m_capacity;
+		uint32_t						m_usedSize;
+
+		// Offset to size, for free ranges and for allocations.
+		std::map<uint32_t, uint32_t>	m_freeRanges;
+		std::map<uint32_t, uint32_t>	m_allocations;
+	};
+}
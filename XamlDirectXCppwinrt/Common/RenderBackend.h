@@ -0,0 +1,32 @@
+﻿#pragma once
+
+#include <cstdint>
+
+namespace DX
+{
+	// A vertex as the 3D content's vertex shader receives it, after the input assembler has
+	// expanded it to floats.
+	struct BackendVertex
+	{
+		float	position[3];
+		float	color[3];
+	};
+
+	// The part of a graphics API that the sample's 3D content uses: indexed triangle lists,
+	// transformed by model, view and projection matrices and drawn with their interpolated
+	// vertex colors into a color target with a depth test. Matrices are row-major and multiply
+	// row vectors, as in the shaders. Back faces, those wound counterclockwise on screen, are
+	// culled, and depth passes when it is less than what is stored, as in Direct3D's defaults.
+	//
+	// Direct3D draws the content itself, with the threading and culling paths only it has.
+	// Other backends, such as SoftwareRasterizer, make the same frames without a GPU.
+	class IRenderBackend
+	{
+	public:
+		virtual ~IRenderBackend() = default;
+
+		virtual void Clear(const float color[4], float depth) = 0;
+		virtual void SetViewProjection(const float view[16], const float projection[16]) = 0;
+		virtual void DrawIndexed(const BackendVertex* vertices, const uint16_t* indices, uint32_t indexCount, const float model[16]) = 0;
+	};
+}
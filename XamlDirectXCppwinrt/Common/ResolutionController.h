@@ -0,0 +1,135 @@
+﻿#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+
+namespace DX
+{
+	// Chooses the resolution to render 3D content at, as a scale of the output size, so that the
+	// GPU finishes each frame within a time budget. The GPU time of each measured frame goes
+	// through a PID controller, in velocity form so that clamping the scale can't wind it up.
+	// Two kinds of hysteresis keep the scale from wandering: the budget has a dead band below it,
+	// where the scale holds, and the scale that is applied only moves in whole steps, once the
+	// controller's output is at least a step away.
+	//
+	// GPU times arrive some frames after the frames they measure, so each sample says which scale
+	// its frame was rendered at; samples from before the last change are ignored.
+	//
+	// The controller has no knowledge of the graphics API; see DynamicResolution for that side.
+	class ResolutionController
+	{
+	public:
+		struct Settings
+		{
+			float	targetMilliseconds = 15.0f;		// GPU budget per frame. Leave room below the refresh interval.
+			float	minScale = 0.5f;
+			float	maxScale = 1.0f;
+			float	step = 1.0f / 32.0f;			// The applied scale is a multiple of this.
+			float	raiseMargin = 0.15f;			// Share of the budget that must be free before the scale grows.
+
+			// Gains on the error, the share of the budget left over (negative when over it).
+			float	proportionalGain = 0.05f;
+			float	integralGain = 0.2f;
+			float	derivativeGain = 0.02f;
+		};
+
+		struct Stats
+		{
+			uint64_t	samples;			// Samples used.
+			uint64_t	staleSamples;		// Samples ignored because the scale changed since.
+			uint64_t	changes;			// Changes to the applied scale.
+		};
+
+		ResolutionController() :
+			m_settings()
+		{
+			Reset();
+		}
+
+		explicit ResolutionController(const Settings& settings) :
+			m_settings(settings)
+		{
+			Reset();
+		}
+
+		// Starts again at the largest scale, for example when the output size changes.
+		void Reset()
+		{
+			m_scale = m_settings.maxScale;
+			m_appliedScale = m_settings.maxScale;
+			m_previousError = 0.0f;
+			m_olderError = 0.0f;
+			m_stats = Stats();
+		}
+
+		// Reports the GPU time of a frame rendered at renderedScale. Returns true if the
+		// applied scale changed.
+		bool AddSample(float gpuMilliseconds, float renderedScale)
+		{
+			if (renderedScale != m_appliedScale || !(gpuMilliseconds >= 0.0f))
+			{
+				m_stats.staleSamples++;
+				return false;
+			}
+			m_stats.samples++;
+
+			// Inside the dead band the scale holds; above it, only the headroom beyond the
+			// margin counts towards growing. Frames far over the budget count as twice the
+			// budget, so that the difference between two of them, which drives the proportional
+			// term, can't swing the scale across its whole range.
+			float error = (m_settings.targetMilliseconds - gpuMilliseconds) / m_settings.targetMilliseconds;
+			if (error > 0.0f)
+			{
+				error = (std::max)(error - m_settings.raiseMargin, 0.0f);
+			}
+			error = (std::max)(error, -1.0f);
+
+			float change =
+				m_settings.proportionalGain * (error - m_previousError) +
+				m_settings.integralGain * error +
+				m_settings.derivativeGain * (error - 2.0f * m_previousError + m_olderError);
+			m_olderError = m_previousError;
+			m_previousError = error;
+
+			m_scale = (std::min)((std::max)(m_scale + change, m_settings.minScale), m_settings.maxScale);
+
+			if (std::fabs(m_scale - m_appliedScale) < m_settings.step)
+			{
+				return false;
+			}
+
+			float applied = std::round(m_scale / m_settings.step) * m_settings.step;
+			applied = (std::min)((std::max)(applied, m_settings.minScale), m_settings.maxScale);
+			if (applied == m_appliedScale)
+			{
+				return false;
+			}
+
+			m_appliedScale = applied;
+			m_stats.changes++;
+			return true;
+		}
+
+		// The scale to render the next frame at.
+		float GetScale() const							{ return m_appliedScale; }
+		const Settings& GetSettings() const				{ return m_settings; }
+		const Stats& GetStats() const					{ return m_stats; }
+
+		void SetTargetMilliseconds(float milliseconds)	{ m_settings.targetMilliseconds = milliseconds; }
+
+		// The size of a render target at a scale, at least one pixel.
+		static uint32_t ScaleSize(uint32_t size, float scale)
+		{
+			return (std::max)(static_cast<uint32_t>(std::lround(size * scale)), 1u);
+		}
+
+	private:
+		Settings	m_settings;
+		float		m_scale;			// The controller's output, before it is snapped to a step.
+		float		m_appliedScale;
+		float		m_previousError;
+		float		m_olderError;
+		Stats		m_stats;
+	};
+}
@@ -0,0 +1,357 @@
+﻿#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+namespace DX
+{
+	// A shader archive packs the compiled variants of every shader into one file that is read in
+	// place, for example from a memory-mapped view. It holds:
+	//
+	//   ShaderArchiveHeader
+	//   ShaderArchiveSlot[slotCount]	Open-addressed hash table from variant key to blob index.
+	//   ShaderArchiveBlob[blobCount]	Where each unique piece of bytecode is.
+	//   bytecode					Each blob starts on a 16-byte boundary.
+	//
+	// Variants that compile to identical bytecode share a blob. All values are little-endian, as
+	// on every platform Direct3D runs on, and every offset is from the start of the file.
+	const uint32_t ShaderArchiveMagic = 0x41535844;	// "DXSA"
+	const uint32_t ShaderArchiveVersion = 1;
+	const uint32_t ShaderArchiveNoBlob = UINT32_MAX;	// Marks an empty slot.
+	const uint32_t ShaderArchiveBlobAlignment = 16;
+
+	struct ShaderArchiveHeader
+	{
+		uint32_t	magic;
+		uint32_t	version;
+		uint32_t	slotCount;		// A power of two, at least twice the number of variants.
+		uint32_t	blobCount;
+		uint64_t	slotsOffset;
+		uint64_t	blobsOffset;
+		uint64_t	fileSize;
+	};
+
+	struct ShaderArchiveSlot
+	{
+		uint64_t	key;
+		uint32_t	blob;
+		uint32_t	reserved;
+	};
+
+	struct ShaderArchiveBlob
+	{
+		uint64_t	offset;
+		uint32_t	size;
+		uint32_t	reserved;
+	};
+
+	static_assert(sizeof(ShaderArchiveHeader) == 40, "The archive header layout is part of the file format.");
+	static_assert(sizeof(ShaderArchiveSlot) == 16, "The archive slot layout is part of the file format.");
+	static_assert(sizeof(ShaderArchiveBlob) == 16, "The archive blob layout is part of the file format.");
+
+	// Spreads the key bits so that keys differing only in their feature mask land in different
+	// slots. This is the finalizer of MurmurHash3.
+	inline uint64_t MixShaderVariantKey(uint64_t key)
+	{
+		key ^= key >> 33;
+		key *= 0xFF51AFD7ED558CCDull;
+		key ^= key >> 33;
+		key *= 0xC4CEB9FE1A85EC53ull;
+		key ^= key >> 33;
+		return key;
+	}
+
+	// 64-bit FNV-1a, used to find identical bytecode.
+	inline uint64_t HashShaderBytecode(const uint8_t* data, size_t size)
+	{
+		uint64_t hash = 14695981039346656037ull;
+		for (size_t i = 0; i < size; i++)
+		{
+			hash = (hash ^ data[i]) * 1099511628211ull;
+		}
+		return hash;
+	}
+
+	// Compiled bytecode of one variant.
+	struct ShaderBytecode
+	{
+		const void*	data;
+		size_t		size;
+	};
+
+	// Reads an archive in place. The archive doesn't copy or own the memory it is opened on, which
+	// must stay valid, and be 8-byte aligned, for as long as the archive is used.
+	class ShaderArchive
+	{
+	public:
+		ShaderArchive() :
+			m_data(nullptr),
+			m_header(nullptr),
+			m_slots(nullptr),
+			m_blobs(nullptr)
+		{
+		}
+
+		// Validates the header and tables. Returns false, leaving the archive empty, if the data
+		// isn't a complete archive of this version.
+		bool Open(const void* data, size_t size)
+		{
+			if (!OpenHeader(data, size))
+			{
+				return false;
+			}
+
+			if (!AreTablesValid(size))
+			{
+				Close();
+				return false;
+			}
+
+			return true;
+		}
+
+		// Opens an archive that Open has accepted before, e.g. on an earlier launch, checking
+		// only the header, so that none of the tables are read until a variant is looked up. The
+		// caller must know that the data hasn't changed since.
+		bool OpenValidated(const void* data, size_t size)
+		{
+			return OpenHeader(data, size);
+		}
+
+		void Close()
+		{
+			m_data = nullptr;
+			m_header = nullptr;
+			m_slots = nullptr;
+			m_blobs = nullptr;
+		}
+
+		bool IsOpen() const { return m_header != nullptr; }
+
+		// Looks up a variant by the key from MakeShaderVariantKey. Returns false if the archive
+		// doesn't have it.
+		bool Find(uint64_t key, ShaderBytecode* bytecode) const
+		{
+			if (m_header == nullptr)
+			{
+				return false;
+			}
+
+			uint32_t mask = m_header->slotCount - 1;
+			for (uint32_t slot = static_cast<uint32_t>(MixShaderVariantKey(key)) & mask; ; slot = (slot + 1) & mask)
+			{
+				const ShaderArchiveSlot& entry = m_slots[slot];
+				if (entry.blob == ShaderArchiveNoBlob)
+				{
+					return false;
+				}
+
+				if (entry.key == key)
+				{
+					const ShaderArchiveBlob& blob = m_blobs[entry.blob];
+					bytecode->data = m_data + blob.offset;
+					bytecode->size = blob.size;
+					return true;
+				}
+			}
+		}
+
+		uint32_t GetBlobCount() const { return m_header != nullptr ? m_header->blobCount : 0; }
+
+	private:
+		bool OpenHeader(const void* data, size_t size)
+		{
+			Close();
+
+			if (data == nullptr || size < sizeof(ShaderArchiveHeader) || reinterpret_cast<uintptr_t>(data) % alignof(ShaderArchiveHeader) != 0)
+			{
+				return false;
+			}
+
+			auto bytes = static_cast<const uint8_t*>(data);
+			auto header = reinterpret_cast<const ShaderArchiveHeader*>(bytes);
+			if (header->magic != ShaderArchiveMagic || header->version != ShaderArchiveVersion || header->fileSize != size)
+			{
+				return false;
+			}
+
+			// The slot count must be a non-zero power of two for the probe mask to work.
+			if (header->slotCount == 0 || (header->slotCount & (header->slotCount - 1)) != 0)
+			{
+				return false;
+			}
+
+			if (!IsTableInFile(header->slotsOffset, header->slotCount, sizeof(ShaderArchiveSlot), size) ||
+				!IsTableInFile(header->blobsOffset, header->blobCount, sizeof(ShaderArchiveBlob), size))
+			{
+				return false;
+			}
+
+			m_data = bytes;
+			m_header = header;
+			m_slots = reinterpret_cast<const ShaderArchiveSlot*>(bytes + header->slotsOffset);
+			m_blobs = reinterpret_cast<const ShaderArchiveBlob*>(bytes + header->blobsOffset);
+			return true;
+		}
+
+		// Checking every entry once here keeps Find free of bounds checks.
+		bool AreTablesValid(size_t size) const
+		{
+			uint32_t usedSlots = 0;
+			for (uint32_t i = 0; i < m_header->slotCount; i++)
+			{
+				if (m_slots[i].blob != ShaderArchiveNoBlob)
+				{
+					if (m_slots[i].blob >= m_header->blobCount)
+					{
+						return false;
+					}
+					usedSlots++;
+				}
+			}
+
+			// A full table would make lookups of missing keys probe forever.
+			if (usedSlots == m_header->slotCount)
+			{
+				return false;
+			}
+
+			for (uint32_t i = 0; i < m_header->blobCount; i++)
+			{
+				if (m_blobs[i].offset > size || m_blobs[i].size > size - m_blobs[i].offset)
+				{
+					return false;
+				}
+			}
+
+			return true;
+		}
+
+		static bool IsTableInFile(uint64_t offset, uint32_t count, size_t entrySize, size_t fileSize)
+		{
+			return offset % 8 == 0 && offset <= fileSize && count <= (fileSize - offset) / entrySize;
+		}
+
+		const uint8_t*				m_data;
+		const ShaderArchiveHeader*	m_header;
+		const ShaderArchiveSlot*	m_slots;
+		const ShaderArchiveBlob*	m_blobs;
+	};
+
+	// Builds an archive from compiled variants. Used by the offline archive builder.
+	class ShaderArchiveWriter
+	{
+	public:
+		// Adds a variant. Identical bytecode is stored once however many variants use it. Returns
+		// false if the key was already added.
+		bool Add(uint64_t key, const void* data, size_t size)
+		{
+			if (!m_keys.insert(key).second)
+			{
+				return false;
+			}
+
+			auto bytes = static_cast<const uint8_t*>(data);
+			uint64_t hash = HashShaderBytecode(bytes, size);
+
+			uint32_t blobIndex = ShaderArchiveNoBlob;
+			auto candidates = m_blobsByHash.equal_range(hash);
+			for (auto candidate = candidates.first; candidate != candidates.second; ++candidate)
+			{
+				const std::vector<uint8_t>& blob = m_blobs[candidate->second];
+				if (blob.size() == size && (size == 0 || memcmp(blob.data(), bytes, size) == 0))
+				{
+					blobIndex = candidate->second;
+					break;
+				}
+			}
+
+			if (blobIndex == ShaderArchiveNoBlob)
+			{
+				blobIndex = static_cast<uint32_t>(m_blobs.size());
+				m_blobs.emplace_back(bytes, bytes + size);
+				m_blobsByHash.emplace(hash, blobIndex);
+			}
+
+			m_variants.push_back({ key, blobIndex });
+			return true;
+		}
+
+		size_t GetVariantCount() const	{ return m_variants.size(); }
+		size_t GetBlobCount() const		{ return m_blobs.size(); }
+
+		std::vector<uint8_t> Serialize() const
+		{
+			// Keep the table at most half full, so probe sequences stay short.
+			uint32_t slotCount = 2;
+			while (slotCount < m_variants.size() * 2)
+			{
+				slotCount *= 2;
+			}
+
+			ShaderArchiveHeader header = {};
+			header.magic = ShaderArchiveMagic;
+			header.version = ShaderArchiveVersion;
+			header.slotCount = slotCount;
+			header.blobCount = static_cast<uint32_t>(m_blobs.size());
+			header.slotsOffset = sizeof(ShaderArchiveHeader);
+			header.blobsOffset = header.slotsOffset + uint64_t(slotCount) * sizeof(ShaderArchiveSlot);
+
+			std::vector<ShaderArchiveSlot> slots(slotCount, ShaderArchiveSlot{ 0, ShaderArchiveNoBlob, 0 });
+			for (const auto& variant : m_variants)
+			{
+				uint32_t slot = static_cast<uint32_t>(MixShaderVariantKey(variant.key)) & (slotCount - 1);
+				while (slots[slot].blob != ShaderArchiveNoBlob)
+				{
+					slot = (slot + 1) & (slotCount - 1);
+				}
+				slots[slot] = { variant.key, variant.blob, 0 };
+			}
+
+			std::vector<ShaderArchiveBlob> blobs(m_blobs.size());
+			uint64_t offset = header.blobsOffset + m_blobs.size() * sizeof(ShaderArchiveBlob);
+			for (size_t i = 0; i < m_blobs.size(); i++)
+			{
+				offset = (offset + ShaderArchiveBlobAlignment - 1) / ShaderArchiveBlobAlignment * ShaderArchiveBlobAlignment;
+				blobs[i] = { offset, static_cast<uint32_t>(m_blobs[i].size()), 0 };
+				offset += m_blobs[i].size();
+			}
+			header.fileSize = offset;
+
+			std::vector<uint8_t> archive(static_cast<size_t>(offset), 0);
+			memcpy(archive.data(), &header, sizeof(header));
+			memcpy(archive.data() + header.slotsOffset, slots.data(), slots.size() * sizeof(ShaderArchiveSlot));
+			if (!blobs.empty())
+			{
+				memcpy(archive.data() + header.blobsOffset, blobs.data(), blobs.size() * sizeof(ShaderArchiveBlob));
+			}
+
+			for (size_t i = 0; i < m_blobs.size(); i++)
+			{
+				if (!m_blobs[i].empty())
+				{
+					memcpy(archive.data() + blobs[i].offset, m_blobs[i].data(), m_blobs[i].size());
+				}
+			}
+
+			return archive;
+		}
+
+	private:
+		struct Variant
+		{
+			uint64_t	key;
+			uint32_t	blob;
+		};
+
+		// Variants in the order they were added, so that the same inputs give the same file.
+		std::vector<Variant>						m_variants;
+		std::unordered_set<uint64_t>				m_keys;
+		std::vector<std::vector<uint8_t>>			m_blobs;
+		std::unordered_multimap<uint64_t, uint32_t>	m_blobsByHash;
+	};
+}
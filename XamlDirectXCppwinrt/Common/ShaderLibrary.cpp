@@ -0,0 +1,106 @@
+﻿#include "pch.h"
+#include "ShaderLibrary.h"
+#include "DirectXHelper.h"
+#include "Profiler.h"
+
+using namespace winrt::Windows::ApplicationModel;
+using namespace winrt::Windows::Foundation;
+
+namespace
+{
+	// Identifies the contents of a file in the package by its size and write time, which is much
+	// cheaper than hashing them. Returns 0 if the file doesn't exist.
+	uint64_t GetPackageFileVersion(const std::wstring& fileName)
+	{
+		std::wstring path = std::wstring(Package::Current().InstalledLocation().Path()) + L"\\" + fileName;
+
+		WIN32_FILE_ATTRIBUTE_DATA attributes;
+		if (!GetFileAttributesExFromApp(path.c_str(), GetFileExInfoStandard, &attributes))
+		{
+			return 0;
+		}
+
+		const uint32_t version[4] = { attributes.nFileSizeLow, attributes.nFileSizeHigh,
+			attributes.ftLastWriteTime.dwLowDateTime, attributes.ftLastWriteTime.dwHighDateTime };
+		return DX::HashWarmStartData(version, sizeof(version));
+	}
+}
+
+DX::ShaderLibrary::ShaderLibrary(std::wstring archiveFileName, std::shared_ptr<WarmStartStore> warmStart) :
+	m_archiveFileName(std::move(archiveFileName)),
+	m_warmStart(std::move(warmStart))
+{
+}
+
+void DX::ShaderLibrary::Open()
+{
+	std::call_once(m_openArchive, [this] { OpenArchive(); });
+}
+
+IAsyncAction DX::ShaderLibrary::LoadAsync(std::string name, uint32_t features, ShaderVariant* variant)
+{
+	Open();
+
+	uint64_t key = MakeShaderVariantKey(name, features);
+	if (m_archive.Find(key, &variant->bytecode))
+	{
+		variant->looseData.clear();
+		co_return;
+	}
+
+	std::wstring fileName(winrt::to_hstring(GetShaderVariantFileName(name, features)));
+	uint64_t cacheKey = MakeWarmStartKey("Shader", key);
+	uint64_t fileVersion = m_warmStart ? GetPackageFileVersion(fileName) : 0;
+
+	WarmStartBlob cached;
+	if (fileVersion != 0 && m_warmStart->Find(cacheKey, fileVersion, &cached))
+	{
+		variant->looseData.clear();
+		variant->bytecode = { cached.data, cached.size };
+		co_return;
+	}
+
+	std::wstring path = L"ms-appx:///" + fileName;
+	co_await ReadDataAsync(path, &variant->looseData);
+	variant->bytecode = { variant->looseData.data(), variant->looseData.size() };
+
+	if (fileVersion != 0)
+	{
+		m_warmStart->Store(cacheKey, fileVersion, variant->looseData.data(), variant->looseData.size());
+	}
+}
+
+// Maps the archive from the package's install folder, if it has one. Pages of the archive are
+// only read when a variant in them is used.
+void DX::ShaderLibrary::OpenArchive()
+{
+	DX_PROFILE_SCOPE("ShaderLibrary::OpenArchive");
+
+	if (!m_archiveFile.OpenPackageFile(m_archiveFileName))
+	{
+		// Without an archive every variant is loaded from its loose file.
+		return;
+	}
+
+	// An archive that was valid on an earlier launch, and hasn't changed since, is opened
+	// without reading its tables.
+	uint64_t cacheKey = MakeWarmStartKey("ShaderArchive");
+	uint64_t fileVersion = m_warmStart ? GetPackageFileVersion(m_archiveFileName) : 0;
+
+	WarmStartBlob validated;
+	if (fileVersion != 0 && m_warmStart->Find(cacheKey, fileVersion, &validated) &&
+		m_archive.OpenValidated(m_archiveFile.GetData(), m_archiveFile.GetSize()))
+	{
+		return;
+	}
+
+	if (!m_archive.Open(m_archiveFile.GetData(), m_archiveFile.GetSize()))
+	{
+		winrt::throw_hresult(HRESULT_FROM_WIN32(ERROR_FILE_CORRUPT));
+	}
+
+	if (fileVersion != 0)
+	{
+		m_warmStart->Store(cacheKey, fileVersion, nullptr, 0);
+	}
+}
@@ -0,0 +1,53 @@
+﻿#pragma once
+
+#include <mutex>
+#include <string>
+#include "MappedFile.h"
+#include "ShaderArchive.h"
+#include "ShaderPermutation.h"
+#include "WarmStartCache.h"
+
+namespace DX
+{
+	// The bytecode of one shader variant. Variants found in the archive or the warm-start cache
+	// point into its mapped view; variants read from loose files own their data.
+	struct ShaderVariant
+	{
+		ShaderBytecode		bytecode;
+		std::vector<byte>	looseData;
+	};
+
+	// Loads compiled shader variants by name and feature mask. Variants come from an archive built
+	// by ShaderArchiveBuilder when the app package contains one, mapped into memory once and
+	// looked up in constant time; any variant it doesn't hold is read from its loose .cso file.
+	// With a warm-start cache, loose variants read on an earlier launch are mapped from the cache
+	// instead, and an archive validated on an earlier launch isn't validated again; both are
+	// matched to the files' sizes and write times. The library is independent of the Direct3D
+	// device, so it survives device loss.
+	class ShaderLibrary
+	{
+	public:
+		explicit ShaderLibrary(std::wstring archiveFileName, std::shared_ptr<WarmStartStore> warmStart = nullptr);
+
+		ShaderLibrary(const ShaderLibrary&) = delete;
+		ShaderLibrary& operator=(const ShaderLibrary&) = delete;
+
+		// The library must outlive the returned action, and the variant must outlive its
+		// bytecode's use.
+		winrt::Windows::Foundation::IAsyncAction LoadAsync(std::string name, uint32_t features, ShaderVariant* variant);
+
+		// Maps the archive now rather than on the first load, e.g. during startup while other
+		// stages wait for the device. May be called from any thread.
+		void Open();
+		bool IsArchiveLoaded() const { return m_archive.IsOpen(); }
+
+	private:
+		void OpenArchive();
+
+		std::wstring					m_archiveFileName;
+		std::shared_ptr<WarmStartStore>	m_warmStart;
+		std::once_flag					m_openArchive;
+		MappedFile						m_archiveFile;
+		ShaderArchive					m_archive;
+	};
+}
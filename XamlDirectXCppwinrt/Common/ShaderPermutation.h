@@ -0,0 +1,162 @@
+﻿#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace DX
+{
+	// 32-bit FNV-1a, used to turn shader names into keys. It is constexpr so that keys for known
+	// shaders can be computed at compile time.
+	constexpr uint32_t HashShaderName(std::string_view name)
+	{
+		uint32_t hash = 2166136261u;
+		for (char c : name)
+		{
+			hash = (hash ^ static_cast<uint8_t>(c)) * 16777619u;
+		}
+		return hash;
+	}
+
+	// Identifies one compiled variant of a shader: the hash of the shader's name in the high 32
+	// bits and the mask of its enabled features in the low 32 bits.
+	constexpr uint64_t MakeShaderVariantKey(std::string_view name, uint32_t features = 0)
+	{
+		return (static_cast<uint64_t>(HashShaderName(name)) << 32) | features;
+	}
+
+	// The variants of a shader that differ only in which feature defines are set. Each define is
+	// one bit of the feature mask, in the order listed, so at most 32 are supported. For example:
+	//
+	//   constexpr DX::ShaderPermutations<2> VertexShader("SampleVertexShader", { "INSTANCED", "SKINNED" });
+	//   uint64_t key = VertexShader.GetKey(VertexShader.GetMask("INSTANCED"));
+	template<size_t TFeatureCount>
+	class ShaderPermutations
+	{
+	public:
+		static_assert(TFeatureCount <= 32, "A feature mask holds at most 32 features.");
+
+		constexpr ShaderPermutations(const char* name, std::array<const char*, TFeatureCount> defines) :
+			m_name(name),
+			m_defines(defines)
+		{
+		}
+
+		constexpr const char* GetName() const				{ return m_name; }
+		constexpr uint32_t GetFeatureCount() const			{ return static_cast<uint32_t>(TFeatureCount); }
+		constexpr uint64_t GetVariantCount() const			{ return uint64_t(1) << TFeatureCount; }
+		constexpr const char* GetDefine(size_t index) const	{ return m_defines[index]; }
+
+		constexpr uint64_t GetKey(uint32_t features) const
+		{
+			return MakeShaderVariantKey(m_name, features);
+		}
+
+		// The mask with the named defines enabled. Unknown names are ignored.
+		template<typename... TNames>
+		constexpr uint32_t GetMask(TNames... names) const
+		{
+			uint32_t mask = 0;
+			((mask |= GetFeatureBit(names)), ...);
+			return mask;
+		}
+
+		constexpr uint32_t GetFeatureBit(std::string_view define) const
+		{
+			for (size_t i = 0; i < TFeatureCount; i++)
+			{
+				if (define == m_defines[i])
+				{
+					return 1u << i;
+				}
+			}
+			return 0;
+		}
+
+		// The defines to compile a variant with.
+		std::vector<const char*> GetDefines(uint32_t features) const
+		{
+			std::vector<const char*> defines;
+			for (size_t i = 0; i < TFeatureCount; i++)
+			{
+				if (features & (1u << i))
+				{
+					defines.push_back(m_defines[i]);
+				}
+			}
+			return defines;
+		}
+
+	private:
+		const char*								m_name;
+		std::array<const char*, TFeatureCount>	m_defines;
+	};
+
+	// Compiled variants are stored as Name.cso for the default variant and Name_<mask>.cso, with
+	// the feature mask in hexadecimal, for the others. The archive builder recovers keys from
+	// these names, and the runtime uses them to find loose files when there is no archive, so
+	// shader names shouldn't themselves end in an underscore and hexadecimal digits.
+	inline std::string GetShaderVariantFileName(std::string_view name, uint32_t features = 0)
+	{
+		std::string fileName(name);
+		if (features != 0)
+		{
+			char suffix[16];
+			snprintf(suffix, sizeof(suffix), "_%x", features);
+			fileName += suffix;
+		}
+		fileName += ".cso";
+		return fileName;
+	}
+
+	// Splits a file name produced by GetShaderVariantFileName, without any directory. Returns
+	// false if it doesn't follow the convention.
+	inline bool ParseShaderVariantFileName(std::string_view fileName, std::string* name, uint32_t* features)
+	{
+		const std::string_view extension = ".cso";
+		if (fileName.size() <= extension.size() || fileName.substr(fileName.size() - extension.size()) != extension)
+		{
+			return false;
+		}
+
+		std::string_view stem = fileName.substr(0, fileName.size() - extension.size());
+		*features = 0;
+
+		size_t separator = stem.rfind('_');
+		if (separator != std::string_view::npos && separator > 0 && stem.size() - separator - 1 <= 8)
+		{
+			uint32_t mask = 0;
+			bool isMask = separator + 1 < stem.size();
+			for (char c : stem.substr(separator + 1))
+			{
+				if (c >= '0' && c <= '9')
+				{
+					mask = (mask << 4) | static_cast<uint32_t>(c - '0');
+				}
+				else if (c >= 'a' && c <= 'f')
+				{
+					mask = (mask << 4) | static_cast<uint32_t>(c - 'a' + 10);
+				}
+				else
+				{
+					isMask = false;
+					break;
+				}
+			}
+
+			// A suffix that isn't a canonical non-zero mask is part of the name.
+			if (isMask && mask != 0 && stem[separator + 1] != '0')
+			{
+				*features = mask;
+				stem = stem.substr(0, separator);
+			}
+		}
+
+		name->assign(stem);
+		return true;
+	}
+}
@@ -0,0 +1,238 @@
+﻿#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+// Describes one member of TStruct for a DX::ShaderStructLayout. A C++ array of the HLSL type
+// becomes an HLSL array; for example, an XMFLOAT4[6] member can be described as Float4.
+#define DX_SHADER_FIELD(TStruct, Member, Type) \
+	DX::MakeShaderField(#Member, DX::ShaderType::Type, offsetof(TStruct, Member), sizeof(TStruct::Member))
+
+namespace DX
+{
+	// HLSL types that can appear in a structure shared between C++ and shaders. Matrices are
+	// declared row_major, so C++ can store them exactly as DirectXMath lays them out.
+	enum class ShaderType : uint8_t
+	{
+		Float,
+		Float2,
+		Float3,
+		Float4,
+		Int,
+		Int2,
+		Int3,
+		Int4,
+		UInt,
+		UInt2,
+		UInt3,
+		UInt4,
+		Float4x4,
+	};
+
+	constexpr uint32_t GetShaderTypeSize(ShaderType type)
+	{
+		switch (type)
+		{
+		case ShaderType::Float:
+		case ShaderType::Int:
+		case ShaderType::UInt:
+			return 4;
+		case ShaderType::Float2:
+		case ShaderType::Int2:
+		case ShaderType::UInt2:
+			return 8;
+		case ShaderType::Float3:
+		case ShaderType::Int3:
+		case ShaderType::UInt3:
+			return 12;
+		case ShaderType::Float4:
+		case ShaderType::Int4:
+		case ShaderType::UInt4:
+			return 16;
+		case ShaderType::Float4x4:
+			return 64;
+		}
+		return 0;
+	}
+
+	constexpr const char* GetShaderTypeName(ShaderType type)
+	{
+		switch (type)
+		{
+		case ShaderType::Float:		return "float";
+		case ShaderType::Float2:	return "float2";
+		case ShaderType::Float3:	return "float3";
+		case ShaderType::Float4:	return "float4";
+		case ShaderType::Int:		return "int";
+		case ShaderType::Int2:		return "int2";
+		case ShaderType::Int3:		return "int3";
+		case ShaderType::Int4:		return "int4";
+		case ShaderType::UInt:		return "uint";
+		case ShaderType::UInt2:		return "uint2";
+		case ShaderType::UInt3:		return "uint3";
+		case ShaderType::UInt4:		return "uint4";
+		case ShaderType::Float4x4:	return "row_major float4x4";
+		}
+		return "";
+	}
+
+	// How the shader lays out the structure. Constant buffers use 16-byte registers: a value
+	// may not straddle two registers, and matrices and array elements each start a new one.
+	// Structured buffers pack every value tightly on 4-byte boundaries, as C++ does.
+	enum class ShaderPacking : uint8_t
+	{
+		ConstantBuffer,
+		StructuredBuffer,
+	};
+
+	// One member of a shared structure, with where C++ put it.
+	struct ShaderField
+	{
+		const char*	name;
+		ShaderType	type;
+		uint32_t	arrayCount;		// 0 for a single value.
+		uint32_t	offset;			// offsetof the C++ member.
+		uint32_t	size;			// sizeof the C++ member.
+	};
+
+	// Describes a C++ structure that a shader reads, so that it can be checked against the HLSL
+	// packing rules at compile time and the matching HLSL declaration can be generated.
+	template<size_t TFieldCount>
+	struct ShaderStructLayout
+	{
+		const char*								name;
+		ShaderPacking							packing;
+		uint32_t								registerIndex;	// b# for constant buffers.
+		uint32_t								size;			// sizeof the C++ structure.
+		std::array<ShaderField, TFieldCount>	fields;
+	};
+
+	constexpr ShaderField MakeShaderField(const char* name, ShaderType type, size_t offset, size_t size)
+	{
+		uint32_t typeSize = GetShaderTypeSize(type);
+		uint32_t count = static_cast<uint32_t>(size) / typeSize;
+		return { name, type, count > 1 ? count : 0, static_cast<uint32_t>(offset), static_cast<uint32_t>(size) };
+	}
+
+	template<typename TStruct, typename... TFields>
+	constexpr ShaderStructLayout<sizeof...(TFields)> DescribeConstantBuffer(const char* name, uint32_t registerIndex, TFields... fields)
+	{
+		return { name, ShaderPacking::ConstantBuffer, registerIndex, static_cast<uint32_t>(sizeof(TStruct)), { fields... } };
+	}
+
+	template<typename TStruct, typename... TFields>
+	constexpr ShaderStructLayout<sizeof...(TFields)> DescribeStructuredBuffer(const char* name, TFields... fields)
+	{
+		return { name, ShaderPacking::StructuredBuffer, 0, static_cast<uint32_t>(sizeof(TStruct)), { fields... } };
+	}
+
+	constexpr uint32_t AlignShaderOffset(uint32_t offset, uint32_t alignment)
+	{
+		return (offset + alignment - 1) / alignment * alignment;
+	}
+
+	// Computes where HLSL places each field and checks that C++ put it in the same place.
+	// Returns the index of the first field that doesn't match, or -1 if the whole structure does.
+	// A structure whose size differs from HLSL's reports the field count.
+	template<size_t TFieldCount>
+	constexpr int FindShaderPackingMismatch(const ShaderStructLayout<TFieldCount>& layout)
+	{
+		const uint32_t registerSize = 16;
+		uint32_t offset = 0;
+
+		for (size_t i = 0; i < TFieldCount; i++)
+		{
+			const ShaderField& field = layout.fields[i];
+			uint32_t typeSize = GetShaderTypeSize(field.type);
+			uint32_t count = field.arrayCount > 0 ? field.arrayCount : 1;
+
+			// The C++ member must hold exactly the values it claims to.
+			if (typeSize == 0 || field.size != typeSize * count)
+			{
+				return static_cast<int>(i);
+			}
+
+			uint32_t hlslSize = typeSize * count;
+			if (layout.packing == ShaderPacking::ConstantBuffer)
+			{
+				bool startsRegister = field.arrayCount > 0 || field.type == ShaderType::Float4x4;
+				if (startsRegister || (offset % registerSize) + typeSize > registerSize)
+				{
+					offset = AlignShaderOffset(offset, registerSize);
+				}
+
+				// Array elements are a register apart. C++ packs them back to back, so only
+				// elements that fill whole registers line up.
+				if (field.arrayCount > 0)
+				{
+					uint32_t stride = AlignShaderOffset(typeSize, registerSize);
+					if (stride != typeSize)
+					{
+						return static_cast<int>(i);
+					}
+					hlslSize = stride * (count - 1) + typeSize;
+				}
+			}
+
+			if (field.offset != offset)
+			{
+				return static_cast<int>(i);
+			}
+			offset += hlslSize;
+		}
+
+		// Constant buffers are a whole number of registers, and the C++ structure is what the
+		// buffer is created from, so it must be too.
+		uint32_t size = (layout.packing == ShaderPacking::ConstantBuffer) ? AlignShaderOffset(offset, registerSize) : offset;
+		if (layout.size != size)
+		{
+			return static_cast<int>(TFieldCount);
+		}
+
+		return -1;
+	}
+
+	template<size_t TFieldCount>
+	constexpr bool MatchesShaderPacking(const ShaderStructLayout<TFieldCount>& layout)
+	{
+		return FindShaderPackingMismatch(layout) < 0;
+	}
+
+	// Generates the HLSL declaration of a structure, for a .hlsli file that shaders include.
+	template<size_t TFieldCount>
+	std::string GenerateHlsl(const ShaderStructLayout<TFieldCount>& layout)
+	{
+		std::string hlsl;
+		if (layout.packing == ShaderPacking::ConstantBuffer)
+		{
+			hlsl += "cbuffer ";
+			hlsl += layout.name;
+			hlsl += " : register(b" + std::to_string(layout.registerIndex) + ")\n";
+		}
+		else
+		{
+			hlsl += "struct ";
+			hlsl += layout.name;
+			hlsl += "\n";
+		}
+
+		hlsl += "{\n";
+		for (const ShaderField& field : layout.fields)
+		{
+			hlsl += "\t";
+			hlsl += GetShaderTypeName(field.type);
+			hlsl += " ";
+			hlsl += field.name;
+			if (field.arrayCount > 0)
+			{
+				hlsl += "[" + std::to_string(field.arrayCount) + "]";
+			}
+			hlsl += ";\n";
+		}
+		hlsl += "};\n";
+
+		return hlsl;
+	}
+}
@@ -0,0 +1,175 @@
+﻿#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace DX
+{
+	// Packs rectangles into a fixed-size area, such as a texture atlas, by tracking the skyline:
+	// the height of the packed area along its width, as a list of level segments. Each rectangle
+	// goes where its bottom edge ends up lowest, preferring the position that wastes the least
+	// space under it. Rectangles can't be freed individually; Reset empties the whole area.
+	class SkylinePacker
+	{
+	public:
+		explicit SkylinePacker(uint32_t width = 0, uint32_t height = 0)
+		{
+			Reset(width, height);
+		}
+
+		void Reset(uint32_t width, uint32_t height)
+		{
+			m_width = width;
+			m_height = height;
+			m_usedArea = 0;
+			m_skyline.clear();
+			if (width > 0)
+			{
+				m_skyline.push_back({ 0, 0, width });
+			}
+		}
+
+		// Finds a place for a rectangle and marks it used. Returns false if it doesn't fit.
+		bool Pack(uint32_t width, uint32_t height, uint32_t* x, uint32_t* y)
+		{
+			if (width == 0 || height == 0 || width > m_width || height > m_height)
+			{
+				return false;
+			}
+
+			size_t bestSegment = SIZE_MAX;
+			uint32_t bestBottom = UINT32_MAX;
+			uint64_t bestWaste = UINT64_MAX;
+			uint32_t bestY = 0;
+
+			for (size_t i = 0; i < m_skyline.size(); i++)
+			{
+				uint32_t top;
+				uint64_t waste;
+				if (!Fit(i, width, height, &top, &waste))
+				{
+					continue;
+				}
+
+				uint32_t bottom = top + height;
+				if (bottom < bestBottom || (bottom == bestBottom && waste < bestWaste))
+				{
+					bestSegment = i;
+					bestBottom = bottom;
+					bestWaste = waste;
+					bestY = top;
+				}
+			}
+
+			if (bestSegment == SIZE_MAX)
+			{
+				return false;
+			}
+
+			*x = m_skyline[bestSegment].x;
+			*y = bestY;
+			Insert(bestSegment, width, bestY + height);
+			m_usedArea += uint64_t(width) * height;
+			return true;
+		}
+
+		uint32_t GetWidth() const	{ return m_width; }
+		uint32_t GetHeight() const	{ return m_height; }
+
+		// Share of the area covered by packed rectangles.
+		float GetOccupancy() const
+		{
+			return m_width > 0 && m_height > 0 ? static_cast<float>(double(m_usedArea) / (double(m_width) * m_height)) : 0.0f;
+		}
+
+	private:
+		struct Segment
+		{
+			uint32_t	x;
+			uint32_t	y;		// Height of the skyline over this segment.
+			uint32_t	width;
+		};
+
+		// Whether a rectangle with its left edge at segment index fits, and if so how high it
+		// must sit to clear every segment under it, and how much area it leaves unusable below.
+		bool Fit(size_t index, uint32_t width, uint32_t height, uint32_t* top, uint64_t* waste) const
+		{
+			uint32_t x = m_skyline[index].x;
+			if (x + width > m_width)
+			{
+				return false;
+			}
+
+			uint32_t y = 0;
+			uint32_t remaining = width;
+			for (size_t i = index; remaining > 0; i++)
+			{
+				y = (std::max)(y, m_skyline[i].y);
+				remaining -= (std::min)(remaining, m_skyline[i].width);
+			}
+
+			if (y + height > m_height)
+			{
+				return false;
+			}
+
+			uint64_t wasted = 0;
+			remaining = width;
+			for (size_t i = index; remaining > 0; i++)
+			{
+				uint32_t covered = (std::min)(remaining, m_skyline[i].width);
+				wasted += uint64_t(y - m_skyline[i].y) * covered;
+				remaining -= covered;
+			}
+
+			*top = y;
+			*waste = wasted;
+			return true;
+		}
+
+		// Raises the skyline to bottom over [x, x + width) of the segment at index.
+		void Insert(size_t index, uint32_t width, uint32_t bottom)
+		{
+			uint32_t x = m_skyline[index].x;
+			m_skyline.insert(m_skyline.begin() + index, { x, bottom, width });
+
+			// Trim or remove the segments the new one now covers.
+			size_t next = index + 1;
+			while (next < m_skyline.size() && m_skyline[next].x < x + width)
+			{
+				Segment& segment = m_skyline[next];
+				uint32_t end = segment.x + segment.width;
+				if (end <= x + width)
+				{
+					m_skyline.erase(m_skyline.begin() + next);
+					continue;
+				}
+
+				segment.width = end - (x + width);
+				segment.x = x + width;
+				break;
+			}
+
+			// Merge neighbours at the same height, so the list stays short.
+			for (size_t i = (index > 0 ? index - 1 : 0); i + 1 < m_skyline.size() && i <= index + 1; )
+			{
+				if (m_skyline[i].y == m_skyline[i + 1].y)
+				{
+					m_skyline[i].width += m_skyline[i + 1].width;
+					m_skyline.erase(m_skyline.begin() + i + 1);
+				}
+				else
+				{
+					i++;
+				}
+			}
+		}
+
+		uint32_t				m_width;
+		uint32_t				m_height;
+		uint64_t				m_usedArea;
+		std::vector<Segment>	m_skyline;
+	};
+}
@@ -0,0 +1,858 @@
+﻿// Doesn't use the precompiled header, so that tools can build it without the Windows headers.
+#include "SoftwareRasterizer.h"
+
+#include <algorithm>
+#include <cctype>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <limits>
+
+#if defined(_M_X64) || defined(__SSE2__)
+#include <emmintrin.h>
+#define DX_SOFTWARE_RASTERIZER_SSE2 1
+#endif
+
+namespace
+{
+	// Vertices are snapped to this many steps per pixel, as Direct3D hardware does.
+	const int64_t SubpixelSteps = 256;
+
+	// Half the size of the guard band in viewports. Triangles are only clipped where they reach
+	// past it, which keeps the fixed point edge functions from overflowing.
+	const float GuardBand = 8.0f;
+
+	// Pixels tested together. Tiles are a whole number of spans wide.
+	const int32_t SpanWidth = 8;
+
+	void Multiply(const float a[16], const float b[16], float result[16])
+	{
+		for (int row = 0; row < 4; row++)
+		{
+			for (int column = 0; column < 4; column++)
+			{
+				result[row * 4 + column] =
+					a[row * 4 + 0] * b[0 * 4 + column] +
+					a[row * 4 + 1] * b[1 * 4 + column] +
+					a[row * 4 + 2] * b[2 * 4 + column] +
+					a[row * 4 + 3] * b[3 * 4 + column];
+			}
+		}
+	}
+
+	// Distance of a clip space position inside each clipping plane; negative is outside.
+	float PlaneDistance(const float position[4], uint32_t plane)
+	{
+		const float x = position[0];
+		const float y = position[1];
+		const float z = position[2];
+		const float w = position[3];
+		switch (plane)
+		{
+		case 0:		return z;					// Near
+		case 1:		return w - z;				// Far
+		case 2:		return GuardBand * w + x;	// Left
+		case 3:		return GuardBand * w - x;	// Right
+		case 4:		return GuardBand * w + y;	// Bottom
+		default:	return GuardBand * w - y;	// Top
+		}
+	}
+
+	const uint32_t ClipPlaneCount = 6;
+
+	// Direct3D's float to UNORM8 conversion: clamp, then round to nearest.
+	uint32_t ToUnorm8(float value)
+	{
+		value = (std::min)((std::max)(value, 0.0f), 1.0f);
+		return static_cast<uint32_t>(value * 255.0f + 0.5f);
+	}
+
+	uint32_t PackColor(float r, float g, float b, float a)
+	{
+		return (ToUnorm8(a) << 24) | (ToUnorm8(r) << 16) | (ToUnorm8(g) << 8) | ToUnorm8(b);
+	}
+
+	int64_t FloorDivide(int64_t numerator, int64_t denominator)
+	{
+		int64_t quotient = numerator / denominator;
+		return (numerator % denominator != 0 && numerator < 0) ? quotient - 1 : quotient;
+	}
+
+	uint32_t CountBits(uint32_t bits)
+	{
+		uint32_t count = 0;
+		for (; bits != 0; bits &= bits - 1)
+		{
+			count++;
+		}
+		return count;
+	}
+
+	// What a triangle needs to draw the spans of one row of a tile. Planes hold depth, 1/w and
+	// the color over w, at the row's first pixel and per pixel to the right.
+	struct SpanSetup
+	{
+		const int64_t*	edgeA;
+		bool			testEdges;
+		int32_t			firstX;		// Pixels before firstX or from lastX on are left alone.
+		int32_t			lastX;
+		float			planeRow[5];
+		float			planeStepX[5];
+	};
+
+	// Draws one pixel of a span. i is its offset from the start of the row's planes. Counts it
+	// as tested if it is covered, and as written if it passes the depth test.
+	inline void DrawPixel(SpanSetup const& setup, int64_t const (&edge)[3], float i, uint32_t* color, float* depth, uint32_t& tested, uint32_t& written)
+	{
+		if (setup.testEdges && (edge[0] | edge[1] | edge[2]) < 0)
+		{
+			return;
+		}
+
+		tested++;
+		float z = setup.planeRow[0] + setup.planeStepX[0] * i;
+		if (z < *depth)
+		{
+			written++;
+			*depth = z;
+
+			float inverseW = setup.planeRow[1] + setup.planeStepX[1] * i;
+			float r = (setup.planeRow[2] + setup.planeStepX[2] * i) / inverseW;
+			float g = (setup.planeRow[3] + setup.planeStepX[3] * i) / inverseW;
+			float b = (setup.planeRow[4] + setup.planeStepX[4] * i) / inverseW;
+			*color = PackColor(r, g, b, 1.0f);
+		}
+	}
+
+	// Draws up to eight pixels from x, which lie in one tile. edge holds the edge functions at
+	// x, and i its offset from the start of the row's planes. Pixels outside the setup's range
+	// are read and written back unchanged. Adds the depth of every pixel in range, after the
+	// test, to maxDepth.
+	void DrawSpanScalar(SpanSetup const& setup, int32_t x, int64_t const (&startEdge)[3], int32_t i, uint32_t* colors, float* depths, uint32_t& tested, uint32_t& written, float& maxDepth)
+	{
+		int64_t edge[3] = { startEdge[0], startEdge[1], startEdge[2] };
+		for (int32_t k = 0; k < SpanWidth; k++)
+		{
+			if (x + k >= setup.firstX && x + k < setup.lastX)
+			{
+				DrawPixel(setup, edge, static_cast<float>(i + k), colors + k, depths + k, tested, written);
+				maxDepth = (std::max)(maxDepth, depths[k]);
+			}
+
+			for (int e = 0; e < 3; e++)
+			{
+				edge[e] += setup.edgeA[e];
+			}
+		}
+	}
+
+#if DX_SOFTWARE_RASTERIZER_SSE2
+	// Edge functions are 64-bit, two to a register. Pixels are covered where the upper halves
+	// of all three are non-negative; this gathers those halves of four pixels into lane masks.
+	inline __m128i CoveredLanes(__m128i pixels01, __m128i pixels23)
+	{
+		__m128 upperHalves = _mm_shuffle_ps(_mm_castsi128_ps(pixels01), _mm_castsi128_ps(pixels23), _MM_SHUFFLE(3, 1, 3, 1));
+		return _mm_xor_si128(_mm_srai_epi32(_mm_castps_si128(upperHalves), 31), _mm_set1_epi32(-1));
+	}
+
+	inline __m128 Plane(SpanSetup const& setup, int plane, __m128 i)
+	{
+		return _mm_add_ps(_mm_set1_ps(setup.planeRow[plane]), _mm_mul_ps(_mm_set1_ps(setup.planeStepX[plane]), i));
+	}
+
+	inline __m128i ToUnorm8(__m128 value)
+	{
+		value = _mm_min_ps(_mm_max_ps(value, _mm_setzero_ps()), _mm_set1_ps(1.0f));
+		return _mm_cvttps_epi32(_mm_add_ps(_mm_mul_ps(value, _mm_set1_ps(255.0f)), _mm_set1_ps(0.5f)));
+	}
+
+	// The same as DrawSpanScalar, four pixels at a time. Needs all eight pixels inside the
+	// target.
+	void DrawSpan(SpanSetup const& setup, int32_t x, int64_t const (&startEdge)[3], int32_t i, uint32_t* colors, float* depths, uint32_t& tested, uint32_t& written, float& maxDepth)
+	{
+		__m128 spanMaxDepth = _mm_set1_ps(maxDepth);
+		for (int32_t quad = 0; quad < SpanWidth; quad += 4)
+		{
+			__m128i lanes = _mm_add_epi32(_mm_set1_epi32(x + quad), _mm_setr_epi32(0, 1, 2, 3));
+			__m128i inRange = _mm_andnot_si128(
+				_mm_cmplt_epi32(lanes, _mm_set1_epi32(setup.firstX)),
+				_mm_cmplt_epi32(lanes, _mm_set1_epi32(setup.lastX)));
+			if (_mm_movemask_epi8(inRange) == 0)
+			{
+				continue;
+			}
+
+			__m128i covered = inRange;
+			if (setup.testEdges)
+			{
+				__m128i pixels01 = _mm_setzero_si128();
+				__m128i pixels23 = _mm_setzero_si128();
+				for (int e = 0; e < 3; e++)
+				{
+					int64_t a = setup.edgeA[e];
+					__m128i edge = _mm_set1_epi64x(startEdge[e] + a * quad);
+					pixels01 = _mm_or_si128(pixels01, _mm_add_epi64(edge, _mm_set_epi64x(a, 0)));
+					pixels23 = _mm_or_si128(pixels23, _mm_add_epi64(edge, _mm_set_epi64x(a * 3, a * 2)));
+				}
+				covered = _mm_and_si128(covered, CoveredLanes(pixels01, pixels23));
+			}
+
+			int coveredBits = _mm_movemask_ps(_mm_castsi128_ps(covered));
+			__m128 storedDepth = _mm_loadu_ps(depths + quad);
+			if (coveredBits != 0)
+			{
+				__m128 offsets = _mm_add_ps(_mm_set1_ps(static_cast<float>(i + quad)), _mm_setr_ps(0.0f, 1.0f, 2.0f, 3.0f));
+				__m128 z = Plane(setup, 0, offsets);
+				__m128 passed = _mm_and_ps(_mm_castsi128_ps(covered), _mm_cmplt_ps(z, storedDepth));
+				int passedBits = _mm_movemask_ps(passed);
+				tested += CountBits(coveredBits);
+				written += CountBits(passedBits);
+
+				if (passedBits != 0)
+				{
+					storedDepth = _mm_or_ps(_mm_and_ps(passed, z), _mm_andnot_ps(passed, storedDepth));
+					_mm_storeu_ps(depths + quad, storedDepth);
+
+					__m128 inverseW = Plane(setup, 1, offsets);
+					__m128i r = ToUnorm8(_mm_div_ps(Plane(setup, 2, offsets), inverseW));
+					__m128i g = ToUnorm8(_mm_div_ps(Plane(setup, 3, offsets), inverseW));
+					__m128i b = ToUnorm8(_mm_div_ps(Plane(setup, 4, offsets), inverseW));
+					__m128i color = _mm_or_si128(
+						_mm_or_si128(_mm_set1_epi32(static_cast<int>(0xFF000000u)), _mm_slli_epi32(r, 16)),
+						_mm_or_si128(_mm_slli_epi32(g, 8), b));
+
+					__m128i passedLanes = _mm_castps_si128(passed);
+					__m128i stored = _mm_loadu_si128(reinterpret_cast<const __m128i*>(colors + quad));
+					stored = _mm_or_si128(_mm_and_si128(passedLanes, color), _mm_andnot_si128(passedLanes, stored));
+					_mm_storeu_si128(reinterpret_cast<__m128i*>(colors + quad), stored);
+				}
+			}
+
+			// Depths are never negative, so zero leaves out the lanes out of range.
+			spanMaxDepth = _mm_max_ps(spanMaxDepth, _mm_and_ps(_mm_castsi128_ps(inRange), storedDepth));
+		}
+
+		spanMaxDepth = _mm_max_ps(spanMaxDepth, _mm_shuffle_ps(spanMaxDepth, spanMaxDepth, _MM_SHUFFLE(1, 0, 3, 2)));
+		spanMaxDepth = _mm_max_ps(spanMaxDepth, _mm_shuffle_ps(spanMaxDepth, spanMaxDepth, _MM_SHUFFLE(2, 3, 0, 1)));
+		maxDepth = _mm_cvtss_f32(spanMaxDepth);
+	}
+#endif
+}
+
+DX::SoftwareRasterizer::SoftwareRasterizer(uint32_t width, uint32_t height, uint32_t threadCount) :
+	m_width(0),
+	m_height(0),
+	m_viewProjection(),
+	m_tilesX(0),
+	m_tilesY(0),
+	m_clearPending(false),
+	m_clearColor(0),
+	m_clearDepth(1.0f),
+	m_stats(),
+	m_workerStats((std::max)(threadCount, 1u)),
+	m_generation(0),
+	m_busyWorkers(0),
+	m_exiting(false),
+	m_nextTile(0)
+{
+	for (int i = 0; i < 4; i++)
+	{
+		m_viewProjection[i * 5] = 1.0f;
+	}
+
+	Resize(width, height);
+
+	for (uint32_t i = 1; i < threadCount; i++)
+	{
+		m_workers.emplace_back(&SoftwareRasterizer::WorkerLoop, this, i - 1);
+	}
+}
+
+DX::SoftwareRasterizer::~SoftwareRasterizer()
+{
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_exiting = true;
+	}
+	m_workReady.notify_all();
+
+	for (std::thread& worker : m_workers)
+	{
+		worker.join();
+	}
+}
+
+void DX::SoftwareRasterizer::Resize(uint32_t width, uint32_t height)
+{
+	m_width = width;
+	m_height = height;
+	m_pixels.resize(size_t(width) * height);
+	m_depth.resize(size_t(width) * height);
+
+	m_tilesX = (width + TileSize - 1) / TileSize;
+	m_tilesY = (height + TileSize - 1) / TileSize;
+	m_tiles.resize(size_t(m_tilesX) * m_tilesY);
+	for (Tile& tile : m_tiles)
+	{
+		tile.triangles.clear();
+		tile.maxDepth = std::numeric_limits<float>::infinity();
+	}
+
+	m_triangles.clear();
+	m_clearPending = false;
+}
+
+void DX::SoftwareRasterizer::Clear(const float color[4], float depth)
+{
+	m_triangles.clear();
+	for (Tile& tile : m_tiles)
+	{
+		tile.triangles.clear();
+	}
+
+	m_clearPending = true;
+	m_clearColor = PackColor(color[0], color[1], color[2], color[3]);
+	m_clearDepth = depth;
+}
+
+void DX::SoftwareRasterizer::SetViewProjection(const float view[16], const float projection[16])
+{
+	Multiply(view, projection, m_viewProjection);
+}
+
+// Transforms the vertices the indices use, then clips and sets up each triangle.
+void DX::SoftwareRasterizer::DrawIndexed(const BackendVertex* vertices, const uint16_t* indices, uint32_t indexCount, const float model[16])
+{
+	float modelViewProjection[16];
+	Multiply(model, m_viewProjection, modelViewProjection);
+
+	uint32_t vertexCount = 0;
+	for (uint32_t i = 0; i < indexCount; i++)
+	{
+		vertexCount = (std::max)(vertexCount, indices[i] + 1u);
+	}
+
+	m_clipVertices.resize(vertexCount);
+	for (uint32_t i = 0; i < vertexCount; i++)
+	{
+		const BackendVertex& vertex = vertices[i];
+		ClipVertex& clipVertex = m_clipVertices[i];
+		for (int column = 0; column < 4; column++)
+		{
+			clipVertex.position[column] =
+				vertex.position[0] * modelViewProjection[0 * 4 + column] +
+				vertex.position[1] * modelViewProjection[1 * 4 + column] +
+				vertex.position[2] * modelViewProjection[2 * 4 + column] +
+				modelViewProjection[3 * 4 + column];
+		}
+		memcpy(clipVertex.color, vertex.color, sizeof(clipVertex.color));
+	}
+
+	for (uint32_t i = 0; i + 2 < indexCount; i += 3)
+	{
+		m_stats.triangles++;
+
+		const ClipVertex triangle[3] = { m_clipVertices[indices[i]], m_clipVertices[indices[i + 1]], m_clipVertices[indices[i + 2]] };
+		ClipVertex polygon[MaxClippedVertices];
+		uint32_t polygonCount = ClipTriangle(triangle, polygon);
+		if (polygonCount < 3)
+		{
+			m_stats.trianglesClipped++;
+			continue;
+		}
+
+		for (uint32_t j = 1; j + 1 < polygonCount; j++)
+		{
+			SetupTriangle(polygon[0], polygon[j], polygon[j + 1]);
+		}
+	}
+}
+
+// Draws the tiles on every thread.
+void DX::SoftwareRasterizer::Flush()
+{
+	if (!m_clearPending && m_triangles.empty())
+	{
+		return;
+	}
+
+	for (Stats& stats : m_workerStats)
+	{
+		stats = {};
+	}
+	m_nextTile.store(0, std::memory_order_relaxed);
+
+	if (!m_workers.empty())
+	{
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+			m_generation++;
+			m_busyWorkers = static_cast<uint32_t>(m_workers.size());
+		}
+		m_workReady.notify_all();
+	}
+
+	DrawTiles(m_workerStats.back());
+
+	if (!m_workers.empty())
+	{
+		std::unique_lock<std::mutex> lock(m_mutex);
+		m_workDone.wait(lock, [this] { return m_busyWorkers == 0; });
+	}
+
+	for (const Stats& stats : m_workerStats)
+	{
+		m_stats.tilesTested += stats.tilesTested;
+		m_stats.tilesRejected += stats.tilesRejected;
+		m_stats.tilesCovered += stats.tilesCovered;
+		m_stats.pixelsTested += stats.pixelsTested;
+		m_stats.pixelsWritten += stats.pixelsWritten;
+	}
+
+	m_triangles.clear();
+	for (Tile& tile : m_tiles)
+	{
+		tile.triangles.clear();
+	}
+	m_clearPending = false;
+}
+
+void DX::SoftwareRasterizer::WorkerLoop(uint32_t workerIndex)
+{
+	uint64_t generation = 0;
+	for (;;)
+	{
+		{
+			std::unique_lock<std::mutex> lock(m_mutex);
+			m_workReady.wait(lock, [&] { return m_exiting || m_generation != generation; });
+			if (m_exiting)
+			{
+				return;
+			}
+			generation = m_generation;
+		}
+
+		DrawTiles(m_workerStats[workerIndex]);
+
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+			m_busyWorkers--;
+		}
+		m_workDone.notify_one();
+	}
+}
+
+void DX::SoftwareRasterizer::DrawTiles(Stats& stats)
+{
+	uint32_t tileCount = static_cast<uint32_t>(m_tiles.size());
+	for (uint32_t tile = m_nextTile.fetch_add(1, std::memory_order_relaxed); tile < tileCount; tile = m_nextTile.fetch_add(1, std::memory_order_relaxed))
+	{
+		DrawTile(tile, stats);
+	}
+}
+
+// Clips a triangle against each plane in turn, keeping the part inside. Returns the number of
+// vertices of the convex polygon that remains, which is less than three if nothing does.
+uint32_t DX::SoftwareRasterizer::ClipTriangle(const ClipVertex (&triangle)[3], ClipVertex* polygon) const
+{
+	// Most triangles are entirely inside, and need no clipping.
+	uint32_t outsideMask = 0;
+	for (uint32_t plane = 0; plane < ClipPlaneCount; plane++)
+	{
+		for (const ClipVertex& vertex : triangle)
+		{
+			if (PlaneDistance(vertex.position, plane) < 0.0f)
+			{
+				outsideMask |= 1u << plane;
+			}
+		}
+	}
+
+	std::copy(std::begin(triangle), std::end(triangle), polygon);
+	if (outsideMask == 0)
+	{
+		return 3;
+	}
+
+	uint32_t count = 3;
+	ClipVertex clipped[MaxClippedVertices];
+	for (uint32_t plane = 0; plane < ClipPlaneCount && count >= 3; plane++)
+	{
+		if ((outsideMask & (1u << plane)) == 0)
+		{
+			continue;
+		}
+
+		uint32_t clippedCount = 0;
+		for (uint32_t i = 0; i < count; i++)
+		{
+			const ClipVertex& current = polygon[i];
+			const ClipVertex& next = polygon[(i + 1) % count];
+			float currentDistance = PlaneDistance(current.position, plane);
+			float nextDistance = PlaneDistance(next.position, plane);
+
+			if (currentDistance >= 0.0f)
+			{
+				clipped[clippedCount++] = current;
+			}
+
+			// Add the point where the edge crosses the plane.
+			if ((currentDistance >= 0.0f) != (nextDistance >= 0.0f))
+			{
+				float t = currentDistance / (currentDistance - nextDistance);
+				ClipVertex& crossing = clipped[clippedCount++];
+				for (int c = 0; c < 4; c++)
+				{
+					crossing.position[c] = current.position[c] + (next.position[c] - current.position[c]) * t;
+				}
+				for (int c = 0; c < 3; c++)
+				{
+					crossing.color[c] = current.color[c] + (next.color[c] - current.color[c]) * t;
+				}
+			}
+		}
+
+		std::copy(clipped, clipped + clippedCount, polygon);
+		count = clippedCount;
+	}
+
+	return count;
+}
+
+
+// Snaps a triangle that lies inside the clip volume to the pixel grid and sets up its edges and
+// planes, then adds it to the tiles its bounds overlap. Pixels are covered where their centers
+// are inside every edge, or on a top or left edge. Depth is interpolated linearly on screen,
+// colors with perspective correction.
+void DX::SoftwareRasterizer::SetupTriangle(const ClipVertex& v0, const ClipVertex& v1, const ClipVertex& v2)
+{
+	const ClipVertex* vertices[3] = { &v0, &v1, &v2 };
+
+	int64_t x[3];
+	int64_t y[3];
+	double values[3][PlaneCount];
+	for (int i = 0; i < 3; i++)
+	{
+		const float* position = vertices[i]->position;
+		if (!(position[3] > 0.0f))
+		{
+			m_stats.trianglesCulled++;
+			return;
+		}
+
+		float inverseW = 1.0f / position[3];
+		float screenX = (position[0] * inverseW + 1.0f) * 0.5f * m_width;
+		float screenY = (1.0f - position[1] * inverseW) * 0.5f * m_height;
+		x[i] = static_cast<int64_t>(std::lround(screenX * SubpixelSteps));
+		y[i] = static_cast<int64_t>(std::lround(screenY * SubpixelSteps));
+
+		values[i][0] = position[2] * inverseW;
+		values[i][1] = inverseW;
+		for (int c = 0; c < 3; c++)
+		{
+			values[i][2 + c] = vertices[i]->color[c] * inverseW;
+		}
+	}
+
+	// Positive for triangles wound clockwise on screen, which are the front faces.
+	int64_t area = (x[1] - x[0]) * (y[2] - y[0]) - (x[2] - x[0]) * (y[1] - y[0]);
+	if (area <= 0)
+	{
+		m_stats.trianglesCulled++;
+		return;
+	}
+
+	m_stats.trianglesRasterized++;
+
+	// Pixels whose centers fall within the triangle's bounds, inside the target.
+	int64_t half = SubpixelSteps / 2;
+	int64_t minX = (std::max)(FloorDivide((std::min)({ x[0], x[1], x[2] }) - half + SubpixelSteps - 1, SubpixelSteps), int64_t(0));
+	int64_t minY = (std::max)(FloorDivide((std::min)({ y[0], y[1], y[2] }) - half + SubpixelSteps - 1, SubpixelSteps), int64_t(0));
+	int64_t maxX = (std::min)(FloorDivide((std::max)({ x[0], x[1], x[2] }) - half, SubpixelSteps), int64_t(m_width) - 1);
+	int64_t maxY = (std::min)(FloorDivide((std::max)({ y[0], y[1], y[2] }) - half, SubpixelSteps), int64_t(m_height) - 1);
+	if (minX > maxX || minY > maxY)
+	{
+		return;
+	}
+
+	Triangle triangle;
+	triangle.minX = static_cast<int32_t>(minX);
+	triangle.minY = static_cast<int32_t>(minY);
+	triangle.maxX = static_cast<int32_t>(maxX);
+	triangle.maxY = static_cast<int32_t>(maxY);
+
+	// Edge i runs opposite vertex i, and is positive on the inside. Pixels exactly on an edge
+	// are only covered if it is a top or a left edge, so that triangles sharing it cover each
+	// pixel once.
+	for (int i = 0; i < 3; i++)
+	{
+		int a = (i + 1) % 3;
+		int b = (i + 2) % 3;
+		int64_t dx = x[b] - x[a];
+		int64_t dy = y[b] - y[a];
+		bool topLeft = dy < 0 || (dy == 0 && dx > 0);
+
+		triangle.edgeA[i] = -dy * SubpixelSteps;
+		triangle.edgeB[i] = dx * SubpixelSteps;
+		triangle.edgeC[i] = dx * (half - y[a]) - dy * (half - x[a]) - (topLeft ? 0 : 1);
+	}
+
+	// Each value is a plane through the three vertices, in pixels.
+	double pixelX[3];
+	double pixelY[3];
+	for (int i = 0; i < 3; i++)
+	{
+		pixelX[i] = static_cast<double>(x[i]) / SubpixelSteps;
+		pixelY[i] = static_cast<double>(y[i]) / SubpixelSteps;
+	}
+
+	double pixelArea = static_cast<double>(area) / (SubpixelSteps * SubpixelSteps);
+	for (uint32_t p = 0; p < PlaneCount; p++)
+	{
+		double d1 = values[1][p] - values[0][p];
+		double d2 = values[2][p] - values[0][p];
+		double a = (d1 * (pixelY[2] - pixelY[0]) - d2 * (pixelY[1] - pixelY[0])) / pixelArea;
+		double b = ((pixelX[1] - pixelX[0]) * d2 - (pixelX[2] - pixelX[0]) * d1) / pixelArea;
+		triangle.planeA[p] = a;
+		triangle.planeB[p] = b;
+		triangle.planeC[p] = values[0][p] + (0.5 - pixelX[0]) * a + (0.5 - pixelY[0]) * b;
+	}
+
+	triangle.minDepth = static_cast<float>((std::min)({ values[0][0], values[1][0], values[2][0] }));
+
+	uint32_t index = static_cast<uint32_t>(m_triangles.size());
+	m_triangles.push_back(triangle);
+
+	for (int32_t tileY = triangle.minY / TileSize; tileY <= triangle.maxY / static_cast<int32_t>(TileSize); tileY++)
+	{
+		for (int32_t tileX = triangle.minX / TileSize; tileX <= triangle.maxX / static_cast<int32_t>(TileSize); tileX++)
+		{
+			m_tiles[size_t(tileY) * m_tilesX + tileX].triangles.push_back(index);
+		}
+	}
+}
+
+// Clears the tile if a clear is pending, then draws its triangles in the order they came.
+void DX::SoftwareRasterizer::DrawTile(uint32_t tileIndex, Stats& stats)
+{
+	Tile& tile = m_tiles[tileIndex];
+	int32_t tileX = static_cast<int32_t>(tileIndex % m_tilesX * TileSize);
+	int32_t tileY = static_cast<int32_t>(tileIndex / m_tilesX * TileSize);
+
+	if (m_clearPending)
+	{
+		uint32_t right = (std::min)(uint32_t(tileX) + TileSize, m_width);
+		uint32_t bottom = (std::min)(uint32_t(tileY) + TileSize, m_height);
+		for (uint32_t y = uint32_t(tileY); y < bottom; y++)
+		{
+			size_t row = size_t(y) * m_width;
+			std::fill(m_pixels.begin() + row + tileX, m_pixels.begin() + row + right, m_clearColor);
+			std::fill(m_depth.begin() + row + tileX, m_depth.begin() + row + right, m_clearDepth);
+		}
+		tile.maxDepth = m_clearDepth;
+	}
+
+	for (uint32_t triangle : tile.triangles)
+	{
+		DrawTriangle(tile, m_triangles[triangle], tileX, tileY, stats);
+	}
+}
+
+// Draws the part of a triangle inside one tile. Where the triangle is behind the whole tile it
+// is skipped, and where it covers the tile the edges aren't tested.
+void DX::SoftwareRasterizer::DrawTriangle(Tile& tile, const Triangle& triangle, int32_t tileX, int32_t tileY, Stats& stats)
+{
+	int32_t tileRight = (std::min)(tileX + static_cast<int32_t>(TileSize), static_cast<int32_t>(m_width));
+	int32_t tileBottom = (std::min)(tileY + static_cast<int32_t>(TileSize), static_cast<int32_t>(m_height));
+	int32_t x0 = (std::max)(triangle.minX, tileX);
+	int32_t y0 = (std::max)(triangle.minY, tileY);
+	int32_t x1 = (std::min)(triangle.maxX + 1, tileRight);
+	int32_t y1 = (std::min)(triangle.maxY + 1, tileBottom);
+
+	stats.tilesTested++;
+	if (triangle.minDepth >= tile.maxDepth)
+	{
+		stats.tilesRejected++;
+		return;
+	}
+
+	// Edges are linear, so their least and greatest values over the rectangle are at its corners.
+	bool covered = true;
+	for (int e = 0; e < 3; e++)
+	{
+		int64_t left = triangle.edgeC[e] + triangle.edgeA[e] * x0;
+		int64_t right = triangle.edgeC[e] + triangle.edgeA[e] * (x1 - 1);
+		int64_t top = triangle.edgeB[e] * y0;
+		int64_t bottom = triangle.edgeB[e] * (y1 - 1);
+		int64_t least = (std::min)(left, right) + (std::min)(top, bottom);
+		int64_t greatest = (std::max)(left, right) + (std::max)(top, bottom);
+		if (greatest < 0)
+		{
+			return;
+		}
+		covered = covered && least >= 0;
+	}
+
+	// Only a triangle that covers the whole tile tells how far its pixels are now.
+	bool whole = covered && x0 == tileX && y0 == tileY && x1 == tileRight && y1 == tileBottom;
+	if (whole)
+	{
+		stats.tilesCovered++;
+	}
+
+	SpanSetup setup;
+	setup.edgeA = triangle.edgeA;
+	setup.testEdges = !covered;
+	setup.firstX = x0;
+	setup.lastX = x1;
+	for (uint32_t p = 0; p < PlaneCount; p++)
+	{
+		setup.planeStepX[p] = static_cast<float>(triangle.planeA[p]);
+	}
+
+	uint32_t tested = 0;
+	uint32_t written = 0;
+	float maxDepth = 0.0f;
+	int32_t spanStart = tileX + (x0 - tileX) / SpanWidth * SpanWidth;
+	for (int32_t y = y0; y < y1; y++)
+	{
+		// Planes are evaluated from the tile's left edge, so that every tile draws the same
+		// pixels the same way, whichever thread draws it.
+		for (uint32_t p = 0; p < PlaneCount; p++)
+		{
+			setup.planeRow[p] = static_cast<float>(triangle.planeC[p] + triangle.planeA[p] * tileX + triangle.planeB[p] * y);
+		}
+
+		size_t row = size_t(y) * m_width;
+		for (int32_t x = spanStart; x < x1; x += SpanWidth)
+		{
+			int64_t edge[3];
+			for (int e = 0; e < 3; e++)
+			{
+				edge[e] = triangle.edgeC[e] + triangle.edgeA[e] * x + triangle.edgeB[e] * y;
+			}
+
+			uint32_t* colors = m_pixels.data() + row + x;
+			float* depths = m_depth.data() + row + x;
+#if DX_SOFTWARE_RASTERIZER_SSE2
+			if (x + SpanWidth <= static_cast<int32_t>(m_width))
+			{
+				DrawSpan(setup, x, edge, x - tileX, colors, depths, tested, written, maxDepth);
+				continue;
+			}
+#endif
+			DrawSpanScalar(setup, x, edge, x - tileX, colors, depths, tested, written, maxDepth);
+		}
+	}
+
+	stats.pixelsTested += tested;
+	stats.pixelsWritten += written;
+	if (whole)
+	{
+		tile.maxDepth = maxDepth;
+	}
+}
+
+DX::ImageDifference DX::CompareImages(const uint32_t* first, const uint32_t* second, uint32_t pixelCount, uint32_t tolerance)
+{
+	ImageDifference difference = {};
+	for (uint32_t i = 0; i < pixelCount; i++)
+	{
+		uint32_t largest = 0;
+		for (uint32_t shift = 0; shift < 32; shift += 8)
+		{
+			int32_t a = (first[i] >> shift) & 0xFF;
+			int32_t b = (second[i] >> shift) & 0xFF;
+			largest = (std::max)(largest, static_cast<uint32_t>(std::abs(a - b)));
+		}
+
+		if (largest > tolerance)
+		{
+			difference.differentPixels++;
+		}
+		difference.maxChannelDifference = (std::max)(difference.maxChannelDifference, largest);
+	}
+	return difference;
+}
+
+std::vector<uint8_t> DX::EncodePortablePixmap(const uint32_t* pixels, uint32_t width, uint32_t height)
+{
+	char header[64];
+	int headerSize = snprintf(header, sizeof(header), "P6\n%u %u\n255\n", width, height);
+
+	std::vector<uint8_t> data(header, header + headerSize);
+	data.reserve(data.size() + size_t(width) * height * 3);
+	for (size_t i = 0; i < size_t(width) * height; i++)
+	{
+		data.push_back(static_cast<uint8_t>(pixels[i] >> 16));
+		data.push_back(static_cast<uint8_t>(pixels[i] >> 8));
+		data.push_back(static_cast<uint8_t>(pixels[i]));
+	}
+	return data;
+}
+
+bool DX::DecodePortablePixmap(const uint8_t* data, size_t size, std::vector<uint32_t>& pixels, uint32_t& width, uint32_t& height)
+{
+	// The header is the magic number and three decimal fields, separated by whitespace and
+	// comments, followed by a single whitespace character.
+	size_t position = 0;
+	auto readField = [&](uint32_t& value)
+	{
+		while (position < size)
+		{
+			if (data[position] == '#')
+			{
+				while (position < size && data[position] != '\n')
+				{
+					position++;
+				}
+			}
+			else if (isspace(data[position]))
+			{
+				position++;
+			}
+			else
+			{
+				break;
+			}
+		}
+
+		uint64_t result = 0;
+		size_t start = position;
+		while (position < size && isdigit(data[position]) && result <= UINT32_MAX)
+		{
+			result = result * 10 + (data[position++] - '0');
+		}
+
+		value = static_cast<uint32_t>(result);
+		return position > start && result <= UINT32_MAX;
+	};
+
+	uint32_t maxValue = 0;
+	if (size < 2 || data[0] != 'P' || data[1] != '6')
+	{
+		return false;
+	}
+	position = 2;
+
+	if (!readField(width) || !readField(height) || !readField(maxValue) || maxValue != 255 ||
+		position >= size || !isspace(data[position]))
+	{
+		return false;
+	}
+	position++;
+
+	uint64_t pixelCount = uint64_t(width) * height;
+	if (pixelCount * 3 > size - position)
+	{
+		return false;
+	}
+
+	pixels.resize(static_cast<size_t>(pixelCount));
+	for (size_t i = 0; i < pixels.size(); i++)
+	{
+		const uint8_t* rgb = data + position + i * 3;
+		pixels[i] = 0xFF000000u | (uint32_t(rgb[0]) << 16) | (uint32_t(rgb[1]) << 8) | rgb[2];
+	}
+	return true;
+}
@@ -0,0 +1,171 @@
+﻿#pragma once
+
+#include "RenderBackend.h"
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace DX
+{
+	// Draws on the CPU into memory, following Direct3D's rasterization rules: pixel centers at
+	// half-pixel offsets, vertices snapped to 1/256 of a pixel, the top-left fill rule, and
+	// depth and colors interpolated as the hardware does. Triangles are clipped to the near and
+	// far planes, and to a guard band around the viewport, which covers the whole target.
+	//
+	// Draws are set up as they are submitted and binned into square tiles. Flush then draws
+	// the tiles on several threads, each tile's triangles in submission order, so the result
+	// doesn't depend on the thread count. Within a tile, a triangle is skipped if it is behind
+	// everything the tile already holds, and filled without edge tests where it covers all of
+	// it; elsewhere spans of eight pixels are tested at once, with SSE2 where it's available.
+	//
+	// It only uses the standard library, so frames can be drawn where there is no GPU or swap
+	// chain at all, to compare them with golden images or to time them. Results match a GPU to
+	// within rounding; compare images with a small tolerance.
+	class SoftwareRasterizer : public IRenderBackend
+	{
+	public:
+		// What the draws since the last ResetStats did.
+		struct Stats
+		{
+			uint64_t	triangles;				// Triangles submitted.
+			uint64_t	trianglesClipped;		// Entirely outside the clip volume.
+			uint64_t	trianglesCulled;		// Back facing or without area, counting each part clipping left.
+			uint64_t	trianglesRasterized;	// Drawn, counting each part clipping left.
+			uint64_t	tilesTested;			// Tiles that a drawn triangle's bounds overlapped.
+			uint64_t	tilesRejected;			// Of those, tiles whose depth hid the triangle.
+			uint64_t	tilesCovered;			// Of those, tiles the triangle covered entirely.
+			uint64_t	pixelsTested;			// Covered pixels that reached the depth test.
+			uint64_t	pixelsWritten;			// Pixels that passed it.
+		};
+
+		// Width and height of a tile in pixels.
+		static const uint32_t TileSize = 64;
+
+		// threadCount includes the thread that calls Flush.
+		SoftwareRasterizer(uint32_t width, uint32_t height, uint32_t threadCount = 1);
+		~SoftwareRasterizer();
+
+		// The contents are undefined after a resize, until the next Clear.
+		void Resize(uint32_t width, uint32_t height);
+
+		// IRenderBackend. Clear discards the draws that haven't been flushed, which it would
+		// cover anyway.
+		void Clear(const float color[4], float depth) override;
+		void SetViewProjection(const float view[16], const float projection[16]) override;
+		void DrawIndexed(const BackendVertex* vertices, const uint16_t* indices, uint32_t indexCount, const float model[16]) override;
+
+		// Draws everything submitted since the last Flush. Call it before reading the pixels.
+		void Flush();
+
+		uint32_t GetWidth() const					{ return m_width; }
+		uint32_t GetHeight() const					{ return m_height; }
+		uint32_t GetThreadCount() const				{ return static_cast<uint32_t>(m_workers.size()) + 1; }
+
+		// Pixels in rows from the top, in the back buffer's B8G8R8A8 format: blue in the lowest
+		// byte of each value on a little-endian machine.
+		const uint32_t* GetPixels() const			{ return m_pixels.data(); }
+		const float* GetDepth() const				{ return m_depth.data(); }
+
+		const Stats& GetStats() const				{ return m_stats; }
+		void ResetStats()							{ m_stats = {}; }
+
+	private:
+		// A vertex in clip space, with the attributes the pixel shader receives.
+		struct ClipVertex
+		{
+			float	position[4];
+			float	color[3];
+		};
+
+		// Clipping a triangle against six planes leaves at most nine vertices.
+		static const uint32_t MaxClippedVertices = 9;
+
+		// Values interpolated across a triangle: depth, 1/w, and the color divided by w.
+		static const uint32_t PlaneCount = 5;
+
+		// A triangle ready to draw. Edge i, opposite vertex i, is c + a * x + b * y at the center
+		// of pixel (x, y), in fixed point, and is at least 0 where the pixel is covered. Each
+		// plane holds an interpolated value at the center of pixel (x, y) as c + a * x + b * y.
+		struct Triangle
+		{
+			int64_t		edgeA[3];
+			int64_t		edgeB[3];
+			int64_t		edgeC[3];
+			double		planeA[PlaneCount];
+			double		planeB[PlaneCount];
+			double		planeC[PlaneCount];
+			float		minDepth;
+			int32_t		minX;
+			int32_t		minY;
+			int32_t		maxX;
+			int32_t		maxY;
+		};
+
+		struct Tile
+		{
+			std::vector<uint32_t>	triangles;		// Indices into m_triangles, in submission order.
+			float					maxDepth;		// No pixel of the tile is further than this.
+		};
+
+		uint32_t ClipTriangle(const ClipVertex (&triangle)[3], ClipVertex* polygon) const;
+		void SetupTriangle(const ClipVertex& v0, const ClipVertex& v1, const ClipVertex& v2);
+		void DrawTiles(Stats& stats);
+		void DrawTile(uint32_t tileIndex, Stats& stats);
+		void DrawTriangle(Tile& tile, const Triangle& triangle, int32_t tileX, int32_t tileY, Stats& stats);
+		void WorkerLoop(uint32_t workerIndex);
+
+		uint32_t				m_width;
+		uint32_t				m_height;
+		std::vector<uint32_t>	m_pixels;
+		std::vector<float>		m_depth;
+
+		// View times projection, set once per frame.
+		float					m_viewProjection[16];
+
+		// The vertices of the current draw in clip space, kept to avoid allocating per draw.
+		std::vector<ClipVertex>	m_clipVertices;
+
+		// Work for the next Flush.
+		std::vector<Triangle>	m_triangles;
+		std::vector<Tile>		m_tiles;
+		uint32_t				m_tilesX;
+		uint32_t				m_tilesY;
+		bool					m_clearPending;
+		uint32_t				m_clearColor;
+		float					m_clearDepth;
+
+		Stats					m_stats;
+
+		// Threads that help Flush. Each Flush starts a new generation of work, in which every
+		// thread takes the next tile until none are left.
+		std::vector<std::thread>	m_workers;
+		std::vector<Stats>			m_workerStats;
+		std::mutex					m_mutex;
+		std::condition_variable		m_workReady;
+		std::condition_variable		m_workDone;
+		uint64_t					m_generation;
+		uint32_t					m_busyWorkers;
+		bool						m_exiting;
+		std::atomic<uint32_t>		m_nextTile;
+	};
+
+	// How far two images of the same size differ, to compare a frame with a golden image.
+	struct ImageDifference
+	{
+		uint32_t	differentPixels;		// Pixels with a channel further apart than the tolerance.
+		uint32_t	maxChannelDifference;	// Largest difference of any channel of any pixel.
+	};
+
+	ImageDifference CompareImages(const uint32_t* first, const uint32_t* second, uint32_t pixelCount, uint32_t tolerance);
+
+	// Golden images are stored as binary PPM (P6): 8-bit RGB, no alpha, readable by most image
+	// tools. DecodePortablePixmap returns false if the data isn't such an image; pixels come back
+	// in the rasterizer's format, with opaque alpha.
+	std::vector<uint8_t> EncodePortablePixmap(const uint32_t* pixels, uint32_t width, uint32_t height);
+	bool DecodePortablePixmap(const uint8_t* data, size_t size, std::vector<uint32_t>& pixels, uint32_t& width, uint32_t& height);
+}
@@ -0,0 +1,250 @@
+﻿#pragma once
+
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+namespace DX
+{
+	// A vertex of a 2D primitive. Positions are in render target pixels, and the color is RGBA8
+	// with red in the lowest byte, not premultiplied.
+	struct SpriteVertex
+	{
+		float		x;
+		float		y;
+		float		u;
+		float		v;
+		uint32_t	color;
+	};
+
+	struct SpriteRect
+	{
+		float	left;
+		float	top;
+		float	right;
+		float	bottom;
+	};
+
+	// A 2D affine transform, laid out like D2D1_MATRIX_3X2_F: a point (x, y) maps to
+	// (x * m11 + y * m21 + dx, x * m12 + y * m22 + dy).
+	struct SpriteTransform
+	{
+		float	m11;
+		float	m12;
+		float	m21;
+		float	m22;
+		float	dx;
+		float	dy;
+	};
+
+	// A run of consecutive sprites that share a texture, drawn with one call. Sprite i of the
+	// frame uses vertices 4i to 4i + 3.
+	struct SpriteDraw
+	{
+		uint32_t	texture;
+		uint32_t	firstSprite;
+		uint32_t	spriteCount;
+	};
+
+	// Collects the 2D primitives of every overlay in a frame, so that they can be drawn from one
+	// vertex buffer with as few draw calls as possible. Every primitive is a quad: sprites, glyphs
+	// cut from an atlas, solid rectangles and lines. End sorts the quads by layer, then by texture,
+	// and merges quads with the same texture into one draw.
+	//
+	// Quads in the same layer are drawn in the order they were added only if they use the same
+	// texture, so put primitives that overlap and use different textures in different layers.
+	//
+	// The batch only knows textures by number, and holds no graphics API objects; see
+	// SpriteRenderer for the Direct3D side.
+	class SpriteBatch
+	{
+	public:
+		using TextureId = uint32_t;
+
+		// Solid color, drawn with a white texel.
+		static const TextureId NoTexture = 0;
+
+		// Quads per draw, so that 16-bit indices can address every vertex of a draw.
+		static const uint32_t MaxSpritesPerDraw = 16384;
+
+		SpriteBatch() :
+			m_transform{ 1.0f, 0.0f, 0.0f, 1.0f, 0.0f, 0.0f },
+			m_hasTransform(false)
+		{
+		}
+
+		// Starts a new frame, discarding the last one.
+		void Begin()
+		{
+			ResetTransform();
+			m_keys.clear();
+			m_quads.clear();
+			m_vertices.clear();
+			m_draws.clear();
+		}
+
+		// Transforms the positions of the primitives added from now on, for example to draw in
+		// DIPs on a rotated display.
+		void SetTransform(SpriteTransform const& transform)
+		{
+			m_transform = transform;
+			m_hasTransform = true;
+		}
+
+		void ResetTransform()
+		{
+			m_transform = { 1.0f, 0.0f, 0.0f, 1.0f, 0.0f, 0.0f };
+			m_hasTransform = false;
+		}
+
+		// A textured quad. Glyphs are quads like any other, cut from an atlas texture.
+		void DrawQuad(TextureId texture, SpriteRect const& destination, SpriteRect const& source, uint32_t color, uint16_t layer = 0)
+		{
+			Quad& quad = AddQuad(texture, layer);
+			quad.vertices[0] = { destination.left, destination.top, source.left, source.top, color };
+			quad.vertices[1] = { destination.right, destination.top, source.right, source.top, color };
+			quad.vertices[2] = { destination.left, destination.bottom, source.left, source.bottom, color };
+			quad.vertices[3] = { destination.right, destination.bottom, source.right, source.bottom, color };
+			Transform(quad);
+		}
+
+		void DrawRect(SpriteRect const& destination, uint32_t color, uint16_t layer = 0)
+		{
+			DrawQuad(NoTexture, destination, { 0.0f, 0.0f, 1.0f, 1.0f }, color, layer);
+		}
+
+		// A line thickness pixels wide, with square ends at the end points.
+		void DrawLine(float x0, float y0, float x1, float y1, float thickness, uint32_t color, uint16_t layer = 0)
+		{
+			float dx = x1 - x0;
+			float dy = y1 - y0;
+			float length = std::sqrt(dx * dx + dy * dy);
+			if (length <= 0.0f)
+			{
+				return;
+			}
+
+			// Half the thickness, across the line.
+			float nx = -dy / length * thickness * 0.5f;
+			float ny = dx / length * thickness * 0.5f;
+
+			Quad& quad = AddQuad(NoTexture, layer);
+			quad.vertices[0] = { x0 + nx, y0 + ny, 0.0f, 0.0f, color };
+			quad.vertices[1] = { x1 + nx, y1 + ny, 1.0f, 0.0f, color };
+			quad.vertices[2] = { x0 - nx, y0 - ny, 0.0f, 1.0f, color };
+			quad.vertices[3] = { x1 - nx, y1 - ny, 1.0f, 1.0f, color };
+			Transform(quad);
+		}
+
+		// Sorts the frame's quads and builds the vertices and draws.
+		void End()
+		{
+			SortKeys();
+
+			m_vertices.resize(m_quads.size() * 4);
+			SpriteVertex* vertex = m_vertices.data();
+			for (uint32_t i = 0; i < m_keys.size(); i++, vertex += 4)
+			{
+				uint32_t quad = m_keys[i].quad;
+				memcpy(vertex, m_quads[quad].vertices, sizeof(Quad::vertices));
+
+				TextureId texture = static_cast<TextureId>(m_keys[i].key);
+				if (m_draws.empty() || m_draws.back().texture != texture || m_draws.back().spriteCount == MaxSpritesPerDraw)
+				{
+					m_draws.push_back({ texture, i, 0 });
+				}
+				m_draws.back().spriteCount++;
+			}
+		}
+
+		size_t GetSpriteCount() const							{ return m_quads.size(); }
+		const std::vector<SpriteVertex>& GetVertices() const	{ return m_vertices; }
+		const std::vector<SpriteDraw>& GetDraws() const			{ return m_draws; }
+
+	private:
+		struct Quad
+		{
+			SpriteVertex	vertices[4];	// Top left, top right, bottom left, bottom right.
+		};
+
+		// The layer in bits 32 to 47 and the texture in the low 32 bits.
+		struct SortKey
+		{
+			uint64_t	key;
+			uint32_t	quad;
+		};
+
+		Quad& AddQuad(TextureId texture, uint16_t layer)
+		{
+			m_keys.push_back({ (static_cast<uint64_t>(layer) << 32) | texture, static_cast<uint32_t>(m_quads.size()) });
+			m_quads.emplace_back();
+			return m_quads.back();
+		}
+
+		void Transform(Quad& quad) const
+		{
+			if (!m_hasTransform)
+			{
+				return;
+			}
+
+			for (SpriteVertex& vertex : quad.vertices)
+			{
+				float x = vertex.x;
+				float y = vertex.y;
+				vertex.x = x * m_transform.m11 + y * m_transform.m21 + m_transform.dx;
+				vertex.y = x * m_transform.m12 + y * m_transform.m22 + m_transform.dy;
+			}
+		}
+
+		// A stable least significant digit radix sort, one byte at a time. Bytes that are the same
+		// in every key are skipped, so a frame that uses a few textures in one layer takes one or
+		// two passes rather than six.
+		void SortKeys()
+		{
+			const int digitCount = 6;
+			uint32_t counts[digitCount][256] = {};
+			for (const SortKey& key : m_keys)
+			{
+				for (int digit = 0; digit < digitCount; digit++)
+				{
+					counts[digit][(key.key >> (digit * 8)) & 0xFF]++;
+				}
+			}
+
+			m_sortBuffer.resize(m_keys.size());
+			for (int digit = 0; digit < digitCount; digit++)
+			{
+				uint32_t* count = counts[digit];
+				if (m_keys.empty() || count[(m_keys[0].key >> (digit * 8)) & 0xFF] == m_keys.size())
+				{
+					continue;
+				}
+
+				uint32_t offset = 0;
+				for (int i = 0; i < 256; i++)
+				{
+					uint32_t next = offset + count[i];
+					count[i] = offset;
+					offset = next;
+				}
+
+				for (const SortKey& key : m_keys)
+				{
+					m_sortBuffer[count[(key.key >> (digit * 8)) & 0xFF]++] = key;
+				}
+				m_keys.swap(m_sortBuffer);
+			}
+		}
+
+		std::vector<SortKey>		m_keys;
+		std::vector<SortKey>		m_sortBuffer;
+		std::vector<Quad>			m_quads;
+		std::vector<SpriteVertex>	m_vertices;
+		std::vector<SpriteDraw>		m_draws;
+		SpriteTransform				m_transform;
+		bool						m_hasTransform;
+	};
+}
@@ -0,0 +1,23 @@
+Texture2D spriteTexture : register(t0);
+SamplerState spriteSampler : register(s0);
+
+struct PixelShaderInput
+{
+	float4 pos : SV_POSITION;
+	float2 uv : TEXCOORD0;
+	float4 color : COLOR0;
+};
+
+// The value a GlyphAtlas stores at the edge of a shape.
+static const float edge = 128.0f / 255.0f;
+
+// Draws a distance field texture as a shape in the vertex color. The edge is smoothed over about
+// one pixel, measured by how fast the distance changes across the screen, so it stays sharp and
+// antialiased at any scale. The result is premultiplied, like the color shader's.
+float4 main(PixelShaderInput input) : SV_TARGET
+{
+	float distance = spriteTexture.Sample(spriteSampler, input.uv).r;
+	float width = max(fwidth(distance) * 0.5f, 0.001f);
+	float alpha = smoothstep(edge - width, edge + width, distance) * input.color.a;
+	return float4(input.color.rgb * alpha, alpha);
+}
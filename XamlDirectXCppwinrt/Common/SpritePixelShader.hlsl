@@ -0,0 +1,18 @@
+Texture2D spriteTexture : register(t0);
+SamplerState spriteSampler : register(s0);
+
+struct PixelShaderInput
+{
+	float4 pos : SV_POSITION;
+	float2 uv : TEXCOORD0;
+	float4 color : COLOR0;
+};
+
+// Textures and vertex colors have straight alpha. The result is premultiplied, which is what
+// the blend state expects.
+float4 main(PixelShaderInput input) : SV_TARGET
+{
+	float4 color = spriteTexture.Sample(spriteSampler, input.uv) * input.color;
+	color.rgb *= color.a;
+	return color;
+}
@@ -0,0 +1,242 @@
+﻿#include "pch.h"
+#include "SpriteRenderer.h"
+#include "Profiler.h"
+
+DX::SpriteRenderer::SpriteRenderer(const std::shared_ptr<DeviceResources>& deviceResources, const std::shared_ptr<ShaderLibrary>& shaderLibrary) :
+	m_deviceResources(deviceResources),
+	m_shaderLibrary(shaderLibrary),
+	m_spriteCapacity(0),
+	m_loadingComplete(false)
+{
+	// Texture 0 is SpriteBatch::NoTexture, which binds the white texel.
+	m_textures.push_back({ nullptr, SpriteTextureType::Color });
+	m_batch.Begin();
+}
+
+DX::SpriteRenderer::TextureId DX::SpriteRenderer::AddTexture(ID3D11ShaderResourceView* view, SpriteTextureType type)
+{
+	m_textures.push_back({ nullptr, type });
+	m_textures.back().view.copy_from(view);
+	return static_cast<TextureId>(m_textures.size() - 1);
+}
+
+void DX::SpriteRenderer::SetTexture(TextureId texture, ID3D11ShaderResourceView* view)
+{
+	m_textures[texture].view.copy_from(view);
+}
+
+winrt::fire_and_forget DX::SpriteRenderer::CreateDeviceDependentResourcesAsync()
+{
+	DX_PROFILE_SCOPE("SpriteRenderer::CreateDeviceDependentResourcesAsync");
+
+	auto device = m_deviceResources->GetD3DDevice();
+
+	ShaderVariant vertexShader;
+	co_await m_shaderLibrary->LoadAsync("SpriteVertexShader", 0, &vertexShader);
+	winrt::check_hresult(
+		device->CreateVertexShader(
+			vertexShader.bytecode.data,
+			vertexShader.bytecode.size,
+			nullptr,
+			m_vertexShader.put()));
+
+	const auto vertexDesc = SpriteVertexLayout::GetInputElements();
+	winrt::check_hresult(
+		device->CreateInputLayout(
+			vertexDesc.data(),
+			static_cast<UINT>(vertexDesc.size()),
+			vertexShader.bytecode.data,
+			vertexShader.bytecode.size,
+			m_inputLayout.put()));
+
+	ShaderVariant pixelShader;
+	co_await m_shaderLibrary->LoadAsync("SpritePixelShader", 0, &pixelShader);
+	winrt::check_hresult(
+		device->CreatePixelShader(
+			pixelShader.bytecode.data,
+			pixelShader.bytecode.size,
+			nullptr,
+			m_pixelShader.put()));
+
+	if (m_deviceResources->GetDeviceFeatureLevel() >= D3D_FEATURE_LEVEL_9_3)
+	{
+		ShaderVariant distanceFieldShader;
+		co_await m_shaderLibrary->LoadAsync("SpriteDistanceFieldPixelShader", 0, &distanceFieldShader);
+		winrt::check_hresult(
+			device->CreatePixelShader(
+				distanceFieldShader.bytecode.data,
+				distanceFieldShader.bytecode.size,
+				nullptr,
+				m_distanceFieldPixelShader.put()));
+	}
+
+	CD3D11_BUFFER_DESC constantBufferDesc(sizeof(SpriteConstantBuffer), D3D11_BIND_CONSTANT_BUFFER);
+	winrt::check_hresult(device->CreateBuffer(&constantBufferDesc, nullptr, m_constantBuffer.put()));
+
+	// Every draw uses the same quad indices, offset to its first sprite by the base vertex.
+	std::vector<uint16_t> indices(SpriteBatch::MaxSpritesPerDraw * 6);
+	for (uint32_t i = 0; i < SpriteBatch::MaxSpritesPerDraw; i++)
+	{
+		uint16_t vertex = static_cast<uint16_t>(i * 4);
+		uint16_t quad[6] = { vertex, static_cast<uint16_t>(vertex + 1), static_cast<uint16_t>(vertex + 2),
+			static_cast<uint16_t>(vertex + 2), static_cast<uint16_t>(vertex + 1), static_cast<uint16_t>(vertex + 3) };
+		memcpy(&indices[i * 6], quad, sizeof(quad));
+	}
+
+	D3D11_SUBRESOURCE_DATA indexBufferData = { indices.data(), 0, 0 };
+	CD3D11_BUFFER_DESC indexBufferDesc(static_cast<UINT>(indices.size() * sizeof(uint16_t)), D3D11_BIND_INDEX_BUFFER, D3D11_USAGE_IMMUTABLE);
+	winrt::check_hresult(device->CreateBuffer(&indexBufferDesc, &indexBufferData, m_indexBuffer.put()));
+
+	// The pixel shader premultiplies its output by alpha.
+	CD3D11_BLEND_DESC blendDesc(D3D11_DEFAULT);
+	blendDesc.RenderTarget[0].BlendEnable = TRUE;
+	blendDesc.RenderTarget[0].SrcBlend = D3D11_BLEND_ONE;
+	blendDesc.RenderTarget[0].DestBlend = D3D11_BLEND_INV_SRC_ALPHA;
+	blendDesc.RenderTarget[0].SrcBlendAlpha = D3D11_BLEND_ONE;
+	blendDesc.RenderTarget[0].DestBlendAlpha = D3D11_BLEND_INV_SRC_ALPHA;
+	winrt::check_hresult(device->CreateBlendState(&blendDesc, m_blendState.put()));
+
+	CD3D11_DEPTH_STENCIL_DESC depthStencilDesc(D3D11_DEFAULT);
+	depthStencilDesc.DepthEnable = FALSE;
+	winrt::check_hresult(device->CreateDepthStencilState(&depthStencilDesc, m_depthStencilState.put()));
+
+	CD3D11_RASTERIZER_DESC rasterizerDesc(D3D11_DEFAULT);
+	rasterizerDesc.CullMode = D3D11_CULL_NONE;
+	rasterizerDesc.ScissorEnable = TRUE;
+	winrt::check_hresult(device->CreateRasterizerState(&rasterizerDesc, m_rasterizerState.put()));
+
+	CD3D11_SAMPLER_DESC samplerDesc(D3D11_DEFAULT);
+	winrt::check_hresult(device->CreateSamplerState(&samplerDesc, m_sampler.put()));
+
+	const uint32_t white = 0xFFFFFFFF;
+	D3D11_SUBRESOURCE_DATA whiteData = { &white, sizeof(white), 0 };
+	CD3D11_TEXTURE2D_DESC whiteDesc(DXGI_FORMAT_R8G8B8A8_UNORM, 1, 1, 1, 1, D3D11_BIND_SHADER_RESOURCE, D3D11_USAGE_IMMUTABLE);
+	winrt::com_ptr<ID3D11Texture2D> whiteTexture;
+	winrt::check_hresult(device->CreateTexture2D(&whiteDesc, &whiteData, whiteTexture.put()));
+	winrt::check_hresult(device->CreateShaderResourceView(whiteTexture.get(), nullptr, m_whiteTexture.put()));
+
+	m_loadingComplete = true;
+}
+
+// The texture views belong to their owners, who set them again after the device is restored.
+void DX::SpriteRenderer::ReleaseDeviceDependentResources()
+{
+	m_loadingComplete = false;
+	m_vertexShader = nullptr;
+	m_pixelShader = nullptr;
+	m_distanceFieldPixelShader = nullptr;
+	m_inputLayout = nullptr;
+	m_constantBuffer = nullptr;
+	m_vertexBuffer = nullptr;
+	m_indexBuffer = nullptr;
+	m_blendState = nullptr;
+	m_depthStencilState = nullptr;
+	m_rasterizerState = nullptr;
+	m_sampler = nullptr;
+	m_whiteTexture = nullptr;
+	m_spriteCapacity = 0;
+	for (auto& texture : m_textures)
+	{
+		texture.view = nullptr;
+	}
+}
+
+// Grows by half again each time, so a frame with slightly more sprites than the last doesn't
+// recreate the buffer every frame.
+void DX::SpriteRenderer::CreateVertexBuffer(uint32_t spriteCapacity)
+{
+	m_spriteCapacity = (std::max)(spriteCapacity, m_spriteCapacity + m_spriteCapacity / 2);
+	m_vertexBuffer = nullptr;
+
+	CD3D11_BUFFER_DESC vertexBufferDesc(
+		m_spriteCapacity * 4 * sizeof(SpriteVertex),
+		D3D11_BIND_VERTEX_BUFFER,
+		D3D11_USAGE_DYNAMIC,
+		D3D11_CPU_ACCESS_WRITE);
+	winrt::check_hresult(m_deviceResources->GetD3DDevice()->CreateBuffer(&vertexBufferDesc, nullptr, m_vertexBuffer.put()));
+}
+
+// Draws the frame's batch and begins the next. Leaves the blend, depth stencil and rasterizer
+// states at their defaults, which the other renderers assume.
+void DX::SpriteRenderer::Render(ID3D11DeviceContext3* context)
+{
+	m_batch.End();
+
+	const auto& vertices = m_batch.GetVertices();
+	if (!m_loadingComplete || vertices.empty())
+	{
+		m_batch.Begin();
+		return;
+	}
+
+	uint32_t spriteCount = static_cast<uint32_t>(m_batch.GetSpriteCount());
+	if (spriteCount > m_spriteCapacity)
+	{
+		CreateVertexBuffer(spriteCount);
+	}
+
+	// The whole frame is written with one map, discarding the last frame's vertices.
+	D3D11_MAPPED_SUBRESOURCE mapped;
+	winrt::check_hresult(context->Map(m_vertexBuffer.get(), 0, D3D11_MAP_WRITE_DISCARD, 0, &mapped));
+	memcpy(mapped.pData, vertices.data(), vertices.size() * sizeof(SpriteVertex));
+	context->Unmap(m_vertexBuffer.get(), 0);
+
+	D3D11_VIEWPORT viewport = m_deviceResources->GetScreenViewport();
+	SpriteConstantBuffer constants = { { 2.0f / viewport.Width, -2.0f / viewport.Height }, { -1.0f, 1.0f } };
+	context->UpdateSubresource1(m_constantBuffer.get(), 0, nullptr, &constants, 0, 0, 0);
+
+	UINT stride = sizeof(SpriteVertex);
+	UINT offset = 0;
+	ID3D11Buffer* vertexBuffer = m_vertexBuffer.get();
+	ID3D11Buffer* constantBuffer = m_constantBuffer.get();
+	ID3D11SamplerState* sampler = m_sampler.get();
+	context->IASetVertexBuffers(0, 1, &vertexBuffer, &stride, &offset);
+	context->IASetIndexBuffer(m_indexBuffer.get(), DXGI_FORMAT_R16_UINT, 0);
+	context->IASetPrimitiveTopology(D3D11_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
+	context->IASetInputLayout(m_inputLayout.get());
+	context->VSSetShader(m_vertexShader.get(), nullptr, 0);
+	context->VSSetConstantBuffers1(SpriteConstantBufferLayout.registerIndex, 1, &constantBuffer, nullptr, nullptr);
+	context->PSSetSamplers(0, 1, &sampler);
+	context->OMSetBlendState(m_blendState.get(), nullptr, 0xFFFFFFFF);
+	context->OMSetDepthStencilState(m_depthStencilState.get(), 0);
+	context->RSSetState(m_rasterizerState.get());
+
+	ID3D11PixelShader* currentShader = nullptr;
+	for (const SpriteDraw& draw : m_batch.GetDraws())
+	{
+		const Texture* texture = (draw.texture < m_textures.size()) ? &m_textures[draw.texture] : nullptr;
+		ID3D11ShaderResourceView* view = (texture != nullptr) ? texture->view.get() : nullptr;
+		ID3D11PixelShader* shader = m_pixelShader.get();
+		if (texture != nullptr && texture->type == SpriteTextureType::DistanceField)
+		{
+			// A white texel would fill the glyphs' whole quads, so skip these instead.
+			shader = m_distanceFieldPixelShader.get();
+			if (shader == nullptr || view == nullptr)
+			{
+				continue;
+			}
+		}
+		else if (view == nullptr)
+		{
+			// Untextured, or a texture that isn't loaded yet.
+			view = m_whiteTexture.get();
+		}
+
+		if (shader != currentShader)
+		{
+			context->PSSetShader(shader, nullptr, 0);
+			currentShader = shader;
+		}
+
+		context->PSSetShaderResources(0, 1, &view);
+		context->DrawIndexed(draw.spriteCount * 6, 0, static_cast<INT>(draw.firstSprite * 4));
+	}
+
+	ID3D11ShaderResourceView* nullView = nullptr;
+	context->PSSetShaderResources(0, 1, &nullView);
+	context->OMSetBlendState(nullptr, nullptr, 0xFFFFFFFF);
+	context->OMSetDepthStencilState(nullptr, 0);
+	context->RSSetState(nullptr);
+
+	m_batch.Begin();
+}
@@ -0,0 +1,100 @@
+﻿#pragma once
+
+#include "DeviceResources.h"
+#include "ShaderLibrary.h"
+#include "ShaderReflection.h"
+#include "SpriteBatch.h"
+#include "VertexLayout.h"
+
+namespace DX
+{
+	// SpriteVertex as the input assembler reads it.
+	using SpriteVertexLayout = VertexLayout<
+		VertexAttribute<VertexSemantic::Position, VertexFormat::Float2>,
+		VertexAttribute<VertexSemantic::TexCoord, VertexFormat::Float2>,
+		VertexAttribute<VertexSemantic::Color, VertexFormat::Unorm8x4>>;
+
+	static_assert(SpriteVertexLayout::Stride == sizeof(SpriteVertex), "SpriteVertexLayout doesn't match SpriteVertex.");
+	static_assert(SpriteVertexLayout::GetOffset(1) == offsetof(SpriteVertex, u), "SpriteVertexLayout doesn't match SpriteVertex.");
+	static_assert(SpriteVertexLayout::GetOffset(2) == offsetof(SpriteVertex, color), "SpriteVertexLayout doesn't match SpriteVertex.");
+
+	// Maps render target pixels to clip space: clip = pixel * scale + offset.
+	struct SpriteConstantBuffer
+	{
+		DirectX::XMFLOAT2 scale;
+		DirectX::XMFLOAT2 offset;
+	};
+
+	constexpr auto SpriteConstantBufferLayout = DescribeConstantBuffer<SpriteConstantBuffer>(
+		"SpriteConstantBuffer", 0,
+		DX_SHADER_FIELD(SpriteConstantBuffer, scale, Float2),
+		DX_SHADER_FIELD(SpriteConstantBuffer, offset, Float2));
+
+	static_assert(MatchesShaderPacking(SpriteConstantBufferLayout), "SpriteConstantBuffer doesn't match HLSL packing.");
+
+	// How a texture's texels are drawn. Color textures are RGBA with straight alpha. Distance
+	// field textures hold a single channel signed distance, as a GlyphAtlas makes, and are drawn
+	// as a shape in the vertex color with an edge antialiased to one pixel at any scale.
+	enum class SpriteTextureType
+	{
+		Color,
+		DistanceField,
+	};
+
+	// Draws a SpriteBatch with Direct3D. Overlays add their primitives to the batch during the
+	// frame, instead of each starting its own Direct2D drawing session, and Render then draws them
+	// all from one dynamic vertex buffer, one draw call per run of quads that share a texture.
+	// Quads are alpha blended and drawn without depth, within the caller's scissor rectangle.
+	//
+	// The distance field shader needs screen space derivatives, which feature levels 9_1 and 9_2
+	// lack; on those devices quads with distance field textures aren't drawn.
+	class SpriteRenderer
+	{
+	public:
+		using TextureId = SpriteBatch::TextureId;
+
+		SpriteRenderer(const std::shared_ptr<DeviceResources>& deviceResources, const std::shared_ptr<ShaderLibrary>& shaderLibrary);
+		winrt::fire_and_forget CreateDeviceDependentResourcesAsync();
+		void ReleaseDeviceDependentResources();
+
+		// Textures are known to the batch by number. A texture's view may change from frame to
+		// frame, as streamed textures' do; set it again before the frame is rendered.
+		TextureId AddTexture(ID3D11ShaderResourceView* view = nullptr, SpriteTextureType type = SpriteTextureType::Color);
+		void SetTexture(TextureId texture, ID3D11ShaderResourceView* view);
+
+		// The batch for the current frame. Render begins the next one.
+		SpriteBatch& GetBatch() { return m_batch; }
+
+		void Render(ID3D11DeviceContext3* context);
+
+	private:
+		struct Texture
+		{
+			winrt::com_ptr<ID3D11ShaderResourceView>	view;
+			SpriteTextureType							type;
+		};
+
+		void CreateVertexBuffer(uint32_t spriteCapacity);
+
+		std::shared_ptr<DeviceResources>			m_deviceResources;
+		std::shared_ptr<ShaderLibrary>				m_shaderLibrary;
+
+		SpriteBatch									m_batch;
+		std::vector<Texture>						m_textures;
+
+		winrt::com_ptr<ID3D11VertexShader>			m_vertexShader;
+		winrt::com_ptr<ID3D11PixelShader>			m_pixelShader;
+		winrt::com_ptr<ID3D11PixelShader>			m_distanceFieldPixelShader;
+		winrt::com_ptr<ID3D11InputLayout>			m_inputLayout;
+		winrt::com_ptr<ID3D11Buffer>				m_constantBuffer;
+		winrt::com_ptr<ID3D11Buffer>				m_vertexBuffer;
+		winrt::com_ptr<ID3D11Buffer>				m_indexBuffer;
+		winrt::com_ptr<ID3D11BlendState>			m_blendState;
+		winrt::com_ptr<ID3D11DepthStencilState>		m_depthStencilState;
+		winrt::com_ptr<ID3D11RasterizerState>		m_rasterizerState;
+		winrt::com_ptr<ID3D11SamplerState>			m_sampler;
+		winrt::com_ptr<ID3D11ShaderResourceView>	m_whiteTexture;
+		uint32_t									m_spriteCapacity;
+		bool										m_loadingComplete;
+	};
+}
@@ -0,0 +1,30 @@
+// Matches DX::SpriteConstantBufferLayout in SpriteRenderer.h.
+cbuffer SpriteConstantBuffer : register(b0)
+{
+	float2 scale;
+	float2 offset;
+};
+
+struct VertexShaderInput
+{
+	float2 pos : POSITION;
+	float2 uv : TEXCOORD0;
+	float4 color : COLOR0;
+};
+
+struct PixelShaderInput
+{
+	float4 pos : SV_POSITION;
+	float2 uv : TEXCOORD0;
+	float4 color : COLOR0;
+};
+
+// Maps render target pixels to clip space.
+PixelShaderInput main(VertexShaderInput input)
+{
+	PixelShaderInput output;
+	output.pos = float4(input.pos * scale + offset, 0.0f, 1.0f);
+	output.uv = input.uv;
+	output.color = input.color;
+	return output;
+}
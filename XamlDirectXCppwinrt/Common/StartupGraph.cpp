@@ -0,0 +1,225 @@
+﻿// Doesn't use the precompiled header, so that tools can build it without the Windows headers.
+#include "StartupGraph.h"
+#include "Profiler.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <thread>
+
+DX::StartupGraph::StageId DX::StartupGraph::AddStage(const char* name, std::initializer_list<StageId> dependencies, StartupThread thread, std::function<void()> work)
+{
+	StageId id = static_cast<StageId>(m_stages.size());
+	for (StageId dependency : dependencies)
+	{
+		m_stages[dependency].dependents.push_back(id);
+	}
+
+	m_stages.push_back({ name, thread, std::move(work), dependencies, {}, 0, false });
+	return id;
+}
+
+uint32_t DX::StartupGraph::GetDefaultWorkerCount()
+{
+	return (std::max)(std::thread::hardware_concurrency(), 2u) - 1;
+}
+
+void DX::StartupGraph::Run(uint32_t workerCount)
+{
+	m_timeline.assign(m_stages.size(), StartupStageTiming());
+	m_readyAny.clear();
+	m_readyCalling.clear();
+	m_finishedCount = 0;
+	m_exception = nullptr;
+
+	for (StageId id = 0; id < m_stages.size(); id++)
+	{
+		Stage& stage = m_stages[id];
+		stage.waitingFor = static_cast<uint32_t>(stage.dependencies.size());
+		stage.skipped = false;
+		if (stage.waitingFor == 0)
+		{
+			(stage.thread == StartupThread::Calling ? m_readyCalling : m_readyAny).push_back(id);
+		}
+	}
+
+	m_start = std::chrono::steady_clock::now();
+
+	std::vector<std::thread> workers;
+	for (uint32_t i = 0; i < workerCount; i++)
+	{
+		workers.emplace_back([this, i]
+		{
+			DX_PROFILE_THREAD_NAME("Startup");
+			RunStages(i + 1);
+		});
+	}
+
+	RunStages(0);
+
+	for (std::thread& worker : workers)
+	{
+		worker.join();
+	}
+
+	m_totalMilliseconds = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - m_start).count();
+
+	if (m_exception)
+	{
+		std::rethrow_exception(m_exception);
+	}
+}
+
+// Runs ready stages until every stage has finished.
+void DX::StartupGraph::RunStages(uint32_t threadIndex)
+{
+	std::unique_lock<std::mutex> lock(m_mutex);
+	while (m_finishedCount < m_stages.size())
+	{
+		StageId id;
+		if (!TakeStage(threadIndex, id))
+		{
+			m_stageReady.wait(lock);
+			continue;
+		}
+
+		Stage& stage = m_stages[id];
+		lock.unlock();
+
+		auto start = std::chrono::steady_clock::now();
+		std::exception_ptr exception;
+		if (!stage.skipped)
+		{
+			try
+			{
+				DX_PROFILE_SCOPE(stage.name);
+				stage.work();
+			}
+			catch (...)
+			{
+				exception = std::current_exception();
+			}
+		}
+		auto end = std::chrono::steady_clock::now();
+
+		lock.lock();
+		StartupStageTiming& timing = m_timeline[id];
+		timing.name = stage.name;
+		timing.thread = threadIndex;
+		timing.startMilliseconds = std::chrono::duration<double, std::milli>(start - m_start).count();
+		timing.endMilliseconds = std::chrono::duration<double, std::milli>(end - m_start).count();
+		timing.skipped = stage.skipped;
+
+		if (exception && !m_exception)
+		{
+			m_exception = exception;
+		}
+		FinishStage(id, exception != nullptr);
+	}
+}
+
+// Takes the oldest ready stage this thread may run. The calling thread runs its own stages
+// first, since no other thread can.
+bool DX::StartupGraph::TakeStage(uint32_t threadIndex, StageId& stage)
+{
+	if (threadIndex == 0 && !m_readyCalling.empty())
+	{
+		stage = m_readyCalling.front();
+		m_readyCalling.pop_front();
+		return true;
+	}
+
+	if (!m_readyAny.empty())
+	{
+		stage = m_readyAny.front();
+		m_readyAny.pop_front();
+		return true;
+	}
+
+	return false;
+}
+
+// Makes the stages that were only waiting for this one ready, and skips them if it failed.
+void DX::StartupGraph::FinishStage(StageId id, bool failed)
+{
+	const Stage& stage = m_stages[id];
+	for (StageId dependentId : stage.dependents)
+	{
+		Stage& dependent = m_stages[dependentId];
+		dependent.skipped = dependent.skipped || failed || stage.skipped;
+		if (--dependent.waitingFor == 0)
+		{
+			(dependent.thread == StartupThread::Calling ? m_readyCalling : m_readyAny).push_back(dependentId);
+		}
+	}
+
+	m_finishedCount++;
+	m_stageReady.notify_all();
+}
+
+// Stages only depend on earlier ones, so a single pass in order finds the longest path.
+std::vector<DX::StartupGraph::StageId> DX::StartupGraph::GetCriticalPath() const
+{
+	if (m_timeline.size() != m_stages.size() || m_stages.empty())
+	{
+		return {};
+	}
+
+	std::vector<double> pathEnd(m_stages.size());
+	std::vector<StageId> previous(m_stages.size());
+	StageId last = 0;
+	for (StageId id = 0; id < m_stages.size(); id++)
+	{
+		double start = 0.0;
+		previous[id] = id;
+		for (StageId dependency : m_stages[id].dependencies)
+		{
+			if (pathEnd[dependency] > start)
+			{
+				start = pathEnd[dependency];
+				previous[id] = dependency;
+			}
+		}
+
+		pathEnd[id] = start + (m_timeline[id].endMilliseconds - m_timeline[id].startMilliseconds);
+		last = (pathEnd[id] > pathEnd[last]) ? id : last;
+	}
+
+	std::vector<StageId> path = { last };
+	while (previous[path.back()] != path.back())
+	{
+		path.push_back(previous[path.back()]);
+	}
+	std::reverse(path.begin(), path.end());
+	return path;
+}
+
+double DX::StartupGraph::GetCriticalPathMilliseconds() const
+{
+	double milliseconds = 0.0;
+	for (StageId id : GetCriticalPath())
+	{
+		milliseconds += m_timeline[id].endMilliseconds - m_timeline[id].startMilliseconds;
+	}
+	return milliseconds;
+}
+
+void DX::StartupGraph::WriteTimeline(std::ostream& stream) const
+{
+	std::vector<StageId> criticalPath = GetCriticalPath();
+
+	char line[256];
+	snprintf(line, sizeof(line), "  %-24s %6s %10s %10s %10s\n", "Stage", "Thread", "Start ms", "End ms", "Took ms");
+	stream << line;
+	for (StageId id = 0; id < m_timeline.size(); id++)
+	{
+		const StartupStageTiming& timing = m_timeline[id];
+		bool critical = std::find(criticalPath.begin(), criticalPath.end(), id) != criticalPath.end();
+		snprintf(line, sizeof(line), "%c %-24s %6u %10.2f %10.2f %10.2f%s\n",
+			critical ? '*' : ' ', timing.name, timing.thread, timing.startMilliseconds, timing.endMilliseconds,
+			timing.endMilliseconds - timing.startMilliseconds, timing.skipped ? " skipped" : "");
+		stream << line;
+	}
+
+	snprintf(line, sizeof(line), "Total %.2f ms, critical path (*) %.2f ms\n", m_totalMilliseconds, GetCriticalPathMilliseconds());
+	stream << line;
+}
@@ -0,0 +1,104 @@
+﻿#pragma once
+
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <initializer_list>
+#include <mutex>
+#include <ostream>
+#include <vector>
+
+namespace DX
+{
+	// Which threads may run a startup stage. Stages that touch XAML or other objects bound to
+	// the UI thread run on the thread that calls Run.
+	enum class StartupThread
+	{
+		Any,
+		Calling
+	};
+
+	// When a stage ran, in milliseconds from the start of Run. Thread 0 is the calling thread.
+	struct StartupStageTiming
+	{
+		const char*	name;
+		uint32_t	thread;
+		double		startMilliseconds;
+		double		endMilliseconds;
+		bool		skipped;	// A stage it depends on failed, so it didn't run.
+	};
+
+	// Runs the stages of app startup, each as soon as the stages it depends on have finished, so
+	// that independent stages such as creating the Direct3D device and loading a font overlap
+	// instead of following each other. Stages can only depend on stages added before them, so
+	// the graph never has cycles.
+	//
+	// It only uses the standard library, so the same graph can be timed with synthetic stages on
+	// any platform; see Tools\StartupBenchmark.cpp.
+	class StartupGraph
+	{
+	public:
+		using StageId = uint32_t;
+
+		StartupGraph() = default;
+		StartupGraph(const StartupGraph&) = delete;
+		StartupGraph& operator=(const StartupGraph&) = delete;
+
+		// Names must be string literals or otherwise outlive the graph.
+		StageId AddStage(const char* name, std::initializer_list<StageId> dependencies, StartupThread thread, std::function<void()> work);
+
+		// Runs every stage once, on the calling thread and on workerCount other threads, and
+		// returns when all have finished. If a stage throws, the stages that depend on it are
+		// skipped, and the first exception is rethrown once the others have finished. With no
+		// workers every stage runs on the calling thread, one after another.
+		void Run(uint32_t workerCount);
+
+		// One worker per hardware thread besides the calling one, and at least one, since
+		// startup stages spend much of their time waiting for the driver or the disk.
+		static uint32_t GetDefaultWorkerCount();
+
+		// The stages in the order they were added, once Run has returned.
+		const std::vector<StartupStageTiming>& GetTimeline() const	{ return m_timeline; }
+		double GetTotalMilliseconds() const							{ return m_totalMilliseconds; }
+
+		// The longest chain of dependent stages, by how long each took: no number of threads
+		// starts up faster than this.
+		double GetCriticalPathMilliseconds() const;
+
+		// The timeline as a table, with the stages on the critical path marked.
+		void WriteTimeline(std::ostream& stream) const;
+
+	private:
+		struct Stage
+		{
+			const char*				name;
+			StartupThread			thread;
+			std::function<void()>	work;
+			std::vector<StageId>	dependencies;
+			std::vector<StageId>	dependents;
+			uint32_t				waitingFor;		// Dependencies that haven't finished.
+			bool					skipped;
+		};
+
+		void RunStages(uint32_t threadIndex);
+		bool TakeStage(uint32_t threadIndex, StageId& stage);
+		void FinishStage(StageId stage, bool failed);
+		std::vector<StageId> GetCriticalPath() const;
+
+		std::vector<Stage>				m_stages;
+		std::vector<StartupStageTiming>	m_timeline;
+		std::chrono::steady_clock::time_point	m_start;
+		double							m_totalMilliseconds = 0.0;
+
+		// Stages whose dependencies have all finished, in the order they became ready.
+		std::mutex						m_mutex;
+		std::condition_variable			m_stageReady;
+		std::deque<StageId>				m_readyAny;
+		std::deque<StageId>				m_readyCalling;
+		size_t							m_finishedCount = 0;
+		std::exception_ptr				m_exception;
+	};
+}
@@ -0,0 +1,212 @@
+﻿#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <type_traits>
+#include <vector>
+
+namespace DX
+{
+	// A state snapshot records simulation state, such as the clock and the transforms of a scene,
+	// in a compact blob that can be kept in the app's settings while it is suspended. It holds:
+	//
+	//   StateSnapshotHeader
+	//   sections				Each a StateSnapshotSection followed by its data, padded to 4 bytes.
+	//
+	// Each part of the app writes its state as one section of plain data under its own tag.
+	// Readers skip sections they don't know, and a section that is missing or changed size keeps
+	// the reader's defaults, so a snapshot from an older version of the app restores what still
+	// fits. All values are little-endian, as on every platform Direct3D runs on.
+	const uint32_t StateSnapshotMagic = 0x53535844;	// "DXSS"
+	const uint32_t StateSnapshotVersion = 1;
+
+	struct StateSnapshotHeader
+	{
+		uint32_t	magic;
+		uint32_t	version;
+		uint32_t	size;			// Of the whole snapshot, header included.
+		uint32_t	checksum;		// HashStateSnapshot of everything after the header.
+	};
+
+	struct StateSnapshotSection
+	{
+		uint32_t	tag;
+		uint32_t	size;			// Of the data, without padding.
+	};
+
+	static_assert(sizeof(StateSnapshotHeader) == 16, "The snapshot header layout is part of the format.");
+	static_assert(sizeof(StateSnapshotSection) == 8, "The snapshot section layout is part of the format.");
+
+	// Tags read as four characters in a hex dump, e.g. MakeStateSnapshotTag('T', 'I', 'M', 'E').
+	constexpr uint32_t MakeStateSnapshotTag(char a, char b, char c, char d)
+	{
+		return uint32_t(uint8_t(a)) | (uint32_t(uint8_t(b)) << 8) | (uint32_t(uint8_t(c)) << 16) | (uint32_t(uint8_t(d)) << 24);
+	}
+
+	// FNV-1a over 64-bit words rather than bytes, with a shift to spread the high bits down, folded
+	// to 32 bits. Large scenes hash several times faster than a byte at a time.
+	inline uint32_t HashStateSnapshot(const uint8_t* data, size_t size)
+	{
+		uint64_t hash = 14695981039346656037ull;
+		size_t i = 0;
+		for (; i + sizeof(uint64_t) <= size; i += sizeof(uint64_t))
+		{
+			uint64_t word;
+			memcpy(&word, data + i, sizeof(word));
+			hash = (hash ^ word) * 1099511628211ull;
+			hash ^= hash >> 29;
+		}
+		for (; i < size; i++)
+		{
+			hash = (hash ^ data[i]) * 1099511628211ull;
+		}
+		return static_cast<uint32_t>(hash ^ (hash >> 32));
+	}
+
+	class StateSnapshotWriter
+	{
+	public:
+		StateSnapshotWriter() :
+			m_data(sizeof(StateSnapshotHeader), 0)
+		{
+		}
+
+		// Adds a section. Writing a tag twice adds two sections, of which readers find the first.
+		void Write(uint32_t tag, const void* data, size_t size)
+		{
+			StateSnapshotSection section = { tag, static_cast<uint32_t>(size) };
+			size_t offset = m_data.size();
+			m_data.resize(offset + sizeof(section) + (size + 3) / 4 * 4, 0);
+			memcpy(m_data.data() + offset, &section, sizeof(section));
+			if (size != 0)
+			{
+				memcpy(m_data.data() + offset + sizeof(section), data, size);
+			}
+		}
+
+		// State is written as it is laid out in memory, so it must be plain data without pointers.
+		template<typename TState>
+		void Write(uint32_t tag, const TState& state)
+		{
+			static_assert(std::is_trivially_copyable<TState>::value, "Snapshot state must be plain data.");
+			Write(tag, &state, sizeof(state));
+		}
+
+		// Completes the header. The writer can't be used afterwards.
+		std::vector<uint8_t> Finish()
+		{
+			StateSnapshotHeader header = {};
+			header.magic = StateSnapshotMagic;
+			header.version = StateSnapshotVersion;
+			header.size = static_cast<uint32_t>(m_data.size());
+			header.checksum = HashStateSnapshot(m_data.data() + sizeof(header), m_data.size() - sizeof(header));
+			memcpy(m_data.data(), &header, sizeof(header));
+			return std::move(m_data);
+		}
+
+	private:
+		std::vector<uint8_t>	m_data;
+	};
+
+	// Reads a snapshot in place. Like the writer it copies state out with memcpy, so the data
+	// needs no particular alignment; it must stay valid while the reader is used.
+	class StateSnapshotReader
+	{
+	public:
+		StateSnapshotReader() :
+			m_data(nullptr),
+			m_size(0)
+		{
+		}
+
+		// Validates the header, the checksum and the section sizes. Returns false, leaving the
+		// reader empty, if the data isn't a complete snapshot of this version.
+		bool Open(const void* data, size_t size)
+		{
+			m_data = nullptr;
+			m_size = 0;
+
+			if (data == nullptr || size < sizeof(StateSnapshotHeader))
+			{
+				return false;
+			}
+
+			auto bytes = static_cast<const uint8_t*>(data);
+			StateSnapshotHeader header;
+			memcpy(&header, bytes, sizeof(header));
+			if (header.magic != StateSnapshotMagic || header.version != StateSnapshotVersion || header.size != size ||
+				header.checksum != HashStateSnapshot(bytes + sizeof(header), size - sizeof(header)))
+			{
+				return false;
+			}
+
+			// Checking every section once here keeps Find free of bounds checks.
+			for (size_t offset = sizeof(header); offset < size; )
+			{
+				StateSnapshotSection section;
+				if (size - offset < sizeof(section))
+				{
+					return false;
+				}
+				memcpy(&section, bytes + offset, sizeof(section));
+				offset += sizeof(section);
+
+				size_t padded = (size_t(section.size) + 3) / 4 * 4;
+				if (padded > size - offset)
+				{
+					return false;
+				}
+				offset += padded;
+			}
+
+			m_data = bytes;
+			m_size = size;
+			return true;
+		}
+
+		bool IsOpen() const { return m_data != nullptr; }
+
+		// Finds the first section with the tag. Returns false if there is none.
+		bool Find(uint32_t tag, const void** data, size_t* size) const
+		{
+			for (size_t offset = sizeof(StateSnapshotHeader); offset < m_size; )
+			{
+				StateSnapshotSection section;
+				memcpy(&section, m_data + offset, sizeof(section));
+				offset += sizeof(section);
+
+				if (section.tag == tag)
+				{
+					*data = m_data + offset;
+					*size = section.size;
+					return true;
+				}
+				offset += (size_t(section.size) + 3) / 4 * 4;
+			}
+			return false;
+		}
+
+		// Copies a section into state. Returns false, leaving state as it was, if the section is
+		// missing or was written from a type of a different size.
+		template<typename TState>
+		bool Read(uint32_t tag, TState* state) const
+		{
+			static_assert(std::is_trivially_copyable<TState>::value, "Snapshot state must be plain data.");
+
+			const void* data;
+			size_t size;
+			if (!Find(tag, &data, &size) || size != sizeof(TState))
+			{
+				return false;
+			}
+
+			memcpy(state, data, sizeof(TState));
+			return true;
+		}
+
+	private:
+		const uint8_t*	m_data;
+		size_t			m_size;
+	};
+}
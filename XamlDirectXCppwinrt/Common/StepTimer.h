@@ -2,6 +2,15 @@
 
 namespace DX
 {
+    // The simulation time of a StepTimer, to carry across a suspension or a relaunch.
+    struct StepTimerState
+    {
+        uint64_t totalTicks;
+        uint64_t leftOverTicks;
+        uint32_t frameCount;
+        uint32_t reserved;
+    };
+
     // Helper class for animation and simulation timing.
     class StepTimer
     {
@@ -15,7 +24,9 @@ namespace DX
             m_framesThisSecond(0),
             m_qpcSecondCounter(0),
             m_isFixedTimeStep(false),
-            m_targetElapsedTicks(TicksPerSecond / 60)
+            m_targetElapsedTicks(TicksPerSecond / 60),
+            m_maxUpdatesPerTick(0),
+            m_droppedTicks(0)
         {
             m_qpcFrequency = GetPerformanceFrequency();
 
@@ -44,6 +55,39 @@ namespace DX
         void SetTargetElapsedTicks(uint64_t targetElapsed)    { m_targetElapsedTicks = targetElapsed;                   }
         void SetTargetElapsedSeconds(double targetElapsed)    { m_targetElapsedTicks = SecondsToTicks(targetElapsed);   }
 
+        // Set the maximum number of catch-up Update calls a single Tick may make in fixed timestep
+        // mode. Zero means no limit beyond the clamp on large time deltas.
+        void SetMaxUpdatesPerTick(uint32_t maxUpdates)        { m_maxUpdatesPerTick = maxUpdates;                       }
+
+        // Get the total simulation time discarded because the catch-up limit was reached.
+        uint64_t GetDroppedTicks() const                      { return m_droppedTicks;                                  }
+
+        // Get the simulation time, to continue from later with SetState.
+        StepTimerState GetState() const                       { return { m_totalTicks, m_leftOverTicks, m_frameCount, 0 }; }
+
+        // Continue from a saved state. The time that passed since it was saved doesn't count.
+        void SetState(const StepTimerState& state)
+        {
+            ResetElapsedTime();
+
+            m_elapsedTicks  = 0;
+            m_totalTicks    = state.totalTicks;
+            m_leftOverTicks = state.leftOverTicks;
+            m_frameCount    = state.frameCount;
+        }
+
+        // Get how far the clock has advanced past the last fixed Update, as a fraction of one
+        // timestep. Renderers blend the previous and current simulation states by this amount.
+        // Always 1 in variable timestep mode, where the last Update is exactly current.
+        double GetInterpolationAlpha() const
+        {
+            if (!m_isFixedTimeStep || m_targetElapsedTicks == 0)
+            {
+                return 1.0;
+            }
+            return static_cast<double>(m_leftOverTicks) / m_targetElapsedTicks;
+        }
+
         // Integer format represents time using 10,000,000 ticks per second.
         static const uint64_t TicksPerSecond = 10'000'000;
 
@@ -129,12 +173,26 @@ namespace DX
 
                 m_leftOverTicks += timeDelta;
 
+                uint32_t updateCount = 0;
+
                 while (m_leftOverTicks >= m_targetElapsedTicks)
                 {
+                    // If Update itself costs more than one timestep, each Tick would owe more catch-up
+                    // calls than the last. Once the limit is hit, let the simulation fall behind the
+                    // wall clock instead, keeping only the fraction of a step used for interpolation.
+                    if (m_maxUpdatesPerTick != 0 && updateCount == m_maxUpdatesPerTick)
+                    {
+                        uint64_t remainder = m_leftOverTicks % m_targetElapsedTicks;
+                        m_droppedTicks += m_leftOverTicks - remainder;
+                        m_leftOverTicks = remainder;
+                        break;
+                    }
+
                     m_elapsedTicks   = m_targetElapsedTicks;
                     m_totalTicks    += m_targetElapsedTicks;
                     m_leftOverTicks -= m_targetElapsedTicks;
                     m_frameCount++;
+                    updateCount++;
 
                     update();
                 }
@@ -185,5 +243,26 @@ namespace DX
         // Members for configuring fixed timestep mode.
         bool     m_isFixedTimeStep;
         uint64_t m_targetElapsedTicks;
+        uint32_t m_maxUpdatesPerTick;
+        uint64_t m_droppedTicks;
     };
+
+    // Blends an angle from its previous to its current fixed update by alpha, taking the short
+    // way around when the angle wrapped in between. Angles are in radians, within one turn.
+    inline float InterpolateRadians(float previous, float current, double alpha)
+    {
+        const float pi = 3.14159265358979f;
+
+        float delta = current - previous;
+        if (delta > pi)
+        {
+            delta -= 2.0f * pi;
+        }
+        else if (delta < -pi)
+        {
+            delta += 2.0f * pi;
+        }
+
+        return previous + delta * static_cast<float>(alpha);
+    }
 }
@@ -0,0 +1,67 @@
+// Matches DX::TemporalResolveConstantBufferLayout in AntiAliasing.h.
+cbuffer TemporalResolveConstantBuffer : register(b0)
+{
+	row_major float4x4 reprojection;
+	float2 viewportSize;
+	float2 textureSizeInverse;
+	float currentWeight;
+	float3 padding;
+};
+
+Texture2D currentTexture : register(t0);
+Texture2D<float> depthTexture : register(t1);
+Texture2D historyTexture : register(t2);
+SamplerState historySampler : register(s0);
+
+struct PixelShaderInput
+{
+	float4 pos : SV_POSITION;
+};
+
+struct PixelShaderOutput
+{
+	float4 color : SV_TARGET0;
+	float4 history : SV_TARGET1;
+};
+
+// Blends the current frame into the history it reprojects through the depth buffer, as
+// DX::TemporalResolve and DX::Reproject do in AntiAliasingFilters.h.
+PixelShaderOutput main(PixelShaderInput input)
+{
+	int2 pixel = int2(input.pos.xy);
+	int2 lastPixel = int2(viewportSize) - 1;
+
+	float4 current = currentTexture.Load(int3(pixel, 0));
+	float4 low = current;
+	float4 high = current;
+	[unroll]
+	for (int y = -1; y <= 1; y++)
+	{
+		[unroll]
+		for (int x = -1; x <= 1; x++)
+		{
+			float4 neighbour = currentTexture.Load(int3(clamp(pixel + int2(x, y), 0, lastPixel), 0));
+			low = min(low, neighbour);
+			high = max(high, neighbour);
+		}
+	}
+
+	float depth = depthTexture.Load(int3(pixel, 0));
+	float2 uv = input.pos.xy / viewportSize;
+	float4 clip = mul(float4(uv.x * 2.0f - 1.0f, 1.0f - uv.y * 2.0f, depth, 1.0f), reprojection);
+
+	float weight = currentWeight;
+	float2 previous = float2(clip.x / clip.w + 1.0f, 1.0f - clip.y / clip.w) * 0.5f;
+	if (clip.w <= 0.0f || any(previous < 0.0f) || any(previous > 1.0f))
+	{
+		weight = 1.0f;
+	}
+
+	float4 history = historyTexture.Sample(historySampler, previous * viewportSize * textureSizeInverse);
+	history = clamp(history, low, high);
+
+	PixelShaderOutput output;
+	output.color = lerp(history, current, weight);
+	output.history = output.color;
+	return output;
+}
@@ -0,0 +1,220 @@
+﻿#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+namespace DX
+{
+	// Block-compressed formats. Each block covers 4x4 texels.
+	enum class BlockFormat : uint32_t
+	{
+		BC1,
+		BC2,
+		BC3,
+		BC4,
+		BC5,
+		BC6H,
+		BC7,
+	};
+
+	const uint32_t BlockFormatCount = 7;
+
+	constexpr uint32_t GetBlockSize(BlockFormat format)
+	{
+		return (format == BlockFormat::BC1 || format == BlockFormat::BC4) ? 8 : 16;
+	}
+
+	// Size and pitch of one mip level. Rows are rows of blocks, not of texels.
+	struct TextureMipLayout
+	{
+		uint32_t	width;
+		uint32_t	height;
+		uint32_t	rowPitch;
+		uint32_t	rowCount;
+		uint64_t	size;
+	};
+
+	inline TextureMipLayout GetMipLayout(BlockFormat format, uint32_t width, uint32_t height, uint32_t mip)
+	{
+		TextureMipLayout layout;
+		layout.width = (width >> mip) > 0 ? (width >> mip) : 1;
+		layout.height = (height >> mip) > 0 ? (height >> mip) : 1;
+		layout.rowPitch = (layout.width + 3) / 4 * GetBlockSize(format);
+		layout.rowCount = (layout.height + 3) / 4;
+		layout.size = uint64_t(layout.rowPitch) * layout.rowCount;
+		return layout;
+	}
+
+	// Number of levels in a full mip chain, down to 1x1.
+	inline uint32_t GetFullMipCount(uint32_t width, uint32_t height)
+	{
+		uint32_t count = 1;
+		for (uint32_t size = (width > height ? width : height); size > 1; size >>= 1)
+		{
+			count++;
+		}
+		return count;
+	}
+
+	// A streaming texture container holds one block-compressed 2D texture:
+	//
+	//   TextureContainerHeader
+	//   TextureContainerMip[mipCount]	Mip 0, the most detailed, first.
+	//   mip data					The least detailed mip first, each on a 16-byte boundary.
+	//
+	// The data is ordered so that streaming from low to high detail reads the file front to back,
+	// and the low mips that are always resident sit together at its start. All values are
+	// little-endian, and offsets are from the start of the file.
+	const uint32_t TextureContainerMagic = 0x53545844;	// "DXTS"
+	const uint32_t TextureContainerVersion = 1;
+	const uint32_t TextureContainerSrgb = 0x1;			// Flag: the texels are sRGB encoded.
+
+	struct TextureContainerHeader
+	{
+		uint32_t	magic;
+		uint32_t	version;
+		uint32_t	format;		// A BlockFormat.
+		uint32_t	flags;
+		uint32_t	width;
+		uint32_t	height;
+		uint32_t	mipCount;
+		uint32_t	reserved;
+	};
+
+	struct TextureContainerMip
+	{
+		uint64_t	offset;
+		uint64_t	size;
+	};
+
+	static_assert(sizeof(TextureContainerHeader) == 32, "The container header layout is part of the file format.");
+	static_assert(sizeof(TextureContainerMip) == 16, "The container mip layout is part of the file format.");
+
+	// Reads a container in place. Like ShaderArchive, it neither copies nor owns the memory it is
+	// opened on, which must stay valid and 8-byte aligned while the container is used.
+	class TextureContainer
+	{
+	public:
+		TextureContainer() :
+			m_data(nullptr),
+			m_header(nullptr),
+			m_mips(nullptr)
+		{
+		}
+
+		// Validates the header and the mip table. Returns false if the data isn't a complete
+		// container of this version. Mip 0 must be a whole number of blocks across and down, as
+		// Direct3D requires of block-compressed textures.
+		bool Open(const void* data, size_t size)
+		{
+			m_data = nullptr;
+			m_header = nullptr;
+			m_mips = nullptr;
+
+			if (data == nullptr || size < sizeof(TextureContainerHeader) || reinterpret_cast<uintptr_t>(data) % alignof(TextureContainerHeader) != 0)
+			{
+				return false;
+			}
+
+			auto bytes = static_cast<const uint8_t*>(data);
+			auto header = reinterpret_cast<const TextureContainerHeader*>(bytes);
+			if (header->magic != TextureContainerMagic || header->version != TextureContainerVersion || header->format >= BlockFormatCount)
+			{
+				return false;
+			}
+
+			if (header->width == 0 || header->height == 0 || header->width % 4 != 0 || header->height % 4 != 0 ||
+				header->width > 16384 || header->height > 16384)
+			{
+				return false;
+			}
+
+			if (header->mipCount == 0 || header->mipCount > GetFullMipCount(header->width, header->height) ||
+				header->mipCount > (size - sizeof(TextureContainerHeader)) / sizeof(TextureContainerMip))
+			{
+				return false;
+			}
+
+			auto mips = reinterpret_cast<const TextureContainerMip*>(bytes + sizeof(TextureContainerHeader));
+			for (uint32_t mip = 0; mip < header->mipCount; mip++)
+			{
+				TextureMipLayout layout = DX::GetMipLayout(static_cast<BlockFormat>(header->format), header->width, header->height, mip);
+				if (mips[mip].size != layout.size || mips[mip].offset > size || mips[mip].size > size - mips[mip].offset)
+				{
+					return false;
+				}
+			}
+
+			m_data = bytes;
+			m_header = header;
+			m_mips = mips;
+			return true;
+		}
+
+		bool IsOpen() const						{ return m_header != nullptr; }
+		BlockFormat GetFormat() const			{ return static_cast<BlockFormat>(m_header->format); }
+		bool IsSrgb() const						{ return (m_header->flags & TextureContainerSrgb) != 0; }
+		uint32_t GetWidth() const				{ return m_header->width; }
+		uint32_t GetHeight() const				{ return m_header->height; }
+		uint32_t GetMipCount() const			{ return m_header->mipCount; }
+		const void* GetMipData(uint32_t mip) const	{ return m_data + m_mips[mip].offset; }
+		uint64_t GetMipSize(uint32_t mip) const		{ return m_mips[mip].size; }
+
+		TextureMipLayout GetMipLayout(uint32_t mip) const
+		{
+			return DX::GetMipLayout(GetFormat(), m_header->width, m_header->height, mip);
+		}
+
+	private:
+		const uint8_t*					m_data;
+		const TextureContainerHeader*	m_header;
+		const TextureContainerMip*		m_mips;
+	};
+
+	// Builds a container from mips that are already compressed, mip 0 first. Each mip must be
+	// exactly the size GetMipLayout gives. Returns an empty vector if the mips don't fit the
+	// format and dimensions.
+	inline std::vector<uint8_t> WriteTextureContainer(BlockFormat format, uint32_t flags, uint32_t width, uint32_t height, const std::vector<std::vector<uint8_t>>& mips)
+	{
+		uint32_t mipCount = static_cast<uint32_t>(mips.size());
+		if (mipCount == 0 || width == 0 || height == 0 || mipCount > GetFullMipCount(width, height))
+		{
+			return {};
+		}
+
+		TextureContainerHeader header = {};
+		header.magic = TextureContainerMagic;
+		header.version = TextureContainerVersion;
+		header.format = static_cast<uint32_t>(format);
+		header.flags = flags;
+		header.width = width;
+		header.height = height;
+		header.mipCount = mipCount;
+
+		std::vector<TextureContainerMip> table(mipCount);
+		uint64_t offset = sizeof(TextureContainerHeader) + uint64_t(mipCount) * sizeof(TextureContainerMip);
+		for (uint32_t mip = mipCount; mip-- > 0; )
+		{
+			if (mips[mip].size() != GetMipLayout(format, width, height, mip).size)
+			{
+				return {};
+			}
+
+			offset = (offset + 15) / 16 * 16;
+			table[mip] = { offset, mips[mip].size() };
+			offset += mips[mip].size();
+		}
+
+		std::vector<uint8_t> container(static_cast<size_t>(offset), 0);
+		memcpy(container.data(), &header, sizeof(header));
+		memcpy(container.data() + sizeof(header), table.data(), table.size() * sizeof(TextureContainerMip));
+		for (uint32_t mip = 0; mip < mipCount; mip++)
+		{
+			memcpy(container.data() + table[mip].offset, mips[mip].data(), mips[mip].size());
+		}
+
+		return container;
+	}
+}
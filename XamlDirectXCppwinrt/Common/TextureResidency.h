@@ -0,0 +1,342 @@
+﻿#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <queue>
+#include <vector>
+
+namespace DX
+{
+	// Decides how many mips of each streamed texture should be in video memory. Textures report
+	// how large they appear on screen each frame; Update then spends a fixed memory budget on the
+	// mips that would add the most visible detail, keeps what it can of textures that are no
+	// longer drawn, and evicts the rest. Residency is described by the most detailed resident
+	// mip: every mip from there down to the smallest is resident.
+	//
+	// The manager has no knowledge of the graphics API. It returns the changes to make, and the
+	// caller makes them; see TextureStreamer.
+	class TextureResidencyManager
+	{
+	public:
+		using TextureHandle = uint32_t;
+		static const TextureHandle InvalidTexture = UINT32_MAX;
+
+		// A texture that must become resident from residentMip down. An eviction when residentMip
+		// grows, a load when it shrinks.
+		struct Change
+		{
+			TextureHandle	texture;
+			uint32_t		previousMip;
+			uint32_t		residentMip;
+		};
+
+		struct Stats
+		{
+			uint64_t	budget;
+			uint64_t	residentSize;
+			uint64_t	targetSize;		// What the last Update would have resident if it weren't rate limited.
+			uint32_t	textureCount;
+			uint32_t	loadsPending;	// Textures still short of their target.
+			uint32_t	lastLoads;
+			uint32_t	lastEvictions;
+		};
+
+		explicit TextureResidencyManager(uint64_t budget) :
+			m_budget(budget),
+			m_frame(0),
+			m_residentSize(0),
+			m_stats()
+		{
+		}
+
+		// Registers a texture. mipSizes lists the size of every mip, the most detailed first.
+		// Mips from tailMip down are always resident, whatever the budget; choose a tail small
+		// enough that it costs little to keep every texture drawable. Nothing is resident until
+		// the next Update.
+		TextureHandle Add(const uint64_t* mipSizes, uint32_t mipCount, uint32_t width, uint32_t height, uint32_t tailMip)
+		{
+			TextureHandle handle;
+			if (!m_freeHandles.empty())
+			{
+				handle = m_freeHandles.back();
+				m_freeHandles.pop_back();
+			}
+			else
+			{
+				handle = static_cast<TextureHandle>(m_textures.size());
+				m_textures.emplace_back();
+			}
+
+			Texture& texture = m_textures[handle];
+			texture = Texture();
+			texture.mipSizes.assign(mipSizes, mipSizes + mipCount);
+			texture.size = (std::max)(width, height);
+			texture.tailMip = (std::min)(tailMip, mipCount - 1);
+			texture.residentMip = mipCount;
+			texture.targetMip = mipCount;
+			texture.inUse = true;
+			return handle;
+		}
+
+		// Unregisters a texture. Its memory no longer counts against the budget, so the caller
+		// must release it too.
+		void Remove(TextureHandle handle)
+		{
+			Texture& texture = m_textures[handle];
+			m_residentSize -= GetSize(texture, texture.residentMip);
+			texture = Texture();
+			m_freeHandles.push_back(handle);
+		}
+
+		// Reports that the texture is drawn this frame covering about screenSize pixels along its
+		// larger dimension. A texture drawn several times keeps its largest size.
+		void RequestScreenSize(TextureHandle handle, float screenSize)
+		{
+			Texture& texture = m_textures[handle];
+			if (texture.requestFrame != m_frame + 1 || screenSize > texture.screenSize)
+			{
+				texture.screenSize = screenSize;
+			}
+			texture.requestFrame = m_frame + 1;
+		}
+
+		// Decides residency for the frame. Writes the changes to make, evictions first so their
+		// memory is free before the loads. Loads are limited to about maxLoadSize bytes per call
+		// and happen one mip at a time from low to high detail, most needed first, so a texture
+		// sharpens gradually; the tail of a new texture is always loaded at once, and a mip larger
+		// than the limit is loaded on its own when nothing else is.
+		void Update(uint64_t maxLoadSize, std::vector<Change>* changes)
+		{
+			m_frame++;
+			changes->clear();
+
+			ChooseTargets();
+
+			uint32_t evictions = 0;
+			for (TextureHandle handle = 0; handle < m_textures.size(); handle++)
+			{
+				Texture& texture = m_textures[handle];
+				if (texture.inUse && texture.targetMip > texture.residentMip)
+				{
+					changes->push_back({ handle, texture.residentMip, texture.targetMip });
+					m_residentSize -= GetSize(texture, texture.residentMip) - GetSize(texture, texture.targetMip);
+					texture.residentMip = texture.targetMip;
+					evictions++;
+				}
+			}
+
+			// Textures with nothing resident come first, then the ones whose next mip adds the
+			// most detail.
+			m_loadOrder.clear();
+			for (TextureHandle handle = 0; handle < m_textures.size(); handle++)
+			{
+				const Texture& texture = m_textures[handle];
+				if (texture.inUse && texture.targetMip < texture.residentMip)
+				{
+					m_loadOrder.push_back({ GetLoadPriority(texture), handle });
+				}
+			}
+			std::sort(m_loadOrder.begin(), m_loadOrder.end(), [](const Candidate& a, const Candidate& b) { return a.priority > b.priority; });
+
+			uint32_t loads = 0;
+			uint32_t pending = 0;
+			uint64_t loadedSize = 0;
+			for (const Candidate& candidate : m_loadOrder)
+			{
+				Texture& texture = m_textures[candidate.texture];
+				uint32_t previousMip = texture.residentMip;
+				uint32_t mip = previousMip;
+
+				if (previousMip == texture.mipSizes.size())
+				{
+					mip = texture.tailMip;
+					loadedSize += GetSize(texture, mip);
+				}
+
+				while (mip > texture.targetMip && (loadedSize == 0 || loadedSize + texture.mipSizes[mip - 1] <= maxLoadSize))
+				{
+					mip--;
+					loadedSize += texture.mipSizes[mip];
+				}
+
+				if (mip != previousMip)
+				{
+					changes->push_back({ candidate.texture, previousMip, mip });
+					m_residentSize += GetSize(texture, mip) - GetSize(texture, previousMip);
+					texture.residentMip = mip;
+					loads++;
+				}
+
+				if (texture.residentMip > texture.targetMip)
+				{
+					pending++;
+				}
+			}
+
+			m_stats.budget = m_budget;
+			m_stats.residentSize = m_residentSize;
+			m_stats.textureCount = static_cast<uint32_t>(m_textures.size() - m_freeHandles.size());
+			m_stats.loadsPending = pending;
+			m_stats.lastLoads = loads;
+			m_stats.lastEvictions = evictions;
+		}
+
+		// Forgets all residency, for example after the device was lost. The textures stay
+		// registered and their tails are loaded again by the next Update.
+		void ResetResidency()
+		{
+			for (Texture& texture : m_textures)
+			{
+				texture.residentMip = static_cast<uint32_t>(texture.mipSizes.size());
+				texture.targetMip = texture.residentMip;
+			}
+			m_residentSize = 0;
+		}
+
+		void SetBudget(uint64_t budget)						{ m_budget = budget; }
+		uint64_t GetBudget() const							{ return m_budget; }
+		uint32_t GetResidentMip(TextureHandle handle) const	{ return m_textures[handle].residentMip; }
+		uint32_t GetTargetMip(TextureHandle handle) const	{ return m_textures[handle].targetMip; }
+		const Stats& GetStats() const						{ return m_stats; }
+
+		// The mip whose texels map about one to one onto screen pixels for a texture of the given
+		// size drawn screenSize pixels across. More detailed mips would only be minified away.
+		static uint32_t GetDesiredMip(uint32_t textureSize, float screenSize)
+		{
+			if (!(screenSize >= 1.0f))
+			{
+				screenSize = 1.0f;
+			}
+
+			float ratio = static_cast<float>(textureSize) / screenSize;
+			return ratio <= 1.0f ? 0 : static_cast<uint32_t>(std::floor(std::log2(ratio)));
+		}
+
+	private:
+		struct Texture
+		{
+			std::vector<uint64_t>	mipSizes;
+			uint32_t				size = 0;			// Larger dimension of mip 0.
+			uint32_t				tailMip = 0;
+			uint32_t				residentMip = 0;
+			uint32_t				targetMip = 0;
+			uint32_t				desiredMip = 0;		// The mip that matches the size on screen.
+			uint64_t				requestFrame = 0;	// The frame that last requested the texture.
+			float					screenSize = 0.0f;
+			bool					inUse = false;
+		};
+
+		struct Candidate
+		{
+			double			priority;
+			TextureHandle	texture;
+
+			bool operator<(const Candidate& other) const { return priority < other.priority; }
+		};
+
+		// Bytes resident when every mip from mip down is.
+		static uint64_t GetSize(const Texture& texture, uint32_t mip)
+		{
+			uint64_t size = 0;
+			for (uint32_t i = mip; i < texture.mipSizes.size(); i++)
+			{
+				size += texture.mipSizes[i];
+			}
+			return size;
+		}
+
+		// How badly the texture wants mip. A mip that a texture drawn this frame needs ranks by the
+		// screen pixels each of its texels would cover, and always outranks detail that isn't
+		// needed now. That ranks by how recently the texture was drawn, so detail that has gone
+		// unused longest is what gets evicted.
+		double GetMipPriority(const Texture& texture, uint32_t mip) const
+		{
+			if (texture.requestFrame == m_frame && mip >= texture.desiredMip)
+			{
+				double mipSize = (std::max)(1.0, static_cast<double>(texture.size >> mip));
+				return 1.0e9 + texture.screenSize / mipSize;
+			}
+			return -static_cast<double>(m_frame - texture.requestFrame) - mip * 1.0e-3;
+		}
+
+		double GetLoadPriority(const Texture& texture) const
+		{
+			if (texture.residentMip == texture.mipSizes.size())
+			{
+				return 1.0e18;
+			}
+			return GetMipPriority(texture, texture.residentMip - 1);
+		}
+
+		// Every texture gets its tail. The rest of the budget goes to the most valuable mips,
+		// one at a time from each texture's tail upwards: a texture drawn this frame wants the
+		// mips down to the one that matches its size on screen, and a texture that isn't drawn
+		// wants to keep what it already has, at lower priority.
+		void ChooseTargets()
+		{
+			uint64_t targetSize = 0;
+			m_candidates = std::priority_queue<Candidate>();
+
+			for (TextureHandle handle = 0; handle < m_textures.size(); handle++)
+			{
+				Texture& texture = m_textures[handle];
+				if (!texture.inUse)
+				{
+					continue;
+				}
+
+				texture.targetMip = texture.tailMip;
+				texture.desiredMip = (texture.requestFrame == m_frame) ? GetDesiredMip(texture.size, texture.screenSize) : texture.tailMip;
+				targetSize += GetSize(texture, texture.tailMip);
+
+				uint32_t limit = GetTargetLimit(texture);
+				if (limit < texture.targetMip)
+				{
+					m_candidates.push({ GetMipPriority(texture, texture.targetMip - 1), handle });
+				}
+			}
+
+			while (!m_candidates.empty())
+			{
+				Candidate candidate = m_candidates.top();
+				m_candidates.pop();
+
+				Texture& texture = m_textures[candidate.texture];
+				uint32_t mip = texture.targetMip - 1;
+				if (targetSize + texture.mipSizes[mip] > m_budget)
+				{
+					// Smaller mips of other textures may still fit, but this texture's larger
+					// ones won't.
+					continue;
+				}
+
+				texture.targetMip = mip;
+				targetSize += texture.mipSizes[mip];
+
+				if (GetTargetLimit(texture) < mip)
+				{
+					m_candidates.push({ GetMipPriority(texture, mip - 1), candidate.texture });
+				}
+			}
+
+			m_stats.targetSize = targetSize;
+		}
+
+		// The most detailed mip a texture may have: the one it needs now, or any more detailed
+		// one it already has.
+		static uint32_t GetTargetLimit(const Texture& texture)
+		{
+			return (std::min)((std::min)(texture.desiredMip, texture.residentMip), texture.tailMip);
+		}
+
+		uint64_t						m_budget;
+		uint64_t						m_frame;
+		uint64_t						m_residentSize;
+		std::vector<Texture>			m_textures;
+		std::vector<TextureHandle>		m_freeHandles;
+		std::priority_queue<Candidate>	m_candidates;
+		std::vector<Candidate>			m_loadOrder;
+		Stats							m_stats;
+	};
+}
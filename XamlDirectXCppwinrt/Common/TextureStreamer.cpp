@@ -0,0 +1,240 @@
+﻿#include "pch.h"
+#include "TextureStreamer.h"
+#include "Profiler.h"
+
+DX::TextureStreamer::TextureStreamer(uint64_t budget, uint64_t maxUploadSizePerFrame) :
+	m_maxUploadSize(maxUploadSizePerFrame),
+	m_residency(budget)
+{
+}
+
+void DX::TextureStreamer::CreateDeviceDependentResources(ID3D11Device3* device)
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	m_device.copy_from(device);
+}
+
+// Unlike meshes in the GeometryPool, textures stay registered across device loss. Their data is
+// still mapped, so the next Update uploads their tails to the new device.
+void DX::TextureStreamer::ReleaseDeviceDependentResources()
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	m_device = nullptr;
+	for (auto& texture : m_textures)
+	{
+		if (texture)
+		{
+			texture->texture = nullptr;
+			texture->view = nullptr;
+		}
+	}
+	m_residency.ResetResidency();
+}
+
+DX::TextureStreamer::TextureHandle DX::TextureStreamer::Add(const std::wstring& fileName)
+{
+	auto texture = std::make_unique<StreamedTexture>();
+	if (!texture->file.OpenPackageFile(fileName))
+	{
+		winrt::throw_hresult(HRESULT_FROM_WIN32(ERROR_FILE_NOT_FOUND));
+	}
+
+	if (!texture->container.Open(texture->file.GetData(), texture->file.GetSize()))
+	{
+		winrt::throw_hresult(HRESULT_FROM_WIN32(ERROR_FILE_CORRUPT));
+	}
+
+	const TextureContainer& container = texture->container;
+	std::vector<uint64_t> mipSizes(container.GetMipCount());
+	for (uint32_t mip = 0; mip < container.GetMipCount(); mip++)
+	{
+		mipSizes[mip] = container.GetMipSize(mip);
+	}
+
+	std::lock_guard<std::mutex> lock(m_mutex);
+	TextureHandle handle = m_residency.Add(mipSizes.data(), container.GetMipCount(), container.GetWidth(), container.GetHeight(), GetTailMip(container));
+	if (handle >= m_textures.size())
+	{
+		m_textures.resize(handle + 1);
+	}
+	m_textures[handle] = std::move(texture);
+	return handle;
+}
+
+void DX::TextureStreamer::Remove(TextureHandle texture)
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	m_residency.Remove(texture);
+	m_textures[texture] = nullptr;
+}
+
+void DX::TextureStreamer::RequestScreenSize(TextureHandle texture, float screenSize)
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	m_residency.RequestScreenSize(texture, screenSize);
+}
+
+ID3D11ShaderResourceView* DX::TextureStreamer::GetShaderResourceView(TextureHandle texture)
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	return m_textures[texture]->view.get();
+}
+
+DX::TextureResidencyManager::Stats DX::TextureStreamer::GetStats()
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	return m_residency.GetStats();
+}
+
+void DX::TextureStreamer::Update(ID3D11DeviceContext3* context)
+{
+	DX_PROFILE_SCOPE("TextureStreamer::Update");
+
+	std::lock_guard<std::mutex> lock(m_mutex);
+	if (m_device == nullptr)
+	{
+		return;
+	}
+
+	m_residency.Update(m_maxUploadSize, &m_changes);
+	for (const auto& change : m_changes)
+	{
+		ApplyChange(context, change);
+	}
+}
+
+void DX::TextureStreamer::Trim(ID3D11DeviceContext3* context)
+{
+	DX_PROFILE_SCOPE("TextureStreamer::Trim");
+
+	std::lock_guard<std::mutex> lock(m_mutex);
+	if (m_device == nullptr)
+	{
+		return;
+	}
+
+	// Without a budget only the tails stay resident.
+	uint64_t budget = m_residency.GetBudget();
+	m_residency.SetBudget(0);
+	m_residency.Update(m_maxUploadSize, &m_changes);
+	m_residency.SetBudget(budget);
+
+	for (const auto& change : m_changes)
+	{
+		ApplyChange(context, change);
+	}
+}
+
+// Recreates the texture with mips from change.residentMip down. Mips that were already resident
+// are copied on the GPU; only newly resident ones are read from the container.
+void DX::TextureStreamer::ApplyChange(ID3D11DeviceContext3* context, const TextureResidencyManager::Change& change)
+{
+	StreamedTexture& streamed = *m_textures[change.texture];
+	const TextureContainer& container = streamed.container;
+	uint32_t mipCount = container.GetMipCount();
+	TextureMipLayout top = container.GetMipLayout(change.residentMip);
+
+	CD3D11_TEXTURE2D_DESC textureDesc(
+		GetDxgiFormat(container),
+		top.width,
+		top.height,
+		1,
+		mipCount - change.residentMip,
+		D3D11_BIND_SHADER_RESOURCE);
+
+	winrt::com_ptr<ID3D11Texture2D> texture;
+	if (streamed.texture == nullptr)
+	{
+		// Nothing to copy from: create the texture with its data.
+		std::vector<D3D11_SUBRESOURCE_DATA> initialData(mipCount - change.residentMip);
+		for (uint32_t mip = change.residentMip; mip < mipCount; mip++)
+		{
+			D3D11_SUBRESOURCE_DATA& data = initialData[mip - change.residentMip];
+			data.pSysMem = container.GetMipData(mip);
+			data.SysMemPitch = container.GetMipLayout(mip).rowPitch;
+			data.SysMemSlicePitch = 0;
+		}
+
+		winrt::check_hresult(
+			m_device->CreateTexture2D(
+				&textureDesc,
+				initialData.data(),
+				texture.put()));
+	}
+	else
+	{
+		winrt::check_hresult(
+			m_device->CreateTexture2D(
+				&textureDesc,
+				nullptr,
+				texture.put()));
+
+		// Mips resident both before and after the change.
+		uint32_t firstRetained = (std::max)(change.residentMip, change.previousMip);
+		for (uint32_t mip = firstRetained; mip < mipCount; mip++)
+		{
+			context->CopySubresourceRegion(
+				texture.get(), mip - change.residentMip, 0, 0, 0,
+				streamed.texture.get(), mip - change.previousMip, nullptr);
+		}
+
+		for (uint32_t mip = change.residentMip; mip < firstRetained; mip++)
+		{
+			context->UpdateSubresource(
+				texture.get(), mip - change.residentMip, nullptr,
+				container.GetMipData(mip), container.GetMipLayout(mip).rowPitch, 0);
+		}
+	}
+
+	CD3D11_SHADER_RESOURCE_VIEW_DESC viewDesc(texture.get(), D3D11_SRV_DIMENSION_TEXTURE2D);
+	winrt::com_ptr<ID3D11ShaderResourceView> view;
+	winrt::check_hresult(
+		m_device->CreateShaderResourceView(
+			texture.get(),
+			&viewDesc,
+			view.put()));
+
+	streamed.texture = std::move(texture);
+	streamed.view = std::move(view);
+}
+
+// Always keep the mips at most TailSize across, but no more detailed a mip than can be the top
+// of a texture: Direct3D requires the top mip of a block-compressed texture to be a whole
+// number of blocks across and down.
+uint32_t DX::TextureStreamer::GetTailMip(const TextureContainer& container)
+{
+	uint32_t tailMip = 0;
+	while (tailMip + 1 < container.GetMipCount() &&
+		(std::max)(container.GetWidth() >> tailMip, container.GetHeight() >> tailMip) > TailSize)
+	{
+		tailMip++;
+	}
+
+	uint32_t lastBlockAlignedMip = 0;
+	while (lastBlockAlignedMip + 1 < container.GetMipCount() &&
+		(container.GetWidth() >> (lastBlockAlignedMip + 1)) % 4 == 0 &&
+		(container.GetHeight() >> (lastBlockAlignedMip + 1)) % 4 == 0 &&
+		(container.GetWidth() >> (lastBlockAlignedMip + 1)) > 0 &&
+		(container.GetHeight() >> (lastBlockAlignedMip + 1)) > 0)
+	{
+		lastBlockAlignedMip++;
+	}
+
+	return (std::min)(tailMip, lastBlockAlignedMip);
+}
+
+DXGI_FORMAT DX::TextureStreamer::GetDxgiFormat(const TextureContainer& container)
+{
+	bool srgb = container.IsSrgb();
+	switch (container.GetFormat())
+	{
+	case BlockFormat::BC1:	return srgb ? DXGI_FORMAT_BC1_UNORM_SRGB : DXGI_FORMAT_BC1_UNORM;
+	case BlockFormat::BC2:	return srgb ? DXGI_FORMAT_BC2_UNORM_SRGB : DXGI_FORMAT_BC2_UNORM;
+	case BlockFormat::BC3:	return srgb ? DXGI_FORMAT_BC3_UNORM_SRGB : DXGI_FORMAT_BC3_UNORM;
+	case BlockFormat::BC4:	return DXGI_FORMAT_BC4_UNORM;
+	case BlockFormat::BC5:	return DXGI_FORMAT_BC5_UNORM;
+	case BlockFormat::BC6H:	return DXGI_FORMAT_BC6H_UF16;
+	case BlockFormat::BC7:	return srgb ? DXGI_FORMAT_BC7_UNORM_SRGB : DXGI_FORMAT_BC7_UNORM;
+	}
+	return DXGI_FORMAT_UNKNOWN;
+}
@@ -0,0 +1,77 @@
+﻿#pragma once
+
+#include <memory>
+#include <mutex>
+#include "MappedFile.h"
+#include "TextureContainer.h"
+#include "TextureResidency.h"
+
+namespace DX
+{
+	// Streams block-compressed textures from containers in the app package under a fixed video
+	// memory budget. Each texture's smallest mips are uploaded as soon as it is added, so it can
+	// be drawn at once; more detailed mips follow as renderers report how large the texture
+	// appears on screen, and the least recently drawn detail is evicted when the budget is full.
+	//
+	// Containers are memory-mapped, so mips are read from disk only when they are uploaded.
+	// Textures may be added, removed and requested from any thread; Update and the resources it
+	// creates belong to the render thread.
+	class TextureStreamer
+	{
+	public:
+		using TextureHandle = TextureResidencyManager::TextureHandle;
+		static const TextureHandle InvalidTexture = TextureResidencyManager::InvalidTexture;
+
+		TextureStreamer(uint64_t budget, uint64_t maxUploadSizePerFrame);
+		void CreateDeviceDependentResources(ID3D11Device3* device);
+		void ReleaseDeviceDependentResources();
+
+		// Adds a texture from a container file relative to the package's install folder. Throws
+		// if the file is missing or isn't a valid container.
+		TextureHandle Add(const std::wstring& fileName);
+		void Remove(TextureHandle texture);
+
+		// Reports that the texture is drawn this frame, about screenSize pixels across.
+		void RequestScreenSize(TextureHandle texture, float screenSize);
+
+		// Null until the texture's first mips are uploaded. The view always starts at the most
+		// detailed resident mip, so texture coordinates are unaffected by residency; the view
+		// changes whenever residency does, so look it up each frame rather than keeping it.
+		ID3D11ShaderResourceView* GetShaderResourceView(TextureHandle texture);
+
+		// Called by the render thread before drawing. Applies the residency changes for the frame,
+		// uploading at most about maxUploadSizePerFrame bytes.
+		void Update(ID3D11DeviceContext3* context);
+
+		// Evicts every mip above each texture's tail, e.g. while the app is suspended. Detail
+		// streams back in as textures are drawn again. Called like Update.
+		void Trim(ID3D11DeviceContext3* context);
+
+		TextureResidencyManager::Stats GetStats();
+
+		// Mips at most this large are always resident.
+		static const uint32_t TailSize = 64;
+
+	private:
+		struct StreamedTexture
+		{
+			MappedFile									file;
+			TextureContainer							container;
+			winrt::com_ptr<ID3D11Texture2D>				texture;
+			winrt::com_ptr<ID3D11ShaderResourceView>	view;
+		};
+
+		static uint32_t GetTailMip(const TextureContainer& container);
+		static DXGI_FORMAT GetDxgiFormat(const TextureContainer& container);
+		void ApplyChange(ID3D11DeviceContext3* context, const TextureResidencyManager::Change& change);
+
+		uint64_t										m_maxUploadSize;
+		winrt::com_ptr<ID3D11Device3>					m_device;
+		std::vector<TextureResidencyManager::Change>	m_changes;
+
+		// Guards everything below, which is shared with threads that add or remove textures.
+		std::mutex										m_mutex;
+		TextureResidencyManager							m_residency;
+		std::vector<std::unique_ptr<StreamedTexture>>	m_textures;
+	};
+}
@@ -0,0 +1,292 @@
+﻿#pragma once
+
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+#if defined(_M_X64) || defined(__SSE2__)
+#include <emmintrin.h>
+#define DX_VERTEX_ENCODING_SSE2 1
+#endif
+
+namespace DX
+{
+	// Conversions between 32-bit floats and the compact formats used for vertex attributes. The
+	// scalar functions define the exact results; the array kernels produce identical values and
+	// use SSE2 where it's available. Normalized formats clamp their input, and NaN encodes as
+	// the lowest value of the range.
+	namespace VertexEncoding
+	{
+		// IEEE 754 half precision, rounding to nearest even. Values too large for a half become
+		// infinity, and NaN stays NaN.
+		inline uint16_t FloatToHalf(float value)
+		{
+			uint32_t bits;
+			memcpy(&bits, &value, sizeof(bits));
+
+			uint32_t sign = (bits >> 16) & 0x8000u;
+			uint32_t magnitude = bits & 0x7FFFFFFFu;
+
+			if (magnitude >= 0x7F800000u)
+			{
+				// Infinity, or NaN with its payload truncated but kept non-zero.
+				uint32_t nan = (magnitude > 0x7F800000u) ? (0x200u | ((magnitude >> 13) & 0x3FFu)) : 0u;
+				return static_cast<uint16_t>(sign | 0x7C00u | nan);
+			}
+
+			if (magnitude >= 0x477FF000u)
+			{
+				// Rounds past the largest half, 65504.
+				return static_cast<uint16_t>(sign | 0x7C00u);
+			}
+
+			if (magnitude < 0x38800000u)
+			{
+				// Below the smallest normal half. The result is a subnormal: the full 24-bit
+				// mantissa scaled by the exponent, rounded to a multiple of 2^-24.
+				if (magnitude < 0x33000000u)
+				{
+					return static_cast<uint16_t>(sign);
+				}
+
+				uint32_t exponent = magnitude >> 23;
+				uint32_t mantissa = (magnitude & 0x7FFFFFu) | 0x800000u;
+				uint32_t shift = 126 - exponent;
+				uint32_t result = mantissa >> shift;
+				uint32_t remainder = mantissa & ((1u << shift) - 1);
+				uint32_t halfway = 1u << (shift - 1);
+				if (remainder > halfway || (remainder == halfway && (result & 1)))
+				{
+					result++;
+				}
+				return static_cast<uint16_t>(sign | result);
+			}
+
+			// Normal half. Rebias the exponent and round the mantissa to 10 bits; a carry out of
+			// the mantissa correctly bumps the exponent.
+			uint32_t rebiased = magnitude - 0x38000000u;
+			uint32_t result = rebiased >> 13;
+			uint32_t remainder = rebiased & 0x1FFFu;
+			if (remainder > 0x1000u || (remainder == 0x1000u && (result & 1)))
+			{
+				result++;
+			}
+			return static_cast<uint16_t>(sign | result);
+		}
+
+		inline float HalfToFloat(uint16_t half)
+		{
+			uint32_t sign = static_cast<uint32_t>(half & 0x8000u) << 16;
+			uint32_t exponent = (half >> 10) & 0x1Fu;
+			uint32_t mantissa = half & 0x3FFu;
+
+			uint32_t bits;
+			if (exponent == 0x1F)
+			{
+				bits = sign | 0x7F800000u | (mantissa << 13);
+			}
+			else if (exponent == 0)
+			{
+				// Zero or subnormal, both exactly representable as a float.
+				float magnitude = static_cast<float>(mantissa) * (1.0f / 16777216.0f);
+				return sign ? -magnitude : magnitude;
+			}
+			else
+			{
+				bits = sign | ((exponent + 112) << 23) | (mantissa << 13);
+			}
+
+			float value;
+			memcpy(&value, &bits, sizeof(value));
+			return value;
+		}
+
+		// Written so that NaN falls through to the lower bound, matching _mm_max_ps.
+		inline float Clamp(float value, float lower, float upper)
+		{
+			value = (value > lower) ? value : lower;
+			return (value < upper) ? value : upper;
+		}
+
+		inline int16_t FloatToSnorm16(float value)
+		{
+			return static_cast<int16_t>(std::nearbyint(Clamp(value, -1.0f, 1.0f) * 32767.0f));
+		}
+
+		inline float Snorm16ToFloat(int16_t value)
+		{
+			// Both -32768 and -32767 decode to -1.
+			float result = static_cast<float>(value) * (1.0f / 32767.0f);
+			return (result > -1.0f) ? result : -1.0f;
+		}
+
+		inline uint8_t FloatToUnorm8(float value)
+		{
+			return static_cast<uint8_t>(std::nearbyint(Clamp(value, 0.0f, 1.0f) * 255.0f));
+		}
+
+		inline float Unorm8ToFloat(uint8_t value)
+		{
+			return static_cast<float>(value) * (1.0f / 255.0f);
+		}
+
+		// Three 10-bit components and one 2-bit component, x in the lowest bits, matching
+		// DXGI_FORMAT_R10G10B10A2_UNORM.
+		inline uint32_t PackUnorm10_10_10_2(float x, float y, float z, float w)
+		{
+			uint32_t r = static_cast<uint32_t>(std::nearbyint(Clamp(x, 0.0f, 1.0f) * 1023.0f));
+			uint32_t g = static_cast<uint32_t>(std::nearbyint(Clamp(y, 0.0f, 1.0f) * 1023.0f));
+			uint32_t b = static_cast<uint32_t>(std::nearbyint(Clamp(z, 0.0f, 1.0f) * 1023.0f));
+			uint32_t a = static_cast<uint32_t>(std::nearbyint(Clamp(w, 0.0f, 1.0f) * 3.0f));
+			return r | (g << 10) | (b << 20) | (a << 30);
+		}
+
+		inline void UnpackUnorm10_10_10_2(uint32_t packed, float* values)
+		{
+			values[0] = static_cast<float>(packed & 0x3FFu) * (1.0f / 1023.0f);
+			values[1] = static_cast<float>((packed >> 10) & 0x3FFu) * (1.0f / 1023.0f);
+			values[2] = static_cast<float>((packed >> 20) & 0x3FFu) * (1.0f / 1023.0f);
+			values[3] = static_cast<float>(packed >> 30) * (1.0f / 3.0f);
+		}
+
+		// Unit vectors stored in R10G10B10A2_UNORM, remapped from [-1, 1] to [0, 1]. Shaders
+		// recover them with n * 2 - 1.
+		inline uint32_t PackNormal(float x, float y, float z)
+		{
+			return PackUnorm10_10_10_2(x * 0.5f + 0.5f, y * 0.5f + 0.5f, z * 0.5f + 0.5f, 0.0f);
+		}
+
+		inline void UnpackNormal(uint32_t packed, float* values)
+		{
+			float unorm[4];
+			UnpackUnorm10_10_10_2(packed, unorm);
+			for (int i = 0; i < 3; i++)
+			{
+				values[i] = unorm[i] * 2.0f - 1.0f;
+			}
+		}
+
+		// Array kernels. Each converts count values between contiguous arrays.
+
+		// There is no half conversion in SSE2, and F16C isn't available on every processor the
+		// template targets, so halves are always converted one at a time.
+		inline void EncodeHalf(const float* source, uint16_t* destination, size_t count)
+		{
+			for (size_t i = 0; i < count; i++)
+			{
+				destination[i] = FloatToHalf(source[i]);
+			}
+		}
+
+		inline void DecodeHalf(const uint16_t* source, float* destination, size_t count)
+		{
+			for (size_t i = 0; i < count; i++)
+			{
+				destination[i] = HalfToFloat(source[i]);
+			}
+		}
+
+		inline void EncodeSnorm16(const float* source, int16_t* destination, size_t count)
+		{
+			size_t i = 0;
+#if defined(DX_VERTEX_ENCODING_SSE2)
+			const __m128 lower = _mm_set1_ps(-1.0f);
+			const __m128 upper = _mm_set1_ps(1.0f);
+			const __m128 scale = _mm_set1_ps(32767.0f);
+			for (; i + 8 <= count; i += 8)
+			{
+				__m128 a = _mm_min_ps(_mm_max_ps(_mm_loadu_ps(source + i), lower), upper);
+				__m128 b = _mm_min_ps(_mm_max_ps(_mm_loadu_ps(source + i + 4), lower), upper);
+				__m128i packed = _mm_packs_epi32(_mm_cvtps_epi32(_mm_mul_ps(a, scale)), _mm_cvtps_epi32(_mm_mul_ps(b, scale)));
+				_mm_storeu_si128(reinterpret_cast<__m128i*>(destination + i), packed);
+			}
+#endif
+			for (; i < count; i++)
+			{
+				destination[i] = FloatToSnorm16(source[i]);
+			}
+		}
+
+		inline void DecodeSnorm16(const int16_t* source, float* destination, size_t count)
+		{
+			size_t i = 0;
+#if defined(DX_VERTEX_ENCODING_SSE2)
+			const __m128 lower = _mm_set1_ps(-1.0f);
+			const __m128 scale = _mm_set1_ps(1.0f / 32767.0f);
+			for (; i + 8 <= count; i += 8)
+			{
+				__m128i values = _mm_loadu_si128(reinterpret_cast<const __m128i*>(source + i));
+
+				// Sign-extend each 16-bit value to 32 bits.
+				__m128i low = _mm_srai_epi32(_mm_unpacklo_epi16(values, values), 16);
+				__m128i high = _mm_srai_epi32(_mm_unpackhi_epi16(values, values), 16);
+				_mm_storeu_ps(destination + i, _mm_max_ps(_mm_mul_ps(_mm_cvtepi32_ps(low), scale), lower));
+				_mm_storeu_ps(destination + i + 4, _mm_max_ps(_mm_mul_ps(_mm_cvtepi32_ps(high), scale), lower));
+			}
+#endif
+			for (; i < count; i++)
+			{
+				destination[i] = Snorm16ToFloat(source[i]);
+			}
+		}
+
+		inline void EncodeUnorm8(const float* source, uint8_t* destination, size_t count)
+		{
+			size_t i = 0;
+#if defined(DX_VERTEX_ENCODING_SSE2)
+			const __m128 lower = _mm_setzero_ps();
+			const __m128 upper = _mm_set1_ps(1.0f);
+			const __m128 scale = _mm_set1_ps(255.0f);
+			for (; i + 16 <= count; i += 16)
+			{
+				__m128i values[4];
+				for (int j = 0; j < 4; j++)
+				{
+					__m128 clamped = _mm_min_ps(_mm_max_ps(_mm_loadu_ps(source + i + j * 4), lower), upper);
+					values[j] = _mm_cvtps_epi32(_mm_mul_ps(clamped, scale));
+				}
+
+				__m128i low = _mm_packs_epi32(values[0], values[1]);
+				__m128i high = _mm_packs_epi32(values[2], values[3]);
+				_mm_storeu_si128(reinterpret_cast<__m128i*>(destination + i), _mm_packus_epi16(low, high));
+			}
+#endif
+			for (; i < count; i++)
+			{
+				destination[i] = FloatToUnorm8(source[i]);
+			}
+		}
+
+		inline void DecodeUnorm8(const uint8_t* source, float* destination, size_t count)
+		{
+			size_t i = 0;
+#if defined(DX_VERTEX_ENCODING_SSE2)
+			const __m128i zero = _mm_setzero_si128();
+			const __m128 scale = _mm_set1_ps(1.0f / 255.0f);
+			for (; i + 16 <= count; i += 16)
+			{
+				__m128i values = _mm_loadu_si128(reinterpret_cast<const __m128i*>(source + i));
+				__m128i low = _mm_unpacklo_epi8(values, zero);
+				__m128i high = _mm_unpackhi_epi8(values, zero);
+				__m128i words[4] =
+				{
+					_mm_unpacklo_epi16(low, zero),
+					_mm_unpackhi_epi16(low, zero),
+					_mm_unpacklo_epi16(high, zero),
+					_mm_unpackhi_epi16(high, zero),
+				};
+
+				for (int j = 0; j < 4; j++)
+				{
+					_mm_storeu_ps(destination + i + j * 4, _mm_mul_ps(_mm_cvtepi32_ps(words[j]), scale));
+				}
+			}
+#endif
+			for (; i < count; i++)
+			{
+				destination[i] = Unorm8ToFloat(source[i]);
+			}
+		}
+	}
+}
@@ -0,0 +1,290 @@
+﻿#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include "VertexEncoding.h"
+
+namespace DX
+{
+	// Storage formats for vertex attributes. All sizes are multiples of four bytes, as Direct3D
+	// requires for element offsets.
+	enum class VertexFormat : uint8_t
+	{
+		Float2,				// DXGI_FORMAT_R32G32_FLOAT
+		Float3,				// DXGI_FORMAT_R32G32B32_FLOAT
+		Float4,				// DXGI_FORMAT_R32G32B32A32_FLOAT
+		Half2,				// DXGI_FORMAT_R16G16_FLOAT
+		Half4,				// DXGI_FORMAT_R16G16B16A16_FLOAT
+		Snorm16x2,			// DXGI_FORMAT_R16G16_SNORM, components in [-1, 1]
+		Snorm16x4,			// DXGI_FORMAT_R16G16B16A16_SNORM, components in [-1, 1]
+		Unorm8x4,			// DXGI_FORMAT_R8G8B8A8_UNORM, components in [0, 1]
+		Unorm10_10_10_2,	// DXGI_FORMAT_R10G10B10A2_UNORM, components in [0, 1]
+		PackedNormal,		// DXGI_FORMAT_R10G10B10A2_UNORM holding a unit vector; decode with n * 2 - 1
+	};
+
+	enum class VertexSemantic : uint8_t
+	{
+		Position,
+		Normal,
+		Tangent,
+		Color,
+		TexCoord,
+	};
+
+	constexpr uint32_t GetVertexFormatSize(VertexFormat format)
+	{
+		switch (format)
+		{
+		case VertexFormat::Float2:			return 8;
+		case VertexFormat::Float3:			return 12;
+		case VertexFormat::Float4:			return 16;
+		case VertexFormat::Half2:			return 4;
+		case VertexFormat::Half4:			return 8;
+		case VertexFormat::Snorm16x2:		return 4;
+		case VertexFormat::Snorm16x4:		return 8;
+		case VertexFormat::Unorm8x4:		return 4;
+		case VertexFormat::Unorm10_10_10_2:	return 4;
+		case VertexFormat::PackedNormal:	return 4;
+		}
+		return 0;
+	}
+
+	// Number of floats Set reads and Get writes for an attribute of this format.
+	constexpr uint32_t GetVertexFormatComponentCount(VertexFormat format)
+	{
+		switch (format)
+		{
+		case VertexFormat::Float2:
+		case VertexFormat::Half2:
+		case VertexFormat::Snorm16x2:
+			return 2;
+		case VertexFormat::Float3:
+		case VertexFormat::PackedNormal:
+			return 3;
+		default:
+			return 4;
+		}
+	}
+
+	// Converts one attribute from floats to its storage format.
+	inline void EncodeVertexAttribute(VertexFormat format, const float* values, uint8_t* destination)
+	{
+		switch (format)
+		{
+		case VertexFormat::Float2:
+		case VertexFormat::Float3:
+		case VertexFormat::Float4:
+			memcpy(destination, values, GetVertexFormatSize(format));
+			break;
+
+		case VertexFormat::Half2:
+		case VertexFormat::Half4:
+		{
+			uint16_t halves[4];
+			uint32_t count = GetVertexFormatComponentCount(format);
+			VertexEncoding::EncodeHalf(values, halves, count);
+			memcpy(destination, halves, count * sizeof(uint16_t));
+			break;
+		}
+
+		case VertexFormat::Snorm16x2:
+		case VertexFormat::Snorm16x4:
+		{
+			int16_t snorms[4];
+			uint32_t count = GetVertexFormatComponentCount(format);
+			VertexEncoding::EncodeSnorm16(values, snorms, count);
+			memcpy(destination, snorms, count * sizeof(int16_t));
+			break;
+		}
+
+		case VertexFormat::Unorm8x4:
+			VertexEncoding::EncodeUnorm8(values, destination, 4);
+			break;
+
+		case VertexFormat::Unorm10_10_10_2:
+		{
+			uint32_t packed = VertexEncoding::PackUnorm10_10_10_2(values[0], values[1], values[2], values[3]);
+			memcpy(destination, &packed, sizeof(packed));
+			break;
+		}
+
+		case VertexFormat::PackedNormal:
+		{
+			uint32_t packed = VertexEncoding::PackNormal(values[0], values[1], values[2]);
+			memcpy(destination, &packed, sizeof(packed));
+			break;
+		}
+		}
+	}
+
+	// Converts one attribute from its storage format back to floats.
+	inline void DecodeVertexAttribute(VertexFormat format, const uint8_t* source, float* values)
+	{
+		switch (format)
+		{
+		case VertexFormat::Float2:
+		case VertexFormat::Float3:
+		case VertexFormat::Float4:
+			memcpy(values, source, GetVertexFormatSize(format));
+			break;
+
+		case VertexFormat::Half2:
+		case VertexFormat::Half4:
+		{
+			uint16_t halves[4];
+			uint32_t count = GetVertexFormatComponentCount(format);
+			memcpy(halves, source, count * sizeof(uint16_t));
+			VertexEncoding::DecodeHalf(halves, values, count);
+			break;
+		}
+
+		case VertexFormat::Snorm16x2:
+		case VertexFormat::Snorm16x4:
+		{
+			int16_t snorms[4];
+			uint32_t count = GetVertexFormatComponentCount(format);
+			memcpy(snorms, source, count * sizeof(int16_t));
+			VertexEncoding::DecodeSnorm16(snorms, values, count);
+			break;
+		}
+
+		case VertexFormat::Unorm8x4:
+			VertexEncoding::DecodeUnorm8(source, values, 4);
+			break;
+
+		case VertexFormat::Unorm10_10_10_2:
+		{
+			uint32_t packed;
+			memcpy(&packed, source, sizeof(packed));
+			VertexEncoding::UnpackUnorm10_10_10_2(packed, values);
+			break;
+		}
+
+		case VertexFormat::PackedNormal:
+		{
+			uint32_t packed;
+			memcpy(&packed, source, sizeof(packed));
+			VertexEncoding::UnpackNormal(packed, values);
+			break;
+		}
+		}
+	}
+
+	// One attribute of a vertex layout.
+	template<VertexSemantic TSemantic, VertexFormat TFormat, uint32_t TSemanticIndex = 0>
+	struct VertexAttribute
+	{
+		static constexpr VertexSemantic Semantic = TSemantic;
+		static constexpr VertexFormat Format = TFormat;
+		static constexpr uint32_t SemanticIndex = TSemanticIndex;
+	};
+
+	// Describes an interleaved vertex at compile time. The attributes are packed in order with no
+	// padding, and the same description produces the C++ storage for a vertex and the Direct3D
+	// input layout, so the two can't disagree. For example:
+	//
+	//   using Layout = VertexLayout<
+	//       VertexAttribute<VertexSemantic::Position, VertexFormat::Snorm16x4>,
+	//       VertexAttribute<VertexSemantic::Color, VertexFormat::Unorm8x4>>;
+	//
+	//   Layout::Vertex vertex;
+	//   vertex.Set<0>(position);
+	//   auto elements = Layout::GetInputElements();
+	template<typename... TAttributes>
+	class VertexLayout
+	{
+	public:
+		static constexpr size_t AttributeCount = sizeof...(TAttributes);
+		static constexpr std::array<VertexFormat, AttributeCount> Formats = { TAttributes::Format... };
+		static constexpr std::array<VertexSemantic, AttributeCount> Semantics = { TAttributes::Semantic... };
+		static constexpr std::array<uint32_t, AttributeCount> SemanticIndices = { TAttributes::SemanticIndex... };
+
+		static constexpr uint32_t GetOffset(size_t attribute)
+		{
+			uint32_t offset = 0;
+			for (size_t i = 0; i < attribute; i++)
+			{
+				offset += GetVertexFormatSize(Formats[i]);
+			}
+			return offset;
+		}
+
+		static constexpr uint32_t Stride = GetOffset(AttributeCount);
+
+		static_assert(AttributeCount > 0, "A vertex layout needs at least one attribute.");
+		static_assert(Stride % 4 == 0, "Vertex stride must be a multiple of four bytes.");
+
+		// Storage for one vertex, packed exactly as the input layout describes.
+		struct Vertex
+		{
+			uint8_t data[Stride];
+
+			// Encodes the attribute from GetVertexFormatComponentCount floats.
+			template<size_t TAttribute>
+			void Set(const float* values)
+			{
+				static_assert(TAttribute < AttributeCount, "Attribute index out of range.");
+				EncodeVertexAttribute(Formats[TAttribute], values, data + GetOffset(TAttribute));
+			}
+
+			template<size_t TAttribute>
+			void Get(float* values) const
+			{
+				static_assert(TAttribute < AttributeCount, "Attribute index out of range.");
+				DecodeVertexAttribute(Formats[TAttribute], data + GetOffset(TAttribute), values);
+			}
+		};
+
+		static_assert(sizeof(Vertex) == Stride, "Vertex storage must not be padded.");
+
+		static constexpr const char* GetSemanticName(VertexSemantic semantic)
+		{
+			switch (semantic)
+			{
+			case VertexSemantic::Position:	return "POSITION";
+			case VertexSemantic::Normal:	return "NORMAL";
+			case VertexSemantic::Tangent:	return "TANGENT";
+			case VertexSemantic::Color:		return "COLOR";
+			case VertexSemantic::TexCoord:	return "TEXCOORD";
+			}
+			return "";
+		}
+
+		static constexpr DXGI_FORMAT GetDxgiFormat(VertexFormat format)
+		{
+			switch (format)
+			{
+			case VertexFormat::Float2:			return DXGI_FORMAT_R32G32_FLOAT;
+			case VertexFormat::Float3:			return DXGI_FORMAT_R32G32B32_FLOAT;
+			case VertexFormat::Float4:			return DXGI_FORMAT_R32G32B32A32_FLOAT;
+			case VertexFormat::Half2:			return DXGI_FORMAT_R16G16_FLOAT;
+			case VertexFormat::Half4:			return DXGI_FORMAT_R16G16B16A16_FLOAT;
+			case VertexFormat::Snorm16x2:		return DXGI_FORMAT_R16G16_SNORM;
+			case VertexFormat::Snorm16x4:		return DXGI_FORMAT_R16G16B16A16_SNORM;
+			case VertexFormat::Unorm8x4:		return DXGI_FORMAT_R8G8B8A8_UNORM;
+			case VertexFormat::Unorm10_10_10_2:	return DXGI_FORMAT_R10G10B10A2_UNORM;
+			case VertexFormat::PackedNormal:	return DXGI_FORMAT_R10G10B10A2_UNORM;
+			}
+			return DXGI_FORMAT_UNKNOWN;
+		}
+
+		// The input layout for vertex buffer slot 0.
+		static std::array<D3D11_INPUT_ELEMENT_DESC, AttributeCount> GetInputElements()
+		{
+			std::array<D3D11_INPUT_ELEMENT_DESC, AttributeCount> elements = {};
+			for (size_t i = 0; i < AttributeCount; i++)
+			{
+				elements[i].SemanticName = GetSemanticName(Semantics[i]);
+				elements[i].SemanticIndex = SemanticIndices[i];
+				elements[i].Format = GetDxgiFormat(Formats[i]);
+				elements[i].InputSlot = 0;
+				elements[i].AlignedByteOffset = GetOffset(i);
+				elements[i].InputSlotClass = D3D11_INPUT_PER_VERTEX_DATA;
+				elements[i].InstanceDataStepRate = 0;
+			}
+			return elements;
+		}
+	};
+}
@@ -0,0 +1,413 @@
+﻿#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <map>
+#include <mutex>
+#include <set>
+#include <vector>
+
+namespace DX
+{
+	// A warm-start cache keeps what the app derived from its assets on one launch, such as shader
+	// bytecode read from loose files or vertices encoded for the input layout, so that the next
+	// launch can map it instead of doing the work again. The file holds:
+	//
+	//   WarmStartCacheHeader
+	//   WarmStartCacheEntry[entryCount]	Sorted by key.
+	//   data								Each entry's data starts on a 16-byte boundary.
+	//
+	// Every entry records a hash of the source it was derived from. A lookup only succeeds if the
+	// caller's hash of the current source matches, so changed assets are rebuilt one by one; a
+	// different build key, e.g. from a new package version, discards the whole file. All values
+	// are little-endian and every offset is from the start of the file.
+	const uint32_t WarmStartCacheMagic = 0x43575844;	// "DXWC"
+	const uint32_t WarmStartCacheVersion = 1;
+	const uint32_t WarmStartCacheDataAlignment = 16;
+
+	struct WarmStartCacheHeader
+	{
+		uint32_t	magic;
+		uint32_t	version;
+		uint32_t	entryCount;
+		uint32_t	reserved;
+		uint64_t	buildKey;			// Chosen by the app; caches from other builds are ignored.
+		uint64_t	generation;			// Increases with every save, to find the newest file.
+		uint64_t	entriesOffset;
+		uint64_t	entriesChecksum;	// HashWarmStartData of the entry table.
+		uint64_t	fileSize;
+	};
+
+	struct WarmStartCacheEntry
+	{
+		uint64_t	key;
+		uint64_t	sourceHash;
+		uint64_t	offset;
+		uint32_t	size;
+		uint32_t	reserved;
+		uint64_t	checksum;			// HashWarmStartData of the data.
+	};
+
+	static_assert(sizeof(WarmStartCacheHeader) == 56, "The cache header layout is part of the file format.");
+	static_assert(sizeof(WarmStartCacheEntry) == 40, "The cache entry layout is part of the file format.");
+
+	// 64-bit FNV-1a. Hashes of several pieces can be chained by passing the previous hash as the
+	// seed.
+	inline uint64_t HashWarmStartData(const void* data, size_t size, uint64_t seed = 14695981039346656037ull)
+	{
+		auto bytes = static_cast<const uint8_t*>(data);
+		uint64_t hash = seed;
+		for (size_t i = 0; i < size; i++)
+		{
+			hash = (hash ^ bytes[i]) * 1099511628211ull;
+		}
+		return hash;
+	}
+
+	// Names an entry by the kind of data it holds, e.g. "Shader", and an id within that kind.
+	inline uint64_t MakeWarmStartKey(const char* kind, uint64_t id = 0)
+	{
+		return HashWarmStartData(&id, sizeof(id), HashWarmStartData(kind, strlen(kind)));
+	}
+
+	// The data of one entry.
+	struct WarmStartBlob
+	{
+		const void*	data;
+		size_t		size;
+	};
+
+	// Reads a cache file in place. Like ShaderArchive it doesn't copy or own the memory it is
+	// opened on, which must stay valid, and be 8-byte aligned, for as long as the cache is used.
+	class WarmStartCache
+	{
+	public:
+		WarmStartCache() :
+			m_data(nullptr),
+			m_header(nullptr),
+			m_entries(nullptr)
+		{
+		}
+
+		// Validates the header and the entry table. Returns false, leaving the cache empty, if
+		// the data isn't a complete cache of this version and build. Entry data is only checked
+		// by Find, so that a mapped file only reads the pages of the entries that are used.
+		bool Open(const void* data, size_t size, uint64_t buildKey)
+		{
+			Close();
+
+			if (data == nullptr || size < sizeof(WarmStartCacheHeader) || reinterpret_cast<uintptr_t>(data) % alignof(WarmStartCacheHeader) != 0)
+			{
+				return false;
+			}
+
+			auto bytes = static_cast<const uint8_t*>(data);
+			auto header = reinterpret_cast<const WarmStartCacheHeader*>(bytes);
+			if (header->magic != WarmStartCacheMagic || header->version != WarmStartCacheVersion ||
+				header->buildKey != buildKey || header->fileSize != size)
+			{
+				return false;
+			}
+
+			if (header->entriesOffset % 8 != 0 || header->entriesOffset > size ||
+				header->entryCount > (size - header->entriesOffset) / sizeof(WarmStartCacheEntry))
+			{
+				return false;
+			}
+
+			auto entries = reinterpret_cast<const WarmStartCacheEntry*>(bytes + header->entriesOffset);
+			if (HashWarmStartData(entries, header->entryCount * sizeof(WarmStartCacheEntry)) != header->entriesChecksum)
+			{
+				return false;
+			}
+
+			for (uint32_t i = 0; i < header->entryCount; i++)
+			{
+				if (entries[i].offset > size || entries[i].size > size - entries[i].offset ||
+					(i > 0 && entries[i].key <= entries[i - 1].key))
+				{
+					return false;
+				}
+			}
+
+			m_data = bytes;
+			m_header = header;
+			m_entries = entries;
+			return true;
+		}
+
+		void Close()
+		{
+			m_data = nullptr;
+			m_header = nullptr;
+			m_entries = nullptr;
+		}
+
+		bool IsOpen() const					{ return m_header != nullptr; }
+		uint64_t GetGeneration() const		{ return m_header != nullptr ? m_header->generation : 0; }
+		uint32_t GetEntryCount() const		{ return m_header != nullptr ? m_header->entryCount : 0; }
+		const WarmStartCacheEntry& GetEntry(uint32_t index) const	{ return m_entries[index]; }
+
+		// The data of an entry, without checking it.
+		WarmStartBlob GetData(const WarmStartCacheEntry& entry) const { return { m_data + entry.offset, entry.size }; }
+
+		// Looks up an entry by key. Returns nullptr if there is none.
+		const WarmStartCacheEntry* FindEntry(uint64_t key) const
+		{
+			if (m_header == nullptr)
+			{
+				return nullptr;
+			}
+
+			const WarmStartCacheEntry* end = m_entries + m_header->entryCount;
+			const WarmStartCacheEntry* entry = std::lower_bound(m_entries, end, key,
+				[](const WarmStartCacheEntry& candidate, uint64_t value) { return candidate.key < value; });
+			return (entry != end && entry->key == key) ? entry : nullptr;
+		}
+
+		// Whether the entry's data is what was written, e.g. after a save that didn't finish.
+		bool IsIntact(const WarmStartCacheEntry& entry) const
+		{
+			return HashWarmStartData(m_data + entry.offset, entry.size) == entry.checksum;
+		}
+
+	private:
+		const uint8_t*				m_data;
+		const WarmStartCacheHeader*	m_header;
+		const WarmStartCacheEntry*	m_entries;
+	};
+
+	// Builds a cache file.
+	class WarmStartCacheWriter
+	{
+	public:
+		// Adds an entry, replacing any earlier one with the same key.
+		void Add(uint64_t key, uint64_t sourceHash, const void* data, size_t size)
+		{
+			auto bytes = static_cast<const uint8_t*>(data);
+			Entry& entry = m_entries[key];
+			entry.sourceHash = sourceHash;
+			entry.data.assign(bytes, bytes + size);
+		}
+
+		size_t GetEntryCount() const { return m_entries.size(); }
+
+		// Entries are written in key order, so the same entries always give the same file.
+		std::vector<uint8_t> Serialize(uint64_t buildKey, uint64_t generation) const
+		{
+			WarmStartCacheHeader header = {};
+			header.magic = WarmStartCacheMagic;
+			header.version = WarmStartCacheVersion;
+			header.entryCount = static_cast<uint32_t>(m_entries.size());
+			header.buildKey = buildKey;
+			header.generation = generation;
+			header.entriesOffset = sizeof(WarmStartCacheHeader);
+
+			std::vector<WarmStartCacheEntry> entries;
+			entries.reserve(m_entries.size());
+			uint64_t offset = header.entriesOffset + m_entries.size() * sizeof(WarmStartCacheEntry);
+			for (const auto& [key, entry] : m_entries)
+			{
+				offset = (offset + WarmStartCacheDataAlignment - 1) / WarmStartCacheDataAlignment * WarmStartCacheDataAlignment;
+				entries.push_back({ key, entry.sourceHash, offset, static_cast<uint32_t>(entry.data.size()), 0,
+					HashWarmStartData(entry.data.data(), entry.data.size()) });
+				offset += entry.data.size();
+			}
+			header.entriesChecksum = HashWarmStartData(entries.data(), entries.size() * sizeof(WarmStartCacheEntry));
+			header.fileSize = offset;
+
+			std::vector<uint8_t> file(static_cast<size_t>(offset), 0);
+			memcpy(file.data(), &header, sizeof(header));
+			if (!entries.empty())
+			{
+				memcpy(file.data() + header.entriesOffset, entries.data(), entries.size() * sizeof(WarmStartCacheEntry));
+			}
+
+			size_t index = 0;
+			for (const auto& [key, entry] : m_entries)
+			{
+				if (!entry.data.empty())
+				{
+					memcpy(file.data() + entries[index].offset, entry.data.data(), entry.data.size());
+				}
+				index++;
+			}
+
+			return file;
+		}
+
+	private:
+		struct Entry
+		{
+			uint64_t				sourceHash;
+			std::vector<uint8_t>	data;
+		};
+
+		std::map<uint64_t, Entry>	m_entries;
+	};
+
+	// How lookups in a WarmStartStore went. Stale entries were found but derived from a different
+	// source, or damaged; they are rebuilt like missing ones.
+	struct WarmStartStats
+	{
+		uint32_t	hits;
+		uint32_t	misses;
+		uint32_t	stale;
+	};
+
+	// The cache as the app uses it over a launch. The app keeps two files, and saves to the one it
+	// didn't load from: the loaded file stays mapped while lookups point into it, and a save that
+	// doesn't finish leaves the other file to load next time. Reading and writing the files is
+	// up to the caller, so that the same logic runs on every platform; see
+	// Tools\WarmStartCacheTool.cpp. Find and Store may be called from any thread.
+	class WarmStartStore
+	{
+	public:
+		static const uint32_t SlotCount = 2;
+
+		explicit WarmStartStore(uint64_t buildKey) :
+			m_buildKey(buildKey),
+			m_loadedSlot(SlotCount),
+			m_dirty(false),
+			m_stats()
+		{
+		}
+
+		WarmStartStore(const WarmStartStore&) = delete;
+		WarmStartStore& operator=(const WarmStartStore&) = delete;
+
+		// Offers the contents of one of the files, before any lookups. The newest valid file is
+		// used. The data must stay valid as long as the store if it is the one GetLoadedSlot
+		// returns afterwards; the other can be released.
+		bool Open(uint32_t slot, const void* data, size_t size)
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+
+			WarmStartCache cache;
+			if (slot >= SlotCount || !cache.Open(data, size, m_buildKey) ||
+				(m_cache.IsOpen() && cache.GetGeneration() <= m_cache.GetGeneration()))
+			{
+				return false;
+			}
+
+			m_cache = cache;
+			m_loadedSlot = slot;
+			return true;
+		}
+
+		// SlotCount if no file was valid.
+		uint32_t GetLoadedSlot() const { return m_loadedSlot; }
+
+		// Looks up what was derived from a source with the given hash. The data stays valid as
+		// long as the store, unless the key is stored again.
+		bool Find(uint64_t key, uint64_t sourceHash, WarmStartBlob* blob)
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+
+			auto stored = m_stored.find(key);
+			if (stored != m_stored.end())
+			{
+				if (stored->second.sourceHash != sourceHash)
+				{
+					m_stats.stale++;
+					return false;
+				}
+
+				*blob = { stored->second.data.data(), stored->second.data.size() };
+				m_stats.hits++;
+				return true;
+			}
+
+			const WarmStartCacheEntry* entry = m_cache.FindEntry(key);
+			if (entry == nullptr)
+			{
+				m_stats.misses++;
+				return false;
+			}
+
+			if (entry->sourceHash != sourceHash || !m_cache.IsIntact(*entry))
+			{
+				// Leave the entry out of the next save, whether or not it is rebuilt.
+				m_discarded.insert(key);
+				m_dirty = true;
+				m_stats.stale++;
+				return false;
+			}
+
+			*blob = m_cache.GetData(*entry);
+			m_stats.hits++;
+			return true;
+		}
+
+		// Keeps what was derived from a source, for the next save and later lookups.
+		void Store(uint64_t key, uint64_t sourceHash, const void* data, size_t size)
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+
+			auto bytes = static_cast<const uint8_t*>(data);
+			StoredEntry& stored = m_stored[key];
+			stored.sourceHash = sourceHash;
+			stored.data.assign(bytes, bytes + size);
+			m_dirty = true;
+		}
+
+		// Whether anything changed since the cache was loaded or last saved.
+		bool NeedsSave() const
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+			return m_dirty;
+		}
+
+		// The file to write to GetSaveSlot: the entries of the loaded file that are still valid,
+		// whether or not they were looked up, and everything stored since. Counts as saved.
+		std::vector<uint8_t> Serialize()
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+
+			WarmStartCacheWriter writer;
+			for (uint32_t i = 0; i < m_cache.GetEntryCount(); i++)
+			{
+				const WarmStartCacheEntry& entry = m_cache.GetEntry(i);
+				if (m_discarded.count(entry.key) == 0 && m_stored.count(entry.key) == 0)
+				{
+					WarmStartBlob blob = m_cache.GetData(entry);
+					writer.Add(entry.key, entry.sourceHash, blob.data, blob.size);
+				}
+			}
+
+			for (const auto& [key, stored] : m_stored)
+			{
+				writer.Add(key, stored.sourceHash, stored.data.data(), stored.data.size());
+			}
+
+			m_dirty = false;
+			return writer.Serialize(m_buildKey, m_cache.GetGeneration() + 1);
+		}
+
+		uint32_t GetSaveSlot() const { return m_loadedSlot == 0 ? 1 : 0; }
+
+		WarmStartStats GetStats() const
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+			return m_stats;
+		}
+
+	private:
+		struct StoredEntry
+		{
+			uint64_t				sourceHash;
+			std::vector<uint8_t>	data;
+		};
+
+		uint64_t							m_buildKey;
+		mutable std::mutex					m_mutex;
+		WarmStartCache						m_cache;
+		uint32_t							m_loadedSlot;
+		std::map<uint64_t, StoredEntry>		m_stored;
+		std::set<uint64_t>					m_discarded;
+		bool								m_dirty;
+		WarmStartStats						m_stats;
+	};
+}
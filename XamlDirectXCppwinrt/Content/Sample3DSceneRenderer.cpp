@@ -2,20 +2,142 @@
 #include "Sample3DSceneRenderer.h"
 
 #include "..\Common\DirectXHelper.h"
+#include "..\Common\Profiler.h"
 
 using namespace winrt::$projectname$::implementation;
 
 using namespace DirectX;
 using namespace winrt::Windows::Foundation;
 
+namespace
+{
+	// Mesh vertices. Each vertex has a position and a color.
+	const VertexPositionColor cubeVertices[] =
+	{
+		// -x : orange
+		{XMFLOAT3(-0.5f, -0.5f, -0.5f), XMFLOAT3(1.0f, 0.35f, 0.0f)},	 //  0
+		{XMFLOAT3(-0.5f, -0.5f,  0.5f), XMFLOAT3(1.0f, 0.35f, 0.0f)},	 //  1
+		{XMFLOAT3(-0.5f,  0.5f, -0.5f), XMFLOAT3(1.0f, 0.35f, 0.0f)},	 //  2
+		{XMFLOAT3(-0.5f,  0.5f,  0.5f), XMFLOAT3(1.0f, 0.35f, 0.0f)},	 //  3
+
+		// +x : red
+		{XMFLOAT3(0.5f, -0.5f, -0.5f),  XMFLOAT3(0.80f, 0.12f, .23f)},	 //  4
+		{XMFLOAT3(0.5f, -0.5f,  0.5f),  XMFLOAT3(0.80f, 0.12f, .23f)},	 //  5
+		{XMFLOAT3(0.5f,  0.5f, -0.5f),  XMFLOAT3(0.80f, 0.12f, .23f)},	 //  6
+		{XMFLOAT3(0.5f,  0.5f,  0.5f),  XMFLOAT3(0.80f, 0.12f, .23f)},	 //  7
+
+		// -y : white
+		{XMFLOAT3(-0.5f, -0.5f, -0.5f), XMFLOAT3(1.0f, 1.0f, 1.0f)},     //  8
+		{XMFLOAT3(-0.5f, -0.5f,  0.5f), XMFLOAT3(1.0f, 1.0f, 1.0f)},     //  9
+		{XMFLOAT3(0.5f, -0.5f, -0.5f),  XMFLOAT3(1.0f, 1.0f, 1.0f)},     // 10
+		{XMFLOAT3(0.5f, -0.5f,  0.5f),  XMFLOAT3(1.0f, 1.0f, 1.0f)},     // 11
+
+		// +y : yellow
+		{XMFLOAT3(-0.5f,  0.5f, -0.5f), XMFLOAT3(1.0f, 0.84f, 0.0f)},    // 12
+		{XMFLOAT3(-0.5f,  0.5f,  0.5f), XMFLOAT3(1.0f, 0.84f, 0.0f)},    // 13
+		{XMFLOAT3( 0.5f,  0.5f, -0.5f), XMFLOAT3(1.0f, 0.84f, 0.0f)},    // 14
+		{XMFLOAT3( 0.5f,  0.5f,  0.5f), XMFLOAT3(1.0f, 0.84f, 0.0f)},    // 15
+
+		// -z : green
+		{XMFLOAT3(-0.5f, -0.5f, -0.5f), XMFLOAT3(0.0f, 0.48f, 0.29f)},   // 16
+		{XMFLOAT3(-0.5f,  0.5f, -0.5f), XMFLOAT3(0.0f, 0.48f, 0.29f)},   // 17
+		{XMFLOAT3( 0.5f, -0.5f, -0.5f), XMFLOAT3(0.0f, 0.48f, 0.29f)},   // 18
+		{XMFLOAT3( 0.5f,  0.5f, -0.5f), XMFLOAT3(0.0f, 0.48f, 0.29f)},   // 19
+
+		// +z : blue
+		{XMFLOAT3(-0.5f, -0.5f,  0.5f), XMFLOAT3(0.0f, 0.32f, 0.73f)},   // 20
+		{XMFLOAT3(-0.5f,  0.5f,  0.5f), XMFLOAT3(0.0f, 0.32f, 0.73f)},   // 21
+		{XMFLOAT3( 0.5f, -0.5f,  0.5f), XMFLOAT3(0.0f, 0.32f, 0.73f)},   // 22
+		{XMFLOAT3( 0.5f,  0.5f,  0.5f), XMFLOAT3(0.0f, 0.32f, 0.73f)},   // 23
+	};
+
+	// Mesh indices. Each trio of indices represents
+	// a triangle to be rendered on the screen.
+	// For example: 0,2,1 means that the vertices with indexes
+	// 0, 2 and 1 from the vertex buffer compose the
+	// first triangle of this mesh.
+	const unsigned short cubeIndices [] =
+	{
+		0,2,1, // -x
+		1,2,3,
+
+		4,5,6, // +x
+		5,7,6,
+
+		8,9,11, // -y
+		8,11,10,
+
+		12,14,15, // +y
+		12,15,13,
+
+		16,18,19, // -z
+		16,19,17,
+
+		20,21,23, // +z
+		20,23,22,
+	};
+
+	// What SaveState writes. The layout is part of saved snapshots; change the tag along with it.
+	struct SceneState
+	{
+		float	currentRadians;
+		float	previousRadians;
+		float	degreesPerSecond;
+	};
+
+	const uint32_t SceneStateTag = DX::MakeStateSnapshotTag('C', 'U', 'B', 'E');
+
+	// Compresses a vertex into the format the input layout describes. The cube fits inside
+	// [-1, 1], so its positions can be stored as SNORM16 without scaling.
+	VertexPositionColorLayout::Vertex EncodeVertex(VertexPositionColor const& vertex)
+	{
+		const float position[4] = { vertex.pos.x, vertex.pos.y, vertex.pos.z, 1.0f };
+		const float color[4] = { vertex.color.x, vertex.color.y, vertex.color.z, 1.0f };
+		VertexPositionColorLayout::Vertex encoded;
+		encoded.Set<0>(position);
+		encoded.Set<1>(color);
+		return encoded;
+	}
+}
+
 // Loads vertex and pixel shaders from files and instantiates the cube geometry.
-Sample3DSceneRenderer::Sample3DSceneRenderer(const std::shared_ptr<DX::DeviceResources>& deviceResources) :
+Sample3DSceneRenderer::Sample3DSceneRenderer(
+	const std::shared_ptr<DX::DeviceResources>& deviceResources,
+	const std::shared_ptr<DX::FrameScheduler>& frameScheduler,
+	const std::shared_ptr<DX::DeferredContextPool>& deferredContexts,
+	const std::shared_ptr<DX::GeometryPool>& geometryPool,
+	const std::shared_ptr<DX::ShaderLibrary>& shaderLibrary,
+	const std::shared_ptr<DX::WarmStartStore>& warmStart) :
 	m_loadingComplete(false),
 	m_degreesPerSecond(45),
-	m_indexCount(0),
+	m_cubeMesh(DX::GeometryPool::InvalidMesh),
+	m_gpuCulling(false),
 	m_tracking(false),
-	m_deviceResources(deviceResources)
+	m_previousRadians(0.0f),
+	m_currentRadians(0.0f),
+	m_drawnRadians(0.0f),
+	m_hasDrawn(false),
+	m_projectionJitter(),
+	m_deviceResources(deviceResources),
+	m_frameScheduler(frameScheduler),
+	m_deferredContexts(deferredContexts),
+	m_commandRecorder(*deferredContexts),
+	m_geometryPool(geometryPool),
+	m_shaderLibrary(shaderLibrary),
+	m_warmStart(warmStart)
 {
+	// Other backends read the cube as the input assembler expands its compressed vertices.
+	m_backendVertices.resize(ARRAYSIZE(cubeVertices));
+	for (size_t i = 0; i < ARRAYSIZE(cubeVertices); i++)
+	{
+		VertexPositionColorLayout::Vertex encoded = EncodeVertex(cubeVertices[i]);
+		float position[4];
+		float color[4];
+		encoded.Get<0>(position);
+		encoded.Get<1>(color);
+		m_backendVertices[i] = { { position[0], position[1], position[2] }, { color[0], color[1], color[2] } };
+	}
+
 	CreateDeviceDependentResourcesAsync();
 	CreateWindowSizeDependentResources();
 }
@@ -52,22 +174,40 @@ void Sample3DSceneRenderer::CreateWindowSizeDependentResources()
 
 	XMMATRIX orientationMatrix = XMLoadFloat4x4(&orientation);
 
-	XMStoreFloat4x4(
-		&m_constantBufferData.projection,
-		XMMatrixTranspose(perspectiveMatrix * orientationMatrix)
-		);
-
 	// Eye is at (0,0.7,1.5), looking at point (0,-0.1,0) with the up-vector along the y-axis.
 	static const XMVECTORF32 eye = { 0.0f, 0.7f, 1.5f, 0.0f };
 	static const XMVECTORF32 at = { 0.0f, -0.1f, 0.0f, 0.0f };
 	static const XMVECTORF32 up = { 0.0f, 1.0f, 0.0f, 0.0f };
 
-	XMStoreFloat4x4(&m_constantBufferData.view, XMMatrixTranspose(XMMatrixLookAtRH(eye, at, up)));
+	XMMATRIX viewMatrix = XMMatrixLookAtRH(eye, at, up);
+
+	XMStoreFloat4x4(
+		&m_projection,
+		perspectiveMatrix * orientationMatrix
+		);
+	SetProjectionJitter(m_projectionJitter);
+
+	XMStoreFloat4x4(&m_constantBufferData.view, viewMatrix);
+
+	// Culling tests objects against the frustum of the combined matrix.
+	XMStoreFloat4x4(&m_viewProjection, viewMatrix * perspectiveMatrix * orientationMatrix);
+}
+
+// Moves the image by a clip space offset, for temporal antialiasing. Culling keeps using the
+// projection without it.
+void Sample3DSceneRenderer::SetProjectionJitter(DX::JitterOffset clip)
+{
+	m_projectionJitter = clip;
+	m_constantBufferData.projection = m_projection;
+	DX::ApplyProjectionJitter(&m_constantBufferData.projection.m[0][0], clip);
 }
 
 // Called once per frame, rotates the cube and calculates the model and view matrices.
 void Sample3DSceneRenderer::Update(DX::StepTimer const& timer)
 {
+	// Keep the state from the previous update so Render can blend between the two.
+	m_previousRadians = m_currentRadians;
+
 	if (!m_tracking)
 	{
 		// Convert degrees to radians, then convert seconds to rotation angle
@@ -76,14 +216,19 @@ void Sample3DSceneRenderer::Update(DX::StepTimer const& timer)
 		float radians = static_cast<float>(fmod(totalRotation, XM_2PI));
 
 		Rotate(radians);
+
+		// The cube spins continuously, so every frame is different from the last.
+		if (m_degreesPerSecond != 0.0f)
+		{
+			m_frameScheduler->Invalidate();
+		}
 	}
 }
 
 // Rotate the 3D cube model a set amount of radians.
 void Sample3DSceneRenderer::Rotate(float radians)
 {
-	// Prepare to pass the updated model matrix to the shader
-	XMStoreFloat4x4(&m_constantBufferData.model, XMMatrixTranspose(XMMatrixRotationY(radians)));
+	m_currentRadians = radians;
 }
 
 void Sample3DSceneRenderer::StartTracking()
@@ -98,6 +243,9 @@ void Sample3DSceneRenderer::TrackingUpdate(float positionX)
 	{
 		float radians = XM_2PI * 2.0f * positionX / m_deviceResources->GetOutputSize().Width;
 		Rotate(radians);
+
+		// Direct manipulation should follow the pointer exactly, so don't blend toward it.
+		m_previousRadians = m_currentRadians;
 	}
 }
 
@@ -106,8 +254,48 @@ void Sample3DSceneRenderer::StopTracking()
 	m_tracking = false;
 }
 
+void Sample3DSceneRenderer::SaveState(DX::StateSnapshotWriter& snapshot) const
+{
+	snapshot.Write(SceneStateTag, SceneState{ m_currentRadians, m_previousRadians, m_degreesPerSecond });
+}
+
+void Sample3DSceneRenderer::RestoreState(const DX::StateSnapshotReader& snapshot)
+{
+	SceneState state;
+	if (snapshot.Read(SceneStateTag, &state))
+	{
+		m_currentRadians = state.currentRadians;
+		m_previousRadians = state.previousRadians;
+		m_degreesPerSecond = state.degreesPerSecond;
+		m_hasDrawn = false;
+		m_frameScheduler->Invalidate();
+	}
+}
+
+// In fixed timestep mode the clock is usually part way between two updates. Interpolate
+// the rotation by that fraction, taking the short way around when the angle wraps.
+float Sample3DSceneRenderer::GetInterpolatedRadians(DX::StepTimer const& timer) const
+{
+	return DX::InterpolateRadians(m_previousRadians, m_currentRadians, timer.GetInterpolationAlpha());
+}
+
+// Reports the part of the render target that will look different in the next frame. The cube
+// can cover any part of the screen, so any change to it damages the whole view.
+void Sample3DSceneRenderer::CollectDamage(DX::StepTimer const& timer, DX::DirtyRect const& bounds, DX::DirtyRegion& damage)
+{
+	if (!m_loadingComplete)
+	{
+		return;
+	}
+
+	if (!m_hasDrawn || GetInterpolatedRadians(timer) != m_drawnRadians)
+	{
+		damage.Add(bounds);
+	}
+}
+
 // Renders one frame using the vertex and pixel shaders.
-void Sample3DSceneRenderer::Render()
+void Sample3DSceneRenderer::Render(DX::StepTimer const& timer)
 {
 	// Loading is asynchronous. Only draw geometry after it's loaded.
 	if (!m_loadingComplete)
@@ -115,9 +303,154 @@ void Sample3DSceneRenderer::Render()
 		return;
 	}
 
+	m_drawnRadians = GetInterpolatedRadians(timer);
+	m_hasDrawn = true;
+
+	BuildDrawPackets(m_drawnRadians, m_geometryPool->GetMeshRange(m_cubeMesh));
+
+	DX::FrustumPlanes frustum = DX::ExtractFrustumPlanes(m_viewProjection.m);
+
+	if (m_gpuCulling && m_drawPackets.size() <= MaxGpuInstances)
+	{
+		RenderCulledOnGpu(frustum);
+	}
+	else
+	{
+		RenderCulledOnCpu(frustum);
+	}
+}
+
+// Draws the same frame through another backend, such as the software rasterizer, culling on
+// the CPU. It needs no device resources, and the caller clears the target. The main class
+// uses it to check the Direct3D frames against the software rasterizer's.
+void Sample3DSceneRenderer::Render(DX::StepTimer const& timer, DX::IRenderBackend& backend)
+{
+	if (!m_loadingComplete)
+	{
+		return;
+	}
+
+	DX_PROFILE_SCOPE("Sample3DSceneRenderer::Render(IRenderBackend)");
+
+	BuildDrawPackets(GetInterpolatedRadians(timer), DX::MeshRange());
+	CullPackets(DX::ExtractFrustumPlanes(m_viewProjection.m));
+
+	backend.SetViewProjection(&m_constantBufferData.view.m[0][0], &m_constantBufferData.projection.m[0][0]);
+	for (const DrawPacket& packet : m_visiblePackets)
+	{
+		backend.DrawIndexed(m_backendVertices.data(), cubeIndices, ARRAYSIZE(cubeIndices), &packet.model.m[0][0]);
+	}
+}
+
+// Describes every object to draw this frame. The sample has a single cube.
+// TODO: Add a packet per object in your scene.
+void Sample3DSceneRenderer::BuildDrawPackets(float radians, DX::MeshRange const& cubeMesh)
+{
+	m_drawPackets.clear();
+	DrawPacket cube;
+	XMMATRIX model = XMMatrixRotationY(radians);
+	XMStoreFloat4x4(&cube.model, model);
+	cube.mesh = cubeMesh;
+
+	// The cube's bounding sphere is centered on its origin and touches its corners.
+	XMFLOAT3 center;
+	XMStoreFloat3(&center, XMVector3Transform(XMVectorZero(), model));
+	cube.bounds = { center.x, center.y, center.z, 0.8660254f };
+	m_drawPackets.push_back(cube);
+}
+
+// Culls the packets on the CPU and records the survivors. Scenes with many objects are
+// recorded on several threads, then executed in the order of the packets.
+void Sample3DSceneRenderer::RenderCulledOnCpu(DX::FrustumPlanes const& frustum)
+{
+	DX_PROFILE_SCOPE("Sample3DSceneRenderer::RenderCulledOnCpu");
+
+	CullPackets(frustum);
+
+	m_commandRecorder.Record(
+		m_visiblePackets.data(),
+		m_visiblePackets.size(),
+		[this](ID3D11DeviceContext3& context) { BindPipeline(context); },
+		[this](ID3D11DeviceContext3& context, DrawPacket const& packet) { DrawObject(context, packet); });
+}
+
+// Leaves the packets that intersect the frustum in m_visiblePackets, in their original order.
+void Sample3DSceneRenderer::CullPackets(DX::FrustumPlanes const& frustum)
+{
+	uint32_t packetCount = static_cast<uint32_t>(m_drawPackets.size());
+	m_instanceBounds.resize(packetCount);
+	m_visibleInstances.resize(packetCount);
+	for (uint32_t i = 0; i < packetCount; i++)
+	{
+		m_instanceBounds[i] = m_drawPackets[i].bounds;
+	}
+
+	uint32_t visibleCount = DX::CullInstances(frustum, m_instanceBounds.data(), packetCount, m_visibleInstances.data());
+
+	m_visiblePackets.clear();
+	for (uint32_t i = 0; i < visibleCount; i++)
+	{
+		m_visiblePackets.push_back(m_drawPackets[m_visibleInstances[i]]);
+	}
+}
+
+// Culls the packets in a compute shader, which writes the arguments of a single instanced
+// draw. The CPU never learns how many instances are visible, so nothing waits on the GPU.
+void Sample3DSceneRenderer::RenderCulledOnGpu(DX::FrustumPlanes const& frustum)
+{
+	DX_PROFILE_SCOPE("Sample3DSceneRenderer::RenderCulledOnGpu");
+
 	auto context = m_deviceResources->GetD3DDeviceContext();
 
-	// Prepare the constant buffer to send it to the graphics device.
+	// Every packet in the sample draws the cube. A scene with several meshes needs one
+	// dispatch and indirect draw per mesh.
+	uint32_t instanceCount = static_cast<uint32_t>(m_drawPackets.size());
+	const DX::MeshRange& mesh = m_drawPackets[0].mesh;
+
+	m_instanceData.resize(instanceCount);
+	for (uint32_t i = 0; i < instanceCount; i++)
+	{
+		const DrawPacket& packet = m_drawPackets[i];
+		m_instanceData[i].model = packet.model;
+		m_instanceData[i].bounds = XMFLOAT4(packet.bounds.centerX, packet.bounds.centerY, packet.bounds.centerZ, packet.bounds.radius);
+	}
+
+	D3D11_BOX instanceBox = CD3D11_BOX(0, 0, 0, instanceCount * sizeof(InstanceData), 1, 1);
+	context->UpdateSubresource(m_instanceBuffer.get(), 0, &instanceBox, m_instanceData.data(), 0, 0);
+
+	CullingConstantBuffer cullingConstants = {};
+	memcpy(cullingConstants.frustumPlanes, frustum.planes, sizeof(frustum.planes));
+	cullingConstants.instanceCount = instanceCount;
+	context->UpdateSubresource(m_cullingConstantBuffer.get(), 0, nullptr, &cullingConstants, 0, 0);
+
+	// Start from no visible instances; the compute shader counts them up.
+	DX::DrawIndexedIndirectArgs drawArgs = DX::MakeDrawArgs(mesh.indexCount, mesh.startIndex, mesh.baseVertex);
+	context->UpdateSubresource(m_drawArgsBuffer.get(), 0, nullptr, &drawArgs, 0, 0);
+
+	// Cull.
+	ID3D11Buffer* cullingConstantBufferNoRef = m_cullingConstantBuffer.get();
+	ID3D11ShaderResourceView* instanceViewNoRef = m_instanceView.get();
+	ID3D11UnorderedAccessView* cullingOutputs[] = { m_visibleInstanceAccess.get(), m_drawArgsAccess.get() };
+	context->CSSetShader(m_cullingShader.get(), nullptr, 0);
+	context->CSSetConstantBuffers(CullingConstantBufferLayout.registerIndex, 1, &cullingConstantBufferNoRef);
+	context->CSSetShaderResources(0, 1, &instanceViewNoRef);
+	context->CSSetUnorderedAccessViews(0, ARRAYSIZE(cullingOutputs), cullingOutputs, nullptr);
+	context->Dispatch((instanceCount + 63) / 64, 1, 1);
+
+	// Unbind the outputs so the vertex shader can read them.
+	ID3D11UnorderedAccessView* nullOutputs[ARRAYSIZE(cullingOutputs)] = {};
+	ID3D11ShaderResourceView* nullView = nullptr;
+	context->CSSetUnorderedAccessViews(0, ARRAYSIZE(nullOutputs), nullOutputs, nullptr);
+	context->CSSetShaderResources(0, 1, &nullView);
+	context->CSSetShader(nullptr, nullptr, 0);
+
+	// Draw every visible instance at once.
+	BindPipeline(*context);
+	context->VSSetShader(m_instancedVertexShader.get(), nullptr, 0);
+
+	ID3D11ShaderResourceView* instanceViews[] = { m_instanceView.get(), m_visibleInstanceView.get() };
+	context->VSSetShaderResources(0, ARRAYSIZE(instanceViews), instanceViews);
+
 	context->UpdateSubresource1(
 		m_constantBuffer.get(),
 		0,
@@ -128,30 +461,24 @@ void Sample3DSceneRenderer::Render()
 		0
 		);
 
-	// Each vertex is one instance of the VertexPositionColor struct.
-	UINT stride = sizeof(VertexPositionColor);
-	UINT offset = 0;
-	auto vertexBufferNoRef = m_vertexBuffer.get();
-	context->IASetVertexBuffers(
-		0,
-		1,
-		&vertexBufferNoRef,
-		&stride,
-		&offset
-		);
+	context->DrawIndexedInstancedIndirect(m_drawArgsBuffer.get(), 0);
 
-	context->IASetIndexBuffer(
-		m_indexBuffer.get(),
-		DXGI_FORMAT_R16_UINT, // Each index is one 16-bit unsigned integer (short).
-		0
-		);
+	ID3D11ShaderResourceView* nullViews[ARRAYSIZE(instanceViews)] = {};
+	context->VSSetShaderResources(0, ARRAYSIZE(nullViews), nullViews);
+}
 
-	context->IASetPrimitiveTopology(D3D11_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
+// Sets the state shared by every object. Called once for each context that records packets.
+void Sample3DSceneRenderer::BindPipeline(ID3D11DeviceContext3& context)
+{
+	// Every mesh shares the pool's vertex and index buffers, so they are bound once.
+	m_geometryPool->Bind(context);
 
-	context->IASetInputLayout(m_inputLayout.get());
+	context.IASetPrimitiveTopology(D3D11_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
+
+	context.IASetInputLayout(m_inputLayout.get());
 
 	// Attach our vertex shader.
-	context->VSSetShader(
+	context.VSSetShader(
 		m_vertexShader.get(),
 		nullptr,
 		0
@@ -159,7 +486,7 @@ void Sample3DSceneRenderer::Render()
 
 	// Send the constant buffer to the graphics device.
 	auto constantBufferNoRef = m_constantBuffer.get();
-	context->VSSetConstantBuffers1(
+	context.VSSetConstantBuffers1(
 		0,
 		1,
 		&constantBufferNoRef,
@@ -168,54 +495,72 @@ void Sample3DSceneRenderer::Render()
 		);
 
 	// Attach our pixel shader.
-	context->PSSetShader(
+	context.PSSetShader(
 		m_pixelShader.get(),
 		nullptr,
 		0
 		);
 
-	// Draw the objects.
-	context->DrawIndexed(
-		m_indexCount,
+}
+
+// Draws one object. May run on a worker thread, so only the packet and read-only members are used.
+void Sample3DSceneRenderer::DrawObject(ID3D11DeviceContext3& context, DrawPacket const& packet)
+{
+	// Prepare to pass the object's model matrix to the shader.
+	ModelViewProjectionConstantBuffer constantBufferData = m_constantBufferData;
+	constantBufferData.model = packet.model;
+
+	// Prepare the constant buffer to send it to the graphics device.
+	context.UpdateSubresource1(
+		m_constantBuffer.get(),
+		0,
+		NULL,
+		&constantBufferData,
+		0,
 		0,
 		0
 		);
+
+	// Draw the object from its part of the shared buffers.
+	context.DrawIndexed(
+		packet.mesh.indexCount,
+		packet.mesh.startIndex,
+		packet.mesh.baseVertex
+		);
 }
 
 winrt::fire_and_forget Sample3DSceneRenderer::CreateDeviceDependentResourcesAsync()
 {
-	// After the vertex shader file is loaded, create the shader and input layout.
-	std::vector<byte> vertexShaderFileData;
-	co_await DX::ReadDataAsync(L"ms-appx:///SampleVertexShader.cso", &vertexShaderFileData);
+	DX_PROFILE_SCOPE("Sample3DSceneRenderer::CreateDeviceDependentResourcesAsync");
+
+	// After the vertex shader is loaded, create the shader and input layout.
+	DX::ShaderVariant vertexShader;
+	co_await m_shaderLibrary->LoadAsync("SampleVertexShader", 0, &vertexShader);
 
 	winrt::check_hresult(
 		m_deviceResources->GetD3DDevice()->CreateVertexShader(
-			&vertexShaderFileData[0],
-			vertexShaderFileData.size(),
+			vertexShader.bytecode.data,
+			vertexShader.bytecode.size,
 			nullptr,
 			m_vertexShader.put()));
 
-	static const D3D11_INPUT_ELEMENT_DESC vertexDesc [] =
-	{
-		{ "POSITION", 0, DXGI_FORMAT_R32G32B32_FLOAT, 0, 0, D3D11_INPUT_PER_VERTEX_DATA, 0 },
-		{ "COLOR", 0, DXGI_FORMAT_R32G32B32_FLOAT, 0, 12, D3D11_INPUT_PER_VERTEX_DATA, 0 },
-	};
+	const auto vertexDesc = VertexPositionColorLayout::GetInputElements();
 
 	winrt::check_hresult(
 		m_deviceResources->GetD3DDevice()->CreateInputLayout(
-			vertexDesc,
-			ARRAYSIZE(vertexDesc),
-			&vertexShaderFileData[0],
-			vertexShaderFileData.size(),
+			vertexDesc.data(),
+			static_cast<UINT>(vertexDesc.size()),
+			vertexShader.bytecode.data,
+			vertexShader.bytecode.size,
 			m_inputLayout.put()));
 
-	// After the pixel shader file is loaded, create the shader and constant buffer.
-	std::vector<byte> pixelShaderFileData;
-	co_await DX::ReadDataAsync(L"ms-appx:///SamplePixelShader.cso", &pixelShaderFileData);
+	// After the pixel shader is loaded, create the shader and constant buffer.
+	DX::ShaderVariant pixelShader;
+	co_await m_shaderLibrary->LoadAsync("SamplePixelShader", 0, &pixelShader);
 	winrt::check_hresult(
 		m_deviceResources->GetD3DDevice()->CreatePixelShader(
-			&pixelShaderFileData[0],
-			pixelShaderFileData.size(),
+			pixelShader.bytecode.data,
+			pixelShader.bytecode.size,
 			nullptr,
 			m_pixelShader.put()));
 
@@ -226,108 +571,137 @@ winrt::fire_and_forget Sample3DSceneRenderer::CreateDeviceDependentResourcesAsyn
 			nullptr,
 			m_constantBuffer.put()));
 
-	// Load mesh vertices. Each vertex has a position and a color.
-	static const VertexPositionColor cubeVertices[] = 
+	// Culling on the GPU needs compute shaders that can write to buffers, which arrived with
+	// feature level 11. Older hardware culls on the CPU instead.
+	if (m_deviceResources->GetDeviceFeatureLevel() >= D3D_FEATURE_LEVEL_11_0)
 	{
-		// -x : orange
-		{XMFLOAT3(-0.5f, -0.5f, -0.5f), XMFLOAT3(1.0f, 0.35f, 0.0f)},	 //  0
-		{XMFLOAT3(-0.5f, -0.5f,  0.5f), XMFLOAT3(1.0f, 0.35f, 0.0f)},	 //  1
-		{XMFLOAT3(-0.5f,  0.5f, -0.5f), XMFLOAT3(1.0f, 0.35f, 0.0f)},	 //  2
-		{XMFLOAT3(-0.5f,  0.5f,  0.5f), XMFLOAT3(1.0f, 0.35f, 0.0f)},	 //  3
-
-		// +x : red
-		{XMFLOAT3(0.5f, -0.5f, -0.5f),  XMFLOAT3(0.80f, 0.12f, .23f)},	 //  4
-		{XMFLOAT3(0.5f, -0.5f,  0.5f),  XMFLOAT3(0.80f, 0.12f, .23f)},	 //  5
-		{XMFLOAT3(0.5f,  0.5f, -0.5f),  XMFLOAT3(0.80f, 0.12f, .23f)},	 //  6
-		{XMFLOAT3(0.5f,  0.5f,  0.5f),  XMFLOAT3(0.80f, 0.12f, .23f)},	 //  7
-
-		// -y : white
-		{XMFLOAT3(-0.5f, -0.5f, -0.5f), XMFLOAT3(1.0f, 1.0f, 1.0f)},     //  8
-		{XMFLOAT3(-0.5f, -0.5f,  0.5f), XMFLOAT3(1.0f, 1.0f, 1.0f)},     //  9
-		{XMFLOAT3(0.5f, -0.5f, -0.5f),  XMFLOAT3(1.0f, 1.0f, 1.0f)},     // 10
-		{XMFLOAT3(0.5f, -0.5f,  0.5f),  XMFLOAT3(1.0f, 1.0f, 1.0f)},     // 11
-
-		// +y : yellow
-		{XMFLOAT3(-0.5f,  0.5f, -0.5f), XMFLOAT3(1.0f, 0.84f, 0.0f)},    // 12
-		{XMFLOAT3(-0.5f,  0.5f,  0.5f), XMFLOAT3(1.0f, 0.84f, 0.0f)},    // 13
-		{XMFLOAT3( 0.5f,  0.5f, -0.5f), XMFLOAT3(1.0f, 0.84f, 0.0f)},    // 14
-		{XMFLOAT3( 0.5f,  0.5f,  0.5f), XMFLOAT3(1.0f, 0.84f, 0.0f)},    // 15
-
-		// -z : green
-		{XMFLOAT3(-0.5f, -0.5f, -0.5f), XMFLOAT3(0.0f, 0.48f, 0.29f)},   // 16
-		{XMFLOAT3(-0.5f,  0.5f, -0.5f), XMFLOAT3(0.0f, 0.48f, 0.29f)},   // 17
-		{XMFLOAT3( 0.5f, -0.5f, -0.5f), XMFLOAT3(0.0f, 0.48f, 0.29f)},   // 18
-		{XMFLOAT3( 0.5f,  0.5f, -0.5f), XMFLOAT3(0.0f, 0.48f, 0.29f)},   // 19
-																				 
-		// +z : blue
-		{XMFLOAT3(-0.5f, -0.5f,  0.5f), XMFLOAT3(0.0f, 0.32f, 0.73f)},   // 20
-		{XMFLOAT3(-0.5f,  0.5f,  0.5f), XMFLOAT3(0.0f, 0.32f, 0.73f)},   // 21
-		{XMFLOAT3( 0.5f, -0.5f,  0.5f), XMFLOAT3(0.0f, 0.32f, 0.73f)},   // 22
-		{XMFLOAT3( 0.5f,  0.5f,  0.5f), XMFLOAT3(0.0f, 0.32f, 0.73f)},   // 23
-	};
+		auto device = m_deviceResources->GetD3DDevice();
+
+		DX::ShaderVariant cullingShader;
+		co_await m_shaderLibrary->LoadAsync("SampleCullingComputeShader", 0, &cullingShader);
+		winrt::check_hresult(
+			device->CreateComputeShader(
+				cullingShader.bytecode.data,
+				cullingShader.bytecode.size,
+				nullptr,
+				m_cullingShader.put()));
+
+		DX::ShaderVariant instancedVertexShader;
+		co_await m_shaderLibrary->LoadAsync("SampleInstancedVertexShader", 0, &instancedVertexShader);
+		winrt::check_hresult(
+			device->CreateVertexShader(
+				instancedVertexShader.bytecode.data,
+				instancedVertexShader.bytecode.size,
+				nullptr,
+				m_instancedVertexShader.put()));
+
+		CD3D11_BUFFER_DESC cullingConstantBufferDesc(sizeof(CullingConstantBuffer), D3D11_BIND_CONSTANT_BUFFER);
+		winrt::check_hresult(
+			device->CreateBuffer(
+				&cullingConstantBufferDesc,
+				nullptr,
+				m_cullingConstantBuffer.put()));
+
+		// Instance data, read by both the compute and the vertex shader.
+		CD3D11_BUFFER_DESC instanceBufferDesc(
+			sizeof(InstanceData) * MaxGpuInstances,
+			D3D11_BIND_SHADER_RESOURCE,
+			D3D11_USAGE_DEFAULT,
+			0,
+			D3D11_RESOURCE_MISC_BUFFER_STRUCTURED,
+			sizeof(InstanceData));
+		winrt::check_hresult(device->CreateBuffer(&instanceBufferDesc, nullptr, m_instanceBuffer.put()));
+
+		CD3D11_SHADER_RESOURCE_VIEW_DESC instanceViewDesc(m_instanceBuffer.get(), DXGI_FORMAT_UNKNOWN, 0, MaxGpuInstances);
+		winrt::check_hresult(device->CreateShaderResourceView(m_instanceBuffer.get(), &instanceViewDesc, m_instanceView.put()));
+
+		// Indices of the visible instances, written by the compute shader.
+		CD3D11_BUFFER_DESC visibleInstanceBufferDesc(
+			sizeof(uint32_t) * MaxGpuInstances,
+			D3D11_BIND_SHADER_RESOURCE | D3D11_BIND_UNORDERED_ACCESS,
+			D3D11_USAGE_DEFAULT,
+			0,
+			D3D11_RESOURCE_MISC_BUFFER_STRUCTURED,
+			sizeof(uint32_t));
+		winrt::check_hresult(device->CreateBuffer(&visibleInstanceBufferDesc, nullptr, m_visibleInstanceBuffer.put()));
+
+		CD3D11_SHADER_RESOURCE_VIEW_DESC visibleInstanceViewDesc(m_visibleInstanceBuffer.get(), DXGI_FORMAT_UNKNOWN, 0, MaxGpuInstances);
+		winrt::check_hresult(device->CreateShaderResourceView(m_visibleInstanceBuffer.get(), &visibleInstanceViewDesc, m_visibleInstanceView.put()));
+
+		CD3D11_UNORDERED_ACCESS_VIEW_DESC visibleInstanceAccessDesc(m_visibleInstanceBuffer.get(), DXGI_FORMAT_UNKNOWN, 0, MaxGpuInstances);
+		winrt::check_hresult(device->CreateUnorderedAccessView(m_visibleInstanceBuffer.get(), &visibleInstanceAccessDesc, m_visibleInstanceAccess.put()));
+
+		// Indirect draw arguments. The compute shader updates them through a raw view.
+		CD3D11_BUFFER_DESC drawArgsBufferDesc(
+			sizeof(DX::DrawIndexedIndirectArgs),
+			D3D11_BIND_UNORDERED_ACCESS,
+			D3D11_USAGE_DEFAULT,
+			0,
+			D3D11_RESOURCE_MISC_DRAWINDIRECT_ARGS | D3D11_RESOURCE_MISC_BUFFER_ALLOW_RAW_VIEWS);
+		winrt::check_hresult(device->CreateBuffer(&drawArgsBufferDesc, nullptr, m_drawArgsBuffer.put()));
+
+		CD3D11_UNORDERED_ACCESS_VIEW_DESC drawArgsAccessDesc(
+			m_drawArgsBuffer.get(),
+			DXGI_FORMAT_R32_TYPELESS,
+			0,
+			sizeof(DX::DrawIndexedIndirectArgs) / sizeof(uint32_t),
+			D3D11_BUFFER_UAV_FLAG_RAW);
+		winrt::check_hresult(device->CreateUnorderedAccessView(m_drawArgsBuffer.get(), &drawArgsAccessDesc, m_drawArgsAccess.put()));
+
+		m_gpuCulling = true;
+	}
 
-	D3D11_SUBRESOURCE_DATA vertexBufferData = {0};
-	vertexBufferData.pSysMem = cubeVertices;
-	vertexBufferData.SysMemPitch = 0;
-	vertexBufferData.SysMemSlicePitch = 0;
-	CD3D11_BUFFER_DESC vertexBufferDesc(sizeof(cubeVertices), D3D11_BIND_VERTEX_BUFFER);
-	winrt::check_hresult(
-		m_deviceResources->GetD3DDevice()->CreateBuffer(
-			&vertexBufferDesc,
-			&vertexBufferData,
-			m_vertexBuffer.put()
-			)
-		);
+	// Compress the vertices into the format the input layout describes, unless an earlier launch
+	// already did so for the same vertices and layout.
+	const uint64_t cubeKey = DX::MakeWarmStartKey("SampleCubeVertices");
+	uint64_t cubeHash = DX::HashWarmStartData(cubeVertices, sizeof(cubeVertices));
+	cubeHash = DX::HashWarmStartData(VertexPositionColorLayout::Formats.data(), sizeof(VertexPositionColorLayout::Formats), cubeHash);
 
-	// Load mesh indices. Each trio of indices represents
-	// a triangle to be rendered on the screen.
-	// For example: 0,2,1 means that the vertices with indexes
-	// 0, 2 and 1 from the vertex buffer compose the 
-	// first triangle of this mesh.
-	static const unsigned short cubeIndices [] =
+	const void* vertices = nullptr;
+	VertexPositionColorLayout::Vertex encodedVertices[ARRAYSIZE(cubeVertices)];
+	DX::WarmStartBlob cached;
+	if (m_warmStart->Find(cubeKey, cubeHash, &cached) && cached.size == sizeof(encodedVertices))
 	{
-		0,2,1, // -x
-		1,2,3,
-
-		4,5,6, // +x
-		5,7,6,
-
-		8,9,11, // -y
-		8,11,10,
-
-		12,14,15, // +y
-		12,15,13,
-
-		16,18,19, // -z
-		16,19,17,
-
-		20,21,23, // +z
-		20,23,22,
-	};
+		vertices = cached.data;
+	}
+	else
+	{
+		for (size_t i = 0; i < ARRAYSIZE(cubeVertices); i++)
+		{
+			encodedVertices[i] = EncodeVertex(cubeVertices[i]);
+		}
+		m_warmStart->Store(cubeKey, cubeHash, encodedVertices, sizeof(encodedVertices));
+		vertices = encodedVertices;
+	}
 
-	m_indexCount = ARRAYSIZE(cubeIndices);
-
-	D3D11_SUBRESOURCE_DATA indexBufferData = {0};
-	indexBufferData.pSysMem = cubeIndices;
-	indexBufferData.SysMemPitch = 0;
-	indexBufferData.SysMemSlicePitch = 0;
-	CD3D11_BUFFER_DESC indexBufferDesc(sizeof(cubeIndices), D3D11_BIND_INDEX_BUFFER);
-	winrt::check_hresult(
-		m_deviceResources->GetD3DDevice()->CreateBuffer(
-			&indexBufferDesc,
-			&indexBufferData,
-			m_indexBuffer.put()));
+	// Place the mesh in the shared geometry buffers. It is uploaded before the next frame.
+	m_cubeMesh = m_geometryPool->AddMesh(vertices, ARRAYSIZE(cubeVertices), cubeIndices, ARRAYSIZE(cubeIndices));
 
 	m_loadingComplete = true;
+
+	// The cube can be drawn now; make sure a frame is produced even if nothing else changes.
+	m_frameScheduler->Invalidate();
 }
 
 void Sample3DSceneRenderer::ReleaseDeviceDependentResources()
 {
 	m_loadingComplete = false;
+	m_hasDrawn = false;
 	m_vertexShader = nullptr;
 	m_inputLayout = nullptr;
 	m_pixelShader = nullptr;
 	m_constantBuffer = nullptr;
-	m_vertexBuffer = nullptr;
-	m_indexBuffer = nullptr;
+	m_gpuCulling = false;
+	m_cullingShader = nullptr;
+	m_instancedVertexShader = nullptr;
+	m_cullingConstantBuffer = nullptr;
+	m_instanceBuffer = nullptr;
+	m_instanceView = nullptr;
+	m_visibleInstanceBuffer = nullptr;
+	m_visibleInstanceView = nullptr;
+	m_visibleInstanceAccess = nullptr;
+	m_drawArgsBuffer = nullptr;
+	m_drawArgsAccess = nullptr;
+	m_geometryPool->RemoveMesh(m_cubeMesh);
+	m_cubeMesh = DX::GeometryPool::InvalidMesh;
 }
\ No newline at end of file
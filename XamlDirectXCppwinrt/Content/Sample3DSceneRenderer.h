@@ -1,8 +1,17 @@
 ﻿#pragma once
 
+#include "..\Common\AntiAliasingFilters.h"
 #include "..\Common\DeviceResources.h"
+#include "..\Common\DeferredContextPool.h"
+#include "..\Common\FrameScheduler.h"
+#include "..\Common\GeometryPool.h"
+#include "..\Common\InstanceCulling.h"
+#include "..\Common\RenderBackend.h"
+#include "..\Common\ShaderLibrary.h"
 #include "ShaderStructures.h"
+#include "..\Common\StateSnapshot.h"
 #include "..\Common\StepTimer.h"
+#include "..\Common\WarmStartCache.h"
 
 namespace winrt::$projectname$::implementation
 {
@@ -10,41 +19,122 @@ namespace winrt::$projectname$::implementation
 	class Sample3DSceneRenderer
 	{
 	public:
-		Sample3DSceneRenderer(const std::shared_ptr<DX::DeviceResources>& deviceResources);
+		Sample3DSceneRenderer(
+			const std::shared_ptr<DX::DeviceResources>& deviceResources,
+			const std::shared_ptr<DX::FrameScheduler>& frameScheduler,
+			const std::shared_ptr<DX::DeferredContextPool>& deferredContexts,
+			const std::shared_ptr<DX::GeometryPool>& geometryPool,
+			const std::shared_ptr<DX::ShaderLibrary>& shaderLibrary,
+			const std::shared_ptr<DX::WarmStartStore>& warmStart);
 		winrt::fire_and_forget CreateDeviceDependentResourcesAsync();
 		void CreateWindowSizeDependentResources();
 		void ReleaseDeviceDependentResources();
 		void Update(DX::StepTimer const& timer);
-		void Render();
+		void CollectDamage(DX::StepTimer const& timer, DX::DirtyRect const& bounds, DX::DirtyRegion& damage);
+		void Render(DX::StepTimer const& timer);
+		void Render(DX::StepTimer const& timer, DX::IRenderBackend& backend);
+		bool IsLoadingComplete() const { return m_loadingComplete; }
 		void StartTracking();
 		void TrackingUpdate(float positionX);
 		void StopTracking();
 		bool IsTracking() { return m_tracking; }
 
+		// The cube's rotation, kept in the app's state snapshot while it is suspended.
+		void SaveState(DX::StateSnapshotWriter& snapshot) const;
+		void RestoreState(const DX::StateSnapshotReader& snapshot);
+
+		// Sub-pixel offset of the projection, for temporal antialiasing. It lasts until replaced.
+		void SetProjectionJitter(DX::JitterOffset clip);
+		DirectX::XMFLOAT4X4 const& GetViewProjection() const { return m_viewProjection; }
+
 
 	private:
+		// Everything needed to draw one object.
+		struct DrawPacket
+		{
+			DirectX::XMFLOAT4X4	model;
+			DX::MeshRange		mesh;
+			DX::InstanceBounds	bounds;
+		};
+
+		// Number of instances the GPU culling buffers can hold.
+		static const uint32_t MaxGpuInstances = 1024;
+
 		void Rotate(float radians);
+		float GetInterpolatedRadians(DX::StepTimer const& timer) const;
+		void BuildDrawPackets(float radians, DX::MeshRange const& cubeMesh);
+		void CullPackets(DX::FrustumPlanes const& frustum);
+		void BindPipeline(ID3D11DeviceContext3& context);
+		void DrawObject(ID3D11DeviceContext3& context, DrawPacket const& packet);
+		void RenderCulledOnCpu(DX::FrustumPlanes const& frustum);
+		void RenderCulledOnGpu(DX::FrustumPlanes const& frustum);
 
 	private:
 		// Cached pointer to device resources.
 		std::shared_ptr<DX::DeviceResources> m_deviceResources;
 
+		// Used to request new frames while the cube is animating.
+		std::shared_ptr<DX::FrameScheduler> m_frameScheduler;
+
+		// Records the draw packets of large scenes on several threads.
+		std::shared_ptr<DX::DeferredContextPool>					m_deferredContexts;
+		DX::ParallelCommandRecorder<DX::DeferredContextPool>		m_commandRecorder;
+		std::vector<DrawPacket>										m_drawPackets;
+		std::vector<DrawPacket>										m_visiblePackets;
+		std::vector<DX::InstanceBounds>								m_instanceBounds;
+		std::vector<uint32_t>										m_visibleInstances;
+
+		// Shared buffers that hold the geometry of every mesh.
+		std::shared_ptr<DX::GeometryPool>	m_geometryPool;
+
+		// Compiled shader variants, from the shader archive or loose files.
+		std::shared_ptr<DX::ShaderLibrary>	m_shaderLibrary;
+
+		// What earlier launches derived from the cube's source data.
+		std::shared_ptr<DX::WarmStartStore>	m_warmStart;
+
 		// Direct3D resources for cube geometry.
 		winrt::com_ptr<ID3D11InputLayout>	m_inputLayout;
-		winrt::com_ptr<ID3D11Buffer>		m_vertexBuffer;
-		winrt::com_ptr<ID3D11Buffer>		m_indexBuffer;
 		winrt::com_ptr<ID3D11VertexShader>	m_vertexShader;
 		winrt::com_ptr<ID3D11PixelShader>	m_pixelShader;
 		winrt::com_ptr<ID3D11Buffer>		m_constantBuffer;
 
+		// Direct3D resources for culling on the GPU, which needs feature level 11.
+		winrt::com_ptr<ID3D11ComputeShader>			m_cullingShader;
+		winrt::com_ptr<ID3D11VertexShader>			m_instancedVertexShader;
+		winrt::com_ptr<ID3D11Buffer>				m_cullingConstantBuffer;
+		winrt::com_ptr<ID3D11Buffer>				m_instanceBuffer;
+		winrt::com_ptr<ID3D11ShaderResourceView>	m_instanceView;
+		winrt::com_ptr<ID3D11Buffer>				m_visibleInstanceBuffer;
+		winrt::com_ptr<ID3D11ShaderResourceView>	m_visibleInstanceView;
+		winrt::com_ptr<ID3D11UnorderedAccessView>	m_visibleInstanceAccess;
+		winrt::com_ptr<ID3D11Buffer>				m_drawArgsBuffer;
+		winrt::com_ptr<ID3D11UnorderedAccessView>	m_drawArgsAccess;
+		std::vector<InstanceData>					m_instanceData;
+		bool										m_gpuCulling;
+
 		// System resources for cube geometry.
 		ModelViewProjectionConstantBuffer	m_constantBufferData;
-		uint32_t	m_indexCount;
+		DirectX::XMFLOAT4X4					m_viewProjection;
+		DirectX::XMFLOAT4X4					m_projection;
+		DX::JitterOffset					m_projectionJitter;
+		DX::GeometryPool::MeshHandle		m_cubeMesh;
+
+		// The cube's vertices for backends other than Direct3D, decoded from the compressed ones.
+		std::vector<DX::BackendVertex>		m_backendVertices;
 
 		// Variables used with the rendering loop.
 		bool	m_loadingComplete;
 		float	m_degreesPerSecond;
 		bool	m_tracking;
+
+		// Cube rotation after the previous and the most recent Update, blended when rendering.
+		float	m_previousRadians;
+		float	m_currentRadians;
+
+		// Rotation shown by the last frame that was drawn, used to tell whether the scene changed.
+		float	m_drawnRadians;
+		bool	m_hasDrawn;
 	};
 }
 
@@ -0,0 +1,42 @@
+// CullingConstantBuffer holds the frustum planes, with inward-facing normals, and the number of
+// instances to test. InstanceData is shared with the instanced vertex shader.
+#include "ShaderStructures.hlsli"
+
+StructuredBuffer<InstanceData> instances : register(t0);
+
+// Indices of the instances that passed, in the order they were appended.
+RWStructuredBuffer<uint> visibleInstances : register(u0);
+
+// DrawIndexedInstancedIndirect arguments. The CPU resets them every frame with instanceCount
+// set to zero, and each visible instance increments it.
+RWByteAddressBuffer drawArgs : register(u1);
+
+// Byte offset of instanceCount within the draw arguments.
+static const uint InstanceCountOffset = 4;
+
+// Tests each instance's bounding sphere against the view frustum. This must stay in sync with
+// DX::CullInstances in InstanceCulling.h, which is the reference for its results.
+[numthreads(64, 1, 1)]
+void main(uint3 dispatchThreadId : SV_DispatchThreadID)
+{
+	uint index = dispatchThreadId.x;
+	if (index >= instanceCount)
+	{
+		return;
+	}
+
+	float4 bounds = instances[index].bounds;
+
+	[unroll]
+	for (uint i = 0; i < 6; i++)
+	{
+		if (dot(frustumPlanes[i].xyz, bounds.xyz) + frustumPlanes[i].w < -bounds.w)
+		{
+			return;
+		}
+	}
+
+	uint slot;
+	drawArgs.InterlockedAdd(InstanceCountOffset, 1, slot);
+	visibleInstances[slot] = index;
+}
@@ -5,39 +5,18 @@
 
 using namespace winrt::$projectname$::implementation;
 
-// Initializes D2D resources used for text rendering.
-SampleFpsTextRenderer::SampleFpsTextRenderer(const std::shared_ptr<DX::DeviceResources>& deviceResources) : 
+namespace
+{
+	// Text size, in DIPs to the em.
+	const float FontSize = 32.0f;
+}
+
+SampleFpsTextRenderer::SampleFpsTextRenderer(const std::shared_ptr<DX::DeviceResources>& deviceResources, const std::shared_ptr<DX::DistanceFieldFont>& font) : 
 	m_text(L""),
-	m_deviceResources(deviceResources)
+	m_drawnBounds(),
+	m_deviceResources(deviceResources),
+	m_font(font)
 {
-	ZeroMemory(&m_textMetrics, sizeof(DWRITE_TEXT_METRICS));
-
-	// Create device independent resources
-	winrt::com_ptr<IDWriteTextFormat> textFormat;
-	winrt::check_hresult(
-		m_deviceResources->GetDWriteFactory()->CreateTextFormat(
-			L"Segoe UI",
-			nullptr,
-			DWRITE_FONT_WEIGHT_LIGHT,
-			DWRITE_FONT_STYLE_NORMAL,
-			DWRITE_FONT_STRETCH_NORMAL,
-			32.0f,
-			L"en-US",
-			textFormat.put()
-			)
-		);
-
-	m_textFormat = textFormat.as<IDWriteTextFormat2>();
-
-	winrt::check_hresult(
-		m_textFormat->SetParagraphAlignment(DWRITE_PARAGRAPH_ALIGNMENT_NEAR)
-		);
-
-	winrt::check_hresult(
-		m_deviceResources->GetD2DFactory()->CreateDrawingStateBlock(m_stateBlock.put())
-		);
-
-	CreateDeviceDependentResources();
 }
 
 // Updates the text to be displayed.
@@ -46,70 +25,76 @@ void SampleFpsTextRenderer::Update(DX::StepTimer const& timer)
 	// Update display text.
 	uint32_t fps = timer.GetFramesPerSecond();
 
-	m_text = (fps > 0) ? std::to_wstring(fps) + L" FPS" : L" - FPS";
+	std::wstring text = (fps > 0) ? std::to_wstring(fps) + L" FPS" : L" - FPS";
 
-	winrt::com_ptr<IDWriteTextLayout> textLayout;
-	winrt::check_hresult(
-		m_deviceResources->GetDWriteFactory()->CreateTextLayout(
-			m_text.c_str(),
-			(uint32_t) m_text.length(),
-			m_textFormat.get(),
-			240.0f, // Max width of the input text.
-			50.0f, // Max height of the input text.
-			textLayout.put()
-			)
-		);
-
-	m_textLayout = textLayout.as<IDWriteTextLayout3>();
+	// The counter only changes about once a second; don't lay the text out again in between.
+	// A change in the text does not invalidate the frame by itself, so when rendering on
+	// demand the overlay simply shows the new value with the next frame that is drawn.
+	if (text == m_text)
+	{
+		return;
+	}
 
-	winrt::check_hresult(m_textLayout->GetMetrics(&m_textMetrics));
+	m_text = std::move(text);
+	m_font->GetAtlas().LayoutText(m_text, &m_textLayout);
 }
 
-// Renders a frame to the screen.
-void SampleFpsTextRenderer::Render()
+// Maps the text's line box, in ems from its top left corner, to render target pixels: right
+// aligned in the bottom right corner of the logical screen, then rotated to the display's
+// orientation and scaled to its DPI.
+D2D1::Matrix3x2F SampleFpsTextRenderer::GetTextTransform() const
 {
-	ID2D1DeviceContext* context = m_deviceResources->GetD2DDeviceContext();
 	Windows::Foundation::Size logicalSize = m_deviceResources->GetLogicalSize();
+	float pixelsPerDip = m_deviceResources->GetDpi() / 96.0f;
+
+	return
+		D2D1::Matrix3x2F::Scale(FontSize, FontSize) *
+		D2D1::Matrix3x2F::Translation(
+			logicalSize.Width - m_textLayout.width * FontSize,
+			logicalSize.Height - m_font->GetAtlas().GetLineHeight() * FontSize) *
+		m_deviceResources->GetOrientationTransform2D() *
+		D2D1::Matrix3x2F::Scale(pixelsPerDip, pixelsPerDip);
+}
 
-	context->SaveDrawingState(m_stateBlock.get());
-	context->BeginDraw();
-
-	// Position on the bottom right corner
-	D2D1::Matrix3x2F screenTranslation = D2D1::Matrix3x2F::Translation(
-		logicalSize.Width - m_textMetrics.layoutWidth,
-		logicalSize.Height - m_textMetrics.height
-		);
-
-	context->SetTransform(screenTranslation * m_deviceResources->GetOrientationTransform2D());
-
-	winrt::check_hresult(
-		m_textFormat->SetTextAlignment(DWRITE_TEXT_ALIGNMENT_TRAILING)
-		);
-
-	context->DrawTextLayout(
-		D2D1::Point2F(0.f, 0.f),
-		m_textLayout.get(),
-		m_whiteBrush.get()
-		);
+// Returns the area covered by the text, in render target pixels.
+DX::DirtyRect SampleFpsTextRenderer::GetTextBounds() const
+{
+	D2D1::Matrix3x2F transform = GetTextTransform();
+
+	// The orientation transform only rotates by multiples of 90 degrees, so the transformed
+	// corners still describe an axis-aligned rectangle.
+	D2D1_POINT_2F a = transform.TransformPoint(D2D1::Point2F(0.0f, 0.0f));
+	D2D1_POINT_2F b = transform.TransformPoint(D2D1::Point2F(m_textLayout.width, m_font->GetAtlas().GetLineHeight()));
+
+	// Pad by a pixel on each side to cover anti-aliased glyph edges.
+	return {
+		static_cast<int32_t>(floorf(min(a.x, b.x))) - 1,
+		static_cast<int32_t>(floorf(min(a.y, b.y))) - 1,
+		static_cast<int32_t>(ceilf(max(a.x, b.x))) + 1,
+		static_cast<int32_t>(ceilf(max(a.y, b.y))) + 1
+	};
+}
 
-	// Ignore D2DERR_RECREATE_TARGET here. This error indicates that the device
-	// is lost. It will be handled during the next call to Present.
-	HRESULT hr = context->EndDraw();
-	if (hr != D2DERR_RECREATE_TARGET)
+// Reports the part of the render target that will look different in the next frame: where the
+// old text was and where the new text goes.
+void SampleFpsTextRenderer::CollectDamage(DX::DirtyRegion& damage)
+{
+	if (m_text != m_drawnText)
 	{
-		winrt::check_hresult(hr);
+		damage.Add(m_drawnBounds);
+		damage.Add(GetTextBounds());
 	}
-
-	context->RestoreDrawingState(m_stateBlock.get());
 }
 
-void SampleFpsTextRenderer::CreateDeviceDependentResources()
-{
-	winrt::check_hresult(
-		m_deviceResources->GetD2DDeviceContext()->CreateSolidColorBrush(D2D1::ColorF(D2D1::ColorF::White), m_whiteBrush.put())
-		);
-}
-void SampleFpsTextRenderer::ReleaseDeviceDependentResources()
+// Adds the text. The batch is drawn within the frame's scissor rectangle, so only the repainted
+// part of the text is touched.
+void SampleFpsTextRenderer::CollectSprites(DX::SpriteBatch& batch)
 {
-	m_whiteBrush = nullptr;
+	D2D1::Matrix3x2F transform = GetTextTransform();
+	batch.SetTransform({ transform._11, transform._12, transform._21, transform._22, transform._31, transform._32 });
+	m_font->GetAtlas().DrawLayout(batch, m_font->GetTexture(), m_textLayout, 0.0f, 0.0f, 1.0f, 0xFFFFFFFF);
+	batch.ResetTransform();
+
+	m_drawnText = m_text;
+	m_drawnBounds = GetTextBounds();
 }
\ No newline at end of file
@@ -2,30 +2,38 @@
 
 #include <string>
 #include "..\Common\DeviceResources.h"
+#include "..\Common\DirtyRegion.h"
+#include "..\Common\DistanceFieldFont.h"
+#include "..\Common\SpriteBatch.h"
 #include "..\Common\StepTimer.h"
 
 namespace winrt::$projectname$::implementation
 {
-	// Renders the current FPS value in the bottom right corner of the screen using Direct2D and DirectWrite.
+	// Renders the current FPS value in the bottom right corner of the screen, as distance field
+	// text drawn with the other overlays' sprites.
 	class SampleFpsTextRenderer
 	{
 	public:
-		SampleFpsTextRenderer(const std::shared_ptr<DX::DeviceResources>& deviceResources);
-		void CreateDeviceDependentResources();
-		void ReleaseDeviceDependentResources();
+		SampleFpsTextRenderer(const std::shared_ptr<DX::DeviceResources>& deviceResources, const std::shared_ptr<DX::DistanceFieldFont>& font);
 		void Update(DX::StepTimer const& timer);
-		void Render();
+		void CollectDamage(DX::DirtyRegion& damage);
+		void CollectSprites(DX::SpriteBatch& batch);
 
 	private:
+		DX::DirtyRect GetTextBounds() const;
+		D2D1::Matrix3x2F GetTextTransform() const;
+
 		// Cached pointer to device resources.
 		std::shared_ptr<DX::DeviceResources> m_deviceResources;
 
-		// Resources related to text rendering.
-		std::wstring                                    m_text;
-		DWRITE_TEXT_METRICS	                            m_textMetrics;
-		winrt::com_ptr<ID2D1SolidColorBrush>    m_whiteBrush;
-		winrt::com_ptr<ID2D1DrawingStateBlock1> m_stateBlock;
-		winrt::com_ptr<IDWriteTextLayout3>      m_textLayout;
-		winrt::com_ptr<IDWriteTextFormat2>      m_textFormat;
+		// Resources related to text rendering. The layout is in ems, so it stays valid when the
+		// DPI or the orientation changes.
+		std::shared_ptr<DX::DistanceFieldFont>  m_font;
+		std::wstring                            m_text;
+		DX::TextLayout                          m_textLayout;
+
+		// What the last drawn frame showed, and where, in render target pixels.
+		std::wstring                            m_drawnText;
+		DX::DirtyRect                           m_drawnBounds;
 	};
 }
\ No newline at end of file
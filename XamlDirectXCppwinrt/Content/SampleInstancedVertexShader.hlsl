@@ -0,0 +1,43 @@
+// The view and projection matrices come from ModelViewProjectionConstantBuffer. Its model
+// matrix is unused; each instance provides its own in InstanceData.
+#include "ShaderStructures.hlsli"
+
+// Per-instance data written by the CPU and filtered by the culling compute shader.
+StructuredBuffer<InstanceData> instances : register(t0);
+StructuredBuffer<uint> visibleInstances : register(t1);
+
+// Per-vertex data used as input to the vertex shader.
+struct VertexShaderInput
+{
+	float3 pos : POSITION;
+	float3 color : COLOR0;
+	uint instanceId : SV_InstanceID;
+};
+
+// Per-pixel color data passed through the pixel shader.
+struct PixelShaderInput
+{
+	float4 pos : SV_POSITION;
+	float3 color : COLOR0;
+};
+
+// Vertex processing for instances that survived GPU culling.
+PixelShaderInput main(VertexShaderInput input)
+{
+	PixelShaderInput output;
+	float4 pos = float4(input.pos, 1.0f);
+
+	// Instance ids count the visible instances, so look up which instance this is.
+	matrix instanceModel = instances[visibleInstances[input.instanceId]].model;
+
+	// Transform the vertex position into projected space.
+	pos = mul(pos, instanceModel);
+	pos = mul(pos, view);
+	pos = mul(pos, projection);
+	output.pos = pos;
+
+	// Pass the color through without modification.
+	output.color = input.color;
+
+	return output;
+}
@@ -1,10 +1,5 @@
-// A constant buffer that stores the three basic column-major matrices for composing geometry.
-cbuffer ModelViewProjectionConstantBuffer : register(b0)
-{
-	matrix model;
-	matrix view;
-	matrix projection;
-};
+// The three basic row-major matrices for composing geometry, in ModelViewProjectionConstantBuffer.
+#include "ShaderStructures.hlsli"
 
 // Per-vertex data used as input to the vertex shader.
 struct VertexShaderInput
@@ -1,7 +1,16 @@
 ﻿#pragma once
 
+#include <string>
+#include "../Common/ShaderReflection.h"
+#include "../Common/VertexLayout.h"
+
 namespace winrt::$projectname$::implementation
 {
+	// The structures below are shared with the shaders. Each has a layout that is checked against
+	// the HLSL packing rules at compile time; ShaderStructures.hlsli declares them for the shaders
+	// and is generated from these layouts by GenerateShaderStructuresHlsl. Matrices are row-major
+	// on both sides, so they are stored exactly as DirectXMath computes them.
+
 	// Constant buffer used to send MVP matrices to the vertex shader.
 	struct ModelViewProjectionConstantBuffer
 	{
@@ -10,10 +19,69 @@ namespace winrt::$projectname$::implementation
 		DirectX::XMFLOAT4X4 projection;
 	};
 
-	// Used to send per-vertex data to the vertex shader.
+	constexpr auto ModelViewProjectionConstantBufferLayout = DX::DescribeConstantBuffer<ModelViewProjectionConstantBuffer>(
+		"ModelViewProjectionConstantBuffer", 0,
+		DX_SHADER_FIELD(ModelViewProjectionConstantBuffer, model, Float4x4),
+		DX_SHADER_FIELD(ModelViewProjectionConstantBuffer, view, Float4x4),
+		DX_SHADER_FIELD(ModelViewProjectionConstantBuffer, projection, Float4x4));
+
+	static_assert(DX::MatchesShaderPacking(ModelViewProjectionConstantBufferLayout), "ModelViewProjectionConstantBuffer doesn't match HLSL packing.");
+
+	// Per-instance data read by the culling compute shader and the instanced vertex shader.
+	struct InstanceData
+	{
+		DirectX::XMFLOAT4X4 model;
+		DirectX::XMFLOAT4 bounds;	// World space bounding sphere: center in xyz, radius in w.
+	};
+
+	constexpr auto InstanceDataLayout = DX::DescribeStructuredBuffer<InstanceData>(
+		"InstanceData",
+		DX_SHADER_FIELD(InstanceData, model, Float4x4),
+		DX_SHADER_FIELD(InstanceData, bounds, Float4));
+
+	static_assert(DX::MatchesShaderPacking(InstanceDataLayout), "InstanceData doesn't match HLSL packing.");
+
+	// Constant buffer used to send the view frustum to the culling compute shader.
+	struct CullingConstantBuffer
+	{
+		DirectX::XMFLOAT4 frustumPlanes[6];
+		uint32_t instanceCount;
+		uint32_t padding[3];
+	};
+
+	constexpr auto CullingConstantBufferLayout = DX::DescribeConstantBuffer<CullingConstantBuffer>(
+		"CullingConstantBuffer", 1,
+		DX_SHADER_FIELD(CullingConstantBuffer, frustumPlanes, Float4),
+		DX_SHADER_FIELD(CullingConstantBuffer, instanceCount, UInt),
+		DX_SHADER_FIELD(CullingConstantBuffer, padding, UInt3));
+
+	static_assert(DX::MatchesShaderPacking(CullingConstantBufferLayout), "CullingConstantBuffer doesn't match HLSL packing.");
+
+	// Source data for a vertex with a position and a color.
 	struct VertexPositionColor
 	{
 		DirectX::XMFLOAT3 pos;
 		DirectX::XMFLOAT3 color;
 	};
+
+	// Used to send per-vertex data to the vertex shader. Positions are stored as SNORM16 and
+	// colors as RGBA8, 12 bytes per vertex instead of 24; the input assembler expands both to
+	// floats, so the shaders are unaffected.
+	using VertexPositionColorLayout = DX::VertexLayout<
+		DX::VertexAttribute<DX::VertexSemantic::Position, DX::VertexFormat::Snorm16x4>,
+		DX::VertexAttribute<DX::VertexSemantic::Color, DX::VertexFormat::Unorm8x4>>;
+
+	// The contents of ShaderStructures.hlsli. Tools/ShaderStructuresTest checks the file against
+	// this, and rewrites it with --write after a structure changes.
+	inline std::string GenerateShaderStructuresHlsl()
+	{
+		std::string hlsl =
+			"// Declarations of the structures shared with C++. Generated from the layouts in\n"
+			"// ShaderStructures.h by running Tools/ShaderStructuresTest with --write; change the C++\n"
+			"// structures and their layouts, then regenerate this file, rather than editing it by hand.\n";
+		hlsl += "\n" + DX::GenerateHlsl(ModelViewProjectionConstantBufferLayout);
+		hlsl += "\n" + DX::GenerateHlsl(InstanceDataLayout);
+		hlsl += "\n" + DX::GenerateHlsl(CullingConstantBufferLayout);
+		return hlsl;
+	}
 }
\ No newline at end of file
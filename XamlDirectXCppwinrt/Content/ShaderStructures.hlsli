@@ -0,0 +1,23 @@
+// Declarations of the structures shared with C++. Generated from the layouts in
+// ShaderStructures.h by running Tools/ShaderStructuresTest with --write; change the C++
+// structures and their layouts, then regenerate this file, rather than editing it by hand.
+
+cbuffer ModelViewProjectionConstantBuffer : register(b0)
+{
+	row_major float4x4 model;
+	row_major float4x4 view;
+	row_major float4x4 projection;
+};
+
+struct InstanceData
+{
+	row_major float4x4 model;
+	float4 bounds;
+};
+
+cbuffer CullingConstantBuffer : register(b1)
+{
+	float4 frustumPlanes[6];
+	uint instanceCount;
+	uint3 padding;
+};
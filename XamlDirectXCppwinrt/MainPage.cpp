@@ -2,8 +2,13 @@
 #include "MainPage.h"
 #include "MainPage.g.cpp"
 
+#if defined(DX_ENABLE_PROFILER)
+#include <sstream>
+#endif
+
 using namespace winrt;
 using namespace winrt::Windows::Foundation;
+using namespace winrt::Windows::Foundation::Collections;
 using namespace winrt::Windows::UI::Xaml;
 using namespace winrt::Windows::UI::Core;
 using namespace winrt::$projectname$::implementation;
@@ -12,114 +17,161 @@ using namespace winrt::Windows::System::Threading;
 
 MainPage::MainPage()
 {
+    DX_PROFILE_THREAD_NAME("UI");
     InitializeComponent();
 
-    auto window = Window::Current().CoreWindow();
+	// Startup runs as a graph of stages, so that the device is created on other threads while
+	// this one hooks up the window, and assets load while the device is being created. Stages
+	// that touch XAML run on this thread.
+	m_deviceResources = std::make_shared<DX::DeviceResources>(m_startup);
+
+	m_startup.AddStage("Window events", {}, DX::StartupThread::Calling, [this]
+	{
+		auto window = Window::Current().CoreWindow();
 
-    m_visibilityChangedRevoker = window.VisibilityChanged(
-		winrt::auto_revoke, { this, &MainPage::OnVisibilityChanged });
+		m_visibilityChangedRevoker = window.VisibilityChanged(
+			winrt::auto_revoke, { this, &MainPage::OnVisibilityChanged });
 
-	auto currentDisplayInformation = DisplayInformation::GetForCurrentView();
+		auto currentDisplayInformation = DisplayInformation::GetForCurrentView();
 
-	m_dpiChangedRevoker = currentDisplayInformation.DpiChanged(
-		winrt::auto_revoke, { this, &MainPage::OnDpiChanged });
+		m_dpiChangedRevoker = currentDisplayInformation.DpiChanged(
+			winrt::auto_revoke, { this, &MainPage::OnDpiChanged });
 
-	m_orientationChangedRevoker = currentDisplayInformation.OrientationChanged(
-		winrt::auto_revoke, { this, &MainPage::OnOrientationChanged });
+		m_orientationChangedRevoker = currentDisplayInformation.OrientationChanged(
+			winrt::auto_revoke, { this, &MainPage::OnOrientationChanged });
 
-	m_displayContentsInvalidated_revoker = DisplayInformation::DisplayContentsInvalidated(
-		winrt::auto_revoke, { this, &MainPage::OnDisplayContentsInvalidated });
+		m_displayContentsInvalidated_revoker = DisplayInformation::DisplayContentsInvalidated(
+			winrt::auto_revoke, { this, &MainPage::OnDisplayContentsInvalidated });
 
-	m_compositionScaleChanged_revoker = swapChainPanel().CompositionScaleChanged(
-		winrt::auto_revoke, { this, &MainPage::OnCompositionScaleChanged });
+		m_compositionScaleChanged_revoker = swapChainPanel().CompositionScaleChanged(
+			winrt::auto_revoke, { this, &MainPage::OnCompositionScaleChanged });
 
-	m_sizeChanged_revoker = swapChainPanel().SizeChanged(
-		winrt::auto_revoke, { this,  &MainPage::OnSwapChainPanelSizeChanged });
+		m_sizeChanged_revoker = swapChainPanel().SizeChanged(
+			winrt::auto_revoke, { this,  &MainPage::OnSwapChainPanelSizeChanged });
+	});
 
-	// At this point we have access to the device. 
-	// We can create the device-dependent resources.
-	m_deviceResources = std::make_shared<DX::DeviceResources>();
-	m_deviceResources->SetSwapChainPanel(swapChainPanel());
+	// Once the device exists the swap chain can be created for the panel.
+	auto swapChainPanelReady = m_startup.AddStage("Swap chain panel", { m_deviceResources->GetCreationStage() }, DX::StartupThread::Calling, [this]
+	{
+		m_deviceResources->SetSwapChainPanel(swapChainPanel());
+	});
 
-	// Register our SwapChainPanel to get independent input pointer events
-	auto workItemHandler = [this](IAsyncAction const&)
+	m_startup.AddStage("Input", {}, DX::StartupThread::Calling, [this]
 	{
-		// The CoreIndependentInputSource will raise pointer events for the specified device types on whichever thread it's created on.
-		m_coreInput = swapChainPanel().CreateCoreIndependentInputSource(
-			Windows::UI::Core::CoreInputDeviceTypes::Mouse |
-			Windows::UI::Core::CoreInputDeviceTypes::Touch |
-			Windows::UI::Core::CoreInputDeviceTypes::Pen
-		);
-
-		// Register for pointer events, which will be raised on the background thread.
-		m_pointerPressed_revoker = m_coreInput.PointerPressed(
-			winrt::auto_revoke, { this,  &MainPage::OnPointerPressedZ });
-		m_pointerMoved_revoker = m_coreInput.PointerMoved(
-			winrt::auto_revoke, { this,  &MainPage::OnPointerMovedZ });
-		m_pointerReleased_revoker = m_coreInput.PointerReleased(
-			winrt::auto_revoke, { this,  &MainPage::OnPointerReleasedZ });
-
-		// Begin processing input messages as they're delivered.
-		m_coreInput.Dispatcher().ProcessEvents(CoreProcessEventsOption::ProcessUntilQuit);
-	};
-
-	// Run task on a dedicated high priority background thread.
-	m_inputLoopWorker = ThreadPool::RunAsync(workItemHandler, WorkItemPriority::High, WorkItemOptions::TimeSliced);
-
-	m_main = std::unique_ptr<$projectname$Main>(new $projectname$Main(m_deviceResources));
+		// Register our SwapChainPanel to get independent input pointer events
+		auto workItemHandler = [this](IAsyncAction const&)
+		{
+			DX_PROFILE_THREAD_NAME("Input");
+
+			// The CoreIndependentInputSource will raise pointer events for the specified device types on whichever thread it's created on.
+			m_coreInput = swapChainPanel().CreateCoreIndependentInputSource(
+				Windows::UI::Core::CoreInputDeviceTypes::Mouse |
+				Windows::UI::Core::CoreInputDeviceTypes::Touch |
+				Windows::UI::Core::CoreInputDeviceTypes::Pen
+			);
+
+			// Register for pointer events, which will be raised on the background thread.
+			m_pointerPressed_revoker = m_coreInput.PointerPressed(
+				winrt::auto_revoke, { this,  &MainPage::OnPointerPressedZ });
+			m_pointerMoved_revoker = m_coreInput.PointerMoved(
+				winrt::auto_revoke, { this,  &MainPage::OnPointerMovedZ });
+			m_pointerReleased_revoker = m_coreInput.PointerReleased(
+				winrt::auto_revoke, { this,  &MainPage::OnPointerReleasedZ });
+
+			// Begin processing input messages as they're delivered.
+			m_coreInput.Dispatcher().ProcessEvents(CoreProcessEventsOption::ProcessUntilQuit);
+		};
+
+		// Run task on a dedicated high priority background thread.
+		m_inputLoopWorker = ThreadPool::RunAsync(workItemHandler, WorkItemPriority::High, WorkItemOptions::TimeSliced);
+	});
+
+	// The main class adds the stages that load content. Input may arrive as soon as the input
+	// thread starts, and is queued until the render loop runs.
+	m_main = std::make_shared<$projectname$Main>(m_deviceResources, m_startup, swapChainPanelReady);
+
+	m_startup.Run(DX::StartupGraph::GetDefaultWorkerCount());
+
+#if defined(DX_ENABLE_PROFILER)
+	// Report when each stage ran, to see what the first frame waited for.
+	std::ostringstream timeline;
+	m_startup.WriteTimeline(timeline);
+	OutputDebugStringA(timeline.str().c_str());
+#endif
+
 	m_main->StartRenderLoop();
 }
 
 MainPage::~MainPage()
 {
-	// Stop rendering and processing events on destruction.
-	m_main->StopRenderLoop();
+	// Stop rendering and processing events on destruction. The workers are joined in the
+	// background, which keeps the main class alive until they have exited.
+	m_main->StopRenderLoopAsync();
 	m_coreInput.Dispatcher().StopProcessEvents();
 }
 
+namespace
+{
+	const wchar_t StateSnapshotKey[] = L"StateSnapshot";
+}
+
+IAsyncAction MainPage::SuspendAsync(IPropertySet state)
+{
+	auto strongThis = get_strong();
+	co_await m_main->SuspendAsync();
+
+	// The snapshot is a few dozen bytes, well within what a setting can hold.
+	state.Insert(StateSnapshotKey, PropertyValue::CreateUInt8Array(m_main->SaveState()));
+}
+
+void MainPage::Resume()
+{
+	// Restarts the render loop, or streaming if the window is hidden.
+	m_main->Resume();
+}
+
+void MainPage::LoadInternalState(IPropertySet const& state)
+{
+	auto value = state.TryLookup(StateSnapshotKey).try_as<IPropertyValue>();
+	if (value != nullptr)
+	{
+		com_array<uint8_t> snapshot;
+		value.GetUInt8Array(snapshot);
+		m_main->RestoreState(std::vector<uint8_t>(snapshot.begin(), snapshot.end()));
+	}
+}
+
 void MainPage::OnVisibilityChanged(
 	winrt::Windows::UI::Core::CoreWindow const& /*sender*/,
 	winrt::Windows::UI::Core::VisibilityChangedEventArgs const& args)
 {
-	m_windowVisible = args.Visible();
-	if (m_windowVisible)
-	{
-		m_main->StartRenderLoop();
-	}
-	else
-	{
-		m_main->StopRenderLoop();
-	}
+	// Hiding the window stops the render loop and streams in the background until it is shown.
+	m_main->SetVisible(args.Visible());
 }
 
 void MainPage::OnDpiChanged(
 	winrt::Windows::Graphics::Display::DisplayInformation const& sender,
 	winrt::Windows::Foundation::IInspectable const& /*args*/)
 {
-	concurrency::critical_section::scoped_lock lock(m_main->CriticalSection());
 	// Note: The value for LogicalDpi retrieved here may not match the effective DPI of the app
 	// if it is being scaled for high resolution devices. Once the DPI is set on DeviceResources,
 	// you should always retrieve it using the GetDpi method.
 	// See DeviceResources.cpp for more details.
-	m_deviceResources->SetDpi(sender.LogicalDpi());
-	m_main->CreateWindowSizeDependentResources();
+	m_main->SetDpi(sender.LogicalDpi());
 }
 
 void MainPage::OnOrientationChanged(
 	winrt::Windows::Graphics::Display::DisplayInformation const& sender,
 	winrt::Windows::Foundation::IInspectable const& /*args*/)
 {
-	concurrency::critical_section::scoped_lock lock(m_main->CriticalSection());
-	m_deviceResources->SetCurrentOrientation(sender.CurrentOrientation());
-	m_main->CreateWindowSizeDependentResources();
+	m_main->SetCurrentOrientation(sender.CurrentOrientation());
 }
 
 void MainPage::OnDisplayContentsInvalidated(
 	winrt::Windows::Graphics::Display::DisplayInformation const& /*sender*/,
 	winrt::Windows::Foundation::IInspectable const& /*args*/)
 {
-	concurrency::critical_section::scoped_lock lock(m_main->CriticalSection());
-	m_deviceResources->ValidateDevice();
+	m_main->ValidateDevice();
 }
 
 // Called when the app bar button is clicked.
@@ -133,45 +185,65 @@ void MainPage::AppBarButton_Click(
 
 void MainPage::OnPointerPressedZ(
 	winrt::Windows::Foundation::IInspectable const& /*sender*/,
-	winrt::Windows::UI::Core::PointerEventArgs const& /*e*/)
+	winrt::Windows::UI::Core::PointerEventArgs const& e)
 {
 	// When the pointer is pressed begin tracking the pointer movement.
-	m_main->StartTracking();
+	QueuePointerEvent(DX::InputEventType::PointerPressed, e.CurrentPoint());
 }
 
 void MainPage::OnPointerMovedZ(
 	winrt::Windows::Foundation::IInspectable const& /*sender*/,
 	winrt::Windows::UI::Core::PointerEventArgs const& e)
 {
-	// Update the pointer tracking code.
-	if (m_main->IsTracking())
+	// Only forward movement while the pointer is down; hovering doesn't affect the scene.
+	if (!e.CurrentPoint().IsInContact())
+	{
+		return;
+	}
+
+	// The input stack may have coalesced several samples into this event. Forward all of them,
+	// oldest first, so the render loop sees the complete motion history.
+	auto points = e.GetIntermediatePoints();
+	for (uint32_t i = points.Size(); i > 0; i--)
 	{
-		m_main->TrackingUpdate(e.CurrentPoint().Position().X);
+		QueuePointerEvent(DX::InputEventType::PointerMoved, points.GetAt(i - 1));
 	}
 }
 
 void MainPage::OnPointerReleasedZ(
 	winrt::Windows::Foundation::IInspectable const& /*sender*/,
-	winrt::Windows::UI::Core::PointerEventArgs const& /*e*/)
+	winrt::Windows::UI::Core::PointerEventArgs const& e)
 {
 	// Stop tracking pointer movement when the pointer is released.
-	m_main->StopTracking();
+	QueuePointerEvent(DX::InputEventType::PointerReleased, e.CurrentPoint());
+}
+
+// Hands a pointer sample to the render loop. This runs on the input thread, so nothing here
+// may touch rendering state directly.
+void MainPage::QueuePointerEvent(
+	DX::InputEventType type,
+	winrt::Windows::UI::Input::PointerPoint const& point)
+{
+	DX::InputEvent inputEvent;
+	inputEvent.type = type;
+	inputEvent.pointerId = point.PointerId();
+	inputEvent.x = point.Position().X;
+	inputEvent.y = point.Position().Y;
+	inputEvent.timestamp = point.Timestamp();
+
+	m_main->QueueInput(inputEvent);
 }
 
 void MainPage::OnCompositionScaleChanged(
 	winrt::Windows::UI::Xaml::Controls::SwapChainPanel const& sender,
 	winrt::Windows::Foundation::IInspectable const& /*args*/)
 {
-	concurrency::critical_section::scoped_lock lock(m_main->CriticalSection());
-	m_deviceResources->SetCompositionScale(sender.CompositionScaleX(), sender.CompositionScaleY());
-	m_main->CreateWindowSizeDependentResources();
+	m_main->SetCompositionScale(sender.CompositionScaleX(), sender.CompositionScaleY());
 }
 
 void MainPage::OnSwapChainPanelSizeChanged(
 	winrt::Windows::Foundation::IInspectable const& /*sender*/,
 	winrt::Windows::UI::Xaml::SizeChangedEventArgs const& e)
 {
-	concurrency::critical_section::scoped_lock lock(m_main->CriticalSection());
-	m_deviceResources->SetLogicalSize(e.NewSize());
-	m_main->CreateWindowSizeDependentResources();
+	m_main->SetLogicalSize(e.NewSize());
 }
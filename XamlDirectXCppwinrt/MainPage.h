@@ -2,6 +2,7 @@
 
 #include "MainPage.g.h"
 #include "Common\DeviceResources.h"
+#include "Common\StartupGraph.h"
 #include "$projectname$Main.h"
 
 namespace winrt::$projectname$::implementation
@@ -11,6 +12,12 @@ namespace winrt::$projectname$::implementation
         MainPage();
         ~MainPage();
 
+        // Application lifecycle. The state snapshot is kept in the given settings while the app
+        // is suspended, and read back if it was terminated in the meantime.
+        winrt::Windows::Foundation::IAsyncAction SuspendAsync(winrt::Windows::Foundation::Collections::IPropertySet state);
+        void Resume();
+        void LoadInternalState(winrt::Windows::Foundation::Collections::IPropertySet const& state);
+
     private:
         // Window event handlers.
         void OnVisibilityChanged(
@@ -58,11 +65,16 @@ namespace winrt::$projectname$::implementation
         void OnPointerReleasedZ(
             winrt::Windows::Foundation::IInspectable const& sender,
             winrt::Windows::UI::Core::PointerEventArgs const& e);
+        void QueuePointerEvent(
+            DX::InputEventType type,
+            winrt::Windows::UI::Input::PointerPoint const& point);
+
+        // The stages of startup, kept for their timeline.
+        DX::StartupGraph m_startup;
 
         // Resources used to render the DirectX content in the XAML page background.
         std::shared_ptr<DX::DeviceResources> m_deviceResources;
-        std::unique_ptr<$projectname$Main> m_main;
-        bool m_windowVisible{ true };
+        std::shared_ptr<$projectname$Main> m_main;
 
         // Event revokers
         winrt::Windows::UI::Core::CoreWindow::VisibilityChanged_revoker m_visibilityChangedRevoker;
@@ -0,0 +1,586 @@
+﻿// Checks the reference math of the antialiasing modes in AntiAliasingFilters.h: the weights
+// of the multisample resolve, the Halton jitter and how it moves the projection, reprojection
+// through the depth buffer, and the temporal history blend, each against an independent
+// computation. Then it renders a test image of hard edges the way each mode would, with the
+// sample patterns Direct3D uses for multisampling and the jitter and blend AntiAliasing uses
+// for temporal antialiasing, and compares each with a heavily supersampled reference.
+//
+// Usage: AntiAliasingFilterTest
+//
+// The temporal rendering emulates TemporalResolvePixelShader.hlsl pixel by pixel, with the
+// camera still: the neighbourhood is clamped at the image's edges, and the first frame has no
+// history. Build it with:
+//
+//   g++ -std=c++17 -O2 AntiAliasingFilterTest.cpp -o AntiAliasingFilterTest
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <vector>
+#include "../Common/AntiAliasingFilters.h"
+#include "Check.h"
+
+using DX::FilterColor;
+using DX::JitterOffset;
+
+// As in AntiAliasing.
+static const uint32_t JitterLength = 8;
+static const float CurrentWeight = 0.1f;
+static const uint32_t AccumulationFrames = JitterLength * 2;
+
+static bool Near(float a, float b, float tolerance)
+{
+	return std::fabs(a - b) <= tolerance;
+}
+
+static bool Near(const FilterColor& a, const FilterColor& b, float tolerance)
+{
+	return Near(a.r, b.r, tolerance) && Near(a.g, b.g, tolerance) && Near(a.b, b.b, tolerance) && Near(a.a, b.a, tolerance);
+}
+
+// 4x4 matrices, row-major, multiplying row vectors, as DirectXMath lays them out.
+struct Matrix
+{
+	double	m[16];
+};
+
+static Matrix Multiply(const Matrix& a, const Matrix& b)
+{
+	Matrix result = {};
+	for (int row = 0; row < 4; row++)
+	{
+		for (int column = 0; column < 4; column++)
+		{
+			for (int k = 0; k < 4; k++)
+			{
+				result.m[row * 4 + column] += a.m[row * 4 + k] * b.m[k * 4 + column];
+			}
+		}
+	}
+	return result;
+}
+
+// Gauss-Jordan elimination with partial pivoting.
+static Matrix Inverse(const Matrix& matrix)
+{
+	double a[4][8];
+	for (int row = 0; row < 4; row++)
+	{
+		for (int column = 0; column < 4; column++)
+		{
+			a[row][column] = matrix.m[row * 4 + column];
+			a[row][column + 4] = row == column ? 1.0 : 0.0;
+		}
+	}
+	for (int column = 0; column < 4; column++)
+	{
+		int pivot = column;
+		for (int row = column + 1; row < 4; row++)
+		{
+			pivot = std::fabs(a[row][column]) > std::fabs(a[pivot][column]) ? row : pivot;
+		}
+		std::swap(a[column], a[pivot]);
+		double scale = 1.0 / a[column][column];
+		for (int k = 0; k < 8; k++)
+		{
+			a[column][k] *= scale;
+		}
+		for (int row = 0; row < 4; row++)
+		{
+			if (row != column)
+			{
+				double factor = a[row][column];
+				for (int k = 0; k < 8; k++)
+				{
+					a[row][k] -= factor * a[column][k];
+				}
+			}
+		}
+	}
+	Matrix inverse;
+	for (int row = 0; row < 4; row++)
+	{
+		for (int column = 0; column < 4; column++)
+		{
+			inverse.m[row * 4 + column] = a[row][column + 4];
+		}
+	}
+	return inverse;
+}
+
+static void Transform(const double point[4], const Matrix& matrix, double result[4])
+{
+	for (int column = 0; column < 4; column++)
+	{
+		result[column] = 0.0;
+		for (int row = 0; row < 4; row++)
+		{
+			result[column] += point[row] * matrix.m[row * 4 + column];
+		}
+	}
+}
+
+// A left-handed perspective projection, as XMMatrixPerspectiveFovLH makes.
+static Matrix Perspective(double fovY, double aspect, double nearZ, double farZ)
+{
+	double yScale = 1.0 / std::tan(fovY * 0.5);
+	double range = farZ / (farZ - nearZ);
+	return { { yScale / aspect, 0, 0, 0,  0, yScale, 0, 0,  0, 0, range, 1,  0, 0, -range * nearZ, 0 } };
+}
+
+// A camera at (x, y, z) turned yaw radians about the y axis: the view matrix moves the world
+// by minus the position, then turns it back.
+static Matrix View(double x, double y, double z, double yaw)
+{
+	double c = std::cos(-yaw);
+	double s = std::sin(-yaw);
+	Matrix translation = { { 1, 0, 0, 0,  0, 1, 0, 0,  0, 0, 1, 0,  -x, -y, -z, 1 } };
+	Matrix rotation = { { c, 0, -s, 0,  0, 1, 0, 0,  s, 0, c, 0,  0, 0, 0, 1 } };
+	return Multiply(translation, rotation);
+}
+
+static void CheckResolveWeights(std::mt19937& random)
+{
+	// The box filter gives every sample the same weight, so an impulse in one sample comes
+	// through at 1 / count wherever it is.
+	bool equal = true;
+	bool constant = true;
+	for (uint32_t count : { 1u, 2u, 4u, 8u, 16u })
+	{
+		std::vector<FilterColor> samples(count);
+		for (uint32_t i = 0; i < count; i++)
+		{
+			std::fill(samples.begin(), samples.end(), FilterColor{ 0.0f, 0.0f, 0.0f, 0.0f });
+			samples[i] = { 1.0f, 2.0f, 4.0f, 8.0f };
+			FilterColor resolved = DX::ResolveSamples(samples.data(), count);
+			float weight = 1.0f / count;
+			equal = equal && Near(resolved, { weight, 2.0f * weight, 4.0f * weight, 8.0f * weight }, 1e-7f);
+		}
+
+		std::uniform_real_distribution<float> unit(0.0f, 1.0f);
+		FilterColor color = { unit(random), unit(random), unit(random), unit(random) };
+		std::fill(samples.begin(), samples.end(), color);
+		constant = constant && Near(DX::ResolveSamples(samples.data(), count), color, 1e-6f);
+	}
+	Expect(equal, "resolve: each of 1 to 16 samples has a weight of one over the count, in every channel");
+	Expect(constant, "resolve: a pixel whose samples agree resolves to their color");
+
+	// Linear: resolving a blend of two sets of samples blends their resolves.
+	bool linear = true;
+	std::uniform_real_distribution<float> unit(0.0f, 1.0f);
+	for (int test = 0; test < 1000; test++)
+	{
+		FilterColor a[8], b[8], blend[8];
+		float t = unit(random);
+		for (int i = 0; i < 8; i++)
+		{
+			a[i] = { unit(random), unit(random), unit(random), unit(random) };
+			b[i] = { unit(random), unit(random), unit(random), unit(random) };
+			blend[i] = { a[i].r + (b[i].r - a[i].r) * t, a[i].g + (b[i].g - a[i].g) * t, a[i].b + (b[i].b - a[i].b) * t, a[i].a + (b[i].a - a[i].a) * t };
+		}
+		FilterColor resolvedA = DX::ResolveSamples(a, 8);
+		FilterColor resolvedB = DX::ResolveSamples(b, 8);
+		FilterColor expected = { resolvedA.r + (resolvedB.r - resolvedA.r) * t, resolvedA.g + (resolvedB.g - resolvedA.g) * t,
+			resolvedA.b + (resolvedB.b - resolvedA.b) * t, resolvedA.a + (resolvedB.a - resolvedA.a) * t };
+		linear = linear && Near(DX::ResolveSamples(blend, 8), expected, 1e-5f);
+	}
+	Expect(linear, "resolve: the filter is linear");
+}
+
+static void CheckJitter()
+{
+	// The first elements of the Halton sequences in bases 2 and 3.
+	static const float base2[] = { 0.0f, 0.5f, 0.25f, 0.75f, 0.125f, 0.625f, 0.375f, 0.875f, 0.0625f };
+	static const float base3[] = { 0.0f, 1.0f / 3, 2.0f / 3, 1.0f / 9, 4.0f / 9, 7.0f / 9, 2.0f / 9, 5.0f / 9, 8.0f / 9 };
+	bool halton = true;
+	for (uint32_t i = 0; i < 9; i++)
+	{
+		halton = halton && Near(DX::Halton(i, 2), base2[i], 1e-7f) && Near(DX::Halton(i, 3), base3[i], 1e-7f);
+	}
+	Expect(halton, "jitter: Halton gives the known sequences in bases 2 and 3");
+
+	// A cycle of jitter skips the pixel corner, stays within the pixel, repeats, and is spread
+	// evenly enough that its mean is near the pixel center and no two offsets coincide.
+	bool inPixel = true;
+	bool repeats = true;
+	bool distinct = true;
+	JitterOffset mean = { 0.0f, 0.0f };
+	for (uint32_t frame = 0; frame < JitterLength; frame++)
+	{
+		JitterOffset offset = DX::ComputeJitter(frame, JitterLength);
+		inPixel = inPixel && offset.x >= -0.5f && offset.x < 0.5f && offset.y >= -0.5f && offset.y < 0.5f && !(offset.x == -0.5f && offset.y == -0.5f);
+		JitterOffset later = DX::ComputeJitter(frame + JitterLength * 1000003ull, JitterLength);
+		repeats = repeats && later.x == offset.x && later.y == offset.y;
+		for (uint32_t other = 0; other < frame; other++)
+		{
+			JitterOffset previous = DX::ComputeJitter(other, JitterLength);
+			distinct = distinct && (previous.x != offset.x || previous.y != offset.y);
+		}
+		mean.x += offset.x / JitterLength;
+		mean.y += offset.y / JitterLength;
+	}
+	Expect(inPixel && repeats && distinct, "jitter: a cycle holds distinct offsets within the pixel, skipping its corner, and repeats");
+	Expect(std::fabs(mean.x) <= 1.0f / 16 && std::fabs(mean.y) <= 1.0f / 16, "jitter: a cycle's offsets center on the pixel");
+
+	JitterOffset clip = DX::JitterToClip({ 0.25f, 0.25f }, 200.0f, 100.0f);
+	Expect(clip.x == 0.0025f && clip.y == -0.005f, "jitter: a pixel offset becomes a clip space offset, with y flipped");
+
+	// Jittering the projection moves every point, at any depth, by the same amount after the
+	// perspective divide.
+	Matrix projection = Perspective(70.0 * 3.14159265 / 180.0, 16.0 / 9.0, 0.01, 100.0);
+	Matrix viewProjection = Multiply(View(0.3, 0.7, -1.5, 0.2), projection);
+	float jittered[16];
+	for (int i = 0; i < 16; i++)
+	{
+		jittered[i] = static_cast<float>(viewProjection.m[i]);
+	}
+	JitterOffset offset = DX::JitterToClip(DX::ComputeJitter(3, JitterLength), 1920.0f, 1080.0f);
+	DX::ApplyProjectionJitter(jittered, offset);
+	Matrix jitteredMatrix;
+	for (int i = 0; i < 16; i++)
+	{
+		jitteredMatrix.m[i] = jittered[i];
+	}
+
+	bool shifted = true;
+	static const double points[][3] = { { 0, 0, 1 }, { 0.5, -0.2, 3 }, { -2, 1, 20 }, { 1, 1, 60 }, { 0.1, 0.9, 0.5 } };
+	for (const auto& point : points)
+	{
+		double world[4] = { point[0], point[1], point[2], 1.0 };
+		double before[4], after[4];
+		Transform(world, viewProjection, before);
+		Transform(world, jitteredMatrix, after);
+		shifted = shifted && Near(static_cast<float>(after[0] / after[3] - before[0] / before[3]), offset.x, 1e-5f) &&
+			Near(static_cast<float>(after[1] / after[3] - before[1] / before[3]), offset.y, 1e-5f) &&
+			Near(static_cast<float>(after[2] / after[3]), static_cast<float>(before[2] / before[3]), 1e-6f);
+	}
+	Expect(shifted, "jitter: the jittered projection moves points at every depth by the same clip space offset, and keeps their depth");
+}
+
+static void CheckReprojection()
+{
+	Matrix projection = Perspective(60.0 * 3.14159265 / 180.0, 16.0 / 9.0, 0.05, 50.0);
+	Matrix previous = Multiply(View(0.0, 0.0, -4.0, 0.0), projection);
+	Matrix current = Multiply(View(0.4, 0.1, -3.5, 0.15), projection);
+	Matrix reprojection = Multiply(Inverse(current), previous);
+	float reprojectionFloat[16];
+	for (int i = 0; i < 16; i++)
+	{
+		reprojectionFloat[i] = static_cast<float>(reprojection.m[i]);
+	}
+
+	// Points seen from both cameras land where the previous camera saw them.
+	bool found = true;
+	uint32_t tested = 0;
+	std::mt19937 random(7);
+	std::uniform_real_distribution<double> coordinate(-3.0, 3.0);
+	for (int test = 0; test < 2000; test++)
+	{
+		double world[4] = { coordinate(random), coordinate(random), coordinate(random) + 3.0, 1.0 };
+		double now[4], before[4];
+		Transform(world, current, now);
+		Transform(world, previous, before);
+		if (now[3] <= 0.1 || before[3] <= 0.1)
+		{
+			continue;
+		}
+
+		float u = static_cast<float>((now[0] / now[3] + 1.0) * 0.5);
+		float v = static_cast<float>((1.0 - now[1] / now[3]) * 0.5);
+		float depth = static_cast<float>(now[2] / now[3]);
+		float previousU, previousV;
+		bool ok = DX::Reproject(reprojectionFloat, u, v, depth, &previousU, &previousV);
+		found = found && ok && Near(previousU, static_cast<float>((before[0] / before[3] + 1.0) * 0.5), 2e-4f) &&
+			Near(previousV, static_cast<float>((1.0 - before[1] / before[3]) * 0.5), 2e-4f);
+		tested++;
+	}
+	Expect(found && tested > 1000, "reprojection: points seen by both cameras land where the previous camera saw them");
+
+	// A point the current camera sees but that was behind the previous one has no history.
+	Matrix turned = Multiply(View(0.0, 0.0, 0.0, 3.14159265), projection);
+	Matrix behind = Multiply(Inverse(current), turned);
+	for (int i = 0; i < 16; i++)
+	{
+		reprojectionFloat[i] = static_cast<float>(behind.m[i]);
+	}
+	double world[4] = { 0.0, 0.0, 2.0, 1.0 };
+	double now[4];
+	Transform(world, current, now);
+	float previousU, previousV;
+	Expect(!DX::Reproject(reprojectionFloat, static_cast<float>((now[0] / now[3] + 1.0) * 0.5), static_cast<float>((1.0 - now[1] / now[3]) * 0.5),
+		static_cast<float>(now[2] / now[3]), &previousU, &previousV),
+		"reprojection: a point behind the previous camera has no history");
+
+	// With the camera still, every pixel is its own history.
+	float identity[16] = { 1, 0, 0, 0,  0, 1, 0, 0,  0, 0, 1, 0,  0, 0, 0, 1 };
+	bool still = true;
+	for (float u = 0.0f; u <= 1.0f; u += 0.125f)
+	{
+		for (float depth : { 0.0f, 0.5f, 1.0f })
+		{
+			still = still && DX::Reproject(identity, u, 1.0f - u, depth, &previousU, &previousV) && Near(previousU, u, 1e-6f) && Near(previousV, 1.0f - u, 1e-6f);
+		}
+	}
+	Expect(still, "reprojection: with the camera still, each pixel reprojects onto itself");
+}
+
+// The history blend written out channel by channel: clamp to the neighbourhood's range, then
+// move towards the current pixel by the weight.
+static float BlendChannel(const float neighbourhood[9], float history, float weight)
+{
+	float low = *std::min_element(neighbourhood, neighbourhood + 9);
+	float high = *std::max_element(neighbourhood, neighbourhood + 9);
+	float clamped = history < low ? low : (history > high ? high : history);
+	return clamped * (1.0f - weight) + neighbourhood[4] * weight;
+}
+
+static void CheckHistoryBlend(std::mt19937& random)
+{
+	std::uniform_real_distribution<float> unit(-0.5f, 1.5f);
+	bool matches = true;
+	bool bounded = true;
+	bool noHistory = true;
+	for (int test = 0; test < 100000; test++)
+	{
+		FilterColor neighbourhood[9];
+		float channels[4][9];
+		for (int i = 0; i < 9; i++)
+		{
+			neighbourhood[i] = { unit(random), unit(random), unit(random), unit(random) };
+			channels[0][i] = neighbourhood[i].r;
+			channels[1][i] = neighbourhood[i].g;
+			channels[2][i] = neighbourhood[i].b;
+			channels[3][i] = neighbourhood[i].a;
+		}
+		FilterColor history = { unit(random) * 2.0f, unit(random), unit(random), unit(random) * 2.0f - 1.0f };
+		float weight = test % 10 == 0 ? 1.0f : (test % 10 == 1 ? 0.0f : std::fabs(unit(random)) / 1.5f);
+
+		FilterColor blended = DX::TemporalResolve(neighbourhood, history, weight);
+		FilterColor expected = { BlendChannel(channels[0], history.r, weight), BlendChannel(channels[1], history.g, weight),
+			BlendChannel(channels[2], history.b, weight), BlendChannel(channels[3], history.a, weight) };
+		matches = matches && Near(blended, expected, 1e-5f);
+
+		const float* values = &blended.r;
+		for (int channel = 0; channel < 4; channel++)
+		{
+			bounded = bounded && values[channel] >= *std::min_element(channels[channel], channels[channel] + 9) - 1e-6f &&
+				values[channel] <= *std::max_element(channels[channel], channels[channel] + 9) + 1e-6f;
+		}
+		if (weight == 1.0f)
+		{
+			noHistory = noHistory && Near(blended, neighbourhood[4], 1e-6f);
+		}
+	}
+	Expect(matches, "history blend: clamps the history to the neighbourhood's range and blends in the current pixel by its weight");
+	Expect(bounded, "history blend: the result never leaves the range of the current neighbourhood, so nothing stale ghosts");
+	Expect(noHistory, "history blend: with a weight of one the history is ignored");
+
+	// A history inside the range blends linearly; a constant neighbourhood replaces any history.
+	FilterColor flat[9];
+	std::fill(flat, flat + 9, FilterColor{ 0.25f, 0.5f, 0.75f, 1.0f });
+	FilterColor wide[9];
+	std::fill(wide, wide + 9, FilterColor{ 0.0f, 0.0f, 0.0f, 0.0f });
+	wide[0] = { 1.0f, 1.0f, 1.0f, 1.0f };
+	wide[4] = { 0.5f, 0.5f, 0.5f, 0.5f };
+	FilterColor fromStale = DX::TemporalResolve(flat, { 1.0f, 0.0f, 9.0f, -3.0f }, CurrentWeight);
+	FilterColor inRange = DX::TemporalResolve(wide, { 0.9f, 0.1f, 0.3f, 0.7f }, CurrentWeight);
+	Expect(Near(fromStale, flat[4], 1e-6f) && Near(inRange, { 0.86f, 0.14f, 0.32f, 0.68f }, 1e-6f),
+		"history blend: a history within the range blends as is, and a flat neighbourhood overrides any history");
+
+	// A still pixel whose samples alternate converges on their mean: the blend is an
+	// exponential moving average with the current frame's weight.
+	FilterColor pixel = { 0.0f, 0.0f, 0.0f, 0.0f };
+	for (uint32_t frame = 0; frame < 400; frame++)
+	{
+		FilterColor neighbourhood[9];
+		float value = frame % 2 == 0 ? 1.0f : 0.0f;
+		std::fill(neighbourhood, neighbourhood + 9, FilterColor{ 0.0f, 0.0f, 0.0f, 0.0f });
+		neighbourhood[0] = { 1.0f, 1.0f, 1.0f, 1.0f };
+		neighbourhood[4] = { value, value, value, value };
+		pixel = DX::TemporalResolve(neighbourhood, pixel, frame == 0 ? 1.0f : CurrentWeight);
+	}
+	// Sampled after a 0 frame, the average sits below the mean by half the weight's swing.
+	float expected = (1.0f - CurrentWeight) / (2.0f - CurrentWeight);
+	Expect(Near(pixel.r, expected, 1e-4f), "history blend: alternating samples settle on the exponential moving average");
+}
+
+// The test image: a disk in red, a half plane at an angle in green, and thin diagonal lines
+// in blue, at a point in pixels.
+static FilterColor Shade(double x, double y)
+{
+	double dx = x - 27.3;
+	double dy = y - 30.1;
+	float disk = dx * dx + dy * dy <= 19.0 * 19.0 ? 1.0f : 0.0f;
+	float plane = (x - 32.0) * 0.8660 + (y - 32.0) * 0.5 >= 0.0 ? 1.0f : 0.0f;
+	float lines = std::fmod(std::fabs(x * 0.3 + y * 0.9), 6.0) < 1.2 ? 1.0f : 0.0f;
+	return { disk, plane, lines, 1.0f };
+}
+
+static const int ImageSize = 64;
+
+using Image = std::vector<FilterColor>;
+
+// Each pixel's color through a box filter, from 32 x 32 samples.
+static Image RenderReference()
+{
+	Image image(ImageSize * ImageSize);
+	const int grid = 32;
+	for (int y = 0; y < ImageSize; y++)
+	{
+		for (int x = 0; x < ImageSize; x++)
+		{
+			FilterColor sum = {};
+			for (int sy = 0; sy < grid; sy++)
+			{
+				for (int sx = 0; sx < grid; sx++)
+				{
+					FilterColor color = Shade(x + (sx + 0.5) / grid, y + (sy + 0.5) / grid);
+					sum = { sum.r + color.r, sum.g + color.g, sum.b + color.b, sum.a + color.a };
+				}
+			}
+			float scale = 1.0f / (grid * grid);
+			image[y * ImageSize + x] = { sum.r * scale, sum.g * scale, sum.b * scale, sum.a * scale };
+		}
+	}
+	return image;
+}
+
+// Multisampled with Direct3D's standard sample pattern for a count, in sixteenths of a pixel
+// from its center, and resolved.
+static Image RenderMultisampled(uint32_t count)
+{
+	static const int pattern1[][2] = { { 0, 0 } };
+	static const int pattern2[][2] = { { 4, 4 }, { -4, -4 } };
+	static const int pattern4[][2] = { { -2, -6 }, { 6, -2 }, { -6, 2 }, { 2, 6 } };
+	static const int pattern8[][2] = { { 1, -3 }, { -1, 3 }, { 5, 1 }, { -3, -5 }, { -5, 5 }, { -7, -1 }, { 3, 7 }, { 7, -7 } };
+	const int (*pattern)[2] = count == 1 ? pattern1 : count == 2 ? pattern2 : count == 4 ? pattern4 : pattern8;
+
+	Image image(ImageSize * ImageSize);
+	for (int y = 0; y < ImageSize; y++)
+	{
+		for (int x = 0; x < ImageSize; x++)
+		{
+			FilterColor samples[8];
+			for (uint32_t i = 0; i < count; i++)
+			{
+				samples[i] = Shade(x + 0.5 + pattern[i][0] / 16.0, y + 0.5 + pattern[i][1] / 16.0);
+			}
+			image[y * ImageSize + x] = DX::ResolveSamples(samples, count);
+		}
+	}
+	return image;
+}
+
+// One frame of temporal antialiasing with the camera still, as the resolve shader runs it:
+// the frame is rendered with the projection jittered, and each pixel blended with its history
+// and clamped to its neighbourhood, with neighbours beyond the image's edges clamped to it.
+static void RenderTemporalFrame(uint32_t frame, Image& history)
+{
+	// Jittering the projection by +offset moves the image by it, so each pixel sees the scene
+	// at its center minus the offset.
+	JitterOffset offset = DX::ComputeJitter(frame, JitterLength);
+	Image current(ImageSize * ImageSize);
+	for (int y = 0; y < ImageSize; y++)
+	{
+		for (int x = 0; x < ImageSize; x++)
+		{
+			current[y * ImageSize + x] = Shade(x + 0.5 - offset.x, y + 0.5 - offset.y);
+		}
+	}
+
+	for (int y = 0; y < ImageSize; y++)
+	{
+		for (int x = 0; x < ImageSize; x++)
+		{
+			FilterColor neighbourhood[9];
+			for (int ny = -1; ny <= 1; ny++)
+			{
+				for (int nx = -1; nx <= 1; nx++)
+				{
+					int sx = (std::min)((std::max)(x + nx, 0), ImageSize - 1);
+					int sy = (std::min)((std::max)(y + ny, 0), ImageSize - 1);
+					neighbourhood[(ny + 1) * 3 + nx + 1] = current[sy * ImageSize + sx];
+				}
+			}
+			FilterColor& pixel = history[y * ImageSize + x];
+			pixel = DX::TemporalResolve(neighbourhood, pixel, frame == 0 ? 1.0f : CurrentWeight);
+		}
+	}
+}
+
+// Mean absolute error of the color channels against the reference, and the largest.
+static void GetError(const Image& image, const Image& reference, float* mean, float* largest)
+{
+	double sum = 0.0;
+	*largest = 0.0f;
+	for (size_t i = 0; i < image.size(); i++)
+	{
+		for (float error : { image[i].r - reference[i].r, image[i].g - reference[i].g, image[i].b - reference[i].b })
+		{
+			sum += std::fabs(error);
+			*largest = (std::max)(*largest, std::fabs(error));
+		}
+	}
+	*mean = static_cast<float>(sum / (image.size() * 3));
+}
+
+static void CheckImages()
+{
+	Image reference = RenderReference();
+
+	printf("\n%-28s %12s %12s\n", "Mode", "Mean error", "Max error");
+	float errors[4];
+	int index = 0;
+	for (uint32_t count : { 1u, 2u, 4u, 8u })
+	{
+		float mean, largest;
+		GetError(RenderMultisampled(count), reference, &mean, &largest);
+		char name[32];
+		snprintf(name, sizeof(name), count == 1 ? "No antialiasing" : "Multisample x%u", count);
+		printf("%-28s %12.4f %12.4f\n", name, mean, largest);
+		errors[index++] = mean;
+	}
+
+	Image history(ImageSize * ImageSize);
+	float temporalErrors[5] = {};
+	static const uint32_t checkpoints[] = { 1, JitterLength, AccumulationFrames, 32, 64 };
+	uint32_t frame = 0;
+	for (int i = 0; i < 5; i++)
+	{
+		while (frame < checkpoints[i])
+		{
+			RenderTemporalFrame(frame++, history);
+		}
+		float largest;
+		GetError(history, reference, &temporalErrors[i], &largest);
+		char name[32];
+		snprintf(name, sizeof(name), "Temporal, %u frames", checkpoints[i]);
+		printf("%-28s %12.4f %12.4f\n", name, temporalErrors[i], largest);
+	}
+	printf("\n");
+
+	Expect(errors[1] < errors[0] && errors[2] < errors[1] && errors[3] < errors[2], "images: each doubling of the sample count brings the resolve closer to the reference");
+	Expect(temporalErrors[2] < errors[0] * 0.6f, "images: once accumulated, temporal antialiasing is well closer to the reference than no antialiasing");
+	Expect(temporalErrors[2] <= temporalErrors[0] && temporalErrors[4] <= temporalErrors[2] * 1.05f,
+		"images: temporal antialiasing improves as the history accumulates, and stays settled");
+}
+
+int main(int argc, char** argv)
+{
+	if (argc > 1)
+	{
+		fprintf(stderr, "Usage: %s\n", argv[0]);
+		return 1;
+	}
+
+	std::mt19937 random(1);
+	CheckResolveWeights(random);
+	CheckJitter();
+	CheckReprojection();
+	CheckHistoryBlend(random);
+	CheckImages();
+
+	return ReportChecks();
+}
@@ -0,0 +1,48 @@
+﻿#pragma once
+
+// What the tools share for reporting their checks. Each check prints a line starting with "ok"
+// or "FAILED" and a description; ReportChecks ends the run with a summary and gives the exit
+// code, so a build script can run any tool and stop on failure. Like the tools themselves, it
+// only uses the standard library.
+
+#include <cstdarg>
+#include <cstdint>
+#include <cstdio>
+
+// Checks that failed so far.
+inline uint32_t g_checkFailures = 0;
+
+// Counts a check whose result the tool prints itself, such as a row of a table.
+inline bool RecordCheck(bool ok)
+{
+	g_checkFailures += ok ? 0 : 1;
+	return ok;
+}
+
+inline bool Expect(bool ok, const char* description)
+{
+	printf("%-6s %s\n", ok ? "ok" : "FAILED", description);
+	return RecordCheck(ok);
+}
+
+// As above, followed by the value that was checked, in a column after the description.
+#if defined(__GNUC__)
+__attribute__((format(printf, 3, 4)))
+#endif
+inline bool Expect(bool ok, const char* description, const char* valueFormat, ...)
+{
+	printf("%-6s %-48s ", ok ? "ok" : "FAILED", description);
+	va_list arguments;
+	va_start(arguments, valueFormat);
+	vprintf(valueFormat, arguments);
+	va_end(arguments);
+	printf("\n");
+	return RecordCheck(ok);
+}
+
+// Prints whether every check passed, and returns the exit code for main.
+inline int ReportChecks()
+{
+	printf("\n%s\n", g_checkFailures == 0 ? "All checks passed." : "Some checks failed.");
+	return g_checkFailures == 0 ? 0 : 1;
+}
@@ -0,0 +1,219 @@
+﻿// Times DX::DirtyRegion on random frames of damage and checks each result against a brute force
+// rasterization: the region covers every damaged pixel, stays within the rectangle cap, and
+// GetArea matches the number of pixels its rectangles cover.
+//
+// Usage: DirtyRegionBenchmark [options]
+//
+//   --size <width>x<height>		Size of the render target. The default is 640x360.
+//   --frames <count>				Frames of damage to add. The default is 2000.
+//   --rects <count>				Rectangles added each frame. The default is 16.
+//   --seed <value>					Seed for the random damage. The default is 1.
+//
+// Each frame mixes small rectangles, like glyphs and sprites, with the odd large one, like a
+// panel, and also merges in the previous frame's region as the app does for its swap chain.
+// Build it with:
+//
+//   g++ -std=c++17 -O2 DirtyRegionBenchmark.cpp -o DirtyRegionBenchmark
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <string>
+#include <vector>
+#include "../Common/DirtyRegion.h"
+#include "Check.h"
+
+using Clock = std::chrono::steady_clock;
+
+// One bit per pixel would do; a byte keeps it simple.
+class Raster
+{
+public:
+	Raster(int32_t width, int32_t height) :
+		m_width(width),
+		m_height(height),
+		m_pixels(static_cast<size_t>(width) * height)
+	{
+	}
+
+	void Clear() { std::fill(m_pixels.begin(), m_pixels.end(), static_cast<uint8_t>(0)); }
+
+	void Fill(const DX::DirtyRect& rect)
+	{
+		DX::DirtyRect clipped = DX::DirtyRect::Intersect(rect, { 0, 0, m_width, m_height });
+		for (int32_t y = clipped.top; y < clipped.bottom; y++)
+		{
+			for (int32_t x = clipped.left; x < clipped.right; x++)
+			{
+				m_pixels[static_cast<size_t>(y) * m_width + x] = 1;
+			}
+		}
+	}
+
+	int64_t Count() const { return std::count(m_pixels.begin(), m_pixels.end(), static_cast<uint8_t>(1)); }
+
+	// True if every pixel set here is set in the other raster.
+	bool IsWithin(const Raster& other) const
+	{
+		for (size_t i = 0; i < m_pixels.size(); i++)
+		{
+			if (m_pixels[i] && !other.m_pixels[i])
+			{
+				return false;
+			}
+		}
+		return true;
+	}
+
+private:
+	int32_t					m_width;
+	int32_t					m_height;
+	std::vector<uint8_t>	m_pixels;
+};
+
+static DX::DirtyRect MakeRect(std::mt19937& random, int32_t width, int32_t height)
+{
+	// One rectangle in sixteen is a panel up to a third of the target; the rest are glyph or
+	// sprite sized.
+	bool large = (random() % 16) == 0;
+	int32_t maxWidth = large ? width / 3 : 48;
+	int32_t maxHeight = large ? height / 3 : 48;
+	int32_t w = 1 + static_cast<int32_t>(random() % maxWidth);
+	int32_t h = 1 + static_cast<int32_t>(random() % maxHeight);
+	int32_t x = static_cast<int32_t>(random() % width) - w / 2;
+	int32_t y = static_cast<int32_t>(random() % height) - h / 2;
+	return { x, y, x + w, y + h };
+}
+
+int main(int argc, char** argv)
+{
+	int32_t width = 640;
+	int32_t height = 360;
+	uint32_t frameCount = 2000;
+	uint32_t rectsPerFrame = 16;
+	uint32_t seed = 1;
+
+	for (int i = 1; i < argc; i++)
+	{
+		std::string argument = argv[i];
+		if (argument == "--size" && i + 1 < argc)
+		{
+			if (sscanf(argv[++i], "%dx%d", &width, &height) != 2 || width <= 0 || height <= 0)
+			{
+				fprintf(stderr, "%s: expected <width>x<height>\n", argv[i]);
+				return 1;
+			}
+		}
+		else if (argument == "--frames" && i + 1 < argc)
+		{
+			frameCount = (std::max)(static_cast<uint32_t>(strtoul(argv[++i], nullptr, 10)), 1u);
+		}
+		else if (argument == "--rects" && i + 1 < argc)
+		{
+			rectsPerFrame = (std::max)(static_cast<uint32_t>(strtoul(argv[++i], nullptr, 10)), 1u);
+		}
+		else if (argument == "--seed" && i + 1 < argc)
+		{
+			seed = static_cast<uint32_t>(strtoul(argv[++i], nullptr, 10));
+		}
+		else
+		{
+			fprintf(stderr, "%s: unknown option\n", argument.c_str());
+			fprintf(stderr, "Usage: %s [--size <width>x<height>] [--frames <count>] [--rects <count>] [--seed <value>]\n", argv[0]);
+			return 1;
+		}
+	}
+
+	// Generate the damage up front, so the timing covers only the region.
+	std::mt19937 random(seed);
+	std::vector<DX::DirtyRect> damage(static_cast<size_t>(frameCount) * rectsPerFrame);
+	for (DX::DirtyRect& rect : damage)
+	{
+		rect = MakeRect(random, width, height);
+	}
+
+	const DX::DirtyRect bounds = { 0, 0, width, height };
+	std::vector<DX::DirtyRegion> regions(frameCount);
+	std::vector<DX::DirtyRegion> repaints(frameCount);
+
+	auto start = Clock::now();
+	for (uint32_t frame = 0; frame < frameCount; frame++)
+	{
+		DX::DirtyRegion& region = regions[frame];
+		for (uint32_t i = 0; i < rectsPerFrame; i++)
+		{
+			region.Add(damage[static_cast<size_t>(frame) * rectsPerFrame + i]);
+		}
+		region.Clip(bounds);
+	}
+	double addSeconds = std::chrono::duration<double>(Clock::now() - start).count();
+
+	// With a flip model swap chain the back buffer is two frames old, so each repaint covers
+	// this frame's damage and the last.
+	start = Clock::now();
+	for (uint32_t frame = 0; frame < frameCount; frame++)
+	{
+		repaints[frame] = regions[frame];
+		if (frame > 0)
+		{
+			repaints[frame].Add(regions[frame - 1]);
+		}
+	}
+	double mergeSeconds = std::chrono::duration<double>(Clock::now() - start).count();
+
+	// Check every frame against the rasterized damage.
+	Raster damaged(width, height);
+	Raster covered(width, height);
+	uint32_t uncovered = 0;
+	uint32_t overCap = 0;
+	uint32_t areaMismatches = 0;
+	int64_t damagedPixels = 0;
+	int64_t regionPixels = 0;
+	size_t rectCount = 0;
+
+	for (uint32_t frame = 0; frame < frameCount; frame++)
+	{
+		for (const DX::DirtyRegion* region : { &regions[frame], &repaints[frame] })
+		{
+			damaged.Clear();
+			covered.Clear();
+			for (uint32_t i = 0; i < rectsPerFrame; i++)
+			{
+				damaged.Fill(damage[static_cast<size_t>(frame) * rectsPerFrame + i]);
+				if (region == &repaints[frame] && frame > 0)
+				{
+					damaged.Fill(damage[static_cast<size_t>(frame - 1) * rectsPerFrame + i]);
+				}
+			}
+			for (size_t i = 0; i < region->GetCount(); i++)
+			{
+				covered.Fill(region->GetRects()[i]);
+			}
+
+			int64_t area = covered.Count();
+			uncovered += damaged.IsWithin(covered) ? 0 : 1;
+			overCap += (region->GetCount() <= DX::DirtyRegion::MaxRects) ? 0 : 1;
+			areaMismatches += (region->GetArea() == area) ? 0 : 1;
+			if (region == &regions[frame])
+			{
+				damagedPixels += damaged.Count();
+				regionPixels += area;
+				rectCount += region->GetCount();
+			}
+		}
+	}
+
+	uint64_t adds = static_cast<uint64_t>(frameCount) * rectsPerFrame;
+	printf("%llu rectangles in %u frames of %dx%d\n", static_cast<unsigned long long>(adds), frameCount, width, height);
+	printf("Add: %.1f ns a rectangle, merge: %.1f ns a region\n", addSeconds * 1e9 / adds, mergeSeconds * 1e9 / frameCount);
+	printf("%.2f rectangles a frame, covering %.1f%% more pixels than were damaged\n\n",
+		static_cast<double>(rectCount) / frameCount, damagedPixels > 0 ? 100.0 * (regionPixels - damagedPixels) / damagedPixels : 0.0);
+
+	Expect(uncovered == 0, "regions missing damaged pixels", "%u", uncovered);
+	Expect(overCap == 0, "regions over the rectangle cap", "%u", overCap);
+	Expect(areaMismatches == 0, "regions whose GetArea isn't the rasterized area", "%u", areaMismatches);
+
+	return ReportChecks();
+}
@@ -0,0 +1,244 @@
+﻿// Stress tests the two ways changes reach the render loop from other threads: DX::MpscQueue,
+// which must deliver every item it accepts once and in each producer's order, and the
+// DX::LatestValue slots the app keeps display changes in, which must never lose the newest
+// value however long the render loop stalls.
+//
+// Usage: DisplayCommandStressTest [options]
+//
+//   --items <count>				Items each producer pushes or sets. The default is 200000.
+//   --producers <count>			Threads pushing into the queue. The default is 4.
+//   --stall <ms>					How long the render loop stops, as while the window is hidden,
+//									in the middle of the slot test. The default is 50.
+//
+// The slot test runs one producer per display command type, like the UI thread reporting a
+// resize drag, and a render loop that applies whatever is pending between frames. Build it
+// with:
+//
+//   g++ -std=c++17 -O2 -pthread DisplayCommandStressTest.cpp -o DisplayCommandStressTest
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+#include "../Common/LatestValue.h"
+#include "../Common/LockFreeQueue.h"
+#include "Check.h"
+
+using Clock = std::chrono::steady_clock;
+
+// Stands in for the app's DisplayCommand: which producer sent it and its sequence number.
+struct Command
+{
+	uint32_t	producer;
+	uint32_t	sequence;
+	uint64_t	queuedNanoseconds;
+};
+
+static uint64_t GetNanoseconds(Clock::time_point start)
+{
+	return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - start).count());
+}
+
+static void CheckQueue(uint32_t producerCount, uint32_t itemCount)
+{
+	auto queue = std::make_unique<DX::MpscQueue<Command, 256>>();
+	std::atomic<uint32_t> running(producerCount);
+	std::vector<uint64_t> accepted(producerCount);
+	Clock::time_point start = Clock::now();
+
+	// Producers retry when the queue is full, so every item is eventually accepted; the
+	// failed attempts show how often it filled.
+	std::atomic<uint64_t> fullCount(0);
+	std::vector<std::thread> producers;
+	for (uint32_t producer = 0; producer < producerCount; producer++)
+	{
+		producers.emplace_back([&, producer]
+		{
+			for (uint32_t sequence = 0; sequence < itemCount; sequence++)
+			{
+				while (!queue->TryPush({ producer, sequence, 0 }))
+				{
+					fullCount.fetch_add(1, std::memory_order_relaxed);
+					std::this_thread::yield();
+				}
+				accepted[producer]++;
+			}
+			running.fetch_sub(1, std::memory_order_release);
+		});
+	}
+
+	std::vector<int64_t> last(producerCount, -1);
+	uint64_t popped = 0;
+	uint64_t outOfOrder = 0;
+	Command command;
+	for (;;)
+	{
+		bool done = running.load(std::memory_order_acquire) == 0;
+		while (queue->TryPop(command))
+		{
+			bool valid = command.producer < producerCount && static_cast<int64_t>(command.sequence) == last[command.producer] + 1;
+			outOfOrder += valid ? 0 : 1;
+			if (command.producer < producerCount)
+			{
+				last[command.producer] = command.sequence;
+			}
+			popped++;
+		}
+		if (done)
+		{
+			break;
+		}
+		std::this_thread::yield();
+	}
+	for (std::thread& producer : producers)
+	{
+		producer.join();
+	}
+
+	double seconds = std::chrono::duration<double>(Clock::now() - start).count();
+	uint64_t total = static_cast<uint64_t>(producerCount) * itemCount;
+	char description[160];
+	snprintf(description, sizeof(description), "queue: %llu items from %u producers in %.3f s, the queue full %llu times",
+		static_cast<unsigned long long>(popped), producerCount, seconds, static_cast<unsigned long long>(fullCount.load()));
+	Expect(popped == total, description);
+	Expect(outOfOrder == 0, "queue: each producer's items arrive once and in order");
+}
+
+static void CheckLatestValues(uint32_t itemCount, std::chrono::milliseconds stall)
+{
+	// One producer per display command type, as in the app.
+	const uint32_t typeCount = 5;
+	std::array<DX::LatestValue<Command>, typeCount> slots;
+	std::atomic<uint32_t> running(typeCount);
+	std::atomic<uint64_t> coalesced(0);
+	Clock::time_point start = Clock::now();
+
+	std::vector<std::thread> producers;
+	for (uint32_t type = 0; type < typeCount; type++)
+	{
+		producers.emplace_back([&, type]
+		{
+			for (uint32_t sequence = 0; sequence < itemCount; sequence++)
+			{
+				Command command = { type, sequence, GetNanoseconds(start) };
+				bool replaced = slots[type].Update([&command](Command& pending, bool isPending)
+				{
+					// As QueueDisplayCommand does, latency counts from the oldest change.
+					if (isPending)
+					{
+						command.queuedNanoseconds = pending.queuedNanoseconds;
+					}
+					pending = command;
+				});
+				coalesced.fetch_add(replaced ? 1 : 0, std::memory_order_relaxed);
+
+				// Pause now and then, so that some changes arrive one at a time.
+				if (sequence % 1024 == 0)
+				{
+					std::this_thread::sleep_for(std::chrono::microseconds(100));
+				}
+			}
+			running.fetch_sub(1, std::memory_order_release);
+		});
+	}
+
+	// The render loop, applying whatever is pending once per iteration and stalling once.
+	std::array<int64_t, typeCount> applied;
+	applied.fill(-1);
+	uint64_t taken = 0;
+	uint64_t backwards = 0;
+	uint64_t maxLatency = 0;
+	bool stalled = false;
+	for (;;)
+	{
+		bool done = running.load(std::memory_order_acquire) == 0;
+		uint64_t now = GetNanoseconds(start);
+		for (uint32_t type = 0; type < typeCount; type++)
+		{
+			Command command;
+			if (slots[type].Take(command))
+			{
+				backwards += (command.producer == type && static_cast<int64_t>(command.sequence) > applied[type]) ? 0 : 1;
+				applied[type] = command.sequence;
+				maxLatency = (std::max)(maxLatency, now - (std::min)(now, command.queuedNanoseconds));
+				taken++;
+			}
+		}
+		if (done)
+		{
+			break;
+		}
+
+		if (!stalled && applied[0] >= static_cast<int64_t>(itemCount / 2))
+		{
+			std::this_thread::sleep_for(stall);
+			stalled = true;
+		}
+		else
+		{
+			std::this_thread::yield();
+		}
+	}
+	for (std::thread& producer : producers)
+	{
+		producer.join();
+	}
+
+	uint64_t total = static_cast<uint64_t>(typeCount) * itemCount;
+	bool newest = true;
+	for (uint32_t type = 0; type < typeCount; type++)
+	{
+		newest = newest && applied[type] == static_cast<int64_t>(itemCount) - 1 && !slots[type].IsPending();
+	}
+
+	char description[160];
+	snprintf(description, sizeof(description), "slots: %llu changes applied as %llu, %llu coalesced, across a %lld ms stall",
+		static_cast<unsigned long long>(total), static_cast<unsigned long long>(taken), static_cast<unsigned long long>(coalesced.load()),
+		static_cast<long long>(stall.count()));
+	Expect(taken + coalesced.load() == total, description);
+	Expect(newest, "slots: the newest change of every type is applied");
+	Expect(backwards == 0, "slots: no type ever goes back to an older change");
+	snprintf(description, sizeof(description), "slots: the longest a change waited was %.2f ms", maxLatency / 1e6);
+	Expect(maxLatency >= static_cast<uint64_t>(std::chrono::nanoseconds(stall).count()) || !stalled, description);
+}
+
+int main(int argc, char** argv)
+{
+	uint32_t itemCount = 200000;
+	uint32_t producerCount = 4;
+	std::chrono::milliseconds stall(50);
+
+	for (int i = 1; i < argc; i++)
+	{
+		std::string argument = argv[i];
+		if (argument == "--items" && i + 1 < argc)
+		{
+			itemCount = (std::max)(static_cast<uint32_t>(strtoul(argv[++i], nullptr, 10)), 2u);
+		}
+		else if (argument == "--producers" && i + 1 < argc)
+		{
+			producerCount = (std::max)(static_cast<uint32_t>(strtoul(argv[++i], nullptr, 10)), 1u);
+		}
+		else if (argument == "--stall" && i + 1 < argc)
+		{
+			stall = std::chrono::milliseconds(strtol(argv[++i], nullptr, 10));
+		}
+		else
+		{
+			fprintf(stderr, "%s: unknown option\n", argument.c_str());
+			fprintf(stderr, "Usage: %s [--items <count>] [--producers <count>] [--stall <ms>]\n", argv[0]);
+			return 1;
+		}
+	}
+
+	CheckQueue(producerCount, itemCount);
+	CheckLatestValues(itemCount, stall);
+
+	return ReportChecks();
+}
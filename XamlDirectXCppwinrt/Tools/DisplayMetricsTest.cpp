@@ -0,0 +1,469 @@
+﻿// Checks DX::ComputeDisplayMetrics, DX::CompareDisplayMetrics and DX::DisplayMetricsCache over
+// every combination of native and current orientation, DPI, composition scale and window size
+// in a grid, against a reference worked out independently: rotations from the angles of the
+// orientations, the 2D transforms from where the window's corners must land, and the 3D
+// transforms from agreeing with the 2D ones in clip space. Then every transition between two
+// states in the grid is classified, and must resize the buffers exactly when their size in the
+// native orientation changes, and otherwise report a transform change exactly when something a
+// renderer sees has changed. The cache is walked through random transitions and must return
+// what ComputeDisplayMetrics does, with the hits and misses of a plain model of it.
+//
+// Usage: DisplayMetricsTest
+//
+// Build it with:
+//
+//   g++ -std=c++17 -O2 DisplayMetricsTest.cpp -o DisplayMetricsTest
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <vector>
+#include "../Common/DisplayMetrics.h"
+#include "Check.h"
+
+using DX::DisplayChange;
+using DX::DisplayMetrics;
+using DX::DisplayOrientation;
+using DX::DisplayRotation;
+using DX::DisplayState;
+
+// The metrics a state should have, worked out without ComputeDisplayMetrics's tables.
+struct Reference
+{
+	double			dpi;
+	double			scaleX;
+	double			scaleY;
+	double			outputWidth;
+	double			outputHeight;
+	double			renderTargetWidth;
+	double			renderTargetHeight;
+	DisplayRotation	rotation;
+	int				angle;				// Clockwise, in degrees; 0 when the rotation is unspecified.
+	double			transform2D[6];
+};
+
+// Clockwise angles from landscape, or -1 for an orientation that isn't one of the four.
+static int GetAngle(DisplayOrientation orientation)
+{
+	switch (orientation)
+	{
+	case DisplayOrientation::Landscape:			return 0;
+	case DisplayOrientation::Portrait:			return 90;
+	case DisplayOrientation::LandscapeFlipped:	return 180;
+	case DisplayOrientation::PortraitFlipped:	return 270;
+	default:									return -1;
+	}
+}
+
+static double ToPixels(double dips, double dpi)
+{
+	return std::floor(dips * dpi / 96.0 + 0.5);
+}
+
+static Reference GetReference(const DisplayState& state)
+{
+	Reference reference = {};
+	reference.dpi = state.dpi;
+	reference.scaleX = state.compositionScaleX;
+	reference.scaleY = state.compositionScaleY;
+
+	// Above 192 DPI, a window larger than 1080p in pixels is rendered at half the DPI.
+	double width = ToPixels(state.logicalWidth, state.dpi);
+	double height = ToPixels(state.logicalHeight, state.dpi);
+	if (!DX::DisplayScaling::SupportHighResolutions && state.dpi > 192.0 && (std::max)(width, height) > 1920.0 && (std::min)(width, height) > 1080.0)
+	{
+		reference.dpi /= 2.0;
+		reference.scaleX /= 2.0;
+		reference.scaleY /= 2.0;
+	}
+	reference.outputWidth = (std::max)(ToPixels(state.logicalWidth, reference.dpi), 1.0);
+	reference.outputHeight = (std::max)(ToPixels(state.logicalHeight, reference.dpi), 1.0);
+
+	// The buffers are in the native orientation, so the content is rotated back by the angle
+	// the display turned from it. Only landscape and portrait are native orientations.
+	int native = GetAngle(state.nativeOrientation);
+	int current = GetAngle(state.currentOrientation);
+	reference.rotation = DisplayRotation::Unspecified;
+	if ((native == 0 || native == 90) && current >= 0)
+	{
+		reference.angle = (native - current + 360) % 360;
+		static const DisplayRotation rotations[] = { DisplayRotation::Identity, DisplayRotation::Rotate90, DisplayRotation::Rotate180, DisplayRotation::Rotate270 };
+		reference.rotation = rotations[reference.angle / 90];
+	}
+
+	bool quarterTurn = reference.angle == 90 || reference.angle == 270;
+	reference.renderTargetWidth = quarterTurn ? reference.outputHeight : reference.outputWidth;
+	reference.renderTargetHeight = quarterTurn ? reference.outputWidth : reference.outputHeight;
+
+	// A clockwise rotation, y down, followed by the translation that brings the window's
+	// corners back to the origin.
+	static const double cosines[] = { 1.0, 0.0, -1.0, 0.0 };
+	static const double sines[] = { 0.0, 1.0, 0.0, -1.0 };
+	double c = cosines[reference.angle / 90];
+	double s = sines[reference.angle / 90];
+	double* transform = reference.transform2D;
+	transform[0] = c;
+	transform[1] = s;
+	transform[2] = -s;
+	transform[3] = c;
+	double corners[4][2] = { { 0.0, 0.0 }, { state.logicalWidth, 0.0 }, { 0.0, state.logicalHeight }, { state.logicalWidth, state.logicalHeight } };
+	double minX = 0.0;
+	double minY = 0.0;
+	for (int i = 0; i < 4; i++)
+	{
+		double x = corners[i][0] * c - corners[i][1] * s;
+		double y = corners[i][0] * s + corners[i][1] * c;
+		minX = i == 0 ? x : (std::min)(minX, x);
+		minY = i == 0 ? y : (std::min)(minY, y);
+	}
+	transform[4] = -minX + 0.0;
+	transform[5] = -minY + 0.0;
+	return reference;
+}
+
+static bool MatchesReference(const DisplayMetrics& metrics, const Reference& reference)
+{
+	bool ok = metrics.effectiveDpi == static_cast<float>(reference.dpi) &&
+		metrics.effectiveCompositionScaleX == static_cast<float>(reference.scaleX) &&
+		metrics.effectiveCompositionScaleY == static_cast<float>(reference.scaleY) &&
+		metrics.outputWidth == reference.outputWidth && metrics.outputHeight == reference.outputHeight &&
+		metrics.renderTargetWidth == reference.renderTargetWidth && metrics.renderTargetHeight == reference.renderTargetHeight &&
+		metrics.rotation == reference.rotation;
+	for (int i = 0; i < 6; i++)
+	{
+		ok = ok && metrics.orientationTransform2D[i] == static_cast<float>(reference.transform2D[i]);
+	}
+	return ok;
+}
+
+// Whether the 3D transform, applied to clip space positions as row vectors after the
+// projection, puts every point where the 2D transform puts it on the screen.
+static bool Agrees3D(const DisplayState& state, const DisplayMetrics& metrics)
+{
+	const float* m = metrics.orientationTransform3D;
+	bool quarterTurn = metrics.rotation == DisplayRotation::Rotate90 || metrics.rotation == DisplayRotation::Rotate270;
+	double width = state.logicalWidth;
+	double height = state.logicalHeight;
+	double rotatedWidth = quarterTurn ? height : width;
+	double rotatedHeight = quarterTurn ? width : height;
+
+	// A rotation about Z: z and w pass through.
+	bool ok = m[2] == 0.0f && m[3] == 0.0f && m[6] == 0.0f && m[7] == 0.0f &&
+		m[8] == 0.0f && m[9] == 0.0f && m[10] == 1.0f && m[11] == 0.0f &&
+		m[12] == 0.0f && m[13] == 0.0f && m[14] == 0.0f && m[15] == 1.0f &&
+		m[0] * m[5] - m[1] * m[4] == 1.0f;
+	if (width <= 0.0 || height <= 0.0)
+	{
+		return ok;
+	}
+
+	static const double points[][2] = { { 0.0, 0.0 }, { 1.0, 0.0 }, { 0.0, 1.0 }, { 1.0, 1.0 }, { 0.25, 0.75 }, { 0.6, 0.1 } };
+	const float* t = metrics.orientationTransform2D;
+	for (const auto& point : points)
+	{
+		double x = point[0] * width;
+		double y = point[1] * height;
+		double clipX = 2.0 * x / width - 1.0;
+		double clipY = 1.0 - 2.0 * y / height;
+
+		double screenX = x * t[0] + y * t[2] + t[4];
+		double screenY = x * t[1] + y * t[3] + t[5];
+		double expectedX = 2.0 * screenX / rotatedWidth - 1.0;
+		double expectedY = 1.0 - 2.0 * screenY / rotatedHeight;
+
+		double rotatedX = clipX * m[0] + clipY * m[4];
+		double rotatedY = clipX * m[1] + clipY * m[5];
+		ok = ok && std::fabs(rotatedX - expectedX) < 1e-5 && std::fabs(rotatedY - expectedY) < 1e-5;
+	}
+	return ok;
+}
+
+static std::vector<DisplayState> MakeStates()
+{
+	static const DisplayOrientation natives[] = { DisplayOrientation::Landscape, DisplayOrientation::Portrait, DisplayOrientation::None };
+	static const DisplayOrientation currents[] =
+	{
+		DisplayOrientation::Landscape, DisplayOrientation::Portrait, DisplayOrientation::LandscapeFlipped, DisplayOrientation::PortraitFlipped, DisplayOrientation::None,
+	};
+	static const float dpis[] = { 96.0f, 120.0f, 144.0f, 168.0f, 192.0f, 240.0f, 288.0f, 384.0f };
+	static const float scales[] = { 1.0f, 1.5f };
+
+	// Landscape and portrait windows of the same size, a fractional size, a square, and an
+	// empty window, as while the panel is being laid out.
+	static const float sizes[][2] =
+	{
+		{ 1920.0f, 1080.0f }, { 1080.0f, 1920.0f }, { 1366.0f, 768.0f }, { 1366.3f, 768.7f }, { 800.0f, 800.0f }, { 2560.0f, 1440.0f }, { 0.0f, 0.0f },
+	};
+
+	std::vector<DisplayState> states;
+	for (DisplayOrientation native : natives)
+	{
+		for (DisplayOrientation current : currents)
+		{
+			for (float dpi : dpis)
+			{
+				for (float scale : scales)
+				{
+					for (const auto& size : sizes)
+					{
+						states.push_back({ size[0], size[1], dpi, scale, scale, native, current });
+					}
+				}
+			}
+		}
+	}
+	return states;
+}
+
+static void CheckMetrics(const std::vector<DisplayState>& states, const std::vector<DisplayMetrics>& metrics)
+{
+	bool matches = true;
+	bool agrees = true;
+	for (size_t i = 0; i < states.size(); i++)
+	{
+		matches = matches && MatchesReference(metrics[i], GetReference(states[i]));
+		agrees = agrees && Agrees3D(states[i], metrics[i]);
+	}
+	Expect(matches, "metrics: DPI, sizes, rotation and 2D transform match the reference in every state");
+	Expect(agrees, "metrics: the 3D transform rotates clip space as the 2D transform rotates the screen");
+
+	// The rotation table, orientation by orientation.
+	struct Case
+	{
+		DisplayOrientation	native;
+		DisplayOrientation	current;
+		DisplayRotation		rotation;
+	};
+	static const Case cases[] =
+	{
+		{ DisplayOrientation::Landscape, DisplayOrientation::Landscape, DisplayRotation::Identity },
+		{ DisplayOrientation::Landscape, DisplayOrientation::Portrait, DisplayRotation::Rotate270 },
+		{ DisplayOrientation::Landscape, DisplayOrientation::LandscapeFlipped, DisplayRotation::Rotate180 },
+		{ DisplayOrientation::Landscape, DisplayOrientation::PortraitFlipped, DisplayRotation::Rotate90 },
+		{ DisplayOrientation::Portrait, DisplayOrientation::Landscape, DisplayRotation::Rotate90 },
+		{ DisplayOrientation::Portrait, DisplayOrientation::Portrait, DisplayRotation::Identity },
+		{ DisplayOrientation::Portrait, DisplayOrientation::LandscapeFlipped, DisplayRotation::Rotate270 },
+		{ DisplayOrientation::Portrait, DisplayOrientation::PortraitFlipped, DisplayRotation::Rotate180 },
+		{ DisplayOrientation::LandscapeFlipped, DisplayOrientation::Landscape, DisplayRotation::Unspecified },
+		{ DisplayOrientation::None, DisplayOrientation::Portrait, DisplayRotation::Unspecified },
+		{ DisplayOrientation::Landscape, DisplayOrientation::None, DisplayRotation::Unspecified },
+	};
+	bool rotations = true;
+	for (const Case& test : cases)
+	{
+		rotations = rotations && DX::ComputeDisplayRotation(test.native, test.current) == test.rotation;
+	}
+	Expect(rotations, "metrics: each pair of orientations has the rotation DXGI expects");
+
+	// Spot checks of the rules the reference encodes.
+	DisplayMetrics high = DX::ComputeDisplayMetrics({ 1920.0f, 1080.0f, 240.0f, 2.5f, 2.5f, DisplayOrientation::Landscape, DisplayOrientation::Landscape });
+	DisplayMetrics threshold = DX::ComputeDisplayMetrics({ 1920.0f, 1080.0f, 192.0f, 2.0f, 2.0f, DisplayOrientation::Landscape, DisplayOrientation::Landscape });
+	DisplayMetrics small = DX::ComputeDisplayMetrics({ 800.0f, 300.0f, 288.0f, 3.0f, 3.0f, DisplayOrientation::Landscape, DisplayOrientation::Landscape });
+	Expect(high.effectiveDpi == 120.0f && high.outputWidth == 2400.0f && high.outputHeight == 1350.0f && high.effectiveCompositionScaleX == 1.25f &&
+		threshold.effectiveDpi == 192.0f && threshold.outputWidth == 3840.0f && small.effectiveDpi == 288.0f && small.outputWidth == 2400.0f,
+		"metrics: only windows larger than 1080p above 192 DPI render at half the DPI");
+
+	DisplayMetrics empty = DX::ComputeDisplayMetrics({ 0.0f, 0.0f, 96.0f, 1.0f, 1.0f, DisplayOrientation::Landscape, DisplayOrientation::Portrait });
+	Expect(empty.outputWidth == 1.0f && empty.outputHeight == 1.0f && empty.renderTargetWidth == 1.0f, "metrics: an empty window still gets a one pixel render target");
+
+	DisplayMetrics portrait = DX::ComputeDisplayMetrics({ 1080.0f, 1920.0f, 96.0f, 1.0f, 1.0f, DisplayOrientation::Landscape, DisplayOrientation::Portrait });
+	Expect(portrait.outputWidth == 1080.0f && portrait.outputHeight == 1920.0f && portrait.renderTargetWidth == 1920.0f && portrait.renderTargetHeight == 1080.0f,
+		"metrics: a landscape display turned to portrait keeps its buffers in landscape");
+}
+
+// What a transition should report, from the reference metrics of both states.
+static DisplayChange GetExpectedChange(const Reference& previous, const Reference& next)
+{
+	if (previous.renderTargetWidth != next.renderTargetWidth || previous.renderTargetHeight != next.renderTargetHeight)
+	{
+		return DisplayChange::Resize;
+	}
+
+	bool same = previous.dpi == next.dpi && previous.scaleX == next.scaleX && previous.scaleY == next.scaleY &&
+		previous.outputWidth == next.outputWidth && previous.outputHeight == next.outputHeight && previous.rotation == next.rotation;
+	for (int i = 0; i < 6; i++)
+	{
+		same = same && previous.transform2D[i] == next.transform2D[i];
+	}
+	return same ? DisplayChange::None : DisplayChange::Transform;
+}
+
+static DisplayChange Compare(const DisplayState& previous, const DisplayState& next)
+{
+	return DX::CompareDisplayMetrics(DX::ComputeDisplayMetrics(previous), DX::ComputeDisplayMetrics(next));
+}
+
+static void CheckTransitions(const std::vector<DisplayState>& states, const std::vector<DisplayMetrics>& metrics)
+{
+	std::vector<Reference> references;
+	for (const DisplayState& state : states)
+	{
+		references.push_back(GetReference(state));
+	}
+
+	uint64_t counts[3] = {};
+	uint64_t wrong = 0;
+	bool symmetric = true;
+	for (size_t a = 0; a < states.size(); a++)
+	{
+		for (size_t b = 0; b < states.size(); b++)
+		{
+			DisplayChange change = DX::CompareDisplayMetrics(metrics[a], metrics[b]);
+			counts[static_cast<uint32_t>(change)]++;
+			wrong += change != GetExpectedChange(references[a], references[b]) ? 1 : 0;
+			symmetric = symmetric && change == DX::CompareDisplayMetrics(metrics[b], metrics[a]);
+		}
+	}
+	printf("\n%zu states, %zu transitions: %llu none, %llu transform only, %llu resize, %llu wrong\n\n", states.size(), states.size() * states.size(),
+		static_cast<unsigned long long>(counts[0]), static_cast<unsigned long long>(counts[1]),
+		static_cast<unsigned long long>(counts[2]), static_cast<unsigned long long>(wrong));
+	Expect(wrong == 0, "transitions: every transition resizes exactly when the native buffer size changes, and is otherwise classified by what changed");
+	Expect(symmetric, "transitions: going back reports the same change as going forward");
+
+	// The transitions the app meets most, spelled out.
+	const DisplayOrientation L = DisplayOrientation::Landscape;
+	const DisplayOrientation P = DisplayOrientation::Portrait;
+	const DisplayOrientation LF = DisplayOrientation::LandscapeFlipped;
+	const DisplayOrientation PF = DisplayOrientation::PortraitFlipped;
+	DisplayState landscape = { 1366.0f, 768.0f, 144.0f, 1.5f, 1.5f, L, L };
+	DisplayState state = landscape;
+	Expect(Compare(landscape, state) == DisplayChange::None, "transitions: the same state changes nothing");
+
+	DisplayState turned = { 768.0f, 1366.0f, 144.0f, 1.5f, 1.5f, L, P };
+	DisplayState turnedBack = { 768.0f, 1366.0f, 144.0f, 1.5f, 1.5f, L, PF };
+	Expect(Compare(landscape, turned) == DisplayChange::Transform && Compare(turned, turnedBack) == DisplayChange::Transform,
+		"transitions: turning the device a quarter, as the window's size swaps with it, only changes the transform");
+
+	state.currentOrientation = LF;
+	Expect(Compare(landscape, state) == DisplayChange::Transform, "transitions: turning the device upside down only changes the transform");
+
+	state = landscape;
+	state.currentOrientation = P;
+	Expect(Compare(landscape, state) == DisplayChange::Resize, "transitions: a quarter turn that keeps the window's size resizes");
+
+	state = landscape;
+	state.logicalWidth = 1024.0f;
+	Expect(Compare(landscape, state) == DisplayChange::Resize, "transitions: resizing the window resizes");
+
+	state = landscape;
+	state.dpi = 96.0f;
+	Expect(Compare(landscape, state) == DisplayChange::Resize, "transitions: moving to a monitor of another DPI resizes");
+
+	state = landscape;
+	state.compositionScaleX = state.compositionScaleY = 2.0f;
+	Expect(Compare(landscape, state) == DisplayChange::Transform, "transitions: a new composition scale only changes the transform");
+
+	state = landscape;
+	state.logicalWidth = 1366.2f;
+	DisplayState flipped = landscape;
+	flipped.currentOrientation = LF;
+	DisplayState flippedFraction = state;
+	flippedFraction.currentOrientation = LF;
+	Expect(Compare(landscape, state) == DisplayChange::None && Compare(flipped, flippedFraction) == DisplayChange::Transform,
+		"transitions: a size that rounds to the same pixels changes nothing, unless a rotation moves the content by it");
+
+	DisplayState low = { 1920.0f, 1080.0f, 192.0f, 2.0f, 2.0f, L, L };
+	DisplayState high = { 1920.0f, 1080.0f, 240.0f, 2.5f, 2.5f, L, L };
+	DisplayState higher = { 1920.0f, 1080.0f, 384.0f, 4.0f, 4.0f, L, L };
+	Expect(Compare(low, high) == DisplayChange::Resize && Compare(low, higher) == DisplayChange::None,
+		"transitions: crossing the high resolution threshold halves the DPI, so twice the DPI can render as the lower one does");
+}
+
+// A plain model of the cache: the last Capacity distinct states, the oldest replaced first.
+static void CheckCache(const std::vector<DisplayState>& states, std::mt19937& random)
+{
+	DX::DisplayMetricsCache cache;
+	std::vector<DisplayState> model;
+	size_t next = 0;
+	uint64_t hits = 0;
+	uint64_t misses = 0;
+	bool same = true;
+
+	// Random walks over working sets of a few states, like a window moving between monitors
+	// and orientations, with now and then a jump to a new set.
+	std::vector<size_t> working;
+	for (uint32_t step = 0; step < 200000; step++)
+	{
+		if (step % 5000 == 0)
+		{
+			working.clear();
+			size_t size = 1 + random() % 12;
+			for (size_t i = 0; i < size; i++)
+			{
+				working.push_back(random() % states.size());
+			}
+		}
+
+		const DisplayState& state = states[working[random() % working.size()]];
+		const DisplayMetrics& metrics = cache.Get(state);
+		DisplayMetrics expected = DX::ComputeDisplayMetrics(state);
+		same = same && memcmp(&metrics, &expected, sizeof(DisplayMetrics)) == 0;
+
+		auto found = std::find(model.begin(), model.end(), state);
+		if (found != model.end())
+		{
+			hits++;
+		}
+		else
+		{
+			misses++;
+			if (model.size() < DX::DisplayMetricsCache::Capacity)
+			{
+				model.push_back(state);
+			}
+			else
+			{
+				model[next] = state;
+			}
+			next = (next + 1) % DX::DisplayMetricsCache::Capacity;
+		}
+	}
+	Expect(same, "cache: Get returns what ComputeDisplayMetrics does, on every transition of a random walk");
+	Expect(cache.GetHits() == hits && cache.GetMisses() == misses, "cache: hits and misses match a model that replaces the oldest state");
+
+	// Going back and forth between two orientations computes each once.
+	DX::DisplayMetricsCache pair;
+	for (int i = 0; i < 100; i++)
+	{
+		pair.Get(states[i % 2]);
+	}
+	Expect(pair.GetMisses() == 2 && pair.GetHits() == 98, "cache: a window moving between two states computes each once");
+
+	// One state more than the capacity, in turn, misses every time; Clear forgets everything.
+	DX::DisplayMetricsCache cycle;
+	for (int i = 0; i < 90; i++)
+	{
+		cycle.Get(states[i % (DX::DisplayMetricsCache::Capacity + 1)]);
+	}
+	bool thrashed = cycle.GetHits() == 0;
+	cycle.Clear();
+	cycle.Get(states[0]);
+	cycle.Get(states[0]);
+	Expect(thrashed && cycle.GetMisses() == 91 && cycle.GetHits() == 1, "cache: more states than it holds, in turn, always miss, and Clear forgets them");
+}
+
+int main(int argc, char** argv)
+{
+	if (argc > 1)
+	{
+		fprintf(stderr, "Usage: %s\n", argv[0]);
+		return 1;
+	}
+
+	std::vector<DisplayState> states = MakeStates();
+	std::vector<DisplayMetrics> metrics;
+	for (const DisplayState& state : states)
+	{
+		metrics.push_back(DX::ComputeDisplayMetrics(state));
+	}
+
+	std::mt19937 random(1);
+	CheckMetrics(states, metrics);
+	CheckTransitions(states, metrics);
+	CheckCache(states, random);
+
+	return ReportChecks();
+}
@@ -0,0 +1,179 @@
+﻿// Runs a render loop on DX::FrameScheduler in on-demand mode and checks that it sleeps while
+// nothing changes: no frames and no wakeups over a long idle period, then a frame for each
+// Invalidate, with those made during a frame folded into one, a wakeup without a frame for Wake,
+// and a frame at a scheduled redraw.
+//
+// Usage: FrameSchedulerTest [--idle <ms>]
+//
+//   --idle <ms>					How long the loop is left idle. The default is 2000; an
+//									hour shows the same, more slowly.
+//
+// Build it with:
+//
+//   g++ -std=c++17 -O2 -pthread FrameSchedulerTest.cpp -o FrameSchedulerTest
+
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <thread>
+#include "../Common/FrameScheduler.h"
+#include "Check.h"
+
+using Clock = DX::FrameScheduler::Clock;
+
+// The render loop. The scheduler's statistics belong to the loop's thread, so the loop copies
+// them out after each wait.
+class RenderLoop
+{
+public:
+	explicit RenderLoop(DX::FrameScheduler& scheduler) :
+		m_scheduler(scheduler),
+		m_running(true),
+		m_frames(0),
+		m_wakesWithoutFrame(0),
+		m_wakeups(0),
+		m_lastFrameTime(0),
+		m_frameMilliseconds(0),
+		m_thread([this] { Run(); })
+	{
+	}
+
+	~RenderLoop()
+	{
+		m_running.store(false);
+		m_scheduler.Wake();
+		m_thread.join();
+	}
+
+	// How long drawing a frame takes. Invalidations during a frame are folded into the next.
+	void SetFrameDuration(std::chrono::milliseconds duration) { m_frameMilliseconds.store(duration.count()); }
+
+	uint64_t GetFrames() const { return m_frames.load(); }
+	uint64_t GetWakesWithoutFrame() const { return m_wakesWithoutFrame.load(); }
+	uint64_t GetWakeups() const { return m_wakeups.load(); }
+	Clock::time_point GetLastFrameTime() const { return Clock::time_point(Clock::duration(m_lastFrameTime.load())); }
+
+private:
+	void Run()
+	{
+		while (m_running.load())
+		{
+			bool frame = m_scheduler.WaitForFrame();
+			m_wakeups.store(m_scheduler.GetWakeupCount());
+			if (frame)
+			{
+				m_lastFrameTime.store(Clock::now().time_since_epoch().count());
+				m_frames++;
+				std::this_thread::sleep_for(std::chrono::milliseconds(m_frameMilliseconds.load()));
+			}
+			else
+			{
+				m_wakesWithoutFrame++;
+			}
+		}
+	}
+
+	DX::FrameScheduler&					m_scheduler;
+	std::atomic<bool>					m_running;
+	std::atomic<uint64_t>				m_frames;
+	std::atomic<uint64_t>				m_wakesWithoutFrame;
+	std::atomic<uint64_t>				m_wakeups;
+	std::atomic<Clock::rep>				m_lastFrameTime;
+	std::atomic<int64_t>				m_frameMilliseconds;
+	std::thread							m_thread;
+};
+
+// Waits up to a second for the loop to reach a count, so the checks don't depend on how quickly
+// the loop's thread is scheduled.
+template<typename TCount>
+static bool WaitFor(const TCount& count, uint64_t expected)
+{
+	auto end = Clock::now() + std::chrono::seconds(1);
+	while (count() < expected && Clock::now() < end)
+	{
+		std::this_thread::sleep_for(std::chrono::milliseconds(1));
+	}
+	return count() == expected;
+}
+
+int main(int argc, char** argv)
+{
+	std::chrono::milliseconds idle(2000);
+
+	for (int i = 1; i < argc; i++)
+	{
+		std::string argument = argv[i];
+		if (argument == "--idle" && i + 1 < argc)
+		{
+			idle = std::chrono::milliseconds(strtol(argv[++i], nullptr, 10));
+		}
+		else
+		{
+			fprintf(stderr, "%s: unknown option\n", argument.c_str());
+			fprintf(stderr, "Usage: %s [--idle <ms>]\n", argv[0]);
+			return 1;
+		}
+	}
+
+	DX::FrameScheduler scheduler;
+	scheduler.SetContinuous(false);
+	RenderLoop loop(scheduler);
+	auto frames = [&loop] { return loop.GetFrames(); };
+	auto wakesWithoutFrame = [&loop] { return loop.GetWakesWithoutFrame(); };
+
+	// A new scheduler starts dirty, so the first frame is drawn.
+	Expect(WaitFor(frames, 1), "the first frame is drawn at once");
+
+	std::this_thread::sleep_for(idle);
+	char description[160];
+	snprintf(description, sizeof(description), "idle for %lld ms: %llu frames, %llu wakeups", static_cast<long long>(idle.count()),
+		static_cast<unsigned long long>(loop.GetFrames() - 1), static_cast<unsigned long long>(loop.GetWakeups()));
+	Expect(loop.GetFrames() == 1 && loop.GetWakeups() == 0 && loop.GetWakesWithoutFrame() == 0, description);
+
+	auto invalidated = Clock::now();
+	scheduler.Invalidate();
+	bool drawn = WaitFor(frames, 2);
+	snprintf(description, sizeof(description), "Invalidate draws one frame, %.2f ms later",
+		std::chrono::duration<double, std::milli>(loop.GetLastFrameTime() - invalidated).count());
+	Expect(drawn, description);
+
+	// Invalidations from two threads while a frame is drawn make one more frame: the first
+	// wakes the loop, and the rest arrive while it draws.
+	loop.SetFrameDuration(std::chrono::milliseconds(100));
+	std::thread other([&scheduler] { for (int i = 0; i < 1000; i++) scheduler.Invalidate(); });
+	for (int i = 0; i < 1000; i++)
+	{
+		scheduler.Invalidate();
+	}
+	other.join();
+	std::this_thread::sleep_for(std::chrono::milliseconds(300));
+	loop.SetFrameDuration(std::chrono::milliseconds(0));
+	uint64_t burst = loop.GetFrames() - 2;
+	snprintf(description, sizeof(description), "2000 invalidations draw %llu frames", static_cast<unsigned long long>(burst));
+	Expect(burst >= 1 && burst <= 2, description);
+
+	uint64_t before = loop.GetFrames();
+	scheduler.Wake();
+	Expect(WaitFor(wakesWithoutFrame, 1) && loop.GetFrames() == before, "Wake wakes the loop without drawing");
+
+	auto deadline = Clock::now() + std::chrono::milliseconds(100);
+	scheduler.ScheduleRedraw(deadline);
+	scheduler.ScheduleRedraw(deadline + std::chrono::seconds(10));
+	bool redrawn = WaitFor(frames, before + 1);
+	double late = std::chrono::duration<double, std::milli>(loop.GetLastFrameTime() - deadline).count();
+	snprintf(description, sizeof(description), "a scheduled redraw draws at the earliest deadline, %.2f ms after it", late);
+	Expect(redrawn && late >= 0.0 && late < 50.0, description);
+
+	std::this_thread::sleep_for(std::chrono::milliseconds(200));
+	Expect(loop.GetFrames() == before + 1, "nothing is drawn after the deadline");
+
+	// In continuous mode every iteration draws.
+	scheduler.SetContinuous(true);
+	std::this_thread::sleep_for(std::chrono::milliseconds(20));
+	Expect(loop.GetFrames() > before + 100, "continuous mode draws without waiting");
+	scheduler.SetContinuous(false);
+
+	return ReportChecks();
+}
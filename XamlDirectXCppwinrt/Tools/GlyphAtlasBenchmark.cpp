@@ -0,0 +1,561 @@
+﻿// Checks the pieces of DX::GlyphAtlas against plain references, then times them: the skyline
+// packer, that packed rectangles stay inside the area and never overlap; the distance
+// transform and DistanceField::Generate, against a brute force search for the nearest texel;
+// and the atlas, that its glyphs land where they were packed and lay out as their advances
+// say. The benchmark packs glyph-sized rectangles until atlases of several sizes are full,
+// generates distance fields of glyphs of several sizes, and fills an atlas with synthetic
+// glyphs as DistanceFieldFont fills it with a font's.
+//
+// Usage: GlyphAtlasBenchmark [options]
+//
+//   --glyphs <count>				Glyphs added in the atlas fill timing. The default is 2000.
+//   --repeat <count>				Times each measurement is repeated. The default is 20.
+//   --seed <value>					Seed for the rectangles and glyphs. The default is 1.
+//
+// Glyphs are drawn as a few antialiased strokes, so their distance fields cost what a real
+// font's do without needing a rasterizer. Build it with:
+//
+//   g++ -std=c++17 -O2 GlyphAtlasBenchmark.cpp -o GlyphAtlasBenchmark
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <string>
+#include <vector>
+#include "../Common/GlyphAtlas.h"
+#include "Check.h"
+
+using DX::GlyphAtlas;
+using DX::GlyphBitmap;
+using DX::SkylinePacker;
+using Clock = std::chrono::steady_clock;
+
+namespace DistanceField = DX::DistanceField;
+
+// The app's font: DistanceFieldFont rasterizes at 48 pixels to the em, with a spread of 6, into
+// a 512 x 512 atlas.
+static const float RasterEmSize = 48.0f;
+static const uint32_t Spread = 6;
+static const uint32_t AtlasSize = 512;
+
+struct PackedRect
+{
+	uint32_t	x;
+	uint32_t	y;
+	uint32_t	width;
+	uint32_t	height;
+};
+
+// Whether the rectangles are inside the area and cover no texel twice.
+static bool CheckPlacement(const std::vector<PackedRect>& rects, uint32_t width, uint32_t height)
+{
+	std::vector<uint8_t> used(size_t(width) * height, 0);
+	for (const PackedRect& rect : rects)
+	{
+		if (rect.x + rect.width > width || rect.y + rect.height > height)
+		{
+			return false;
+		}
+		for (uint32_t y = rect.y; y < rect.y + rect.height; y++)
+		{
+			for (uint32_t x = rect.x; x < rect.x + rect.width; x++)
+			{
+				if (used[size_t(y) * width + x]++ != 0)
+				{
+					return false;
+				}
+			}
+		}
+	}
+	return true;
+}
+
+// A glyph's distance field rectangle, with the atlas's texel of padding: the size of a glyph at
+// the em size, from a narrow punctuation mark to a wide capital, plus the spread on each side.
+static void MakeGlyphSize(std::mt19937& random, float emSize, uint32_t spread, uint32_t* width, uint32_t* height)
+{
+	uint32_t em = static_cast<uint32_t>(emSize);
+	*width = 1 + random() % em + spread * 2 + 1;
+	*height = em / 8 + random() % em + spread * 2 + 1;
+}
+
+static void CheckPacker(std::mt19937& random)
+{
+	SkylinePacker packer(256, 256);
+	uint32_t x, y;
+	Expect(!packer.Pack(0, 4, &x, &y) && !packer.Pack(4, 0, &x, &y) && !packer.Pack(257, 1, &x, &y) && !packer.Pack(1, 257, &x, &y),
+		"packer: empty rectangles and rectangles larger than the area don't fit");
+
+	// Equal squares that tile the area fill it completely.
+	std::vector<PackedRect> rects;
+	for (uint32_t i = 0; i < 256; i++)
+	{
+		PackedRect rect = { 0, 0, 16, 16 };
+		if (!packer.Pack(rect.width, rect.height, &rect.x, &rect.y))
+		{
+			break;
+		}
+		rects.push_back(rect);
+	}
+	Expect(rects.size() == 256 && packer.GetOccupancy() == 1.0f && !packer.Pack(1, 1, &x, &y) && CheckPlacement(rects, 256, 256),
+		"packer: squares that tile the area fill all of it");
+
+	packer.Reset(256, 256);
+	Expect(packer.GetOccupancy() == 0.0f && packer.Pack(256, 256, &x, &y) && x == 0 && y == 0, "packer: Reset empties the area");
+
+	// Random glyph-sized rectangles until the area is full. A rectangle that doesn't fit leaves
+	// the packer as it was, so smaller ones that follow still fit.
+	bool placed = true;
+	bool occupancyMatches = true;
+	bool keptPacking = false;
+	for (uint32_t size : { 256u, 512u, 1024u })
+	{
+		packer.Reset(size, size);
+		rects.clear();
+		uint64_t area = 0;
+		uint32_t failures = 0;
+		while (failures < 200)
+		{
+			PackedRect rect;
+			MakeGlyphSize(random, RasterEmSize, Spread, &rect.width, &rect.height);
+			if (!packer.Pack(rect.width, rect.height, &rect.x, &rect.y))
+			{
+				failures++;
+				continue;
+			}
+			keptPacking = keptPacking || failures > 0;
+			rects.push_back(rect);
+			area += uint64_t(rect.width) * rect.height;
+		}
+		placed = placed && CheckPlacement(rects, size, size);
+		occupancyMatches = occupancyMatches && std::fabs(packer.GetOccupancy() - static_cast<double>(area) / (double(size) * size)) < 1e-6;
+	}
+	Expect(placed, "packer: random rectangles stay inside the area and never overlap");
+	Expect(occupancyMatches, "packer: the occupancy is the packed area over the whole area");
+	Expect(keptPacking, "packer: a rectangle that doesn't fit leaves room for smaller ones after it");
+}
+
+// The squared distance from each texel to the nearest feature texel, by trying every one.
+static std::vector<float> BruteForceTransform(const std::vector<float>& features, int width, int height)
+{
+	std::vector<float> distances(features.size(), DistanceField::Infinity);
+	for (int y = 0; y < height; y++)
+	{
+		for (int x = 0; x < width; x++)
+		{
+			float& nearest = distances[size_t(y) * width + x];
+			for (int fy = 0; fy < height; fy++)
+			{
+				for (int fx = 0; fx < width; fx++)
+				{
+					if (features[size_t(fy) * width + fx] == 0.0f)
+					{
+						nearest = (std::min)(nearest, float((x - fx) * (x - fx) + (y - fy) * (y - fy)));
+					}
+				}
+			}
+		}
+	}
+	return distances;
+}
+
+// A glyph-like coverage bitmap: a few antialiased strokes, as capsules, with the coverage of
+// each texel the share of four by four samples inside one.
+static std::vector<uint8_t> MakeGlyph(std::mt19937& random, uint32_t width, uint32_t height)
+{
+	struct Stroke
+	{
+		float	x0, y0, x1, y1, radius;
+	};
+	std::uniform_real_distribution<float> unit(0.0f, 1.0f);
+	std::vector<Stroke> strokes(2 + random() % 3);
+	for (Stroke& stroke : strokes)
+	{
+		stroke = { unit(random) * width, unit(random) * height, unit(random) * width, unit(random) * height,
+			1.0f + unit(random) * (std::min)(width, height) * 0.08f };
+	}
+
+	std::vector<uint8_t> coverage(size_t(width) * height);
+	for (uint32_t y = 0; y < height; y++)
+	{
+		for (uint32_t x = 0; x < width; x++)
+		{
+			uint32_t inside = 0;
+			for (uint32_t sample = 0; sample < 16; sample++)
+			{
+				float px = x + (sample % 4 + 0.5f) / 4.0f;
+				float py = y + (sample / 4 + 0.5f) / 4.0f;
+				for (const Stroke& stroke : strokes)
+				{
+					float dx = stroke.x1 - stroke.x0;
+					float dy = stroke.y1 - stroke.y0;
+					float lengthSquared = dx * dx + dy * dy;
+					float t = lengthSquared > 0.0f ? (std::min)((std::max)(((px - stroke.x0) * dx + (py - stroke.y0) * dy) / lengthSquared, 0.0f), 1.0f) : 0.0f;
+					float ex = px - (stroke.x0 + t * dx);
+					float ey = py - (stroke.y0 + t * dy);
+					if (ex * ex + ey * ey <= stroke.radius * stroke.radius)
+					{
+						inside++;
+						break;
+					}
+				}
+			}
+			coverage[size_t(y) * width + x] = static_cast<uint8_t>((inside * 255 + 8) / 16);
+		}
+	}
+	return coverage;
+}
+
+static void CheckDistanceField(std::mt19937& random)
+{
+	// The transform is exact, so it must match the brute force search on any pattern, including
+	// none and every texel.
+	bool exact = true;
+	for (int test = 0; test < 40; test++)
+	{
+		int width = 1 + random() % 24;
+		int height = 1 + random() % 24;
+		uint32_t density = test < 2 ? test * 100 : random() % 30;
+		std::vector<float> values(size_t(width) * height);
+		for (float& value : values)
+		{
+			value = (random() % 100 < density) ? 0.0f : DistanceField::Infinity;
+		}
+		std::vector<float> expected = BruteForceTransform(values, width, height);
+		DistanceField::Transform2D(values.data(), width, height);
+		for (size_t i = 0; i < values.size(); i++)
+		{
+			bool none = expected[i] == DistanceField::Infinity;
+			exact = exact && (none ? values[i] >= DistanceField::Infinity * 0.5f : values[i] == expected[i]);
+		}
+	}
+	Expect(exact, "distance field: the transform matches a brute force search for the nearest texel");
+
+	// Generate against the encoding applied to brute force distances, on glyphs of several
+	// sizes and spreads, into a destination wider than the field with guard bytes after it.
+	bool encoded = true;
+	bool guarded = true;
+	bool thresholded = true;
+	for (int test = 0; test < 12; test++)
+	{
+		uint32_t width = 4 + random() % 28;
+		uint32_t height = 4 + random() % 28;
+		uint32_t spread = 1 + random() % 8;
+		std::vector<uint8_t> coverage = MakeGlyph(random, width, height);
+
+		int fieldWidth = static_cast<int>(width + spread * 2);
+		int fieldHeight = static_cast<int>(height + spread * 2);
+		uint32_t pitch = fieldWidth + 5;
+		std::vector<uint8_t> field(size_t(pitch) * fieldHeight, 0xCD);
+		DistanceField::Generate(coverage.data(), width, height, width, spread, field.data(), pitch);
+
+		std::vector<float> inside(size_t(fieldWidth) * fieldHeight, DistanceField::Infinity);
+		std::vector<float> outside(size_t(fieldWidth) * fieldHeight, 0.0f);
+		for (uint32_t y = 0; y < height; y++)
+		{
+			for (uint32_t x = 0; x < width; x++)
+			{
+				if (coverage[size_t(y) * width + x] >= 128)
+				{
+					size_t texel = size_t(y + spread) * fieldWidth + x + spread;
+					inside[texel] = 0.0f;
+					outside[texel] = DistanceField::Infinity;
+				}
+			}
+		}
+		std::vector<float> toInside = BruteForceTransform(inside, fieldWidth, fieldHeight);
+		std::vector<float> toOutside = BruteForceTransform(outside, fieldWidth, fieldHeight);
+
+		float scale = 127.0f / spread;
+		for (int y = 0; y < fieldHeight; y++)
+		{
+			for (int x = 0; x < fieldWidth; x++)
+			{
+				size_t texel = size_t(y) * fieldWidth + x;
+				float distance = (toOutside[texel] > 0.0f) ? std::sqrt(toOutside[texel]) - 0.5f : 0.5f - std::sqrt(toInside[texel]);
+				float expected = (std::min)((std::max)(128.0f + distance * scale, 0.0f), 255.0f);
+				uint8_t value = field[size_t(y) * pitch + x];
+				encoded = encoded && std::fabs(value - expected) <= 0.5f + 1e-3f;
+				thresholded = thresholded && ((value >= 128) == (outside[texel] > 0.0f));
+			}
+			for (uint32_t x = fieldWidth; x < pitch; x++)
+			{
+				guarded = guarded && field[size_t(y) * pitch + x] == 0xCD;
+			}
+		}
+	}
+	Expect(encoded, "distance field: Generate encodes the brute force signed distances, 128 at the edge");
+	Expect(thresholded, "distance field: thresholding the field at 128 gives back the glyph");
+	Expect(guarded, "distance field: Generate writes only the field's texels of each row");
+
+	// With nothing inside, every texel is as far outside as the encoding goes.
+	std::vector<uint8_t> empty(64, 0);
+	std::vector<uint8_t> field(size_t(8 + 8) * (8 + 8), 0xCD);
+	DistanceField::Generate(empty.data(), 8, 8, 8, 4, field.data(), 16);
+	Expect(std::all_of(field.begin(), field.end(), [](uint8_t value) { return value == 0; }), "distance field: an empty bitmap is outside everywhere");
+}
+
+static void CheckAtlas(std::mt19937& random)
+{
+	GlyphAtlas atlas(AtlasSize, AtlasSize, RasterEmSize, Spread);
+	atlas.SetLineMetrics(0.75f, 0.25f);
+
+	struct Added
+	{
+		uint32_t				codepoint;
+		uint32_t				width;
+		uint32_t				height;
+		std::vector<uint8_t>	coverage;
+	};
+	std::vector<Added> added;
+	bool addedAll = true;
+	for (uint32_t codepoint = '!'; codepoint <= '~'; codepoint++)
+	{
+		uint32_t width, height;
+		MakeGlyphSize(random, RasterEmSize, 0, &width, &height);
+		width -= 1;
+		height -= 1;
+		added.push_back({ codepoint, width, height, MakeGlyph(random, width, height) });
+		GlyphBitmap bitmap = { added.back().coverage.data(), width, height, width, 2, -static_cast<int32_t>(height) };
+		addedAll = addedAll && atlas.AddGlyph(codepoint, width + 4.0f, &bitmap);
+	}
+	addedAll = addedAll && atlas.AddGlyph(' ', 12.0f, nullptr);
+	Expect(addedAll, "atlas: the printable ASCII characters fit the app's atlas");
+
+	// Each glyph's texture rectangle holds its distance field, inside the atlas and clear of
+	// every other glyph's.
+	std::vector<PackedRect> rects;
+	bool matches = true;
+	const std::vector<uint8_t>& pixels = atlas.GetPixels();
+	for (const Added& glyphAdded : added)
+	{
+		const DX::Glyph* glyph = atlas.FindGlyph(glyphAdded.codepoint);
+		if (glyph == nullptr || glyph->blank)
+		{
+			matches = false;
+			continue;
+		}
+
+		PackedRect rect;
+		rect.x = static_cast<uint32_t>(std::lround(glyph->texture.left * AtlasSize));
+		rect.y = static_cast<uint32_t>(std::lround(glyph->texture.top * AtlasSize));
+		rect.width = static_cast<uint32_t>(std::lround(glyph->texture.right * AtlasSize)) - rect.x;
+		rect.height = static_cast<uint32_t>(std::lround(glyph->texture.bottom * AtlasSize)) - rect.y;
+		rects.push_back(rect);
+		matches = matches && rect.width == glyphAdded.width + Spread * 2 && rect.height == glyphAdded.height + Spread * 2;
+
+		std::vector<uint8_t> field(size_t(rect.width) * rect.height);
+		DistanceField::Generate(glyphAdded.coverage.data(), glyphAdded.width, glyphAdded.height, glyphAdded.width, Spread, field.data(), rect.width);
+		for (uint32_t y = 0; matches && y < rect.height; y++)
+		{
+			matches = std::equal(field.begin() + size_t(y) * rect.width, field.begin() + size_t(y + 1) * rect.width,
+				pixels.begin() + size_t(rect.y + y) * AtlasSize + rect.x);
+		}
+
+		// The bounds, in ems, put the field's top left corner spread texels beyond the bitmap's.
+		matches = matches && std::fabs(glyph->bounds.left - (2.0f - Spread) / RasterEmSize) < 1e-6f &&
+			std::fabs(glyph->bounds.top - (-float(glyphAdded.height) - Spread) / RasterEmSize) < 1e-6f &&
+			std::fabs(glyph->advance - (glyphAdded.width + 4.0f) / RasterEmSize) < 1e-6f;
+	}
+	Expect(matches, "atlas: each glyph's texture rectangle holds its distance field, with bounds and advance in ems");
+	Expect(CheckPlacement(rects, AtlasSize, AtlasSize), "atlas: glyphs don't overlap");
+
+	// Layout: characters the atlas lacks become '?', and blank glyphs only advance the pen.
+	DX::TextLayout layout;
+	atlas.LayoutText(L"A B\x4E2D", &layout);
+	const DX::Glyph* a = atlas.FindGlyph('A');
+	const DX::Glyph* b = atlas.FindGlyph('B');
+	const DX::Glyph* space = atlas.FindGlyph(' ');
+	const DX::Glyph* question = atlas.FindGlyph('?');
+	float spaceAdvance = 12.0f / RasterEmSize;
+	Expect(layout.glyphs.size() == 3 && space != nullptr && space->blank &&
+		layout.glyphs[0].glyph == a && layout.glyphs[0].x == 0.0f &&
+		layout.glyphs[1].glyph == b && std::fabs(layout.glyphs[1].x - (a->advance + spaceAdvance)) < 1e-6f &&
+		layout.glyphs[2].glyph == question && std::fabs(layout.width - (a->advance + spaceAdvance + b->advance + question->advance)) < 1e-6f,
+		"atlas: text lays out by advances, with blanks skipped and missing characters as '?'");
+
+	// Drawing at twice the size scales every quad about the line box's corner.
+	DX::SpriteBatch batch;
+	batch.Begin();
+	atlas.DrawLayout(batch, 7, layout, 10.0f, 20.0f, 32.0f, 0xFFFFFFFF);
+	atlas.DrawLayout(batch, 7, layout, 10.0f, 20.0f, 64.0f, 0xFFFFFFFF, 1);
+	batch.End();
+	const std::vector<DX::SpriteVertex>& vertices = batch.GetVertices();
+	bool scaled = vertices.size() == 24 && batch.GetDraws().size() == 1 && batch.GetDraws()[0].texture == 7;
+	for (size_t i = 0; scaled && i < 12; i++)
+	{
+		scaled = std::fabs((vertices[i + 12].x - 10.0f) - 2.0f * (vertices[i].x - 10.0f)) < 1e-3f &&
+			std::fabs((vertices[i + 12].y - 20.0f) - 2.0f * (vertices[i].y - 20.0f)) < 1e-3f &&
+			vertices[i + 12].u == vertices[i].u && vertices[i + 12].v == vertices[i].v;
+	}
+	Expect(scaled, "atlas: a layout is drawn at any size from the same glyphs");
+
+	// An atlas too small for the glyph says so, and keeps the glyphs it has.
+	GlyphAtlas small(32, 32, RasterEmSize, Spread);
+	std::vector<uint8_t> large = MakeGlyph(random, 24, 24);
+	GlyphBitmap bitmap = { large.data(), 24, 24, 24, 0, 0 };
+	bool fits = small.AddGlyph('x', 10.0f, &bitmap);
+	Expect(!fits && small.FindGlyph('x') == nullptr && small.AddGlyph(' ', 10.0f, nullptr), "atlas: a glyph that doesn't fit is refused");
+}
+
+static double Seconds(Clock::time_point start)
+{
+	return std::chrono::duration<double>(Clock::now() - start).count();
+}
+
+// Packs glyph-sized rectangles until the atlas is full, in the order they come and tallest
+// first, as a font whose glyphs are all known up front could be added.
+static void TimePacker(uint32_t repeat, std::mt19937& random)
+{
+	printf("\n%10s %10s %8s %10s %12s %14s\n", "Atlas", "Order", "Glyphs", "Occupancy", "ns/Pack", "Fill ms");
+	for (uint32_t size : { 512u, 1024u, 2048u, 4096u })
+	{
+		std::vector<PackedRect> rects(size_t(size) * size / (24 * 48) + 64);
+		for (PackedRect& rect : rects)
+		{
+			MakeGlyphSize(random, RasterEmSize, Spread, &rect.width, &rect.height);
+		}
+
+		for (bool sorted : { false, true })
+		{
+			if (sorted)
+			{
+				std::stable_sort(rects.begin(), rects.end(), [](const PackedRect& a, const PackedRect& b) { return a.height > b.height; });
+			}
+
+			SkylinePacker packer;
+			uint32_t packed = 0;
+			uint32_t calls = 0;
+			double seconds = 0.0;
+			for (uint32_t run = 0; run < repeat; run++)
+			{
+				packer.Reset(size, size);
+				packed = 0;
+				Clock::time_point start = Clock::now();
+				for (PackedRect& rect : rects)
+				{
+					packed += packer.Pack(rect.width, rect.height, &rect.x, &rect.y) ? 1 : 0;
+				}
+				seconds += Seconds(start);
+				calls += static_cast<uint32_t>(rects.size());
+			}
+			printf("%10u %10s %8u %9.1f%% %12.1f %14.3f\n", size, sorted ? "tallest" : "as added", packed,
+				packer.GetOccupancy() * 100.0f, seconds * 1e9 / calls, seconds * 1e3 / repeat);
+		}
+	}
+}
+
+static void TimeDistanceField(uint32_t repeat, std::mt19937& random)
+{
+	printf("\n%10s %8s %14s %12s\n", "Bitmap", "Spread", "ns/texel", "us/glyph");
+	struct Case
+	{
+		uint32_t	size;
+		uint32_t	spread;
+	};
+	static const Case cases[] = { { 16, 4 }, { 32, 4 }, { 48, Spread }, { 64, 8 }, { 128, 8 }, { 128, 16 } };
+	for (const Case& test : cases)
+	{
+		std::vector<uint8_t> coverage = MakeGlyph(random, test.size, test.size);
+		uint32_t fieldSize = test.size + test.spread * 2;
+		std::vector<uint8_t> field(size_t(fieldSize) * fieldSize);
+		uint32_t runs = (std::max)(1u, repeat * 4096 / (test.size * test.size) * 4);
+
+		Clock::time_point start = Clock::now();
+		for (uint32_t run = 0; run < runs; run++)
+		{
+			DistanceField::Generate(coverage.data(), test.size, test.size, test.size, test.spread, field.data(), fieldSize);
+		}
+		double seconds = Seconds(start);
+		printf("%10u %8u %14.2f %12.2f\n", test.size, test.spread, seconds * 1e9 / (double(runs) * fieldSize * fieldSize), seconds * 1e6 / runs);
+	}
+}
+
+// Fills atlases with glyphs as DistanceFieldFont does: the ASCII characters at the app's sizes,
+// then a larger set, as a font with more scripts would need.
+static void TimeAtlas(uint32_t glyphCount, uint32_t repeat, std::mt19937& random)
+{
+	printf("\n%8s %8s %8s %10s %10s %12s %12s\n", "Glyphs", "Em", "Atlas", "Added", "Occupancy", "us/glyph", "Fill ms");
+	struct Case
+	{
+		uint32_t	glyphs;
+		float		emSize;
+		uint32_t	atlasSize;
+	};
+	const Case cases[] = { { 94, RasterEmSize, AtlasSize }, { 94, 96.0f, 1024 }, { glyphCount, 32.0f, 2048 }, { glyphCount, RasterEmSize, 4096 } };
+	for (const Case& test : cases)
+	{
+		std::vector<uint32_t> widths(test.glyphs);
+		std::vector<uint32_t> heights(test.glyphs);
+		std::vector<std::vector<uint8_t>> coverage(test.glyphs);
+		for (uint32_t i = 0; i < test.glyphs; i++)
+		{
+			MakeGlyphSize(random, test.emSize, 0, &widths[i], &heights[i]);
+			coverage[i] = MakeGlyph(random, widths[i], heights[i]);
+		}
+
+		uint32_t runs = (std::max)(1u, repeat / (test.glyphs > 94 ? 10 : 1));
+		uint32_t added = 0;
+		float occupancy = 0.0f;
+		double seconds = 0.0;
+		for (uint32_t run = 0; run < runs; run++)
+		{
+			GlyphAtlas atlas(test.atlasSize, test.atlasSize, test.emSize, Spread);
+			added = 0;
+			Clock::time_point start = Clock::now();
+			for (uint32_t i = 0; i < test.glyphs; i++)
+			{
+				GlyphBitmap bitmap = { coverage[i].data(), widths[i], heights[i], widths[i], 0, -static_cast<int32_t>(heights[i]) };
+				added += atlas.AddGlyph(0x21 + i, widths[i] + 2.0f, &bitmap) ? 1 : 0;
+			}
+			seconds += Seconds(start);
+			occupancy = atlas.GetOccupancy();
+		}
+		printf("%8u %8.0f %8u %10u %9.1f%% %12.2f %12.3f\n", test.glyphs, test.emSize, test.atlasSize, added, occupancy * 100.0f,
+			seconds * 1e6 / (double(runs) * test.glyphs), seconds * 1e3 / runs);
+	}
+}
+
+int main(int argc, char** argv)
+{
+	uint32_t glyphCount = 2000;
+	uint32_t repeat = 20;
+	uint32_t seed = 1;
+
+	for (int i = 1; i < argc; i++)
+	{
+		std::string argument = argv[i];
+		if (argument == "--glyphs" && i + 1 < argc)
+		{
+			glyphCount = (std::max)(static_cast<uint32_t>(strtoul(argv[++i], nullptr, 10)), 1u);
+		}
+		else if (argument == "--repeat" && i + 1 < argc)
+		{
+			repeat = (std::max)(static_cast<uint32_t>(strtoul(argv[++i], nullptr, 10)), 1u);
+		}
+		else if (argument == "--seed" && i + 1 < argc)
+		{
+			seed = static_cast<uint32_t>(strtoul(argv[++i], nullptr, 10));
+		}
+		else
+		{
+			fprintf(stderr, "%s: unknown option\n", argument.c_str());
+			fprintf(stderr, "Usage: %s [--glyphs <count>] [--repeat <count>] [--seed <value>]\n", argv[0]);
+			return 1;
+		}
+	}
+
+	std::mt19937 random(seed);
+	CheckPacker(random);
+	CheckDistanceField(random);
+	CheckAtlas(random);
+
+	TimePacker(repeat, random);
+	TimeDistanceField(repeat, random);
+	TimeAtlas(glyphCount, repeat, random);
+
+	return ReportChecks();
+}
@@ -0,0 +1,168 @@
+﻿// Drives DX::InputEventQueue the way the app does, with an input thread pushing pointer samples
+// and a render loop draining them once per frame, and reports how long samples wait in the
+// queue. Checks that every sample arrives once and in order, or is counted as dropped.
+//
+// Usage: InputQueueBenchmark [options]
+//
+//   --events <count>				Samples to push. The default is 1200, five seconds of pen
+//									input, or 1000000 with --rate 0.
+//   --rate <per second>			Samples pushed per second. The default is 240, about what a
+//									pen reports; 0 pushes as fast as possible, a stress test.
+//   --frame <us>					Time between drains, standing in for the frame rate. The
+//									default is 16000, a 60 Hz frame, or 0 with --rate 0 so the
+//									render loop drains as fast as possible too.
+//
+// Latency is the time from a push to the drain that hands the sample to the render loop. At a
+// pen's rate a frame's samples fit easily in the queue, so more than 1% dropped fails the run.
+// The stress test pushes faster than any drain keeps up with and only reports what it dropped;
+// with one core it mostly measures the scheduler's time slice. Build it with:
+//
+//   g++ -std=c++17 -O2 -pthread InputQueueBenchmark.cpp -o InputQueueBenchmark
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+#include "../Common/InputEventQueue.h"
+#include "Check.h"
+
+using Clock = std::chrono::steady_clock;
+
+static uint64_t GetMicroseconds(Clock::time_point start)
+{
+	return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::microseconds>(Clock::now() - start).count());
+}
+
+// Largest share of the samples that may be dropped at a steady rate.
+static const double MaxDroppedFraction = 0.01;
+
+int main(int argc, char** argv)
+{
+	uint32_t eventCount = 0;
+	double rate = 240.0;
+	int64_t frameMicroseconds = -1;
+
+	for (int i = 1; i < argc; i++)
+	{
+		std::string argument = argv[i];
+		if (argument == "--events" && i + 1 < argc)
+		{
+			eventCount = (std::max)(static_cast<uint32_t>(strtoul(argv[++i], nullptr, 10)), 1u);
+		}
+		else if (argument == "--rate" && i + 1 < argc)
+		{
+			rate = strtod(argv[++i], nullptr);
+		}
+		else if (argument == "--frame" && i + 1 < argc)
+		{
+			frameMicroseconds = static_cast<int64_t>(strtoul(argv[++i], nullptr, 10));
+		}
+		else
+		{
+			fprintf(stderr, "%s: unknown option\n", argument.c_str());
+			fprintf(stderr, "Usage: %s [--events <count>] [--rate <per second>] [--frame <us>]\n", argv[0]);
+			return 1;
+		}
+	}
+
+	// Unless they were given, the defaults follow the mode: a few seconds of pen input drained
+	// once a frame, or a flood drained as fast as possible.
+	bool stress = (rate <= 0.0);
+	if (eventCount == 0)
+	{
+		eventCount = stress ? 1000000 : 1200;
+	}
+	if (frameMicroseconds < 0)
+	{
+		frameMicroseconds = stress ? 0 : 16000;
+	}
+
+	// Large enough to live outside the stack, like the app's member.
+	auto queue = std::make_unique<DX::InputEventQueue>();
+	std::atomic<bool> producing(true);
+	Clock::time_point start = Clock::now();
+
+	// The input thread. The pointer ID carries the sequence number, so the drain can check the
+	// order; the timestamp is when the sample was pushed.
+	std::thread producer([&]
+	{
+		for (uint32_t sequence = 0; sequence < eventCount; sequence++)
+		{
+			if (rate > 0.0)
+			{
+				auto due = start + std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(sequence / rate));
+				while (Clock::now() < due)
+				{
+					std::this_thread::yield();
+				}
+			}
+
+			DX::InputEvent inputEvent = { DX::InputEventType::PointerMoved, sequence, static_cast<float>(sequence), 0.0f, GetMicroseconds(start) };
+			queue->Push(inputEvent);
+		}
+		producing.store(false, std::memory_order_release);
+	});
+
+	std::vector<uint32_t> latencies;
+	latencies.reserve(eventCount);
+	uint64_t drained = 0;
+	uint64_t outOfOrder = 0;
+	uint64_t drains = 0;
+	size_t largestDrain = 0;
+	int64_t previous = -1;
+
+	for (;;)
+	{
+		bool done = !producing.load(std::memory_order_acquire);
+		uint64_t now = GetMicroseconds(start);
+		size_t count = queue->Drain([&](const DX::InputEvent& inputEvent)
+		{
+			outOfOrder += (static_cast<int64_t>(inputEvent.pointerId) <= previous) ? 1 : 0;
+			previous = inputEvent.pointerId;
+			latencies.push_back(static_cast<uint32_t>(now - (std::min)(now, inputEvent.timestamp)));
+		});
+		drained += count;
+		drains++;
+		largestDrain = (std::max)(largestDrain, count);
+
+		// The producer finished before this drain, so it drained everything.
+		if (done)
+		{
+			break;
+		}
+		if (frameMicroseconds > 0)
+		{
+			std::this_thread::sleep_for(std::chrono::microseconds(frameMicroseconds));
+		}
+	}
+	producer.join();
+
+	double seconds = std::chrono::duration<double>(Clock::now() - start).count();
+	uint64_t dropped = queue->GetDroppedEventCount();
+	std::sort(latencies.begin(), latencies.end());
+	auto percentile = [&latencies](double fraction)
+	{
+		return latencies.empty() ? 0u : latencies[static_cast<size_t>(fraction * (latencies.size() - 1))];
+	};
+
+	double droppedPercent = 100.0 * dropped / eventCount;
+
+	printf("%u samples in %.3f s, %.0f a second\n", eventCount, seconds, eventCount / seconds);
+	printf("drained %llu in %llu drains, at most %zu at once\n",
+		static_cast<unsigned long long>(drained), static_cast<unsigned long long>(drains), largestDrain);
+	printf("latency us: median %u, 99th percentile %u, 99.9th %u, largest %u; dropped %llu, %.2f%%\n\n",
+		percentile(0.5), percentile(0.99), percentile(0.999), percentile(1.0), static_cast<unsigned long long>(dropped), droppedPercent);
+
+	Expect(drained + dropped == eventCount && outOfOrder == 0, "every sample arrives once and in order, or is dropped");
+	if (!stress)
+	{
+		Expect(dropped <= eventCount * MaxDroppedFraction, "samples dropped at a steady rate", "%.2f%%", droppedPercent);
+	}
+
+	return ReportChecks();
+}
@@ -0,0 +1,323 @@
+﻿// Checks the CPU reference of the culling compute shader in InstanceCulling.h: the planes
+// ExtractFrustumPlanes finds for known matrices, the sphere test at each plane, and, for the
+// sample's own camera in every display rotation, that no sphere reaching into the view volume
+// is ever culled.
+//
+// Usage: InstanceCullingTest [--spheres <count>]
+//
+//   --spheres <count>				Random spheres tested against the sample's camera in each
+//									rotation. The default is 20000.
+//
+// Matrices are built the way DirectXMath builds them: row-major, transforming row vectors,
+// right-handed, with clip space depth from 0 to w. Build it with:
+//
+//   g++ -std=c++17 -O2 InstanceCullingTest.cpp -o InstanceCullingTest
+
+#include <cmath>
+#include <cstddef>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <string>
+#include <vector>
+#include "../Common/DisplayMetrics.h"
+#include "../Common/InstanceCulling.h"
+#include "Check.h"
+
+struct Matrix
+{
+	float m[4][4];
+};
+
+static Matrix Identity()
+{
+	Matrix result = {};
+	for (int i = 0; i < 4; i++)
+	{
+		result.m[i][i] = 1.0f;
+	}
+	return result;
+}
+
+static Matrix Multiply(const Matrix& a, const Matrix& b)
+{
+	Matrix result = {};
+	for (int row = 0; row < 4; row++)
+	{
+		for (int column = 0; column < 4; column++)
+		{
+			for (int k = 0; k < 4; k++)
+			{
+				result.m[row][column] += a.m[row][k] * b.m[k][column];
+			}
+		}
+	}
+	return result;
+}
+
+// XMMatrixPerspectiveFovRH.
+static Matrix PerspectiveFovRH(float fovAngleY, float aspectRatio, float nearZ, float farZ)
+{
+	float height = 1.0f / std::tan(fovAngleY * 0.5f);
+	float range = farZ / (nearZ - farZ);
+	Matrix result = {};
+	result.m[0][0] = height / aspectRatio;
+	result.m[1][1] = height;
+	result.m[2][2] = range;
+	result.m[2][3] = -1.0f;
+	result.m[3][2] = range * nearZ;
+	return result;
+}
+
+// XMMatrixLookAtRH.
+static Matrix LookAtRH(const float (&eye)[3], const float (&at)[3], const float (&up)[3])
+{
+	auto normalize = [](float (&v)[3])
+	{
+		float length = std::sqrt(v[0] * v[0] + v[1] * v[1] + v[2] * v[2]);
+		for (float& value : v)
+		{
+			value /= length;
+		}
+	};
+	auto cross = [](const float (&a)[3], const float (&b)[3], float (&result)[3])
+	{
+		result[0] = a[1] * b[2] - a[2] * b[1];
+		result[1] = a[2] * b[0] - a[0] * b[2];
+		result[2] = a[0] * b[1] - a[1] * b[0];
+	};
+	auto dot = [](const float (&a)[3], const float (&b)[3]) { return a[0] * b[0] + a[1] * b[1] + a[2] * b[2]; };
+
+	float zAxis[3] = { eye[0] - at[0], eye[1] - at[1], eye[2] - at[2] };
+	normalize(zAxis);
+	float xAxis[3];
+	cross(up, zAxis, xAxis);
+	normalize(xAxis);
+	float yAxis[3];
+	cross(zAxis, xAxis, yAxis);
+
+	Matrix result = Identity();
+	for (int i = 0; i < 3; i++)
+	{
+		result.m[i][0] = xAxis[i];
+		result.m[i][1] = yAxis[i];
+		result.m[i][2] = zAxis[i];
+	}
+	result.m[3][0] = -dot(xAxis, eye);
+	result.m[3][1] = -dot(yAxis, eye);
+	result.m[3][2] = -dot(zAxis, eye);
+	return result;
+}
+
+static Matrix OrientationTransform(DX::DisplayRotation rotation)
+{
+	Matrix result;
+	const float* values = DX::DisplayMetricsDetail::Transforms3D[static_cast<uint32_t>(rotation)];
+	for (int i = 0; i < 16; i++)
+	{
+		result.m[i / 4][i % 4] = values[i];
+	}
+	return result;
+}
+
+// True if the point is inside the clip volume of the matrix.
+static bool IsPointInside(const Matrix& matrix, float x, float y, float z)
+{
+	float clip[4];
+	for (int column = 0; column < 4; column++)
+	{
+		clip[column] = x * matrix.m[0][column] + y * matrix.m[1][column] + z * matrix.m[2][column] + matrix.m[3][column];
+	}
+	float w = clip[3];
+	return w > 0.0f && std::fabs(clip[0]) <= w && std::fabs(clip[1]) <= w && clip[2] >= 0.0f && clip[2] <= w;
+}
+
+// True if any of a dense set of points within the sphere is inside the clip volume: a brute
+// force answer to whether the sphere is really visible.
+static bool IsSphereReallyVisible(const Matrix& matrix, const DX::InstanceBounds& bounds)
+{
+	const int steps = 8;
+	for (int x = -steps; x <= steps; x++)
+	{
+		for (int y = -steps; y <= steps; y++)
+		{
+			for (int z = -steps; z <= steps; z++)
+			{
+				float dx = static_cast<float>(x) / steps;
+				float dy = static_cast<float>(y) / steps;
+				float dz = static_cast<float>(z) / steps;
+				if (dx * dx + dy * dy + dz * dz <= 1.0f &&
+					IsPointInside(matrix, bounds.centerX + dx * bounds.radius, bounds.centerY + dy * bounds.radius, bounds.centerZ + dz * bounds.radius))
+				{
+					return true;
+				}
+			}
+		}
+	}
+	return false;
+}
+
+static bool PlaneMatches(const float (&plane)[4], float a, float b, float c, float d)
+{
+	const float tolerance = 1e-5f;
+	return std::fabs(plane[0] - a) < tolerance && std::fabs(plane[1] - b) < tolerance && std::fabs(plane[2] - c) < tolerance && std::fabs(plane[3] - d) < tolerance;
+}
+
+static void CheckPlanes()
+{
+	// The identity's frustum is the clip volume itself.
+	DX::FrustumPlanes frustum = DX::ExtractFrustumPlanes(Identity().m);
+	Expect(PlaneMatches(frustum.planes[0], 1, 0, 0, 1) && PlaneMatches(frustum.planes[1], -1, 0, 0, 1) &&
+		PlaneMatches(frustum.planes[2], 0, 1, 0, 1) && PlaneMatches(frustum.planes[3], 0, -1, 0, 1) &&
+		PlaneMatches(frustum.planes[4], 0, 0, 1, 0) && PlaneMatches(frustum.planes[5], 0, 0, -1, 1),
+		"identity: the planes of the clip volume, x and y from -1 to 1, z from 0 to 1");
+
+	// Scaling the matrix by two halves the volume; normalized planes keep unit normals.
+	Matrix scale = Identity();
+	scale.m[0][0] = scale.m[1][1] = scale.m[2][2] = 2.0f;
+	frustum = DX::ExtractFrustumPlanes(scale.m);
+	Expect(PlaneMatches(frustum.planes[0], 1, 0, 0, 0.5f) && PlaneMatches(frustum.planes[3], 0, -1, 0, 0.5f) && PlaneMatches(frustum.planes[5], 0, 0, -1, 0.5f),
+		"scale by 2: unit normals, distances halved");
+
+	// A 90 degree square perspective looking down -z, from 1 to 10: the side planes pass
+	// through the eye at 45 degrees.
+	const float Pi = 3.14159265358979f;
+	const float s = 1.0f / std::sqrt(2.0f);
+	frustum = DX::ExtractFrustumPlanes(PerspectiveFovRH(Pi / 2, 1.0f, 1.0f, 10.0f).m);
+	Expect(PlaneMatches(frustum.planes[0], s, 0, -s, 0) && PlaneMatches(frustum.planes[1], -s, 0, -s, 0) &&
+		PlaneMatches(frustum.planes[2], 0, s, -s, 0) && PlaneMatches(frustum.planes[3], 0, -s, -s, 0),
+		"perspective: side planes at 45 degrees through the eye");
+	Expect(PlaneMatches(frustum.planes[4], 0, 0, -1, -1) && PlaneMatches(frustum.planes[5], 0, 0, 1, 10),
+		"perspective: near plane at z = -1 and far plane at z = -10");
+
+	// Moving the camera moves the planes with it.
+	float eye[3] = { 0, 0, 5 };
+	float at[3] = { 0, 0, 0 };
+	float up[3] = { 0, 1, 0 };
+	frustum = DX::ExtractFrustumPlanes(Multiply(LookAtRH(eye, at, up), PerspectiveFovRH(Pi / 2, 1.0f, 1.0f, 10.0f)).m);
+	Expect(PlaneMatches(frustum.planes[4], 0, 0, -1, 4) && PlaneMatches(frustum.planes[5], 0, 0, 1, 5) && PlaneMatches(frustum.planes[0], s, 0, -s, 5 * s),
+		"view and projection: planes follow the camera at z = 5");
+}
+
+static void CheckSpheres()
+{
+	const float Pi = 3.14159265358979f;
+	DX::FrustumPlanes frustum = DX::ExtractFrustumPlanes(PerspectiveFovRH(Pi / 2, 1.0f, 1.0f, 10.0f).m);
+
+	struct Case
+	{
+		const char*			description;
+		DX::InstanceBounds	bounds;
+		bool				visible;
+	};
+	const Case cases[] =
+	{
+		{ "inside",										{ 0.0f, 0.0f, -5.0f, 0.1f }, true },
+		{ "behind the eye",								{ 0.0f, 0.0f, 5.0f, 1.0f }, false },
+		{ "0.5 before the near plane, radius 0.4",		{ 0.0f, 0.0f, -0.5f, 0.4f }, false },
+		{ "0.5 before the near plane, radius 0.6",		{ 0.0f, 0.0f, -0.5f, 0.6f }, true },
+		{ "0.5 past the far plane, radius 0.4",			{ 0.0f, 0.0f, -10.5f, 0.4f }, false },
+		{ "0.5 past the far plane, radius 0.6",			{ 0.0f, 0.0f, -10.5f, 0.6f }, true },
+		{ "0.71 left of the left plane, radius 0.70",	{ -6.0f, 0.0f, -5.0f, 0.70f }, false },
+		{ "0.71 left of the left plane, radius 0.72",	{ -6.0f, 0.0f, -5.0f, 0.72f }, true },
+		{ "0.71 above the top plane, radius 0.70",		{ 0.0f, 6.0f, -5.0f, 0.70f }, false },
+		{ "0.71 above the top plane, radius 0.72",		{ 0.0f, 6.0f, -5.0f, 0.72f }, true },
+		{ "enclosing the whole frustum",				{ 0.0f, 0.0f, -5.0f, 20.0f }, true },
+	};
+
+	std::vector<DX::InstanceBounds> instances;
+	std::vector<uint32_t> expected;
+	for (const Case& test : cases)
+	{
+		char description[160];
+		snprintf(description, sizeof(description), "sphere %s is %s", test.description, test.visible ? "visible" : "culled");
+		Expect(DX::IsSphereVisible(frustum, test.bounds) == test.visible, description);
+		if (test.visible)
+		{
+			expected.push_back(static_cast<uint32_t>(instances.size()));
+		}
+		instances.push_back(test.bounds);
+	}
+
+	// Near a corner the sphere is outside both planes by less than its radius, so it is kept,
+	// though it misses the frustum: 0.42 from each side plane but 0.49 from their edge.
+	DX::InstanceBounds corner = { 5.6f, 5.6f, -5.0f, 0.45f };
+	Matrix projection = PerspectiveFovRH(Pi / 2, 1.0f, 1.0f, 10.0f);
+	Expect(DX::IsSphereVisible(frustum, corner) && !IsSphereReallyVisible(projection, corner), "a sphere just off a corner is kept, conservatively");
+
+	// CullInstances returns the visible ones, in order.
+	std::vector<uint32_t> visible(instances.size());
+	uint32_t count = DX::CullInstances(frustum, instances.data(), static_cast<uint32_t>(instances.size()), visible.data());
+	visible.resize(count);
+	Expect(visible == expected, "CullInstances lists the visible instances in order");
+
+	Expect(offsetof(DX::DrawIndexedIndirectArgs, instanceCount) == DX::DrawArgsInstanceCountOffset &&
+		DX::MakeDrawArgs(36, 6, -2).instanceCount == 0 && DX::MakeDrawArgs(36, 6, -2).baseVertexLocation == -2,
+		"draw arguments start with no instances, at the offset the shader increments");
+}
+
+// The sample's camera, as Sample3DSceneRenderer::CreateWindowSizeDependentResources builds it,
+// in each rotation. No sphere that reaches into the view may be culled.
+static void CheckSampleCamera(uint32_t sphereCount)
+{
+	const float Pi = 3.14159265358979f;
+	float eye[3] = { 0.0f, 0.7f, 1.5f };
+	float at[3] = { 0.0f, -0.1f, 0.0f };
+	float up[3] = { 0.0f, 1.0f, 0.0f };
+	Matrix viewProjection = Multiply(LookAtRH(eye, at, up), PerspectiveFovRH(70.0f * Pi / 180.0f, 16.0f / 9.0f, 0.01f, 100.0f));
+
+	const DX::DisplayRotation rotations[] = { DX::DisplayRotation::Identity, DX::DisplayRotation::Rotate90, DX::DisplayRotation::Rotate180, DX::DisplayRotation::Rotate270 };
+	for (DX::DisplayRotation rotation : rotations)
+	{
+		uint32_t degrees = (static_cast<uint32_t>(rotation) - 1) * 90;
+		Matrix matrix = Multiply(viewProjection, OrientationTransform(rotation));
+		DX::FrustumPlanes frustum = DX::ExtractFrustumPlanes(matrix.m);
+
+		std::mt19937 random(static_cast<uint32_t>(rotation));
+		std::uniform_real_distribution<float> position(-4.0f, 4.0f);
+		std::uniform_real_distribution<float> radius(0.01f, 0.5f);
+		uint32_t culledButVisible = 0;
+		uint32_t keptButHidden = 0;
+		uint32_t visible = 0;
+		for (uint32_t i = 0; i < sphereCount; i++)
+		{
+			DX::InstanceBounds bounds = { position(random), position(random), position(random), radius(random) };
+			bool kept = DX::IsSphereVisible(frustum, bounds);
+			bool reallyVisible = IsSphereReallyVisible(matrix, bounds);
+			culledButVisible += (!kept && reallyVisible) ? 1 : 0;
+			keptButHidden += (kept && !reallyVisible) ? 1 : 0;
+			visible += reallyVisible ? 1 : 0;
+		}
+
+		char description[160];
+		snprintf(description, sizeof(description), "sample camera rotated %3u degrees: %u of %u visible, none culled, %u kept conservatively",
+			degrees, visible, sphereCount, keptButHidden);
+		Expect(culledButVisible == 0 && visible > 0 && visible < sphereCount, description);
+	}
+}
+
+int main(int argc, char** argv)
+{
+	uint32_t sphereCount = 20000;
+
+	for (int i = 1; i < argc; i++)
+	{
+		std::string argument = argv[i];
+		if (argument == "--spheres" && i + 1 < argc)
+		{
+			sphereCount = static_cast<uint32_t>(strtoul(argv[++i], nullptr, 10));
+		}
+		else
+		{
+			fprintf(stderr, "%s: unknown option\n", argument.c_str());
+			fprintf(stderr, "Usage: %s [--spheres <count>]\n", argv[0]);
+			return 1;
+		}
+	}
+
+	CheckPlanes();
+	CheckSpheres();
+	CheckSampleCamera(sphereCount);
+
+	return ReportChecks();
+}
@@ -0,0 +1,328 @@
+﻿// Checks DX::LifecycleScheduler the way the app drives it: the state each series of window
+// events leads to, how often the render loop and the streaming worker run in each state, that
+// stopping one worker before starting the other never lets them overlap, and that a change
+// returns without waiting for either.
+//
+// Usage: LifecycleBenchmark [options]
+//
+//   --duration <ms>				How long to hold each state while counting iterations. The
+//									default is 1000.
+//   --frame <ms>					How long a simulated frame takes, standing in for the wait
+//									for vsync. The default is 16.
+//
+// The workers run on threads of their own with the app's intervals: the occluded render loop
+// updates ten times a second and the hidden streaming worker four times. Build it with:
+//
+//   g++ -std=c++17 -O2 -pthread LifecycleBenchmark.cpp -o LifecycleBenchmark
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include "../Common/LifecycleScheduler.h"
+#include "Check.h"
+
+using DX::LifecycleScheduler;
+using DX::LifecycleState;
+using DX::LifecycleWorker;
+
+static const char* GetStateName(LifecycleState state)
+{
+	switch (state)
+	{
+	case LifecycleState::Foreground:	return "foreground";
+	case LifecycleState::Occluded:		return "occluded";
+	case LifecycleState::Hidden:		return "hidden";
+	case LifecycleState::Suspended:		return "suspended";
+	}
+	return "?";
+}
+
+// A window event, as MainPage, App and the render loop report them.
+enum class Event
+{
+	Show,
+	Hide,
+	Occlude,
+	Uncover,
+	Suspend,
+	Resume,
+};
+
+static void Apply(LifecycleScheduler& scheduler, Event event)
+{
+	switch (event)
+	{
+	case Event::Show:		scheduler.SetVisible(true); break;
+	case Event::Hide:		scheduler.SetVisible(false); break;
+	case Event::Occlude:	scheduler.SetOccluded(true); break;
+	case Event::Uncover:	scheduler.SetOccluded(false); break;
+	case Event::Suspend:	scheduler.Suspend(); break;
+	case Event::Resume:		scheduler.Resume(); break;
+	}
+}
+
+struct Transition
+{
+	const char*		description;
+	Event			event;
+	LifecycleState	expected;
+};
+
+// Runs the events in order on one scheduler, checking the state after each.
+static void CheckTransitions()
+{
+	static const Transition transitions[] =
+	{
+		{ "covered window is occluded",				Event::Occlude, LifecycleState::Occluded },
+		{ "uncovered window is in the foreground",	Event::Uncover, LifecycleState::Foreground },
+		{ "occluded window can be hidden",			Event::Occlude, LifecycleState::Occluded },
+		{ "",										Event::Hide,	LifecycleState::Hidden },
+		{ "late occlusion doesn't show a hidden one", Event::Occlude, LifecycleState::Hidden },
+		{ "shown window starts uncovered",			Event::Show,	LifecycleState::Foreground },
+		{ "hidden window can be suspended",			Event::Hide,	LifecycleState::Hidden },
+		{ "",										Event::Suspend, LifecycleState::Suspended },
+		{ "showing a suspended one does nothing",	Event::Show,	LifecycleState::Suspended },
+		{ "resumed window is in the foreground",	Event::Resume,	LifecycleState::Foreground },
+		{ "occluded window can be suspended",		Event::Occlude, LifecycleState::Occluded },
+		{ "",										Event::Suspend, LifecycleState::Suspended },
+		{ "resumed window starts uncovered",		Event::Resume,	LifecycleState::Foreground },
+	};
+
+	LifecycleScheduler scheduler;
+	uint64_t changes = 0;
+	LifecycleState previous = scheduler.GetState();
+	for (const Transition& transition : transitions)
+	{
+		Apply(scheduler, transition.event);
+		LifecycleState state = scheduler.GetState();
+		changes += (state != previous) ? 1 : 0;
+		previous = state;
+
+		bool ok = (state == transition.expected);
+		if (transition.description[0] != '\0' || !ok)
+		{
+			Expect(ok, transition.description, "%s", GetStateName(state));
+		}
+		else
+		{
+			RecordCheck(ok);
+		}
+	}
+
+	Expect(scheduler.GetTransitionCount() == changes, "every change is counted once", "%llu", static_cast<unsigned long long>(changes));
+}
+
+// Starts and stops the workers as the app's main class does, with threads in place of the
+// thread pool: Apply changes the state and returns, and a transition thread of its own joins
+// and starts the workers, one transition at a time. Each iteration marks the simulated device
+// context as in use while it runs.
+class SimulatedApp
+{
+public:
+	explicit SimulatedApp(std::chrono::milliseconds frame) :
+		m_frame(frame),
+		m_contextUsers(0),
+		m_overlaps(0),
+		m_longestJoin(0.0),
+		m_longestApply(0.0)
+	{
+	}
+
+	~SimulatedApp()
+	{
+		m_scheduler.Suspend();
+		UpdateWorkersAsync();
+		for (std::thread& thread : m_transitions)
+		{
+			thread.join();
+		}
+		for (std::thread& thread : m_threads)
+		{
+			thread.join();
+		}
+	}
+
+	void Apply(Event event)
+	{
+		auto start = std::chrono::steady_clock::now();
+		::Apply(m_scheduler, event);
+		UpdateWorkersAsync();
+		m_longestApply = (std::max)(m_longestApply, std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count());
+	}
+
+	// Waits for the transitions Apply started.
+	void Settle()
+	{
+		for (std::thread& thread : m_transitions)
+		{
+			thread.join();
+		}
+		m_transitions.clear();
+	}
+
+	LifecycleScheduler& GetScheduler() { return m_scheduler; }
+	uint32_t GetOverlaps() const { return m_overlaps; }
+	double GetLongestJoin() const { return m_longestJoin; }
+	double GetLongestApply() const { return m_longestApply; }
+
+private:
+	void UpdateWorkersAsync()
+	{
+		m_transitions.emplace_back([this] { UpdateWorkers(); });
+	}
+
+	void UpdateWorkers()
+	{
+		std::lock_guard<std::mutex> lock(m_workerMutex);
+
+		auto start = std::chrono::steady_clock::now();
+		m_scheduler.WaitForWorkers();
+		m_longestJoin = (std::max)(m_longestJoin, std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count());
+
+		for (LifecycleWorker worker : { LifecycleWorker::Render, LifecycleWorker::Streaming })
+		{
+			if (m_scheduler.BeginWorker(worker))
+			{
+				m_threads.emplace_back([this, worker] { Run(worker); });
+			}
+		}
+	}
+
+	void Run(LifecycleWorker worker)
+	{
+		DX::LifecycleWorkerScope scope(m_scheduler, worker);
+		while (m_scheduler.WaitForTick(worker))
+		{
+			if (m_contextUsers.fetch_add(1) != 0)
+			{
+				m_overlaps++;
+			}
+
+			// A render loop iteration lasts until vsync; an upload is much shorter.
+			std::this_thread::sleep_for(worker == LifecycleWorker::Render ? m_frame : m_frame / 4);
+			m_contextUsers.fetch_sub(1);
+		}
+	}
+
+	std::chrono::milliseconds	m_frame;
+	LifecycleScheduler			m_scheduler;
+
+	// Transitions are started by the caller of Apply, and workers by the transitions, under
+	// m_workerMutex.
+	std::vector<std::thread>	m_transitions;
+	std::mutex					m_workerMutex;
+	std::vector<std::thread>	m_threads;
+
+	std::atomic<uint32_t>		m_contextUsers;
+	std::atomic<uint32_t>		m_overlaps;
+	double						m_longestJoin;
+	double						m_longestApply;
+};
+
+struct Phase
+{
+	Event			event;
+	LifecycleState	state;
+	double			renderRate;		// Expected iterations per second.
+	double			streamingRate;
+};
+
+// Holds each state for the duration and compares the iterations of each worker with the rate
+// the state allows. Rates may fall short by a fifth, since the threads sleep longer than asked,
+// and a phase may count one iteration more or less, depending on where the intervals fall.
+static void CheckThrottling(std::chrono::milliseconds duration, std::chrono::milliseconds frame)
+{
+	const double frameRate = 1000.0 / frame.count();
+	const Phase phases[] =
+	{
+		{ Event::Show,		LifecycleState::Foreground,	frameRate,	0.0 },
+		{ Event::Occlude,	LifecycleState::Occluded,	10.0,		0.0 },
+		{ Event::Hide,		LifecycleState::Hidden,		0.0,		4.0 },
+		{ Event::Show,		LifecycleState::Foreground,	frameRate,	0.0 },
+		{ Event::Hide,		LifecycleState::Hidden,		0.0,		4.0 },
+		{ Event::Suspend,	LifecycleState::Suspended,	0.0,		0.0 },
+		{ Event::Resume,	LifecycleState::Hidden,		0.0,		4.0 },
+		{ Event::Show,		LifecycleState::Foreground,	frameRate,	0.0 },
+	};
+
+	SimulatedApp app(frame);
+	LifecycleScheduler& scheduler = app.GetScheduler();
+	double seconds = duration.count() / 1000.0;
+
+	printf("\n%-12s %14s %14s %14s %14s\n", "State", "Render/s", "Expected", "Streaming/s", "Expected");
+	for (const Phase& phase : phases)
+	{
+		app.Apply(phase.event);
+		uint64_t render = scheduler.GetTickCount(LifecycleWorker::Render);
+		uint64_t streaming = scheduler.GetTickCount(LifecycleWorker::Streaming);
+		std::this_thread::sleep_for(duration);
+		double renderRate = (scheduler.GetTickCount(LifecycleWorker::Render) - render) / seconds;
+		double streamingRate = (scheduler.GetTickCount(LifecycleWorker::Streaming) - streaming) / seconds;
+
+		auto isExpected = [seconds](double rate, double expected)
+		{
+			return rate >= expected * 0.8 - 1.0 / seconds - 0.001 && rate <= expected + 1.0 / seconds + 0.001;
+		};
+		bool ok = scheduler.GetState() == phase.state && isExpected(renderRate, phase.renderRate) && isExpected(streamingRate, phase.streamingRate);
+		RecordCheck(ok);
+		printf("%-12s %14.1f %14.1f %14.1f %14.1f %s\n", GetStateName(scheduler.GetState()),
+			renderRate, phase.renderRate, streamingRate, phase.streamingRate, ok ? "" : " FAILED");
+	}
+
+	// Showing and hiding the window faster than a worker can stop, as when switching apps
+	// quickly, lets transitions overtake each other. Whichever runs last must leave the workers
+	// the latest state runs.
+	for (int i = 0; i < 50; i++)
+	{
+		app.Apply(i % 2 == 0 ? Event::Hide : Event::Show);
+	}
+	app.Apply(Event::Hide);
+	app.Settle();
+	uint64_t render = scheduler.GetTickCount(LifecycleWorker::Render);
+	uint64_t streaming = scheduler.GetTickCount(LifecycleWorker::Streaming);
+	std::this_thread::sleep_for(std::chrono::milliseconds(600));
+	bool latest = scheduler.GetState() == LifecycleState::Hidden &&
+		scheduler.GetTickCount(LifecycleWorker::Render) == render && scheduler.GetTickCount(LifecycleWorker::Streaming) > streaming;
+
+	printf("\n");
+	Expect(latest, "a burst of changes ends in the latest state", "%s", GetStateName(scheduler.GetState()));
+	Expect(app.GetOverlaps() == 0, "workers never overlap", "%u", app.GetOverlaps());
+	Expect(app.GetLongestJoin() <= frame.count() * 2.0 + 5.0, "longest wait for a stopped worker", "%.2f ms", app.GetLongestJoin());
+	Expect(app.GetLongestApply() <= frame.count() * 0.5, "longest a change held up its caller", "%.2f ms", app.GetLongestApply());
+}
+
+int main(int argc, char** argv)
+{
+	std::chrono::milliseconds duration(1000);
+	std::chrono::milliseconds frame(16);
+
+	for (int i = 1; i < argc; i++)
+	{
+		std::string argument = argv[i];
+		if (argument == "--duration" && i + 1 < argc)
+		{
+			duration = std::chrono::milliseconds((std::max)(strtol(argv[++i], nullptr, 10), 100l));
+		}
+		else if (argument == "--frame" && i + 1 < argc)
+		{
+			frame = std::chrono::milliseconds((std::max)(strtol(argv[++i], nullptr, 10), 1l));
+		}
+		else
+		{
+			fprintf(stderr, "%s: unknown option\n", argument.c_str());
+			fprintf(stderr, "Usage: %s [--duration <ms>] [--frame <ms>]\n", argv[0]);
+			return 1;
+		}
+	}
+
+	CheckTransitions();
+	CheckThrottling(duration, frame);
+
+	return ReportChecks();
+}
@@ -0,0 +1,368 @@
+﻿// Runs DX::ParallelCommandRecorder on a mock backend that records packet numbers instead of
+// draw calls, to check that the submitted stream is the one recording on a single thread would
+// give and that each worker records exactly its range, and to time recording with 1, 2, 4...
+// workers.
+//
+// Usage: ParallelRecorderBenchmark [options]
+//
+//   --packets <count>				Packets in each timed frame. The default is 20000.
+//   --workers <count>				Most workers to time. The default is one per hardware thread,
+//									at least 4.
+//   --work <iterations>			Work done to record each packet, standing in for setting its
+//									constants and issuing its draw. The default is 200.
+//   --frames <count>				Frames to time with each worker count. The default is 100.
+//
+// Workers run on threads of their own, started by the mock's ParallelFor, where the app uses
+// the PPL's. Build it with:
+//
+//   g++ -std=c++17 -O2 -pthread ParallelRecorderBenchmark.cpp -o ParallelRecorderBenchmark
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <thread>
+#include <vector>
+#include "../Common/ParallelCommandRecorder.h"
+#include "Check.h"
+
+using Clock = std::chrono::steady_clock;
+
+// What a mock context recorded: the state binding, or a packet and the context it went into.
+struct MockCommand
+{
+	static const uint32_t Bind = UINT32_MAX;
+
+	uint32_t	packet;
+	uint32_t	context;
+};
+
+const uint32_t ImmediateContext = UINT32_MAX;
+
+struct MockContext
+{
+	uint32_t					index = 0;
+	bool						recording = false;
+	uint32_t					checksum = 0;		// Of the benchmark's work, so it isn't optimized away.
+	std::vector<MockCommand>	commands;
+};
+
+// Implements the interface ParallelCommandRecorder documents. Packets recorded on the immediate
+// context go straight to the submitted stream; those recorded on a worker context go there
+// when its command list is executed.
+class MockBackend
+{
+public:
+	using Context = MockContext;
+	using CommandList = std::vector<MockCommand>;
+
+	explicit MockBackend(size_t workerCount) :
+		m_workers(workerCount),
+		m_inParallelRecording(false),
+		m_protocolErrors(0),
+		m_parallelForCount(0)
+	{
+		m_immediate.index = ImmediateContext;
+		for (size_t worker = 0; worker < workerCount; worker++)
+		{
+			m_workers[worker].index = static_cast<uint32_t>(worker);
+		}
+	}
+
+	size_t GetWorkerCount() const				{ return m_workers.size(); }
+	Context& GetImmediateContext()				{ return m_immediate; }
+	Context& GetWorkerContext(size_t worker)	{ return m_workers[worker]; }
+
+	void BeginParallelRecording()
+	{
+		m_protocolErrors += (m_inParallelRecording || std::this_thread::get_id() != m_submittingThread) ? 1 : 0;
+		m_inParallelRecording = true;
+	}
+
+	void EndParallelRecording()
+	{
+		m_protocolErrors += (!m_inParallelRecording || std::this_thread::get_id() != m_submittingThread) ? 1 : 0;
+		m_inParallelRecording = false;
+	}
+
+	void BeginRecording(Context& context)
+	{
+		m_protocolErrors += (!m_inParallelRecording || context.recording) ? 1 : 0;
+		context.recording = true;
+		context.commands.clear();
+	}
+
+	CommandList FinishRecording(Context& context)
+	{
+		m_protocolErrors += context.recording ? 0 : 1;
+		context.recording = false;
+		CommandList commandList;
+		commandList.swap(context.commands);
+		return commandList;
+	}
+
+	// Command lists must be executed on the submitting thread, while the parallel recording
+	// is still open.
+	void Execute(CommandList& commandList)
+	{
+		m_protocolErrors += (!m_inParallelRecording || std::this_thread::get_id() != m_submittingThread) ? 1 : 0;
+		m_submitted.insert(m_submitted.end(), commandList.begin(), commandList.end());
+	}
+
+	template<typename TFunc>
+	void ParallelFor(size_t count, const TFunc& func)
+	{
+		m_parallelForCount++;
+		std::vector<std::thread> threads;
+		for (size_t i = 1; i < count; i++)
+		{
+			threads.emplace_back([&func, i] { func(i); });
+		}
+		func(0);
+		for (std::thread& thread : threads)
+		{
+			thread.join();
+		}
+	}
+
+	// Called by the test before each frame.
+	void BeginFrame()
+	{
+		m_submittingThread = std::this_thread::get_id();
+		m_submitted.clear();
+		m_immediate.commands.clear();
+		m_parallelForCount = 0;
+	}
+
+	// The whole stream the GPU would see: direct recording on the immediate context, or the
+	// executed command lists.
+	const std::vector<MockCommand>& GetSubmitted()
+	{
+		if (!m_immediate.commands.empty())
+		{
+			m_submitted.insert(m_submitted.end(), m_immediate.commands.begin(), m_immediate.commands.end());
+			m_immediate.commands.clear();
+		}
+		return m_submitted;
+	}
+
+	uint32_t GetProtocolErrors() const { return m_protocolErrors.load(); }
+	uint32_t GetParallelForCount() const { return m_parallelForCount; }
+
+private:
+	MockContext					m_immediate;
+	std::vector<MockContext>	m_workers;
+	std::vector<MockCommand>	m_submitted;
+	std::thread::id				m_submittingThread;
+	bool						m_inParallelRecording;
+	std::atomic<uint32_t>		m_protocolErrors;		// Counted on the workers too.
+	uint32_t					m_parallelForCount;
+};
+
+// Stands in for the per-packet work of a real renderer.
+static uint32_t DoWork(uint32_t packet, uint32_t iterations)
+{
+	uint32_t value = packet;
+	for (uint32_t i = 0; i < iterations; i++)
+	{
+		value = value * 1664525u + 1013904223u;
+	}
+	return value;
+}
+
+static void CheckPartitioning()
+{
+	uint32_t failures = 0;
+	DX::PacketRange ranges[DX::ParallelCommandRecorder<MockBackend>::MaxWorkers];
+	for (size_t packetCount = 0; packetCount <= 1100; packetCount += (packetCount < 100 ? 1 : 37))
+	{
+		for (size_t maxRanges = 0; maxRanges <= 16; maxRanges++)
+		{
+			for (size_t minPackets : { size_t(0), size_t(1), size_t(7), size_t(64), size_t(200) })
+			{
+				size_t count = DX::PartitionPackets(packetCount, maxRanges, minPackets, ranges);
+				size_t expected = (packetCount == 0 || maxRanges == 0) ? 0 :
+					(std::min)(maxRanges, (std::max)(size_t(1), packetCount / (std::max)(size_t(1), minPackets)));
+
+				bool ok = (count == expected);
+				size_t next = 0;
+				size_t smallest = SIZE_MAX;
+				size_t largest = 0;
+				for (size_t i = 0; ok && i < count; i++)
+				{
+					ok = (ranges[i].begin == next && ranges[i].end > ranges[i].begin);
+					next = ranges[i].end;
+					smallest = (std::min)(smallest, ranges[i].Size());
+					largest = (std::max)(largest, ranges[i].Size());
+				}
+
+				// The ranges cover every packet in order, differ in size by at most one, and
+				// hold the minimum unless there is only one.
+				ok = ok && (count == 0 || (next == packetCount && largest - smallest <= 1 && (count == 1 || smallest >= minPackets)));
+				failures += ok ? 0 : 1;
+			}
+		}
+	}
+	Expect(failures == 0, "partitions cover every packet in order, in nearly equal ranges of at least the minimum");
+}
+
+static void CheckRecording()
+{
+	uint32_t orderFailures = 0;
+	uint32_t rangeFailures = 0;
+	uint32_t bindFailures = 0;
+	uint32_t immediateFailures = 0;
+	uint32_t protocolErrors = 0;
+
+	for (size_t workerCount : { size_t(1), size_t(2), size_t(3), size_t(8), size_t(16), size_t(20) })
+	{
+		MockBackend backend(workerCount);
+		DX::ParallelCommandRecorder<MockBackend> recorder(backend, 16);
+
+		for (size_t packetCount : { size_t(0), size_t(1), size_t(15), size_t(16), size_t(33), size_t(100), size_t(257), size_t(5000) })
+		{
+			std::vector<uint32_t> packets(packetCount);
+			for (size_t i = 0; i < packetCount; i++)
+			{
+				packets[i] = static_cast<uint32_t>(i);
+			}
+
+			backend.BeginFrame();
+			size_t used = recorder.Record(packets.data(), packetCount,
+				[](MockContext& context) { context.commands.push_back({ MockCommand::Bind, context.index }); },
+				[](MockContext& context, uint32_t packet) { context.commands.push_back({ packet, context.index }); });
+			const std::vector<MockCommand>& submitted = backend.GetSubmitted();
+
+			// The expected split, capped as the recorder caps the workers.
+			DX::PacketRange ranges[DX::ParallelCommandRecorder<MockBackend>::MaxWorkers];
+			size_t rangeCount = DX::PartitionPackets(packetCount, (std::min)(workerCount, DX::ParallelCommandRecorder<MockBackend>::MaxWorkers), 16, ranges);
+			bool direct = (rangeCount <= 1);
+			immediateFailures += (direct ? (used == 0 && backend.GetParallelForCount() == 0) : (used == rangeCount && backend.GetParallelForCount() == 1)) ? 0 : 1;
+
+			// Every packet once and in order, each context starting with its state bound.
+			uint32_t nextPacket = 0;
+			uint32_t context = 0;
+			bool bound = false;
+			for (const MockCommand& command : submitted)
+			{
+				if (command.packet == MockCommand::Bind)
+				{
+					bindFailures += (bound && command.context == context) ? 1 : 0;
+					context = command.context;
+					bound = true;
+					continue;
+				}
+
+				orderFailures += (command.packet == nextPacket) ? 0 : 1;
+				bindFailures += (bound && command.context == context) ? 0 : 1;
+				nextPacket = command.packet + 1;
+
+				// Each packet went to the context that owns its range.
+				uint32_t owner = ImmediateContext;
+				for (size_t range = 0; !direct && range < rangeCount; range++)
+				{
+					if (command.packet >= ranges[range].begin && command.packet < ranges[range].end)
+					{
+						owner = static_cast<uint32_t>(range);
+					}
+				}
+				rangeFailures += (command.context == owner) ? 0 : 1;
+			}
+			orderFailures += (nextPacket == packetCount && (packetCount > 0 || submitted.empty())) ? 0 : 1;
+		}
+		protocolErrors += backend.GetProtocolErrors();
+	}
+
+	Expect(orderFailures == 0, "the submitted stream holds every packet once and in order");
+	Expect(rangeFailures == 0, "each worker records exactly its range");
+	Expect(bindFailures == 0, "state is bound once at the start of each context");
+	Expect(immediateFailures == 0, "one range records on the immediate context, more use workers");
+	Expect(protocolErrors == 0, "backend calls come in order, on the submitting thread where required");
+}
+
+static void Benchmark(size_t packetCount, size_t maxWorkers, uint32_t work, uint32_t frames)
+{
+	std::vector<uint32_t> packets(packetCount);
+	for (size_t i = 0; i < packetCount; i++)
+	{
+		packets[i] = static_cast<uint32_t>(i);
+	}
+
+	printf("\n%zu packets, %u iterations of work each, on %u hardware threads\n", packetCount, work, std::thread::hardware_concurrency());
+	printf("%-8s %14s %14s %10s\n", "Workers", "ms/frame", "ns/packet", "Speedup");
+
+	uint32_t failures = 0;
+	double baseline = 0.0;
+	for (size_t workers = 1; workers <= maxWorkers; workers *= 2)
+	{
+		MockBackend backend(workers);
+		DX::ParallelCommandRecorder<MockBackend> recorder(backend);
+		uint64_t submitted = 0;
+		uint64_t expected = 0;
+
+		auto start = Clock::now();
+		for (uint32_t frame = 0; frame < frames; frame++)
+		{
+			backend.BeginFrame();
+			size_t used = recorder.Record(packets.data(), packetCount,
+				[](MockContext& context) { context.commands.push_back({ MockCommand::Bind, context.index }); },
+				[work](MockContext& context, uint32_t packet)
+				{
+					context.checksum += DoWork(packet, work);
+					context.commands.push_back({ packet, context.index });
+				});
+			submitted += backend.GetSubmitted().size();
+			expected += packetCount + (std::max)(used, size_t(1));
+		}
+		double seconds = std::chrono::duration<double>(Clock::now() - start).count();
+		double milliseconds = seconds * 1000.0 / frames;
+		baseline = (workers == 1) ? milliseconds : baseline;
+		printf("%-8zu %14.3f %14.1f %9.2fx\n", workers, milliseconds, milliseconds * 1e6 / packetCount, baseline / milliseconds);
+		failures += (submitted == expected) ? 0 : 1;
+	}
+	printf("\n");
+	Expect(failures == 0, "every timed frame submitted every packet");
+}
+
+int main(int argc, char** argv)
+{
+	size_t packetCount = 20000;
+	size_t maxWorkers = (std::max)(static_cast<size_t>(std::thread::hardware_concurrency()), size_t(4));
+	uint32_t work = 200;
+	uint32_t frames = 100;
+
+	for (int i = 1; i < argc; i++)
+	{
+		std::string argument = argv[i];
+		if (argument == "--packets" && i + 1 < argc)
+		{
+			packetCount = (std::max)(static_cast<size_t>(strtoul(argv[++i], nullptr, 10)), size_t(1));
+		}
+		else if (argument == "--workers" && i + 1 < argc)
+		{
+			maxWorkers = (std::max)(static_cast<size_t>(strtoul(argv[++i], nullptr, 10)), size_t(1));
+		}
+		else if (argument == "--work" && i + 1 < argc)
+		{
+			work = static_cast<uint32_t>(strtoul(argv[++i], nullptr, 10));
+		}
+		else if (argument == "--frames" && i + 1 < argc)
+		{
+			frames = (std::max)(static_cast<uint32_t>(strtoul(argv[++i], nullptr, 10)), 1u);
+		}
+		else
+		{
+			fprintf(stderr, "%s: unknown option\n", argument.c_str());
+			fprintf(stderr, "Usage: %s [--packets <count>] [--workers <count>] [--work <iterations>] [--frames <count>]\n", argv[0]);
+			return 1;
+		}
+	}
+
+	CheckPartitioning();
+	CheckRecording();
+	Benchmark(packetCount, maxWorkers, work, frames);
+
+	return ReportChecks();
+}
@@ -0,0 +1,304 @@
+﻿// Checks DX::Profiler's exports and buffers: the Chrome trace is well formed and escapes names,
+// the binary form reads back to the zones that were recorded, the history keeps the newest
+// zones, a full thread buffer drops rather than blocks, and the buffers of exited threads are
+// freed once they are collected.
+//
+// Usage: ProfilerTest
+//
+// Build it with:
+//
+//   g++ -std=c++17 -O2 -pthread ProfilerTest.cpp -o ProfilerTest
+
+#include <cstdio>
+#include <cstring>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+#include "../Common/Profiler.h"
+#include "Check.h"
+
+using DX::Profiler;
+
+// True if the braces and brackets outside strings balance, and every string is closed.
+static bool IsBalanced(const std::string& json)
+{
+	std::vector<char> open;
+	bool inString = false;
+	for (size_t i = 0; i < json.size(); i++)
+	{
+		char c = json[i];
+		if (inString)
+		{
+			if (c == '\\')
+			{
+				i++;
+			}
+			else if (c == '"')
+			{
+				inString = false;
+			}
+		}
+		else if (c == '"')
+		{
+			inString = true;
+		}
+		else if (c == '{' || c == '[')
+		{
+			open.push_back(c == '{' ? '}' : ']');
+		}
+		else if (c == '}' || c == ']')
+		{
+			if (open.empty() || open.back() != c)
+			{
+				return false;
+			}
+			open.pop_back();
+		}
+	}
+	return open.empty() && !inString;
+}
+
+static bool Contains(const std::string& text, const char* part)
+{
+	return text.find(part) != std::string::npos;
+}
+
+static void CheckChromeTrace()
+{
+	Profiler& profiler = Profiler::Get();
+	profiler.Clear();
+	profiler.SetThreadName("Render \"main\" \\ loop");
+	profiler.Record("Frame", 1234567, 2000);
+	profiler.RecordGpu("Clear", 5, 999);
+
+	std::ostringstream stream;
+	profiler.WriteChromeTrace(stream);
+	std::string trace = stream.str();
+
+	Expect(trace.compare(0, 16, "{\"traceEvents\":[") == 0 && trace.size() >= 3 && trace.compare(trace.size() - 3, 3, "]}\n") == 0 && IsBalanced(trace),
+		"trace: a balanced traceEvents array");
+	Expect(Contains(trace, "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":0,\"args\":{\"name\":\"GPU\"}}"), "trace: the GPU timeline is named");
+	Expect(Contains(trace, "\"args\":{\"name\":\"Render \\\"main\\\" \\\\ loop\"}}"), "trace: thread names are escaped");
+	Expect(Contains(trace, "{\"name\":\"Frame\",\"cat\":\"cpu\",\"ph\":\"X\",\"pid\":1,\"tid\":") && Contains(trace, ",\"ts\":1234.567,\"dur\":2.000}"),
+		"trace: CPU zones in microseconds, to the nanosecond");
+	Expect(Contains(trace, "{\"name\":\"Clear\",\"cat\":\"gpu\",\"ph\":\"X\",\"pid\":1,\"tid\":0,\"ts\":0.005,\"dur\":0.999}"),
+		"trace: GPU zones on the GPU timeline");
+}
+
+struct BinaryProfile
+{
+	bool						valid = false;
+	uint32_t					version = 0;
+	std::vector<std::string>	names;
+	std::vector<DX::ProfileEvent> events;		// Names point into the names above.
+};
+
+template<typename T>
+static bool Read(std::istream& stream, T& value)
+{
+	return static_cast<bool>(stream.read(reinterpret_cast<char*>(&value), sizeof(T)));
+}
+
+// Reads the layout documented on Profiler::WriteBinary.
+static BinaryProfile ReadBinary(const std::string& data)
+{
+	BinaryProfile profile;
+	std::istringstream stream(data);
+	char magic[4];
+	uint32_t nameCount = 0;
+	uint32_t eventCount = 0;
+	if (!stream.read(magic, 4) || memcmp(magic, "DXPF", 4) != 0 || !Read(stream, profile.version) || !Read(stream, nameCount) || !Read(stream, eventCount))
+	{
+		return profile;
+	}
+
+	profile.names.resize(nameCount);
+	for (std::string& name : profile.names)
+	{
+		uint16_t length = 0;
+		if (!Read(stream, length))
+		{
+			return profile;
+		}
+		name.resize(length);
+		if (length > 0 && !stream.read(&name[0], length))
+		{
+			return profile;
+		}
+	}
+
+	profile.events.resize(eventCount);
+	for (DX::ProfileEvent& profileEvent : profile.events)
+	{
+		uint32_t nameIndex = 0;
+		if (!Read(stream, nameIndex) || nameIndex >= nameCount || !Read(stream, profileEvent.threadId) ||
+			!Read(stream, profileEvent.startNanoseconds) || !Read(stream, profileEvent.durationNanoseconds))
+		{
+			return profile;
+		}
+		profileEvent.name = profile.names[nameIndex].c_str();
+	}
+
+	// Nothing may follow the last record.
+	profile.valid = (stream.peek() == std::char_traits<char>::eof());
+	return profile;
+}
+
+static BinaryProfile WriteAndRead()
+{
+	std::ostringstream stream;
+	Profiler::Get().WriteBinary(stream);
+	return ReadBinary(stream.str());
+}
+
+static void CheckBinary()
+{
+	static const char* const names[] = { "Update", "Render", "Stream" };
+	const uint32_t threadCount = 3;
+	const uint64_t zonesPerThread = 1000;
+
+	Profiler& profiler = Profiler::Get();
+	profiler.Clear();
+
+	// Each thread records zones with its own name, numbered in the start time.
+	std::vector<std::thread> threads;
+	for (uint32_t thread = 0; thread < threadCount; thread++)
+	{
+		threads.emplace_back([&profiler, thread, zonesPerThread]
+		{
+			for (uint64_t zone = 0; zone < zonesPerThread; zone++)
+			{
+				profiler.Record(names[thread], zone * 10 + thread, zone + 1);
+			}
+		});
+	}
+	for (std::thread& thread : threads)
+	{
+		thread.join();
+	}
+	profiler.RecordGpu(names[1], 7, 3);
+
+	BinaryProfile profile = WriteAndRead();
+	Expect(profile.valid && profile.version == Profiler::BinaryFormatVersion, "binary: the header and every record read back");
+	Expect(profile.names.size() == 3, "binary: each name is stored once");
+	Expect(profile.events.size() == threadCount * zonesPerThread + 1, "binary: every zone is stored");
+
+	// Zones read back with their names, times and threads, and in order within each thread.
+	bool matches = true;
+	uint32_t threadIds[threadCount] = {};
+	uint64_t nextZone[threadCount] = {};
+	for (const DX::ProfileEvent& profileEvent : profile.events)
+	{
+		if (profileEvent.threadId == Profiler::GpuThreadId)
+		{
+			matches = matches && strcmp(profileEvent.name, "Render") == 0 && profileEvent.startNanoseconds == 7 && profileEvent.durationNanoseconds == 3;
+			continue;
+		}
+
+		uint32_t thread = static_cast<uint32_t>(profileEvent.startNanoseconds % 10);
+		if (thread >= threadCount)
+		{
+			matches = false;
+			continue;
+		}
+		threadIds[thread] = threadIds[thread] == 0 ? profileEvent.threadId : threadIds[thread];
+		uint64_t zone = nextZone[thread]++;
+		matches = matches && strcmp(profileEvent.name, names[thread]) == 0 && profileEvent.threadId == threadIds[thread] &&
+			profileEvent.startNanoseconds == zone * 10 + thread && profileEvent.durationNanoseconds == zone + 1;
+	}
+	Expect(matches, "binary: zones keep their names, times and threads, in order");
+	Expect(threadIds[0] != threadIds[1] && threadIds[1] != threadIds[2] && threadIds[0] != threadIds[2], "binary: each thread has its own id");
+}
+
+static void CheckHistory()
+{
+	Profiler& profiler = Profiler::Get();
+	profiler.Clear();
+
+	// Overfill the history, collecting often enough that the thread buffer never fills.
+	const uint64_t total = Profiler::HistoryCapacity + 1000;
+	for (uint64_t zone = 0; zone < total; zone++)
+	{
+		profiler.Record("Zone", zone, 1);
+		if ((zone + 1) % (Profiler::ThreadBufferCapacity / 2) == 0)
+		{
+			profiler.Collect();
+		}
+	}
+
+	BinaryProfile profile = WriteAndRead();
+	bool newest = profile.valid && profile.events.size() == Profiler::HistoryCapacity;
+	for (size_t i = 0; newest && i < profile.events.size(); i++)
+	{
+		newest = (profile.events[i].startNanoseconds == total - Profiler::HistoryCapacity + i);
+	}
+	Expect(newest, "history: keeps the newest zones, oldest first");
+}
+
+static void CheckFullBuffer()
+{
+	Profiler& profiler = Profiler::Get();
+	profiler.Clear();
+	for (uint64_t zone = 0; zone < Profiler::ThreadBufferCapacity + 100; zone++)
+	{
+		profiler.Record("Zone", zone, 1);
+	}
+
+	BinaryProfile profile = WriteAndRead();
+	Expect(profile.valid && profile.events.size() == Profiler::ThreadBufferCapacity && profile.events.back().startNanoseconds == Profiler::ThreadBufferCapacity - 1,
+		"a full thread buffer drops the newest zones");
+}
+
+static void CheckThreadExit()
+{
+	Profiler& profiler = Profiler::Get();
+	profiler.Clear();
+	size_t baseline = profiler.GetThreadBufferCount();
+
+	// Short lived threads, like a thread pool's, each recording a zone just before exiting.
+	const uint32_t threadCount = 200;
+	for (uint32_t batch = 0; batch < threadCount; batch += 8)
+	{
+		std::vector<std::thread> threads;
+		for (uint32_t thread = batch; thread < batch + 8; thread++)
+		{
+			threads.emplace_back([&profiler, thread] { profiler.Record("Work", thread, 1); });
+		}
+		for (std::thread& thread : threads)
+		{
+			thread.join();
+		}
+	}
+
+	size_t exited = profiler.GetThreadBufferCount();
+	BinaryProfile profile = WriteAndRead();
+	size_t collected = profiler.GetThreadBufferCount();
+
+	char description[160];
+	snprintf(description, sizeof(description), "exited threads keep %zu buffers until collected, then %zu", exited - baseline, collected - baseline);
+	Expect(exited == baseline + threadCount && collected == baseline, description);
+	Expect(profile.valid && profile.events.size() == threadCount, "zones recorded just before a thread exits are kept");
+
+	// A thread that is still running keeps its buffer.
+	profiler.Record("Main", 0, 1);
+	profiler.Collect();
+	Expect(profiler.GetThreadBufferCount() == collected, "a running thread keeps its buffer");
+}
+
+int main(int argc, char** argv)
+{
+	if (argc > 1)
+	{
+		fprintf(stderr, "Usage: %s\n", argv[0]);
+		return 1;
+	}
+
+	CheckChromeTrace();
+	CheckBinary();
+	CheckHistory();
+	CheckFullBuffer();
+	CheckThreadExit();
+
+	return ReportChecks();
+}
@@ -0,0 +1,391 @@
+﻿// Checks DX::RangeAllocator, the sub-allocator behind GeometryPool, and times it on random
+// streams of meshes being loaded and unloaded. Every step of the random streams is checked
+// against a brute force model of the space, one flag per element.
+//
+// Usage: RangeAllocatorBenchmark [options]
+//
+//   --capacity <elements>			Size of the space. The default is 196608, the geometry
+//									pool's index buffer.
+//   --operations <count>			Allocations and frees in each timed run. The default is
+//									1000000.
+//   --seed <value>					Seed for the random streams. The default is 1.
+//
+// Build it with:
+//
+//   g++ -std=c++17 -O2 RangeAllocatorBenchmark.cpp -o RangeAllocatorBenchmark
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <string>
+#include <vector>
+#include "../Common/RangeAllocator.h"
+#include "Check.h"
+
+using DX::RangeAllocator;
+using Clock = std::chrono::steady_clock;
+
+static void CheckMerging()
+{
+	// Three neighbours, each freed so that it has a free range on one side, the other or both.
+	RangeAllocator allocator(400);
+	uint32_t a = allocator.Allocate(100);
+	uint32_t b = allocator.Allocate(100);
+	uint32_t c = allocator.Allocate(100);
+	uint32_t d = allocator.Allocate(100);
+	Expect(a == 0 && b == 100 && c == 200 && d == 300 && allocator.GetStats().freeRangeCount == 0, "allocations fill the space in order");
+
+	allocator.Free(b);
+	allocator.Free(d);
+	Expect(allocator.GetStats().freeRangeCount == 2, "freeing between allocations leaves separate ranges");
+
+	allocator.Free(c);
+	RangeAllocator::Stats stats = allocator.GetStats();
+	Expect(stats.freeRangeCount == 1 && stats.largestFreeRange == 300, "freeing between two free ranges merges all three");
+
+	allocator.Free(a);
+	stats = allocator.GetStats();
+	Expect(stats.freeRangeCount == 1 && stats.largestFreeRange == 400 && stats.usedSize == 0, "freeing before a free range merges with it");
+
+	allocator.Reset(400);
+	a = allocator.Allocate(100);
+	b = allocator.Allocate(100);
+	allocator.Allocate(200);
+	allocator.Free(a);
+	allocator.Free(b);
+	stats = allocator.GetStats();
+	Expect(stats.freeRangeCount == 1 && stats.largestFreeRange == 200, "freeing after a free range merges with it");
+}
+
+static void CheckBestFit()
+{
+	// Holes of 50, 20 and 30 elements between allocations, and 170 free at the end.
+	RangeAllocator allocator(300);
+	uint32_t holes[3];
+	uint32_t holeSizes[3] = { 50, 20, 30 };
+	for (uint32_t i = 0; i < 3; i++)
+	{
+		holes[i] = allocator.Allocate(holeSizes[i]);
+		allocator.Allocate(10);
+	}
+	for (uint32_t hole : holes)
+	{
+		allocator.Free(hole);
+	}
+
+	Expect(allocator.Allocate(25) == holes[2], "the smallest range that fits is used");
+	Expect(allocator.Allocate(20) == holes[1], "a range of exactly the size is used");
+	Expect(allocator.Allocate(60) == 130, "a size only the end fits goes at the end");
+	Expect(allocator.Allocate(45) == holes[0], "the remaining hole still fits smaller sizes");
+	Expect(allocator.Allocate(111) == RangeAllocator::InvalidOffset, "a size no range fits fails");
+	Expect(allocator.GetSize(holes[2]) == 25 && allocator.GetSize(holes[2] + 1) == 0, "GetSize knows allocations only by their offset");
+	Expect(allocator.Allocate(0) == RangeAllocator::InvalidOffset, "zero sized allocations fail");
+	Expect(!allocator.Free(holes[2] + 1) && allocator.Free(holes[2]) && !allocator.Free(holes[2]), "only live allocations can be freed");
+}
+
+static void CheckDefragment()
+{
+	// Allocations tagged in a simulated buffer, with holes between them.
+	const uint32_t capacity = 1000;
+	RangeAllocator allocator(capacity);
+	std::vector<int32_t> buffer(capacity, -1);
+	std::vector<uint32_t> offsets;
+	for (uint32_t i = 0; i < 20; i++)
+	{
+		offsets.push_back(allocator.Allocate(10 + i * 3));
+	}
+	for (uint32_t i = 0; i < offsets.size(); i++)
+	{
+		if (i % 3 == 0)
+		{
+			allocator.Free(offsets[i]);
+			continue;
+		}
+		std::fill(buffer.begin() + offsets[i], buffer.begin() + offsets[i] + allocator.GetSize(offsets[i]), static_cast<int32_t>(i));
+	}
+
+	RangeAllocator::Stats before = allocator.GetStats();
+	std::vector<RangeAllocator::Move> moves = allocator.Defragment();
+
+	// Applying the moves in place and in order must not overwrite anything not yet moved.
+	// GeometryPool copies into new buffers instead, but the offsets it maps must agree.
+	bool ascending = true;
+	bool packed = true;
+	for (size_t i = 0; i < moves.size(); i++)
+	{
+		const RangeAllocator::Move& move = moves[i];
+		ascending = ascending && move.newOffset < move.oldOffset && (i == 0 || moves[i - 1].oldOffset < move.oldOffset);
+		packed = packed && allocator.GetSize(move.newOffset) == move.size;
+		std::copy(buffer.begin() + move.oldOffset, buffer.begin() + move.oldOffset + move.size, buffer.begin() + move.newOffset);
+	}
+
+	// The kept allocations, in their old order, now sit back to back from offset 0.
+	bool intact = true;
+	uint32_t next = 0;
+	uint32_t moved = 0;
+	for (uint32_t i = 0; i < offsets.size(); i++)
+	{
+		if (i % 3 == 0)
+		{
+			continue;
+		}
+		uint32_t size = 10 + i * 3;
+		moved += (offsets[i] != next) ? 1 : 0;
+		intact = intact && allocator.GetSize(next) == size &&
+			std::all_of(buffer.begin() + next, buffer.begin() + next + size, [i](int32_t value) { return value == static_cast<int32_t>(i); });
+		next += size;
+	}
+
+	RangeAllocator::Stats after = allocator.GetStats();
+	Expect(before.freeRangeCount > 1 && before.fragmentation > 0.0f, "freeing every third allocation fragments the space");
+	Expect(ascending && packed && moves.size() == moved, "moves list just the allocations that moved, in ascending order");
+	Expect(intact, "copying in the order of the moves keeps every allocation's contents");
+	Expect(after.freeRangeCount == 1 && after.largestFreeRange == capacity - next && after.fragmentation == 0.0f &&
+		after.usedSize == before.usedSize && after.allocationCount == before.allocationCount, "afterwards the free space is one range");
+	Expect(allocator.Defragment().empty(), "defragmenting a packed space moves nothing");
+}
+
+static void CheckFragmentation()
+{
+	RangeAllocator allocator(100);
+	RangeAllocator::Stats stats = allocator.GetStats();
+	Expect(stats.fragmentation == 0.0f && stats.freeSize == 100, "an empty space isn't fragmented");
+
+	// Free ranges of 10 and 30: a quarter of the free space is outside the largest range.
+	uint32_t a = allocator.Allocate(10);
+	allocator.Allocate(20);
+	uint32_t b = allocator.Allocate(30);
+	allocator.Allocate(40);
+	allocator.Free(a);
+	allocator.Free(b);
+	stats = allocator.GetStats();
+	Expect(stats.freeRangeCount == 2 && stats.largestFreeRange == 30 && fabs(stats.fragmentation - 0.25f) < 1e-6f, "free ranges of 10 and 30 are a quarter fragmented");
+
+	allocator.Allocate(10);
+	allocator.Allocate(30);
+	stats = allocator.GetStats();
+	Expect(stats.freeSize == 0 && stats.fragmentation == 0.0f, "a full space isn't fragmented");
+}
+
+// Keeps one flag per element, and derives what the allocator should report from them.
+class Model
+{
+public:
+	explicit Model(uint32_t capacity) : m_used(capacity, false) {}
+
+	bool IsFree(uint32_t offset, uint32_t size) const
+	{
+		return offset + size <= m_used.size() && std::none_of(m_used.begin() + offset, m_used.begin() + offset + size, [](bool used) { return used; });
+	}
+
+	void Mark(uint32_t offset, uint32_t size, bool used)
+	{
+		std::fill(m_used.begin() + offset, m_used.begin() + offset + size, used);
+	}
+
+	// Calls func(offset, size) for every run of free elements.
+	template<typename TFunc>
+	void ForEachFreeRun(const TFunc& func) const
+	{
+		uint32_t size = static_cast<uint32_t>(m_used.size());
+		for (uint32_t offset = 0; offset < size;)
+		{
+			if (m_used[offset])
+			{
+				offset++;
+				continue;
+			}
+			uint32_t end = offset;
+			while (end < size && !m_used[end])
+			{
+				end++;
+			}
+			func(offset, end - offset);
+			offset = end;
+		}
+	}
+
+private:
+	std::vector<bool>	m_used;
+};
+
+static void CheckAgainstModel(uint32_t capacity, uint32_t seed)
+{
+	const uint32_t steps = 20000;
+	std::mt19937 random(seed);
+	RangeAllocator allocator(capacity);
+	Model model(capacity);
+	std::vector<uint32_t> live;
+	uint32_t overlaps = 0;
+	uint32_t notBestFit = 0;
+	uint32_t wrongStats = 0;
+
+	for (uint32_t step = 0; step < steps; step++)
+	{
+		if (live.empty() || random() % 100 < 55)
+		{
+			uint32_t size = 1 + random() % (capacity / 64);
+
+			// The smallest free run that fits, lowest offset first, is where best fit must go.
+			uint32_t bestOffset = RangeAllocator::InvalidOffset;
+			uint32_t bestSize = UINT32_MAX;
+			model.ForEachFreeRun([&](uint32_t offset, uint32_t runSize)
+			{
+				if (runSize >= size && runSize < bestSize)
+				{
+					bestOffset = offset;
+					bestSize = runSize;
+				}
+			});
+
+			uint32_t offset = allocator.Allocate(size);
+			notBestFit += (offset == bestOffset) ? 0 : 1;
+			if (offset != RangeAllocator::InvalidOffset)
+			{
+				overlaps += model.IsFree(offset, size) ? 0 : 1;
+				model.Mark(offset, size, true);
+				live.push_back(offset);
+			}
+		}
+		else
+		{
+			size_t index = random() % live.size();
+			model.Mark(live[index], allocator.GetSize(live[index]), false);
+			allocator.Free(live[index]);
+			live[index] = live.back();
+			live.pop_back();
+		}
+
+		if (step % 64 == 0)
+		{
+			uint32_t freeSize = 0;
+			uint32_t runs = 0;
+			uint32_t largest = 0;
+			model.ForEachFreeRun([&](uint32_t, uint32_t runSize)
+			{
+				freeSize += runSize;
+				runs++;
+				largest = (std::max)(largest, runSize);
+			});
+			RangeAllocator::Stats stats = allocator.GetStats();
+			float fragmentation = freeSize > 0 ? 1.0f - static_cast<float>(largest) / freeSize : 0.0f;
+			wrongStats += (stats.freeSize == freeSize && stats.freeRangeCount == runs && stats.largestFreeRange == largest &&
+				stats.allocationCount == live.size() && stats.fragmentation == fragmentation) ? 0 : 1;
+		}
+	}
+
+	char description[160];
+	snprintf(description, sizeof(description), "%u random steps: no allocation overlaps another", steps);
+	Expect(overlaps == 0, description);
+	snprintf(description, sizeof(description), "%u random steps: every allocation is the best fit", steps);
+	Expect(notBestFit == 0, description);
+	snprintf(description, sizeof(description), "%u random steps: stats match the free runs, merged with their neighbours", steps);
+	Expect(wrongStats == 0, description);
+}
+
+// Loads and unloads meshes at random, keeping the space about half full, and reports the cost
+// of each operation and the fragmentation it settles at.
+static void Benchmark(uint32_t capacity, uint32_t operations, uint32_t seed)
+{
+	printf("\n%-12s %12s %12s %12s %14s\n", "Mesh size", "Allocate ns", "Free ns", "Free ranges", "Fragmentation");
+	for (uint32_t largest : { 64u, 1024u, 8192u })
+	{
+		std::mt19937 random(seed);
+		RangeAllocator allocator(capacity);
+		std::vector<uint32_t> live;
+		std::vector<uint32_t> sizes(operations);
+		for (uint32_t& size : sizes)
+		{
+			size = 1 + random() % largest;
+		}
+
+		double allocateSeconds = 0.0;
+		double freeSeconds = 0.0;
+		uint32_t allocations = 0;
+		uint32_t frees = 0;
+		uint64_t freeRanges = 0;
+		double fragmentation = 0.0;
+		uint32_t samples = 0;
+
+		for (uint32_t operation = 0; operation < operations; operation++)
+		{
+			bool allocate = live.empty() || allocator.GetUsedSize() < capacity / 2;
+			auto start = Clock::now();
+			if (allocate)
+			{
+				uint32_t offset = allocator.Allocate(sizes[operation]);
+				allocateSeconds += std::chrono::duration<double>(Clock::now() - start).count();
+				allocations++;
+				if (offset != RangeAllocator::InvalidOffset)
+				{
+					live.push_back(offset);
+				}
+			}
+			else
+			{
+				size_t index = sizes[operation] % live.size();
+				start = Clock::now();
+				allocator.Free(live[index]);
+				freeSeconds += std::chrono::duration<double>(Clock::now() - start).count();
+				frees++;
+				live[index] = live.back();
+				live.pop_back();
+			}
+
+			if (operation % 1024 == 0)
+			{
+				RangeAllocator::Stats stats = allocator.GetStats();
+				freeRanges += stats.freeRangeCount;
+				fragmentation += stats.fragmentation;
+				samples++;
+			}
+		}
+
+		char label[32];
+		snprintf(label, sizeof(label), "1-%u", largest);
+		printf("%-12s %12.1f %12.1f %12.1f %14.3f\n", label, allocateSeconds * 1e9 / (std::max)(allocations, 1u),
+			freeSeconds * 1e9 / (std::max)(frees, 1u), static_cast<double>(freeRanges) / samples, fragmentation / samples);
+	}
+}
+
+int main(int argc, char** argv)
+{
+	uint32_t capacity = 3 << 16;
+	uint32_t operations = 1000000;
+	uint32_t seed = 1;
+
+	for (int i = 1; i < argc; i++)
+	{
+		std::string argument = argv[i];
+		if (argument == "--capacity" && i + 1 < argc)
+		{
+			capacity = (std::max)(static_cast<uint32_t>(strtoul(argv[++i], nullptr, 10)), 1024u);
+		}
+		else if (argument == "--operations" && i + 1 < argc)
+		{
+			operations = (std::max)(static_cast<uint32_t>(strtoul(argv[++i], nullptr, 10)), 1u);
+		}
+		else if (argument == "--seed" && i + 1 < argc)
+		{
+			seed = static_cast<uint32_t>(strtoul(argv[++i], nullptr, 10));
+		}
+		else
+		{
+			fprintf(stderr, "%s: unknown option\n", argument.c_str());
+			fprintf(stderr, "Usage: %s [--capacity <elements>] [--operations <count>] [--seed <value>]\n", argv[0]);
+			return 1;
+		}
+	}
+
+	CheckMerging();
+	CheckBestFit();
+	CheckDefragment();
+	CheckFragmentation();
+	CheckAgainstModel(4096, seed);
+	Benchmark(capacity, operations, seed);
+
+	return ReportChecks();
+}
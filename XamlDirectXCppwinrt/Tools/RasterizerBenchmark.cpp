@@ -0,0 +1,341 @@
+﻿// Draws the sample's spinning cubes with DX::SoftwareRasterizer, to time the rasterizer on the
+// CPU and to check its frames against golden images.
+//
+// Usage: RasterizerBenchmark [options]
+//
+//   --size <width>x<height>		Size of the frames. The default is 1280x720.
+//   --frames <count>				Frames to draw. The default is 100.
+//   --cubes <count>				Cubes in the scene, in a grid in front of the camera. The
+//									default is 1024, about 6000 triangles drawn per frame, which
+//									gives a steady throughput. 1 draws the sample's own scene.
+//   --threads <count>				Threads drawing tiles. The default is one per hardware thread.
+//   --benchmark					Draw the frames with 1, 2, 4... threads up to --threads and
+//									report the throughput of each.
+//   --output <file.ppm>			Write the last frame as a binary PPM image.
+//   --golden <file.ppm>			Compare the last frame with this image, and fail if they
+//									differ by more than the tolerance.
+//   --tolerance <value>			Largest difference allowed in any channel. The default is 1.
+//
+// Throughput counts the triangles that were set up and drawn, after culling and clipping, and
+// the pixels that reached the depth test.
+//
+// It needs no GPU, so golden images can be checked on build machines as well as on a desktop.
+// Build it with:
+//
+//   g++ -std=c++20 -O2 -pthread RasterizerBenchmark.cpp ../Common/SoftwareRasterizer.cpp -o RasterizerBenchmark
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <string>
+#include <thread>
+#include <vector>
+#include "../Common/SoftwareRasterizer.h"
+#include "Check.h"
+
+static const float Pi = 3.14159265f;
+
+// The cube of Sample3DSceneRenderer, with its face colors.
+static const DX::BackendVertex CubeVertices[] =
+{
+	{ { -0.5f, -0.5f, -0.5f }, { 1.0f, 0.35f, 0.0f } },
+	{ { -0.5f, -0.5f,  0.5f }, { 1.0f, 0.35f, 0.0f } },
+	{ { -0.5f,  0.5f, -0.5f }, { 1.0f, 0.35f, 0.0f } },
+	{ { -0.5f,  0.5f,  0.5f }, { 1.0f, 0.35f, 0.0f } },
+
+	{ {  0.5f, -0.5f, -0.5f }, { 0.80f, 0.12f, 0.23f } },
+	{ {  0.5f, -0.5f,  0.5f }, { 0.80f, 0.12f, 0.23f } },
+	{ {  0.5f,  0.5f, -0.5f }, { 0.80f, 0.12f, 0.23f } },
+	{ {  0.5f,  0.5f,  0.5f }, { 0.80f, 0.12f, 0.23f } },
+
+	{ { -0.5f, -0.5f, -0.5f }, { 1.0f, 1.0f, 1.0f } },
+	{ { -0.5f, -0.5f,  0.5f }, { 1.0f, 1.0f, 1.0f } },
+	{ {  0.5f, -0.5f, -0.5f }, { 1.0f, 1.0f, 1.0f } },
+	{ {  0.5f, -0.5f,  0.5f }, { 1.0f, 1.0f, 1.0f } },
+
+	{ { -0.5f,  0.5f, -0.5f }, { 1.0f, 0.84f, 0.0f } },
+	{ { -0.5f,  0.5f,  0.5f }, { 1.0f, 0.84f, 0.0f } },
+	{ {  0.5f,  0.5f, -0.5f }, { 1.0f, 0.84f, 0.0f } },
+	{ {  0.5f,  0.5f,  0.5f }, { 1.0f, 0.84f, 0.0f } },
+
+	{ { -0.5f, -0.5f, -0.5f }, { 0.0f, 0.48f, 0.29f } },
+	{ { -0.5f,  0.5f, -0.5f }, { 0.0f, 0.48f, 0.29f } },
+	{ {  0.5f, -0.5f, -0.5f }, { 0.0f, 0.48f, 0.29f } },
+	{ {  0.5f,  0.5f, -0.5f }, { 0.0f, 0.48f, 0.29f } },
+
+	{ { -0.5f, -0.5f,  0.5f }, { 0.0f, 0.32f, 0.73f } },
+	{ { -0.5f,  0.5f,  0.5f }, { 0.0f, 0.32f, 0.73f } },
+	{ {  0.5f, -0.5f,  0.5f }, { 0.0f, 0.32f, 0.73f } },
+	{ {  0.5f,  0.5f,  0.5f }, { 0.0f, 0.32f, 0.73f } },
+};
+
+static const uint16_t CubeIndices[] =
+{
+	0, 2, 1, 1, 2, 3,
+	4, 5, 6, 5, 7, 6,
+	8, 9, 11, 8, 11, 10,
+	12, 14, 15, 12, 15, 13,
+	16, 18, 19, 16, 19, 17,
+	20, 21, 23, 20, 23, 22,
+};
+
+// Row-major matrices for row vectors, as XMMatrixPerspectiveFovRH, XMMatrixLookAtRH and
+// XMMatrixRotationY make them.
+static void PerspectiveFovRH(float fovAngleY, float aspectRatio, float nearZ, float farZ, float result[16])
+{
+	float height = 1.0f / std::tan(fovAngleY * 0.5f);
+	float range = farZ / (nearZ - farZ);
+	const float matrix[16] =
+	{
+		height / aspectRatio,	0.0f,		0.0f,			0.0f,
+		0.0f,					height,		0.0f,			0.0f,
+		0.0f,					0.0f,		range,			-1.0f,
+		0.0f,					0.0f,		range * nearZ,	0.0f,
+	};
+	memcpy(result, matrix, sizeof(matrix));
+}
+
+static void Normalize(float v[3])
+{
+	float length = std::sqrt(v[0] * v[0] + v[1] * v[1] + v[2] * v[2]);
+	for (int i = 0; i < 3; i++)
+	{
+		v[i] /= length;
+	}
+}
+
+static void Cross(const float a[3], const float b[3], float result[3])
+{
+	result[0] = a[1] * b[2] - a[2] * b[1];
+	result[1] = a[2] * b[0] - a[0] * b[2];
+	result[2] = a[0] * b[1] - a[1] * b[0];
+}
+
+static float Dot(const float a[3], const float b[3])
+{
+	return a[0] * b[0] + a[1] * b[1] + a[2] * b[2];
+}
+
+static void LookAtRH(const float eye[3], const float at[3], const float up[3], float result[16])
+{
+	float z[3] = { eye[0] - at[0], eye[1] - at[1], eye[2] - at[2] };
+	Normalize(z);
+	float x[3];
+	Cross(up, z, x);
+	Normalize(x);
+	float y[3];
+	Cross(z, x, y);
+
+	const float matrix[16] =
+	{
+		x[0],			y[0],			z[0],			0.0f,
+		x[1],			y[1],			z[1],			0.0f,
+		x[2],			y[2],			z[2],			0.0f,
+		-Dot(x, eye),	-Dot(y, eye),	-Dot(z, eye),	1.0f,
+	};
+	memcpy(result, matrix, sizeof(matrix));
+}
+
+static void RotationY(float radians, float result[16])
+{
+	float sine = std::sin(radians);
+	float cosine = std::cos(radians);
+	const float matrix[16] =
+	{
+		cosine,		0.0f,	-sine,		0.0f,
+		0.0f,		1.0f,	0.0f,		0.0f,
+		sine,		0.0f,	cosine,		0.0f,
+		0.0f,		0.0f,	0.0f,		1.0f,
+	};
+	memcpy(result, matrix, sizeof(matrix));
+}
+
+// Draws frames of cubeCount cubes, spinning as the sample's cube does at 60 frames per second.
+// A single cube sits where the sample draws it; more fill a square grid that shrinks to fit.
+static void DrawFrames(DX::SoftwareRasterizer& rasterizer, uint32_t frameCount, uint32_t cubeCount)
+{
+	// The sample's camera and clear color.
+	float projection[16];
+	PerspectiveFovRH(70.0f * Pi / 180.0f, float(rasterizer.GetWidth()) / float(rasterizer.GetHeight()), 0.01f, 100.0f, projection);
+	const float eye[3] = { 0.0f, 0.7f, 1.5f };
+	const float at[3] = { 0.0f, -0.1f, 0.0f };
+	const float up[3] = { 0.0f, 1.0f, 0.0f };
+	float view[16];
+	LookAtRH(eye, at, up, view);
+	const float cornflowerBlue[4] = { 0.392f, 0.584f, 0.929f, 1.0f };
+
+	uint32_t columns = static_cast<uint32_t>(std::ceil(std::sqrt(float(cubeCount))));
+	float scale = 1.0f / columns;
+	for (uint32_t frame = 0; frame < frameCount; frame++)
+	{
+		rasterizer.Clear(cornflowerBlue, 1.0f);
+		rasterizer.SetViewProjection(view, projection);
+
+		// 45 degrees per second.
+		float radians = frame * (Pi / 4.0f) / 60.0f;
+		for (uint32_t cube = 0; cube < cubeCount; cube++)
+		{
+			float model[16];
+			RotationY(radians + cube * 0.5f, model);
+			for (int i = 0; i < 12; i++)
+			{
+				model[i] *= (i % 4 == 3) ? 1.0f : scale;
+			}
+			model[12] = ((cube % columns) + 0.5f) * scale * 2.0f - 1.0f;
+			model[13] = 0.0f;
+			model[14] = ((cube / columns) + 0.5f) * scale * 2.0f - 1.0f;
+			rasterizer.DrawIndexed(CubeVertices, CubeIndices, static_cast<uint32_t>(std::size(CubeIndices)), model);
+		}
+
+		rasterizer.Flush();
+	}
+}
+
+static bool ReadFile(const std::string& path, std::vector<uint8_t>* data)
+{
+	std::ifstream file(path, std::ios::binary);
+	if (!file)
+	{
+		return false;
+	}
+
+	data->assign(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+	return !file.bad();
+}
+
+int main(int argc, char** argv)
+{
+	uint32_t width = 1280;
+	uint32_t height = 720;
+	uint32_t frameCount = 100;
+	uint32_t cubeCount = 1024;
+	uint32_t threadCount = (std::max)(std::thread::hardware_concurrency(), 1u);
+	uint32_t tolerance = 1;
+	bool benchmark = false;
+	std::string outputPath;
+	std::string goldenPath;
+
+	for (int i = 1; i < argc; i++)
+	{
+		std::string argument = argv[i];
+		if (argument == "--size" && i + 1 < argc)
+		{
+			if (sscanf(argv[++i], "%ux%u", &width, &height) != 2 || width == 0 || height == 0)
+			{
+				fprintf(stderr, "%s: invalid size (expected <width>x<height>)\n", argv[i]);
+				return 1;
+			}
+		}
+		else if (argument == "--frames" && i + 1 < argc)
+		{
+			frameCount = (std::max)(static_cast<uint32_t>(strtoul(argv[++i], nullptr, 10)), 1u);
+		}
+		else if (argument == "--cubes" && i + 1 < argc)
+		{
+			cubeCount = (std::max)(static_cast<uint32_t>(strtoul(argv[++i], nullptr, 10)), 1u);
+		}
+		else if (argument == "--threads" && i + 1 < argc)
+		{
+			threadCount = (std::max)(static_cast<uint32_t>(strtoul(argv[++i], nullptr, 10)), 1u);
+		}
+		else if (argument == "--benchmark")
+		{
+			benchmark = true;
+		}
+		else if (argument == "--output" && i + 1 < argc)
+		{
+			outputPath = argv[++i];
+		}
+		else if (argument == "--golden" && i + 1 < argc)
+		{
+			goldenPath = argv[++i];
+		}
+		else if (argument == "--tolerance" && i + 1 < argc)
+		{
+			tolerance = static_cast<uint32_t>(strtoul(argv[++i], nullptr, 10));
+		}
+		else
+		{
+			fprintf(stderr, "%s: unknown option\n", argument.c_str());
+			fprintf(stderr, "Usage: %s [--size <width>x<height>] [--frames <count>] [--cubes <count>] [--threads <count>] [--benchmark] [--output <file.ppm>] [--golden <file.ppm>] [--tolerance <value>]\n", argv[0]);
+			return 1;
+		}
+	}
+
+	std::vector<uint32_t> threadCounts = { threadCount };
+	if (benchmark)
+	{
+		threadCounts.clear();
+		for (uint32_t count = 1; count < threadCount; count *= 2)
+		{
+			threadCounts.push_back(count);
+		}
+		threadCounts.push_back(threadCount);
+	}
+
+	std::vector<uint32_t> lastFrame;
+	double baseline = 0.0;
+	for (uint32_t count : threadCounts)
+	{
+		DX::SoftwareRasterizer rasterizer(width, height, count);
+
+		auto start = std::chrono::steady_clock::now();
+		DrawFrames(rasterizer, frameCount, cubeCount);
+		double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+		const DX::SoftwareRasterizer::Stats& stats = rasterizer.GetStats();
+		baseline = (count == 1) ? seconds : baseline;
+		printf("%3u threads: %8.3f ms/frame, %8.2f Mtri/s, %8.2f Mpix/s",
+			count, seconds * 1000.0 / frameCount, stats.trianglesRasterized / seconds / 1.0e6, stats.pixelsTested / seconds / 1.0e6);
+		if (baseline > 0.0)
+		{
+			printf(", %5.2fx", baseline / seconds);
+		}
+		printf("\n");
+
+		lastFrame.assign(rasterizer.GetPixels(), rasterizer.GetPixels() + size_t(width) * height);
+	}
+
+	if (!outputPath.empty())
+	{
+		std::vector<uint8_t> image = DX::EncodePortablePixmap(lastFrame.data(), width, height);
+		std::ofstream file(outputPath, std::ios::binary);
+		if (!file.write(reinterpret_cast<const char*>(image.data()), image.size()))
+		{
+			fprintf(stderr, "%s: could not write the image\n", outputPath.c_str());
+			return 1;
+		}
+	}
+
+	if (!goldenPath.empty())
+	{
+		std::vector<uint8_t> file;
+		std::vector<uint32_t> golden;
+		uint32_t goldenWidth;
+		uint32_t goldenHeight;
+		if (!ReadFile(goldenPath, &file) || !DX::DecodePortablePixmap(file.data(), file.size(), golden, goldenWidth, goldenHeight))
+		{
+			fprintf(stderr, "%s: not a binary PPM image\n", goldenPath.c_str());
+			return 1;
+		}
+
+		if (goldenWidth != width || goldenHeight != height)
+		{
+			fprintf(stderr, "%s: is %ux%u, the frames are %ux%u\n", goldenPath.c_str(), goldenWidth, goldenHeight, width, height);
+			return 1;
+		}
+
+		DX::ImageDifference difference = DX::CompareImages(lastFrame.data(), golden.data(), width * height, tolerance);
+		printf("\n");
+		Expect(difference.differentPixels == 0, "last frame matches the golden image", "%u pixels differ by more than %u, by up to %u",
+			difference.differentPixels, tolerance, difference.maxChannelDifference);
+		return ReportChecks();
+	}
+
+	return 0;
+}
@@ -0,0 +1,472 @@
+﻿// Replays GPU time traces through DX::ResolutionController the way DynamicResolution feeds it:
+// each frame's time is read back a few frames after it was rendered, at most FrameLatency
+// frames are measured at once, and the frames redrawn after a change of scale aren't measured.
+// A trace gives each frame's GPU time at full scale; rendered at a lower scale, the part of it
+// that scales with the pixel count shrinks with the square of the scale.
+//
+// Usage: ResolutionControllerTest [options]
+//
+//   --trace <FrameTrace.json>		Also replays the "GPU Frame" zones of a trace saved by the
+//									app with the profiler compiled in. Record it with the scale
+//									held at one, so that its times are full scale times.
+//   --target <ms>					GPU budget per frame. The default is 15, as in the app.
+//   --fixed <ms>					GPU time per frame that doesn't depend on the scale, such as
+//									the overlays and the upscale. The default is 1.
+//   --latency <frames>				Frames before a frame's time can be read back. The default is 2.
+//   --seed <value>					Seed for the noise in the built-in traces. The default is 1.
+//
+// The built-in traces are shaped like recordings of the sample: light and heavy scenes, noise,
+// steps as the scene changes, single slow frames, and loads the scale can't absorb. For each,
+// the scale must settle with the GPU time inside the budget's dead band, stay between the
+// controller's limits, and move only in whole steps. Build it with:
+//
+//   g++ -std=c++17 -O2 ResolutionControllerTest.cpp -o ResolutionControllerTest
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <deque>
+#include <fstream>
+#include <random>
+#include <string>
+#include <vector>
+#include "../Common/ResolutionController.h"
+#include "Check.h"
+
+using DX::ResolutionController;
+
+// As in DynamicResolution.
+static const uint32_t FrameLatency = 4;
+static const uint32_t SettlingFrames = 2;
+
+struct ReplayOptions
+{
+	float		targetMilliseconds;
+	float		fixedMilliseconds;
+	uint32_t	latency;
+};
+
+struct Replay
+{
+	std::vector<float>	scales;			// The scale each frame was rendered at.
+	std::vector<float>	milliseconds;	// Its GPU time at that scale.
+	ResolutionController::Stats	stats;
+	bool				inLimits;		// Every scale between the limits, and a whole number of steps.
+};
+
+static float GetFrameTime(float fullScaleMilliseconds, float scale, const ReplayOptions& options)
+{
+	float scaled = (std::max)(fullScaleMilliseconds - options.fixedMilliseconds, 0.0f);
+	return (std::min)(fullScaleMilliseconds, options.fixedMilliseconds) + scaled * scale * scale;
+}
+
+static Replay RunReplay(const std::vector<float>& trace, const ReplayOptions& options, ResolutionController::Settings settings = {})
+{
+	settings.targetMilliseconds = options.targetMilliseconds;
+	ResolutionController controller(settings);
+
+	struct Pending
+	{
+		uint32_t	readyFrame;
+		float		milliseconds;
+		float		scale;
+	};
+	std::deque<Pending> pending;
+	uint32_t settlingFrames = 0;
+	float scale = controller.GetScale();
+
+	Replay replay = {};
+	replay.inLimits = true;
+	for (uint32_t frame = 0; frame < trace.size(); frame++)
+	{
+		// Update: read back the frames that have finished, then pick this frame's scale.
+		while (!pending.empty() && pending.front().readyFrame <= frame)
+		{
+			controller.AddSample(pending.front().milliseconds, pending.front().scale);
+			pending.pop_front();
+		}
+		if (controller.GetScale() != scale)
+		{
+			scale = controller.GetScale();
+			settlingFrames = SettlingFrames;
+		}
+
+		float steps = scale / settings.step;
+		replay.inLimits = replay.inLimits && scale >= settings.minScale && scale <= settings.maxScale && steps == std::round(steps);
+
+		float milliseconds = GetFrameTime(trace[frame], scale, options);
+		replay.scales.push_back(scale);
+		replay.milliseconds.push_back(milliseconds);
+
+		// BeginFrame and EndFrame: measure the frame unless it is settling or every query is
+		// in flight.
+		if (settlingFrames > 0)
+		{
+			settlingFrames--;
+		}
+		else if (pending.size() < FrameLatency)
+		{
+			pending.push_back({ frame + options.latency, milliseconds, scale });
+		}
+	}
+	replay.stats = controller.GetStats();
+	return replay;
+}
+
+// How a replay went over frames [first, last).
+struct Summary
+{
+	float		minScale;
+	float		maxScale;
+	float		finalScale;
+	float		meanMilliseconds;
+	float		overBudget;			// Share of frames over the budget.
+	float		farOverBudget;		// Share of frames over the budget by more than a tenth.
+	uint32_t	changes;			// Changes of scale.
+};
+
+static Summary Summarize(const Replay& replay, float targetMilliseconds, size_t first, size_t last)
+{
+	Summary summary = { 2.0f, 0.0f, replay.scales[last - 1], 0.0f, 0.0f, 0.0f, 0 };
+	uint32_t over = 0;
+	uint32_t farOver = 0;
+	for (size_t i = first; i < last; i++)
+	{
+		summary.minScale = (std::min)(summary.minScale, replay.scales[i]);
+		summary.maxScale = (std::max)(summary.maxScale, replay.scales[i]);
+		summary.meanMilliseconds += replay.milliseconds[i];
+		over += replay.milliseconds[i] > targetMilliseconds ? 1 : 0;
+		farOver += replay.milliseconds[i] > targetMilliseconds * 1.1f ? 1 : 0;
+		summary.changes += (i > first && replay.scales[i] != replay.scales[i - 1]) ? 1 : 0;
+	}
+	summary.meanMilliseconds /= last - first;
+	summary.overBudget = static_cast<float>(over) / (last - first);
+	summary.farOverBudget = static_cast<float>(farOver) / (last - first);
+	return summary;
+}
+
+// The first frame from which the scale holds to the end of [first, last), or last if it never
+// settles.
+static size_t GetSettledFrame(const Replay& replay, size_t first, size_t last)
+{
+	size_t settled = first;
+	for (size_t i = first + 1; i < last; i++)
+	{
+		if (replay.scales[i] != replay.scales[i - 1])
+		{
+			settled = i;
+		}
+	}
+	return settled;
+}
+
+// The scale at which a frame of the given full scale time meets the budget exactly.
+static float GetIdealScale(float fullScaleMilliseconds, const ReplayOptions& options)
+{
+	float scaled = fullScaleMilliseconds - options.fixedMilliseconds;
+	return std::sqrt((std::max)(options.targetMilliseconds - options.fixedMilliseconds, 0.0f) / scaled);
+}
+
+static std::vector<float> Constant(float milliseconds, uint32_t frames)
+{
+	return std::vector<float>(frames, milliseconds);
+}
+
+static std::vector<float> Noisy(float milliseconds, float deviation, uint32_t frames, std::mt19937& random)
+{
+	std::normal_distribution<float> noise(0.0f, deviation);
+	std::vector<float> trace(frames);
+	for (float& value : trace)
+	{
+		value = (std::max)(milliseconds * (1.0f + noise(random)), 0.1f);
+	}
+	return trace;
+}
+
+static std::vector<float> Join(std::initializer_list<std::vector<float>> parts)
+{
+	std::vector<float> trace;
+	for (const std::vector<float>& part : parts)
+	{
+		trace.insert(trace.end(), part.begin(), part.end());
+	}
+	return trace;
+}
+
+static void PrintHeader()
+{
+	printf("\n%-24s %7s %9s %9s %9s %10s %10s %8s %10s %8s %7s\n", "Trace", "Frames", "Min", "Max", "Final", "Settled", "Mean ms", "Over %", "Over 10%", "Changes", "Stale");
+}
+
+static void PrintRow(const char* name, const Replay& replay, float targetMilliseconds)
+{
+	size_t frames = replay.scales.size();
+	Summary summary = Summarize(replay, targetMilliseconds, 0, frames);
+	printf("%-24s %7zu %9.4f %9.4f %9.4f %10zu %10.2f %7.1f%% %9.1f%% %8u %7llu\n", name, frames, summary.minScale, summary.maxScale, summary.finalScale,
+		GetSettledFrame(replay, 0, frames), summary.meanMilliseconds, summary.overBudget * 100.0f, summary.farOverBudget * 100.0f, summary.changes,
+		static_cast<unsigned long long>(replay.stats.staleSamples));
+}
+
+// The controller on its own, sample by sample.
+static void CheckController()
+{
+	ResolutionController controller;
+	const ResolutionController::Settings& settings = controller.GetSettings();
+
+	Expect(!controller.AddSample(-1.0f, 1.0f) && !controller.AddSample(std::nanf(""), 1.0f) && !controller.AddSample(30.0f, 0.5f) &&
+		controller.GetStats().staleSamples == 3 && controller.GetStats().samples == 0,
+		"controller: negative and NaN times, and frames at a scale no longer applied, are ignored");
+
+	// Within the dead band nothing moves, and below it the scale is already at its maximum.
+	bool held = true;
+	for (int i = 0; i < 200; i++)
+	{
+		float milliseconds = settings.targetMilliseconds * (1.0f - settings.raiseMargin * (i % 10) / 10.0f);
+		held = held && !controller.AddSample(milliseconds, controller.GetScale());
+	}
+	for (int i = 0; i < 200; i++)
+	{
+		held = held && !controller.AddSample(1.0f + i % 5, controller.GetScale());
+	}
+	Expect(held && controller.GetScale() == settings.maxScale && controller.GetStats().changes == 0,
+		"controller: frames within the budget, or far under it at full scale, keep the scale");
+
+	// Far over the budget the scale falls to its minimum and no further, however long it lasts.
+	for (int i = 0; i < 1000; i++)
+	{
+		controller.AddSample(1000.0f, controller.GetScale());
+	}
+	Expect(controller.GetScale() == settings.minScale, "controller: a load the scale can't absorb holds it at the minimum");
+
+	// In velocity form, those frames left nothing to unwind: the first light frames raise the
+	// scale again.
+	uint32_t frames = 0;
+	while (controller.GetScale() < settings.maxScale && frames < 1000)
+	{
+		controller.AddSample(1.0f, controller.GetScale());
+		frames++;
+	}
+	Expect(frames <= 10, "controller: after a long stretch at the minimum, the scale recovers without windup");
+
+	controller.AddSample(1000.0f, controller.GetScale());
+	controller.Reset();
+	Expect(controller.GetScale() == settings.maxScale && controller.GetStats().samples == 0, "controller: Reset starts again at full scale");
+
+	Expect(ResolutionController::ScaleSize(1920, 0.5f) == 960 && ResolutionController::ScaleSize(1366, 0.75f) == 1025 && ResolutionController::ScaleSize(1, 0.5f) == 1,
+		"controller: scaled sizes round to the nearest pixel, and never reach zero");
+}
+
+static void CheckReplays(const ReplayOptions& options, std::mt19937& random)
+{
+	ResolutionController::Settings settings;
+	float target = options.targetMilliseconds;
+	float low = target * (1.0f - settings.raiseMargin);
+	PrintHeader();
+
+	// A scene the GPU renders within the budget at full scale.
+	Replay light = RunReplay(Constant(target * 0.6f, 600), options);
+	PrintRow("light", light, target);
+
+	// A scene that needs half the pixels: the scale must settle where the GPU time is within the
+	// dead band, between the budget and the margin below it, to within one step.
+	float heavyMilliseconds = options.fixedMilliseconds + (target - options.fixedMilliseconds) * 2.0f;
+	Replay heavy = RunReplay(Constant(heavyMilliseconds, 600), options);
+	PrintRow("heavy", heavy, target);
+
+	// Frame to frame jitter of a few percent, and noisier loads than the dead band can hold.
+	Replay noisy = RunReplay(Noisy(heavyMilliseconds, 0.04f, 1800, random), options);
+	PrintRow("heavy, 4% noise", noisy, target);
+	Replay noisier = RunReplay(Noisy(heavyMilliseconds, 0.08f, 1800, random), options);
+	PrintRow("heavy, 8% noise", noisier, target);
+	Replay noisiest = RunReplay(Noisy(heavyMilliseconds, 0.15f, 1800, random), options);
+	PrintRow("heavy, 15% noise", noisiest, target);
+
+	Replay overloaded = RunReplay(Constant(target * 10.0f, 600), options);
+	PrintRow("overloaded", overloaded, target);
+
+	std::vector<float> stepsTrace = Join({ Constant(target * 0.6f, 300), Constant(heavyMilliseconds, 600), Constant(target * 0.6f, 600) });
+	Replay steps = RunReplay(stepsTrace, options);
+	PrintRow("light, heavy, light", steps, target);
+
+	// Single slow frames, such as a shader compiled on first use, every two seconds.
+	std::vector<float> hitchTrace = Constant(target * 0.7f, 1200);
+	for (size_t i = 60; i < hitchTrace.size(); i += 120)
+	{
+		hitchTrace[i] = target * 6.0f;
+	}
+	Replay hitches = RunReplay(hitchTrace, options);
+	PrintRow("light, single hitches", hitches, target);
+
+	// A load that swings slowly between light and heavy, as the camera moves through a scene.
+	std::vector<float> swingTrace(2400);
+	for (size_t i = 0; i < swingTrace.size(); i++)
+	{
+		swingTrace[i] = target * (1.3f + 0.7f * std::sin(static_cast<float>(i) * 2.0f * 3.14159265f / 600.0f));
+	}
+	Replay swing = RunReplay(swingTrace, options);
+	PrintRow("slow swing", swing, target);
+	printf("\n");
+
+	Summary lightSummary = Summarize(light, target, 0, light.scales.size());
+	Expect(lightSummary.minScale == settings.maxScale && light.stats.changes == 0, "replay: a light scene stays at full scale");
+
+	// Settled: the scale holds for the last third, with the GPU time inside the dead band. One
+	// step either way moves the time by about 2 * step of the scaled part, so allow that.
+	float ideal = GetIdealScale(heavyMilliseconds, options);
+	size_t heavySettled = GetSettledFrame(heavy, 0, heavy.scales.size());
+	Summary heavyTail = Summarize(heavy, target, heavy.scales.size() * 2 / 3, heavy.scales.size());
+	float slack = 2.0f * settings.step * (heavyMilliseconds - options.fixedMilliseconds);
+	Expect(heavySettled < heavy.scales.size() / 3 && heavyTail.changes == 0 &&
+		heavyTail.meanMilliseconds <= target && heavyTail.meanMilliseconds >= low - slack && std::fabs(heavyTail.finalScale - ideal) <= 2.0f * settings.step,
+		"replay: a heavy scene settles within the budget's dead band, near the scale that meets the budget");
+
+	// Jitter of a few percent mustn't keep the scale moving: once settled it changes at most
+	// once a second, by a step either way, and stays within the budget on average. Noisier
+	// loads move it more often, but still around the same scale.
+	Summary noisyTail = Summarize(noisy, target, 600, noisy.scales.size());
+	Summary noisiestTail = Summarize(noisiest, target, 600, noisiest.scales.size());
+	Expect(noisyTail.changes <= (noisy.scales.size() - 600) / 60 && noisyTail.meanMilliseconds <= target &&
+		noisyTail.maxScale - noisyTail.minScale <= 2.0f * settings.step,
+		"replay: jitter around a heavy load moves the scale rarely, and by a step at most");
+	Expect(noisiestTail.meanMilliseconds <= target && std::fabs(noisiestTail.minScale + noisiestTail.maxScale - 2.0f * ideal) <= 4.0f * settings.step,
+		"replay: a noisier load keeps the scale around the same value, within the budget on average");
+
+	Summary overloadedTail = Summarize(overloaded, target, 60, overloaded.scales.size());
+	Expect(overloadedTail.minScale == settings.minScale && overloadedTail.maxScale == settings.minScale,
+		"replay: a load the scale can't absorb holds it at the minimum, and never below");
+
+	// After each step in load the scale settles again, and returns to full scale afterwards.
+	Summary stepsHeavy = Summarize(steps, target, 700, 900);
+	Summary stepsLight = Summarize(steps, target, 1200, 1500);
+	Expect(std::fabs(stepsHeavy.finalScale - ideal) <= 2.0f * settings.step && stepsHeavy.changes == 0 &&
+		stepsLight.minScale == settings.maxScale,
+		"replay: a scene that gets heavier and lighter again settles each time, and ends at full scale");
+
+	// A hitch costs a dip, which must be shallow and brief: back to full scale well before the
+	// next one.
+	bool recovered = true;
+	float deepest = settings.maxScale;
+	for (size_t i = 60; i + 60 < hitches.scales.size(); i += 120)
+	{
+		for (size_t frame = i; frame < i + 120 && frame < hitches.scales.size(); frame++)
+		{
+			deepest = (std::min)(deepest, hitches.scales[frame]);
+		}
+		recovered = recovered && hitches.scales[i + 60] == settings.maxScale;
+	}
+	printf("A single hitch lowers the scale to %.4f at most.\n", deepest);
+	Expect(recovered && deepest >= 0.7f, "replay: single slow frames cause a bounded dip, recovered within a second");
+
+	// Tracking a slow swing: the scale follows the load down and back to full scale, and lags it
+	// by little enough that frames are rarely far over the budget.
+	Summary swingSummary = Summarize(swing, target, 600, swing.scales.size());
+	Expect(swingSummary.farOverBudget <= 0.02f && swingSummary.maxScale == settings.maxScale && std::fabs(swingSummary.minScale - ideal) <= 2.0f * settings.step,
+		"replay: a slowly swinging load is followed, and rarely exceeds the budget by more than a tenth");
+
+	bool inLimits = light.inLimits && heavy.inLimits && noisy.inLimits && noisier.inLimits && noisiest.inLimits && overloaded.inLimits && steps.inLimits && hitches.inLimits && swing.inLimits;
+	Expect(inLimits, "replay: every applied scale is between the limits and a whole number of steps");
+
+	// Frames still in flight when the scale changes are measured at the old scale, and their
+	// times are ignored.
+	Expect(heavy.stats.staleSamples > 0 && heavy.stats.changes > 0, "replay: times of frames rendered at an earlier scale are ignored");
+
+	// A longer readback latency must not make the controller oscillate.
+	ReplayOptions slow = options;
+	slow.latency = FrameLatency;
+	Replay slowHeavy = RunReplay(Constant(heavyMilliseconds, 900), slow);
+	Summary slowTail = Summarize(slowHeavy, target, 600, 900);
+	Expect(slowTail.changes == 0 && slowTail.meanMilliseconds <= target, "replay: with the longest readback latency the heavy scene still settles");
+}
+
+// The durations of the "GPU Frame" zones of a trace saved by Profiler::WriteChromeTrace, in
+// milliseconds. Every zone is on a line of its own.
+static bool LoadTrace(const std::string& path, std::vector<float>* trace)
+{
+	std::ifstream stream(path);
+	if (!stream)
+	{
+		return false;
+	}
+
+	std::string line;
+	while (std::getline(stream, line))
+	{
+		if (line.find("\"name\":\"GPU Frame\"") == std::string::npos)
+		{
+			continue;
+		}
+		size_t duration = line.find("\"dur\":");
+		if (duration != std::string::npos)
+		{
+			trace->push_back(strtof(line.c_str() + duration + 6, nullptr) / 1000.0f);
+		}
+	}
+	return true;
+}
+
+int main(int argc, char** argv)
+{
+	std::string tracePath;
+	ReplayOptions options = { 15.0f, 1.0f, 2 };
+	uint32_t seed = 1;
+
+	for (int i = 1; i < argc; i++)
+	{
+		std::string argument = argv[i];
+		if (argument == "--trace" && i + 1 < argc)
+		{
+			tracePath = argv[++i];
+		}
+		else if (argument == "--target" && i + 1 < argc)
+		{
+			options.targetMilliseconds = (std::max)(strtof(argv[++i], nullptr), 1.0f);
+		}
+		else if (argument == "--fixed" && i + 1 < argc)
+		{
+			options.fixedMilliseconds = (std::max)(strtof(argv[++i], nullptr), 0.0f);
+		}
+		else if (argument == "--latency" && i + 1 < argc)
+		{
+			options.latency = (std::min)((std::max)(static_cast<uint32_t>(strtoul(argv[++i], nullptr, 10)), 1u), FrameLatency);
+		}
+		else if (argument == "--seed" && i + 1 < argc)
+		{
+			seed = static_cast<uint32_t>(strtoul(argv[++i], nullptr, 10));
+		}
+		else
+		{
+			fprintf(stderr, "%s: unknown option\n", argument.c_str());
+			fprintf(stderr, "Usage: %s [--trace <FrameTrace.json>] [--target <ms>] [--fixed <ms>] [--latency <frames>] [--seed <value>]\n", argv[0]);
+			return 1;
+		}
+	}
+	options.fixedMilliseconds = (std::min)(options.fixedMilliseconds, options.targetMilliseconds * 0.5f);
+
+	std::mt19937 random(seed);
+	CheckController();
+	CheckReplays(options, random);
+
+	if (!tracePath.empty())
+	{
+		std::vector<float> trace;
+		if (!LoadTrace(tracePath, &trace))
+		{
+			fprintf(stderr, "%s: can't open\n", tracePath.c_str());
+			return 1;
+		}
+		if (trace.empty())
+		{
+			fprintf(stderr, "%s: no GPU Frame zones\n", tracePath.c_str());
+			return 1;
+		}
+
+		Replay replay = RunReplay(trace, options);
+		PrintHeader();
+		PrintRow("recorded", replay, options.targetMilliseconds);
+		printf("\n");
+		Expect(replay.inLimits, "recorded: every applied scale is between the limits and a whole number of steps");
+	}
+
+	return ReportChecks();
+}
@@ -0,0 +1,89 @@
+﻿// Packs compiled shader variants into one archive for DX::ShaderLibrary to load.
+//
+// Usage: ShaderArchiveBuilder <archive> <variant.cso>...
+//
+// Compile every variant first, naming each output as DX::GetShaderVariantFileName does; with
+// FxCompile, set ObjectFileOutput to $(OutDir)Name_<mask>.cso and PreprocessorDefinitions to the
+// variant's defines. The builder recovers each variant's key from its file name and stores
+// bytecode that several variants share only once.
+//
+// This is a standalone tool rather than part of the app. It only depends on the standard library
+// and the portable archive headers, so it builds with any C++17 compiler:
+//
+//   cl /std:c++17 /EHsc ShaderArchiveBuilder.cpp
+//   g++ -std=c++17 ShaderArchiveBuilder.cpp -o ShaderArchiveBuilder
+
+#include <cstdio>
+#include <fstream>
+#include <iterator>
+#include <string>
+#include <vector>
+#include "../Common/ShaderArchive.h"
+#include "../Common/ShaderPermutation.h"
+
+static bool ReadFile(const std::string& path, std::vector<uint8_t>* data)
+{
+	std::ifstream file(path, std::ios::binary);
+	if (!file)
+	{
+		return false;
+	}
+
+	data->assign(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+	return !file.bad();
+}
+
+int main(int argc, char** argv)
+{
+	if (argc < 3)
+	{
+		fprintf(stderr, "Usage: %s <archive> <variant.cso>...\n", argv[0]);
+		return 1;
+	}
+
+	DX::ShaderArchiveWriter writer;
+	size_t inputSize = 0;
+
+	for (int i = 2; i < argc; i++)
+	{
+		std::string path = argv[i];
+		std::string fileName = path.substr(path.find_last_of("/\\") + 1);
+
+		std::string name;
+		uint32_t features;
+		if (!DX::ParseShaderVariantFileName(fileName, &name, &features))
+		{
+			fprintf(stderr, "%s: not a compiled shader variant (expected Name.cso or Name_<mask>.cso)\n", path.c_str());
+			return 1;
+		}
+
+		std::vector<uint8_t> bytecode;
+		if (!ReadFile(path, &bytecode))
+		{
+			fprintf(stderr, "%s: can't read the file\n", path.c_str());
+			return 1;
+		}
+
+		if (!writer.Add(DX::MakeShaderVariantKey(name, features), bytecode.data(), bytecode.size()))
+		{
+			fprintf(stderr, "%s: variant %s with features 0x%x was already added\n", path.c_str(), name.c_str(), features);
+			return 1;
+		}
+
+		inputSize += bytecode.size();
+	}
+
+	std::vector<uint8_t> archive = writer.Serialize();
+
+	std::ofstream file(argv[1], std::ios::binary | std::ios::trunc);
+	file.write(reinterpret_cast<const char*>(archive.data()), static_cast<std::streamsize>(archive.size()));
+	if (!file)
+	{
+		fprintf(stderr, "%s: can't write the archive\n", argv[1]);
+		return 1;
+	}
+
+	printf("%s: %zu variants, %zu unique, %zu bytes of bytecode in %zu bytes\n",
+		argv[1], writer.GetVariantCount(), writer.GetBlobCount(), inputSize, archive.size());
+	return 0;
+}
@@ -0,0 +1,397 @@
+﻿// Checks shader archives end to end: writes a small fixture of compiled variants named as
+// DX::GetShaderVariantFileName names them, packs it with ShaderArchiveBuilder, and reads the
+// archive back with DX::ShaderArchive the way ShaderLibrary does. Every variant must be found
+// with its exact bytecode, variants that weren't packed must not be, and damaged or truncated
+// archives must be rejected by Open rather than read out of bounds.
+//
+// Usage: ShaderArchiveTest [options]
+//
+//   --builder <path>				The ShaderArchiveBuilder to run. The default is
+//									./ShaderArchiveBuilder.
+//   --directory <path>				Where to write the fixture and the archive. The default is
+//									ShaderArchiveTestFixture.
+//   --seed <value>					Seed for the fixture's bytecode and the damage done to the
+//									archive. The default is 1.
+//
+// Build the builder next to it:
+//
+//   g++ -std=c++17 -O2 ShaderArchiveBuilder.cpp -o ShaderArchiveBuilder
+//   g++ -std=c++17 -O2 ShaderArchiveTest.cpp -o ShaderArchiveTest
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <memory>
+#include <random>
+#include <string>
+#include <vector>
+#include "../Common/ShaderArchive.h"
+#include "../Common/ShaderPermutation.h"
+#include "Check.h"
+
+// One compiled variant in the fixture.
+struct FixtureVariant
+{
+	std::string				name;
+	uint32_t				features;
+	std::vector<uint8_t>	bytecode;
+};
+
+// The app's shaders and a few of their variants. Some variants compile to the same bytecode,
+// as variants whose features don't affect a stage do, and one is empty.
+static std::vector<FixtureVariant> MakeFixture(std::mt19937& random)
+{
+	struct Shader
+	{
+		const char*	name;
+		uint32_t	features;
+		size_t		size;
+		int			sameAs;		// Index of an earlier variant with the same bytecode, or -1.
+	};
+
+	static const Shader shaders[] =
+	{
+		{ "SampleVertexShader",				0,		1532,	-1 },
+		{ "SampleVertexShader",				0x1,	1960,	-1 },
+		{ "SamplePixelShader",				0,		612,	-1 },
+		{ "SamplePixelShader",				0x1,	612,	2 },
+		{ "SampleInstancedVertexShader",	0,		2204,	-1 },
+		{ "SampleCullingComputeShader",		0,		3120,	-1 },
+		{ "SpriteVertexShader",				0,		1404,	-1 },
+		{ "SpritePixelShader",				0,		720,	-1 },
+		{ "SpriteDistanceFieldPixelShader",	0,		988,	-1 },
+		{ "SpriteDistanceFieldPixelShader",	0xa0,	1012,	-1 },
+		{ "SpriteDistanceFieldPixelShader",	0x80000000,	988, 8 },
+		{ "FullscreenVertexShader",			0,		0,		-1 },
+		{ "TemporalResolvePixelShader",		0x3,	2777,	-1 },
+	};
+
+	std::vector<FixtureVariant> fixture;
+	for (const Shader& shader : shaders)
+	{
+		FixtureVariant variant = { shader.name, shader.features, {} };
+		if (shader.sameAs >= 0)
+		{
+			variant.bytecode = fixture[shader.sameAs].bytecode;
+		}
+		else
+		{
+			// Starts like DXBC, so that every blob shares a prefix as real bytecode does.
+			variant.bytecode.resize(shader.size);
+			for (size_t i = 0; i < shader.size; i++)
+			{
+				variant.bytecode[i] = i < 4 ? static_cast<uint8_t>("DXBC"[i]) : static_cast<uint8_t>(random());
+			}
+		}
+		fixture.push_back(variant);
+	}
+	return fixture;
+}
+
+static bool WriteFile(const std::filesystem::path& path, const std::vector<uint8_t>& data)
+{
+	std::ofstream file(path, std::ios::binary | std::ios::trunc);
+	file.write(reinterpret_cast<const char*>(data.data()), static_cast<std::streamsize>(data.size()));
+	return static_cast<bool>(file);
+}
+
+static bool ReadFile(const std::filesystem::path& path, std::vector<uint8_t>& data)
+{
+	std::ifstream file(path, std::ios::binary);
+	if (!file)
+	{
+		return false;
+	}
+	data.assign(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+	return !file.bad();
+}
+
+static int RunBuilder(const std::string& builder, const std::filesystem::path& archive, const std::vector<std::filesystem::path>& inputs)
+{
+	std::string command = "\"" + builder + "\" \"" + archive.string() + "\"";
+	for (const std::filesystem::path& input : inputs)
+	{
+		command += " \"" + input.string() + "\"";
+	}
+	return std::system(command.c_str());
+}
+
+// Opens a copy of the data in a buffer of exactly its size, so that the address sanitizer
+// catches any read past the end, and looks every key up.
+static bool OpenAndFindAll(const std::vector<uint8_t>& data, const std::vector<uint64_t>& keys, bool* inBounds)
+{
+	// new[] returns memory aligned for any fundamental type, which the archive requires.
+	std::unique_ptr<uint8_t[]> exact(new uint8_t[data.size()]);
+	if (!data.empty())
+	{
+		memcpy(exact.get(), data.data(), data.size());
+	}
+
+	DX::ShaderArchive archive;
+	if (!archive.Open(exact.get(), data.size()))
+	{
+		return false;
+	}
+
+	for (uint64_t key : keys)
+	{
+		DX::ShaderBytecode bytecode = {};
+		if (archive.Find(key, &bytecode))
+		{
+			auto begin = static_cast<const uint8_t*>(bytecode.data);
+			*inBounds = *inBounds && begin >= exact.get() && begin + bytecode.size <= exact.get() + data.size();
+		}
+	}
+	return true;
+}
+
+static void CheckArchive(const std::string& builder, const std::filesystem::path& directory, std::mt19937& random)
+{
+	std::error_code error;
+	std::filesystem::create_directories(directory, error);
+
+	std::vector<FixtureVariant> fixture = MakeFixture(random);
+	std::vector<std::filesystem::path> inputs;
+	bool written = true;
+	for (const FixtureVariant& variant : fixture)
+	{
+		inputs.push_back(directory / DX::GetShaderVariantFileName(variant.name, variant.features));
+		written = written && WriteFile(inputs.back(), variant.bytecode);
+	}
+	Expect(written, "fixture: the compiled variants are written");
+
+	std::filesystem::path archivePath = directory / "Shaders.dxsa";
+	std::filesystem::path rebuiltPath = directory / "Rebuilt.dxsa";
+	int result = RunBuilder(builder, archivePath, inputs);
+	int rebuiltResult = RunBuilder(builder, rebuiltPath, inputs);
+	Expect(result == 0 && rebuiltResult == 0, "builder: packs the fixture");
+
+	std::vector<uint8_t> data;
+	std::vector<uint8_t> rebuilt;
+	if (result != 0 || !ReadFile(archivePath, data) || !ReadFile(rebuiltPath, rebuilt))
+	{
+		Expect(false, "builder: the archive can be read back");
+		return;
+	}
+	Expect(data == rebuilt, "builder: the same inputs give the same file");
+
+	// Read the archive in place from memory that, like a mapped view, is 8-byte aligned.
+	std::vector<uint64_t> aligned((data.size() + 7) / 8);
+	memcpy(aligned.data(), data.data(), data.size());
+	DX::ShaderArchive archive;
+	Expect(archive.Open(aligned.data(), data.size()), "archive: Open accepts the builder's output");
+	Expect(archive.GetBlobCount() == fixture.size() - 2, "archive: variants with the same bytecode share a blob");
+
+	bool allFound = true;
+	bool aligned16 = true;
+	std::vector<uint64_t> keys;
+	for (const FixtureVariant& variant : fixture)
+	{
+		uint64_t key = DX::MakeShaderVariantKey(variant.name, variant.features);
+		keys.push_back(key);
+
+		DX::ShaderBytecode bytecode = {};
+		bool found = archive.Find(key, &bytecode) && bytecode.size == variant.bytecode.size() &&
+			(bytecode.size == 0 || memcmp(bytecode.data, variant.bytecode.data(), bytecode.size) == 0);
+		allFound = allFound && found;
+
+		size_t offset = static_cast<size_t>(static_cast<const uint8_t*>(bytecode.data) - reinterpret_cast<const uint8_t*>(aligned.data()));
+		aligned16 = aligned16 && offset % DX::ShaderArchiveBlobAlignment == 0;
+	}
+	Expect(allFound, "archive: every variant is found with its exact bytecode");
+	Expect(aligned16, "archive: every blob starts on a 16-byte boundary");
+
+	// ShaderLibrary falls back to loose files for these, so they must be reported missing: the
+	// other feature masks of each shader, and shaders that aren't packed at all.
+	bool noneFound = true;
+	for (const FixtureVariant& variant : fixture)
+	{
+		for (uint32_t features = 0; features < 256; features++)
+		{
+			uint64_t key = DX::MakeShaderVariantKey(variant.name, features);
+			DX::ShaderBytecode bytecode = {};
+			bool packed = std::find(keys.begin(), keys.end(), key) != keys.end();
+			noneFound = noneFound && (packed || !archive.Find(key, &bytecode));
+		}
+	}
+	static const char* const unpacked[] = { "", "SampleVertexShader_1", "samplevertexshader", "MissingShader" };
+	for (const char* name : unpacked)
+	{
+		DX::ShaderBytecode bytecode = {};
+		noneFound = noneFound && !archive.Find(DX::MakeShaderVariantKey(name), &bytecode);
+	}
+	Expect(noneFound, "archive: variants that weren't packed are reported missing");
+
+	DX::ShaderArchive validated;
+	bool validatedFound = validated.OpenValidated(aligned.data(), data.size());
+	for (size_t i = 0; validatedFound && i < keys.size(); i++)
+	{
+		DX::ShaderBytecode bytecode = {};
+		validatedFound = validated.Find(keys[i], &bytecode) && bytecode.size == fixture[i].bytecode.size();
+	}
+	Expect(validatedFound, "archive: OpenValidated finds the same variants without reading the tables");
+
+	// Damaged archives. Each must be rejected by Open, which is what lets Find skip bounds
+	// checks.
+	bool inBounds = true;
+	bool truncatedRejected = true;
+	for (size_t size = 0; size < data.size(); size += (size < 512 ? 1 : 97))
+	{
+		std::vector<uint8_t> truncated(data.begin(), data.begin() + size);
+		truncatedRejected = truncatedRejected && !OpenAndFindAll(truncated, keys, &inBounds);
+	}
+	Expect(truncatedRejected, "damage: every truncated archive is rejected");
+
+	DX::ShaderArchiveHeader header;
+	memcpy(&header, data.data(), sizeof(header));
+	auto withHeader = [&data](void (*damage)(DX::ShaderArchiveHeader&))
+	{
+		std::vector<uint8_t> damaged = data;
+		DX::ShaderArchiveHeader changed;
+		memcpy(&changed, damaged.data(), sizeof(changed));
+		damage(changed);
+		memcpy(damaged.data(), &changed, sizeof(changed));
+		return damaged;
+	};
+
+	bool headerRejected =
+		!OpenAndFindAll(withHeader([](DX::ShaderArchiveHeader& h) { h.magic ^= 1; }), keys, &inBounds) &&
+		!OpenAndFindAll(withHeader([](DX::ShaderArchiveHeader& h) { h.version++; }), keys, &inBounds) &&
+		!OpenAndFindAll(withHeader([](DX::ShaderArchiveHeader& h) { h.fileSize--; }), keys, &inBounds) &&
+		!OpenAndFindAll(withHeader([](DX::ShaderArchiveHeader& h) { h.slotCount = 0; }), keys, &inBounds) &&
+		!OpenAndFindAll(withHeader([](DX::ShaderArchiveHeader& h) { h.slotCount--; }), keys, &inBounds) &&
+		!OpenAndFindAll(withHeader([](DX::ShaderArchiveHeader& h) { h.slotCount *= 2; }), keys, &inBounds) &&
+		!OpenAndFindAll(withHeader([](DX::ShaderArchiveHeader& h) { h.blobCount = 1u << 30; }), keys, &inBounds) &&
+		!OpenAndFindAll(withHeader([](DX::ShaderArchiveHeader& h) { h.slotsOffset += 4; }), keys, &inBounds) &&
+		!OpenAndFindAll(withHeader([](DX::ShaderArchiveHeader& h) { h.blobsOffset = h.fileSize; }), keys, &inBounds);
+	Expect(headerRejected, "damage: bad magic, version, size, slot count and table offsets are rejected");
+
+	// A slot pointing past the blob table, a blob past the end of the file, and a table with no
+	// empty slot, which would make lookups of missing keys probe forever.
+	std::vector<uint8_t> badSlot = data;
+	std::vector<uint8_t> badBlob = data;
+	std::vector<uint8_t> fullTable = data;
+	for (uint32_t i = 0; i < header.slotCount; i++)
+	{
+		DX::ShaderArchiveSlot slot;
+		size_t slotOffset = static_cast<size_t>(header.slotsOffset) + i * sizeof(slot);
+		memcpy(&slot, data.data() + slotOffset, sizeof(slot));
+		if (slot.blob != DX::ShaderArchiveNoBlob)
+		{
+			slot.blob = header.blobCount;
+			memcpy(badSlot.data() + slotOffset, &slot, sizeof(slot));
+		}
+		else
+		{
+			slot = { 0x123456789ull + i, 0, 0 };
+			memcpy(fullTable.data() + slotOffset, &slot, sizeof(slot));
+		}
+	}
+	DX::ShaderArchiveBlob blob;
+	size_t blobOffset = static_cast<size_t>(header.blobsOffset) + (header.blobCount - 1) * sizeof(blob);
+	memcpy(&blob, data.data() + blobOffset, sizeof(blob));
+	blob.size += 1;
+	memcpy(badBlob.data() + blobOffset, &blob, sizeof(blob));
+	Expect(!OpenAndFindAll(badSlot, keys, &inBounds) && !OpenAndFindAll(badBlob, keys, &inBounds) && !OpenAndFindAll(fullTable, keys, &inBounds),
+		"damage: bad slot and blob entries and a full slot table are rejected");
+
+	// Random damage to the header and tables. Whatever Open accepts must be safe to look up in.
+	size_t tablesEnd = static_cast<size_t>(header.blobsOffset) + header.blobCount * sizeof(DX::ShaderArchiveBlob);
+	uint32_t accepted = 0;
+	const uint32_t attempts = 20000;
+	for (uint32_t attempt = 0; attempt < attempts; attempt++)
+	{
+		std::vector<uint8_t> damaged = data;
+		for (uint32_t flips = 1 + random() % 4; flips > 0; flips--)
+		{
+			damaged[random() % tablesEnd] ^= static_cast<uint8_t>(1u << (random() % 8));
+		}
+		accepted += OpenAndFindAll(damaged, keys, &inBounds) ? 1 : 0;
+	}
+	char description[160];
+	snprintf(description, sizeof(description), "damage: lookups stay inside the file for all %u randomly damaged archives, %u of them accepted",
+		attempts, accepted);
+	Expect(inBounds, description);
+
+	// The builder refuses inputs it can't key.
+	std::filesystem::path duplicate = directory / "copy";
+	std::filesystem::create_directories(duplicate, error);
+	std::filesystem::path duplicateInput = duplicate / DX::GetShaderVariantFileName(fixture[1].name, fixture[1].features);
+	std::filesystem::path badName = directory / "Readme.txt";
+	bool rejected = WriteFile(duplicateInput, fixture[1].bytecode) && WriteFile(badName, fixture[0].bytecode);
+	std::vector<std::filesystem::path> withDuplicate = inputs;
+	withDuplicate.push_back(duplicateInput);
+	rejected = rejected && RunBuilder(builder, directory / "Duplicate.dxsa", withDuplicate) != 0;
+	rejected = rejected && RunBuilder(builder, directory / "BadName.dxsa", { inputs[0], badName }) != 0;
+	rejected = rejected && RunBuilder(builder, directory / "Missing.dxsa", { directory / "Missing.cso" }) != 0;
+	Expect(rejected, "builder: a duplicate variant, a file that isn't a variant and a missing file are errors");
+}
+
+// ShaderLibrary opens loose files by the names GetShaderVariantFileName gives, and the builder
+// keys files by parsing those names, so the two must agree for every shader and mask.
+static void CheckFileNames(std::mt19937& random)
+{
+	static const char* const names[] = { "SampleVertexShader", "Sprite_PixelShader", "Shader_zz", "A", "Blur_" };
+	bool roundTrips = true;
+	for (const char* name : names)
+	{
+		for (int i = 0; i < 1000; i++)
+		{
+			uint32_t features = i < 64 ? static_cast<uint32_t>(i) : static_cast<uint32_t>(random());
+			std::string parsedName;
+			uint32_t parsedFeatures = 0;
+			roundTrips = roundTrips && DX::ParseShaderVariantFileName(DX::GetShaderVariantFileName(name, features), &parsedName, &parsedFeatures) &&
+				parsedName == name && parsedFeatures == features;
+		}
+	}
+	Expect(roundTrips, "names: every shader and feature mask round-trips through its file name");
+
+	std::string name;
+	uint32_t features = 0;
+	bool ok = DX::ParseShaderVariantFileName("Shader_0.cso", &name, &features) && name == "Shader_0" && features == 0 &&
+		DX::ParseShaderVariantFileName("Shader_0ff.cso", &name, &features) && name == "Shader_0ff" && features == 0 &&
+		DX::ParseShaderVariantFileName("Shader_123456789.cso", &name, &features) && name == "Shader_123456789" && features == 0 &&
+		DX::ParseShaderVariantFileName("Shader_FF.cso", &name, &features) && name == "Shader_FF" && features == 0 &&
+		!DX::ParseShaderVariantFileName(".cso", &name, &features) && !DX::ParseShaderVariantFileName("Shader.hlsl", &name, &features);
+	Expect(ok, "names: suffixes that aren't canonical masks stay part of the name, and other files are refused");
+}
+
+int main(int argc, char** argv)
+{
+	std::string builder = "./ShaderArchiveBuilder";
+	std::string directory = "ShaderArchiveTestFixture";
+	uint32_t seed = 1;
+
+	for (int i = 1; i < argc; i++)
+	{
+		std::string argument = argv[i];
+		if (argument == "--builder" && i + 1 < argc)
+		{
+			builder = argv[++i];
+		}
+		else if (argument == "--directory" && i + 1 < argc)
+		{
+			directory = argv[++i];
+		}
+		else if (argument == "--seed" && i + 1 < argc)
+		{
+			seed = static_cast<uint32_t>(strtoul(argv[++i], nullptr, 10));
+		}
+		else
+		{
+			fprintf(stderr, "%s: unknown option\n", argument.c_str());
+			fprintf(stderr, "Usage: %s [--builder <path>] [--directory <path>] [--seed <value>]\n", argv[0]);
+			return 1;
+		}
+	}
+
+	std::mt19937 random(seed);
+	CheckArchive(builder, directory, random);
+	CheckFileNames(random);
+
+	return ReportChecks();
+}
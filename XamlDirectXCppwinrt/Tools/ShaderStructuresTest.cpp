@@ -0,0 +1,585 @@
+﻿// Checks the structures C++ shares with the shaders against what the shaders declare.
+// ShaderStructures.hlsli must be exactly what GenerateShaderStructuresHlsl generates from the
+// layouts in ShaderStructures.h. The generated declarations must parse back to the same
+// layouts, and data written through the C++ structures must read back from the offsets the
+// HLSL packing rules give the declarations. The sample's vertex shaders must read the
+// attributes VertexPositionColorLayout provides. It also checks that DX::FindShaderPackingMismatch
+// rejects structures the rules don't allow.
+//
+// Usage: ShaderStructuresTest [options]
+//
+//   --content <directory>			The Content directory holding ShaderStructures.hlsli and the
+//									sample's shaders. The default is ../Content.
+//   --write						Rewrites ShaderStructures.hlsli from the layouts, for after a
+//									shared structure changes, then checks it.
+//
+// Build it with:
+//
+//   g++ -std=c++17 -O2 ShaderStructuresTest.cpp -o ShaderStructuresTest
+
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#if defined(_WIN32)
+#include <d3d11.h>
+#include <DirectXMath.h>
+#else
+// The parts of the Direct3D and DirectXMath headers the shared structures use, with their
+// values from dxgiformat.h and d3d11.h.
+enum DXGI_FORMAT
+{
+	DXGI_FORMAT_UNKNOWN = 0,
+	DXGI_FORMAT_R32G32B32A32_FLOAT = 2,
+	DXGI_FORMAT_R32G32B32_FLOAT = 6,
+	DXGI_FORMAT_R16G16B16A16_FLOAT = 10,
+	DXGI_FORMAT_R16G16B16A16_SNORM = 13,
+	DXGI_FORMAT_R32G32_FLOAT = 16,
+	DXGI_FORMAT_R10G10B10A2_UNORM = 24,
+	DXGI_FORMAT_R8G8B8A8_UNORM = 28,
+	DXGI_FORMAT_R16G16_FLOAT = 34,
+	DXGI_FORMAT_R16G16_SNORM = 37,
+};
+
+enum D3D11_INPUT_CLASSIFICATION
+{
+	D3D11_INPUT_PER_VERTEX_DATA = 0,
+	D3D11_INPUT_PER_INSTANCE_DATA = 1,
+};
+
+struct D3D11_INPUT_ELEMENT_DESC
+{
+	const char*					SemanticName;
+	uint32_t					SemanticIndex;
+	DXGI_FORMAT					Format;
+	uint32_t					InputSlot;
+	uint32_t					AlignedByteOffset;
+	D3D11_INPUT_CLASSIFICATION	InputSlotClass;
+	uint32_t					InstanceDataStepRate;
+};
+
+namespace DirectX
+{
+	struct XMFLOAT2 { float x, y; };
+	struct XMFLOAT3 { float x, y, z; };
+	struct XMFLOAT4 { float x, y, z, w; };
+	struct XMFLOAT4X4 { float m[4][4]; };
+}
+#endif
+
+#include "../Content/ShaderStructures.h"
+#include "Check.h"
+
+using namespace winrt::$projectname$::implementation;
+
+static bool ReadText(const std::string& path, std::string& text)
+{
+	std::ifstream file(path, std::ios::binary);
+	if (!file)
+	{
+		return false;
+	}
+
+	std::ostringstream contents;
+	contents << file.rdbuf();
+	text = contents.str();
+
+	// Git may check the file out with CRLF line endings, and editors may add a byte order mark;
+	// neither changes what the shader compiler sees.
+	if (text.compare(0, 3, "\xEF\xBB\xBF") == 0)
+	{
+		text.erase(0, 3);
+	}
+	std::string normalized;
+	for (char c : text)
+	{
+		if (c != '\r')
+		{
+			normalized += c;
+		}
+	}
+	text = normalized;
+	return true;
+}
+
+static std::vector<std::string> SplitLines(const std::string& text)
+{
+	std::vector<std::string> lines;
+	std::istringstream stream(text);
+	std::string line;
+	while (std::getline(stream, line))
+	{
+		lines.push_back(line);
+	}
+	return lines;
+}
+
+static void CheckGeneratedFile(const std::string& contentDirectory, bool write)
+{
+	std::string path = contentDirectory + "/ShaderStructures.hlsli";
+	std::string generated = GenerateShaderStructuresHlsl();
+
+	if (write)
+	{
+		std::ofstream file(path, std::ios::binary);
+		file << generated;
+		Expect(static_cast<bool>(file), ("wrote " + path).c_str());
+	}
+
+	std::string checkedIn;
+	if (!ReadText(path, checkedIn))
+	{
+		Expect(false, ("can't read " + path).c_str());
+		return;
+	}
+
+	// Point at the first line that differs, which is what someone fixing it needs.
+	std::vector<std::string> expectedLines = SplitLines(generated);
+	std::vector<std::string> actualLines = SplitLines(checkedIn);
+	size_t line = 0;
+	while (line < expectedLines.size() && line < actualLines.size() && expectedLines[line] == actualLines[line])
+	{
+		line++;
+	}
+
+	bool same = checkedIn == generated;
+	if (!same)
+	{
+		printf("       line %zu of %s is\n         %s\n       but the layouts generate\n         %s\n", line + 1, path.c_str(),
+			line < actualLines.size() ? actualLines[line].c_str() : "(the end of the file)",
+			line < expectedLines.size() ? expectedLines[line].c_str() : "(the end of the file)");
+	}
+	Expect(same, "ShaderStructures.hlsli is what the layouts in ShaderStructures.h generate; rerun with --write if a structure changed");
+}
+
+// A declaration read back from generated HLSL.
+struct ParsedField
+{
+	std::string	type;
+	std::string	name;
+	uint32_t	arrayCount;
+};
+
+struct ParsedStruct
+{
+	bool						constantBuffer;
+	std::string					name;
+	uint32_t					registerIndex;
+	std::vector<ParsedField>	fields;
+};
+
+// Reads the declarations in the form GenerateHlsl writes them. Returns false on anything else.
+static bool ParseHlsl(const std::string& hlsl, std::vector<ParsedStruct>& structs)
+{
+	std::vector<std::string> lines = SplitLines(hlsl);
+	for (size_t i = 0; i < lines.size(); i++)
+	{
+		const std::string& line = lines[i];
+		if (line.empty() || line.compare(0, 2, "//") == 0)
+		{
+			continue;
+		}
+
+		ParsedStruct parsed = {};
+		char name[128] = {};
+		unsigned registerIndex = 0;
+		if (sscanf(line.c_str(), "cbuffer %127s : register(b%u)", name, &registerIndex) == 2)
+		{
+			parsed.constantBuffer = true;
+		}
+		else if (sscanf(line.c_str(), "struct %127s", name) != 1)
+		{
+			return false;
+		}
+		parsed.name = name;
+		parsed.registerIndex = registerIndex;
+
+		if (++i >= lines.size() || lines[i] != "{")
+		{
+			return false;
+		}
+		for (i++; i < lines.size() && lines[i] != "};"; i++)
+		{
+			// "\t<type> <name>;" or "\t<type> <name>[<count>];", where the type may be
+			// "row_major float4x4".
+			const std::string& declaration = lines[i];
+			size_t nameStart = declaration.rfind(' ');
+			if (declaration.empty() || declaration[0] != '\t' || nameStart == std::string::npos || declaration.back() != ';')
+			{
+				return false;
+			}
+
+			ParsedField field = {};
+			field.type = declaration.substr(1, nameStart - 1);
+			field.name = declaration.substr(nameStart + 1, declaration.size() - nameStart - 2);
+			size_t bracket = field.name.find('[');
+			if (bracket != std::string::npos)
+			{
+				field.arrayCount = static_cast<uint32_t>(strtoul(field.name.c_str() + bracket + 1, nullptr, 10));
+				field.name.erase(bracket);
+			}
+			parsed.fields.push_back(field);
+		}
+		if (i >= lines.size())
+		{
+			return false;
+		}
+		structs.push_back(parsed);
+	}
+	return true;
+}
+
+template<size_t TFieldCount>
+static bool MatchesParsed(const DX::ShaderStructLayout<TFieldCount>& layout, const ParsedStruct& parsed)
+{
+	bool ok = parsed.name == layout.name && parsed.constantBuffer == (layout.packing == DX::ShaderPacking::ConstantBuffer) &&
+		parsed.fields.size() == TFieldCount;
+	if (ok && parsed.constantBuffer)
+	{
+		ok = parsed.registerIndex == layout.registerIndex;
+	}
+	for (size_t i = 0; ok && i < TFieldCount; i++)
+	{
+		ok = parsed.fields[i].type == DX::GetShaderTypeName(layout.fields[i].type) &&
+			parsed.fields[i].name == layout.fields[i].name &&
+			parsed.fields[i].arrayCount == layout.fields[i].arrayCount;
+	}
+	return ok;
+}
+
+// The size of an HLSL type, from its name rather than from ShaderReflection.h, so that the
+// offsets below don't depend on the code they check.
+static uint32_t GetHlslTypeSize(const std::string& type)
+{
+	if (type == "row_major float4x4")
+	{
+		return 64;
+	}
+
+	static const char* const scalars[] = { "float", "int", "uint" };
+	for (const char* scalar : scalars)
+	{
+		size_t length = strlen(scalar);
+		if (type.compare(0, length, scalar) == 0)
+		{
+			if (type.size() == length)
+			{
+				return 4;
+			}
+			if (type.size() == length + 1 && type[length] >= '2' && type[length] <= '4')
+			{
+				return 4 * static_cast<uint32_t>(type[length] - '0');
+			}
+		}
+	}
+	return 0;
+}
+
+// Where the shader reads each element of each field: the offsets of the fields' 4-byte words,
+// in order. In a constant buffer a value doesn't straddle a 16-byte register, and matrices and
+// arrays start a new one, with each array element in a register of its own.
+static std::vector<std::vector<uint32_t>> GetHlslWordOffsets(const ParsedStruct& parsed)
+{
+	std::vector<std::vector<uint32_t>> offsets;
+	uint32_t offset = 0;
+	for (const ParsedField& field : parsed.fields)
+	{
+		uint32_t size = GetHlslTypeSize(field.type);
+		uint32_t count = field.arrayCount > 0 ? field.arrayCount : 1;
+		uint32_t stride = size;
+		if (parsed.constantBuffer)
+		{
+			bool newRegister = field.arrayCount > 0 || size > 16 || (offset % 16) + size > 16;
+			offset = newRegister ? (offset + 15) / 16 * 16 : offset;
+			stride = field.arrayCount > 0 ? (size + 15) / 16 * 16 : size;
+		}
+
+		std::vector<uint32_t> words;
+		for (uint32_t element = 0; element < count; element++)
+		{
+			for (uint32_t word = 0; word < size / 4; word++)
+			{
+				words.push_back(offset + element * stride + word * 4);
+			}
+		}
+		offsets.push_back(words);
+		offset += stride * (count - 1) + size;
+	}
+	return offsets;
+}
+
+// Fills a structure with distinct words, reads each member the way the shader would from its
+// declaration, and compares that with the member's own words. members lists where each
+// member is in C++, in declaration order.
+template<typename TStruct>
+static bool RoundTrips(const ParsedStruct& parsed, const std::vector<std::pair<size_t, size_t>>& members)
+{
+	static_assert(sizeof(TStruct) % 4 == 0, "Shared structures are made of 4-byte words.");
+	TStruct data;
+	std::vector<uint32_t> words(sizeof(TStruct) / 4);
+	for (size_t i = 0; i < words.size(); i++)
+	{
+		words[i] = 0x1000u + static_cast<uint32_t>(i);
+	}
+	memcpy(&data, words.data(), sizeof(data));
+
+	std::vector<std::vector<uint32_t>> offsets = GetHlslWordOffsets(parsed);
+	if (offsets.size() != members.size())
+	{
+		return false;
+	}
+
+	const uint8_t* bytes = reinterpret_cast<const uint8_t*>(&data);
+	for (size_t field = 0; field < members.size(); field++)
+	{
+		size_t memberOffset = members[field].first;
+		size_t memberSize = members[field].second;
+		if (offsets[field].size() * 4 != memberSize)
+		{
+			return false;
+		}
+		for (size_t word = 0; word < offsets[field].size(); word++)
+		{
+			uint32_t shaderValue;
+			uint32_t cppValue;
+			if (offsets[field][word] + 4 > sizeof(TStruct))
+			{
+				return false;
+			}
+			memcpy(&shaderValue, bytes + offsets[field][word], 4);
+			memcpy(&cppValue, bytes + memberOffset + word * 4, 4);
+			if (shaderValue != cppValue)
+			{
+				return false;
+			}
+		}
+	}
+	return true;
+}
+
+#define MEMBER(TStruct, Member) std::make_pair(offsetof(TStruct, Member), sizeof(TStruct::Member))
+
+static void CheckDeclarations()
+{
+	std::vector<ParsedStruct> parsed;
+	bool ok = ParseHlsl(GenerateShaderStructuresHlsl(), parsed);
+	Expect(ok && parsed.size() == 3, "the generated HLSL parses as three declarations");
+	if (!ok || parsed.size() != 3)
+	{
+		return;
+	}
+
+	Expect(MatchesParsed(ModelViewProjectionConstantBufferLayout, parsed[0]), "ModelViewProjectionConstantBuffer: the declaration parses back to its layout");
+	Expect(MatchesParsed(InstanceDataLayout, parsed[1]), "InstanceData: the declaration parses back to its layout");
+	Expect(MatchesParsed(CullingConstantBufferLayout, parsed[2]), "CullingConstantBuffer: the declaration parses back to its layout");
+
+	Expect(RoundTrips<ModelViewProjectionConstantBuffer>(parsed[0], {
+			MEMBER(ModelViewProjectionConstantBuffer, model),
+			MEMBER(ModelViewProjectionConstantBuffer, view),
+			MEMBER(ModelViewProjectionConstantBuffer, projection) }),
+		"ModelViewProjectionConstantBuffer: the shader reads every member where C++ wrote it");
+	Expect(RoundTrips<InstanceData>(parsed[1], {
+			MEMBER(InstanceData, model),
+			MEMBER(InstanceData, bounds) }),
+		"InstanceData: the shader reads every member where C++ wrote it");
+	Expect(RoundTrips<CullingConstantBuffer>(parsed[2], {
+			MEMBER(CullingConstantBuffer, frustumPlanes),
+			MEMBER(CullingConstantBuffer, instanceCount),
+			MEMBER(CullingConstantBuffer, padding) }),
+		"CullingConstantBuffer: the shader reads every member where C++ wrote it");
+}
+
+// Structures that break the packing rules in each of the ways FindShaderPackingMismatch
+// reports, and ones that only look like they might.
+struct Straddling
+{
+	DirectX::XMFLOAT2 a;
+	DirectX::XMFLOAT3 b;	// HLSL moves this to the next register, C++ doesn't.
+	float c[3];
+};
+
+struct ScalarArray
+{
+	float values[4];		// HLSL gives each element its own register.
+};
+
+struct MatrixThenFloat
+{
+	DirectX::XMFLOAT4X4 matrix;
+	float value;			// The constant buffer is 80 bytes, the C++ structure 68.
+};
+
+struct MatrixThenFloatPadded
+{
+	DirectX::XMFLOAT4X4 matrix;
+	float value;
+	float padding[3];
+};
+
+struct Packed
+{
+	DirectX::XMFLOAT3 a;
+	float b;				// Fills the rest of a's register.
+	DirectX::XMFLOAT2 c;
+	DirectX::XMFLOAT2 d;
+};
+
+static void CheckPackingRules()
+{
+	constexpr auto straddling = DX::DescribeConstantBuffer<Straddling>("Straddling", 0,
+		DX_SHADER_FIELD(Straddling, a, Float2),
+		DX_SHADER_FIELD(Straddling, b, Float3),
+		DX_SHADER_FIELD(Straddling, c, Float3));
+	Expect(DX::FindShaderPackingMismatch(straddling) == 1, "packing: a float3 straddling two registers is reported");
+
+	constexpr auto scalarArray = DX::DescribeConstantBuffer<ScalarArray>("ScalarArray", 0,
+		DX_SHADER_FIELD(ScalarArray, values, Float));
+	constexpr auto scalarArrayStructured = DX::DescribeStructuredBuffer<ScalarArray>("ScalarArray",
+		DX_SHADER_FIELD(ScalarArray, values, Float));
+	Expect(DX::FindShaderPackingMismatch(scalarArray) == 0 && DX::MatchesShaderPacking(scalarArrayStructured),
+		"packing: a float[4] is reported in a constant buffer but fine in a structured buffer");
+
+	constexpr auto matrixThenFloat = DX::DescribeConstantBuffer<MatrixThenFloat>("MatrixThenFloat", 0,
+		DX_SHADER_FIELD(MatrixThenFloat, matrix, Float4x4),
+		DX_SHADER_FIELD(MatrixThenFloat, value, Float));
+	constexpr auto matrixThenFloatPadded = DX::DescribeConstantBuffer<MatrixThenFloatPadded>("MatrixThenFloatPadded", 0,
+		DX_SHADER_FIELD(MatrixThenFloatPadded, matrix, Float4x4),
+		DX_SHADER_FIELD(MatrixThenFloatPadded, value, Float),
+		DX_SHADER_FIELD(MatrixThenFloatPadded, padding, Float3));
+	Expect(DX::FindShaderPackingMismatch(matrixThenFloat) == 2 && DX::MatchesShaderPacking(matrixThenFloatPadded),
+		"packing: a constant buffer that isn't a whole number of registers is reported until it is padded");
+
+	constexpr auto packed = DX::DescribeConstantBuffer<Packed>("Packed", 0,
+		DX_SHADER_FIELD(Packed, a, Float3),
+		DX_SHADER_FIELD(Packed, b, Float),
+		DX_SHADER_FIELD(Packed, c, Float2),
+		DX_SHADER_FIELD(Packed, d, Float2));
+	constexpr auto wrongType = DX::DescribeConstantBuffer<Packed>("Packed", 0,
+		DX_SHADER_FIELD(Packed, a, Float4),
+		DX_SHADER_FIELD(Packed, b, Float),
+		DX_SHADER_FIELD(Packed, c, Float2),
+		DX_SHADER_FIELD(Packed, d, Float2));
+	Expect(DX::MatchesShaderPacking(packed) && DX::FindShaderPackingMismatch(wrongType) == 0,
+		"packing: values sharing registers match, and a member described with the wrong type is reported");
+
+	// The independent offsets used for the round trips agree with the checks on these too.
+	std::vector<ParsedStruct> parsed;
+	bool ok = ParseHlsl(DX::GenerateHlsl(packed) + DX::GenerateHlsl(matrixThenFloatPadded), parsed) && parsed.size() == 2 &&
+		RoundTrips<Packed>(parsed[0], { MEMBER(Packed, a), MEMBER(Packed, b), MEMBER(Packed, c), MEMBER(Packed, d) }) &&
+		RoundTrips<MatrixThenFloatPadded>(parsed[1], {
+			MEMBER(MatrixThenFloatPadded, matrix), MEMBER(MatrixThenFloatPadded, value), MEMBER(MatrixThenFloatPadded, padding) });
+	Expect(ok, "packing: structures that pass the checks round-trip through their generated HLSL");
+}
+
+// The attributes a vertex shader reads, from "<type> <name> : <SEMANTIC>;" lines in its
+// VertexShaderInput. System values are left out, since the input assembler generates them.
+struct ShaderInput
+{
+	std::string	semantic;
+	uint32_t	semanticIndex;
+	uint32_t	componentCount;
+};
+
+static bool ReadVertexShaderInputs(const std::string& path, std::vector<ShaderInput>& inputs)
+{
+	std::string text;
+	if (!ReadText(path, text))
+	{
+		return false;
+	}
+
+	std::vector<std::string> lines = SplitLines(text);
+	size_t i = 0;
+	while (i < lines.size() && lines[i] != "struct VertexShaderInput")
+	{
+		i++;
+	}
+	for (i += 2; i < lines.size() && lines[i] != "};"; i++)
+	{
+		char type[32] = {};
+		char name[64] = {};
+		char semantic[64] = {};
+		if (sscanf(lines[i].c_str(), " %31s %63s : %63[A-Za-z0-9_]", type, name, semantic) != 3)
+		{
+			return false;
+		}
+
+		std::string semanticName = semantic;
+		if (semanticName.compare(0, 3, "SV_") == 0)
+		{
+			continue;
+		}
+
+		// A trailing number is the semantic index: COLOR0 is COLOR, index 0.
+		size_t digits = semanticName.find_last_not_of("0123456789") + 1;
+		ShaderInput input = {};
+		input.semantic = semanticName.substr(0, digits);
+		input.semanticIndex = static_cast<uint32_t>(strtoul(semanticName.c_str() + digits, nullptr, 10));
+		input.componentCount = GetHlslTypeSize(type) / 4;
+		inputs.push_back(input);
+	}
+	return i < lines.size();
+}
+
+static void CheckVertexInputs(const std::string& contentDirectory)
+{
+	// The input assembler matches attributes by semantic, and expands each to four components
+	// so a shader may read fewer than the format stores.
+	auto elements = VertexPositionColorLayout::GetInputElements();
+	static const char* const shaders[] = { "SampleVertexShader.hlsl", "SampleInstancedVertexShader.hlsl" };
+	for (const char* shader : shaders)
+	{
+		std::vector<ShaderInput> inputs;
+		bool ok = ReadVertexShaderInputs(contentDirectory + "/" + shader, inputs) && inputs.size() == elements.size();
+		for (size_t i = 0; ok && i < inputs.size(); i++)
+		{
+			bool found = false;
+			for (size_t j = 0; j < elements.size(); j++)
+			{
+				found = found || (inputs[i].semantic == elements[j].SemanticName && inputs[i].semanticIndex == elements[j].SemanticIndex &&
+					inputs[i].componentCount >= 1 && inputs[i].componentCount <= DX::GetVertexFormatComponentCount(VertexPositionColorLayout::Formats[j]));
+			}
+			ok = found;
+		}
+
+		std::string description = std::string(shader) + ": reads exactly the attributes VertexPositionColorLayout provides";
+		Expect(ok, description.c_str());
+	}
+}
+
+int main(int argc, char** argv)
+{
+	std::string contentDirectory = "../Content";
+	bool write = false;
+
+	for (int i = 1; i < argc; i++)
+	{
+		std::string argument = argv[i];
+		if (argument == "--content" && i + 1 < argc)
+		{
+			contentDirectory = argv[++i];
+		}
+		else if (argument == "--write")
+		{
+			write = true;
+		}
+		else
+		{
+			fprintf(stderr, "%s: unknown option\n", argument.c_str());
+			fprintf(stderr, "Usage: %s [--content <directory>] [--write]\n", argv[0]);
+			return 1;
+		}
+	}
+
+	CheckGeneratedFile(contentDirectory, write);
+	CheckDeclarations();
+	CheckPackingRules();
+	CheckVertexInputs(contentDirectory);
+
+	return ReportChecks();
+}
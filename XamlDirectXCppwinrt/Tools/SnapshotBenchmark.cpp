@@ -0,0 +1,191 @@
+﻿// Times saving and restoring DX::StateSnapshot blobs like the one the app keeps while it is
+// suspended, for scenes of several sizes, and checks that each restores what was saved.
+//
+// Usage: SnapshotBenchmark [options]
+//
+//   --transforms <count>			Restore a scene of this many transforms instead of the
+//									default series, from the sample's one cube to 65536.
+//   --runs <count>					Snapshots saved and restored per scene; the fastest is
+//									reported. The default is 1000.
+//
+// The app's snapshot holds the StepTimer and the sample scene; larger scenes add a section of
+// 4x4 transforms, one per object. Build it with:
+//
+//   g++ -std=c++17 -O2 SnapshotBenchmark.cpp -o SnapshotBenchmark
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <vector>
+#include "../Common/StateSnapshot.h"
+#include "Check.h"
+
+// The same layout as DX::StepTimerState and the sample scene's state.
+struct TimerState
+{
+	uint64_t	totalTicks;
+	uint64_t	leftOverTicks;
+	uint32_t	frameCount;
+	uint32_t	reserved;
+};
+
+struct SceneState
+{
+	float		currentRadians;
+	float		previousRadians;
+	float		degreesPerSecond;
+};
+
+struct Transform
+{
+	float		m[4][4];
+};
+
+static const uint32_t TimerTag = DX::MakeStateSnapshotTag('T', 'I', 'M', 'E');
+static const uint32_t SceneTag = DX::MakeStateSnapshotTag('C', 'U', 'B', 'E');
+static const uint32_t TransformsTag = DX::MakeStateSnapshotTag('X', 'F', 'R', 'M');
+
+struct Scene
+{
+	TimerState				timer;
+	SceneState				scene;
+	std::vector<Transform>	transforms;
+};
+
+static std::vector<uint8_t> Save(const Scene& scene)
+{
+	DX::StateSnapshotWriter snapshot;
+	snapshot.Write(TimerTag, scene.timer);
+	snapshot.Write(SceneTag, scene.scene);
+	if (!scene.transforms.empty())
+	{
+		snapshot.Write(TransformsTag, scene.transforms.data(), scene.transforms.size() * sizeof(Transform));
+	}
+	return snapshot.Finish();
+}
+
+static bool Restore(const std::vector<uint8_t>& data, Scene* scene)
+{
+	DX::StateSnapshotReader snapshot;
+	if (!snapshot.Open(data.data(), data.size()) || !snapshot.Read(TimerTag, &scene->timer) || !snapshot.Read(SceneTag, &scene->scene))
+	{
+		return false;
+	}
+
+	const void* transforms;
+	size_t size;
+	if (snapshot.Find(TransformsTag, &transforms, &size))
+	{
+		if (size % sizeof(Transform) != 0)
+		{
+			return false;
+		}
+		scene->transforms.resize(size / sizeof(Transform));
+		memcpy(scene->transforms.data(), transforms, size);
+	}
+	else
+	{
+		scene->transforms.clear();
+	}
+	return true;
+}
+
+static Scene MakeScene(uint32_t transformCount)
+{
+	Scene scene = {};
+	scene.timer = { 1234567890123ull, 41666ull, 7407, 0 };
+	scene.scene = { 1.25f, 1.2f, 45.0f };
+	scene.transforms.resize(transformCount);
+	for (uint32_t i = 0; i < transformCount; i++)
+	{
+		for (uint32_t element = 0; element < 16; element++)
+		{
+			scene.transforms[i].m[element / 4][element % 4] = static_cast<float>(i * 16 + element) * 0.5f;
+		}
+	}
+	return scene;
+}
+
+static bool IsSameScene(const Scene& a, const Scene& b)
+{
+	return memcmp(&a.timer, &b.timer, sizeof(a.timer)) == 0 && memcmp(&a.scene, &b.scene, sizeof(a.scene)) == 0 &&
+		a.transforms.size() == b.transforms.size() &&
+		(a.transforms.empty() || memcmp(a.transforms.data(), b.transforms.data(), a.transforms.size() * sizeof(Transform)) == 0);
+}
+
+// Damaged, truncated and foreign snapshots must be rejected, so that a resume never restores
+// garbage.
+static bool CheckRejection()
+{
+	std::vector<uint8_t> data = Save(MakeScene(4));
+	Scene scene;
+
+	std::vector<uint8_t> damaged = data;
+	damaged[damaged.size() / 2] ^= 0x10;
+	std::vector<uint8_t> truncated(data.begin(), data.end() - 4);
+	std::vector<uint8_t> foreign = data;
+	foreign[4]++;
+
+	return Restore(data, &scene) && !Restore(damaged, &scene) && !Restore(truncated, &scene) && !Restore(foreign, &scene);
+}
+
+int main(int argc, char** argv)
+{
+	std::vector<uint32_t> transformCounts = { 0, 16, 256, 4096, 65536 };
+	uint32_t runCount = 1000;
+
+	for (int i = 1; i < argc; i++)
+	{
+		std::string argument = argv[i];
+		if (argument == "--transforms" && i + 1 < argc)
+		{
+			transformCounts = { static_cast<uint32_t>(strtoul(argv[++i], nullptr, 10)) };
+		}
+		else if (argument == "--runs" && i + 1 < argc)
+		{
+			runCount = (std::max)(static_cast<uint32_t>(strtoul(argv[++i], nullptr, 10)), 1u);
+		}
+		else
+		{
+			fprintf(stderr, "%s: unknown option\n", argument.c_str());
+			fprintf(stderr, "Usage: %s [--transforms <count>] [--runs <count>]\n", argv[0]);
+			return 1;
+		}
+	}
+
+	bool restoredAll = true;
+	printf("%10s %10s %12s %12s\n", "Transforms", "Bytes", "Save us", "Restore us");
+	for (uint32_t transformCount : transformCounts)
+	{
+		Scene scene = MakeScene(transformCount);
+		Scene restored;
+		std::vector<uint8_t> data;
+		double save = 0.0;
+		double restore = 0.0;
+
+		for (uint32_t run = 0; run < runCount; run++)
+		{
+			auto start = std::chrono::steady_clock::now();
+			data = Save(scene);
+			auto saved = std::chrono::steady_clock::now();
+			restoredAll = Restore(data, &restored) && restoredAll;
+			auto end = std::chrono::steady_clock::now();
+
+			double saveMicroseconds = std::chrono::duration<double, std::micro>(saved - start).count();
+			double restoreMicroseconds = std::chrono::duration<double, std::micro>(end - saved).count();
+			save = (run == 0) ? saveMicroseconds : (std::min)(save, saveMicroseconds);
+			restore = (run == 0) ? restoreMicroseconds : (std::min)(restore, restoreMicroseconds);
+		}
+
+		restoredAll = IsSameScene(scene, restored) && restoredAll;
+		printf("%10u %10zu %12.2f %12.2f\n", transformCount, data.size(), save, restore);
+	}
+
+	printf("\n");
+	Expect(restoredAll, "every snapshot restores what was saved");
+	Expect(CheckRejection(), "damaged, truncated and foreign snapshots are rejected");
+
+	return ReportChecks();
+}
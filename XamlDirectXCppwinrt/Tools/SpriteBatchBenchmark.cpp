@@ -0,0 +1,369 @@
+﻿// Checks DX::SpriteBatch, which collects the 2D primitives of the overlays, against a plain
+// reference: End must order the quads by layer and then by texture, keep the order they were
+// added in within each layer and texture, and merge them into as few draws as that order and
+// MaxSpritesPerDraw allow. Then it times a frame of many sprites, adding them and ending the
+// batch, for a range of texture and layer counts.
+//
+// Usage: SpriteBatchBenchmark [options]
+//
+//   --sprites <count>				Sprites in each timed frame. The default is 100000.
+//   --frames <count>				Frames timed for each case. The default is 100.
+//   --seed <value>					Seed for the sprites. The default is 1.
+//
+// The End column includes the sort, the vertex copy and building the draws; the stable_sort
+// column is std::stable_sort on the same keys, for comparison with the batch's radix sort.
+// Build it with:
+//
+//   g++ -std=c++17 -O2 SpriteBatchBenchmark.cpp -o SpriteBatchBenchmark
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <string>
+#include <vector>
+#include "../Common/SpriteBatch.h"
+#include "Check.h"
+
+using DX::SpriteBatch;
+using DX::SpriteDraw;
+using DX::SpriteRect;
+using DX::SpriteVertex;
+using Clock = std::chrono::steady_clock;
+
+// A sprite to add to the batch. The color is its index, so the order of the vertices shows
+// where each sprite went.
+struct Sprite
+{
+	SpriteBatch::TextureId	texture;
+	uint16_t				layer;
+	SpriteRect				destination;
+};
+
+static std::vector<Sprite> MakeSprites(uint32_t count, uint32_t textureCount, uint32_t layerCount, std::mt19937& random)
+{
+	std::vector<Sprite> sprites(count);
+	for (Sprite& sprite : sprites)
+	{
+		// Texture 0 is the solid color texture, as for rectangles and lines.
+		sprite.texture = random() % textureCount;
+		sprite.layer = static_cast<uint16_t>(random() % layerCount);
+		float x = static_cast<float>(random() % 3840);
+		float y = static_cast<float>(random() % 2160);
+		float size = static_cast<float>(8 + random() % 56);
+		sprite.destination = { x, y, x + size, y + size };
+	}
+	return sprites;
+}
+
+static void AddSprites(SpriteBatch& batch, const std::vector<Sprite>& sprites)
+{
+	for (uint32_t i = 0; i < sprites.size(); i++)
+	{
+		const Sprite& sprite = sprites[i];
+		batch.DrawQuad(sprite.texture, sprite.destination, { 0.0f, 0.0f, 1.0f, 1.0f }, i, sprite.layer);
+	}
+}
+
+// The order End should produce, and the draws it should build from it.
+static std::vector<uint32_t> GetReferenceOrder(const std::vector<Sprite>& sprites)
+{
+	std::vector<uint32_t> order(sprites.size());
+	for (uint32_t i = 0; i < order.size(); i++)
+	{
+		order[i] = i;
+	}
+	std::stable_sort(order.begin(), order.end(), [&](uint32_t a, uint32_t b)
+	{
+		if (sprites[a].layer != sprites[b].layer)
+		{
+			return sprites[a].layer < sprites[b].layer;
+		}
+		return sprites[a].texture < sprites[b].texture;
+	});
+	return order;
+}
+
+static std::vector<SpriteDraw> GetReferenceDraws(const std::vector<Sprite>& sprites, const std::vector<uint32_t>& order)
+{
+	std::vector<SpriteDraw> draws;
+	for (uint32_t i = 0; i < order.size(); i++)
+	{
+		SpriteBatch::TextureId texture = sprites[order[i]].texture;
+		if (draws.empty() || draws.back().texture != texture || draws.back().spriteCount == SpriteBatch::MaxSpritesPerDraw)
+		{
+			draws.push_back({ texture, i, 0 });
+		}
+		draws.back().spriteCount++;
+	}
+	return draws;
+}
+
+static bool DrawsEqual(const std::vector<SpriteDraw>& a, const std::vector<SpriteDraw>& b)
+{
+	if (a.size() != b.size())
+	{
+		return false;
+	}
+	for (size_t i = 0; i < a.size(); i++)
+	{
+		if (a[i].texture != b[i].texture || a[i].firstSprite != b[i].firstSprite || a[i].spriteCount != b[i].spriteCount)
+		{
+			return false;
+		}
+	}
+	return true;
+}
+
+static bool SameVertex(const SpriteVertex& vertex, float x, float y, float u, float v)
+{
+	const float tolerance = 1e-4f;
+	return std::fabs(vertex.x - x) <= tolerance && std::fabs(vertex.y - y) <= tolerance &&
+		std::fabs(vertex.u - u) <= tolerance && std::fabs(vertex.v - v) <= tolerance;
+}
+
+// Sorting and merging, against the reference, for frames whose keys differ in different bytes
+// so that the radix sort runs one pass, several, or none.
+static void CheckOrder(std::mt19937& random)
+{
+	struct Case
+	{
+		uint32_t	spriteCount;
+		uint32_t	textureCount;
+		uint32_t	layerCount;
+		const char*	description;
+	};
+	static const Case cases[] =
+	{
+		{ 5000, 1, 1, "order: one texture in one layer keeps the order the sprites were added in" },
+		{ 5000, 8, 1, "order: a few textures in one layer are sorted by texture and stay stable" },
+		{ 20000, 1000, 1, "order: textures that differ in more than one byte are sorted by every byte" },
+		{ 20000, 16, 300, "order: layers that differ in more than one byte come before textures" },
+		{ 40000, 1, 1, "order: a draw holds at most MaxSpritesPerDraw sprites" },
+		{ 70000, 3, 2, "order: long runs of one texture are split at MaxSpritesPerDraw" },
+	};
+
+	SpriteBatch batch;
+	for (const Case& test : cases)
+	{
+		std::vector<Sprite> sprites = MakeSprites(test.spriteCount, test.textureCount, test.layerCount, random);
+		batch.Begin();
+		AddSprites(batch, sprites);
+		batch.End();
+
+		std::vector<uint32_t> order = GetReferenceOrder(sprites);
+		const std::vector<SpriteVertex>& vertices = batch.GetVertices();
+		bool ok = batch.GetSpriteCount() == sprites.size() && vertices.size() == sprites.size() * 4;
+		for (uint32_t i = 0; ok && i < order.size(); i++)
+		{
+			const SpriteRect& destination = sprites[order[i]].destination;
+			for (uint32_t corner = 0; corner < 4; corner++)
+			{
+				ok = ok && vertices[4 * i + corner].color == order[i];
+			}
+			ok = ok && SameVertex(vertices[4 * i], destination.left, destination.top, 0.0f, 0.0f) &&
+				SameVertex(vertices[4 * i + 3], destination.right, destination.bottom, 1.0f, 1.0f);
+		}
+		ok = ok && DrawsEqual(batch.GetDraws(), GetReferenceDraws(sprites, order));
+		Expect(ok, test.description);
+	}
+
+	batch.Begin();
+	batch.End();
+	Expect(batch.GetVertices().empty() && batch.GetDraws().empty(), "order: an empty frame has no vertices or draws");
+}
+
+// The geometry of each kind of primitive, with and without a transform.
+static void CheckGeometry()
+{
+	SpriteBatch batch;
+	batch.Begin();
+	batch.DrawQuad(5, { 10.0f, 20.0f, 30.0f, 60.0f }, { 0.25f, 0.5f, 0.75f, 1.0f }, 0xFF00FF00);
+	batch.End();
+	const std::vector<SpriteVertex>& vertices = batch.GetVertices();
+	Expect(vertices.size() == 4 &&
+		SameVertex(vertices[0], 10.0f, 20.0f, 0.25f, 0.5f) && SameVertex(vertices[1], 30.0f, 20.0f, 0.75f, 0.5f) &&
+		SameVertex(vertices[2], 10.0f, 60.0f, 0.25f, 1.0f) && SameVertex(vertices[3], 30.0f, 60.0f, 0.75f, 1.0f) &&
+		vertices[0].color == 0xFF00FF00 && batch.GetDraws().size() == 1 && batch.GetDraws()[0].texture == 5,
+		"geometry: a quad's corners are top left, top right, bottom left, bottom right");
+
+	batch.Begin();
+	batch.DrawRect({ 0.0f, 0.0f, 4.0f, 2.0f }, 0xFFFFFFFF);
+	batch.End();
+	Expect(vertices.size() == 4 && batch.GetDraws()[0].texture == SpriteBatch::NoTexture &&
+		SameVertex(vertices[0], 0.0f, 0.0f, 0.0f, 0.0f) && SameVertex(vertices[3], 4.0f, 2.0f, 1.0f, 1.0f),
+		"geometry: a rectangle is a quad over the whole solid color texture");
+
+	// A horizontal line two pixels thick covers one pixel either side.
+	batch.Begin();
+	batch.DrawLine(0.0f, 0.0f, 10.0f, 0.0f, 2.0f, 0xFFFFFFFF);
+	batch.DrawLine(3.0f, 3.0f, 3.0f, 3.0f, 2.0f, 0xFFFFFFFF);
+	batch.End();
+	Expect(vertices.size() == 4 &&
+		SameVertex(vertices[0], 0.0f, 1.0f, 0.0f, 0.0f) && SameVertex(vertices[1], 10.0f, 1.0f, 1.0f, 0.0f) &&
+		SameVertex(vertices[2], 0.0f, -1.0f, 0.0f, 1.0f) && SameVertex(vertices[3], 10.0f, -1.0f, 1.0f, 1.0f),
+		"geometry: a line is a quad its thickness wide, and a line of no length adds nothing");
+
+	// A diagonal line keeps its thickness across it.
+	batch.Begin();
+	batch.DrawLine(0.0f, 0.0f, 3.0f, 4.0f, 1.0f, 0xFFFFFFFF);
+	batch.End();
+	float across = std::hypot(vertices[0].x - vertices[2].x, vertices[0].y - vertices[2].y);
+	float along = std::hypot(vertices[1].x - vertices[0].x, vertices[1].y - vertices[0].y);
+	Expect(std::fabs(across - 1.0f) < 1e-5f && std::fabs(along - 5.0f) < 1e-5f, "geometry: a diagonal line is as thick and as long as asked");
+
+	// Rotated a quarter turn clockwise and moved, as for a display in portrait: (x, y) maps to
+	// (100 - y, x).
+	batch.Begin();
+	batch.SetTransform({ 0.0f, 1.0f, -1.0f, 0.0f, 100.0f, 0.0f });
+	batch.DrawRect({ 10.0f, 20.0f, 30.0f, 60.0f }, 0xFFFFFFFF);
+	batch.ResetTransform();
+	batch.DrawRect({ 10.0f, 20.0f, 30.0f, 60.0f }, 0xFFFFFFFF);
+	batch.SetTransform({ 2.0f, 0.0f, 0.0f, 2.0f, 0.0f, 0.0f });
+	batch.End();
+	Expect(vertices.size() == 8 &&
+		SameVertex(vertices[0], 80.0f, 10.0f, 0.0f, 0.0f) && SameVertex(vertices[1], 80.0f, 30.0f, 1.0f, 0.0f) &&
+		SameVertex(vertices[2], 40.0f, 10.0f, 0.0f, 1.0f) && SameVertex(vertices[3], 40.0f, 30.0f, 1.0f, 1.0f) &&
+		SameVertex(vertices[4], 10.0f, 20.0f, 0.0f, 0.0f) && SameVertex(vertices[7], 30.0f, 60.0f, 1.0f, 1.0f),
+		"geometry: the transform moves only the primitives added while it is set");
+
+	batch.Begin();
+	batch.DrawRect({ 10.0f, 20.0f, 30.0f, 60.0f }, 0xFFFFFFFF);
+	batch.End();
+	Expect(SameVertex(vertices[0], 10.0f, 20.0f, 0.0f, 0.0f), "geometry: Begin resets the transform");
+}
+
+struct TimingResult
+{
+	double		addNanoseconds;		// Per sprite.
+	double		endNanoseconds;		// Per sprite.
+	double		stableSortNanoseconds;	// Per sprite.
+	size_t		draws;
+};
+
+static TimingResult Time(uint32_t spriteCount, uint32_t textureCount, uint32_t layerCount, bool transformed, uint32_t frameCount, std::mt19937& random)
+{
+	std::vector<Sprite> sprites = MakeSprites(spriteCount, textureCount, layerCount, random);
+	SpriteBatch batch;
+
+	// One untimed frame, so the batch's storage has grown to fit.
+	batch.Begin();
+	AddSprites(batch, sprites);
+	batch.End();
+
+	double addSeconds = 0.0;
+	double endSeconds = 0.0;
+	uint32_t sink = 0;
+	for (uint32_t frame = 0; frame < frameCount; frame++)
+	{
+		Clock::time_point start = Clock::now();
+		batch.Begin();
+		if (transformed)
+		{
+			batch.SetTransform({ 0.0f, 1.0f, -1.0f, 0.0f, 2160.0f, 0.0f });
+		}
+		AddSprites(batch, sprites);
+		Clock::time_point added = Clock::now();
+		batch.End();
+		Clock::time_point ended = Clock::now();
+
+		addSeconds += std::chrono::duration<double>(added - start).count();
+		endSeconds += std::chrono::duration<double>(ended - added).count();
+		sink += batch.GetVertices()[frame % spriteCount].color;
+	}
+
+	// The same keys through std::stable_sort.
+	struct Key
+	{
+		uint64_t	key;
+		uint32_t	quad;
+	};
+	std::vector<Key> keys(spriteCount);
+	std::vector<Key> sorted;
+	for (uint32_t i = 0; i < spriteCount; i++)
+	{
+		keys[i] = { (static_cast<uint64_t>(sprites[i].layer) << 32) | sprites[i].texture, i };
+	}
+	double sortSeconds = 0.0;
+	for (uint32_t frame = 0; frame < frameCount; frame++)
+	{
+		sorted = keys;
+		Clock::time_point start = Clock::now();
+		std::stable_sort(sorted.begin(), sorted.end(), [](const Key& a, const Key& b) { return a.key < b.key; });
+		sortSeconds += std::chrono::duration<double>(Clock::now() - start).count();
+		sink += sorted[frame % spriteCount].quad;
+	}
+
+	if (sink == 0xFFFFFFFF)
+	{
+		printf("\n");
+	}
+
+	double scale = 1e9 / (static_cast<double>(spriteCount) * frameCount);
+	return { addSeconds * scale, endSeconds * scale, sortSeconds * scale, batch.GetDraws().size() };
+}
+
+int main(int argc, char** argv)
+{
+	uint32_t spriteCount = 100000;
+	uint32_t frameCount = 100;
+	uint32_t seed = 1;
+
+	for (int i = 1; i < argc; i++)
+	{
+		std::string argument = argv[i];
+		if (argument == "--sprites" && i + 1 < argc)
+		{
+			spriteCount = (std::max)(static_cast<uint32_t>(strtoul(argv[++i], nullptr, 10)), 1u);
+		}
+		else if (argument == "--frames" && i + 1 < argc)
+		{
+			frameCount = (std::max)(static_cast<uint32_t>(strtoul(argv[++i], nullptr, 10)), 1u);
+		}
+		else if (argument == "--seed" && i + 1 < argc)
+		{
+			seed = static_cast<uint32_t>(strtoul(argv[++i], nullptr, 10));
+		}
+		else
+		{
+			fprintf(stderr, "%s: unknown option\n", argument.c_str());
+			fprintf(stderr, "Usage: %s [--sprites <count>] [--frames <count>] [--seed <value>]\n", argv[0]);
+			return 1;
+		}
+	}
+
+	std::mt19937 random(seed);
+	CheckOrder(random);
+	CheckGeometry();
+
+	struct Case
+	{
+		uint32_t	textureCount;
+		uint32_t	layerCount;
+		bool		transformed;
+	};
+	static const Case cases[] =
+	{
+		{ 1, 1, false },
+		{ 1, 1, true },
+		{ 4, 1, false },
+		{ 64, 1, false },
+		{ 4, 4, false },
+		{ 1024, 1, false },
+		{ 64, 16, false },
+	};
+
+	printf("\n%u sprites a frame, %u frames\n", spriteCount, frameCount);
+	printf("%9s %7s %10s %12s %12s %16s %8s %12s\n", "Textures", "Layers", "Transform", "Add ns/sp", "End ns/sp", "stable_sort ns", "Draws", "Frame ms");
+	for (const Case& test : cases)
+	{
+		TimingResult result = Time(spriteCount, test.textureCount, test.layerCount, test.transformed, frameCount, random);
+		double frameMilliseconds = (result.addNanoseconds + result.endNanoseconds) * spriteCount / 1e6;
+		printf("%9u %7u %10s %12.2f %12.2f %16.2f %8zu %12.3f\n", test.textureCount, test.layerCount, test.transformed ? "yes" : "no",
+			result.addNanoseconds, result.endNanoseconds, result.stableSortNanoseconds, result.draws, frameMilliseconds);
+	}
+
+	return ReportChecks();
+}
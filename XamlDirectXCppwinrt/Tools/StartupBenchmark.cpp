@@ -0,0 +1,190 @@
+﻿// Times DX::StartupGraph on the app's startup stages, with synthetic costs in place of the real
+// work, so that changes to the graph or its scheduling can be measured anywhere.
+//
+// Usage: StartupBenchmark [options]
+//
+//   --threads <count>				Worker threads besides the calling one. The default is
+//									StartupGraph::GetDefaultWorkerCount.
+//   --benchmark					Run with 0, 1, 2, 4... workers up to --threads and report
+//									the time of each against the serial startup.
+//   --scale <factor>				Multiply every stage's cost. The default is 1.
+//   --runs <count>					Runs of each configuration; the fastest is reported. The
+//									default is 5.
+//   --timeline						Print when each stage of the last run ran.
+//
+// Each stage spends part of its cost busy on the CPU and waits out the rest, as creating the
+// device waits for the driver and loading files waits for the disk. The serial startup is the
+// order MainPage used before the graph, with every factory created up front.
+//
+// Build it with:
+//
+//   g++ -std=c++20 -O2 -pthread StartupBenchmark.cpp ../Common/StartupGraph.cpp -o StartupBenchmark
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+#include "../Common/StartupGraph.h"
+
+// A stage of MainPage's startup and what it costs on a typical desktop, cold.
+struct SyntheticStage
+{
+	const char*			name;
+	double				milliseconds;
+	double				busyFraction;	// Of the cost, the part spent on the CPU.
+};
+
+static const SyntheticStage WindowEvents		= { "Window events", 2.0, 1.0 };
+static const SyntheticStage Direct2DFactory		= { "Direct2D factory", 6.0, 0.8 };
+static const SyntheticStage DirectWriteFactory	= { "DirectWrite factory", 4.0, 0.5 };
+static const SyntheticStage WicFactory			= { "WIC factory", 5.0, 0.5 };
+static const SyntheticStage Direct3DDevice		= { "Direct3D device", 45.0, 0.3 };
+static const SyntheticStage Direct2DDevice		= { "Direct2D device", 6.0, 0.8 };
+static const SyntheticStage WarmStartCache		= { "Warm-start cache", 1.0, 0.2 };
+static const SyntheticStage ShaderArchive		= { "Shader archive", 8.0, 0.2 };
+static const SyntheticStage OverlayFont			= { "Overlay font", 25.0, 0.9 };
+static const SyntheticStage SwapChainPanel		= { "Swap chain panel", 12.0, 0.5 };
+static const SyntheticStage Content				= { "Content", 20.0, 0.6 };
+static const SyntheticStage InputThread			= { "Input", 1.0, 1.0 };
+
+// Spins for the busy part of the cost and sleeps for the rest.
+static void Simulate(const SyntheticStage& stage, double scale)
+{
+	using Clock = std::chrono::steady_clock;
+	auto busy = std::chrono::duration<double, std::milli>(stage.milliseconds * stage.busyFraction * scale);
+	auto idle = std::chrono::duration<double, std::milli>(stage.milliseconds * (1.0 - stage.busyFraction) * scale);
+
+	auto end = Clock::now() + std::chrono::duration_cast<Clock::duration>(busy);
+	while (Clock::now() < end)
+	{
+	}
+	std::this_thread::sleep_for(idle);
+}
+
+// MainPage's startup before the graph: everything in order on the UI thread, with every factory
+// created up front.
+static double RunSerial(double scale)
+{
+	auto start = std::chrono::steady_clock::now();
+	for (const SyntheticStage* stage : { &WindowEvents, &Direct2DFactory, &DirectWriteFactory, &WicFactory, &Direct3DDevice,
+		&Direct2DDevice, &SwapChainPanel, &InputThread, &ShaderArchive, &OverlayFont, &Content })
+	{
+		Simulate(*stage, scale);
+	}
+	return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+// The stages MainPage, DeviceResources and the main class add to the graph. The WIC factory is
+// no longer created at startup, and the DirectWrite factory is created by the first stage that
+// uses it, the overlay font.
+static void AddStages(DX::StartupGraph& graph, double scale)
+{
+	using DX::StartupThread;
+	auto stage = [scale](const SyntheticStage& synthetic) { return [&synthetic, scale] { Simulate(synthetic, scale); }; };
+
+	graph.AddStage(WindowEvents.name, {}, StartupThread::Calling, stage(WindowEvents));
+	auto direct2DFactory = graph.AddStage(Direct2DFactory.name, {}, StartupThread::Any, stage(Direct2DFactory));
+	auto direct3DDevice = graph.AddStage(Direct3DDevice.name, {}, StartupThread::Any, stage(Direct3DDevice));
+	auto direct2DDevice = graph.AddStage(Direct2DDevice.name, { direct2DFactory, direct3DDevice }, StartupThread::Any, stage(Direct2DDevice));
+	auto swapChainPanel = graph.AddStage(SwapChainPanel.name, { direct2DDevice }, StartupThread::Calling, stage(SwapChainPanel));
+	auto warmStartCache = graph.AddStage(WarmStartCache.name, {}, StartupThread::Any, stage(WarmStartCache));
+	auto shaderArchive = graph.AddStage(ShaderArchive.name, { warmStartCache }, StartupThread::Any, stage(ShaderArchive));
+	auto overlayFont = graph.AddStage(OverlayFont.name, {}, StartupThread::Any, [scale]
+	{
+		Simulate(DirectWriteFactory, scale);
+		Simulate(OverlayFont, scale);
+	});
+	auto content = graph.AddStage(Content.name, { swapChainPanel, shaderArchive, overlayFont }, StartupThread::Any, stage(Content));
+	graph.AddStage(InputThread.name, { content }, StartupThread::Calling, stage(InputThread));
+}
+
+int main(int argc, char** argv)
+{
+	uint32_t workerCount = DX::StartupGraph::GetDefaultWorkerCount();
+	uint32_t runCount = 5;
+	double scale = 1.0;
+	bool benchmark = false;
+	bool timeline = false;
+
+	for (int i = 1; i < argc; i++)
+	{
+		std::string argument = argv[i];
+		if (argument == "--threads" && i + 1 < argc)
+		{
+			workerCount = static_cast<uint32_t>(strtoul(argv[++i], nullptr, 10));
+		}
+		else if (argument == "--runs" && i + 1 < argc)
+		{
+			runCount = (std::max)(static_cast<uint32_t>(strtoul(argv[++i], nullptr, 10)), 1u);
+		}
+		else if (argument == "--scale" && i + 1 < argc)
+		{
+			scale = strtod(argv[++i], nullptr);
+		}
+		else if (argument == "--benchmark")
+		{
+			benchmark = true;
+		}
+		else if (argument == "--timeline")
+		{
+			timeline = true;
+		}
+		else
+		{
+			fprintf(stderr, "%s: unknown option\n", argument.c_str());
+			fprintf(stderr, "Usage: %s [--threads <count>] [--benchmark] [--scale <factor>] [--runs <count>] [--timeline]\n", argv[0]);
+			return 1;
+		}
+	}
+
+	std::vector<uint32_t> workerCounts = { workerCount };
+	if (benchmark)
+	{
+		workerCounts = { 0 };
+		for (uint32_t count = 1; count < workerCount; count *= 2)
+		{
+			workerCounts.push_back(count);
+		}
+		if (workerCount > 0)
+		{
+			workerCounts.push_back(workerCount);
+		}
+	}
+
+	double serial = RunSerial(scale);
+	for (uint32_t run = 1; run < runCount; run++)
+	{
+		serial = (std::min)(serial, RunSerial(scale));
+	}
+	printf("serial startup:  %8.2f ms\n", serial);
+
+	DX::StartupGraph graph;
+	AddStages(graph, scale);
+	for (uint32_t count : workerCounts)
+	{
+		double best = 0.0;
+		double criticalPath = 0.0;
+		for (uint32_t run = 0; run < runCount; run++)
+		{
+			graph.Run(count);
+			if (run == 0 || graph.GetTotalMilliseconds() < best)
+			{
+				best = graph.GetTotalMilliseconds();
+				criticalPath = graph.GetCriticalPathMilliseconds();
+			}
+		}
+
+		printf("%3u workers:     %8.2f ms, critical path %8.2f ms, %5.2fx\n", count, best, criticalPath, serial / best);
+	}
+
+	if (timeline)
+	{
+		graph.WriteTimeline(std::cout);
+	}
+
+	return 0;
+}
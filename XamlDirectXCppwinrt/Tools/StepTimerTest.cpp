@@ -0,0 +1,267 @@
+﻿// Runs DX::StepTimer against a simulated clock, so that fixed timestep updates, the catch-up
+// limit and the interpolation alpha can be checked frame by frame without depending on real
+// time. Renders the sample cube's rotation as Sample3DSceneRenderer does and checks that the
+// interpolated angle moves smoothly at every display rate, including where the angle wraps.
+//
+// Usage: StepTimerTest
+//
+// StepTimer reads the clock through QueryPerformanceCounter; this test supplies that function
+// and the few Windows types it uses, so it builds with the standard library alone:
+//
+//   g++ -std=c++17 -O2 StepTimerTest.cpp -o StepTimerTest
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+
+// The simulated clock, counting in the same units as StepTimer's ticks.
+static const int64_t ClockFrequency = 10'000'000;
+static int64_t g_clock = 0;
+
+struct LARGE_INTEGER
+{
+	int64_t	QuadPart;
+};
+
+static int QueryPerformanceFrequency(LARGE_INTEGER* frequency)
+{
+	frequency->QuadPart = ClockFrequency;
+	return 1;
+}
+
+static int QueryPerformanceCounter(LARGE_INTEGER* counter)
+{
+	counter->QuadPart = g_clock;
+	return 1;
+}
+
+namespace winrt
+{
+	[[noreturn]] inline void throw_last_error() { abort(); }
+}
+
+#include "../Common/StepTimer.h"
+#include "Check.h"
+
+static const double TwoPi = 6.283185307179586;
+
+// The sample cube, with the same rotation as Sample3DSceneRenderer::Update.
+struct Cube
+{
+	double	degreesPerSecond = 45.0;
+	float	previousRadians = 0.0f;
+	float	currentRadians = 0.0f;
+
+	void Update(const DX::StepTimer& timer)
+	{
+		previousRadians = currentRadians;
+		double radiansPerSecond = degreesPerSecond * TwoPi / 360.0;
+		currentRadians = static_cast<float>(fmod(timer.GetTotalSeconds() * radiansPerSecond, TwoPi));
+	}
+
+	float GetRenderedRadians(const DX::StepTimer& timer) const
+	{
+		return DX::InterpolateRadians(previousRadians, currentRadians, timer.GetInterpolationAlpha());
+	}
+};
+
+// The difference between two angles, the short way around.
+static double GetAngleDifference(double a, double b)
+{
+	double difference = fmod(a - b, TwoPi);
+	if (difference > TwoPi / 2)
+	{
+		difference -= TwoPi;
+	}
+	else if (difference < -TwoPi / 2)
+	{
+		difference += TwoPi;
+	}
+	return fabs(difference);
+}
+
+struct RunResult
+{
+	uint32_t	updates;
+	uint32_t	mostUpdatesInATick;
+	double		smallestAlpha;
+	double		largestAlpha;
+	double		largestAngleError;		// Against the exact angle one timestep behind the clock.
+};
+
+// Ticks a 60 Hz fixed timestep timer at the display rate for the duration, rendering the cube
+// after each tick as the app does.
+static RunResult Run(double displayRate, double seconds, double degreesPerSecond = 45.0)
+{
+	g_clock = 0;
+	DX::StepTimer timer;
+	timer.SetFixedTimeStep(true);
+	timer.SetTargetElapsedSeconds(1.0 / 60);
+	timer.SetMaxUpdatesPerTick(4);
+	timer.ResetElapsedTime();
+
+	Cube cube;
+	cube.degreesPerSecond = degreesPerSecond;
+	RunResult result = { 0, 0, 1.0, 0.0, 0.0 };
+	double radiansPerSecond = degreesPerSecond * TwoPi / 360.0;
+	uint32_t frames = static_cast<uint32_t>(seconds * displayRate);
+
+	for (uint32_t frame = 1; frame <= frames; frame++)
+	{
+		g_clock = static_cast<int64_t>(frame * ClockFrequency / displayRate);
+		uint32_t updates = 0;
+		timer.Tick([&]
+		{
+			cube.Update(timer);
+			updates++;
+		});
+
+		result.updates += updates;
+		result.mostUpdatesInATick = (std::max)(result.mostUpdatesInATick, updates);
+
+		// Before the second update there is nothing to blend from.
+		if (timer.GetFrameCount() < 2)
+		{
+			continue;
+		}
+
+		double alpha = timer.GetInterpolationAlpha();
+		result.smallestAlpha = (std::min)(result.smallestAlpha, alpha);
+		result.largestAlpha = (std::max)(result.largestAlpha, alpha);
+
+		// Interpolating between the last two updates shows the scene one timestep behind the
+		// simulation clock, plus the fraction of a step not yet simulated.
+		double shownSeconds = timer.GetTotalSeconds() - 1.0 / 60 + alpha / 60;
+		double error = GetAngleDifference(cube.GetRenderedRadians(timer), shownSeconds * radiansPerSecond);
+		result.largestAngleError = (std::max)(result.largestAngleError, error);
+	}
+	return result;
+}
+
+static void CheckDisplayRates()
+{
+	// Allow for the quarter millisecond StepTimer snaps to the timestep, and float precision.
+	const double angleTolerance = 45.0 * TwoPi / 360.0 * 0.00026 + 1e-5;
+
+	struct DisplayRate
+	{
+		double		rate;
+		uint32_t	updatesPerTick;		// At most.
+	};
+	for (DisplayRate display : { DisplayRate{ 60.0, 1 }, DisplayRate{ 59.94, 1 }, DisplayRate{ 144.0, 1 }, DisplayRate{ 240.0, 1 }, DisplayRate{ 30.0, 2 }, DisplayRate{ 24.0, 3 } })
+	{
+		RunResult result = Run(display.rate, 10.0);
+		char description[160];
+
+		snprintf(description, sizeof(description), "%6.2f Hz: %u updates in 10 s, at most %u a tick", display.rate, result.updates, result.mostUpdatesInATick);
+		Expect(result.updates >= 599 && result.updates <= 601 && result.mostUpdatesInATick <= display.updatesPerTick, description);
+
+		snprintf(description, sizeof(description), "%6.2f Hz: alpha stays within [0, 1), from %.3f to %.3f", display.rate, result.smallestAlpha, result.largestAlpha);
+		Expect(result.smallestAlpha >= 0.0 && result.largestAlpha < 1.0, description);
+
+		snprintf(description, sizeof(description), "%6.2f Hz: rendered angle is off by at most %.2e radians", display.rate, result.largestAngleError);
+		Expect(result.largestAngleError <= angleTolerance, description);
+	}
+
+	// A fast spin wraps every few frames; the blend must not run the long way around.
+	RunResult fast = Run(144.0, 10.0, 3000.0);
+	char description[160];
+	snprintf(description, sizeof(description), "fast spin wraps the short way, off by at most %.2e radians", fast.largestAngleError);
+	Expect(fast.largestAngleError <= 3000.0 * TwoPi / 360.0 * 0.00026 + 1e-4, description);
+}
+
+static void CheckCatchUpLimit()
+{
+	g_clock = 0;
+	DX::StepTimer timer;
+	timer.SetFixedTimeStep(true);
+	timer.SetTargetElapsedSeconds(1.0 / 60);
+	timer.SetMaxUpdatesPerTick(4);
+	timer.ResetElapsedTime();
+
+	// A 90 ms hitch owes five updates and change, more than the limit of four. The rest of the
+	// whole steps are dropped, and only the fraction of a step is kept for interpolation.
+	uint64_t step = DX::StepTimer::SecondsToTicks(1.0 / 60);
+	g_clock = ClockFrequency * 90 / 1000;
+	uint32_t updates = 0;
+	timer.Tick([&] { updates++; });
+	uint64_t owed = DX::StepTimer::SecondsToTicks(0.09);
+
+	Expect(updates == 4, "a hitch makes no more updates than the limit");
+	Expect(timer.GetDroppedTicks() == (owed / step - 4) * step, "whole steps past the limit are dropped");
+	Expect(fabs(timer.GetInterpolationAlpha() - static_cast<double>(owed % step) / step) < 1e-9, "the fraction of a step is kept for interpolation");
+
+	// Deltas are clamped to a tenth of a second before the limit applies.
+	g_clock += ClockFrequency * 2;
+	updates = 0;
+	timer.Tick([&] { updates++; });
+	Expect(updates == 4 && timer.GetTotalTicks() == 8 * step, "a two second stall counts as a tenth of a second");
+
+	// Without a limit every owed step runs.
+	timer.SetMaxUpdatesPerTick(0);
+	timer.ResetElapsedTime();
+	g_clock += ClockFrequency / 10;
+	updates = 0;
+	timer.Tick([&] { updates++; });
+	Expect(updates == 6, "without a limit a tenth of a second makes six updates");
+}
+
+static void CheckVariableTimestep()
+{
+	g_clock = 0;
+	DX::StepTimer timer;
+	timer.ResetElapsedTime();
+
+	g_clock = ClockFrequency / 50;
+	uint32_t updates = 0;
+	timer.Tick([&] { updates++; });
+	Expect(updates == 1 && timer.GetElapsedTicks() == DX::StepTimer::SecondsToTicks(0.02), "variable timestep updates once with the whole delta");
+	Expect(timer.GetInterpolationAlpha() == 1.0, "variable timestep renders the last update as is");
+}
+
+static void CheckState()
+{
+	g_clock = 0;
+	DX::StepTimer timer;
+	timer.SetFixedTimeStep(true);
+	timer.SetTargetElapsedSeconds(1.0 / 60);
+	timer.ResetElapsedTime();
+	for (int frame = 1; frame <= 100; frame++)
+	{
+		g_clock = frame * ClockFrequency / 144;
+		timer.Tick([] {});
+	}
+
+	DX::StepTimerState state = timer.GetState();
+
+	// Restore into a timer whose clock has moved on a long way, as after a relaunch.
+	g_clock += ClockFrequency * 3600;
+	DX::StepTimer restored;
+	restored.SetFixedTimeStep(true);
+	restored.SetTargetElapsedSeconds(1.0 / 60);
+	restored.SetState(state);
+	Expect(restored.GetTotalTicks() == timer.GetTotalTicks() && restored.GetFrameCount() == timer.GetFrameCount(), "a restored timer continues from the saved time");
+
+	uint32_t updates = 0;
+	g_clock += ClockFrequency / 60;
+	restored.Tick([&] { updates++; });
+	Expect(updates == 1, "the time since the state was saved doesn't count");
+}
+
+int main(int argc, char** argv)
+{
+	if (argc > 1)
+	{
+		fprintf(stderr, "Usage: %s\n", argv[0]);
+		return 1;
+	}
+
+	CheckDisplayRates();
+	CheckCatchUpLimit();
+	CheckVariableTimestep();
+	CheckState();
+
+	return ReportChecks();
+}
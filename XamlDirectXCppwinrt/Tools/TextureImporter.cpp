@@ -0,0 +1,435 @@
+﻿// Converts PNG and JPEG images into streaming texture containers for DX::TextureStreamer.
+//
+// Usage: TextureImporter [options] <image>...
+//
+//   --format <bc1|bc2|bc3|bc4|bc5|bc7>	Block format. The default is bc7.
+//   --linear						The color channels are linear rather than sRGB. Always the
+//									case for bc4 and bc5, which hold data rather than color.
+//   --output <directory>			Where to write the containers, named after each image with
+//									the extension .dxts. The default is next to each image.
+//   --threads <count>				Worker threads. The default is one per hardware thread.
+//   --benchmark					Time the import with 1, 2, 4... threads up to --threads and
+//									report the throughput of each, without writing anything.
+//
+// Images are decoded in parallel, one per thread, and each is reduced to a full mip chain in
+// linear light. The mips of every image are then split into bands of block rows, which the
+// threads encode together, so a single large image uses every core too. Image dimensions must
+// be multiples of 4.
+//
+// Like ShaderArchiveBuilder this is a standalone tool, so it can run on the build machines that
+// import assets. Besides the portable texture headers it needs libpng and libjpeg:
+//
+//   g++ -std=c++20 -O2 -pthread TextureImporter.cpp -lpng -ljpeg -o TextureImporter
+
+#include <atomic>
+#include <chrono>
+#include <csetjmp>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <functional>
+#include <iterator>
+#include <string>
+#include <thread>
+#include <vector>
+#include <jpeglib.h>
+#include <png.h>
+#include "../Common/BlockCompression.h"
+#include "../Common/MipGeneration.h"
+#include "../Common/TextureContainer.h"
+
+struct SourceImage
+{
+	std::string							path;
+	std::string							error;
+	uint32_t							width = 0;
+	uint32_t							height = 0;
+	std::vector<std::vector<uint8_t>>	mips;		// RGBA8, mip 0 first.
+	std::vector<std::vector<uint8_t>>	blocks;		// The encoded mips.
+};
+
+// A band of block rows of one mip of one image.
+struct EncodeTask
+{
+	SourceImage*	image;
+	uint32_t		mip;
+	uint32_t		firstRow;
+	uint32_t		lastRow;
+};
+
+// Calls work for every index in [0, count) from threadCount threads, each taking the next
+// index as it finishes the last.
+static void ParallelFor(uint32_t threadCount, size_t count, const std::function<void(size_t)>& work)
+{
+	std::atomic<size_t> next(0);
+	auto worker = [&]
+	{
+		for (size_t i = next++; i < count; i = next++)
+		{
+			work(i);
+		}
+	};
+
+	std::vector<std::thread> threads;
+	for (uint32_t i = 1; i < threadCount; i++)
+	{
+		threads.emplace_back(worker);
+	}
+	worker();
+	for (std::thread& thread : threads)
+	{
+		thread.join();
+	}
+}
+
+static bool ReadFile(const std::string& path, std::vector<uint8_t>* data)
+{
+	std::ifstream file(path, std::ios::binary);
+	if (!file)
+	{
+		return false;
+	}
+
+	data->assign(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+	return !file.bad();
+}
+
+static bool DecodePng(const std::vector<uint8_t>& file, SourceImage* image)
+{
+	png_image png = {};
+	png.version = PNG_IMAGE_VERSION;
+	if (!png_image_begin_read_from_memory(&png, file.data(), file.size()))
+	{
+		image->error = png.message;
+		return false;
+	}
+
+	png.format = PNG_FORMAT_RGBA;
+	image->width = png.width;
+	image->height = png.height;
+	image->mips.resize(1);
+	image->mips[0].resize(PNG_IMAGE_SIZE(png));
+	if (!png_image_finish_read(&png, nullptr, image->mips[0].data(), 0, nullptr))
+	{
+		image->error = png.message;
+		png_image_free(&png);
+		return false;
+	}
+	return true;
+}
+
+struct JpegError
+{
+	jpeg_error_mgr	manager;
+	jmp_buf			jump;
+};
+
+static void OnJpegError(j_common_ptr info)
+{
+	longjmp(reinterpret_cast<JpegError*>(info->err)->jump, 1);
+}
+
+// libjpeg reports errors by calling error_exit, which must not return, so they come back here
+// through longjmp. Nothing between setjmp and the end of the function needs destroying.
+static bool DecodeJpeg(const std::vector<uint8_t>& file, SourceImage* image)
+{
+	jpeg_decompress_struct info;
+	JpegError error;
+	info.err = jpeg_std_error(&error.manager);
+	error.manager.error_exit = OnJpegError;
+
+	if (setjmp(error.jump))
+	{
+		char message[JMSG_LENGTH_MAX];
+		error.manager.format_message(reinterpret_cast<j_common_ptr>(&info), message);
+		image->error = message;
+		jpeg_destroy_decompress(&info);
+		return false;
+	}
+
+	jpeg_create_decompress(&info);
+	jpeg_mem_src(&info, const_cast<uint8_t*>(file.data()), static_cast<unsigned long>(file.size()));
+	jpeg_read_header(&info, TRUE);
+	info.out_color_space = JCS_RGB;
+	jpeg_start_decompress(&info);
+
+	image->width = info.output_width;
+	image->height = info.output_height;
+	image->mips.resize(1);
+	image->mips[0].resize(size_t(image->width) * image->height * 4);
+
+	// Expand each RGB row to RGBA in place, from the end so nothing is overwritten early.
+	while (info.output_scanline < info.output_height)
+	{
+		uint8_t* row = image->mips[0].data() + size_t(info.output_scanline) * image->width * 4;
+		jpeg_read_scanlines(&info, &row, 1);
+		for (uint32_t x = image->width; x-- > 0; )
+		{
+			row[x * 4 + 3] = 255;
+			row[x * 4 + 2] = row[x * 3 + 2];
+			row[x * 4 + 1] = row[x * 3 + 1];
+			row[x * 4 + 0] = row[x * 3 + 0];
+		}
+	}
+
+	jpeg_finish_decompress(&info);
+	jpeg_destroy_decompress(&info);
+	return true;
+}
+
+// Decodes an image and builds its mip chain.
+static void LoadImage(SourceImage* image, bool srgb)
+{
+	std::vector<uint8_t> file;
+	if (!ReadFile(image->path, &file))
+	{
+		image->error = "can't read the file";
+		return;
+	}
+
+	static const uint8_t pngSignature[] = { 0x89, 'P', 'N', 'G' };
+	bool decoded;
+	if (file.size() >= 4 && memcmp(file.data(), pngSignature, 4) == 0)
+	{
+		decoded = DecodePng(file, image);
+	}
+	else if (file.size() >= 2 && file[0] == 0xFF && file[1] == 0xD8)
+	{
+		decoded = DecodeJpeg(file, image);
+	}
+	else
+	{
+		image->error = "not a PNG or JPEG image";
+		return;
+	}
+
+	if (!decoded)
+	{
+		return;
+	}
+
+	if (image->width % 4 != 0 || image->height % 4 != 0 || image->width > 16384 || image->height > 16384)
+	{
+		image->error = "dimensions must be multiples of 4, at most 16384";
+		return;
+	}
+
+	// Mip 0 keeps the decoded texels exactly; the rest are filtered from the one before.
+	uint32_t mipCount = DX::GetFullMipCount(image->width, image->height);
+	image->mips.resize(mipCount);
+
+	DX::MipImage current;
+	DX::MipImage next;
+	DX::MipGeneration::Load(image->mips[0].data(), image->width, image->height, srgb, &current);
+	for (uint32_t mip = 1; mip < mipCount; mip++)
+	{
+		DX::MipGeneration::Downsample(current, &next);
+		DX::MipGeneration::Store(next, srgb, &image->mips[mip]);
+		std::swap(current, next);
+	}
+}
+
+// Decodes every image and encodes every mip with threadCount threads. Returns false if an
+// image couldn't be loaded.
+static bool Import(std::vector<SourceImage>& images, DX::BlockFormat format, bool srgb, uint32_t threadCount, double* loadSeconds, double* encodeSeconds)
+{
+	auto start = std::chrono::steady_clock::now();
+
+	ParallelFor(threadCount, images.size(), [&](size_t i)
+	{
+		LoadImage(&images[i], srgb);
+	});
+
+	auto loaded = std::chrono::steady_clock::now();
+
+	// Bands of 16 block rows are small enough to balance the load across threads and large
+	// enough that taking one costs little.
+	const uint32_t bandRows = 16;
+	std::vector<EncodeTask> tasks;
+	for (SourceImage& image : images)
+	{
+		if (!image.error.empty())
+		{
+			return false;
+		}
+
+		image.blocks.resize(image.mips.size());
+		for (uint32_t mip = 0; mip < image.mips.size(); mip++)
+		{
+			DX::TextureMipLayout layout = DX::GetMipLayout(format, image.width, image.height, mip);
+			image.blocks[mip].resize(static_cast<size_t>(layout.size));
+			for (uint32_t row = 0; row < layout.rowCount; row += bandRows)
+			{
+				tasks.push_back({ &image, mip, row, (std::min)(row + bandRows, layout.rowCount) });
+			}
+		}
+	}
+
+	ParallelFor(threadCount, tasks.size(), [&](size_t i)
+	{
+		const EncodeTask& task = tasks[i];
+		DX::TextureMipLayout layout = DX::GetMipLayout(format, task.image->width, task.image->height, task.mip);
+		DX::BlockCompression::EncodeBlockRows(format, task.image->mips[task.mip].data(), layout.width, layout.height,
+			task.firstRow, task.lastRow, task.image->blocks[task.mip].data());
+	});
+
+	auto encoded = std::chrono::steady_clock::now();
+	*loadSeconds = std::chrono::duration<double>(loaded - start).count();
+	*encodeSeconds = std::chrono::duration<double>(encoded - loaded).count();
+	return true;
+}
+
+static std::string GetOutputPath(const std::string& input, const std::string& directory)
+{
+	size_t nameStart = input.find_last_of("/\\") + 1;
+	size_t extension = input.find_last_of('.');
+	std::string stem = input.substr(0, (extension != std::string::npos && extension > nameStart) ? extension : input.size());
+	if (!directory.empty())
+	{
+		stem = directory + "/" + stem.substr(nameStart);
+	}
+	return stem + ".dxts";
+}
+
+static bool ParseFormat(const std::string& name, DX::BlockFormat* format)
+{
+	static const char* names[] = { "bc1", "bc2", "bc3", "bc4", "bc5", "bc6h", "bc7" };
+	for (uint32_t i = 0; i < DX::BlockFormatCount; i++)
+	{
+		if (name == names[i] && static_cast<DX::BlockFormat>(i) != DX::BlockFormat::BC6H)
+		{
+			*format = static_cast<DX::BlockFormat>(i);
+			return true;
+		}
+	}
+	return false;
+}
+
+int main(int argc, char** argv)
+{
+	DX::BlockFormat format = DX::BlockFormat::BC7;
+	bool linear = false;
+	bool benchmark = false;
+	std::string outputDirectory;
+	uint32_t threadCount = (std::max)(std::thread::hardware_concurrency(), 1u);
+	std::vector<std::string> inputs;
+
+	for (int i = 1; i < argc; i++)
+	{
+		std::string argument = argv[i];
+		if (argument == "--format" && i + 1 < argc)
+		{
+			if (!ParseFormat(argv[++i], &format))
+			{
+				fprintf(stderr, "%s: unsupported format (expected bc1, bc2, bc3, bc4, bc5 or bc7)\n", argv[i]);
+				return 1;
+			}
+		}
+		else if (argument == "--linear")
+		{
+			linear = true;
+		}
+		else if (argument == "--output" && i + 1 < argc)
+		{
+			outputDirectory = argv[++i];
+		}
+		else if (argument == "--threads" && i + 1 < argc)
+		{
+			threadCount = (std::max)(static_cast<uint32_t>(strtoul(argv[++i], nullptr, 10)), 1u);
+		}
+		else if (argument == "--benchmark")
+		{
+			benchmark = true;
+		}
+		else if (argument.size() > 1 && argument[0] == '-')
+		{
+			fprintf(stderr, "%s: unknown option\n", argument.c_str());
+			return 1;
+		}
+		else
+		{
+			inputs.push_back(argument);
+		}
+	}
+
+	if (inputs.empty())
+	{
+		fprintf(stderr, "Usage: %s [--format bc1|bc2|bc3|bc4|bc5|bc7] [--linear] [--output <directory>] [--threads <count>] [--benchmark] <image>...\n", argv[0]);
+		return 1;
+	}
+
+	bool srgb = !linear && format != DX::BlockFormat::BC4 && format != DX::BlockFormat::BC5;
+
+	std::vector<uint32_t> threadCounts = { threadCount };
+	if (benchmark)
+	{
+		threadCounts.clear();
+		for (uint32_t count = 1; count < threadCount; count *= 2)
+		{
+			threadCounts.push_back(count);
+		}
+		threadCounts.push_back(threadCount);
+	}
+
+	std::vector<SourceImage> images;
+	double baseline = 0.0;
+	for (uint32_t count : threadCounts)
+	{
+		images.assign(inputs.size(), SourceImage());
+		for (size_t i = 0; i < inputs.size(); i++)
+		{
+			images[i].path = inputs[i];
+		}
+
+		double loadSeconds;
+		double encodeSeconds;
+		if (!Import(images, format, srgb, count, &loadSeconds, &encodeSeconds))
+		{
+			for (const SourceImage& image : images)
+			{
+				if (!image.error.empty())
+				{
+					fprintf(stderr, "%s: %s\n", image.path.c_str(), image.error.c_str());
+				}
+			}
+			return 1;
+		}
+
+		if (benchmark)
+		{
+			double texels = 0.0;
+			for (const SourceImage& image : images)
+			{
+				texels += double(image.width) * image.height;
+			}
+
+			double total = loadSeconds + encodeSeconds;
+			baseline = (count == 1) ? total : baseline;
+			printf("%3u threads: decode and mips %8.1f ms, encode %8.1f ms, %7.2f Mtexels/s, %5.2fx\n",
+				count, loadSeconds * 1000.0, encodeSeconds * 1000.0, texels / total / 1.0e6, baseline / total);
+		}
+	}
+
+	if (benchmark)
+	{
+		return 0;
+	}
+
+	for (const SourceImage& image : images)
+	{
+		std::vector<uint8_t> container = DX::WriteTextureContainer(format, srgb ? DX::TextureContainerSrgb : 0, image.width, image.height, image.blocks);
+
+		std::string path = GetOutputPath(image.path, outputDirectory);
+		std::ofstream file(path, std::ios::binary | std::ios::trunc);
+		file.write(reinterpret_cast<const char*>(container.data()), static_cast<std::streamsize>(container.size()));
+		if (!file)
+		{
+			fprintf(stderr, "%s: can't write the container\n", path.c_str());
+			return 1;
+		}
+
+		printf("%s: %ux%u, %zu mips, %zu bytes\n", path.c_str(), image.width, image.height, image.blocks.size(), container.size());
+	}
+	return 0;
+}
@@ -0,0 +1,410 @@
+﻿// Drives DX::TextureResidencyManager, the policy behind TextureStreamer, through a simulated
+// walk past a row of block-compressed textures, and reports for each budget how much of what
+// is drawn is at full detail, how quickly detail returns after a jump, how much is evicted and
+// loaded again soon after, and what Update costs. Every frame's changes are applied to a model
+// of video memory, as TextureStreamer applies them, and checked against the budget and the
+// upload limit.
+//
+// Usage: TextureResidencyBenchmark [options]
+//
+//   --textures <count>				Textures along the walk. The default is 2000.
+//   --frames <count>				Frames simulated for each budget. The default is 900.
+//   --upload <MB>					Upload limit per frame. The default is 8, as in the app.
+//   --seed <value>					Seed for the texture sizes and formats. The default is 1.
+//
+// The camera walks forward for a third of the frames, jumps far ahead, then walks back over
+// where it started, so the detail it left behind is wanted again. Textures far behind the
+// camera are replaced now and then, as a level streams. Build it with:
+//
+//   g++ -std=c++17 -O2 TextureResidencyBenchmark.cpp -o TextureResidencyBenchmark
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <string>
+#include <vector>
+#include "../Common/TextureResidency.h"
+#include "Check.h"
+
+using DX::TextureResidencyManager;
+using Clock = std::chrono::steady_clock;
+
+// A texture as TextureStreamer registers it: square, BC1 or BC7, with a full mip chain and
+// every mip of at most TailSize texels resident as its tail.
+struct SceneTexture
+{
+	uint32_t				size;
+	std::vector<uint64_t>	mipSizes;
+	uint32_t				tailMip;
+	TextureResidencyManager::TextureHandle	handle;
+
+	// What the model of video memory holds, from applying the changes.
+	uint32_t				residentMip;
+	uint64_t				lastEvictionFrame;
+};
+
+static const uint32_t TailSize = 64;
+static const float ViewDistance = 40.0f;
+
+static SceneTexture MakeTexture(std::mt19937& random)
+{
+	static const uint32_t sizes[] = { 512, 1024, 1024, 2048, 2048, 4096 };
+	SceneTexture texture = {};
+	texture.size = sizes[random() % (sizeof(sizes) / sizeof(sizes[0]))];
+	uint32_t blockSize = (random() % 2 == 0) ? 8 : 16;
+
+	for (uint32_t size = texture.size; ; size /= 2)
+	{
+		uint64_t blocks = (std::max)(1u, (size + 3) / 4);
+		texture.mipSizes.push_back(blocks * blocks * blockSize);
+		if (size > TailSize)
+		{
+			texture.tailMip = static_cast<uint32_t>(texture.mipSizes.size());
+		}
+		if (size == 1)
+		{
+			break;
+		}
+	}
+	texture.residentMip = static_cast<uint32_t>(texture.mipSizes.size());
+	return texture;
+}
+
+static uint64_t GetResidentSize(const SceneTexture& texture, uint32_t mip)
+{
+	uint64_t size = 0;
+	for (uint32_t i = mip; i < texture.mipSizes.size(); i++)
+	{
+		size += texture.mipSizes[i];
+	}
+	return size;
+}
+
+// Where the camera is on each frame of the walk.
+static float GetCameraPosition(uint32_t frame, uint32_t frameCount, uint32_t textureCount)
+{
+	float speed = 0.25f;
+	uint32_t third = frameCount / 3;
+	if (frame < third)
+	{
+		return frame * speed;
+	}
+	if (frame < 2 * third)
+	{
+		return textureCount * 0.75f + (frame - third) * speed;
+	}
+	return (std::max)(0.0f, (frameCount - frame) * speed);
+}
+
+// How many pixels across a texture at index appears from the camera: as large as a 4K
+// display's width right in front of it, shrinking with distance.
+static float GetScreenSize(uint32_t index, float camera)
+{
+	return 4096.0f / (1.0f + 0.25f * std::fabs(index - camera));
+}
+
+struct WalkResult
+{
+	double		fullDetail;			// Fraction of drawn textures at or above the detail they need.
+	uint32_t	framesAfterJump;	// Frames after the jump until 95% are.
+	double		uploadedPerFrame;	// MB.
+	double		reloadedPerFrame;	// MB loaded within 60 frames of being evicted.
+	double		evictionsPerFrame;
+	double		updateMicroseconds;
+	double		maxUpdateMicroseconds;
+	double		residentMegabytes;	// At the end.
+	bool		consistent;			// Every change started from what the model held.
+	bool		ordered;			// Evictions came before loads.
+	bool		withinBudget;
+	bool		withinUploadLimit;
+	bool		statsMatch;
+};
+
+static WalkResult Walk(uint64_t budget, uint64_t maxUpload, uint32_t textureCount, uint32_t frameCount, uint32_t seed)
+{
+	std::mt19937 random(seed);
+	TextureResidencyManager residency(budget);
+	std::vector<SceneTexture> textures;
+	uint64_t tailSize = 0;
+	for (uint32_t i = 0; i < textureCount; i++)
+	{
+		textures.push_back(MakeTexture(random));
+		SceneTexture& texture = textures.back();
+		texture.handle = residency.Add(texture.mipSizes.data(), static_cast<uint32_t>(texture.mipSizes.size()), texture.size, texture.size, texture.tailMip);
+		tailSize += GetResidentSize(texture, texture.tailMip);
+	}
+
+	// Handle to scene index, for applying changes.
+	std::vector<uint32_t> sceneIndex(textureCount);
+	for (uint32_t i = 0; i < textureCount; i++)
+	{
+		sceneIndex[textures[i].handle] = i;
+	}
+
+	WalkResult result = {};
+	result.consistent = true;
+	result.ordered = true;
+	result.withinBudget = true;
+	result.withinUploadLimit = true;
+	result.statsMatch = true;
+	result.framesAfterJump = UINT32_MAX;
+
+	std::vector<TextureResidencyManager::Change> changes;
+	uint64_t drawn = 0;
+	uint64_t fullDetail = 0;
+	uint64_t uploaded = 0;
+	uint64_t reloaded = 0;
+	uint64_t evictions = 0;
+	double updateSeconds = 0.0;
+	double maxUpdateSeconds = 0.0;
+	uint64_t residentSize = 0;
+	uint32_t jumpFrame = frameCount / 3;
+
+	for (uint32_t frame = 0; frame < frameCount; frame++)
+	{
+		float camera = GetCameraPosition(frame, frameCount, textureCount);
+
+		// Now and then a texture far from the camera is replaced by a new one, which may get the
+		// freed handle.
+		if (frame % 10 == 5)
+		{
+			uint32_t index = random() % textureCount;
+			if (std::fabs(index - camera) > 2 * ViewDistance)
+			{
+				SceneTexture& texture = textures[index];
+				residency.Remove(texture.handle);
+				residentSize -= GetResidentSize(texture, texture.residentMip);
+				tailSize -= GetResidentSize(texture, texture.tailMip);
+
+				texture = MakeTexture(random);
+				texture.handle = residency.Add(texture.mipSizes.data(), static_cast<uint32_t>(texture.mipSizes.size()), texture.size, texture.size, texture.tailMip);
+				tailSize += GetResidentSize(texture, texture.tailMip);
+				if (texture.handle >= sceneIndex.size())
+				{
+					sceneIndex.resize(texture.handle + 1);
+				}
+				sceneIndex[texture.handle] = index;
+			}
+		}
+
+		// Textures near the camera are drawn, larger the closer they are.
+		uint32_t first = static_cast<uint32_t>((std::max)(0.0f, std::ceil(camera - ViewDistance)));
+		uint32_t last = static_cast<uint32_t>((std::min)(static_cast<float>(textureCount - 1), std::floor(camera + ViewDistance)));
+		for (uint32_t i = first; i <= last; i++)
+		{
+			residency.RequestScreenSize(textures[i].handle, GetScreenSize(i, camera));
+		}
+
+		Clock::time_point start = Clock::now();
+		residency.Update(maxUpload, &changes);
+		double seconds = std::chrono::duration<double>(Clock::now() - start).count();
+		updateSeconds += seconds;
+		maxUpdateSeconds = (std::max)(maxUpdateSeconds, seconds);
+
+		// Apply the changes as TextureStreamer does.
+		bool loading = false;
+		uint64_t frameLoads = 0;
+		uint64_t frameTails = 0;
+		uint32_t frameMips = 0;
+		for (const TextureResidencyManager::Change& change : changes)
+		{
+			SceneTexture& texture = textures[sceneIndex[change.texture]];
+			result.consistent = result.consistent && change.previousMip == texture.residentMip;
+
+			uint64_t before = GetResidentSize(texture, texture.residentMip);
+			uint64_t after = GetResidentSize(texture, change.residentMip);
+			if (change.residentMip > change.previousMip)
+			{
+				result.ordered = result.ordered && !loading;
+				texture.lastEvictionFrame = frame + 1;
+				evictions++;
+			}
+			else
+			{
+				loading = true;
+				uint64_t size = after - before;
+				if (change.previousMip == texture.mipSizes.size())
+				{
+					// A new texture's tail is loaded at once, outside the limit.
+					uint64_t tail = GetResidentSize(texture, texture.tailMip);
+					frameTails += tail;
+					size -= tail;
+				}
+				frameLoads += size;
+				frameMips += (std::min)(change.previousMip, texture.tailMip) - change.residentMip;
+				if (texture.lastEvictionFrame != 0 && frame + 1 - texture.lastEvictionFrame <= 60)
+				{
+					reloaded += size;
+				}
+			}
+			residentSize += after - before;
+			texture.residentMip = change.residentMip;
+		}
+		uploaded += frameLoads + frameTails;
+		result.withinUploadLimit = result.withinUploadLimit && (frameLoads <= maxUpload || frameMips == 1);
+		result.withinBudget = result.withinBudget && residentSize <= (std::max)(budget, tailSize);
+		result.statsMatch = result.statsMatch && residency.GetStats().residentSize == residentSize;
+
+		uint32_t frameDrawn = 0;
+		uint32_t frameFullDetail = 0;
+		for (uint32_t i = first; i <= last; i++)
+		{
+			const SceneTexture& texture = textures[i];
+			uint32_t desired = TextureResidencyManager::GetDesiredMip(texture.size, GetScreenSize(i, camera));
+			frameDrawn++;
+			frameFullDetail += texture.residentMip <= (std::min)(desired, texture.tailMip) ? 1 : 0;
+		}
+		drawn += frameDrawn;
+		fullDetail += frameFullDetail;
+		if (frame >= jumpFrame && result.framesAfterJump == UINT32_MAX && frameFullDetail >= frameDrawn * 0.95)
+		{
+			result.framesAfterJump = frame - jumpFrame;
+		}
+	}
+
+	double megabyte = 1024.0 * 1024.0;
+	result.fullDetail = static_cast<double>(fullDetail) / (std::max)(drawn, static_cast<uint64_t>(1));
+	result.uploadedPerFrame = uploaded / megabyte / frameCount;
+	result.reloadedPerFrame = reloaded / megabyte / frameCount;
+	result.evictionsPerFrame = static_cast<double>(evictions) / frameCount;
+	result.updateMicroseconds = updateSeconds * 1e6 / frameCount;
+	result.maxUpdateMicroseconds = maxUpdateSeconds * 1e6;
+	result.residentMegabytes = residentSize / megabyte;
+	return result;
+}
+
+// Small cases whose outcome is known.
+static void CheckPolicy()
+{
+	// Two 1024 textures, BC1: 512 KB at mip 0, 128 KB at mip 1, and so on. The tail is mip 4,
+	// 64x64.
+	std::vector<uint64_t> mips;
+	for (uint32_t size = 1024; size >= 1; size /= 2)
+	{
+		uint64_t blocks = (std::max)(1u, size / 4);
+		mips.push_back(blocks * blocks * 8);
+	}
+	uint64_t tail = 0;
+	for (size_t i = 4; i < mips.size(); i++)
+	{
+		tail += mips[i];
+	}
+
+	// Room for one full chain and one more mip 3 above the tails.
+	TextureResidencyManager residency(2 * tail + mips[0] + mips[1] + mips[2] + 2 * mips[3]);
+	auto a = residency.Add(mips.data(), static_cast<uint32_t>(mips.size()), 1024, 1024, 4);
+	auto b = residency.Add(mips.data(), static_cast<uint32_t>(mips.size()), 1024, 1024, 4);
+	std::vector<TextureResidencyManager::Change> changes;
+
+	residency.Update(UINT64_MAX, &changes);
+	Expect(residency.GetResidentMip(a) == 4 && residency.GetResidentMip(b) == 4, "policy: textures that aren't drawn get only their tails");
+
+	// Drawn at full size, a wants mip 0 and gets it; b, drawn small, wants only mip 3.
+	residency.RequestScreenSize(a, 1024.0f);
+	residency.RequestScreenSize(b, 128.0f);
+	residency.Update(UINT64_MAX, &changes);
+	Expect(residency.GetResidentMip(a) == 0 && residency.GetResidentMip(b) == 3, "policy: each drawn texture gets the mip that matches its size on screen");
+
+	// Now b is drawn at full size and a isn't drawn. The budget holds one full chain, so a's
+	// detail is evicted to make room.
+	residency.RequestScreenSize(b, 1024.0f);
+	residency.Update(UINT64_MAX, &changes);
+	Expect(residency.GetResidentMip(b) == 0 && residency.GetResidentMip(a) == 3, "policy: detail of a texture no longer drawn is evicted for one that is");
+
+	// With room to spare, detail that is no longer needed stays.
+	residency.SetBudget(UINT64_MAX);
+	residency.Update(UINT64_MAX, &changes);
+	Expect(residency.GetResidentMip(a) == 3 && changes.empty(), "policy: with room to spare nothing is evicted");
+
+	// Trim, as on suspend: only tails stay.
+	residency.SetBudget(0);
+	residency.Update(UINT64_MAX, &changes);
+	Expect(residency.GetResidentMip(a) == 4 && residency.GetResidentMip(b) == 4 && residency.GetStats().residentSize == 2 * tail,
+		"policy: without a budget only the tails stay");
+
+	// Under an upload limit of 128 KB, mips 3 and 2 arrive together, then mip 1, then mip 0,
+	// which is larger than the limit and so is loaded on its own.
+	residency.SetBudget(UINT64_MAX);
+	std::vector<uint32_t> steps;
+	for (int frame = 0; frame < 8 && residency.GetResidentMip(a) > 0; frame++)
+	{
+		residency.RequestScreenSize(a, 1024.0f);
+		residency.Update(mips[1], &changes);
+		steps.push_back(residency.GetResidentMip(a));
+	}
+	Expect(steps == std::vector<uint32_t>({ 2, 1, 0 }),
+		"policy: under the upload limit detail arrives from low to high, and a mip larger than the limit still loads");
+}
+
+int main(int argc, char** argv)
+{
+	uint32_t textureCount = 2000;
+	uint32_t frameCount = 900;
+	uint64_t maxUpload = 8ull << 20;
+	uint32_t seed = 1;
+
+	for (int i = 1; i < argc; i++)
+	{
+		std::string argument = argv[i];
+		if (argument == "--textures" && i + 1 < argc)
+		{
+			textureCount = (std::max)(static_cast<uint32_t>(strtoul(argv[++i], nullptr, 10)), 100u);
+		}
+		else if (argument == "--frames" && i + 1 < argc)
+		{
+			frameCount = (std::max)(static_cast<uint32_t>(strtoul(argv[++i], nullptr, 10)), 3u);
+		}
+		else if (argument == "--upload" && i + 1 < argc)
+		{
+			maxUpload = static_cast<uint64_t>(strtoull(argv[++i], nullptr, 10)) << 20;
+		}
+		else if (argument == "--seed" && i + 1 < argc)
+		{
+			seed = static_cast<uint32_t>(strtoul(argv[++i], nullptr, 10));
+		}
+		else
+		{
+			fprintf(stderr, "%s: unknown option\n", argument.c_str());
+			fprintf(stderr, "Usage: %s [--textures <count>] [--frames <count>] [--upload <MB>] [--seed <value>]\n", argv[0]);
+			return 1;
+		}
+	}
+
+	CheckPolicy();
+
+	printf("\n%10s %12s %12s %12s %12s %12s %10s %10s %12s\n", "Budget MB", "Full detail", "Jump frames",
+		"Upload MB/f", "Reload MB/f", "Evictions/f", "Update us", "Max us", "Resident MB");
+	bool consistent = true;
+	bool ordered = true;
+	bool withinBudget = true;
+	bool withinUploadLimit = true;
+	bool statsMatch = true;
+	static const uint32_t budgets[] = { 64, 128, 256, 512 };
+	for (uint32_t budget : budgets)
+	{
+		WalkResult result = Walk(static_cast<uint64_t>(budget) << 20, maxUpload, textureCount, frameCount, seed);
+		char jump[16];
+		snprintf(jump, sizeof(jump), result.framesAfterJump == UINT32_MAX ? "never" : "%u", result.framesAfterJump);
+		printf("%10u %11.1f%% %12s %12.2f %12.2f %12.1f %10.1f %10.1f %12.1f\n", budget, result.fullDetail * 100.0, jump,
+			result.uploadedPerFrame, result.reloadedPerFrame, result.evictionsPerFrame, result.updateMicroseconds,
+			result.maxUpdateMicroseconds, result.residentMegabytes);
+
+		consistent = consistent && result.consistent;
+		ordered = ordered && result.ordered;
+		withinBudget = withinBudget && result.withinBudget;
+		withinUploadLimit = withinUploadLimit && result.withinUploadLimit;
+		statsMatch = statsMatch && result.statsMatch;
+	}
+	printf("\n");
+
+	Expect(consistent, "walk: every change starts from the residency the previous changes left");
+	Expect(ordered, "walk: each frame's evictions come before its loads");
+	Expect(withinBudget, "walk: resident memory never exceeds the budget, or the tails when they alone do");
+	Expect(withinUploadLimit, "walk: each frame uploads at most the limit, or one larger mip, besides new textures' tails");
+	Expect(statsMatch, "walk: the reported resident size matches the changes");
+
+	return ReportChecks();
+}
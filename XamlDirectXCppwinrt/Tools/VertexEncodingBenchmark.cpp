@@ -0,0 +1,559 @@
+﻿// Checks the compressed vertex formats in VertexEncoding.h and the compile-time layouts in
+// VertexLayout.h, then times them: encoding and decoding whole vertices through
+// VertexLayout::Vertex, as the sample does when it builds its meshes, and the array kernels
+// against their scalar definitions.
+//
+// Usage: VertexEncodingBenchmark [options]
+//
+//   --vertices <count>				Vertices encoded and decoded in each timed run. The default
+//									is 1000000.
+//   --seed <value>					Seed for the random vertices. The default is 1.
+//
+// Every half is round-tripped, and the SSE2 kernels are compared with the scalar conversions
+// for every length up to a few blocks, so their tails are covered too. Build it with:
+//
+//   g++ -std=c++17 -O2 VertexEncodingBenchmark.cpp -o VertexEncodingBenchmark
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <limits>
+#include <random>
+#include <string>
+#include <vector>
+
+#if defined(_WIN32)
+#include <d3d11.h>
+#else
+// The parts of the Direct3D headers VertexLayout.h names, with their values from dxgiformat.h
+// and d3d11.h.
+enum DXGI_FORMAT
+{
+	DXGI_FORMAT_UNKNOWN = 0,
+	DXGI_FORMAT_R32G32B32A32_FLOAT = 2,
+	DXGI_FORMAT_R32G32B32_FLOAT = 6,
+	DXGI_FORMAT_R16G16B16A16_FLOAT = 10,
+	DXGI_FORMAT_R16G16B16A16_SNORM = 13,
+	DXGI_FORMAT_R32G32_FLOAT = 16,
+	DXGI_FORMAT_R10G10B10A2_UNORM = 24,
+	DXGI_FORMAT_R8G8B8A8_UNORM = 28,
+	DXGI_FORMAT_R16G16_FLOAT = 34,
+	DXGI_FORMAT_R16G16_SNORM = 37,
+};
+
+enum D3D11_INPUT_CLASSIFICATION
+{
+	D3D11_INPUT_PER_VERTEX_DATA = 0,
+	D3D11_INPUT_PER_INSTANCE_DATA = 1,
+};
+
+struct D3D11_INPUT_ELEMENT_DESC
+{
+	const char*					SemanticName;
+	uint32_t					SemanticIndex;
+	DXGI_FORMAT					Format;
+	uint32_t					InputSlot;
+	uint32_t					AlignedByteOffset;
+	D3D11_INPUT_CLASSIFICATION	InputSlotClass;
+	uint32_t					InstanceDataStepRate;
+};
+#endif
+
+#include "../Common/VertexLayout.h"
+#include "Check.h"
+
+using namespace DX;
+using namespace DX::VertexEncoding;
+using Clock = std::chrono::steady_clock;
+
+// The sample's cube vertex, from ShaderStructures.h, and its uncompressed equivalent.
+using PositionColorLayout = VertexLayout<
+	VertexAttribute<VertexSemantic::Position, VertexFormat::Snorm16x4>,
+	VertexAttribute<VertexSemantic::Color, VertexFormat::Unorm8x4>>;
+
+using FloatPositionColorLayout = VertexLayout<
+	VertexAttribute<VertexSemantic::Position, VertexFormat::Float3>,
+	VertexAttribute<VertexSemantic::Color, VertexFormat::Float3>>;
+
+// A lit mesh vertex, with and without compression.
+using PositionNormalTexCoordLayout = VertexLayout<
+	VertexAttribute<VertexSemantic::Position, VertexFormat::Float3>,
+	VertexAttribute<VertexSemantic::Normal, VertexFormat::PackedNormal>,
+	VertexAttribute<VertexSemantic::TexCoord, VertexFormat::Half2>>;
+
+using FloatPositionNormalTexCoordLayout = VertexLayout<
+	VertexAttribute<VertexSemantic::Position, VertexFormat::Float3>,
+	VertexAttribute<VertexSemantic::Normal, VertexFormat::Float3>,
+	VertexAttribute<VertexSemantic::TexCoord, VertexFormat::Float2>>;
+
+// SpriteRenderer's layout, whose offsets it checks against SpriteVertex.
+using SpriteLayout = VertexLayout<
+	VertexAttribute<VertexSemantic::Position, VertexFormat::Float2>,
+	VertexAttribute<VertexSemantic::TexCoord, VertexFormat::Float2>,
+	VertexAttribute<VertexSemantic::Color, VertexFormat::Unorm8x4>>;
+
+static_assert(PositionColorLayout::Stride == 12, "The sample's cube vertex should take 12 bytes.");
+static_assert(PositionColorLayout::GetOffset(1) == 8, "The cube's color should follow its position.");
+static_assert(FloatPositionColorLayout::Stride == 24, "Float3 position and color take 24 bytes.");
+static_assert(PositionNormalTexCoordLayout::Stride == 20, "The compressed mesh vertex should take 20 bytes.");
+static_assert(FloatPositionNormalTexCoordLayout::Stride == 32, "The uncompressed mesh vertex should take 32 bytes.");
+static_assert(SpriteLayout::Stride == 20 && SpriteLayout::GetOffset(2) == 16, "The sprite vertex should take 20 bytes.");
+
+static double HalfDistance(uint16_t half, double value)
+{
+	return std::fabs(static_cast<double>(HalfToFloat(half)) - value);
+}
+
+static void CheckHalf(std::mt19937& random)
+{
+	// Every finite half decodes to a float that encodes back to the same half, and every NaN
+	// stays a NaN.
+	uint32_t mismatches = 0;
+	for (uint32_t bits = 0; bits <= 0xFFFF; bits++)
+	{
+		uint16_t half = static_cast<uint16_t>(bits);
+		float value = HalfToFloat(half);
+		bool isNan = (half & 0x7C00u) == 0x7C00u && (half & 0x3FFu) != 0;
+		mismatches += (isNan ? std::isnan(value) && std::isnan(HalfToFloat(FloatToHalf(value))) : FloatToHalf(value) == half) ? 0 : 1;
+	}
+	Expect(mismatches == 0, "half: all 65536 halves round-trip through float");
+
+	// Random floats in the finite range encode to the nearest half, with ties going to the
+	// even one.
+	std::uniform_int_distribution<uint32_t> magnitudes(0, 0x477FEFFFu);
+	uint32_t notNearest = 0;
+	for (int i = 0; i < 1000000; i++)
+	{
+		uint32_t bits = magnitudes(random) | ((random() & 1) << 31);
+		float value;
+		memcpy(&value, &bits, sizeof(value));
+
+		uint16_t half = FloatToHalf(value);
+		uint16_t magnitude = half & 0x7FFFu;
+		double distance = HalfDistance(half, value);
+		bool nearest = magnitude <= 0x7BFFu;
+		for (int step = -1; step <= 1 && nearest; step += 2)
+		{
+			int neighbour = magnitude + step;
+			if (neighbour < 0 || neighbour > 0x7BFF)
+			{
+				continue;
+			}
+
+			double other = HalfDistance(static_cast<uint16_t>((half & 0x8000u) | neighbour), value);
+			nearest = distance < other || (distance == other && (magnitude & 1) == 0);
+		}
+		notNearest += nearest ? 0 : 1;
+	}
+	Expect(notNearest == 0, "half: 1000000 random floats encode to the nearest half, ties to even");
+
+	Expect(FloatToHalf(65504.0f) == 0x7BFFu && FloatToHalf(65519.0f) == 0x7BFFu, "half: values just above 65504 round down to it");
+	Expect(FloatToHalf(65520.0f) == 0x7C00u && FloatToHalf(-1e10f) == 0xFC00u, "half: values from 65520 on become infinity");
+	Expect(FloatToHalf(std::ldexp(1.0f, -24)) == 1 && FloatToHalf(std::ldexp(1.0f, -25)) == 0 && FloatToHalf(std::ldexp(1.5f, -25)) == 1,
+		"half: the smallest subnormal, and the tie below it going to zero");
+}
+
+static void CheckNormalized(std::mt19937& random)
+{
+	// Every stored value decodes into the range, and the decoded value encodes back to it.
+	// -32768 is the exception: it decodes to -1, which encodes as -32767.
+	uint32_t snormMismatches = 0;
+	for (int32_t value = -32767; value <= 32767; value++)
+	{
+		float decoded = Snorm16ToFloat(static_cast<int16_t>(value));
+		snormMismatches += (FloatToSnorm16(decoded) == value && decoded >= -1.0f && decoded <= 1.0f) ? 0 : 1;
+	}
+	Expect(snormMismatches == 0 && Snorm16ToFloat(-32768) == -1.0f, "snorm16: all values round-trip, and -32768 decodes to -1");
+
+	uint32_t unormMismatches = 0;
+	for (uint32_t value = 0; value <= 255; value++)
+	{
+		unormMismatches += FloatToUnorm8(Unorm8ToFloat(static_cast<uint8_t>(value))) == value ? 0 : 1;
+	}
+	Expect(unormMismatches == 0, "unorm8: all values round-trip");
+
+	float nan = std::numeric_limits<float>::quiet_NaN();
+	Expect(FloatToSnorm16(2.0f) == 32767 && FloatToSnorm16(-2.0f) == -32767 && FloatToSnorm16(nan) == -32767,
+		"snorm16: out of range values clamp, and NaN encodes as -1");
+	Expect(FloatToUnorm8(2.0f) == 255 && FloatToUnorm8(-1.0f) == 0 && FloatToUnorm8(nan) == 0,
+		"unorm8: out of range values clamp, and NaN encodes as 0");
+
+	// Encoding is never off by more than half a step.
+	std::uniform_real_distribution<float> signedValues(-1.0f, 1.0f);
+	double snormError = 0.0;
+	double unormError = 0.0;
+	double unorm10Error = 0.0;
+	double normalError = 0.0;
+	for (int i = 0; i < 1000000; i++)
+	{
+		float value = signedValues(random);
+		float unorm = value * 0.5f + 0.5f;
+		snormError = (std::max)(snormError, std::fabs(static_cast<double>(Snorm16ToFloat(FloatToSnorm16(value))) - value));
+		unormError = (std::max)(unormError, std::fabs(static_cast<double>(Unorm8ToFloat(FloatToUnorm8(unorm))) - unorm));
+
+		float unpacked[4];
+		UnpackUnorm10_10_10_2(PackUnorm10_10_10_2(unorm, unorm, unorm, 1.0f), unpacked);
+		unorm10Error = (std::max)(unorm10Error, std::fabs(static_cast<double>(unpacked[0]) - unorm));
+
+		float normal[3] = { signedValues(random), signedValues(random), signedValues(random) };
+		float length = std::sqrt(normal[0] * normal[0] + normal[1] * normal[1] + normal[2] * normal[2]);
+		if (length < 1e-3f)
+		{
+			continue;
+		}
+		for (float& component : normal)
+		{
+			component /= length;
+		}
+
+		float decoded[3];
+		UnpackNormal(PackNormal(normal[0], normal[1], normal[2]), decoded);
+		double dot = 0.0;
+		double decodedLength = 0.0;
+		for (int j = 0; j < 3; j++)
+		{
+			dot += static_cast<double>(normal[j]) * decoded[j];
+			decodedLength += static_cast<double>(decoded[j]) * decoded[j];
+		}
+		normalError = (std::max)(normalError, std::acos((std::min)(dot / std::sqrt(decodedLength), 1.0)));
+	}
+
+	char description[160];
+	snprintf(description, sizeof(description), "snorm16: the largest error is %.3g, half of a 1/32767 step", snormError);
+	Expect(snormError <= 0.5 / 32767.0 + 1e-7, description);
+	snprintf(description, sizeof(description), "unorm8: the largest error is %.3g, half of a 1/255 step", unormError);
+	Expect(unormError <= 0.5 / 255.0 + 1e-7, description);
+	snprintf(description, sizeof(description), "unorm10: the largest error is %.3g, half of a 1/1023 step", unorm10Error);
+	Expect(unorm10Error <= 0.5 / 1023.0 + 1e-7, description);
+	snprintf(description, sizeof(description), "packed normal: the largest angle error is %.3f degrees", normalError * 180.0 / 3.14159265358979);
+	Expect(normalError * 180.0 / 3.14159265358979 < 0.2, description);
+}
+
+// The array kernels must give exactly what the scalar conversions give. Each length is tested
+// separately, so the SIMD blocks and the scalar tail both run.
+static void CheckKernels(std::mt19937& random)
+{
+	const size_t maxCount = 67;
+	std::uniform_real_distribution<float> values(-1.5f, 1.5f);
+	std::vector<float> source(maxCount);
+	uint32_t snormMismatches = 0;
+	uint32_t unormMismatches = 0;
+	uint32_t halfMismatches = 0;
+
+	for (int round = 0; round < 200; round++)
+	{
+		for (size_t i = 0; i < maxCount; i++)
+		{
+			// Exact ties, NaN and values outside the range show up often enough to matter.
+			switch (random() % 8)
+			{
+			case 0:		source[i] = std::numeric_limits<float>::quiet_NaN(); break;
+			case 1:		source[i] = (static_cast<float>(random() % 511) + 0.5f) / 255.0f; break;
+			case 2:		source[i] = (static_cast<float>(random() % 65535) - 32767.0f + 0.5f) / 32767.0f; break;
+			default:	source[i] = values(random); break;
+			}
+		}
+
+		for (size_t count = 0; count <= maxCount; count++)
+		{
+			// The destinations are one element longer than count, to catch writes past the end.
+			std::vector<int16_t> snorms(count + 1, 0x5555);
+			std::vector<float> snormsDecoded(count + 1, 7.0f);
+			EncodeSnorm16(source.data(), snorms.data(), count);
+			DecodeSnorm16(snorms.data(), snormsDecoded.data(), count);
+			for (size_t i = 0; i < count; i++)
+			{
+				snormMismatches += (snorms[i] == FloatToSnorm16(source[i]) && snormsDecoded[i] == Snorm16ToFloat(snorms[i])) ? 0 : 1;
+			}
+			snormMismatches += (snorms[count] == 0x5555 && snormsDecoded[count] == 7.0f) ? 0 : 1;
+
+			std::vector<uint8_t> unorms(count + 1, 0x55);
+			std::vector<float> unormsDecoded(count + 1, 7.0f);
+			EncodeUnorm8(source.data(), unorms.data(), count);
+			DecodeUnorm8(unorms.data(), unormsDecoded.data(), count);
+			for (size_t i = 0; i < count; i++)
+			{
+				unormMismatches += (unorms[i] == FloatToUnorm8(source[i]) && unormsDecoded[i] == Unorm8ToFloat(unorms[i])) ? 0 : 1;
+			}
+			unormMismatches += (unorms[count] == 0x55 && unormsDecoded[count] == 7.0f) ? 0 : 1;
+
+			std::vector<uint16_t> halves(count + 1, 0x5555);
+			EncodeHalf(source.data(), halves.data(), count);
+			for (size_t i = 0; i < count; i++)
+			{
+				halfMismatches += halves[i] == FloatToHalf(source[i]) ? 0 : 1;
+			}
+			halfMismatches += halves[count] == 0x5555 ? 0 : 1;
+		}
+	}
+
+#if defined(DX_VERTEX_ENCODING_SSE2)
+	const char* kernels = "SSE2";
+#else
+	const char* kernels = "scalar";
+#endif
+	char description[160];
+	snprintf(description, sizeof(description), "kernels: the %s snorm16 kernels match the scalar conversions at every length", kernels);
+	Expect(snormMismatches == 0, description);
+	snprintf(description, sizeof(description), "kernels: the %s unorm8 kernels match the scalar conversions at every length", kernels);
+	Expect(unormMismatches == 0, description);
+	Expect(halfMismatches == 0, "kernels: the half kernel matches FloatToHalf at every length");
+}
+
+template<typename TLayout, size_t TAttribute = 0>
+static bool MatchesInputElements(const std::array<D3D11_INPUT_ELEMENT_DESC, TLayout::AttributeCount>& elements, uint32_t offset = 0)
+{
+	if constexpr (TAttribute == TLayout::AttributeCount)
+	{
+		return offset == TLayout::Stride;
+	}
+	else
+	{
+		const D3D11_INPUT_ELEMENT_DESC& element = elements[TAttribute];
+		bool ok = element.AlignedByteOffset == offset && element.InputSlot == 0 &&
+			element.InputSlotClass == D3D11_INPUT_PER_VERTEX_DATA &&
+			element.Format == TLayout::GetDxgiFormat(TLayout::Formats[TAttribute]) &&
+			strcmp(element.SemanticName, TLayout::GetSemanticName(TLayout::Semantics[TAttribute])) == 0;
+		return ok && MatchesInputElements<TLayout, TAttribute + 1>(elements, offset + GetVertexFormatSize(TLayout::Formats[TAttribute]));
+	}
+}
+
+static void CheckLayouts()
+{
+	// The input layout's offsets must add up the formats' sizes with no padding, the way the
+	// C++ storage is packed.
+	bool matches = MatchesInputElements<PositionColorLayout>(PositionColorLayout::GetInputElements()) &&
+		MatchesInputElements<FloatPositionColorLayout>(FloatPositionColorLayout::GetInputElements()) &&
+		MatchesInputElements<PositionNormalTexCoordLayout>(PositionNormalTexCoordLayout::GetInputElements()) &&
+		MatchesInputElements<FloatPositionNormalTexCoordLayout>(FloatPositionNormalTexCoordLayout::GetInputElements()) &&
+		MatchesInputElements<SpriteLayout>(SpriteLayout::GetInputElements());
+	Expect(matches, "layouts: the input elements match the packed storage of every layout");
+
+	auto elements = PositionColorLayout::GetInputElements();
+	Expect(elements[0].Format == DXGI_FORMAT_R16G16B16A16_SNORM && elements[1].Format == DXGI_FORMAT_R8G8B8A8_UNORM &&
+		strcmp(elements[0].SemanticName, "POSITION") == 0 && strcmp(elements[1].SemanticName, "COLOR") == 0,
+		"layouts: the cube's position is R16G16B16A16_SNORM and its color R8G8B8A8_UNORM");
+
+	// Set and Get go through the right bytes: each attribute written alone leaves the others
+	// unchanged.
+	PositionNormalTexCoordLayout::Vertex vertex = {};
+	const float position[3] = { 1.5f, -2.25f, 100.0f };
+	const float normal[3] = { 0.0f, 0.6f, -0.8f };
+	const float texCoord[2] = { 0.25f, 0.75f };
+	vertex.Set<0>(position);
+	vertex.Set<1>(normal);
+	vertex.Set<2>(texCoord);
+
+	float decodedPosition[3];
+	float decodedNormal[3];
+	float decodedTexCoord[2];
+	vertex.Get<0>(decodedPosition);
+	vertex.Get<1>(decodedNormal);
+	vertex.Get<2>(decodedTexCoord);
+	bool ok = memcmp(position, decodedPosition, sizeof(position)) == 0 &&
+		std::fabs(decodedNormal[1] - 0.6f) < 2e-3f && std::fabs(decodedNormal[2] + 0.8f) < 2e-3f && std::fabs(decodedNormal[0]) < 2e-3f &&
+		decodedTexCoord[0] == 0.25f && decodedTexCoord[1] == 0.75f;
+	Expect(ok, "layouts: Set and Get round-trip each attribute of a mesh vertex");
+}
+
+// Source data for one timed layout: four floats per attribute per vertex, of which each format
+// reads the first GetVertexFormatComponentCount.
+struct SourceVertices
+{
+	std::vector<float> attributes[3];
+};
+
+template<typename TLayout, size_t TAttribute = 0>
+static void EncodeVertex(typename TLayout::Vertex& vertex, const SourceVertices& source, size_t index)
+{
+	if constexpr (TAttribute < TLayout::AttributeCount)
+	{
+		vertex.template Set<TAttribute>(source.attributes[TAttribute].data() + index * 4);
+		EncodeVertex<TLayout, TAttribute + 1>(vertex, source, index);
+	}
+}
+
+template<typename TLayout, size_t TAttribute = 0>
+static void DecodeVertex(const typename TLayout::Vertex& vertex, const SourceVertices& source, size_t index, double& error)
+{
+	if constexpr (TAttribute < TLayout::AttributeCount)
+	{
+		float values[4];
+		vertex.template Get<TAttribute>(values);
+		const float* expected = source.attributes[TAttribute].data() + index * 4;
+		for (uint32_t i = 0; i < GetVertexFormatComponentCount(TLayout::Formats[TAttribute]); i++)
+		{
+			error = (std::max)(error, static_cast<double>(std::fabs(values[i] - expected[i])));
+		}
+		DecodeVertex<TLayout, TAttribute + 1>(vertex, source, index, error);
+	}
+}
+
+template<typename TLayout>
+static void BenchmarkLayout(const char* name, const SourceVertices& source, size_t vertexCount)
+{
+	std::vector<typename TLayout::Vertex> vertices(vertexCount);
+
+	Clock::time_point start = Clock::now();
+	for (size_t i = 0; i < vertexCount; i++)
+	{
+		EncodeVertex<TLayout>(vertices[i], source, i);
+	}
+	double encodeSeconds = std::chrono::duration<double>(Clock::now() - start).count();
+
+	double error = 0.0;
+	start = Clock::now();
+	for (size_t i = 0; i < vertexCount; i++)
+	{
+		DecodeVertex<TLayout>(vertices[i], source, i, error);
+	}
+	double decodeSeconds = std::chrono::duration<double>(Clock::now() - start).count();
+
+	printf("%-36s %7u %10.2f %12.2f %12.2f %12.3g\n", name, TLayout::Stride, vertexCount * TLayout::Stride / 1048576.0,
+		encodeSeconds * 1e9 / vertexCount, decodeSeconds * 1e9 / vertexCount, error);
+}
+
+// Times an array kernel against a loop over the scalar conversion it must match.
+template<typename TKernel, typename TScalar>
+static void BenchmarkKernel(const char* name, const TKernel& kernel, const TScalar& scalar, size_t count)
+{
+	Clock::time_point start = Clock::now();
+	kernel();
+	double kernelSeconds = std::chrono::duration<double>(Clock::now() - start).count();
+
+	start = Clock::now();
+	scalar();
+	double scalarSeconds = std::chrono::duration<double>(Clock::now() - start).count();
+
+	printf("%-36s %14.1f %14.1f %10.2fx\n", name, count / kernelSeconds / 1e6, count / scalarSeconds / 1e6,
+		scalarSeconds / (std::max)(kernelSeconds, 1e-9));
+}
+
+static void Benchmark(size_t vertexCount, std::mt19937& random)
+{
+	// Positions and colors like the cube's, in [-1, 1] and [0, 1], and unit normals.
+	std::uniform_real_distribution<float> signedValues(-1.0f, 1.0f);
+	std::uniform_real_distribution<float> unsignedValues(0.0f, 1.0f);
+	std::normal_distribution<float> directions(0.0f, 1.0f);
+
+	SourceVertices cube;
+	SourceVertices mesh;
+	for (std::vector<float>& attribute : cube.attributes)
+	{
+		attribute.resize(vertexCount * 4);
+	}
+	for (std::vector<float>& attribute : mesh.attributes)
+	{
+		attribute.resize(vertexCount * 4);
+	}
+	for (size_t i = 0; i < vertexCount; i++)
+	{
+		float* position = &cube.attributes[0][i * 4];
+		float* color = &cube.attributes[1][i * 4];
+		for (int j = 0; j < 3; j++)
+		{
+			position[j] = signedValues(random);
+			color[j] = unsignedValues(random);
+		}
+		position[3] = 1.0f;
+		color[3] = 1.0f;
+
+		float* meshPosition = &mesh.attributes[0][i * 4];
+		float* normal = &mesh.attributes[1][i * 4];
+		float* texCoord = &mesh.attributes[2][i * 4];
+		float length = 0.0f;
+		for (int j = 0; j < 3; j++)
+		{
+			meshPosition[j] = signedValues(random) * 50.0f;
+			normal[j] = directions(random);
+			length += normal[j] * normal[j];
+		}
+		length = (std::max)(std::sqrt(length), 1e-6f);
+		for (int j = 0; j < 3; j++)
+		{
+			normal[j] /= length;
+		}
+		texCoord[0] = unsignedValues(random);
+		texCoord[1] = unsignedValues(random);
+	}
+
+	printf("\n%-36s %7s %10s %12s %12s %12s\n", "Layout", "Stride", "MB", "Encode ns", "Decode ns", "Max error");
+	BenchmarkLayout<FloatPositionColorLayout>("cube: Float3 + Float3", cube, vertexCount);
+	BenchmarkLayout<PositionColorLayout>("cube: Snorm16x4 + Unorm8x4", cube, vertexCount);
+	BenchmarkLayout<FloatPositionNormalTexCoordLayout>("mesh: Float3 + Float3 + Float2", mesh, vertexCount);
+	BenchmarkLayout<PositionNormalTexCoordLayout>("mesh: Float3 + PackedNormal + Half2", mesh, vertexCount);
+
+	// The kernels convert flat arrays of values, four per vertex.
+	size_t count = vertexCount * 4;
+	const float* source = cube.attributes[0].data();
+	const float* colors = cube.attributes[1].data();
+	std::vector<int16_t> snorms(count);
+	std::vector<uint8_t> unorms(count);
+	std::vector<uint16_t> halves(count);
+	std::vector<float> decoded(count);
+
+	printf("\n%-36s %14s %14s %11s\n", "Kernel", "Kernel M/s", "Scalar M/s", "Speedup");
+	BenchmarkKernel("EncodeSnorm16",
+		[&] { EncodeSnorm16(source, snorms.data(), count); },
+		[&] { for (size_t i = 0; i < count; i++) snorms[i] = FloatToSnorm16(source[i]); }, count);
+	BenchmarkKernel("DecodeSnorm16",
+		[&] { DecodeSnorm16(snorms.data(), decoded.data(), count); },
+		[&] { for (size_t i = 0; i < count; i++) decoded[i] = Snorm16ToFloat(snorms[i]); }, count);
+	BenchmarkKernel("EncodeUnorm8",
+		[&] { EncodeUnorm8(colors, unorms.data(), count); },
+		[&] { for (size_t i = 0; i < count; i++) unorms[i] = FloatToUnorm8(colors[i]); }, count);
+	BenchmarkKernel("DecodeUnorm8",
+		[&] { DecodeUnorm8(unorms.data(), decoded.data(), count); },
+		[&] { for (size_t i = 0; i < count; i++) decoded[i] = Unorm8ToFloat(unorms[i]); }, count);
+	BenchmarkKernel("EncodeHalf",
+		[&] { EncodeHalf(source, halves.data(), count); },
+		[&] { for (size_t i = 0; i < count; i++) halves[i] = FloatToHalf(source[i]); }, count);
+	BenchmarkKernel("DecodeHalf",
+		[&] { DecodeHalf(halves.data(), decoded.data(), count); },
+		[&] { for (size_t i = 0; i < count; i++) decoded[i] = HalfToFloat(halves[i]); }, count);
+
+	// Keeps the timed loops from being optimized away.
+	float sum = 0.0f;
+	for (size_t i = 0; i < count; i += 4099)
+	{
+		sum += decoded[i] + snorms[i] + unorms[i] + halves[i];
+	}
+	printf("(checksum %g)\n", sum);
+}
+
+int main(int argc, char** argv)
+{
+	size_t vertexCount = 1000000;
+	uint32_t seed = 1;
+
+	for (int i = 1; i < argc; i++)
+	{
+		std::string argument = argv[i];
+		if (argument == "--vertices" && i + 1 < argc)
+		{
+			vertexCount = (std::max)(static_cast<size_t>(strtoull(argv[++i], nullptr, 10)), static_cast<size_t>(1));
+		}
+		else if (argument == "--seed" && i + 1 < argc)
+		{
+			seed = static_cast<uint32_t>(strtoul(argv[++i], nullptr, 10));
+		}
+		else
+		{
+			fprintf(stderr, "%s: unknown option\n", argument.c_str());
+			fprintf(stderr, "Usage: %s [--vertices <count>] [--seed <value>]\n", argv[0]);
+			return 1;
+		}
+	}
+
+	std::mt19937 random(seed);
+	CheckHalf(random);
+	CheckNormalized(random);
+	CheckKernels(random);
+	CheckLayouts();
+	Benchmark(vertexCount, random);
+
+	return ReportChecks();
+}
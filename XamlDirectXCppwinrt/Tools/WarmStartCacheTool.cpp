@@ -0,0 +1,307 @@
+﻿// Inspects warm-start caches written by the app, and checks the cache format, its invalidation
+// and the two-file loader by simulating launches against a temporary directory.
+//
+// Usage: WarmStartCacheTool info <file> [--build-key <hex>]
+//        WarmStartCacheTool check [--directory <path>] [--keep]
+//
+//   info							List the entries of a cache file and whether each is intact.
+//									Without --build-key the file's own key is used.
+//   check							Run a series of launches, damaging and changing the files
+//									between them, and report whether each found what it should.
+//   --directory <path>				Where check keeps its cache files. The default is a new
+//									directory under the system's temporary directory.
+//   --keep							Leave the cache files of check behind.
+//
+// The app keeps its caches in its local folder as WarmStart0.dxwc and WarmStart1.dxwc. Build
+// it with:
+//
+//   g++ -std=c++17 -O2 WarmStartCacheTool.cpp -o WarmStartCacheTool
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <string>
+#include <vector>
+#include "../Common/WarmStartCache.h"
+#include "Check.h"
+
+// File contents in 8-byte aligned memory, as the cache requires.
+struct AlignedFile
+{
+	std::vector<uint64_t>	storage;
+	size_t					size = 0;
+
+	const void* GetData() const { return storage.data(); }
+};
+
+static bool ReadFile(const std::filesystem::path& path, AlignedFile* file)
+{
+	std::ifstream stream(path, std::ios::binary);
+	if (!stream)
+	{
+		return false;
+	}
+
+	std::vector<char> bytes((std::istreambuf_iterator<char>(stream)), std::istreambuf_iterator<char>());
+	file->size = bytes.size();
+	file->storage.assign((bytes.size() + 7) / 8, 0);
+	if (!bytes.empty())
+	{
+		memcpy(file->storage.data(), bytes.data(), bytes.size());
+	}
+	return !stream.bad();
+}
+
+static bool WriteFile(const std::filesystem::path& path, const std::vector<uint8_t>& data)
+{
+	std::ofstream stream(path, std::ios::binary | std::ios::trunc);
+	stream.write(reinterpret_cast<const char*>(data.data()), data.size());
+	return static_cast<bool>(stream);
+}
+
+static std::filesystem::path GetSlotPath(const std::filesystem::path& directory, uint32_t slot)
+{
+	return directory / ("WarmStart" + std::to_string(slot) + ".dxwc");
+}
+
+static int Info(const std::string& path, bool hasBuildKey, uint64_t buildKey)
+{
+	AlignedFile file;
+	if (!ReadFile(path, &file))
+	{
+		fprintf(stderr, "%s: can't read the file\n", path.c_str());
+		return 1;
+	}
+
+	if (!hasBuildKey && file.size >= sizeof(DX::WarmStartCacheHeader))
+	{
+		buildKey = static_cast<const DX::WarmStartCacheHeader*>(file.GetData())->buildKey;
+	}
+
+	DX::WarmStartCache cache;
+	if (!cache.Open(file.GetData(), file.size, buildKey))
+	{
+		fprintf(stderr, "%s: not a complete version %u cache for build key %016llx\n",
+			path.c_str(), DX::WarmStartCacheVersion, static_cast<unsigned long long>(buildKey));
+		return 1;
+	}
+
+	printf("%s: build key %016llx, generation %llu, %u entries, %zu bytes\n", path.c_str(),
+		static_cast<unsigned long long>(buildKey), static_cast<unsigned long long>(cache.GetGeneration()), cache.GetEntryCount(), file.size);
+
+	uint32_t damaged = 0;
+	for (uint32_t i = 0; i < cache.GetEntryCount(); i++)
+	{
+		const DX::WarmStartCacheEntry& entry = cache.GetEntry(i);
+		bool intact = cache.IsIntact(entry);
+		damaged += intact ? 0 : 1;
+		printf("  %016llx  source %016llx  %10u bytes at %-10llu %s\n",
+			static_cast<unsigned long long>(entry.key), static_cast<unsigned long long>(entry.sourceHash),
+			entry.size, static_cast<unsigned long long>(entry.offset), intact ? "intact" : "damaged");
+	}
+
+	return damaged == 0 ? 0 : 1;
+}
+
+// One asset of the simulated app, and what processing it at startup gives.
+struct Asset
+{
+	std::string				name;
+	std::vector<uint8_t>	source;
+};
+
+static std::vector<uint8_t> Process(const Asset& asset)
+{
+	std::vector<uint8_t> processed(asset.source.rbegin(), asset.source.rend());
+	for (uint8_t& byte : processed)
+	{
+		byte ^= 0x5A;
+	}
+	return processed;
+}
+
+struct LaunchResult
+{
+	uint32_t			loadedSlot;
+	DX::WarmStartStats	stats;
+	uint32_t			savedSlot;		// SlotCount if nothing needed saving.
+	bool				correct;		// Every hit returned what processing gives.
+};
+
+// Starts the simulated app the way the app starts: offer both files to the store, look every
+// asset up and process the ones it misses, then save to the other file if anything changed.
+static LaunchResult Launch(const std::filesystem::path& directory, uint64_t buildKey, const std::vector<Asset>& assets)
+{
+	AlignedFile files[DX::WarmStartStore::SlotCount];
+	DX::WarmStartStore store(buildKey);
+	for (uint32_t slot = 0; slot < DX::WarmStartStore::SlotCount; slot++)
+	{
+		if (ReadFile(GetSlotPath(directory, slot), &files[slot]))
+		{
+			store.Open(slot, files[slot].GetData(), files[slot].size);
+		}
+	}
+
+	LaunchResult result = { store.GetLoadedSlot(), {}, DX::WarmStartStore::SlotCount, true };
+	for (const Asset& asset : assets)
+	{
+		uint64_t key = DX::MakeWarmStartKey(asset.name.c_str());
+		uint64_t sourceHash = DX::HashWarmStartData(asset.source.data(), asset.source.size());
+		std::vector<uint8_t> processed = Process(asset);
+
+		DX::WarmStartBlob blob;
+		if (store.Find(key, sourceHash, &blob))
+		{
+			result.correct = result.correct && blob.size == processed.size() && memcmp(blob.data, processed.data(), blob.size) == 0;
+		}
+		else
+		{
+			store.Store(key, sourceHash, processed.data(), processed.size());
+		}
+	}
+
+	result.stats = store.GetStats();
+	if (store.NeedsSave())
+	{
+		result.savedSlot = store.GetSaveSlot();
+		WriteFile(GetSlotPath(directory, result.savedSlot), store.Serialize());
+	}
+	return result;
+}
+
+// Changes one byte of a file, at an offset from its start or, if negative, its end.
+static void DamageFile(const std::filesystem::path& path, long long offset)
+{
+	AlignedFile file;
+	ReadFile(path, &file);
+	std::vector<uint8_t> bytes(static_cast<const uint8_t*>(file.GetData()), static_cast<const uint8_t*>(file.GetData()) + file.size);
+	bytes[static_cast<size_t>(offset >= 0 ? offset : static_cast<long long>(bytes.size()) + offset)] ^= 0xFF;
+	WriteFile(path, bytes);
+}
+
+static int Check(std::filesystem::path directory, bool keep)
+{
+	if (directory.empty())
+	{
+		auto ticks = std::chrono::steady_clock::now().time_since_epoch().count();
+		directory = std::filesystem::temp_directory_path() / ("WarmStartCacheCheck" + std::to_string(ticks));
+	}
+	std::filesystem::create_directories(directory);
+	for (uint32_t slot = 0; slot < DX::WarmStartStore::SlotCount; slot++)
+	{
+		std::filesystem::remove(GetSlotPath(directory, slot));
+	}
+
+	std::vector<Asset> assets;
+	for (const char* name : { "VertexShader", "PixelShader", "ComputeShader", "CubeMesh" })
+	{
+		Asset asset = { name, {} };
+		for (size_t i = 0; i < 300 + 100 * assets.size(); i++)
+		{
+			asset.source.push_back(static_cast<uint8_t>(i * 7 + assets.size()));
+		}
+		assets.push_back(asset);
+	}
+
+	const uint32_t None = DX::WarmStartStore::SlotCount;
+	const uint32_t assetCount = static_cast<uint32_t>(assets.size());
+	const uint64_t buildKey = 0x0001000000000000ull;
+
+	auto expect = [&](const char* description, const LaunchResult& result, uint32_t loadedSlot, uint32_t hits, uint32_t misses, uint32_t stale, uint32_t savedSlot)
+	{
+		bool ok = result.loadedSlot == loadedSlot && result.stats.hits == hits && result.stats.misses == misses &&
+			result.stats.stale == stale && result.savedSlot == savedSlot && result.correct;
+
+		auto slotName = [None](uint32_t slot) { return slot == None ? std::string("-") : std::to_string(slot); };
+		Expect(ok, description, "loaded %s, %u hits, %u misses, %u stale, saved %s",
+			slotName(result.loadedSlot).c_str(), result.stats.hits, result.stats.misses, result.stats.stale, slotName(result.savedSlot).c_str());
+	};
+
+	expect("first launch builds everything", Launch(directory, buildKey, assets), None, 0, assetCount, 0, 0);
+	expect("second launch finds everything", Launch(directory, buildKey, assets), 0, assetCount, 0, 0, None);
+
+	assets[1].source[10] ^= 1;
+	expect("changed asset is rebuilt", Launch(directory, buildKey, assets), 0, assetCount - 1, 0, 1, 1);
+	expect("newer file is loaded", Launch(directory, buildKey, assets), 1, assetCount, 0, 0, None);
+
+	// Assets the app doesn't look up on a launch stay in the file for the next.
+	std::vector<Asset> someAssets(assets.begin(), assets.begin() + 2);
+	expect("launch using some assets saves nothing", Launch(directory, buildKey, someAssets), 1, 2, 0, 0, None);
+
+	DamageFile(GetSlotPath(directory, 1), -1);
+	expect("damaged entry is rebuilt", Launch(directory, buildKey, assets), 1, assetCount - 1, 0, 1, 0);
+	expect("rebuilt entry is loaded", Launch(directory, buildKey, assets), 0, assetCount, 0, 0, None);
+
+	// Damaging the entry table discards the whole file. Slot 1 still has the damaged entry.
+	DamageFile(GetSlotPath(directory, 0), sizeof(DX::WarmStartCacheHeader) + 4);
+	expect("damaged table falls back to older file", Launch(directory, buildKey, assets), 1, assetCount - 1, 0, 1, 0);
+
+	std::filesystem::resize_file(GetSlotPath(directory, 0), sizeof(DX::WarmStartCacheHeader) + 8);
+	expect("truncated file falls back to older file", Launch(directory, buildKey, assets), 1, assetCount - 1, 0, 1, 0);
+
+	DamageFile(GetSlotPath(directory, 0), offsetof(DX::WarmStartCacheHeader, version));
+	expect("other format version is ignored", Launch(directory, buildKey, assets), 1, assetCount - 1, 0, 1, 0);
+
+	expect("new build key rebuilds everything", Launch(directory, buildKey + 1, assets), None, 0, assetCount, 0, 0);
+	expect("new build finds everything", Launch(directory, buildKey + 1, assets), 0, assetCount, 0, 0, None);
+
+	if (!keep)
+	{
+		std::filesystem::remove_all(directory);
+	}
+
+	return ReportChecks();
+}
+
+int main(int argc, char** argv)
+{
+	std::string command = argc > 1 ? argv[1] : "";
+	std::string path;
+	std::string directory;
+	uint64_t buildKey = 0;
+	bool hasBuildKey = false;
+	bool keep = false;
+
+	for (int i = 2; i < argc; i++)
+	{
+		std::string argument = argv[i];
+		if (argument == "--build-key" && i + 1 < argc)
+		{
+			buildKey = strtoull(argv[++i], nullptr, 16);
+			hasBuildKey = true;
+		}
+		else if (argument == "--directory" && i + 1 < argc)
+		{
+			directory = argv[++i];
+		}
+		else if (argument == "--keep")
+		{
+			keep = true;
+		}
+		else if (command == "info" && path.empty())
+		{
+			path = argument;
+		}
+		else
+		{
+			command.clear();
+			break;
+		}
+	}
+
+	if (command == "info" && !path.empty())
+	{
+		return Info(path, hasBuildKey, buildKey);
+	}
+	if (command == "check")
+	{
+		return Check(directory, keep);
+	}
+
+	fprintf(stderr, "Usage: %s info <file> [--build-key <hex>]\n", argv[0]);
+	fprintf(stderr, "       %s check [--directory <path>] [--keep]\n", argv[0]);
+	return 1;
+}
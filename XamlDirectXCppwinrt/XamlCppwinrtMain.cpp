@@ -1,29 +1,101 @@
 ﻿#include "pch.h"
 #include "$projectname$Main.h"
 #include "Common\DirectXHelper.h"
+#include "Common\SoftwareRasterizer.h"
+#include <fstream>
 
 using namespace winrt::$projectname$::implementation;
 using namespace winrt::Windows::Foundation;
+using namespace winrt::Windows::Graphics::Display;
 using namespace winrt::Windows::System::Threading;
 
-// Loads and initializes application assets when the application is loaded.
-$projectname$Main::$projectname$Main(const std::shared_ptr<DX::DeviceResources>& deviceResources) :
-	m_deviceResources(deviceResources), m_pointerLocationX(0.0f)
+// Adds the stages that load and initialize application assets to the app's startup. Assets
+// that don't need the device load while it is being created; the rest wait for the swap chain.
+$projectname$Main::$projectname$Main(const std::shared_ptr<DX::DeviceResources>& deviceResources, DX::StartupGraph& startup, DX::StartupGraph::StageId swapChainReady) :
+	m_deviceResources(deviceResources), m_pointerLocationX(0.0f), m_fullRedrawFrames(2),
+	m_appliedDisplayCommands(0), m_coalescedDisplayCommands(0), m_maxDisplayCommandLatency(0)
 {
+	m_inputHistory.reserve(DX::InputEventQueue::Capacity);
+
 	// Register to be notified if the Device is lost or recreated
 	m_deviceResources->RegisterDeviceNotify(this);
 
-	// TODO: Replace this with your app's content initialization.
-	m_sceneRenderer = std::unique_ptr<Sample3DSceneRenderer>(new Sample3DSceneRenderer(m_deviceResources));
+	m_frameScheduler = std::make_shared<DX::FrameScheduler>();
+	m_deferredContexts = std::make_shared<DX::DeferredContextPool>();
+
+	// TODO: Size the geometry pool for your app's content.
+	m_geometryPool = std::make_shared<DX::GeometryPool>(VertexPositionColorLayout::Stride, 1 << 16, 3 << 16);
+
+	// Caches from another version of the package are ignored, since what it derives from its
+	// assets may have changed along with them.
+	auto version = winrt::Windows::ApplicationModel::Package::Current().Id().Version();
+	m_warmStart = std::make_shared<DX::WarmStartStore>(
+		(uint64_t(version.Major) << 48) | (uint64_t(version.Minor) << 32) | (uint64_t(version.Build) << 16) | version.Revision);
+
+	// Shader variants are packed into Shaders.dxsa by ShaderArchiveBuilder. Until the archive is
+	// added to the package, they are loaded from the loose .cso files.
+	m_shaderLibrary = std::make_shared<DX::ShaderLibrary>(L"Shaders.dxsa", m_warmStart);
+
+	// TODO: Size the texture budget for your app's content and target hardware.
+	m_textureStreamer = std::make_shared<DX::TextureStreamer>(256ull << 20, 8ull << 20);
+
+	auto warmStartCache = startup.AddStage("Warm-start cache", {}, DX::StartupThread::Any, [this]
+	{
+		LoadWarmStartCache();
+	});
+
+	auto shaderArchive = startup.AddStage("Shader archive", { warmStartCache }, DX::StartupThread::Any, [this]
+	{
+		m_shaderLibrary->Open();
+	});
+
+	// Building the glyph atlas only needs DirectWrite, which is created here on first use.
+	auto overlayFont = startup.AddStage("Overlay font", {}, DX::StartupThread::Any, [this]
+	{
+		m_overlayFont = std::make_shared<DX::DistanceFieldFont>(m_deviceResources->GetDWriteFactory(), L"Segoe UI", DWRITE_FONT_WEIGHT_LIGHT);
+	});
+
+	startup.AddStage("Content", { swapChainReady, shaderArchive, overlayFont }, DX::StartupThread::Any, [this]
+	{
+		CreateContent();
+	});
 
-	m_fpsTextRenderer = std::unique_ptr<SampleFpsTextRenderer>(new SampleFpsTextRenderer(m_deviceResources));
+	// TODO: Call SetOnDemandRendering(true) if your content is mostly static. The render loop will then
+	// sleep until input, a size change or a renderer invalidates the frame.
 
 	// TODO: Change the timer settings if you want something other than the default variable timestep mode.
 	// e.g. for 60 FPS fixed timestep update logic, call:
 	/*
 	m_timer.SetFixedTimeStep(true);
 	m_timer.SetTargetElapsedSeconds(1.0 / 60);
+	m_timer.SetMaxUpdatesPerTick(4);
 	*/
+	// Renderers interpolate between the last two updates, so the fixed update rate does
+	// not need to match the display refresh rate.
+}
+
+// Creates the renderers, once the device, the swap chain, the shader archive and the overlay
+// font are ready.
+void $projectname$Main::CreateContent()
+{
+	// TODO: Replace this with your app's content initialization.
+	m_sceneRenderer = std::unique_ptr<Sample3DSceneRenderer>(new Sample3DSceneRenderer(m_deviceResources, m_frameScheduler, m_deferredContexts, m_geometryPool, m_shaderLibrary, m_warmStart));
+
+	m_fpsTextRenderer = std::unique_ptr<SampleFpsTextRenderer>(new SampleFpsTextRenderer(m_deviceResources, m_overlayFont));
+
+	m_spriteRenderer = std::make_unique<DX::SpriteRenderer>(m_deviceResources, m_shaderLibrary);
+
+	// TODO: Match the GPU budget to the display's refresh rate. This leaves a tenth of a 60 Hz
+	// frame for the compositor and for GPU work other than this app's.
+	DX::ResolutionController::Settings resolutionSettings;
+	resolutionSettings.targetMilliseconds = 0.9f * 1000.0f / 60.0f;
+	m_dynamicResolution = std::make_unique<DX::DynamicResolution>(m_deviceResources, resolutionSettings);
+
+	// TODO: Call SetAntiAliasingMode to antialias the 3D content. Compare the modes' costs with
+	// GetAntiAliasingCost on your target hardware.
+	m_antiAliasing = std::make_unique<DX::AntiAliasing>(m_deviceResources, m_shaderLibrary);
+
+	CreateDeviceDependentResources();
 }
 
 $projectname$Main::~$projectname$Main()
@@ -32,64 +104,567 @@ $projectname$Main::~$projectname$Main()
 	m_deviceResources->RegisterDeviceNotify(nullptr);
 }
 
+// Creates the resources used by the frame composition itself.
+void $projectname$Main::CreateDeviceDependentResources()
+{
+	CD3D11_RASTERIZER_DESC rasterizerDesc(D3D11_DEFAULT);
+	rasterizerDesc.ScissorEnable = TRUE;
+	winrt::check_hresult(
+		m_deviceResources->GetD3DDevice()->CreateRasterizerState(
+			&rasterizerDesc,
+			m_scissorRasterizerState.put()));
+
+	m_deferredContexts->CreateDeviceDependentResources(m_deviceResources->GetD3DDevice(), m_deviceResources->GetD3DDeviceContext());
+	m_geometryPool->CreateDeviceDependentResources(m_deviceResources->GetD3DDevice());
+	m_textureStreamer->CreateDeviceDependentResources(m_deviceResources->GetD3DDevice());
+	m_spriteRenderer->CreateDeviceDependentResourcesAsync();
+	m_overlayFont->CreateDeviceDependentResources(m_deviceResources->GetD3DDevice(), *m_spriteRenderer);
+	m_dynamicResolution->CreateDeviceDependentResources();
+	m_antiAliasing->CreateDeviceDependentResourcesAsync();
+
+#if defined(DX_ENABLE_PROFILER)
+	m_gpuProfiler.CreateDeviceDependentResources(m_deviceResources->GetD3DDevice());
+#endif
+}
+
 // Updates application state when the window size changes (e.g. device orientation change)
 void $projectname$Main::CreateWindowSizeDependentResources() 
 {
 	// TODO: Replace this with the size-dependent initialization of your app's content.
 	m_sceneRenderer->CreateWindowSizeDependentResources();
+	m_dynamicResolution->CreateWindowSizeDependentResources(*m_spriteRenderer);
+	m_antiAliasing->CreateWindowSizeDependentResources();
+
+	// Both swap chain buffers have undefined contents after a resize.
+	m_fullRedrawFrames = 2;
+
+	m_frameScheduler->Invalidate();
 }
 
 void $projectname$Main::StartRenderLoop()
 {
-	// If the animation render loop is already running then do not start another thread.
-	if (m_renderLoopWorker != nullptr && m_renderLoopWorker.Status() == AsyncStatus::Started)
+	m_lifecycle.Resume();
+	UpdateWorkersAsync();
+}
+
+// The state changes at once, so that a transition queued earlier can't start a worker after
+// this one stopped it. The workers reference this object, so it stays alive until they exit.
+IAsyncAction $projectname$Main::StopRenderLoopAsync()
+{
+	auto self = shared_from_this();
+	m_lifecycle.Suspend();
+	co_await winrt::resume_background();
+	UpdateWorkers();
+}
+
+void $projectname$Main::SetVisible(bool visible)
+{
+	m_lifecycle.SetVisible(visible);
+	UpdateWorkersAsync();
+}
+
+// Runs UpdateWorkers on a background thread, since waiting for a worker may take until the
+// next vsync. Each transition applies the state as it is when it runs, so transitions that
+// overtake each other still end with the workers the latest state runs.
+winrt::fire_and_forget $projectname$Main::UpdateWorkersAsync()
+{
+	auto self = shared_from_this();
+	co_await winrt::resume_background();
+	UpdateWorkers();
+}
+
+// Waits for the workers the lifecycle state no longer runs, then starts the ones it does.
+// Stopping comes first, since the render loop and the streaming worker share the immediate
+// context. The wait is at most one frame, or one iteration of the streaming worker.
+void $projectname$Main::UpdateWorkers()
+{
+	std::lock_guard<std::mutex> lock(m_workerMutex);
+
+	// The loop may be asleep waiting for an invalidation; wake it so it sees the change.
+	m_frameScheduler->Wake();
+	m_lifecycle.WaitForWorkers();
+
+	if (m_lifecycle.BeginWorker(DX::LifecycleWorker::Render))
 	{
-		return;
+		// Always draw at least one frame when the loop starts.
+		m_frameScheduler->Invalidate();
+
+		// Run task on a dedicated high priority background thread.
+		ThreadPool::RunAsync([this](IAsyncAction const&) { RunRenderLoop(); }, WorkItemPriority::High, WorkItemOptions::TimeSliced);
 	}
 
-	// Create a task that will be run on a background thread.
-	auto workItemHandler = [this](IAsyncAction const& action)
+	if (m_lifecycle.BeginWorker(DX::LifecycleWorker::Streaming))
 	{
-		// Calculate the updated frame and render once per vertical blanking interval.
-		while (action.Status() == AsyncStatus::Started)
+		// Streaming in the background must not compete with the apps in the foreground.
+		ThreadPool::RunAsync([this](IAsyncAction const&) { RunStreamingWorker(); }, WorkItemPriority::Low, WorkItemOptions::TimeSliced);
+	}
+}
+
+void $projectname$Main::RunRenderLoop()
+{
+	DX_PROFILE_THREAD_NAME("Render");
+	DX::LifecycleWorkerScope worker(m_lifecycle, DX::LifecycleWorker::Render);
+
+	// Calculate the updated frame and render once per vertical blanking interval. While the
+	// window is occluded, nothing drawn would be shown: only update, at the reduced rate the
+	// lifecycle scheduler paces, and test whether presents are shown again.
+	while (m_lifecycle.WaitForTick(DX::LifecycleWorker::Render))
+	{
+		bool occluded = (m_lifecycle.GetState() == DX::LifecycleState::Occluded);
+
+		// When rendering on demand, sleep until there is something new to draw.
+		if (!occluded && !m_frameScheduler->WaitForFrame())
+		{
+			continue;
+		}
+
 		{
-			concurrency::critical_section::scoped_lock lock(m_criticalSection);
+			DX_PROFILE_SCOPE("Frame");
+			ApplyDisplayCommands();
+			ApplyRestoredState();
 			Update();
-			if (Render())
+			if (occluded)
+			{
+				StreamAssets(m_deviceResources->GetD3DDeviceContext());
+				occluded = m_deviceResources->TestPresent();
+			}
+			else if (Render())
 			{
-				m_deviceResources->Present();
+				DX_PROFILE_SCOPE("Present");
+				m_deviceResources->Present(m_frameDamage);
+				occluded = m_deviceResources->IsOccluded();
 			}
 		}
+		m_lifecycle.SetOccluded(occluded);
+
+#if defined(DX_ENABLE_PROFILER)
+		DX::Profiler::Get().Collect();
+#endif
+	}
+}
+
+// Runs while the window is hidden, so that the detail the last frames asked for is resident
+// when it is shown again.
+void $projectname$Main::RunStreamingWorker()
+{
+	DX_PROFILE_THREAD_NAME("Streaming");
+	DX::LifecycleWorkerScope worker(m_lifecycle, DX::LifecycleWorker::Streaming);
+
+	while (m_lifecycle.WaitForTick(DX::LifecycleWorker::Streaming))
+	{
+		StreamAssets(m_deviceResources->GetD3DDeviceContext());
+	}
+}
+
+// Uploads meshes added since the last frame, and the texture mips the last frame needed.
+void $projectname$Main::StreamAssets(ID3D11DeviceContext3* context)
+{
+	m_geometryPool->Flush(context);
+	m_textureStreamer->Update(context);
+}
+
+IAsyncAction $projectname$Main::SuspendAsync()
+{
+	auto self = shared_from_this();
+
+	// Continues on the background thread that waited for the workers, where writing files
+	// doesn't hold up the UI thread either. The app may be terminated from here on without
+	// another chance to write them, so this is the only place they are saved.
+	co_await StopRenderLoopAsync();
+
+	SaveProfile();
+	SaveWarmStartCache();
+
+	// With every worker stopped, nothing else touches the device context while it is trimmed.
+	TrimCaches();
+	m_deviceResources->Trim();
+}
+
+// Releases memory that the render loop recreates on its own once it runs again.
+void $projectname$Main::TrimCaches()
+{
+	m_antiAliasing->Trim();
+	m_textureStreamer->Trim(m_deviceResources->GetD3DDeviceContext());
+}
+
+namespace
+{
+	const uint32_t TimerStateTag = DX::MakeStateSnapshotTag('T', 'I', 'M', 'E');
+}
+
+std::vector<uint8_t> $projectname$Main::SaveState()
+{
+	DX::StateSnapshotWriter snapshot;
+	snapshot.Write(TimerStateTag, m_timer.GetState());
+	m_sceneRenderer->SaveState(snapshot);
+	return snapshot.Finish();
+}
+
+void $projectname$Main::RestoreState(std::vector<uint8_t> snapshot)
+{
+	{
+		std::lock_guard<std::mutex> lock(m_restoredStateMutex);
+		m_restoredState = std::move(snapshot);
+	}
+	m_frameScheduler->Invalidate();
+}
+
+// Applies a snapshot from RestoreState. A snapshot that isn't valid, e.g. from another version
+// of the format, is ignored, and the app starts from the beginning.
+void $projectname$Main::ApplyRestoredState()
+{
+	std::vector<uint8_t> data;
+	{
+		std::lock_guard<std::mutex> lock(m_restoredStateMutex);
+		if (m_restoredState.empty())
+		{
+			return;
+		}
+		data.swap(m_restoredState);
+	}
+
+	DX::StateSnapshotReader snapshot;
+	if (!snapshot.Open(data.data(), data.size()))
+	{
+		return;
+	}
+
+	DX::StepTimerState timerState;
+	if (snapshot.Read(TimerStateTag, &timerState))
+	{
+		m_timer.SetState(timerState);
+	}
+	m_sceneRenderer->RestoreState(snapshot);
+}
+
+void $projectname$Main::SetLogicalSize(Size logicalSize)
+{
+	DisplayCommand command = {};
+	command.type = DisplayCommandType::SetLogicalSize;
+	command.x = logicalSize.Width;
+	command.y = logicalSize.Height;
+	QueueDisplayCommand(command);
+}
+
+void $projectname$Main::SetDpi(float dpi)
+{
+	DisplayCommand command = {};
+	command.type = DisplayCommandType::SetDpi;
+	command.x = dpi;
+	QueueDisplayCommand(command);
+}
+
+void $projectname$Main::SetCurrentOrientation(DisplayOrientations currentOrientation)
+{
+	DisplayCommand command = {};
+	command.type = DisplayCommandType::SetCurrentOrientation;
+	command.orientation = currentOrientation;
+	QueueDisplayCommand(command);
+}
+
+void $projectname$Main::SetCompositionScale(float compositionScaleX, float compositionScaleY)
+{
+	DisplayCommand command = {};
+	command.type = DisplayCommandType::SetCompositionScale;
+	command.x = compositionScaleX;
+	command.y = compositionScaleY;
+	QueueDisplayCommand(command);
+}
+
+void $projectname$Main::ValidateDevice()
+{
+	DisplayCommand command = {};
+	command.type = DisplayCommandType::ValidateDevice;
+	QueueDisplayCommand(command);
+}
+
+// Hands a display change to the render loop and makes sure a frame follows it. A change of a
+// type the loop hasn't applied yet replaces the pending one, e.g. during a resize drag or while
+// the loop is stopped, but keeps its queue time so the latency still counts from the first.
+void $projectname$Main::QueueDisplayCommand(DisplayCommand command)
+{
+	command.queuedTicks = static_cast<uint64_t>(DX::StepTimer::GetTicks());
+	bool coalesced = m_displayCommands[static_cast<size_t>(command.type)].Update([&command](DisplayCommand& pending, bool isPending)
+	{
+		if (isPending)
+		{
+			command.queuedTicks = pending.queuedTicks;
+		}
+		pending = command;
+	});
+
+	if (coalesced)
+	{
+		m_coalescedDisplayCommands.fetch_add(1, std::memory_order_relaxed);
+	}
+	m_frameScheduler->Invalidate();
+}
+
+// Applies the display changes queued since the previous frame. Runs on the render loop, so
+// device resources are never modified while a frame is being drawn.
+void $projectname$Main::ApplyDisplayCommands()
+{
+	DX_PROFILE_SCOPE("ApplyDisplayCommands");
+
+	uint64_t now = static_cast<uint64_t>(DX::StepTimer::GetTicks());
+	uint64_t maxLatency = m_maxDisplayCommandLatency.load(std::memory_order_relaxed);
+	uint64_t appliedCount = 0;
+	bool validateDevice = false;
+
+	// Several changes often arrive together, e.g. size and composition scale during a resize.
+	// They are folded into one display state, so the swap chain changes at most once for all
+	// of them.
+	DX::DisplayState state = m_deviceResources->GetDisplayState();
+
+	DisplayCommand command;
+	for (auto& pendingCommand : m_displayCommands)
+	{
+		if (!pendingCommand.Take(command))
+		{
+			continue;
+		}
+
+		switch (command.type)
+		{
+		case DisplayCommandType::SetLogicalSize:
+			state.logicalWidth = command.x;
+			state.logicalHeight = command.y;
+			break;
+
+		case DisplayCommandType::SetDpi:
+			state.dpi = command.x;
+			break;
+
+		case DisplayCommandType::SetCurrentOrientation:
+			state.currentOrientation = static_cast<DX::DisplayOrientation>(command.orientation);
+			break;
+
+		case DisplayCommandType::SetCompositionScale:
+			state.compositionScaleX = command.x;
+			state.compositionScaleY = command.y;
+			break;
+
+		case DisplayCommandType::ValidateDevice:
+			validateDevice = true;
+			break;
+		}
+
+		// A change queued after now was read counts as applied at once.
+		maxLatency = (std::max)(maxLatency, now - (std::min)(now, command.queuedTicks));
+		appliedCount++;
+	}
+
+	if (appliedCount == 0)
+	{
+		return;
+	}
+
+	// Content only needs rebuilding if something it can see changed. A device lost while
+	// validating is rebuilt through OnDeviceRestored instead.
+	if (m_deviceResources->SetDisplayState(state) != DX::DisplayChange::None)
+	{
+		CreateWindowSizeDependentResources();
+	}
+
+	if (validateDevice)
+	{
+		m_deviceResources->ValidateDevice();
+	}
+
+	m_appliedDisplayCommands.fetch_add(appliedCount, std::memory_order_relaxed);
+	m_maxDisplayCommandLatency.store(maxLatency, std::memory_order_relaxed);
+}
+
+// Writes the recorded CPU and GPU timeline to FrameTrace.json in the app's local folder, for
+// viewing in chrome://tracing or Perfetto. Does nothing unless the profiler is compiled in.
+void $projectname$Main::SaveProfile()
+{
+#if defined(DX_ENABLE_PROFILER)
+	std::wstring path{ winrt::Windows::Storage::ApplicationData::Current().LocalFolder().Path() };
+	std::ofstream stream(path + L"\\FrameTrace.json", std::ios::out | std::ios::trunc);
+	if (stream)
+	{
+		DX::Profiler::Get().WriteChromeTrace(stream);
+	}
+#endif
+}
+
+// Draws the scene again with the software rasterizer, through the same draw packets, and
+// compares it with the frame the GPU just drew. It runs once per launch, as reading the back
+// buffer stalls until the GPU is done. Both images are written to the local folder as
+// GoldenFrame.ppm and GpuFrame.ppm, to be compared side by side when they differ.
+//
+// No configuration compiles it in, so ordinary debug runs don't pay for the readback. A build
+// that checks the renderer defines DX_ENABLE_GOLDEN_FRAME, for instance by running msbuild
+// with CL=/DDX_ENABLE_GOLDEN_FRAME in its environment.
+#if defined(DX_ENABLE_GOLDEN_FRAME)
+void $projectname$Main::CheckGoldenFrame(ID3D11DeviceContext3* context)
+{
+	if (m_goldenFrameChecked || !m_sceneRenderer->IsLoadingComplete())
+	{
+		return;
+	}
+	m_goldenFrameChecked = true;
+
+	winrt::com_ptr<ID3D11Resource> backBuffer;
+	m_deviceResources->GetBackBufferRenderTargetView()->GetResource(backBuffer.put());
+	D3D11_TEXTURE2D_DESC desc;
+	backBuffer.as<ID3D11Texture2D>()->GetDesc(&desc);
+	desc.Usage = D3D11_USAGE_STAGING;
+	desc.BindFlags = 0;
+	desc.CPUAccessFlags = D3D11_CPU_ACCESS_READ;
+	desc.MiscFlags = 0;
+	winrt::com_ptr<ID3D11Texture2D> staging;
+	winrt::check_hresult(m_deviceResources->GetD3DDevice()->CreateTexture2D(&desc, nullptr, staging.put()));
+	context->CopyResource(staging.get(), backBuffer.get());
+
+	// The back buffer is B8G8R8A8, as the rasterizer's pixels are.
+	std::vector<uint32_t> gpuFrame(size_t(desc.Width) * desc.Height);
+	D3D11_MAPPED_SUBRESOURCE mapped;
+	winrt::check_hresult(context->Map(staging.get(), 0, D3D11_MAP_READ, 0, &mapped));
+	for (uint32_t row = 0; row < desc.Height; row++)
+	{
+		memcpy(&gpuFrame[size_t(row) * desc.Width], static_cast<const uint8_t*>(mapped.pData) + size_t(row) * mapped.RowPitch, desc.Width * sizeof(uint32_t));
+	}
+	context->Unmap(staging.get(), 0);
+
+	DX::SoftwareRasterizer rasterizer(desc.Width, desc.Height, (std::max)(std::thread::hardware_concurrency(), 1u));
+	rasterizer.Clear(DirectX::Colors::CornflowerBlue, 1.0f);
+	m_sceneRenderer->Render(m_timer, rasterizer);
+	rasterizer.Flush();
+
+	// Rounding may move the odd edge pixel, and change colors by a step.
+	const uint32_t tolerance = 1;
+	DX::ImageDifference difference = DX::CompareImages(gpuFrame.data(), rasterizer.GetPixels(), desc.Width * desc.Height, tolerance);
+
+	std::wstring folder{ winrt::Windows::Storage::ApplicationData::Current().LocalFolder().Path() };
+	auto writeImage = [&](const wchar_t* name, const uint32_t* pixels)
+	{
+		std::vector<uint8_t> image = DX::EncodePortablePixmap(pixels, desc.Width, desc.Height);
+		std::ofstream stream(folder + name, std::ios::out | std::ios::binary | std::ios::trunc);
+		stream.write(reinterpret_cast<const char*>(image.data()), image.size());
 	};
+	writeImage(L"\\GoldenFrame.ppm", rasterizer.GetPixels());
+	writeImage(L"\\GpuFrame.ppm", gpuFrame.data());
 
-	// Run task on a dedicated high priority background thread.
-	m_renderLoopWorker = ThreadPool::RunAsync(workItemHandler, WorkItemPriority::High, WorkItemOptions::TimeSliced);
+	char message[128];
+	snprintf(message, sizeof(message), "Golden frame: %u of %u pixels differ by more than %u, by up to %u\n",
+		difference.differentPixels, desc.Width * desc.Height, tolerance, difference.maxChannelDifference);
+	OutputDebugStringA(message);
 }
+#endif
 
-void $projectname$Main::StopRenderLoop()
+// Offers both cache files in the local folder to the warm-start store, which keeps the newest
+// valid one. A cache that can't be read is only rebuilt, never an error.
+void $projectname$Main::LoadWarmStartCache()
 {
-	m_renderLoopWorker.Cancel();
+	std::wstring folder{ winrt::Windows::Storage::ApplicationData::Current().LocalFolder().Path() };
+	for (uint32_t slot = 0; slot < DX::WarmStartStore::SlotCount; slot++)
+	{
+		try
+		{
+			if (m_warmStartFiles[slot].OpenFile(folder + L"\\WarmStart" + std::to_wstring(slot) + L".dxwc"))
+			{
+				m_warmStart->Open(slot, m_warmStartFiles[slot].GetData(), m_warmStartFiles[slot].GetSize());
+			}
+		}
+		catch (winrt::hresult_error const&)
+		{
+			// E.g. an empty file left by a save that didn't finish.
+		}
+	}
+
+	for (uint32_t slot = 0; slot < DX::WarmStartStore::SlotCount; slot++)
+	{
+		if (slot != m_warmStart->GetLoadedSlot())
+		{
+			m_warmStartFiles[slot].Close();
+		}
+	}
+}
+
+// Writes what this launch added to the warm-start cache to the file it wasn't loaded from, so
+// the loaded file stays valid for the lookups that point into it.
+void $projectname$Main::SaveWarmStartCache()
+{
+	if (!m_warmStart->NeedsSave())
+	{
+		return;
+	}
+
+	std::vector<uint8_t> file = m_warmStart->Serialize();
+	std::wstring path{ winrt::Windows::Storage::ApplicationData::Current().LocalFolder().Path() };
+	std::ofstream stream(path + L"\\WarmStart" + std::to_wstring(m_warmStart->GetSaveSlot()) + L".dxwc", std::ios::binary | std::ios::trunc);
+	stream.write(reinterpret_cast<const char*>(file.data()), file.size());
 }
 
 // Updates the application state once per frame.
 void $projectname$Main::Update() 
 {
+	DX_PROFILE_SCOPE("Update");
+
 	ProcessInput();
 
 	// Update scene objects.
 	m_timer.Tick([&]()
 	{
 		// TODO: Replace this with your app's content update functions.
-		m_sceneRenderer->Update(m_timer);
-		m_fpsTextRenderer->Update(m_timer);
+		{
+			DX_PROFILE_SCOPE("Sample3DSceneRenderer::Update");
+			m_sceneRenderer->Update(m_timer);
+		}
+		{
+			DX_PROFILE_SCOPE("SampleFpsTextRenderer::Update");
+			m_fpsTextRenderer->Update(m_timer);
+		}
 	});
 }
 
 // Process all input from the user before updating game state
 void $projectname$Main::ProcessInput()
 {
+	DX_PROFILE_SCOPE("ProcessInput");
+
+	// Drain every sample queued by the input thread since the previous frame. The full list is
+	// kept in m_inputHistory for gesture processing, while consecutive moves are coalesced so
+	// the scene only tracks the most recent pointer position.
+	m_inputHistory.clear();
+	bool pointerMoved = false;
+
+	m_inputQueue.Drain([&](DX::InputEvent const& inputEvent)
+	{
+		m_inputHistory.push_back(inputEvent);
+
+		switch (inputEvent.type)
+		{
+		case DX::InputEventType::PointerPressed:
+			m_sceneRenderer->StartTracking();
+			m_pointerLocationX = inputEvent.x;
+			pointerMoved = true;
+			break;
+
+		case DX::InputEventType::PointerMoved:
+			m_pointerLocationX = inputEvent.x;
+			pointerMoved = true;
+			break;
+
+		case DX::InputEventType::PointerReleased:
+			// Apply the final position before tracking stops so a quick drag isn't lost.
+			if (pointerMoved)
+			{
+				m_sceneRenderer->TrackingUpdate(m_pointerLocationX);
+				pointerMoved = false;
+			}
+			m_sceneRenderer->StopTracking();
+			break;
+		}
+	});
+
 	// TODO: Add per frame input handling here.
-	m_sceneRenderer->TrackingUpdate(m_pointerLocationX);
+	if (pointerMoved)
+	{
+		m_sceneRenderer->TrackingUpdate(m_pointerLocationX);
+	}
 }
 
 // Renders the current frame according to the current application state.
@@ -102,24 +677,156 @@ bool $projectname$Main::Render()
 		return false;
 	}
 
+	DX_PROFILE_SCOPE("Render");
+
 	auto context = m_deviceResources->GetD3DDeviceContext();
+	DX_PROFILE_GPU_FRAME(m_gpuProfiler, context);
+
+	StreamAssets(context);
 
-	// Reset the viewport to target the whole screen.
 	auto viewport = m_deviceResources->GetScreenViewport();
-	context->RSSetViewports(1, &viewport);
+	DX::DirtyRect screenBounds = { 0, 0, lround(viewport.Width), lround(viewport.Height) };
 
-	// Reset render targets to the screen.
-	ID3D11RenderTargetView *const targets[1] = { m_deviceResources->GetBackBufferRenderTargetView() };
-	context->OMSetRenderTargets(1, targets, m_deviceResources->GetDepthStencilView());
+	// Pick the resolution of the 3D content from the GPU times of earlier frames. Nothing drawn
+	// at the old scale can be reused at the new one.
+	if (m_dynamicResolution->Update(context))
+	{
+		m_fullRedrawFrames = 2;
+	}
 
-	// Clear the back buffer and depth stencil view.
-	context->ClearRenderTargetView(m_deviceResources->GetBackBufferRenderTargetView(), DirectX::Colors::CornflowerBlue);
-	context->ClearDepthStencilView(m_deviceResources->GetDepthStencilView(), D3D11_CLEAR_DEPTH | D3D11_CLEAR_STENCIL, 1.0f, 0);
+	// Apply a new antialiasing mode. Its targets start out empty.
+	if (m_antiAliasing->Update())
+	{
+		m_fullRedrawFrames = 2;
+	}
+
+	// Find out what changed since the last presented frame.
+	// TODO: Have your app's content renderers report the areas they change.
+	m_frameDamage.Clear();
+	if (m_fullRedrawFrames > 0)
+	{
+		m_frameDamage.Add(screenBounds);
+		m_fullRedrawFrames--;
+	}
+	m_sceneRenderer->CollectDamage(m_timer, screenBounds, m_frameDamage);
+	m_fpsTextRenderer->CollectDamage(m_frameDamage);
+	m_antiAliasing->CollectDamage(screenBounds, m_frameDamage);
+	m_frameDamage.Clip(screenBounds);
+
+	// Keep drawing until the temporal history settles.
+	if (m_antiAliasing->IsAccumulating())
+	{
+		m_frameScheduler->Invalidate();
+	}
+
+	// Repaint everything that differs between the back buffer and the frame being produced.
+	DX::DirtyRegion repaintRegion = m_frameDamage;
+	repaintRegion.Add(m_previousFrameDamage);
+	m_previousFrameDamage = m_frameDamage;
+
+	// Nothing changed; presenting the untouched buffer shows the same image again.
+	if (repaintRegion.IsEmpty())
+	{
+		return true;
+	}
+
+	// All layers are redrawn within one rectangle, since Direct3D applies a single scissor
+	// rectangle per viewport. Anything redrawn outside the exact region is unchanged anyway.
+	DX::DirtyRect repaintBounds = repaintRegion.GetBounds();
+	D3D11_RECT scissorRect = { repaintBounds.left, repaintBounds.top, repaintBounds.right, repaintBounds.bottom };
+
+	m_dynamicResolution->BeginFrame(context);
+
+	// Draw the 3D content into the offscreen target while the resolution is lowered, within
+	// the scaled viewport and the scaled repainted area.
+	bool scaled = m_dynamicResolution->IsScaled();
+	ID3D11RenderTargetView* finalTarget = m_deviceResources->GetBackBufferRenderTargetView();
+	D3D11_VIEWPORT sceneViewport = viewport;
+	D3D11_RECT sceneScissorRect = scissorRect;
+	if (scaled)
+	{
+		finalTarget = m_dynamicResolution->GetRenderTargetView();
+		sceneViewport = m_dynamicResolution->GetViewport();
+		sceneScissorRect = m_dynamicResolution->ScaleRect(scissorRect);
+	}
+
+	// While antialiasing, draw into its targets instead and resolve them into the final one.
+	bool antiAliased = m_antiAliasing->IsActive();
+	ID3D11RenderTargetView* sceneTarget = finalTarget;
+	ID3D11DepthStencilView* sceneDepthStencil = m_deviceResources->GetDepthStencilView();
+	if (antiAliased)
+	{
+		sceneTarget = m_antiAliasing->GetRenderTargetView();
+		sceneDepthStencil = m_antiAliasing->GetDepthStencilView();
+	}
+
+	// Reset the viewport to target the whole screen, or the scaled part of the offscreen target.
+	context->RSSetViewports(1, &sceneViewport);
+
+	// Reset render targets to the screen or the offscreen target.
+	ID3D11RenderTargetView *const targets[1] = { sceneTarget };
+	context->OMSetRenderTargets(1, targets, sceneDepthStencil);
+
+	m_antiAliasing->BeginScene(context);
+
+	// Clear the repainted part of the scene's target, and all of the depth stencil view.
+	{
+		DX_PROFILE_GPU_SCOPE(m_gpuProfiler, context, "Clear");
+		context->ClearView(sceneTarget, DirectX::Colors::CornflowerBlue, &sceneScissorRect, 1);
+		context->ClearDepthStencilView(sceneDepthStencil, D3D11_CLEAR_DEPTH | D3D11_CLEAR_STENCIL, 1.0f, 0);
+	}
 
 	// Render the scene objects.
 	// TODO: Replace this with your app's content rendering functions.
-	m_sceneRenderer->Render();
-	m_fpsTextRenderer->Render();
+	{
+		DX_PROFILE_SCOPE("Sample3DSceneRenderer::Render");
+		DX_PROFILE_GPU_SCOPE(m_gpuProfiler, context, "Sample3DSceneRenderer::Render");
+		context->RSSetState(m_scissorRasterizerState.get());
+		context->RSSetScissorRects(1, &sceneScissorRect);
+		m_sceneRenderer->SetProjectionJitter(m_antiAliasing->GetProjectionJitter(sceneViewport));
+		m_sceneRenderer->Render(m_timer);
+		context->RSSetState(nullptr);
+	}
+
+#if defined(DX_ENABLE_GOLDEN_FRAME)
+	// The back buffer holds the scene alone, until the overlays are drawn, when the scene was
+	// drawn straight into it and whole.
+	if (!scaled && !antiAliased && repaintBounds.Contains(screenBounds))
+	{
+		CheckGoldenFrame(context);
+	}
+#endif
+
+	{
+		DX_PROFILE_GPU_SCOPE(m_gpuProfiler, context, "AntiAliasing::Resolve");
+		m_antiAliasing->Resolve(context, finalTarget, sceneViewport, m_sceneRenderer->GetViewProjection());
+	}
+
+	// The overlays are drawn at full resolution on the back buffer.
+	ID3D11RenderTargetView *const backBufferTargets[1] = { m_deviceResources->GetBackBufferRenderTargetView() };
+	context->OMSetRenderTargets(1, backBufferTargets, m_deviceResources->GetDepthStencilView());
+	context->RSSetViewports(1, &viewport);
+	context->RSSetScissorRects(1, &scissorRect);
+
+	// Draw the offscreen target on the back buffer, under the overlays. The upscale covers the
+	// whole repainted area, so the back buffer needs no clear.
+	if (scaled)
+	{
+		DX_PROFILE_GPU_SCOPE(m_gpuProfiler, context, "DynamicResolution::Upscale");
+		m_dynamicResolution->DrawUpscale(m_spriteRenderer->GetBatch());
+		m_spriteRenderer->Render(context);
+	}
+
+	// Draw the 2D primitives of every overlay together, within the same scissor rectangle.
+	// TODO: Have your app's overlays add their sprites, lines and glyphs here.
+	{
+		DX_PROFILE_SCOPE("SpriteRenderer::Render");
+		DX_PROFILE_GPU_SCOPE(m_gpuProfiler, context, "SpriteRenderer::Render");
+		m_fpsTextRenderer->CollectSprites(m_spriteRenderer->GetBatch());
+		m_spriteRenderer->Render(context);
+	}
+
+	m_dynamicResolution->EndFrame(context);
 
 	return true;
 }
@@ -128,13 +835,24 @@ bool $projectname$Main::Render()
 void $projectname$Main::OnDeviceLost()
 {
 	m_sceneRenderer->ReleaseDeviceDependentResources();
-	m_fpsTextRenderer->ReleaseDeviceDependentResources();
+	m_scissorRasterizerState = nullptr;
+	m_deferredContexts->ReleaseDeviceDependentResources();
+	m_geometryPool->ReleaseDeviceDependentResources();
+	m_textureStreamer->ReleaseDeviceDependentResources();
+	m_spriteRenderer->ReleaseDeviceDependentResources();
+	m_overlayFont->ReleaseDeviceDependentResources();
+	m_dynamicResolution->ReleaseDeviceDependentResources();
+	m_antiAliasing->ReleaseDeviceDependentResources();
+
+#if defined(DX_ENABLE_PROFILER)
+	m_gpuProfiler.ReleaseDeviceDependentResources();
+#endif
 }
 
 // Notifies renderers that device resources may now be recreated.
 void $projectname$Main::OnDeviceRestored()
 {
 	m_sceneRenderer->CreateDeviceDependentResourcesAsync();
-	m_fpsTextRenderer->CreateDeviceDependentResources();
+	CreateDeviceDependentResources();
 	CreateWindowSizeDependentResources();
 }
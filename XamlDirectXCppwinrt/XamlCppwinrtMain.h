@@ -1,53 +1,225 @@
 ﻿#pragma once
 
 #include "Common\StepTimer.h"
+#include "Common\AntiAliasing.h"
 #include "Common\DeviceResources.h"
+#include "Common\DeferredContextPool.h"
+#include "Common\DirtyRegion.h"
+#include "Common\DistanceFieldFont.h"
+#include "Common\DynamicResolution.h"
+#include "Common\FrameScheduler.h"
+#include "Common\GeometryPool.h"
+#include "Common\GpuProfiler.h"
+#include "Common\InputEventQueue.h"
+#include "Common\LatestValue.h"
+#include "Common\LifecycleScheduler.h"
+#include "Common\LockFreeQueue.h"
+#include "Common\ShaderLibrary.h"
+#include "Common\SpriteRenderer.h"
+#include "Common\StartupGraph.h"
+#include "Common\StateSnapshot.h"
+#include "Common\TextureStreamer.h"
+#include "Common\WarmStartCache.h"
 #include "Content\Sample3DSceneRenderer.h"
 #include "Content\SampleFpsTextRenderer.h"
 
 // Renders Direct2D and 3D content on the screen.
 namespace winrt::$projectname$::implementation
 {
-	class $projectname$Main : public DX::IDeviceNotify
+	// Display changes reported by the UI thread, applied by the render loop between frames.
+	enum class DisplayCommandType : uint8_t
+	{
+		SetLogicalSize,
+		SetDpi,
+		SetCurrentOrientation,
+		SetCompositionScale,
+		ValidateDevice
+	};
+
+	const size_t DisplayCommandTypeCount = 5;
+
+	struct DisplayCommand
+	{
+		DisplayCommandType type;
+		float x;		// Width, DPI or horizontal composition scale.
+		float y;		// Height or vertical composition scale.
+		winrt::Windows::Graphics::Display::DisplayOrientations orientation;
+		uint64_t queuedTicks;	// QueryPerformanceCounter value when the oldest change it replaced was queued.
+	};
+
+	class $projectname$Main : public DX::IDeviceNotify, public std::enable_shared_from_this<$projectname$Main>
 	{
 	public:
-		$projectname$Main(const std::shared_ptr<DX::DeviceResources>& deviceResources);
+		// Content is created by the stages this adds to startup, the last of which waits for
+		// swapChainReady. Until they have run, only QueueInput and the display changes, which
+		// just queue work, may be called.
+		$projectname$Main(const std::shared_ptr<DX::DeviceResources>& deviceResources, DX::StartupGraph& startup, DX::StartupGraph::StageId swapChainReady);
 		~$projectname$Main();
 		void CreateWindowSizeDependentResources();
-		void StartTracking() { m_sceneRenderer->StartTracking(); }
-		void TrackingUpdate(float positionX) { m_pointerLocationX = positionX; }
-		void StopTracking() { m_sceneRenderer->StopTracking(); }
-		bool IsTracking() { return m_sceneRenderer->IsTracking(); }
+		void QueueInput(DX::InputEvent const& inputEvent) { m_inputQueue.Push(inputEvent); m_frameScheduler->Invalidate(); }
+
+		// The render loop and the background streaming worker run as the lifecycle state allows.
+		// StartRenderLoop starts the workers the state runs; StopRenderLoopAsync stops every worker
+		// and completes when they have exited. Changing the window's visibility starts and stops
+		// them likewise. The workers are started and joined on a background thread, so none of
+		// these wait, and the object must be owned by a shared_ptr.
 		void StartRenderLoop();
-		void StopRenderLoop();
+		winrt::Windows::Foundation::IAsyncAction StopRenderLoopAsync();
+		void SetVisible(bool visible);
+		DX::LifecycleState GetLifecycleState() { return m_lifecycle.GetState(); }
 
-		// IDeviceNotify
-		virtual void OnDeviceLost();
-		virtual void OnDeviceRestored();
+		// SuspendAsync stops the workers and waits for them, saves the profile and the warm-start
+		// cache, then releases what the first frames after Resume recreate and trims the driver's
+		// memory, all in the background. Resume only restarts the workers, since everything else
+		// is still loaded.
+		winrt::Windows::Foundation::IAsyncAction SuspendAsync();
+		void Resume() { StartRenderLoop(); }
+
+		// The simulation state as a compact blob, to restore if the app is relaunched after it
+		// was terminated while suspended. Save it while the render loop is stopped. A restored
+		// state is applied before the next frame, so RestoreState may be called at any time.
+		std::vector<uint8_t> SaveState();
+		void RestoreState(std::vector<uint8_t> snapshot);
+
+		// Display changes. These may be called from any thread and never wait for the render
+		// loop; the changes take effect before the next frame is drawn.
+		void SetLogicalSize(winrt::Windows::Foundation::Size logicalSize);
+		void SetDpi(float dpi);
+		void SetCurrentOrientation(winrt::Windows::Graphics::Display::DisplayOrientations currentOrientation);
+		void SetCompositionScale(float compositionScaleX, float compositionScaleY);
+		void ValidateDevice();
 
-		Concurrency::critical_section& CriticalSection()
+		// Display command statistics. Coalesced commands were replaced by a newer one of the same
+		// type before the render loop applied them. Latency is measured from queuing the oldest
+		// change to applying it, in seconds.
+		uint64_t GetAppliedDisplayCommandCount() const { return m_appliedDisplayCommands.load(std::memory_order_relaxed); }
+		uint64_t GetCoalescedDisplayCommandCount() const { return m_coalescedDisplayCommands.load(std::memory_order_relaxed); }
+		double GetMaxDisplayCommandLatency() const
 		{
-			return m_criticalSection;
+			return static_cast<double>(m_maxDisplayCommandLatency.load(std::memory_order_relaxed)) / DX::StepTimer::GetPerformanceFrequency();
 		}
 
+		// In on-demand mode frames are only drawn after something invalidates the current one.
+		void SetOnDemandRendering(bool onDemand) { m_frameScheduler->SetContinuous(!onDemand); }
+		void Invalidate() { m_frameScheduler->Invalidate(); }
+
+		// Antialiasing of the 3D content, applied before the next frame. Costs are updated by the
+		// render loop; read them while it is stopped to get consistent numbers.
+		void SetAntiAliasingMode(DX::AntiAliasingMode mode, uint32_t sampleCount = 4) { m_antiAliasing->SetMode(mode, sampleCount); m_frameScheduler->Invalidate(); }
+		DX::AntiAliasingCost GetAntiAliasingCost(DX::AntiAliasingMode mode) const { return m_antiAliasing->GetCost(mode); }
+
+		// IDeviceNotify
+		virtual void OnDeviceLost();
+		virtual void OnDeviceRestored();
+
 	private:
+		void QueueDisplayCommand(DisplayCommand command);
+		void ApplyDisplayCommands();
+		void ApplyRestoredState();
+		void TrimCaches();
+		void UpdateWorkers();
+		winrt::fire_and_forget UpdateWorkersAsync();
+		void RunRenderLoop();
+		void RunStreamingWorker();
+		void StreamAssets(ID3D11DeviceContext3* context);
+		void CreateContent();
+		void CreateDeviceDependentResources();
+		void SaveProfile();
+		void LoadWarmStartCache();
+		void SaveWarmStartCache();
 		void ProcessInput();
 		void Update();
 		bool Render();
+#if defined(DX_ENABLE_GOLDEN_FRAME)
+		void CheckGoldenFrame(ID3D11DeviceContext3* context);
+#endif
 
 		// Cached pointer to device resources.
 		std::shared_ptr<DX::DeviceResources> m_deviceResources;
 
+		// Decides when the render loop needs to draw.
+		std::shared_ptr<DX::FrameScheduler> m_frameScheduler;
+
+		// Worker contexts shared by the renderers for multithreaded recording.
+		std::shared_ptr<DX::DeferredContextPool> m_deferredContexts;
+
+		// Vertex and index buffers shared by all static meshes.
+		std::shared_ptr<DX::GeometryPool> m_geometryPool;
+
+		// What earlier launches derived from the app's assets, mapped from one of two files in the
+		// local folder. The loaded file stays mapped as long as the app runs.
+		std::shared_ptr<DX::WarmStartStore> m_warmStart;
+		DX::MappedFile m_warmStartFiles[DX::WarmStartStore::SlotCount];
+
+		// Compiled shaders, shared by the renderers and kept across device loss.
+		std::shared_ptr<DX::ShaderLibrary> m_shaderLibrary;
+
+		// Block-compressed textures streamed in under a video memory budget.
+		std::shared_ptr<DX::TextureStreamer> m_textureStreamer;
+
+		// Draws the 2D primitives of every overlay in a few draw calls.
+		std::unique_ptr<DX::SpriteRenderer> m_spriteRenderer;
+
+		// Glyphs of the overlay text, drawn at any size and DPI from one atlas.
+		std::shared_ptr<DX::DistanceFieldFont> m_overlayFont;
+
+		// Lowers the resolution of the 3D content when the GPU falls behind.
+		std::unique_ptr<DX::DynamicResolution> m_dynamicResolution;
+
+		// Multisample or temporal antialiasing of the 3D content.
+		std::unique_ptr<DX::AntiAliasing> m_antiAliasing;
+
 		// TODO: Replace with your own content renderers.
 		std::unique_ptr<Sample3DSceneRenderer> m_sceneRenderer;
 		std::unique_ptr<SampleFpsTextRenderer> m_fpsTextRenderer;
 
-		winrt::Windows::Foundation::IAsyncAction m_renderLoopWorker{ nullptr };
-		Concurrency::critical_section m_criticalSection;
+		// Which of the render loop and the streaming worker run, and how often. Starting and
+		// stopping them is serialized by m_workerMutex.
+		DX::LifecycleScheduler m_lifecycle;
+		std::mutex m_workerMutex;
+
+		// Display changes waiting for the render loop, the latest of each type. Only the render
+		// loop touches device resources, so the UI thread never blocks on a frame in progress,
+		// and however long the loop is stopped no change is lost.
+		std::array<DX::LatestValue<DisplayCommand>, DisplayCommandTypeCount> m_displayCommands;
+		std::atomic<uint64_t> m_appliedDisplayCommands;
+		std::atomic<uint64_t> m_coalescedDisplayCommands;
+		std::atomic<uint64_t> m_maxDisplayCommandLatency;
 
 		// Rendering loop timer.
 		DX::StepTimer m_timer;
 
+		// A snapshot from RestoreState, waiting for the render loop.
+		std::mutex m_restoredStateMutex;
+		std::vector<uint8_t> m_restoredState;
+
+		// Parts of the render target that changed in this frame and the one before. The swap chain
+		// has two buffers, so the buffer being drawn is missing the changes from both frames.
+		DX::DirtyRegion m_frameDamage;
+		DX::DirtyRegion m_previousFrameDamage;
+
+		// Number of upcoming frames that must repaint everything, e.g. after the swap chain is resized.
+		uint32_t m_fullRedrawFrames;
+
+		// Rasterizer state that limits 3D rendering to the repainted area.
+		winrt::com_ptr<ID3D11RasterizerState> m_scissorRasterizerState;
+
+#if defined(DX_ENABLE_PROFILER)
+		// Measures GPU time per frame and per renderer.
+		DX::GpuProfiler m_gpuProfiler;
+#endif
+
+#if defined(DX_ENABLE_GOLDEN_FRAME)
+		// Whether a frame was compared with the software rasterizer's.
+		bool m_goldenFrameChecked = false;
+#endif
+
+		// Pointer samples handed over from the independent input thread.
+		DX::InputEventQueue m_inputQueue;
+
+		// Every sample drained during the current frame, oldest first, for gesture processing.
+		std::vector<DX::InputEvent> m_inputHistory;
+
 		// Track current input pointer position.
 		float m_pointerLocationX;
 	};